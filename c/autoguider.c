@@ -28,17 +28,26 @@
 #include "ccd_general.h"
 #include "ccd_setup.h"
 #include "ccd_temperature.h"
+#include "ccd_trace.h"
 
 #include "autoguider_buffer.h"
+#include "autoguider_calibration_cache.h"
 #include "autoguider_cil.h"
 #include "autoguider_command.h"
 #include "autoguider_dark.h"
+#include "autoguider_exposure.h"
 #include "autoguider_field.h"
+#include "autoguider_fits_writer.h"
 #include "autoguider_flat.h"
 #include "autoguider_general.h"
 #include "autoguider_guide.h"
+#include "autoguider_guide_recorder.h"
+#include "autoguider_housekeeping.h"
 #include "autoguider_object.h"
+#include "autoguider_realtime.h"
 #include "autoguider_server.h"
+#include "autoguider_telemetry.h"
+#include "autoguider_worker_pool.h"
 
 /* hash definitions */
 /**
@@ -73,6 +82,8 @@ static void Help(void);
  * @see #Autoguider_Shutdown_CCD
  * @see autoguider_buffer.html#Autoguider_Buffer_Initialise
  * @see autoguider_buffer.html#Autoguider_Buffer_Shutdown
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Initialise
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Shutdown
  * @see autoguider_cil.html#Autoguider_CIL_Server_Initialise
  * @see autoguider_cil.html#Autoguider_CIL_Server_Start
  * @see autoguider_cil.html#Autoguider_CIL_Server_Stop
@@ -81,14 +92,24 @@ static void Help(void);
  * @see autoguider_dark.html#Autoguider_Dark_Initialise
  * @see autoguider_dark.html#Autoguider_Dark_Shutdown
  * @see autoguider_field.html#Autoguider_Field_Initialise
+ * @see autoguider_fits_writer.html#Autoguider_Fits_Writer_Initialise
+ * @see autoguider_fits_writer.html#Autoguider_Fits_Writer_Shutdown
  * @see autoguider_flat.html#Autoguider_Flat_Initialise
  * @see autoguider_flat.html#Autoguider_Flat_Shutdown
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Get_Config_Filename
  * @see autoguider_guide.html#Autoguider_Guide_Initialise
+ * @see autoguider_guide_recorder.html#Autoguider_Guide_Recorder_Initialise
+ * @see autoguider_guide_recorder.html#Autoguider_Guide_Recorder_Shutdown
+ * @see autoguider_housekeeping.html#Autoguider_Housekeeping_Initialise
  * @see autoguider_object.html#Autoguider_Object_Shutdown
+ * @see autoguider_realtime.html#Autoguider_Realtime_Initialise
+ * @see autoguider_realtime.html#Autoguider_Realtime_Shutdown
  * @see autoguider_server.html#Autoguider_Server_Initialise
  * @see autoguider_server.html#Autoguider_Server_Start
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Initialise
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Shutdown
+ * @see autoguider_worker_pool.html#Autoguider_Worker_Pool_Shutdown
  * @see ../../ccd/cdocs/ccd_config.html#CCD_Config_Initialise
  * @see ../../ccd/cdocs/ccd_config.html#CCD_Config_Load
  * @see ../../ccd/cdocs/ccd_config.html#CCD_Config_Shutdown
@@ -141,6 +162,17 @@ int main(int argc, char *argv[])
 		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 		return 4;
 	}
+	/* initialise real-time mode, before any other threads are created so they inherit the CPU affinity */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Realtime_Initialise.");
+#endif
+	retval = Autoguider_Realtime_Initialise();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		return 4;
+	}
 	/* initialise connection to the CCD */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
@@ -152,6 +184,19 @@ int main(int argc, char *argv[])
 		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 		return 3;
 	}
+	/* start polling the CCD temperature in the background */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Housekeeping_Initialise.");
+#endif
+	retval = Autoguider_Housekeeping_Initialise();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		/* ensure CCD is warmed up */
+		Autoguider_Shutdown_CCD();
+		return 3;
+	}
 	/* initialise field and guide buffers */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
@@ -165,6 +210,19 @@ int main(int argc, char *argv[])
 		Autoguider_Shutdown_CCD();
 		return 5;
 	}
+	/* initialise calibration cache, before the darks and flats are loaded */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Calibration_Cache_Initialise.");
+#endif
+	retval = Autoguider_Calibration_Cache_Initialise();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		/* ensure CCD is warmed up */
+		Autoguider_Shutdown_CCD();
+		return 5;
+	}
 	/* initialise dark handling */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
@@ -178,6 +236,19 @@ int main(int argc, char *argv[])
 		Autoguider_Shutdown_CCD();
 		return 5;
 	}
+	/* initialise exposure length prediction */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Exposure_Initialise.");
+#endif
+	retval = Autoguider_Exposure_Initialise();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		/* ensure CCD is warmed up */
+		Autoguider_Shutdown_CCD();
+		return 5;
+	}
 	/* initialise flat handling */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
@@ -191,6 +262,32 @@ int main(int argc, char *argv[])
 		Autoguider_Shutdown_CCD();
 		return 5;
 	}
+	/* initialise background FITS writer */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Fits_Writer_Initialise.");
+#endif
+	retval = Autoguider_Fits_Writer_Initialise();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		/* ensure CCD is warmed up */
+		Autoguider_Shutdown_CCD();
+		return 5;
+	}
+	/* initialise binary telemetry log */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Telemetry_Initialise.");
+#endif
+	retval = Autoguider_Telemetry_Initialise();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		/* ensure CCD is warmed up */
+		Autoguider_Shutdown_CCD();
+		return 5;
+	}
 	/* initialise field variables - note no equivalent shutdown routine */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
@@ -217,6 +314,19 @@ int main(int argc, char *argv[])
 		Autoguider_Shutdown_CCD();
 		return 5;
 	}
+	/* initialise guide frame recorder */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Guide_Recorder_Initialise.");
+#endif
+	retval = Autoguider_Guide_Recorder_Initialise();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		/* ensure CCD is warmed up */
+		Autoguider_Shutdown_CCD();
+		return 5;
+	}
 	/* initialise object variables - object shutdown routine frees different stuff, this just loads config */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
@@ -316,6 +426,50 @@ int main(int argc, char *argv[])
 		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 		return 2;
 	}
+	/* flush and stop guide frame recorder */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Guide_Recorder_Shutdown.");
+#endif
+	retval = Autoguider_Guide_Recorder_Shutdown();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		return 6;
+	}
+	/* write any queued FITS images and stop FITS writer */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Fits_Writer_Shutdown.");
+#endif
+	retval = Autoguider_Fits_Writer_Shutdown();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		return 6;
+	}
+	/* write any queued telemetry records and stop telemetry log */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Telemetry_Shutdown.");
+#endif
+	retval = Autoguider_Telemetry_Shutdown();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		return 6;
+	}
+	/* stop the field reduction/object detection worker threads */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Worker_Pool_Shutdown.");
+#endif
+	retval = Autoguider_Worker_Pool_Shutdown();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		return 6;
+	}
 	/* object handling */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
@@ -349,6 +503,17 @@ int main(int argc, char *argv[])
 		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 		return 6;
 	}
+	/* free calibration cache */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Calibration_Cache_Shutdown.");
+#endif
+	retval = Autoguider_Calibration_Cache_Shutdown();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		return 6;
+	}
 	/* free buffers */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
@@ -360,6 +525,17 @@ int main(int argc, char *argv[])
 		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
 		return 6;
 	}
+	/* unlock memory */
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP",
+			       "Autoguider_Realtime_Shutdown.");
+#endif
+	retval = Autoguider_Realtime_Shutdown();
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP");
+		return 6;
+	}
 	/* always call Config shutdown, which frees config memory */
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("main","autoguider.c","main",LOG_VERBOSITY_VERY_TERSE,"STARTUP","CCD_Config_Shutdown");
@@ -507,6 +683,7 @@ static int Autoguider_Initialise_Logging(void)
  * Retrieves the registration function from "ccd.driver.registration_function".
  * Configures the CCD library based on "ccd.temperature.target", 
  * "ccd.temperature.cooler.on" and "ccd.exposure.loop.pause.length".
+ * Turns driver call tracing on or off based on "ccd.trace.enable".
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Double
@@ -520,13 +697,14 @@ static int Autoguider_Initialise_Logging(void)
  * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Cooler_On
  * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Cooler_Off
  * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Loop_Pause_Length_Set
+ * @see ../ccd/cdocs/ccd_trace.html#CCD_Trace_Enable_Set
  */
 static int Autoguider_Startup_CCD(void)
 {
 	char *shared_library_name = NULL;
 	char *registration_function = NULL;
 	double target_temperature;
-	int retval,cooler_on,ms;
+	int retval,cooler_on,ms,trace_enable;
 
 	/* driver registration */
 #if AUTOGUIDER_DEBUG > 1
@@ -666,12 +844,24 @@ static int Autoguider_Startup_CCD(void)
 			"CCD_Exposure_Loop_Pause_Length_Set failed.");
 		return FALSE;
 	}
+	/* driver call tracing */
+	retval = CCD_Config_Get_Boolean("ccd.trace.enable",&trace_enable);
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 24;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Startup_CCD:"
+			"Failed to get driver call trace configuration.");
+		return FALSE;
+	}
+	CCD_Trace_Enable_Set(trace_enable);
 	return TRUE;
 }
 
 /**
  * Shutdown the CCD conenction, ramping the temperature to ambient if necessary.
+ * The housekeeping thread is stopped first, so it does not poll the CCD whilst it is shut down.
  * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_housekeeping.html#Autoguider_Housekeeping_Shutdown
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Boolean
  * @see ../ccd/cdocs/ccd_general.html#CCD_General_Error
  * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Get
@@ -690,6 +880,12 @@ static int Autoguider_Shutdown_CCD(void)
 	Autoguider_General_Log("CCD","autoguider.c","Autoguider_Shutdown_CCD",LOG_VERBOSITY_VERBOSE,"SHUTDOWN",
 			       "started.");
 #endif
+	/* stop polling the CCD temperature */
+	if(!Autoguider_Housekeeping_Shutdown())
+	{
+		Autoguider_General_Error("CCD","autoguider.c","Autoguider_Shutdown_CCD",LOG_VERBOSITY_VERBOSE,
+					 "SHUTDOWN"); /* no need to fail */
+	}
 	/* turn the cooler off */
 	retval = CCD_Config_Get_Boolean("ccd.temperature.cooler.off",&cooler_off);
 	if(retval == FALSE)
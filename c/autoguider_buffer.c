@@ -32,6 +32,7 @@
 
 #include "autoguider_general.h"
 #include "autoguider_buffer.h"
+#include "autoguider_realtime.h"
 
 /* hash defines */
 /**
@@ -47,6 +48,8 @@
  * <dt>Bin_Y</dt> <dd>Y binning of buffer.</dd>
  * <dt>Binned_NCols</dt> <dd>Number of binned columns of the buffer.</dd>
  * <dt>Binned_NRows</dt> <dd>Number of binned rows of the buffer.</dd>
+ * <dt>Allocated_Pixel_Count</dt> <dd>The number of pixels each of the raw and reduced buffers is allocated to hold.
+ *     The buffers are only reallocated when a larger image is needed.</dd>
  * <dt>Raw_Buffer_List</dt> <dd>Array of AUTOGUIDER_BUFFER_COUNT pointer to allocated arrays of unsigned shorts,
  *     the actual raw field image buffers.</dd>
  * <dt>Raw_Mutex_List</dt> <dd>Array of AUTOGUIDER_BUFFER_COUNT mutexs to protect the raw buffers 
@@ -70,6 +73,7 @@ struct Buffer_One_Struct
 	int Bin_Y;
 	int Binned_NCols;
 	int Binned_NRows;
+	int Allocated_Pixel_Count;
 	unsigned short *Raw_Buffer_List[AUTOGUIDER_BUFFER_COUNT];
 	pthread_mutex_t Raw_Mutex_List[AUTOGUIDER_BUFFER_COUNT];
 	float *Reduced_Buffer_List[AUTOGUIDER_BUFFER_COUNT];
@@ -107,6 +111,7 @@ static struct Buffer_Struct Buffer_Data =
 {
 	{
 		1,1,0,0, /* dimensions */
+		0, /* Allocated_Pixel_Count */
 		{NULL,NULL}, /* Raw_Buffer_List */
 		{PTHREAD_MUTEX_INITIALIZER,PTHREAD_MUTEX_INITIALIZER}, /* Raw_Mutex_List */
 		{NULL,NULL}, /* Reduced_Buffer_List */
@@ -116,6 +121,7 @@ static struct Buffer_Struct Buffer_Data =
 	},
 	{
 		1,1,0,0, /* dimensions */
+		0, /* Allocated_Pixel_Count */
 		{NULL,NULL}, /* Raw_Buffer_List */
 		{PTHREAD_MUTEX_INITIALIZER,PTHREAD_MUTEX_INITIALIZER}, /* Raw_Mutex_List */
 		{NULL,NULL}, /* Reduced_Buffer_List */
@@ -140,11 +146,13 @@ static int Buffer_One_Reduced_Copy(struct Buffer_One_Struct *data,int index,floa
 ** ---------------------------------------------------------------------------- */
 /**
  * Initialise the readout buffers. Assumes CCD_Config_Load has already loaded the configuration.
+ * In real-time mode, the guide buffers are first sized to hold a full frame guide window.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Buffer_Data
  * @see autoguider.general.html#Autoguider_General_Log
  * @see autoguider.general.html#Autoguider_General_Error_Number
  * @see autoguider.general.html#Autoguider_General_Error_String
+ * @see autoguider_realtime.html#Autoguider_Realtime_Is_Enabled
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
  */
 int Autoguider_Buffer_Initialise(void)
@@ -191,6 +199,14 @@ int Autoguider_Buffer_Initialise(void)
 	retval = Autoguider_Buffer_Set_Field_Dimension(ncols,nrows,x_bin,y_bin);
 	if(retval == FALSE)
 		return FALSE;
+	/* in real-time mode, reserve guide buffers big enough for any (unbinned) guide window now,
+	** so the guide buffers are never reallocated whilst guiding */
+	if(Autoguider_Realtime_Is_Enabled())
+	{
+		retval = Autoguider_Buffer_Set_Guide_Dimension(ncols,nrows,1,1);
+		if(retval == FALSE)
+			return FALSE;
+	}
 	/* get default config */
 	/* guide */
 	retval = CCD_Config_Get_Integer("guide.ncols.default",&ncols);
@@ -219,7 +235,9 @@ int Autoguider_Buffer_Initialise(void)
 }
 
 /**
- * Set the field dimensions, and (re) allocate the buffers accordingly.
+ * Set the field dimensions, and (re) allocate the buffers accordingly. The buffers are only
+ * reallocated if they are too small for the new dimensions. They are allocated with
+ * Autoguider_Realtime_Buffer_Allocate, so are cache line aligned (and prefaulted in real-time mode).
  * Locks/unlocks the associated mutex.
  * @param ncols Number of unbinned columns.
  * @param nrows Number of unbinned rows.
@@ -233,10 +251,11 @@ int Autoguider_Buffer_Initialise(void)
  * @see autoguider.general.html#Autoguider_General_Log
  * @see autoguider.general.html#Autoguider_General_Error_Number
  * @see autoguider.general.html#Autoguider_General_Error_String
+ * @see autoguider_realtime.html#Autoguider_Realtime_Buffer_Allocate
  */
 int Autoguider_Buffer_Set_Field_Dimension(int ncols,int nrows,int x_bin,int y_bin)
 {
-	int i,retval;
+	int i,retval,pixel_count;
 
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("buffer","autoguider_buffer.c","Autoguider_Buffer_Set_Field_Dimension",
@@ -246,6 +265,7 @@ int Autoguider_Buffer_Set_Field_Dimension(int ncols,int nrows,int x_bin,int y_bi
 	Buffer_Data.Field.Bin_Y = x_bin;
 	Buffer_Data.Field.Binned_NCols = ncols/x_bin;
 	Buffer_Data.Field.Binned_NRows = nrows/y_bin;
+	pixel_count = Buffer_Data.Field.Binned_NCols*Buffer_Data.Field.Binned_NRows;
 	for(i=0;i < AUTOGUIDER_BUFFER_COUNT; i++)
 	{
 		/* raw */
@@ -253,19 +273,14 @@ int Autoguider_Buffer_Set_Field_Dimension(int ncols,int nrows,int x_bin,int y_bi
 		retval = Autoguider_General_Mutex_Lock(&(Buffer_Data.Field.Raw_Mutex_List[i]));
 		if(retval == FALSE)
 			return FALSE;
-		if(Buffer_Data.Field.Raw_Buffer_List[i] == NULL)
-		{
-			Buffer_Data.Field.Raw_Buffer_List[i] = (unsigned short *)malloc(Buffer_Data.Field.Binned_NCols*
-						Buffer_Data.Field.Binned_NRows * sizeof(unsigned short));
-		}
-		else
+		if(pixel_count > Buffer_Data.Field.Allocated_Pixel_Count)
 		{
-			Buffer_Data.Field.Raw_Buffer_List[i] = (unsigned short *)realloc(
-                           Buffer_Data.Field.Raw_Buffer_List[i],
-			   (Buffer_Data.Field.Binned_NCols * Buffer_Data.Field.Binned_NRows * sizeof(unsigned short)));
+			retval = Autoguider_Realtime_Buffer_Allocate((void **)&(Buffer_Data.Field.Raw_Buffer_List[i]),
+								     pixel_count*sizeof(unsigned short));
 		}
 		if(Buffer_Data.Field.Raw_Buffer_List[i] == NULL)
 		{
+			Buffer_Data.Field.Allocated_Pixel_Count = 0;
 			/* unlock mutex */
 			Autoguider_General_Mutex_Unlock(&(Buffer_Data.Field.Raw_Mutex_List[i]));
 			Autoguider_General_Error_Number = 406;
@@ -283,19 +298,14 @@ int Autoguider_Buffer_Set_Field_Dimension(int ncols,int nrows,int x_bin,int y_bi
 		retval = Autoguider_General_Mutex_Lock(&(Buffer_Data.Field.Reduced_Mutex_List[i]));
 		if(retval == FALSE)
 			return FALSE;
-		if(Buffer_Data.Field.Reduced_Buffer_List[i] == NULL)
+		if(pixel_count > Buffer_Data.Field.Allocated_Pixel_Count)
 		{
-			Buffer_Data.Field.Reduced_Buffer_List[i] = (float *)malloc(Buffer_Data.Field.Binned_NCols*
-						Buffer_Data.Field.Binned_NRows * sizeof(float));
-		}
-		else
-		{
-			Buffer_Data.Field.Reduced_Buffer_List[i] = (float *)realloc(
-                           Buffer_Data.Field.Reduced_Buffer_List[i],
-			   (Buffer_Data.Field.Binned_NCols * Buffer_Data.Field.Binned_NRows * sizeof(float)));
+			retval = Autoguider_Realtime_Buffer_Allocate((void **)&(Buffer_Data.Field.Reduced_Buffer_List[i]),
+								     pixel_count*sizeof(float));
 		}
 		if(Buffer_Data.Field.Reduced_Buffer_List[i] == NULL)
 		{
+			Buffer_Data.Field.Allocated_Pixel_Count = 0;
 			/* unlock mutex */
 			Autoguider_General_Mutex_Unlock(&(Buffer_Data.Field.Reduced_Mutex_List[i]));
 			Autoguider_General_Error_Number = 414;
@@ -309,6 +319,8 @@ int Autoguider_Buffer_Set_Field_Dimension(int ncols,int nrows,int x_bin,int y_bi
 		if(retval == FALSE)
 			return FALSE;
 	}
+	if(pixel_count > Buffer_Data.Field.Allocated_Pixel_Count)
+		Buffer_Data.Field.Allocated_Pixel_Count = pixel_count;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("buffer","autoguider_buffer.c","Autoguider_Buffer_Set_Field_Dimension",
 			       LOG_VERBOSITY_VERY_VERBOSE,"BUFFER","finished.");
@@ -317,7 +329,9 @@ int Autoguider_Buffer_Set_Field_Dimension(int ncols,int nrows,int x_bin,int y_bi
 }
 
 /**
- * Set the guide dimensions, and (re) allocate the buffers accordingly.
+ * Set the guide dimensions, and (re) allocate the buffers accordingly. The buffers are only
+ * reallocated if they are too small for the new dimensions. They are allocated with
+ * Autoguider_Realtime_Buffer_Allocate, so are cache line aligned (and prefaulted in real-time mode).
  * Locks/unlocks the associated mutex.
  * @param ncols Number of binned (window) columns.
  * @param nrows Number of binned (window) rows.
@@ -330,10 +344,11 @@ int Autoguider_Buffer_Set_Field_Dimension(int ncols,int nrows,int x_bin,int y_bi
  * @see autoguider.general.html#Autoguider_General_Log
  * @see autoguider.general.html#Autoguider_General_Error_Number
  * @see autoguider.general.html#Autoguider_General_Error_String
+ * @see autoguider_realtime.html#Autoguider_Realtime_Buffer_Allocate
  */
 int Autoguider_Buffer_Set_Guide_Dimension(int ncols,int nrows,int x_bin,int y_bin)
 {
-	int i,retval;
+	int i,retval,pixel_count;
 
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("buffer","autoguider_buffer.c","Autoguider_Buffer_Set_Guide_Dimension",
@@ -343,6 +358,7 @@ int Autoguider_Buffer_Set_Guide_Dimension(int ncols,int nrows,int x_bin,int y_bi
 	Buffer_Data.Guide.Bin_Y = x_bin;
 	Buffer_Data.Guide.Binned_NCols = ncols;
 	Buffer_Data.Guide.Binned_NRows = nrows;
+	pixel_count = Buffer_Data.Guide.Binned_NCols*Buffer_Data.Guide.Binned_NRows;
 	for(i=0;i < AUTOGUIDER_BUFFER_COUNT; i++)
 	{
 		/* raw */
@@ -350,19 +366,14 @@ int Autoguider_Buffer_Set_Guide_Dimension(int ncols,int nrows,int x_bin,int y_bi
 		retval = Autoguider_General_Mutex_Lock(&(Buffer_Data.Guide.Raw_Mutex_List[i]));
 		if(retval == FALSE)
 			return FALSE;
-		if(Buffer_Data.Guide.Raw_Buffer_List[i] == NULL)
+		if(pixel_count > Buffer_Data.Guide.Allocated_Pixel_Count)
 		{
-			Buffer_Data.Guide.Raw_Buffer_List[i] = (unsigned short *)malloc(Buffer_Data.Guide.Binned_NCols*
-						Buffer_Data.Guide.Binned_NRows * sizeof(unsigned short));
-		}
-		else
-		{
-			Buffer_Data.Guide.Raw_Buffer_List[i] = (unsigned short *)realloc(
-                           Buffer_Data.Guide.Raw_Buffer_List[i],
-			   (Buffer_Data.Guide.Binned_NCols * Buffer_Data.Guide.Binned_NRows * sizeof(unsigned short)));
+			retval = Autoguider_Realtime_Buffer_Allocate((void **)&(Buffer_Data.Guide.Raw_Buffer_List[i]),
+								     pixel_count*sizeof(unsigned short));
 		}
 		if(Buffer_Data.Guide.Raw_Buffer_List[i] == NULL)
 		{
+			Buffer_Data.Guide.Allocated_Pixel_Count = 0;
 			/* unlock mutex */
 			Autoguider_General_Mutex_Unlock(&(Buffer_Data.Guide.Raw_Mutex_List[i]));
 			Autoguider_General_Error_Number = 407;
@@ -380,19 +391,14 @@ int Autoguider_Buffer_Set_Guide_Dimension(int ncols,int nrows,int x_bin,int y_bi
 		retval = Autoguider_General_Mutex_Lock(&(Buffer_Data.Guide.Reduced_Mutex_List[i]));
 		if(retval == FALSE)
 			return FALSE;
-		if(Buffer_Data.Guide.Reduced_Buffer_List[i] == NULL)
-		{
-			Buffer_Data.Guide.Reduced_Buffer_List[i] = (float *)malloc(Buffer_Data.Guide.Binned_NCols*
-						Buffer_Data.Guide.Binned_NRows * sizeof(float));
-		}
-		else
+		if(pixel_count > Buffer_Data.Guide.Allocated_Pixel_Count)
 		{
-			Buffer_Data.Guide.Reduced_Buffer_List[i] = (float *)realloc(
-                           Buffer_Data.Guide.Reduced_Buffer_List[i],
-			   (Buffer_Data.Guide.Binned_NCols * Buffer_Data.Guide.Binned_NRows * sizeof(float)));
+			retval = Autoguider_Realtime_Buffer_Allocate((void **)&(Buffer_Data.Guide.Reduced_Buffer_List[i]),
+								     pixel_count*sizeof(float));
 		}
 		if(Buffer_Data.Guide.Reduced_Buffer_List[i] == NULL)
 		{
+			Buffer_Data.Guide.Allocated_Pixel_Count = 0;
 			/* unlock mutex */
 			Autoguider_General_Mutex_Unlock(&(Buffer_Data.Guide.Reduced_Mutex_List[i]));
 			Autoguider_General_Error_Number = 415;
@@ -406,6 +412,8 @@ int Autoguider_Buffer_Set_Guide_Dimension(int ncols,int nrows,int x_bin,int y_bi
 		if(retval == FALSE)
 			return FALSE;
 	}
+	if(pixel_count > Buffer_Data.Guide.Allocated_Pixel_Count)
+		Buffer_Data.Guide.Allocated_Pixel_Count = pixel_count;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("buffer","autoguider_buffer.c","Autoguider_Buffer_Set_Guide_Dimension",
 			       LOG_VERBOSITY_VERY_VERBOSE,"BUFFER","finished.");
@@ -1270,6 +1278,8 @@ int Autoguider_Buffer_Shutdown(void)
 		if(retval == FALSE)
 			return FALSE;
 	}
+	Buffer_Data.Field.Allocated_Pixel_Count = 0;
+	Buffer_Data.Guide.Allocated_Pixel_Count = 0;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("buffer","autoguider_buffer.c","Autoguider_Buffer_Shutdown",
 			       LOG_VERBOSITY_VERY_VERBOSE,"BUFFER","finished.");
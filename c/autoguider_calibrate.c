@@ -0,0 +1,781 @@
+/* autoguider_calibrate.c
+** Autoguider calibration frame routines
+** $Header$
+*/
+/**
+ * Routines to build master dark and flat frames inside the autoguider, for the "calibrate" command.
+ * Frames are taken back to back with the CCD library, and combined as they are read out, so only one frame
+ * and three per-pixel accumulators (sum, minimum and maximum) are held in memory, however many frames are taken.
+ * The combined value of each pixel is the mean of its frames with the highest and lowest values rejected
+ * (if three or more frames are taken), which is exact, and removes cosmic rays and other single frame outliers.
+ * Flat frames are dark subtracted (using the dark for the flat exposure length) and scaled to a mean of 1.0
+ * before they are combined, so a changing sky level does not bias the rejection, and the master flat is
+ * normalised to a mean of 1.0.
+ * The master is written to a temporary file and renamed into place. If it replaces the configured dark/flat
+ * for the binning (and exposure length), the dark/flat module is told to reload it.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fitsio.h"
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+#include "ccd_exposure.h"
+#include "ccd_general.h"
+#include "ccd_setup.h"
+
+#include "autoguider_calibrate.h"
+#include "autoguider_dark.h"
+#include "autoguider_field.h"
+#include "autoguider_fits_header.h"
+#include "autoguider_flat.h"
+#include "autoguider_general.h"
+#include "autoguider_guide.h"
+
+/* hash defines */
+/**
+ * Calibration type for a master dark.
+ */
+#define CALIBRATE_TYPE_DARK		(1)
+/**
+ * Calibration type for a master flat.
+ */
+#define CALIBRATE_TYPE_FLAT		(2)
+/**
+ * The minimum number of frames for which the highest and lowest value of each pixel are rejected.
+ */
+#define CALIBRATE_REJECT_FRAME_COUNT	(3)
+
+/* data types */
+/**
+ * Data type holding local data to autoguider_calibrate. This consists of the following:
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex held whilst Is_Calibrating is tested and set, so two calibrate commands
+ *     cannot both start a build.</dd>
+ * <dt>Is_Calibrating</dt> <dd>A boolean, TRUE whilst a master frame is being built.</dd>
+ * <dt>Abort</dt> <dd>A boolean, set by Autoguider_Calibrate_Abort to stop the current build.</dd>
+ * </dl>
+ */
+struct Calibrate_Struct
+{
+	pthread_mutex_t Mutex;
+	int Is_Calibrating;
+	int Abort;
+};
+
+/**
+ * Data type holding the buffers used whilst building a master frame. This consists of the following:
+ * <dl>
+ * <dt>Raw</dt> <dd>The raw frame read out from the CCD.</dd>
+ * <dt>Frame</dt> <dd>The current frame as floats (dark subtracted and scaled for flats). The combined master
+ *     is written into this buffer once all the frames are taken.</dd>
+ * <dt>Sum</dt> <dd>The per-pixel sum of the frames.</dd>
+ * <dt>Min</dt> <dd>The per-pixel minimum of the frames.</dd>
+ * <dt>Max</dt> <dd>The per-pixel maximum of the frames.</dd>
+ * </dl>
+ */
+struct Calibrate_Buffer_Struct
+{
+	unsigned short *Raw;
+	float *Frame;
+	double *Sum;
+	float *Min;
+	float *Max;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of calibrate data.
+ * @see #Calibrate_Struct
+ */
+static struct Calibrate_Struct Calibrate_Data = {PTHREAD_MUTEX_INITIALIZER,FALSE,FALSE};
+
+/* internal functions */
+static int Calibrate_Build(int type,int bin,int exposure_length,int exposure_count,char *filename,
+			   struct Autoguider_Calibrate_Result_Struct *result);
+static int Calibrate_Combine(int type,int bin,int exposure_length,int exposure_count,
+			     struct Calibrate_Buffer_Struct *buffers,int ncols,int nrows,double *mean);
+static int Calibrate_Buffer_Allocate(struct Calibrate_Buffer_Struct *buffers,int pixel_count);
+static void Calibrate_Buffer_Free(struct Calibrate_Buffer_Struct *buffers);
+static int Calibrate_Write(int type,char *filename,float *data,int ncols,int nrows,int bin,int exposure_length,
+			   int exposure_count);
+static void Calibrate_Swap(int type,int bin,int exposure_length);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Build a master dark from a number of (closed shutter) exposures. This fails if the dark model is enabled.
+ * @param bin The binning, in X and Y.
+ * @param exposure_length The exposure length of each frame, in milliseconds.
+ * @param exposure_count The number of frames to take.
+ * @param filename The FITS leafname to write the master dark to in the calibration directory
+ *        ("calibrate.directory"), or NULL to write it to the configured dark
+ *        filename for the binning and exposure length ("dark.filename.&lt;bin&gt;.&lt;bin&gt;.&lt;ms&gt;"),
+ *        and use it for dark subtraction.
+ * @param result The address of a structure to fill in with a description of the master.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibrate_Build
+ */
+int Autoguider_Calibrate_Dark(int bin,int exposure_length,int exposure_count,char *filename,
+			      struct Autoguider_Calibrate_Result_Struct *result)
+{
+	return Calibrate_Build(CALIBRATE_TYPE_DARK,bin,exposure_length,exposure_count,filename,result);
+}
+
+/**
+ * Build a master flat from a number of exposures of a flat field. Each frame is dark subtracted, using the
+ * configured dark for the binning and exposure length.
+ * @param bin The binning, in X and Y.
+ * @param exposure_length The exposure length of each frame, in milliseconds.
+ * @param exposure_count The number of frames to take.
+ * @param filename The FITS leafname to write the master flat to in the calibration directory
+ *        ("calibrate.directory"), or NULL to write it to the configured flat
+ *        filename for the binning ("flat.filename.&lt;bin&gt;.&lt;bin&gt;"), and use it for flat fielding.
+ * @param result The address of a structure to fill in with a description of the master.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibrate_Build
+ */
+int Autoguider_Calibrate_Flat(int bin,int exposure_length,int exposure_count,char *filename,
+			      struct Autoguider_Calibrate_Result_Struct *result)
+{
+	return Calibrate_Build(CALIBRATE_TYPE_FLAT,bin,exposure_length,exposure_count,filename,result);
+}
+
+/**
+ * Abort the master frame being built. The exposure in progress is aborted, and no master is written.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibrate_Data
+ * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Abort
+ */
+int Autoguider_Calibrate_Abort(void)
+{
+	Calibrate_Data.Abort = TRUE;
+	if(!CCD_Exposure_Abort())
+	{
+		Autoguider_General_Error_Number = 2100;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibrate_Abort:CCD_Exposure_Abort failed.");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Return whether a master frame is being built.
+ * @return The routine returns TRUE if a master frame is being built, and FALSE otherwise.
+ * @see #Calibrate_Data
+ */
+int Autoguider_Calibrate_Is_Calibrating(void)
+{
+	return Calibrate_Data.Is_Calibrating;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Build a master dark or flat.
+ * <ul>
+ * <li>We check the parameters. A specified filename must be a leafname, it is written into the configured
+ *     calibration directory ("calibrate.directory"), so a client cannot write anywhere else on disc.
+ * <li>Master darks are rejected when the dark model is enabled, as the dark module then synthesises darks
+ *     from the model frames, and never reads the "dark.filename" masters.
+ * <li>We check that we are not already fielding, guiding or calibrating, and set Is_Calibrating, with the
+ *     calibrate mutex locked.
+ * <li>We get the output filename, from the config if one is not specified. If the output filename is the
+ *     configured dark/flat filename, the master replaces the current calibration.
+ * <li>We get the unbinned dimensions from the "ccd.field.ncols" and "ccd.field.nrows" config,
+ *     and set up the CCD full frame with the specified binning.
+ * <li>We call Calibrate_Combine to take and combine the frames.
+ * <li>We call Calibrate_Write to write the master, and Calibrate_Swap to reload it if it replaced the
+ *     configured dark/flat.
+ * </ul>
+ * @param type The calibration type, CALIBRATE_TYPE_DARK or CALIBRATE_TYPE_FLAT.
+ * @param bin The binning, in X and Y.
+ * @param exposure_length The exposure length of each frame, in milliseconds.
+ * @param exposure_count The number of frames to take.
+ * @param filename The FITS leafname to write the master to in the calibration directory,
+ *        or NULL to use the configured filename.
+ * @param result The address of a structure to fill in with a description of the master.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #CALIBRATE_TYPE_DARK
+ * @see #CALIBRATE_TYPE_FLAT
+ * @see #Calibrate_Data
+ * @see #Calibrate_Buffer_Allocate
+ * @see #Calibrate_Combine
+ * @see #Calibrate_Write
+ * @see #Calibrate_Swap
+ * @see autoguider_field.html#Autoguider_Field_Is_Fielding
+ * @see autoguider_guide.html#Autoguider_Guide_Is_Guiding
+ * @see autoguider_dark.html#Autoguider_Dark_Model_Is_Enabled
+ * @see autoguider_general.html#Autoguider_General_Filename_Is_Leafname
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ * @see ../ccd/cdocs/ccd_setup.html#CCD_Setup_Dimensions
+ */
+static int Calibrate_Build(int type,int bin,int exposure_length,int exposure_count,char *filename,
+			   struct Autoguider_Calibrate_Result_Struct *result)
+{
+	struct Calibrate_Buffer_Struct buffers = {NULL,NULL,NULL,NULL,NULL};
+	struct CCD_Setup_Window_Struct window;
+	struct timespec start_time,end_time;
+	char keyword_string[64];
+	char *config_filename = NULL;
+	char *directory_name = NULL;
+	int retval,ncols,nrows;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("calibrate","autoguider_calibrate.c","Calibrate_Build",
+				      LOG_VERBOSITY_TERSE,"CALIBRATE","started(type=%d,bin=%d,exposure_length=%d,"
+				      "exposure_count=%d).",type,bin,exposure_length,exposure_count);
+#endif
+	/* check parameters */
+	if(result == NULL)
+	{
+		Autoguider_General_Error_Number = 2101;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:result was NULL.");
+		return FALSE;
+	}
+	if(bin < 1)
+	{
+		Autoguider_General_Error_Number = 2102;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:Binning out of range(%d).",bin);
+		return FALSE;
+	}
+	if(exposure_length < 0)
+	{
+		Autoguider_General_Error_Number = 2103;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:Exposure length out of range(%d).",
+			exposure_length);
+		return FALSE;
+	}
+	if(exposure_count < 1)
+	{
+		Autoguider_General_Error_Number = 2104;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:Exposure count out of range(%d).",
+			exposure_count);
+		return FALSE;
+	}
+	if((filename != NULL)&&(!Autoguider_General_Filename_Is_Leafname(filename)))
+	{
+		Autoguider_General_Error_Number = 2122;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:"
+			"Filename '%s' is not a leafname in the calibration directory.",filename);
+		return FALSE;
+	}
+	/* the dark model synthesises darks from its own frames, a master dark would never be used */
+	if((type == CALIBRATE_TYPE_DARK)&&Autoguider_Dark_Model_Is_Enabled())
+	{
+		Autoguider_General_Error_Number = 2123;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:"
+			"Dark model enabled, master darks are not used.");
+		return FALSE;
+	}
+	/* check we are not doing anything else with the CCD */
+	if(!Autoguider_General_Mutex_Lock(&(Calibrate_Data.Mutex)))
+		return FALSE;
+	if(Calibrate_Data.Is_Calibrating)
+	{
+		Autoguider_General_Mutex_Unlock(&(Calibrate_Data.Mutex));
+		Autoguider_General_Error_Number = 2106;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:Already calibrating.");
+		return FALSE;
+	}
+	if(Autoguider_Field_Is_Fielding())
+	{
+		Autoguider_General_Mutex_Unlock(&(Calibrate_Data.Mutex));
+		Autoguider_General_Error_Number = 2107;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:Already fielding.");
+		return FALSE;
+	}
+	if(Autoguider_Guide_Is_Guiding())
+	{
+		Autoguider_General_Mutex_Unlock(&(Calibrate_Data.Mutex));
+		Autoguider_General_Error_Number = 2108;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:Already guiding.");
+		return FALSE;
+	}
+	Calibrate_Data.Is_Calibrating = TRUE;
+	Calibrate_Data.Abort = FALSE;
+	if(!Autoguider_General_Mutex_Unlock(&(Calibrate_Data.Mutex)))
+	{
+		Calibrate_Data.Is_Calibrating = FALSE;
+		return FALSE;
+	}
+	clock_gettime(CLOCK_REALTIME,&start_time);
+	/* get the configured filename, which the master replaces if no filename is specified */
+	if(type == CALIBRATE_TYPE_DARK)
+		sprintf(keyword_string,"dark.filename.%d.%d.%d",bin,bin,exposure_length);
+	else
+		sprintf(keyword_string,"flat.filename.%d.%d",bin,bin);
+	if(!CCD_Config_Get_String(keyword_string,&config_filename))
+		config_filename = NULL;
+	if(filename == NULL)
+	{
+		if((config_filename == NULL)||(strlen(config_filename) >= (AUTOGUIDER_CALIBRATE_FILENAME_LENGTH-8)))
+		{
+			if(config_filename != NULL)
+				free(config_filename);
+			Calibrate_Data.Is_Calibrating = FALSE;
+			Autoguider_General_Error_Number = 2109;
+			sprintf(Autoguider_General_Error_String,"Calibrate_Build:"
+				"No filename specified, and no usable filename configured (%s).",keyword_string);
+			return FALSE;
+		}
+		strcpy(result->Filename,config_filename);
+	}
+	else
+	{
+		if(!CCD_Config_Get_String("calibrate.directory",&directory_name))
+		{
+			if(config_filename != NULL)
+				free(config_filename);
+			Calibrate_Data.Is_Calibrating = FALSE;
+			Autoguider_General_Error_Number = 2124;
+			sprintf(Autoguider_General_Error_String,"Calibrate_Build:"
+				"Failed to get config:'calibrate.directory'.");
+			return FALSE;
+		}
+		if((strlen(directory_name)+strlen(filename)+1) >= (AUTOGUIDER_CALIBRATE_FILENAME_LENGTH-8))
+		{
+			Autoguider_General_Error_Number = 2105;
+			sprintf(Autoguider_General_Error_String,"Calibrate_Build:Filename too long(%ld).",
+				(long)(strlen(directory_name)+strlen(filename)+1));
+			free(directory_name);
+			if(config_filename != NULL)
+				free(config_filename);
+			Calibrate_Data.Is_Calibrating = FALSE;
+			return FALSE;
+		}
+		sprintf(result->Filename,"%s/%s",directory_name,filename);
+		free(directory_name);
+	}
+	result->Is_Swapped = ((config_filename != NULL)&&(strcmp(config_filename,result->Filename) == 0));
+	if(config_filename != NULL)
+		free(config_filename);
+	config_filename = NULL;
+	/* get the dimensions, and set up the CCD */
+	if(!CCD_Config_Get_Integer("ccd.field.ncols",&ncols))
+	{
+		Calibrate_Data.Is_Calibrating = FALSE;
+		Autoguider_General_Error_Number = 2110;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:Failed to get config:'ccd.field.ncols'.");
+		return FALSE;
+	}
+	if(!CCD_Config_Get_Integer("ccd.field.nrows",&nrows))
+	{
+		Calibrate_Data.Is_Calibrating = FALSE;
+		Autoguider_General_Error_Number = 2111;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:Failed to get config:'ccd.field.nrows'.");
+		return FALSE;
+	}
+	if(!CCD_Setup_Dimensions(ncols,nrows,bin,bin,FALSE,window))
+	{
+		Calibrate_Data.Is_Calibrating = FALSE;
+		Autoguider_General_Error_Number = 2112;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Build:CCD_Setup_Dimensions failed.");
+		return FALSE;
+	}
+	ncols = CCD_Setup_Get_NCols();
+	nrows = CCD_Setup_Get_NRows();
+	if(!Calibrate_Buffer_Allocate(&buffers,ncols*nrows))
+	{
+		Calibrate_Data.Is_Calibrating = FALSE;
+		return FALSE;
+	}
+	/* take and combine the frames */
+	retval = Calibrate_Combine(type,bin,exposure_length,exposure_count,&buffers,ncols,nrows,&(result->Mean));
+	if(retval == FALSE)
+	{
+		Calibrate_Buffer_Free(&buffers);
+		Calibrate_Data.Is_Calibrating = FALSE;
+		return FALSE;
+	}
+	/* write the master */
+	retval = Calibrate_Write(type,result->Filename,buffers.Frame,ncols,nrows,bin,exposure_length,exposure_count);
+	Calibrate_Buffer_Free(&buffers);
+	if(retval == FALSE)
+	{
+		Calibrate_Data.Is_Calibrating = FALSE;
+		return FALSE;
+	}
+	if(result->Is_Swapped)
+		Calibrate_Swap(type,bin,exposure_length);
+	clock_gettime(CLOCK_REALTIME,&end_time);
+	result->Frame_Count = exposure_count;
+	result->Elapsed_Time = fdifftime(end_time,start_time);
+	Calibrate_Data.Is_Calibrating = FALSE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("calibrate","autoguider_calibrate.c","Calibrate_Build",
+				      LOG_VERBOSITY_TERSE,"CALIBRATE","finished(%s written in %.2f s).",
+				      result->Filename,result->Elapsed_Time);
+#endif
+	return TRUE;
+}
+
+/**
+ * Take the frames, and combine them into the master. Each frame is exposed into buffers->Raw, converted into
+ * buffers->Frame (and for flats dark subtracted and scaled to a mean of 1.0), and added into the per-pixel
+ * sum, minimum and maximum. The master is then written into buffers->Frame: the mean of each pixel with its
+ * minimum and maximum rejected if CALIBRATE_REJECT_FRAME_COUNT or more frames were taken, otherwise the mean.
+ * A master flat is normalised to a mean of 1.0.
+ * @param type The calibration type, CALIBRATE_TYPE_DARK or CALIBRATE_TYPE_FLAT.
+ * @param bin The binning, in X and Y.
+ * @param exposure_length The exposure length of each frame, in milliseconds.
+ * @param exposure_count The number of frames to take.
+ * @param buffers The allocated buffers.
+ * @param ncols The number of binned columns.
+ * @param nrows The number of binned rows.
+ * @param mean The address of a double, on return the mean of the master (darks), or the mean of the
+ *        dark subtracted flat frames before scaling (flats).
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #CALIBRATE_REJECT_FRAME_COUNT
+ * @see #Calibrate_Data
+ * @see autoguider_dark.html#Autoguider_Dark_Set
+ * @see autoguider_dark.html#Autoguider_Dark_Subtract
+ * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Expose
+ */
+static int Calibrate_Combine(int type,int bin,int exposure_length,int exposure_count,
+			     struct Calibrate_Buffer_Struct *buffers,int ncols,int nrows,double *mean)
+{
+	struct CCD_Setup_Window_Struct window;
+	struct timespec start_time;
+	double frame_mean,frame_mean_total,master_mean;
+	float value,scale;
+	int i,frame,pixel_count;
+
+	pixel_count = ncols*nrows;
+	/* flats are dark subtracted with the dark for the same binning and exposure length */
+	if(type == CALIBRATE_TYPE_FLAT)
+	{
+		if(!Autoguider_Dark_Set(bin,bin,exposure_length))
+			return FALSE;
+	}
+	start_time.tv_sec = 0;
+	start_time.tv_nsec = 0;
+	frame_mean_total = 0.0;
+	for(frame = 0; frame < exposure_count; frame++)
+	{
+		if(Calibrate_Data.Abort)
+		{
+			Autoguider_General_Error_Number = 2113;
+			sprintf(Autoguider_General_Error_String,"Calibrate_Combine:Aborted after %d of %d frames.",
+				frame,exposure_count);
+			return FALSE;
+		}
+#if AUTOGUIDER_DEBUG > 5
+		Autoguider_General_Log_Format("calibrate","autoguider_calibrate.c","Calibrate_Combine",
+					      LOG_VERBOSITY_VERBOSE,"CALIBRATE","Taking frame %d of %d.",
+					      frame+1,exposure_count);
+#endif
+		if(!CCD_Exposure_Expose((type == CALIBRATE_TYPE_FLAT),start_time,exposure_length,buffers->Raw,
+					pixel_count))
+		{
+			Autoguider_General_Error_Number = 2114;
+			sprintf(Autoguider_General_Error_String,"Calibrate_Combine:"
+				"CCD_Exposure_Expose failed for frame %d of %d.",frame+1,exposure_count);
+			return FALSE;
+		}
+		frame_mean = 0.0;
+		for(i = 0; i < pixel_count; i++)
+			buffers->Frame[i] = (float)(buffers->Raw[i]);
+		if(type == CALIBRATE_TYPE_FLAT)
+		{
+			if(!Autoguider_Dark_Subtract(buffers->Frame,pixel_count,ncols,nrows,FALSE,window))
+				return FALSE;
+			for(i = 0; i < pixel_count; i++)
+				frame_mean += buffers->Frame[i];
+			frame_mean /= (double)pixel_count;
+			if(frame_mean <= 0.0)
+			{
+				Autoguider_General_Error_Number = 2115;
+				sprintf(Autoguider_General_Error_String,"Calibrate_Combine:"
+					"Flat frame %d of %d has a dark subtracted mean of %.2f.",frame+1,
+					exposure_count,frame_mean);
+				return FALSE;
+			}
+			scale = (float)(1.0/frame_mean);
+			for(i = 0; i < pixel_count; i++)
+				buffers->Frame[i] *= scale;
+			frame_mean_total += frame_mean;
+		}
+		/* accumulate */
+		if(frame == 0)
+		{
+			for(i = 0; i < pixel_count; i++)
+			{
+				value = buffers->Frame[i];
+				buffers->Sum[i] = value;
+				buffers->Min[i] = value;
+				buffers->Max[i] = value;
+			}
+		}
+		else
+		{
+			for(i = 0; i < pixel_count; i++)
+			{
+				value = buffers->Frame[i];
+				buffers->Sum[i] += value;
+				if(value < buffers->Min[i])
+					buffers->Min[i] = value;
+				if(value > buffers->Max[i])
+					buffers->Max[i] = value;
+			}
+		}
+	}
+	/* combine */
+	master_mean = 0.0;
+	for(i = 0; i < pixel_count; i++)
+	{
+		if(exposure_count >= CALIBRATE_REJECT_FRAME_COUNT)
+		{
+			buffers->Frame[i] = (float)((buffers->Sum[i]-buffers->Min[i]-buffers->Max[i])/
+						    ((double)(exposure_count-2)));
+		}
+		else
+			buffers->Frame[i] = (float)(buffers->Sum[i]/((double)exposure_count));
+		master_mean += buffers->Frame[i];
+	}
+	master_mean /= (double)pixel_count;
+	if(type == CALIBRATE_TYPE_FLAT)
+	{
+		if(master_mean <= 0.0)
+		{
+			Autoguider_General_Error_Number = 2116;
+			sprintf(Autoguider_General_Error_String,"Calibrate_Combine:Master flat has a mean of %.4f.",
+				master_mean);
+			return FALSE;
+		}
+		scale = (float)(1.0/master_mean);
+		for(i = 0; i < pixel_count; i++)
+			buffers->Frame[i] *= scale;
+		(*mean) = frame_mean_total/((double)exposure_count);
+	}
+	else
+		(*mean) = master_mean;
+	return TRUE;
+}
+
+/**
+ * Allocate the buffers used to build a master frame.
+ * @param buffers The address of the buffer structure, whose pointers should be NULL.
+ * @param pixel_count The number of (binned) pixels in a frame.
+ * @return The routine returns TRUE on success and FALSE on failure. On failure any buffers allocated are freed.
+ * @see #Calibrate_Buffer_Free
+ */
+static int Calibrate_Buffer_Allocate(struct Calibrate_Buffer_Struct *buffers,int pixel_count)
+{
+	buffers->Raw = (unsigned short *)malloc(pixel_count*sizeof(unsigned short));
+	buffers->Frame = (float *)malloc(pixel_count*sizeof(float));
+	buffers->Sum = (double *)malloc(pixel_count*sizeof(double));
+	buffers->Min = (float *)malloc(pixel_count*sizeof(float));
+	buffers->Max = (float *)malloc(pixel_count*sizeof(float));
+	if((buffers->Raw == NULL)||(buffers->Frame == NULL)||(buffers->Sum == NULL)||(buffers->Min == NULL)||
+	   (buffers->Max == NULL))
+	{
+		Calibrate_Buffer_Free(buffers);
+		Autoguider_General_Error_Number = 2117;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Buffer_Allocate:"
+			"Failed to allocate buffers for %d pixels.",pixel_count);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Free the buffers used to build a master frame.
+ * @param buffers The address of the buffer structure. The pointers are reset to NULL.
+ */
+static void Calibrate_Buffer_Free(struct Calibrate_Buffer_Struct *buffers)
+{
+	if(buffers->Raw != NULL)
+		free(buffers->Raw);
+	if(buffers->Frame != NULL)
+		free(buffers->Frame);
+	if(buffers->Sum != NULL)
+		free(buffers->Sum);
+	if(buffers->Min != NULL)
+		free(buffers->Min);
+	if(buffers->Max != NULL)
+		free(buffers->Max);
+	buffers->Raw = NULL;
+	buffers->Frame = NULL;
+	buffers->Sum = NULL;
+	buffers->Min = NULL;
+	buffers->Max = NULL;
+}
+
+/**
+ * Write the master frame to a FITS image. The image is written to "&lt;filename&gt;.tmp" and then renamed
+ * to filename, so the master replaces any existing file in one step. The existing file is kept as
+ * "&lt;filename&gt;.old".
+ * @param type The calibration type, CALIBRATE_TYPE_DARK or CALIBRATE_TYPE_FLAT.
+ * @param filename The FITS filename.
+ * @param data The master frame.
+ * @param ncols The number of binned columns.
+ * @param nrows The number of binned rows.
+ * @param bin The binning, in X and Y.
+ * @param exposure_length The exposure length of each frame, in milliseconds.
+ * @param exposure_count The number of frames combined.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Initialise
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Add_String
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Add_Int
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Add_Float
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Write_To_Fits
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Free
+ */
+static int Calibrate_Write(int type,char *filename,float *data,int ncols,int nrows,int bin,int exposure_length,
+			   int exposure_count)
+{
+	struct Fits_Header_Struct fits_header;
+	fitsfile *fits_fp = NULL;
+	char temporary_filename[AUTOGUIDER_CALIBRATE_FILENAME_LENGTH];
+	char old_filename[AUTOGUIDER_CALIBRATE_FILENAME_LENGTH];
+	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
+	long axes[2];
+	int cfitsio_status = 0;
+
+	sprintf(temporary_filename,"%s.tmp",filename);
+	sprintf(old_filename,"%s.old",filename);
+	if(!Autoguider_Fits_Header_Initialise(&fits_header))
+		return FALSE;
+	if((!Autoguider_Fits_Header_Add_String(&fits_header,"OBSTYPE",
+					       (type == CALIBRATE_TYPE_DARK) ? "DARK" : "FLAT",NULL))||
+	   (!Autoguider_Fits_Header_Add_Float(&fits_header,"EXPTIME",((double)exposure_length)/1000.0,NULL))||
+	   (!Autoguider_Fits_Header_Add_Int(&fits_header,"CCDXBIN",bin,NULL))||
+	   (!Autoguider_Fits_Header_Add_Int(&fits_header,"CCDYBIN",bin,NULL))||
+	   (!Autoguider_Fits_Header_Add_Int(&fits_header,"NCOMBINE",exposure_count,"Number of frames combined")))
+	{
+		Autoguider_Fits_Header_Free(&fits_header);
+		return FALSE;
+	}
+	/* CFITSIO refuses to overwrite an existing file unless the filename is prefixed with '!' */
+	unlink(temporary_filename);
+	fits_create_file(&fits_fp,temporary_filename,&cfitsio_status);
+	axes[0] = ncols;
+	axes[1] = nrows;
+	fits_create_img(fits_fp,FLOAT_IMG,2,axes,&cfitsio_status);
+	fits_write_img(fits_fp,TFLOAT,1,ncols*nrows,data,&cfitsio_status);
+	if((cfitsio_status == 0)&&(!Autoguider_Fits_Header_Write_To_Fits(fits_header,fits_fp)))
+	{
+		Autoguider_Fits_Header_Free(&fits_header);
+		cfitsio_status = 0;
+		fits_close_file(fits_fp,&cfitsio_status);
+		unlink(temporary_filename);
+		return FALSE;
+	}
+	Autoguider_Fits_Header_Free(&fits_header);
+	if(cfitsio_status)
+	{
+		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+		if(fits_fp != NULL)
+		{
+			cfitsio_status = 0;
+			fits_close_file(fits_fp,&cfitsio_status);
+		}
+		unlink(temporary_filename);
+		Autoguider_General_Error_Number = 2118;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Write:Failed to write '%s' : %s.",
+			temporary_filename,cfitsio_error_buff);
+		return FALSE;
+	}
+	fits_close_file(fits_fp,&cfitsio_status);
+	if(cfitsio_status)
+	{
+		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+		unlink(temporary_filename);
+		Autoguider_General_Error_Number = 2119;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Write:Failed to close '%s' : %s.",
+			temporary_filename,cfitsio_error_buff);
+		return FALSE;
+	}
+	/* keep the existing master, then replace it */
+	if(access(filename,F_OK) == 0)
+	{
+		unlink(old_filename);
+		if(link(filename,old_filename) != 0)
+		{
+			Autoguider_General_Error_Number = 2120;
+			sprintf(Autoguider_General_Error_String,"Calibrate_Write:Failed to link '%s' to '%s' (%d).",
+				filename,old_filename,errno);
+			Autoguider_General_Error("calibrate","autoguider_calibrate.c","Calibrate_Write",
+						 LOG_VERBOSITY_TERSE,"CALIBRATE"); /* no need to fail */
+		}
+	}
+	if(rename(temporary_filename,filename) != 0)
+	{
+		Autoguider_General_Error_Number = 2121;
+		sprintf(Autoguider_General_Error_String,"Calibrate_Write:Failed to rename '%s' to '%s' (%d).",
+			temporary_filename,filename,errno);
+		unlink(temporary_filename);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Tell the dark or flat module the configured master has been replaced, so the next dark subtraction
+ * or flat field uses the new master. If the binning is the field binning, the new master is loaded now,
+ * rather than by the next field or guide exposure. Any errors are logged.
+ * @param type The calibration type, CALIBRATE_TYPE_DARK or CALIBRATE_TYPE_FLAT.
+ * @param bin The binning, in X and Y.
+ * @param exposure_length The exposure length of each frame, in milliseconds.
+ * @see autoguider_dark.html#Autoguider_Dark_Invalidate
+ * @see autoguider_dark.html#Autoguider_Dark_Set
+ * @see autoguider_flat.html#Autoguider_Flat_Invalidate
+ * @see autoguider_flat.html#Autoguider_Flat_Set
+ * @see autoguider_field.html#Autoguider_Field_Get_Bin_X
+ * @see autoguider_field.html#Autoguider_Field_Get_Bin_Y
+ */
+static void Calibrate_Swap(int type,int bin,int exposure_length)
+{
+	int retval,is_field_binning;
+
+	is_field_binning = ((bin == Autoguider_Field_Get_Bin_X())&&(bin == Autoguider_Field_Get_Bin_Y()));
+	if(type == CALIBRATE_TYPE_DARK)
+	{
+		retval = Autoguider_Dark_Invalidate();
+		if(retval && is_field_binning)
+			retval = Autoguider_Dark_Set(bin,bin,exposure_length);
+	}
+	else
+	{
+		retval = Autoguider_Flat_Invalidate();
+		if(retval && is_field_binning)
+			retval = Autoguider_Flat_Set(bin,bin);
+	}
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("calibrate","autoguider_calibrate.c","Calibrate_Swap",
+					 LOG_VERBOSITY_TERSE,"CALIBRATE"); /* no need to fail */
+	}
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
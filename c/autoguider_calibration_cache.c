@@ -0,0 +1,523 @@
+/* autoguider_calibration_cache.c
+** Autoguider calibration cache routines
+** $Header$
+*/
+/**
+ * Calibration cache routines for the autoguider program.
+ * Loading a dark or flat through cfitsio parses the FITS image and converts it into a freshly allocated float
+ * array. Instead, the first time a dark or flat is loaded, the reduced float data is written to a binary cache
+ * file in the calibration cache directory. This is an Autoguider_Calibration_Cache_Header_Struct padded to the
+ * page size, followed by the float pixel data. Later loads just mmap the cache file read only, so loading is
+ * near-instant, no extra anonymous memory is used, and the kernel shares the pages.
+ * The cache file records the size, modification time, inode and a checksum of the primary header of the source
+ * FITS image. If any of these change, the cache file is ignored and re-made.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+
+#include "autoguider_calibration_cache.h"
+#include "autoguider_general.h"
+
+/* hash defines */
+/**
+ * The length of a calibration cache filename.
+ */
+#define CALIBRATION_CACHE_FILENAME_LENGTH (256)
+/**
+ * The length of a FITS block in bytes. The first block of the source FITS image is checksummed.
+ */
+#define CALIBRATION_CACHE_FITS_BLOCK_LENGTH (2880)
+
+/* data types */
+/**
+ * Data type holding local data to autoguider_calibration_cache. This consists of the following:
+ * <dl>
+ * <dt>Enable</dt> <dd>Boolean, whether the calibration cache is enabled (calibration.cache.enable).</dd>
+ * <dt>Directory</dt> <dd>The directory the cache files are kept in (calibration.cache.directory).</dd>
+ * </dl>
+ */
+struct Calibration_Cache_Struct
+{
+	int Enable;
+	char *Directory;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of calibration cache data.
+ * @see #Calibration_Cache_Struct
+ */
+static struct Calibration_Cache_Struct Calibration_Cache_Data =
+{
+	FALSE,NULL
+};
+
+/* internal functions */
+static int Calibration_Cache_Filename_Get(int type,int bin_x,int bin_y,int exposure_length,char *cache_filename);
+static int Calibration_Cache_Header_Create(char *source_filename,int type,int ncols,int nrows,int bin_x,int bin_y,
+			   int exposure_length,struct Autoguider_Calibration_Cache_Header_Struct *header);
+static unsigned int Calibration_Cache_Adler32(unsigned char *buffer,int length);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Calibration cache initialisation routine. Loads the following config:
+ * <ul>
+ * <li>"calibration.cache.enable" - boolean.
+ * <li>"calibration.cache.directory" - string, only if the cache is enabled.
+ * </ul>
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibration_Cache_Data
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Boolean
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
+ */
+int Autoguider_Calibration_Cache_Initialise(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("calibration_cache","autoguider_calibration_cache.c",
+			       "Autoguider_Calibration_Cache_Initialise",LOG_VERBOSITY_TERSE,"CALCACHE","started.");
+#endif
+	retval = CCD_Config_Get_Boolean("calibration.cache.enable",&(Calibration_Cache_Data.Enable));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1700;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Initialise:"
+			"Failed to load config:'calibration.cache.enable'.");
+		return FALSE;
+	}
+	if(Calibration_Cache_Data.Enable)
+	{
+		retval = CCD_Config_Get_String("calibration.cache.directory",&(Calibration_Cache_Data.Directory));
+		if(retval == FALSE)
+		{
+			Autoguider_General_Error_Number = 1701;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Initialise:"
+				"Failed to load config:'calibration.cache.directory'.");
+			return FALSE;
+		}
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("calibration_cache","autoguider_calibration_cache.c",
+				      "Autoguider_Calibration_Cache_Initialise",LOG_VERBOSITY_TERSE,"CALCACHE",
+				      "finished:enable = %d, directory = %s.",Calibration_Cache_Data.Enable,
+				      (Calibration_Cache_Data.Directory != NULL) ? Calibration_Cache_Data.Directory : "");
+#endif
+	return TRUE;
+}
+
+/**
+ * Return whether the calibration cache is enabled.
+ * @return TRUE if the calibration cache is enabled, FALSE if it is not.
+ * @see #Calibration_Cache_Data
+ */
+int Autoguider_Calibration_Cache_Is_Enabled(void)
+{
+	return Calibration_Cache_Data.Enable;
+}
+
+/**
+ * Try to map the calibration cache file for a dark or flat.
+ * The cache file header must match the header Calibration_Cache_Header_Create makes from the source FITS image
+ * and the expected dimensions, and the cache file must be the right length. If there is no cache file, or it
+ * does not match, found is FALSE and TRUE is returned: the caller should load the source FITS image and call
+ * Autoguider_Calibration_Cache_Create.
+ * @param source_filename The filename of the source FITS image.
+ * @param type The type of calibration frame, AUTOGUIDER_CALIBRATION_CACHE_TYPE_DARK or
+ *        AUTOGUIDER_CALIBRATION_CACHE_TYPE_FLAT.
+ * @param ncols The expected number of binned columns.
+ * @param nrows The expected number of binned rows.
+ * @param bin_x The X binning.
+ * @param bin_y The Y binning.
+ * @param exposure_length Darks: the exposure length in milliseconds. Flats: zero.
+ * @param map The address of a structure, on return with found TRUE, filled in with the mapping. The caller
+ *        should call Autoguider_Calibration_Cache_Unmap when it has finished with the data.
+ *        The mapping is read only.
+ * @param found The address of an integer, on a successful return set to TRUE if the cache file was mapped.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibration_Cache_Filename_Get
+ * @see #Calibration_Cache_Header_Create
+ * @see #Autoguider_Calibration_Cache_Create
+ * @see #Autoguider_Calibration_Cache_Unmap
+ */
+int Autoguider_Calibration_Cache_Map(char *source_filename,int type,int ncols,int nrows,int bin_x,int bin_y,
+				     int exposure_length,struct Autoguider_Calibration_Cache_Map_Struct *map,
+				     int *found)
+{
+	struct Autoguider_Calibration_Cache_Header_Struct expected_header,cache_header;
+	struct stat cache_stat;
+	char cache_filename[CALIBRATION_CACHE_FILENAME_LENGTH];
+	void *map_address = NULL;
+	size_t map_length;
+	int fd;
+
+	if(source_filename == NULL)
+	{
+		Autoguider_General_Error_Number = 1702;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Map:source_filename was NULL.");
+		return FALSE;
+	}
+	if((map == NULL)||(found == NULL))
+	{
+		Autoguider_General_Error_Number = 1703;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Map:map/found was NULL.");
+		return FALSE;
+	}
+	(*found) = FALSE;
+	map->Map_Address = NULL;
+	map->Map_Length = 0;
+	map->Data = NULL;
+	if(!Calibration_Cache_Filename_Get(type,bin_x,bin_y,exposure_length,cache_filename))
+		return FALSE;
+	if(!Calibration_Cache_Header_Create(source_filename,type,ncols,nrows,bin_x,bin_y,exposure_length,
+					    &expected_header))
+		return FALSE;
+	fd = open(cache_filename,O_RDONLY);
+	if(fd < 0)
+	{
+#if AUTOGUIDER_DEBUG > 5
+		Autoguider_General_Log_Format("calibration_cache","autoguider_calibration_cache.c",
+					      "Autoguider_Calibration_Cache_Map",LOG_VERBOSITY_VERBOSE,"CALCACHE",
+					      "No cache file %s for %s.",cache_filename,source_filename);
+#endif
+		return TRUE;
+	}
+	map_length = expected_header.Header_Length+(((size_t)ncols)*((size_t)nrows)*sizeof(float));
+	if((read(fd,&cache_header,sizeof(struct Autoguider_Calibration_Cache_Header_Struct)) !=
+	    sizeof(struct Autoguider_Calibration_Cache_Header_Struct))||
+	   (memcmp(&cache_header,&expected_header,sizeof(struct Autoguider_Calibration_Cache_Header_Struct)) != 0)||
+	   (fstat(fd,&cache_stat) != 0)||(((size_t)cache_stat.st_size) != map_length))
+	{
+		close(fd);
+#if AUTOGUIDER_DEBUG > 3
+		Autoguider_General_Log_Format("calibration_cache","autoguider_calibration_cache.c",
+					      "Autoguider_Calibration_Cache_Map",LOG_VERBOSITY_INTERMEDIATE,"CALCACHE",
+					      "Cache file %s is out of date for %s.",cache_filename,source_filename);
+#endif
+		return TRUE;
+	}
+	map_address = mmap(NULL,map_length,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if(map_address == MAP_FAILED)
+	{
+		Autoguider_General_Error_Number = 1704;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Map:"
+			"mmap of %s failed (%d).",cache_filename,errno);
+		return FALSE;
+	}
+	map->Map_Address = map_address;
+	map->Map_Length = map_length;
+	map->Data = (float *)(((char *)map_address)+expected_header.Header_Length);
+	(*found) = TRUE;
+#if AUTOGUIDER_DEBUG > 3
+	Autoguider_General_Log_Format("calibration_cache","autoguider_calibration_cache.c",
+				      "Autoguider_Calibration_Cache_Map",LOG_VERBOSITY_INTERMEDIATE,"CALCACHE",
+				      "Mapped cache file %s for %s.",cache_filename,source_filename);
+#endif
+	return TRUE;
+}
+
+/**
+ * Write a calibration cache file for a dark or flat, from the reduced data loaded from the source FITS image.
+ * The file is written to a temporary file and renamed, so a partially written cache file is never mapped.
+ * @param source_filename The filename of the source FITS image.
+ * @param type The type of calibration frame, AUTOGUIDER_CALIBRATION_CACHE_TYPE_DARK or
+ *        AUTOGUIDER_CALIBRATION_CACHE_TYPE_FLAT.
+ * @param ncols The number of binned columns in data.
+ * @param nrows The number of binned rows in data.
+ * @param bin_x The X binning.
+ * @param bin_y The Y binning.
+ * @param exposure_length Darks: the exposure length in milliseconds. Flats: zero.
+ * @param data The reduced float data, of ncols x nrows pixels.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibration_Cache_Filename_Get
+ * @see #Calibration_Cache_Header_Create
+ */
+int Autoguider_Calibration_Cache_Create(char *source_filename,int type,int ncols,int nrows,
+					int bin_x,int bin_y,int exposure_length,float *data)
+{
+	struct Autoguider_Calibration_Cache_Header_Struct header;
+	char cache_filename[CALIBRATION_CACHE_FILENAME_LENGTH];
+	char temp_filename[CALIBRATION_CACHE_FILENAME_LENGTH+16];
+	char *header_buffer = NULL;
+	size_t data_length;
+	int fd;
+
+	if((source_filename == NULL)||(data == NULL))
+	{
+		Autoguider_General_Error_Number = 1705;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Create:"
+			"source_filename/data was NULL.");
+		return FALSE;
+	}
+	if(!Calibration_Cache_Filename_Get(type,bin_x,bin_y,exposure_length,cache_filename))
+		return FALSE;
+	if(!Calibration_Cache_Header_Create(source_filename,type,ncols,nrows,bin_x,bin_y,exposure_length,&header))
+		return FALSE;
+	/* the header is padded to Header_Length with zeros */
+	header_buffer = (char *)calloc(header.Header_Length,sizeof(char));
+	if(header_buffer == NULL)
+	{
+		Autoguider_General_Error_Number = 1706;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Create:"
+			"Failed to allocate header buffer of length %d.",header.Header_Length);
+		return FALSE;
+	}
+	memcpy(header_buffer,&header,sizeof(struct Autoguider_Calibration_Cache_Header_Struct));
+	sprintf(temp_filename,"%s.%d",cache_filename,(int)getpid());
+	fd = open(temp_filename,O_WRONLY|O_CREAT|O_TRUNC,S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+	if(fd < 0)
+	{
+		free(header_buffer);
+		Autoguider_General_Error_Number = 1707;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Create:"
+			"Failed to open %s (%d).",temp_filename,errno);
+		return FALSE;
+	}
+	data_length = ((size_t)ncols)*((size_t)nrows)*sizeof(float);
+	if((write(fd,header_buffer,header.Header_Length) != header.Header_Length)||
+	   (write(fd,data,data_length) != (ssize_t)data_length))
+	{
+		close(fd);
+		unlink(temp_filename);
+		free(header_buffer);
+		Autoguider_General_Error_Number = 1708;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Create:"
+			"Failed to write %s (%d).",temp_filename,errno);
+		return FALSE;
+	}
+	free(header_buffer);
+	if(close(fd) != 0)
+	{
+		unlink(temp_filename);
+		Autoguider_General_Error_Number = 1709;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Create:"
+			"Failed to close %s (%d).",temp_filename,errno);
+		return FALSE;
+	}
+	if(rename(temp_filename,cache_filename) != 0)
+	{
+		unlink(temp_filename);
+		Autoguider_General_Error_Number = 1710;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Create:"
+			"Failed to rename %s to %s (%d).",temp_filename,cache_filename,errno);
+		return FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 3
+	Autoguider_General_Log_Format("calibration_cache","autoguider_calibration_cache.c",
+				      "Autoguider_Calibration_Cache_Create",LOG_VERBOSITY_INTERMEDIATE,"CALCACHE",
+				      "Created cache file %s for %s.",cache_filename,source_filename);
+#endif
+	return TRUE;
+}
+
+/**
+ * Unmap a mapped calibration cache file. If nothing is mapped, nothing is done.
+ * @param map The address of a structure filled in by Autoguider_Calibration_Cache_Map. On return it is reset.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Autoguider_Calibration_Cache_Map
+ */
+int Autoguider_Calibration_Cache_Unmap(struct Autoguider_Calibration_Cache_Map_Struct *map)
+{
+	if(map == NULL)
+	{
+		Autoguider_General_Error_Number = 1711;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Unmap:map was NULL.");
+		return FALSE;
+	}
+	if(map->Map_Address != NULL)
+	{
+		if(munmap(map->Map_Address,map->Map_Length) != 0)
+		{
+			Autoguider_General_Error_Number = 1712;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Calibration_Cache_Unmap:"
+				"munmap failed (%d).",errno);
+			return FALSE;
+		}
+	}
+	map->Map_Address = NULL;
+	map->Map_Length = 0;
+	map->Data = NULL;
+	return TRUE;
+}
+
+/**
+ * Calibration cache shutdown routine. Frees the directory string.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibration_Cache_Data
+ */
+int Autoguider_Calibration_Cache_Shutdown(void)
+{
+	if(Calibration_Cache_Data.Directory != NULL)
+		free(Calibration_Cache_Data.Directory);
+	Calibration_Cache_Data.Directory = NULL;
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Get the calibration cache filename for a dark or flat. This is of the form:
+ * &lt;directory&gt;/&lt;dark|flat&gt;_&lt;bin_x&gt;_&lt;bin_y&gt;_&lt;exposure_length&gt;.cal
+ * @param type The type of calibration frame.
+ * @param bin_x The X binning.
+ * @param bin_y The Y binning.
+ * @param exposure_length The exposure length in milliseconds (zero for flats).
+ * @param cache_filename A string of at least CALIBRATION_CACHE_FILENAME_LENGTH characters to put the
+ *        filename into.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibration_Cache_Data
+ * @see #CALIBRATION_CACHE_FILENAME_LENGTH
+ */
+static int Calibration_Cache_Filename_Get(int type,int bin_x,int bin_y,int exposure_length,char *cache_filename)
+{
+	if(Calibration_Cache_Data.Directory == NULL)
+	{
+		Autoguider_General_Error_Number = 1713;
+		sprintf(Autoguider_General_Error_String,"Calibration_Cache_Filename_Get:"
+			"Calibration cache directory not configured.");
+		return FALSE;
+	}
+	/* leave room for the name, binning and exposure length */
+	if((strlen(Calibration_Cache_Data.Directory)+48) >= CALIBRATION_CACHE_FILENAME_LENGTH)
+	{
+		Autoguider_General_Error_Number = 1714;
+		sprintf(Autoguider_General_Error_String,"Calibration_Cache_Filename_Get:"
+			"Calibration cache directory too long (%lu).",strlen(Calibration_Cache_Data.Directory));
+		return FALSE;
+	}
+	sprintf(cache_filename,"%s/%s_%d_%d_%d.cal",Calibration_Cache_Data.Directory,
+		(type == AUTOGUIDER_CALIBRATION_CACHE_TYPE_FLAT) ? "flat" : "dark",bin_x,bin_y,exposure_length);
+	return TRUE;
+}
+
+/**
+ * Fill in a calibration cache header for the source FITS image. The source image is stat'ed, and
+ * its first FITS block checksummed.
+ * @param source_filename The filename of the source FITS image.
+ * @param type The type of calibration frame.
+ * @param ncols The number of binned columns.
+ * @param nrows The number of binned rows.
+ * @param bin_x The X binning.
+ * @param bin_y The Y binning.
+ * @param exposure_length The exposure length in milliseconds (zero for flats).
+ * @param header The address of a header structure to fill in. Unused bytes are zeroed, so headers can be
+ *        compared with memcmp.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibration_Cache_Adler32
+ * @see #CALIBRATION_CACHE_FITS_BLOCK_LENGTH
+ */
+static int Calibration_Cache_Header_Create(char *source_filename,int type,int ncols,int nrows,int bin_x,int bin_y,
+			   int exposure_length,struct Autoguider_Calibration_Cache_Header_Struct *header)
+{
+	unsigned char block[CALIBRATION_CACHE_FITS_BLOCK_LENGTH];
+	struct stat source_stat;
+	long page_size;
+	int fd,block_length;
+
+	if(strlen(source_filename) >= AUTOGUIDER_CALIBRATION_CACHE_SOURCE_FILENAME_LENGTH)
+	{
+		Autoguider_General_Error_Number = 1715;
+		sprintf(Autoguider_General_Error_String,"Calibration_Cache_Header_Create:"
+			"Source filename too long (%lu).",strlen(source_filename));
+		return FALSE;
+	}
+	page_size = sysconf(_SC_PAGESIZE);
+	if(page_size < (long)sizeof(struct Autoguider_Calibration_Cache_Header_Struct))
+		page_size = 4096;
+	fd = open(source_filename,O_RDONLY);
+	if(fd < 0)
+	{
+		Autoguider_General_Error_Number = 1716;
+		sprintf(Autoguider_General_Error_String,"Calibration_Cache_Header_Create:"
+			"Failed to open %s (%d).",source_filename,errno);
+		return FALSE;
+	}
+	if(fstat(fd,&source_stat) != 0)
+	{
+		close(fd);
+		Autoguider_General_Error_Number = 1717;
+		sprintf(Autoguider_General_Error_String,"Calibration_Cache_Header_Create:"
+			"Failed to stat %s (%d).",source_filename,errno);
+		return FALSE;
+	}
+	block_length = read(fd,block,CALIBRATION_CACHE_FITS_BLOCK_LENGTH);
+	close(fd);
+	if(block_length < 0)
+	{
+		Autoguider_General_Error_Number = 1718;
+		sprintf(Autoguider_General_Error_String,"Calibration_Cache_Header_Create:"
+			"Failed to read %s (%d).",source_filename,errno);
+		return FALSE;
+	}
+	memset(header,0,sizeof(struct Autoguider_Calibration_Cache_Header_Struct));
+	header->Magic = AUTOGUIDER_CALIBRATION_CACHE_MAGIC;
+	header->Version = AUTOGUIDER_CALIBRATION_CACHE_VERSION;
+	header->Header_Length = (int)page_size;
+	header->Type = type;
+	header->NCols = ncols;
+	header->NRows = nrows;
+	header->Bin_X = bin_x;
+	header->Bin_Y = bin_y;
+	header->Exposure_Length = exposure_length;
+	header->Source_Size = (int)source_stat.st_size;
+	header->Source_MTime = (int)source_stat.st_mtime;
+	header->Source_Inode = (int)source_stat.st_ino;
+	header->Source_Checksum = Calibration_Cache_Adler32(block,block_length);
+	strcpy(header->Source_Filename,source_filename);
+	return TRUE;
+}
+
+/**
+ * Compute an Adler-32 checksum of a buffer.
+ * @param buffer The buffer to checksum.
+ * @param length The number of bytes in the buffer.
+ * @return The checksum.
+ */
+static unsigned int Calibration_Cache_Adler32(unsigned char *buffer,int length)
+{
+	unsigned int a,b;
+	int i;
+
+	a = 1;
+	b = 0;
+	for(i=0;i<length;i++)
+	{
+		a = (a+buffer[i])%65521;
+		b = (b+a)%65521;
+	}
+	return (b<<16)|a;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
@@ -15,8 +15,14 @@
  * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
  */
 #define _POSIX_C_SOURCE 199309L
+/**
+ * This hash define is needed before including sched.h to give us the CPU affinity (CPU_SET) prototypes.
+ */
+#define _GNU_SOURCE
 
 #include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -38,6 +44,121 @@
 #include "autoguider_general.h"
 #include "autoguider_guide.h"
 
+/* hash defines */
+/**
+ * The number of guide packet records that can be queued for the guide packet sender thread.
+ */
+#define CIL_GUIDE_PACKET_QUEUE_LENGTH	(8)
+
+/* data types */
+/**
+ * Data type holding the state of the SDB publisher. Rather than serialising and sending a whole SDB packet
+ * every time Autoguider_CIL_SDB_Packet_Send is called, the updated values are marked dirty and the
+ * publisher thread sends them, at most once every Min_Interval_Ms milliseconds. State changes are still
+ * sent immediately.
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex protecting this structure, and the NGATCil AGS SDB datum table 
+ *     (which is not thread safe). It is only held whilst a packet is formatted, never whilst it is sent,
+ *     so setting a datum never waits for a UDP send.</dd>
+ * <dt>Send_Mutex</dt> <dd>Mutex held whilst a packet is formatted and sent, so packets formatted by
+ *     different threads are sent in order. If both are held, Send_Mutex is locked first.</dd>
+ * <dt>Condition</dt> <dd>Condition variable signalled when there are dirty values, or the thread should quit.</dd>
+ * <dt>Min_Interval_Ms</dt> <dd>The minimum time between SDB packets sent by the publisher, in milliseconds.
+ *     If this is zero, no publisher thread is started and packets are sent synchronously.</dd>
+ * <dt>Is_Running</dt> <dd>Boolean, TRUE whilst the publisher thread is running.</dd>
+ * <dt>Quit</dt> <dd>Boolean, set to TRUE to make the publisher thread quit.</dd>
+ * <dt>Dirty</dt> <dd>Boolean, TRUE if SDB values have been updated but not yet sent.</dd>
+ * <dt>State_Changed</dt> <dd>Boolean, TRUE if the AG state has been set since the last send.</dd>
+ * <dt>Last_Send_Time</dt> <dd>A timestamp of when the last SDB packet was sent.</dd>
+ * <dt>Send_Count</dt> <dd>The number of SDB packets formatted for sending.</dd>
+ * <dt>Request_Count</dt> <dd>The number of times Autoguider_CIL_SDB_Packet_Send has been called.</dd>
+ * </dl>
+ */
+struct CIL_SDB_Publisher_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_mutex_t Send_Mutex;
+	pthread_cond_t Condition;
+	int Min_Interval_Ms;
+	int Is_Running;
+	int Quit;
+	int Dirty;
+	int State_Changed;
+	struct timespec Last_Send_Time;
+	int Send_Count;
+	int Request_Count;
+};
+
+/**
+ * Data type holding one guide packet to be sent by the guide packet sender thread.
+ * <dl>
+ * <dt>X_Pos</dt> <dd>The X position of the AG centroid, in pixels from the edge of the CCD.</dd>
+ * <dt>Y_Pos</dt> <dd>The Y position of the AG centroid, in pixels from the edge of the CCD.</dd>
+ * <dt>Terminating</dt> <dd>Boolean. If TRUE the autoguider is stopping guiding.</dd>
+ * <dt>Unreliable</dt> <dd>Boolean. If TRUE the centroid is unreliable.</dd>
+ * <dt>Timecode_Secs</dt> <dd>The number of seconds the TCS should wait for until the next guide packet.</dd>
+ * <dt>Status_Char</dt> <dd>The guide packet status character.</dd>
+ * <dt>Packet_Buff</dt> <dd>The formatted guide packet, of length NGATCIL_TCS_GUIDE_PACKET_LENGTH plus a NULL
+ *     terminator.</dd>
+ * <dt>Queue_Time</dt> <dd>A CLOCK_MONOTONIC timestamp of when the record was queued.</dd>
+ * </dl>
+ */
+struct CIL_Guide_Packet_Record_Struct
+{
+	float X_Pos;
+	float Y_Pos;
+	int Terminating;
+	int Unreliable;
+	float Timecode_Secs;
+	char Status_Char;
+	char Packet_Buff[NGATCIL_TCS_GUIDE_PACKET_LENGTH+1];
+	struct timespec Queue_Time;
+};
+
+/**
+ * Data type holding the state of the guide packet sender. The guide thread queues a guide packet record,
+ * and the sender thread formats and sends it, so the guide thread never blocks on the socket. 
+ * The time between a record being queued and the packet leaving the socket is measured with CLOCK_MONOTONIC.
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex protecting this structure.</dd>
+ * <dt>Condition</dt> <dd>Condition variable signalled when a record is queued, or the thread should quit.</dd>
+ * <dt>Thread</dt> <dd>The sender thread, which is joined in Autoguider_CIL_Guide_Packet_Close.</dd>
+ * <dt>Use_Thread</dt> <dd>Boolean, if TRUE guide packets are sent by the sender thread, 
+ *     otherwise they are sent synchronously.</dd>
+ * <dt>CPU</dt> <dd>The CPU to pin the sender thread to, or -1 to leave it unpinned.</dd>
+ * <dt>Is_Running</dt> <dd>Boolean, TRUE whilst the sender thread is running.</dd>
+ * <dt>Quit</dt> <dd>Boolean, set to TRUE to make the sender thread quit (once the queue is empty).</dd>
+ * <dt>Queue</dt> <dd>A ring buffer of guide packet records waiting to be sent.</dd>
+ * <dt>Queue_Head</dt> <dd>The index in Queue of the next record to send.</dd>
+ * <dt>Queue_Count</dt> <dd>The number of records in the Queue.</dd>
+ * <dt>Send_Count</dt> <dd>The number of guide packets sent since the guide packet socket was opened.</dd>
+ * <dt>Fail_Count</dt> <dd>The number of guide packets that failed to send since the socket was opened.</dd>
+ * <dt>Last_Latency</dt> <dd>The send latency of the last guide packet, in seconds.</dd>
+ * <dt>Max_Latency</dt> <dd>The maximum send latency since the socket was opened, in seconds.</dd>
+ * <dt>Total_Latency</dt> <dd>The sum of the send latencies since the socket was opened, in seconds.</dd>
+ * </dl>
+ * @see #CIL_Guide_Packet_Record_Struct
+ * @see #CIL_GUIDE_PACKET_QUEUE_LENGTH
+ */
+struct CIL_Guide_Packet_Sender_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	pthread_t Thread;
+	int Use_Thread;
+	int CPU;
+	int Is_Running;
+	int Quit;
+	struct CIL_Guide_Packet_Record_Struct Queue[CIL_GUIDE_PACKET_QUEUE_LENGTH];
+	int Queue_Head;
+	int Queue_Count;
+	int Send_Count;
+	int Fail_Count;
+	double Last_Latency;
+	double Max_Latency;
+	double Total_Latency;
+};
+
 /* internal data */
 /**
  * Revision Control System identifier.
@@ -88,6 +209,39 @@ static int CIL_SDB_Send = TRUE;
  * Number of continuous hearbeats received.
  */
 static int CIL_CHB_Count = 0;
+/**
+ * SDB publisher data. Statically initialised as follows:
+ * <dl>
+ * <dt>Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Send_Mutex</dt> <dd>PTHREAD_MUTEX_INITIALIZER</dd>
+ * <dt>Condition</dt> <dd>PTHREAD_COND_INITIALIZER</dd>
+ * <dt>Min_Interval_Ms</dt> <dd>0</dd>
+ * <dt>Is_Running</dt> <dd>FALSE</dd>
+ * <dt>Quit</dt> <dd>FALSE</dd>
+ * <dt>Dirty</dt> <dd>FALSE</dd>
+ * <dt>State_Changed</dt> <dd>FALSE</dd>
+ * <dt>Last_Send_Time</dt> <dd>{0L,0L}</dd>
+ * <dt>Send_Count</dt> <dd>0</dd>
+ * <dt>Request_Count</dt> <dd>0</dd>
+ * </dl>
+ * @see #CIL_SDB_Publisher_Struct
+ */
+static struct CIL_SDB_Publisher_Struct SDB_Publisher = 
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER,0,FALSE,FALSE,FALSE,FALSE,
+	{0L,0L},0,0
+};
+
+/**
+ * Guide packet sender data. The mutex and condition variable are statically initialised, 
+ * all other fields are zero (no sender thread, empty queue). Use_Thread and CPU are set from the config file
+ * in Autoguider_CIL_Server_Initialise.
+ * @see #CIL_Guide_Packet_Sender_Struct
+ */
+static struct CIL_Guide_Packet_Sender_Struct Guide_Packet_Sender = 
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER
+};
 
 /* internal functions */
 static int Autoguider_CIL_Server_Connection_Callback(int socket_id,void* message_buff,int message_length);
@@ -109,6 +263,11 @@ static int CIL_UDP_Autoguider_On_Rank_Reply_Send(int rank,int status,int sequenc
 static int CIL_UDP_Autoguider_Off_Reply_Send(int status,int sequence_number);
 static int CIL_Command_Start_Session_Reply_Send(struct NGATCil_Ags_Packet_Struct cil_packet,int status);
 static int CIL_Command_End_Session_Reply_Send(struct NGATCil_Ags_Packet_Struct cil_packet,int status);
+static int CIL_SDB_Value_Set(eAgsDataId_t datum_id,int value);
+static int CIL_SDB_Status_Send(void);
+static void *CIL_SDB_Publisher_Thread(void *arg);
+static void *CIL_Guide_Packet_Sender_Thread(void *arg);
+static void CIL_Guide_Packet_Latency_Update(struct timespec queue_time,struct timespec sent_time,int sent);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -128,6 +287,8 @@ static int CIL_Command_End_Session_Reply_Send(struct NGATCil_Ags_Packet_Struct c
  * @see #MCC_Hostname
  * @see #CIL_SDB_UDP_Port
  * @see #CIL_SDB_Send 
+ * @see #SDB_Publisher
+ * @see #Guide_Packet_Sender
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Log
@@ -210,6 +371,24 @@ int Autoguider_CIL_Server_Initialise(void)
 		      "Failed to find CIL TCS guide packet send (cil.tcs.guide_packet.send) in config file.");
 		return FALSE;
 	}
+	/* get whether to send TCS guide packets from a separate sender thread, and which CPU to pin it to */
+	retval = CCD_Config_Get_Boolean("cil.tcs.guide_packet.sender.thread",&(Guide_Packet_Sender.Use_Thread));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1162;
+		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Server_Initialise:"
+		      "Failed to find CIL TCS guide packet sender thread (cil.tcs.guide_packet.sender.thread) "
+			"in config file.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("cil.tcs.guide_packet.sender.cpu",&(Guide_Packet_Sender.CPU));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1163;
+		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Server_Initialise:"
+		      "Failed to find CIL TCS guide packet sender CPU (cil.tcs.guide_packet.sender.cpu) in config file.");
+		return FALSE;
+	}
  	/* get cil MCC server hostname from config */
 	retval = CCD_Config_Get_String("cil.mcc.hostname",&string_ptr);
 	if(retval == FALSE)
@@ -246,6 +425,22 @@ int Autoguider_CIL_Server_Initialise(void)
 		      "Failed to find CIL SDB packet send (cil.sdb.packet.send) in config file.");
 		return FALSE;
 	}
+	/* get minimum interval between SDB packets sent by the publisher thread */
+	retval = CCD_Config_Get_Integer("cil.sdb.packet.min_interval",&(SDB_Publisher.Min_Interval_Ms));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1158;
+		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Server_Initialise:"
+		      "Failed to find CIL SDB packet minimum interval (cil.sdb.packet.min_interval) in config file.");
+		return FALSE;
+	}
+	if(SDB_Publisher.Min_Interval_Ms < 0)
+	{
+		Autoguider_General_Error_Number = 1159;
+		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Server_Initialise:"
+			"CIL SDB packet minimum interval %d ms is negative.",SDB_Publisher.Min_Interval_Ms);
+		return FALSE;
+	}
 	/* initialise AGS SDB timestamps */
 #if AUTOGUIDER_DEBUG > 1
 	 Autoguider_General_Log("cil","autoguider_cil.c","Autoguider_CIL_Server_Initialise",LOG_VERBOSITY_TERSE,
@@ -281,11 +476,15 @@ int Autoguider_CIL_Server_Initialise(void)
  * This routine starts the server. It returns immediately (the listening is done on a new thread).
  * Use Autoguider_Server_Stop to stop the started server.
  * The server is only started if CIL_UDP_Server_Start is TRUE.
+ * If SDB_Publisher.Min_Interval_Ms is greater than zero, the SDB publisher thread (CIL_SDB_Publisher_Thread)
+ * is also started, which coalesces SDB updates and sends them at most once every Min_Interval_Ms milliseconds.
  * @return The routine returns TRUE if successfull, and FALSE if an error occurs. If an error occurs,
  *        Autoguider_General_Error_Number and Autoguider_General_Error_String are set.
  * @see #CIL_UDP_Port
  * @see #CIL_UDP_Server_Start
  * @see #CIL_UDP_Socket_Fd
+ * @see #SDB_Publisher
+ * @see #CIL_SDB_Publisher_Thread
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see #Autoguider_CIL_Server_Connection_Callback
@@ -296,6 +495,8 @@ int Autoguider_CIL_Server_Initialise(void)
  */
 int Autoguider_CIL_Server_Start(void)
 {
+	pthread_t publisher_thread;
+	pthread_attr_t attr;
 	int retval;
 
 #if AUTOGUIDER_DEBUG > 1
@@ -326,6 +527,29 @@ int Autoguider_CIL_Server_Start(void)
 				       "CIL","NOT starting CIL server.");
 #endif
 	}
+	/* start SDB publisher thread */
+	if(SDB_Publisher.Min_Interval_Ms > 0)
+	{
+#if AUTOGUIDER_DEBUG > 2
+		Autoguider_General_Log_Format("cil","autoguider_cil.c","Autoguider_CIL_Server_Start",
+					      LOG_VERBOSITY_VERBOSE,"CIL",
+					      "Starting SDB publisher with minimum interval %d ms.",
+					      SDB_Publisher.Min_Interval_Ms);
+#endif
+		SDB_Publisher.Quit = FALSE;
+		SDB_Publisher.Is_Running = TRUE;
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+		retval = pthread_create(&publisher_thread,&attr,&CIL_SDB_Publisher_Thread,(void *)NULL);
+		if(retval != 0)
+		{
+			SDB_Publisher.Is_Running = FALSE;
+			Autoguider_General_Error_Number = 1160;
+			sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Server_Start:"
+				"Failed to create SDB publisher thread (%d).",retval);
+			return FALSE;
+		}
+	}
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("cil","autoguider_cil.c","Autoguider_CIL_Server_Start",LOG_VERBOSITY_TERSE,
 			       "CIL","finished.");
@@ -335,10 +559,14 @@ int Autoguider_CIL_Server_Start(void)
 
 /**
  * Autoguider server stop routine. The server is NOT stopped if it was not started, see CIL_UDP_Server_Start.
+ * If the SDB publisher thread is running, the thread is told to quit and any outstanding SDB values are sent,
+ * before the socket is closed.
  * @return The routine returns TRUE if successfull, and FALSE if an error occurs. If an error occurs,
  *        Autoguider_General_Error_Number and Autoguider_General_Error_String are set.
  * @see #CIL_UDP_Socket_Fd
  * @see #CIL_UDP_Server_Start
+ * @see #SDB_Publisher
+ * @see #CIL_SDB_Status_Send
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Log
@@ -347,11 +575,31 @@ int Autoguider_CIL_Server_Start(void)
  */
 int Autoguider_CIL_Server_Stop(void)
 {
-	int retval;
+	int retval,flush;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("cil","autoguider_cil.c","Autoguider_CIL_Server_Stop",LOG_VERBOSITY_TERSE,
 			       "CIL","started.");
 #endif
+	/* stop the SDB publisher thread, flushing any outstanding values */
+	flush = FALSE;
+	if(!Autoguider_General_Mutex_Lock(&(SDB_Publisher.Mutex)))
+		return FALSE;
+	if(SDB_Publisher.Is_Running)
+	{
+		flush = (SDB_Publisher.Dirty && CIL_SDB_Send);
+		SDB_Publisher.Quit = TRUE;
+		pthread_cond_signal(&(SDB_Publisher.Condition));
+	}
+	if(!Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Mutex)))
+		return FALSE;
+	if(flush)
+	{
+		if(!CIL_SDB_Status_Send())
+		{
+			Autoguider_General_Error("cil","autoguider_cil.c","Autoguider_CIL_Server_Stop",
+						 LOG_VERBOSITY_TERSE,"CIL"); /* no need to fail */
+		}
+	}
 	if(CIL_UDP_Server_Start)
 	{
 		retval = NGATCil_UDP_Close(CIL_UDP_Socket_Fd);
@@ -380,11 +628,15 @@ int Autoguider_CIL_Server_Stop(void)
 /**
  * Routine to open a socket file descriptor to send TCS RAW/ASCII (Not CIL!) UDP guide packets over.
  * Assumes Autoguider_CIL_Server_Initialise has been called to setup TCC_Hostname/CIL_TCS_UDP_Guide_Port.
+ * The guide packet send statistics are reset, and if Guide_Packet_Sender.Use_Thread is TRUE the 
+ * guide packet sender thread is started.
  * @return The routine returns TRUE if successfull, and FALSE if an error occurs. If an error occurs,
  *        Autoguider_General_Error_Number and Autoguider_General_Error_String are set.
  * @see #TCC_Hostname
  * @see #CIL_TCS_UDP_Guide_Port
  * @see #CIL_TCS_Guide_Packet_Socket_Fd
+ * @see #Guide_Packet_Sender
+ * @see #CIL_Guide_Packet_Sender_Thread
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Log
@@ -411,6 +663,33 @@ int Autoguider_CIL_Guide_Packet_Open(void)
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Guide_Packet_Open:NGATCil_UDP_Open failed.");
 		return FALSE;
 	}
+	/* reset sender queue and statistics */
+	if(!Autoguider_General_Mutex_Lock(&(Guide_Packet_Sender.Mutex)))
+		return FALSE;
+	Guide_Packet_Sender.Quit = FALSE;
+	Guide_Packet_Sender.Queue_Head = 0;
+	Guide_Packet_Sender.Queue_Count = 0;
+	Guide_Packet_Sender.Send_Count = 0;
+	Guide_Packet_Sender.Fail_Count = 0;
+	Guide_Packet_Sender.Last_Latency = 0.0;
+	Guide_Packet_Sender.Max_Latency = 0.0;
+	Guide_Packet_Sender.Total_Latency = 0.0;
+	if(!Autoguider_General_Mutex_Unlock(&(Guide_Packet_Sender.Mutex)))
+		return FALSE;
+	/* start sender thread */
+	if(Guide_Packet_Sender.Use_Thread && (Guide_Packet_Sender.Is_Running == FALSE))
+	{
+		retval = pthread_create(&(Guide_Packet_Sender.Thread),NULL,&CIL_Guide_Packet_Sender_Thread,
+					(void *)NULL);
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1164;
+			sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Guide_Packet_Open:"
+				"Failed to create guide packet sender thread (%d).",retval);
+			return FALSE;
+		}
+		Guide_Packet_Sender.Is_Running = TRUE;
+	}
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("cil","autoguider_cil.c","Autoguider_CIL_Guide_Packet_Open",LOG_VERBOSITY_INTERMEDIATE,
 			       "CIL","finished.");
@@ -440,21 +719,33 @@ int Autoguider_CIL_Guide_Packet_Open(void)
  *       <li>Bit 1 set means brightness approaching limit
  *       <li>Bit 2 set means critical error
  *       </ul>
+ * If the guide packet sender thread is running, the packet is formatted (which checks the arguments) and 
+ * queued for the sender thread to send, otherwise the packet is sent synchronously. In either case the latency between
+ * this routine being called and the packet being sent is recorded.
  * @return The routine returns TRUE if successfull, and FALSE if an error occurs. If an error occurs,
  *        Autoguider_General_Error_Number and Autoguider_General_Error_String are set.
+ *        When the sender thread is running, errors sending the packet are reported by the sender thread.
  * @see #CIL_TCS_Guide_Packet_Socket_Fd
  * @see #CIL_TCS_UDP_Guide_Packet_Send
+ * @see #Guide_Packet_Sender
+ * @see #CIL_GUIDE_PACKET_QUEUE_LENGTH
+ * @see #CIL_Guide_Packet_Latency_Update
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Log_Format
  * @see ../ngatcil/cdocs/ngatcil_tcs_guide_packet.html#NGATCil_TCS_Guide_Packet_Send
+ * @see ../ngatcil/cdocs/ngatcil_tcs_guide_packet.html#NGATCil_TCS_Guide_Packet_Format
+ * @see ../ngatcil/cdocs/ngatcil_tcs_guide_packet.html#NGATCIL_TCS_GUIDE_PACKET_LENGTH
  * @see ../ngatcil/cdocs/ngatcil_tcs_guide_packet.html#NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED
  * @see ../ngatcil/cdocs/ngatcil_tcs_guide_packet.html#NGATCIL_TCS_GUIDE_PACKET_STATUS_WINDOW
  */
 int Autoguider_CIL_Guide_Packet_Send(float x_pos,float y_pos,int terminating,int unreliable,float timecode_secs,
 				     char status_char)
 {
+	struct CIL_Guide_Packet_Record_Struct *record = NULL;
+	struct timespec start_time,end_time;
+	char packet_buff[NGATCIL_TCS_GUIDE_PACKET_LENGTH+1];
 	int retval;
 
 #if AUTOGUIDER_DEBUG > 1
@@ -464,12 +755,60 @@ int Autoguider_CIL_Guide_Packet_Send(float x_pos,float y_pos,int terminating,int
 				      "timecode=%.2f,status=%c):started.",x_pos,y_pos,terminating,unreliable,
 				      timecode_secs,status_char);
 #endif
-	if(CIL_TCS_UDP_Guide_Packet_Send)
+	if(CIL_TCS_UDP_Guide_Packet_Send && Guide_Packet_Sender.Is_Running)
+	{
+		/* format the guide packet here, so invalid arguments are reported to the caller
+		** rather than the sender thread */
+		if(!NGATCil_TCS_Guide_Packet_Format(packet_buff,NGATCIL_TCS_GUIDE_PACKET_LENGTH+1,x_pos,y_pos,
+						    terminating,unreliable,timecode_secs,status_char))
+		{
+			Autoguider_General_Error_Number = 1170;
+			sprintf(Autoguider_General_Error_String,
+				"Autoguider_CIL_Guide_Packet_Send:NGATCil_TCS_Guide_Packet_Format failed"
+				"(x=%.2f,y=%.2f,terminating=%d,unreliable=%d,timecode=%.2f,status=%c).",x_pos,y_pos,
+				terminating,unreliable,timecode_secs,status_char);
+			return FALSE;
+		}
+		/* queue the guide packet for the sender thread */
+		if(!Autoguider_General_Mutex_Lock(&(Guide_Packet_Sender.Mutex)))
+			return FALSE;
+		if(Guide_Packet_Sender.Queue_Count >= CIL_GUIDE_PACKET_QUEUE_LENGTH)
+		{
+			Autoguider_General_Mutex_Unlock(&(Guide_Packet_Sender.Mutex));
+			Autoguider_General_Error_Number = 1165;
+			sprintf(Autoguider_General_Error_String,
+				"Autoguider_CIL_Guide_Packet_Send:Guide packet sender queue full (%d).",
+				Guide_Packet_Sender.Queue_Count);
+			return FALSE;
+		}
+		record = &(Guide_Packet_Sender.Queue[(Guide_Packet_Sender.Queue_Head+Guide_Packet_Sender.Queue_Count)%
+						     CIL_GUIDE_PACKET_QUEUE_LENGTH]);
+		record->X_Pos = x_pos;
+		record->Y_Pos = y_pos;
+		record->Terminating = terminating;
+		record->Unreliable = unreliable;
+		record->Timecode_Secs = timecode_secs;
+		record->Status_Char = status_char;
+		memcpy(record->Packet_Buff,packet_buff,NGATCIL_TCS_GUIDE_PACKET_LENGTH+1);
+		clock_gettime(CLOCK_MONOTONIC,&(record->Queue_Time));
+		Guide_Packet_Sender.Queue_Count++;
+		pthread_cond_signal(&(Guide_Packet_Sender.Condition));
+		if(!Autoguider_General_Mutex_Unlock(&(Guide_Packet_Sender.Mutex)))
+			return FALSE;
+	}
+	else if(CIL_TCS_UDP_Guide_Packet_Send)
 	{
 		/* send the guide packet
 		** we are relying on this routine to check the arguments - it does. */
+		clock_gettime(CLOCK_MONOTONIC,&start_time);
 		retval = NGATCil_TCS_Guide_Packet_Send(CIL_TCS_Guide_Packet_Socket_Fd,x_pos,y_pos,terminating,
 						       unreliable,timecode_secs,status_char);
+		clock_gettime(CLOCK_MONOTONIC,&end_time);
+		if(Autoguider_General_Mutex_Lock(&(Guide_Packet_Sender.Mutex)))
+		{
+			CIL_Guide_Packet_Latency_Update(start_time,end_time,retval);
+			Autoguider_General_Mutex_Unlock(&(Guide_Packet_Sender.Mutex));
+		}
 		if(retval == FALSE)
 		{
 			Autoguider_General_Error_Number = 1122;
@@ -497,9 +836,12 @@ int Autoguider_CIL_Guide_Packet_Send(float x_pos,float y_pos,int terminating,int
 /**
  * Routine to close the opened socket file descriptor CIL_TCS_Guide_Packet_Socket_Fd.
  * Assumes Autoguider_CIL_Guide_Packet_Open has been called to setup CIL_TCS_Guide_Packet_Socket_Fd.
+ * If the guide packet sender thread is running, it is told to quit and joined. The sender thread sends 
+ * any queued guide packets (including the terminating one) before quitting.
  * @return The routine returns TRUE if successfull, and FALSE if an error occurs. If an error occurs,
  *        Autoguider_General_Error_Number and Autoguider_General_Error_String are set.
  * @see #CIL_TCS_Guide_Packet_Socket_Fd
+ * @see #Guide_Packet_Sender
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Log
@@ -513,6 +855,33 @@ int Autoguider_CIL_Guide_Packet_Close(void)
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("cil","autoguider_cil.c","Autoguider_CIL_Guide_Packet_Close",
 			       LOG_VERBOSITY_INTERMEDIATE,"CIL","started.");
+#endif
+	if(Guide_Packet_Sender.Is_Running)
+	{
+		if(!Autoguider_General_Mutex_Lock(&(Guide_Packet_Sender.Mutex)))
+			return FALSE;
+		Guide_Packet_Sender.Quit = TRUE;
+		pthread_cond_signal(&(Guide_Packet_Sender.Condition));
+		if(!Autoguider_General_Mutex_Unlock(&(Guide_Packet_Sender.Mutex)))
+			return FALSE;
+		retval = pthread_join(Guide_Packet_Sender.Thread,NULL);
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1166;
+			sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Guide_Packet_Close:"
+				"Failed to join guide packet sender thread (%d).",retval);
+			return FALSE;
+		}
+		Guide_Packet_Sender.Is_Running = FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("cil","autoguider_cil.c","Autoguider_CIL_Guide_Packet_Close",
+				      LOG_VERBOSITY_INTERMEDIATE,"CIL","Sent %d guide packets (%d failed):"
+				      "latency last %.6f s, max %.6f s, mean %.6f s.",
+				      Guide_Packet_Sender.Send_Count,Guide_Packet_Sender.Fail_Count,
+				      Guide_Packet_Sender.Last_Latency,Guide_Packet_Sender.Max_Latency,
+				      (Guide_Packet_Sender.Send_Count > 0) ? 
+				      Guide_Packet_Sender.Total_Latency/Guide_Packet_Sender.Send_Count : 0.0);
 #endif
 	retval = NGATCil_UDP_Close(CIL_TCS_Guide_Packet_Socket_Fd);
 	if(retval == FALSE)
@@ -560,6 +929,45 @@ int Autoguider_CIL_Guide_Packet_Send_Get(void)
 	return CIL_TCS_UDP_Guide_Packet_Send;
 }
 
+/**
+ * Get the guide packet send statistics, since the guide packet socket was last opened.
+ * The latency is the time between Autoguider_CIL_Guide_Packet_Send being called and the packet being sent,
+ * measured using CLOCK_MONOTONIC.
+ * @param send_count The address of an integer to store the number of guide packets sent.
+ * @param fail_count The address of an integer to store the number of guide packets that failed to send.
+ * @param last_latency The address of a double to store the last send latency, in seconds.
+ * @param max_latency The address of a double to store the maximum send latency, in seconds.
+ * @param mean_latency The address of a double to store the mean send latency, in seconds.
+ * @return The routine returns TRUE if successfull, and FALSE if an error occurs. If an error occurs,
+ *        Autoguider_General_Error_Number and Autoguider_General_Error_String are set.
+ * @see #Guide_Packet_Sender
+ */
+int Autoguider_CIL_Guide_Packet_Latency_Get(int *send_count,int *fail_count,double *last_latency,
+					    double *max_latency,double *mean_latency)
+{
+	if((send_count == NULL)||(fail_count == NULL)||(last_latency == NULL)||(max_latency == NULL)||
+	   (mean_latency == NULL))
+	{
+		Autoguider_General_Error_Number = 1167;
+		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_Guide_Packet_Latency_Get:"
+			"NULL argument.");
+		return FALSE;
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Guide_Packet_Sender.Mutex)))
+		return FALSE;
+	(*send_count) = Guide_Packet_Sender.Send_Count;
+	(*fail_count) = Guide_Packet_Sender.Fail_Count;
+	(*last_latency) = Guide_Packet_Sender.Last_Latency;
+	(*max_latency) = Guide_Packet_Sender.Max_Latency;
+	if(Guide_Packet_Sender.Send_Count > 0)
+		(*mean_latency) = Guide_Packet_Sender.Total_Latency/((double)Guide_Packet_Sender.Send_Count);
+	else
+		(*mean_latency) = 0.0;
+	if(!Autoguider_General_Mutex_Unlock(&(Guide_Packet_Sender.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
 /**
  * Set the Autoguider AG state.
  * @param state The state to use, from eAgsState_t (ngatcil_ags_sdb.h).
@@ -577,11 +985,11 @@ int Autoguider_CIL_SDB_Packet_State_Set(eAggState_t state)
 	Autoguider_General_Log_Format("cil","autoguider_cil.c","Autoguider_CIL_SDB_Packet_State_Set",
 				      LOG_VERBOSITY_VERY_VERBOSE,"CIL","State Set(%d):started.",state);
 #endif
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_AGSTATE,state))
+	if(!CIL_SDB_Value_Set(D_AGS_AGSTATE,state))
 	{
 		Autoguider_General_Error_Number = 1140;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_State_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 #if AUTOGUIDER_DEBUG > 1
@@ -608,11 +1016,11 @@ int Autoguider_CIL_SDB_Packet_Exp_Time_Set(int ms)
 	Autoguider_General_Log_Format("cil","autoguider_cil.c","Autoguider_CIL_SDB_Packet_Exp_Time_Set",
 				      LOG_VERBOSITY_VERY_VERBOSE,"CIL","Exposure Time Set(%d ms):started.",ms);
 #endif
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_INTTIME,ms))
+	if(!CIL_SDB_Value_Set(D_AGS_INTTIME,ms))
 	{
 		Autoguider_General_Error_Number = 1145;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Exp_Time_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 #if AUTOGUIDER_DEBUG > 1
@@ -647,35 +1055,35 @@ int Autoguider_CIL_SDB_Packet_Centroid_Set(float cx,float cy,float fwhm,float ma
 				      "Centroid Set(cx=%.2f,cy=%.2f,fwhm=%.2f,mag%.2f):started.",cx,cy,fwhm,mag);
 #endif
 	ivalue = (int)(cx*1000.0f);
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_CENTROIDX,ivalue))
+	if(!CIL_SDB_Value_Set(D_AGS_CENTROIDX,ivalue))
 	{
 		Autoguider_General_Error_Number = 1146;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Centroid_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 	ivalue = (int)(cy*1000.0f);
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_CENTROIDY,ivalue))
+	if(!CIL_SDB_Value_Set(D_AGS_CENTROIDY,ivalue))
 	{
 		Autoguider_General_Error_Number = 1147;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Centroid_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 	ivalue = (int)(fwhm*1000.0f);
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_FWHM,ivalue))
+	if(!CIL_SDB_Value_Set(D_AGS_FWHM,ivalue))
 	{
 		Autoguider_General_Error_Number = 1148;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Centroid_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 	ivalue = (int)(mag*1000.0f);
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_GUIDEMAG,ivalue))
+	if(!CIL_SDB_Value_Set(D_AGS_GUIDEMAG,ivalue))
 	{
 		Autoguider_General_Error_Number = 1150;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Centroid_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 #if AUTOGUIDER_DEBUG > 1
@@ -712,35 +1120,35 @@ int Autoguider_CIL_SDB_Packet_Window_Set(int tlx,int tly,int brx,int bry)
 				      "Window Set(tlx=%d,tly=%d,brx=%d,bry=%d):started.",tlx,tly,brx,bry);
 #endif
 	ivalue = (int)(tlx*1000.0);
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_WINDOW_TLX,ivalue))
+	if(!CIL_SDB_Value_Set(D_AGS_WINDOW_TLX,ivalue))
 	{
 		Autoguider_General_Error_Number = 1104;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Window_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 	ivalue = (int)(tly*1000.0);
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_WINDOW_TLY,ivalue))
+	if(!CIL_SDB_Value_Set(D_AGS_WINDOW_TLY,ivalue))
 	{
 		Autoguider_General_Error_Number = 1105;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Window_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 	ivalue = (int)(brx*1000.0);
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_WINDOW_BRX,ivalue))
+	if(!CIL_SDB_Value_Set(D_AGS_WINDOW_BRX,ivalue))
 	{
 		Autoguider_General_Error_Number = 1114;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Window_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 	ivalue = (int)(bry*1000.0);
-	if(!NGATCil_AGS_SDB_Value_Set(D_AGS_WINDOW_BRY,ivalue))
+	if(!CIL_SDB_Value_Set(D_AGS_WINDOW_BRY,ivalue))
 	{
 		Autoguider_General_Error_Number = 1116;
 		sprintf(Autoguider_General_Error_String,"Autoguider_CIL_SDB_Packet_Window_Set:"
-			"NGATCil_AGS_SDB_Value_Set failed.");
+			"CIL_SDB_Value_Set failed.");
 		return FALSE;
 	}
 #if AUTOGUIDER_DEBUG > 1
@@ -753,20 +1161,27 @@ int Autoguider_CIL_SDB_Packet_Window_Set(int tlx,int tly,int brx,int bry)
 /**
  * Routine to submit status to the SDB using CIL.
  * The packet is only sent if CIL_SDB_Send is TRUE.
+ * If the SDB publisher thread is running, and the AG state has not changed since the last send,
+ * the updated values are just marked dirty and the publisher thread is signalled to send them 
+ * (at most once every SDB_Publisher.Min_Interval_Ms milliseconds). Otherwise (AG state changes, or no publisher
+ * thread) the packet is sent immediately, after the publisher mutex has been released.
  * Assumes the CIL UDP server has previously been opened, to set CIL_UDP_Socket_Fd, 
  * @return The routine returns TRUE if successfull, and FALSE if an error occurs. If an error occurs,
  *        Autoguider_General_Error_Number and Autoguider_General_Error_String are set.
  * @see #CIL_UDP_Socket_Fd
  * @see #CIL_SDB_Send
+ * @see #SDB_Publisher
+ * @see #CIL_SDB_Status_Send
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Log_Format
- * @see ../ngatcil/cdocs/ngatcil_agssdb.html#NGATCil_AGS_SDB_Status_Send
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
  */
 int Autoguider_CIL_SDB_Packet_Send(void)
 {
-	int retval;
+	int send_now;
 
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("cil","autoguider_cil.c","Autoguider_CIL_SDB_Packet_Send",
@@ -774,14 +1189,30 @@ int Autoguider_CIL_SDB_Packet_Send(void)
 #endif
 	if(CIL_SDB_Send)
 	{
-		/* submit the status to the SDB */
-		retval = NGATCil_AGS_SDB_Status_Send(CIL_UDP_Socket_Fd);
-		if(retval == FALSE)
+		if(!Autoguider_General_Mutex_Lock(&(SDB_Publisher.Mutex)))
+			return FALSE;
+		SDB_Publisher.Request_Count++;
+		if(SDB_Publisher.Is_Running && (SDB_Publisher.State_Changed == FALSE))
 		{
-			Autoguider_General_Error_Number = 1151;
-			sprintf(Autoguider_General_Error_String,
-			"Autoguider_CIL_SDB_Packet_Send:NGATCil_AGS_SDB_Status_Send failed.");
+			/* leave it to the publisher thread */
+			SDB_Publisher.Dirty = TRUE;
+			pthread_cond_signal(&(SDB_Publisher.Condition));
+			send_now = FALSE;
+		}
+		else
+			send_now = TRUE;
+		if(!Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Mutex)))
 			return FALSE;
+		if(send_now)
+		{
+			/* submit the status to the SDB */
+			if(!CIL_SDB_Status_Send())
+			{
+				Autoguider_General_Error_Number = 1151;
+				sprintf(Autoguider_General_Error_String,
+					"Autoguider_CIL_SDB_Packet_Send:CIL_SDB_Status_Send failed.");
+				return FALSE;
+			}
 		}
 	}
 	else
@@ -1738,6 +2169,289 @@ static int CIL_Command_End_Session_Reply_Send(struct NGATCil_Ags_Packet_Struct c
 	return TRUE;
 }
 
+/**
+ * Set an AGS SDB datum value, whilst holding the SDB publisher mutex (the NGATCil datum table is 
+ * shared with the publisher thread). If the datum is the AG state, SDB_Publisher.State_Changed is set, 
+ * so that the next Autoguider_CIL_SDB_Packet_Send sends the packet immediately.
+ * @param datum_id The datum to set, of type eAgsDataId_t.
+ * @param value The value as an integer.
+ * @return The routine returns TRUE if successfull, and FALSE if an error occurs. 
+ * @see #SDB_Publisher
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
+ * @see ../ngatcil/cdocs/ngatcil_ags_sdb.html#NGATCil_AGS_SDB_Value_Set
+ */
+static int CIL_SDB_Value_Set(eAgsDataId_t datum_id,int value)
+{
+	int retval;
+
+	if(!Autoguider_General_Mutex_Lock(&(SDB_Publisher.Mutex)))
+		return FALSE;
+	retval = NGATCil_AGS_SDB_Value_Set(datum_id,value);
+	if(retval && (datum_id == D_AGS_AGSTATE))
+		SDB_Publisher.State_Changed = TRUE;
+	if(!Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Mutex)))
+		return FALSE;
+	return retval;
+}
+
+/**
+ * Send the changed AGS SDB datums to the SDB. The caller <b>must not</b> hold SDB_Publisher.Mutex.
+ * SDB_Publisher.Send_Mutex is held throughout, so packets are sent in the order they were formatted.
+ * SDB_Publisher.Mutex is only held whilst the changed datums are formatted into a local packet buffer
+ * (NGATCil_AGS_SDB_Status_Format), when the dirty and state changed flags are cleared, and the last send time
+ * updated. The packet is then sent (NGATCil_AGS_SDB_Status_Buffer_Send) after SDB_Publisher.Mutex has been
+ * released, so datum updates from the guide thread do not wait for the UDP send. 
+ * @return The routine returns TRUE if successfull, and FALSE if an error occurs. 
+ * @see #SDB_Publisher
+ * @see #CIL_UDP_Socket_Fd
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
+ * @see ../ngatcil/cdocs/ngatcil_ags_sdb.html#NGATCil_AGS_SDB_Status_Format
+ * @see ../ngatcil/cdocs/ngatcil_ags_sdb.html#NGATCil_AGS_SDB_Status_Buffer_Send
+ * @see ../ngatcil/cdocs/ngatcil_ags_sdb.html#NGATCIL_AGS_SDB_PACKET_LENGTH_MAX
+ */
+static int CIL_SDB_Status_Send(void)
+{
+	char packet_buff[NGATCIL_AGS_SDB_PACKET_LENGTH_MAX];
+	int packet_length,retval;
+
+	if(!Autoguider_General_Mutex_Lock(&(SDB_Publisher.Send_Mutex)))
+		return FALSE;
+	if(!Autoguider_General_Mutex_Lock(&(SDB_Publisher.Mutex)))
+	{
+		Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Send_Mutex));
+		return FALSE;
+	}
+	retval = NGATCil_AGS_SDB_Status_Format(packet_buff,NGATCIL_AGS_SDB_PACKET_LENGTH_MAX,&packet_length);
+	if(retval)
+	{
+		SDB_Publisher.Dirty = FALSE;
+		SDB_Publisher.State_Changed = FALSE;
+		if(packet_length > 0)
+			SDB_Publisher.Send_Count++;
+		clock_gettime(CLOCK_REALTIME,&(SDB_Publisher.Last_Send_Time));
+	}
+	if(!Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Mutex)))
+	{
+		Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Send_Mutex));
+		return FALSE;
+	}
+	if(retval && (packet_length > 0))
+		retval = NGATCil_AGS_SDB_Status_Buffer_Send(CIL_UDP_Socket_Fd,packet_buff,packet_length);
+	if(!Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Send_Mutex)))
+		return FALSE;
+	return retval;
+}
+
+/**
+ * SDB publisher thread. Waits on SDB_Publisher.Condition until there are dirty SDB values, then
+ * sends them, but no more frequently than once every SDB_Publisher.Min_Interval_Ms milliseconds. Updates
+ * that arrive before the interval has elapsed are coalesced into the next packet. SDB_Publisher.Mutex is 
+ * released around CIL_SDB_Status_Send, so the send does not block datum updates.
+ * The thread quits when SDB_Publisher.Quit is set.
+ * @param arg Not used.
+ * @return Always NULL.
+ * @see #SDB_Publisher
+ * @see #CIL_SDB_Status_Send
+ * @see autoguider_general.html#Autoguider_General_Error
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
+ * @see autoguider_general.html#AUTOGUIDER_GENERAL_ONE_SECOND_NS
+ * @see autoguider_general.html#AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS
+ * @see autoguider_general.html#AUTOGUIDER_GENERAL_ONE_SECOND_MS
+ * @see autoguider_general.html#fdifftime
+ */
+static void *CIL_SDB_Publisher_Thread(void *arg)
+{
+	struct timespec current_time,next_send_time;
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("cil","autoguider_cil.c","CIL_SDB_Publisher_Thread",LOG_VERBOSITY_TERSE,
+			       "CIL","started.");
+#endif
+	if(!Autoguider_General_Mutex_Lock(&(SDB_Publisher.Mutex)))
+	{
+		Autoguider_General_Error("cil","autoguider_cil.c","CIL_SDB_Publisher_Thread",
+					 LOG_VERBOSITY_TERSE,"CIL");
+		SDB_Publisher.Is_Running = FALSE;
+		return NULL;
+	}
+	while(SDB_Publisher.Quit == FALSE)
+	{
+		if(SDB_Publisher.Dirty == FALSE)
+		{
+			pthread_cond_wait(&(SDB_Publisher.Condition),&(SDB_Publisher.Mutex));
+			continue;
+		}
+		/* rate limit */
+		next_send_time.tv_sec = SDB_Publisher.Last_Send_Time.tv_sec+
+			(SDB_Publisher.Min_Interval_Ms/AUTOGUIDER_GENERAL_ONE_SECOND_MS);
+		next_send_time.tv_nsec = SDB_Publisher.Last_Send_Time.tv_nsec+
+			((SDB_Publisher.Min_Interval_Ms%AUTOGUIDER_GENERAL_ONE_SECOND_MS)*
+			 AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS);
+		if(next_send_time.tv_nsec >= AUTOGUIDER_GENERAL_ONE_SECOND_NS)
+		{
+			next_send_time.tv_sec++;
+			next_send_time.tv_nsec -= AUTOGUIDER_GENERAL_ONE_SECOND_NS;
+		}
+		clock_gettime(CLOCK_REALTIME,&current_time);
+		if(fdifftime(next_send_time,current_time) > 0.0)
+		{
+			pthread_cond_timedwait(&(SDB_Publisher.Condition),&(SDB_Publisher.Mutex),&next_send_time);
+			continue;
+		}
+		if(CIL_SDB_Send)
+		{
+			/* don't hold the mutex during the send */
+			Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Mutex));
+			retval = CIL_SDB_Status_Send();
+			if(!Autoguider_General_Mutex_Lock(&(SDB_Publisher.Mutex)))
+			{
+				Autoguider_General_Error("cil","autoguider_cil.c","CIL_SDB_Publisher_Thread",
+							 LOG_VERBOSITY_TERSE,"CIL");
+				SDB_Publisher.Is_Running = FALSE;
+				return NULL;
+			}
+			if(retval == FALSE)
+			{
+				Autoguider_General_Error_Number = 1161;
+				sprintf(Autoguider_General_Error_String,"CIL_SDB_Publisher_Thread:"
+					"CIL_SDB_Status_Send failed.");
+				Autoguider_General_Error("cil","autoguider_cil.c","CIL_SDB_Publisher_Thread",
+							 LOG_VERBOSITY_TERSE,"CIL");
+				/* don't retry these values until the next update */
+				SDB_Publisher.Dirty = FALSE;
+				clock_gettime(CLOCK_REALTIME,&(SDB_Publisher.Last_Send_Time));
+			}
+		}
+		else
+			SDB_Publisher.Dirty = FALSE;
+	}
+	SDB_Publisher.Is_Running = FALSE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("cil","autoguider_cil.c","CIL_SDB_Publisher_Thread",LOG_VERBOSITY_TERSE,
+				      "CIL","finished:Sent %d SDB packets for %d requests.",
+				      SDB_Publisher.Send_Count,SDB_Publisher.Request_Count);
+#endif
+	Autoguider_General_Mutex_Unlock(&(SDB_Publisher.Mutex));
+	return NULL;
+}
+
+/**
+ * Guide packet sender thread. Optionally pins itself to Guide_Packet_Sender.CPU. It then waits for guide
+ * packet records to be queued by Autoguider_CIL_Guide_Packet_Send (which has already formatted the packet)
+ * and sends them on CIL_TCS_Guide_Packet_Socket_Fd. The mutex is not held whilst sending, 
+ * so the guide thread can queue the next packet. The thread quits when 
+ * Guide_Packet_Sender.Quit is set and the queue is empty.
+ * @param arg Not used.
+ * @return Always NULL.
+ * @see #Guide_Packet_Sender
+ * @see #CIL_TCS_Guide_Packet_Socket_Fd
+ * @see #CIL_Guide_Packet_Latency_Update
+ * @see autoguider_general.html#Autoguider_General_Error
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
+ * @see ../ngatcil/cdocs/ngatcil_tcs_guide_packet.html#NGATCIL_TCS_GUIDE_PACKET_LENGTH
+ * @see ../ngatcil/cdocs/ngatcil_udp_raw.html#NGATCil_UDP_Raw_Send
+ */
+static void *CIL_Guide_Packet_Sender_Thread(void *arg)
+{
+	struct CIL_Guide_Packet_Record_Struct record;
+	struct timespec sent_time;
+	cpu_set_t cpu_set;
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("cil","autoguider_cil.c","CIL_Guide_Packet_Sender_Thread",LOG_VERBOSITY_INTERMEDIATE,
+			       "CIL","started.");
+#endif
+	if(Guide_Packet_Sender.CPU >= 0)
+	{
+		CPU_ZERO(&cpu_set);
+		CPU_SET(Guide_Packet_Sender.CPU,&cpu_set);
+		if(sched_setaffinity(0,sizeof(cpu_set),&cpu_set) != 0)
+		{
+			Autoguider_General_Error_Number = 1168;
+			sprintf(Autoguider_General_Error_String,"CIL_Guide_Packet_Sender_Thread:"
+				"Failed to pin sender thread to CPU %d (%d).",Guide_Packet_Sender.CPU,errno);
+			Autoguider_General_Error("cil","autoguider_cil.c","CIL_Guide_Packet_Sender_Thread",
+						 LOG_VERBOSITY_TERSE,"CIL"); /* no need to fail */
+		}
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Guide_Packet_Sender.Mutex)))
+	{
+		Autoguider_General_Error("cil","autoguider_cil.c","CIL_Guide_Packet_Sender_Thread",
+					 LOG_VERBOSITY_TERSE,"CIL");
+		return NULL;
+	}
+	while(TRUE)
+	{
+		while((Guide_Packet_Sender.Queue_Count == 0)&&(Guide_Packet_Sender.Quit == FALSE))
+			pthread_cond_wait(&(Guide_Packet_Sender.Condition),&(Guide_Packet_Sender.Mutex));
+		if(Guide_Packet_Sender.Queue_Count == 0)
+			break;
+		record = Guide_Packet_Sender.Queue[Guide_Packet_Sender.Queue_Head];
+		Guide_Packet_Sender.Queue_Head = (Guide_Packet_Sender.Queue_Head+1)%CIL_GUIDE_PACKET_QUEUE_LENGTH;
+		Guide_Packet_Sender.Queue_Count--;
+		Autoguider_General_Mutex_Unlock(&(Guide_Packet_Sender.Mutex));
+		/* send the packet, formatted by Autoguider_CIL_Guide_Packet_Send */
+		retval = NGATCil_UDP_Raw_Send(CIL_TCS_Guide_Packet_Socket_Fd,record.Packet_Buff,
+					      NGATCIL_TCS_GUIDE_PACKET_LENGTH);
+		clock_gettime(CLOCK_MONOTONIC,&sent_time);
+		if(retval == FALSE)
+		{
+			Autoguider_General_Error_Number = 1169;
+			sprintf(Autoguider_General_Error_String,"CIL_Guide_Packet_Sender_Thread:"
+				"Failed to send guide packet(x=%.2f,y=%.2f,terminating=%d,unreliable=%d,"
+				"timecode=%.2f,status=%c).",record.X_Pos,record.Y_Pos,record.Terminating,
+				record.Unreliable,record.Timecode_Secs,record.Status_Char);
+			Autoguider_General_Error("cil","autoguider_cil.c","CIL_Guide_Packet_Sender_Thread",
+						 LOG_VERBOSITY_TERSE,"CIL");
+		}
+		if(!Autoguider_General_Mutex_Lock(&(Guide_Packet_Sender.Mutex)))
+		{
+			Autoguider_General_Error("cil","autoguider_cil.c","CIL_Guide_Packet_Sender_Thread",
+						 LOG_VERBOSITY_TERSE,"CIL");
+			return NULL;
+		}
+		CIL_Guide_Packet_Latency_Update(record.Queue_Time,sent_time,retval);
+	}
+	Autoguider_General_Mutex_Unlock(&(Guide_Packet_Sender.Mutex));
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("cil","autoguider_cil.c","CIL_Guide_Packet_Sender_Thread",LOG_VERBOSITY_INTERMEDIATE,
+			       "CIL","finished.");
+#endif
+	return NULL;
+}
+
+/**
+ * Update the guide packet send statistics in Guide_Packet_Sender. The caller <b>must</b> hold 
+ * Guide_Packet_Sender.Mutex.
+ * @param queue_time A CLOCK_MONOTONIC timestamp of when the packet was handed to Autoguider_CIL_Guide_Packet_Send.
+ * @param sent_time A CLOCK_MONOTONIC timestamp of when the send completed.
+ * @param sent Boolean, TRUE if the packet was sent successfully.
+ * @see #Guide_Packet_Sender
+ * @see autoguider_general.html#fdifftime
+ */
+static void CIL_Guide_Packet_Latency_Update(struct timespec queue_time,struct timespec sent_time,int sent)
+{
+	double latency;
+
+	if(sent == FALSE)
+	{
+		Guide_Packet_Sender.Fail_Count++;
+		return;
+	}
+	latency = fdifftime(sent_time,queue_time);
+	Guide_Packet_Sender.Send_Count++;
+	Guide_Packet_Sender.Last_Latency = latency;
+	Guide_Packet_Sender.Total_Latency += latency;
+	if(latency > Guide_Packet_Sender.Max_Latency)
+		Guide_Packet_Sender.Max_Latency = latency;
+}
+
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.13  2011/09/08 09:23:39  cjm
@@ -17,6 +17,7 @@
 #define _POSIX_C_SOURCE 199309L
 
 #include <errno.h>
+#include <malloc.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
@@ -32,18 +33,22 @@
 #include "ccd_general.h"
 #include "ccd_setup.h"
 #include "ccd_temperature.h"
+#include "ccd_trace.h"
 
 #include "command_server.h"
 
 #include "ngatcil_general.h"
 
+#include "autoguider_calibrate.h"
 #include "autoguider_cil.h"
 #include "autoguider_general.h"
 #include "autoguider_server.h"
 #include "autoguider_field.h"
 #include "autoguider_get_fits.h"
 #include "autoguider_guide.h"
+#include "autoguider_housekeeping.h"
 #include "autoguider_object.h"
+#include "autoguider_preview.h"
 
 /* internal data */
 /**
@@ -57,16 +62,19 @@ static char rcsid[] = "$Id: autoguider_command.c,v 1.18 2014-01-31 17:17:17 cjm
 /**
  * Handle a command of the form: "abort".
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Get_Config_Filename
+ * @see autoguider_calibrate.html#Autoguider_Calibrate_Is_Calibrating
+ * @see autoguider_calibrate.html#Autoguider_Calibrate_Abort
  * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Abort
  */
-int Autoguider_Command_Abort(char *command_string,char **reply_string)
+int Autoguider_Command_Abort(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	char *config_filename = NULL;
 	int retval;
@@ -76,24 +84,28 @@ int Autoguider_Command_Abort(char *command_string,char **reply_string)
 			       "COMMAND","started.");
 #endif
 	/* are we fielding/guiding etc? */
-	if((Autoguider_Field_Is_Fielding() == FALSE)&&(Autoguider_Guide_Is_Guiding() == FALSE))
+	if((Autoguider_Field_Is_Fielding() == FALSE)&&(Autoguider_Guide_Is_Guiding() == FALSE)&&
+	   (Autoguider_Calibrate_Is_Calibrating() == FALSE))
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Abort failed:No Field or Guide operation underway."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Abort failed:No Field, Guide or Calibrate operation underway."))
 			return FALSE;
 		return TRUE;
 	}
-	retval = CCD_Exposure_Abort();
+	if(Autoguider_Calibrate_Is_Calibrating())
+		retval = Autoguider_Calibrate_Abort();
+	else
+		retval = CCD_Exposure_Abort();
 	if(retval == FALSE)
 	{
 		Autoguider_General_Error_Number = 318;
 		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Abort:CCD_Exposure_Abort failed.");
 		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Abort",
 					 LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Autoguider_General_Add_String(reply_string,"1 Abort failed."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Abort failed."))
 			return FALSE;
 		return TRUE;
 	}
-	if(!Autoguider_General_Add_String(reply_string,"0 Abort suceeded."))
+	if(!Autoguider_General_Reply_Add(reply,"0 Abort suceeded."))
 		return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Abort",LOG_VERBOSITY_TERSE,
@@ -105,16 +117,17 @@ int Autoguider_Command_Abort(char *command_string,char **reply_string)
 /**
  * Handle a command of the form: "agstate <ms>".
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see autoguider_cil.html#Autoguider_CIL_SDB_State_Set
  * @see autoguider_cil.html#Autoguider_CIL_SDB_Packet_Send
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  */
-int Autoguider_Command_Agstate(char *command_string,char **reply_string)
+int Autoguider_Command_Agstate(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	int retval,agstate;
 
@@ -139,7 +152,7 @@ int Autoguider_Command_Agstate(char *command_string,char **reply_string)
 	{
 		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Agstate",
 					 LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Autoguider_General_Add_String(reply_string,"1 Setting AgState failed."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Setting AgState failed."))
 			return FALSE;
 		return TRUE;
 	}
@@ -147,11 +160,11 @@ int Autoguider_Command_Agstate(char *command_string,char **reply_string)
 	{
 		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Agstate",
 					 LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Autoguider_General_Add_String(reply_string,"1 Sending AgState to SDB failed."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Sending AgState to SDB failed."))
 			return FALSE;
 		return TRUE;
 	}
-	if(!Autoguider_General_Add_String(reply_string,"0 Agstate suceeded."))
+	if(!Autoguider_General_Reply_Add(reply,"0 Agstate suceeded."))
 		return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Agstate",
@@ -163,16 +176,17 @@ int Autoguider_Command_Agstate(char *command_string,char **reply_string)
 /**
  * Handle a command of the form: "autoguide <on [<pixel <x> <y>>|brightest|<rank <n>>]|off>".
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Autoguider_Command_Autoguide_On
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Get_Config_Filename
  */
-int Autoguider_Command_Autoguide(char *command_string,char **reply_string)
+int Autoguider_Command_Autoguide(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	char onoff_string[64];
 	char parameter1_string[64];
@@ -269,11 +283,11 @@ int Autoguider_Command_Autoguide(char *command_string,char **reply_string)
 		{
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Autoguide",
 						 LOG_VERBOSITY_TERSE,"COMMAND");
-			if(!Autoguider_General_Add_String(reply_string,"1 autoguide on failed."))
+			if(!Autoguider_General_Reply_Add(reply,"1 autoguide on failed."))
 				return FALSE;
 			return TRUE;
 		}
-		if(!Autoguider_General_Add_String(reply_string,"0 Autoguide on suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Autoguide on suceeded."))
 			return FALSE;
 		return TRUE;
 	}
@@ -285,25 +299,25 @@ int Autoguider_Command_Autoguide(char *command_string,char **reply_string)
 		{
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Autoguide",
 						 LOG_VERBOSITY_TERSE,"COMMAND");
-			if(!Autoguider_General_Add_String(reply_string,"1 autoguide off:Guide off failed."))
+			if(!Autoguider_General_Reply_Add(reply,"1 autoguide off:Guide off failed."))
 				return FALSE;
 			return TRUE;
 		}
-		if(!Autoguider_General_Add_String(reply_string,"0 Autoguide off suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Autoguide off suceeded."))
 			return FALSE;
 		return TRUE;
 	}
 	else 
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Autoguide failed:Illegal onoff parameter:"))
+		if(!Autoguider_General_Reply_Add(reply,"1 Autoguide failed:Illegal onoff parameter:"))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,onoff_string))
+		if(!Autoguider_General_Reply_Add(reply,onoff_string))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 		return TRUE;
 	}
-	if(!Autoguider_General_Add_String(reply_string,"0 Autoguide suceeded."))
+	if(!Autoguider_General_Reply_Add(reply,"0 Autoguide suceeded."))
 		return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Autoguide",
@@ -433,13 +447,102 @@ int Autoguider_Command_Autoguide_On(enum COMMAND_AG_ON_TYPE on_type,float pixel_
 	return TRUE;
 }
 
+/**
+ * Handle a command of the form: "calibrate &lt;dark|flat&gt; &lt;bin&gt; &lt;ms&gt; &lt;count&gt; [&lt;filename&gt;]".
+ * The specified number of frames are taken and combined into a master dark or flat. If no filename
+ * is specified, the master is written to the configured dark/flat filename, and replaces the current one.
+ * A specified filename must be a leafname, the master is written into the configured calibration directory.
+ * The reply is of the form: "0 &lt;filename&gt; &lt;frame count&gt; &lt;mean&gt; &lt;elapsed s&gt; &lt;swapped&gt;".
+ * @param command_string The command. This is not changed during this routine.
+ * @param reply The address of a reply buffer to add the reply string to.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_calibrate.html#Autoguider_Calibrate_Dark
+ * @see autoguider_calibrate.html#Autoguider_Calibrate_Flat
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
+ * @see autoguider_general.html#Autoguider_General_Log
+ * @see autoguider_general.html#Autoguider_General_Error_Number
+ * @see autoguider_general.html#Autoguider_General_Error_String
+ */
+int Autoguider_Command_Calibrate(char *command_string,struct Autoguider_General_Reply_Struct *reply)
+{
+	struct Autoguider_Calibrate_Result_Struct result;
+	char type_string[32];
+	char filename[AUTOGUIDER_CALIBRATE_FILENAME_LENGTH];
+	int retval,bin,exposure_length,exposure_count;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Calibrate",
+			       LOG_VERBOSITY_TERSE,"COMMAND","started.");
+#endif
+	if(command_string == NULL)
+	{
+		Autoguider_General_Error_Number = 340;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Calibrate:command_string was NULL.");
+		return FALSE;
+	}
+	/* parse command */
+	retval = sscanf(command_string,"calibrate %31s %d %d %d %255s",type_string,&bin,&exposure_length,
+			&exposure_count,filename);
+	if((retval != 4)&&(retval != 5))
+	{
+		if(!Autoguider_General_Reply_Add(reply,"1 Failed to parse command string:"))
+			return FALSE;
+		if(!Autoguider_General_Reply_Add(reply,command_string))
+			return FALSE;
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Calibrate",
+				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
+#endif
+		return TRUE;
+	}
+	if(strcmp(type_string,"dark") == 0)
+	{
+		retval = Autoguider_Calibrate_Dark(bin,exposure_length,exposure_count,(retval == 5) ? filename : NULL,
+						   &result);
+	}
+	else if(strcmp(type_string,"flat") == 0)
+	{
+		retval = Autoguider_Calibrate_Flat(bin,exposure_length,exposure_count,(retval == 5) ? filename : NULL,
+						   &result);
+	}
+	else
+	{
+		if(!Autoguider_General_Reply_Add(reply,"1 Unknown calibration type:"))
+			return FALSE;
+		if(!Autoguider_General_Reply_Add(reply,type_string))
+			return FALSE;
+		if(!Autoguider_General_Reply_Add(reply,"."))
+			return FALSE;
+		return TRUE;
+	}
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Calibrate",
+					 LOG_VERBOSITY_TERSE,"COMMAND");
+		if(!Autoguider_General_Reply_Add_Format(reply,"1 Calibrate %s failed.",type_string))
+			return FALSE;
+		return TRUE;
+	}
+	if(!Autoguider_General_Reply_Add_Format(reply,"0 %s %d %.4f %.2f %s",result.Filename,result.Frame_Count,
+						result.Mean,result.Elapsed_Time,
+						result.Is_Swapped ? "swapped" : "not_swapped"))
+		return FALSE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Calibrate",
+			       LOG_VERBOSITY_TERSE,"COMMAND","finished.");
+#endif
+	return TRUE;
+}
+
 /**
  * Handle a command of the form: "configload".
  * Note if this is called when <b>anything</b> else is hapenning, you'll probably crash the control system.
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
@@ -447,7 +550,7 @@ int Autoguider_Command_Autoguide_On(enum COMMAND_AG_ON_TYPE on_type,float pixel_
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Shutdown
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Load
  */
-int Autoguider_Command_Config_Load(char *command_string,char **reply_string)
+int Autoguider_Command_Config_Load(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	char *config_filename = NULL;
 	int retval;
@@ -460,13 +563,13 @@ int Autoguider_Command_Config_Load(char *command_string,char **reply_string)
 	/* are we fielding/guiding etc? */
 	if(Autoguider_Field_Is_Fielding())
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Config Load failed:Field operation underway."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Config Load failed:Field operation underway."))
 			return FALSE;
 		return TRUE;
 	}
 	if(Autoguider_Guide_Is_Guiding())
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Config Load failed:Guide operation underway."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Config Load failed:Guide operation underway."))
 			return FALSE;
 		return TRUE;
 	}
@@ -483,7 +586,7 @@ int Autoguider_Command_Config_Load(char *command_string,char **reply_string)
 		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Config_Load:CCD_Config_Shutdown failed.");
 		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Config_Load",
 					 LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Autoguider_General_Add_String(reply_string,"1 Config Load failed."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Config Load failed."))
 			return FALSE;
 		return TRUE;
 	}
@@ -501,11 +604,11 @@ int Autoguider_Command_Config_Load(char *command_string,char **reply_string)
 			Autoguider_General_Get_Config_Filename());
 		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Config_Load",
 					 LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Autoguider_General_Add_String(reply_string,"1 Config Load failed."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Config Load failed."))
 			return FALSE;
 		return TRUE;
 	}
-	if(!Autoguider_General_Add_String(reply_string,"0 Config Load suceeded."))
+	if(!Autoguider_General_Reply_Add(reply,"0 Config Load suceeded."))
 		return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Config_Load",
@@ -524,9 +627,10 @@ int Autoguider_Command_Config_Load(char *command_string,char **reply_string)
  * <li>object min_con_pix <n>
  * </ul>
  * @param command_string The status command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
@@ -535,11 +639,10 @@ int Autoguider_Command_Config_Load(char *command_string,char **reply_string)
  * @see autoguider_object.html#Autoguider_Object_Ellipticity_Limit_Set
  * @see autoguider_object.html#Autoguider_Object_Min_Connected_Pixel_Count_Set
  */
-int Autoguider_Command_Object(char *command_string,char **reply_string)
+int Autoguider_Command_Object(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	char variable_string[65];
 	char value_string[65];
-	char buff[64];
 	float fvalue;
 	int retval,ivalue;
 	
@@ -553,10 +656,10 @@ int Autoguider_Command_Object(char *command_string,char **reply_string)
 		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Object:command_string was NULL.");
 		return FALSE;
 	}
-	if(reply_string == NULL)
+	if(reply == NULL)
 	{
 		Autoguider_General_Error_Number = 332;
-		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Object:reply_string was NULL.");
+		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Object:reply was NULL.");
 		return FALSE;
 	}
 #if AUTOGUIDER_DEBUG > 5
@@ -585,12 +688,11 @@ int Autoguider_Command_Object(char *command_string,char **reply_string)
 	{
 		if(!Autoguider_Object_Threshold_Sigma_Set(fvalue))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"0 object sigma set to:"))
+		if(!Autoguider_General_Reply_Add(reply,"0 object sigma set to:"))
 			return FALSE;
-		sprintf(buff,"%.3f",fvalue);
-		if(!Autoguider_General_Add_String(reply_string,buff))
+		if(!Autoguider_General_Reply_Add_Format(reply,"%.3f",fvalue))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 		return TRUE;
 	}
@@ -598,12 +700,11 @@ int Autoguider_Command_Object(char *command_string,char **reply_string)
 	{
 		if(!Autoguider_Object_Threshold_Sigma_Reject_Set(fvalue))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"0 object sigma reject set to:"))
+		if(!Autoguider_General_Reply_Add(reply,"0 object sigma reject set to:"))
 			return FALSE;
-		sprintf(buff,"%.3f",fvalue);
-		if(!Autoguider_General_Add_String(reply_string,buff))
+		if(!Autoguider_General_Reply_Add_Format(reply,"%.3f",fvalue))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 		return TRUE;
 	}
@@ -611,12 +712,11 @@ int Autoguider_Command_Object(char *command_string,char **reply_string)
 	{
 		if(!Autoguider_Object_Ellipticity_Limit_Set(fvalue))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"0 object ellipticity limit set to:"))
+		if(!Autoguider_General_Reply_Add(reply,"0 object ellipticity limit set to:"))
 			return FALSE;
-		sprintf(buff,"%.3f",fvalue);
-		if(!Autoguider_General_Add_String(reply_string,buff))
+		if(!Autoguider_General_Reply_Add_Format(reply,"%.3f",fvalue))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 		return TRUE;
 	}
@@ -633,22 +733,21 @@ int Autoguider_Command_Object(char *command_string,char **reply_string)
 		}
 		if(!Autoguider_Object_Min_Connected_Pixel_Count_Set(ivalue))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"0 object minimum connected pixels set to:"))
+		if(!Autoguider_General_Reply_Add(reply,"0 object minimum connected pixels set to:"))
 			return FALSE;
-		sprintf(buff,"%d",ivalue);
-		if(!Autoguider_General_Add_String(reply_string,buff))
+		if(!Autoguider_General_Reply_Add_Format(reply,"%d",ivalue))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 		return TRUE;
 	}
 	else
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Unknown variable:"))
+		if(!Autoguider_General_Reply_Add(reply,"1 Unknown variable:"))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,variable_string))
+		if(!Autoguider_General_Reply_Add(reply,variable_string))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 		return TRUE;
 	}
@@ -663,19 +762,27 @@ int Autoguider_Command_Object(char *command_string,char **reply_string)
  * <li>status temperature status
  * <li>status field &lt;active|dark|flat|object&gt;
  * <li>status guide &lt;active|dark|flat|object|packet|cadence|timecode_scaling|exposure_length|window&gt;
- * <li>status guide &lt;last_object|initial_position&gt;
+ * <li>status guide &lt;last_object|initial_position|packet_latency&gt;
  * <li>status object &lt;list|count|median|mean|background_standard_deviation|threshold&gt;
  * <li>status object &lt;sigma|sigma_reject|ellipticity_limit|min_con_pix&gt;
+ * <li>status memory heap
  * </ul>
+ * "status memory heap" returns "0 &lt;in use&gt; &lt;arena&gt; &lt;mmapped&gt; &lt;mmapped chunks&gt;", where
+ * &lt;in use&gt; is the number of heap bytes currently allocated (including mmapped chunks), as returned by
+ * mallinfo2. This is used by the soak test (test/autoguider_soak.c) to track allocation growth.
+ * "status guide packet_latency" returns "0 &lt;sent&gt; &lt;failed&gt; &lt;last&gt; &lt;max&gt; &lt;mean&gt;", the guide packet
+ * send counts and send latencies (in seconds) since the guide packet socket was last opened.
  * @param command_string The status command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see autoguider_cil.html#Autoguider_CIL_Guide_Packet_Send_Get
+ * @see autoguider_cil.html#Autoguider_CIL_Guide_Packet_Latency_Get
  * @see autoguider_field.html#Autoguider_Field_Is_Fielding
  * @see autoguider_field.html#Autoguider_Field_Get_Do_Dark_Subtract
  * @see autoguider_field.html#Autoguider_Field_Get_Do_Flat_Field
  * @see autoguider_field.html#Autoguider_Field_Get_Do_Object_Detect
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
@@ -704,24 +811,24 @@ int Autoguider_Command_Object(char *command_string,char **reply_string)
  * @see ../ccd/cdocs/ccd_general.html#CCD_General_Error
  * @see ../ccd/cdocs/ccd_general.html#CCD_General_Get_Time_String
  * @see ../ccd/cdocs/ccd_setup.html#CCD_Setup_Window_Struct
- * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Get
+ * @see autoguider_housekeeping.html#Autoguider_Housekeeping_Temperature_Get
  * @see ../ccd/cdocs/ccd_general.html#CCD_Temperature_Cached_Temperature_Get
  */
-int Autoguider_Command_Status(char *command_string,char **reply_string)
+int Autoguider_Command_Status(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	double temperature;
 	enum CCD_TEMPERATURE_STATUS temperature_status;
 	struct CCD_Setup_Window_Struct window;
 	struct Autoguider_Object_Struct last_object;
 	struct timespec temperature_time_stamp;
+	int temperature_age;
+	struct mallinfo2 memory_info;
 	char type_string[65];
 	char element_string[65];
 	char time_string[32];
-	char buff[256];
-	char *object_list_string = NULL;
-	double dvalue;
+	double dvalue,last_latency,max_latency,mean_latency;
 	float x,y,fvalue;
-	int retval,ivalue;
+	int retval,ivalue,send_count,fail_count;
 
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Status",
@@ -733,10 +840,10 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Status:command_string was NULL.");
 		return FALSE;
 	}
-	if(reply_string == NULL)
+	if(reply == NULL)
 	{
 		Autoguider_General_Error_Number = 319;
-		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Status:reply_string was NULL.");
+		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Status:reply was NULL.");
 		return FALSE;
 	}
 #if AUTOGUIDER_DEBUG > 5
@@ -757,48 +864,56 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Status",
 				       LOG_VERBOSITY_TERSE,"COMMAND","temperature status detected.");
 #endif
-		retval = CCD_Temperature_Get(&temperature,&temperature_status);
+		/* use the temperature published by the housekeeping thread, rather than calling CCD_Temperature_Get,
+		** which waits for any field or guide exposure in progress to finish (CCD_Driver_Lock) */
+		retval = Autoguider_Housekeeping_Temperature_Get(&temperature,&temperature_status,&temperature_age);
 		if(retval == FALSE)
 		{
-			Autoguider_General_Error_Number = 302;
-			sprintf(Autoguider_General_Error_String,"Autoguider_Command_Status:"
-				"CCD_Temperature_Get failed.");
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Status",
 						 LOG_VERBOSITY_TERSE,"COMMAND");
 			/* get last cached temperature instead */
 			CCD_Temperature_Cached_Temperature_Get(&temperature,&temperature_status,
 							       &temperature_time_stamp);
 		}
-		else /* set the temperature time stamp to be now */
+		else
+		{
+			/* set the temperature time stamp to be when it was read */
 			clock_gettime(CLOCK_REALTIME,&(temperature_time_stamp));
+			temperature_time_stamp.tv_sec -= temperature_age/AUTOGUIDER_GENERAL_ONE_SECOND_MS;
+			temperature_time_stamp.tv_nsec -= (temperature_age%AUTOGUIDER_GENERAL_ONE_SECOND_MS)*
+				AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS;
+			if(temperature_time_stamp.tv_nsec < 0)
+			{
+				temperature_time_stamp.tv_sec--;
+				temperature_time_stamp.tv_nsec += AUTOGUIDER_GENERAL_ONE_SECOND_NS;
+			}
+		}
 		if(strcmp(element_string,"get") == 0)
 		{
-			if(!Autoguider_General_Add_String(reply_string,"0 "))
+			if(!Autoguider_General_Reply_Add(reply,"0 "))
 				return FALSE;
 			CCD_General_Get_Time_String(temperature_time_stamp,time_string,31);
-			sprintf(buff,"%s %.2f",time_string,temperature);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"%s %.2f",time_string,temperature))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"status") == 0)
 		{
-			if(!Autoguider_General_Add_String(reply_string,"0 "))
+			if(!Autoguider_General_Reply_Add(reply,"0 "))
 				return FALSE;
 			CCD_General_Get_Time_String(temperature_time_stamp,time_string,31);
-			sprintf(buff,"%s %.2f %s",time_string,temperature,
-				CCD_Temperature_Status_To_String(temperature_status));
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"%s %.2f %s",time_string,temperature,
+				CCD_Temperature_Status_To_String(temperature_status)))
 				return FALSE;
 			return TRUE;
 		}
 		else
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Unknown temperature element:"))
+			if(!Autoguider_General_Reply_Add(reply,"1 Unknown temperature element:"))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,element_string))
+			if(!Autoguider_General_Reply_Add(reply,element_string))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,"."))
+			if(!Autoguider_General_Reply_Add(reply,"."))
 				return FALSE;
 			return TRUE;
 		}
@@ -813,12 +928,12 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_Field_Is_Fielding())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
 					return FALSE;
 			}
 			return TRUE;
@@ -827,12 +942,12 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_Field_Get_Do_Dark_Subtract())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
 					return FALSE;
 			}
 			return TRUE;
@@ -841,12 +956,12 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_Field_Get_Do_Flat_Field())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
 					return FALSE;
 			}
 			return TRUE;
@@ -855,23 +970,23 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_Field_Get_Do_Object_Detect())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
 					return FALSE;
 			}
 			return TRUE;
 		}
 		else
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Unknown field element:"))
+			if(!Autoguider_General_Reply_Add(reply,"1 Unknown field element:"))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,element_string))
+			if(!Autoguider_General_Reply_Add(reply,element_string))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,"."))
+			if(!Autoguider_General_Reply_Add(reply,"."))
 				return FALSE;
 			return TRUE;
 		}
@@ -886,12 +1001,12 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_Guide_Is_Guiding())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
 					return FALSE;
 			}
 			return TRUE;
@@ -900,12 +1015,12 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_Guide_Get_Do_Dark_Subtract())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
 					return FALSE;
 			}
 			return TRUE;
@@ -914,12 +1029,12 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_Guide_Get_Do_Flat_Field())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
 					return FALSE;
 			}
 			return TRUE;
@@ -928,12 +1043,12 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_Guide_Get_Do_Object_Detect())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
 					return FALSE;
 			}
 			return TRUE;
@@ -942,45 +1057,58 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 		{
 			if(Autoguider_CIL_Guide_Packet_Send_Get())
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 true"))
+				if(!Autoguider_General_Reply_Add(reply,"0 true"))
 					return FALSE;
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"0 false"))
+				if(!Autoguider_General_Reply_Add(reply,"0 false"))
+					return FALSE;
+			}
+			return TRUE;
+		}
+		else if(strcmp(element_string,"packet_latency") == 0)
+		{
+			if(!Autoguider_CIL_Guide_Packet_Latency_Get(&send_count,&fail_count,&last_latency,
+								    &max_latency,&mean_latency))
+			{
+				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Status",
+							 LOG_VERBOSITY_TERSE,"COMMAND");
+				if(!Autoguider_General_Reply_Add(reply,"1 Failed to get guide packet latency."))
 					return FALSE;
+				return TRUE;
 			}
+			/* 0 Send_Count Fail_Count Last_Latency Max_Latency Mean_Latency (latencies in seconds) */
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %d %d %.6f %.6f %.6f",send_count,fail_count,
+								last_latency,max_latency,mean_latency))
+				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"cadence") == 0)
 		{
 			dvalue = Autoguider_Guide_Loop_Cadence_Get();
-			sprintf(buff,"0 %.2f",dvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.2f",dvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"timecode_scaling") == 0)
 		{
 			dvalue = Autoguider_Guide_Timecode_Scaling_Get();
-			sprintf(buff,"0 %.2f",dvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.2f",dvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"exposure_length") == 0)
 		{
 			ivalue = Autoguider_Guide_Exposure_Length_Get();
-			sprintf(buff,"0 %d",ivalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %d",ivalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"window") == 0)
 		{
 			window = Autoguider_Guide_Window_Get();
-			sprintf(buff,"0 %d %d %d %d",window.X_Start,window.Y_Start,window.X_End,window.Y_End);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %d %d %d %d",window.X_Start,window.Y_Start,window.X_End,window.Y_End))
 				return FALSE;
 			return TRUE;
 		}
@@ -989,13 +1117,12 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 			last_object = Autoguider_Guide_Last_Object_Get();
 			/* 0 CCD_X_Position CCD_Y_Position Buffer_X_Position Buffer_Y_Position 
 			** Total_Counts Pixel_Count Peak_Counts Is_Stellar FWHM_X FWHM_Y */
-			sprintf(buff,"0 %.2f %.2f %.2f %.2f %.2f %d %.2f %s %.2f %.2f",
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.2f %.2f %.2f %.2f %.2f %d %.2f %s %.2f %.2f",
 				last_object.CCD_X_Position,last_object.CCD_Y_Position,
 				last_object.Buffer_X_Position,last_object.Buffer_Y_Position,
 				last_object.Total_Counts,last_object.Pixel_Count,last_object.Peak_Counts,
 				(last_object.Is_Stellar ? "TRUE" : "FALSE"),
-				last_object.FWHM_X,last_object.FWHM_Y);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+				last_object.FWHM_X,last_object.FWHM_Y))
 				return FALSE;
 			return TRUE;
 		}
@@ -1004,18 +1131,17 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 			x = Autoguider_Guide_Initial_Object_CCD_X_Position_Get();
 			y = Autoguider_Guide_Initial_Object_CCD_Y_Position_Get();
 			/* 0 Initial_Object_CCD_X_Position Initial_Object_CCD_Y_Position  */
-			sprintf(buff,"0 %.2f %.2f",x,y);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.2f %.2f",x,y))
 				return FALSE;
 			return TRUE;
 		}
 		else
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Unknown guide element:"))
+			if(!Autoguider_General_Reply_Add(reply,"1 Unknown guide element:"))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,element_string))
+			if(!Autoguider_General_Reply_Add(reply,element_string))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,"."))
+			if(!Autoguider_General_Reply_Add(reply,"."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1032,124 +1158,132 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Status",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,"1 Failed to get object list count."))
+				if(!Autoguider_General_Reply_Add(reply,"1 Failed to get object list count."))
 					return FALSE;
 				return TRUE;
 			}
-			sprintf(buff,"0 %d",ivalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %d",ivalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"list") == 0)
 		{
-			if(!Autoguider_Object_List_Get_Object_List_String(&object_list_string))
+			if(!Autoguider_General_Reply_Add(reply,"0 \n"))
+				return FALSE;
+			/* the object list is added directly to the reply */
+			if(!Autoguider_Object_List_Get_Object_List_String(reply))
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Status",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,"1 Failed to get object list."))
+				Autoguider_General_Reply_Reset(reply);
+				if(!Autoguider_General_Reply_Add(reply,"1 Failed to get object list."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 \n"))
-			{
-				if(object_list_string != NULL)
-					free(object_list_string);
-				return FALSE;
-			}
-			if(!Autoguider_General_Add_String(reply_string,object_list_string))
-			{
-				if(object_list_string != NULL)
-					free(object_list_string);
-				return FALSE;
-			}
-			/* free allocated string */
-			if(object_list_string != NULL)
-				free(object_list_string);
 			return TRUE;
 		}
 		else if(strcmp(element_string,"median") == 0)
 		{
 			fvalue = Autoguider_Object_Median_Get();
-			sprintf(buff,"0 %.6f",fvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.6f",fvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"mean") == 0)
 		{
 			fvalue = Autoguider_Object_Mean_Get();
-			sprintf(buff,"0 %.6f",fvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.6f",fvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"background_standard_deviation") == 0)
 		{
 			fvalue = Autoguider_Object_Background_Standard_Deviation_Get();
-			sprintf(buff,"0 %.6f",fvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.6f",fvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"threshold") == 0)
 		{
 			fvalue = Autoguider_Object_Threshold_Get();
-			sprintf(buff,"0 %.6f",fvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.6f",fvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"sigma") == 0)
 		{
 			fvalue = Autoguider_Object_Threshold_Sigma_Get();
-			sprintf(buff,"0 %.6f",fvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.6f",fvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"sigma_reject") == 0)
 		{
 			fvalue = Autoguider_Object_Threshold_Sigma_Reject_Get();
-			sprintf(buff,"0 %.6f",fvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.6f",fvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"ellipticity_limit") == 0)
 		{
 			fvalue = Autoguider_Object_Ellipticity_Limit_Get();
-			sprintf(buff,"0 %.6f",fvalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %.6f",fvalue))
 				return FALSE;
 			return TRUE;
 		}
 		else if(strcmp(element_string,"min_con_pix") == 0)
 		{
 			ivalue = Autoguider_Object_Min_Connected_Pixel_Count_Get();
-			sprintf(buff,"0 %d",ivalue);
-			if(!Autoguider_General_Add_String(reply_string,buff))
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %d",ivalue))
+				return FALSE;
+			return TRUE;
+		}
+		else
+		{
+			if(!Autoguider_General_Reply_Add(reply,"1 Unknown object element:"))
+				return FALSE;
+			if(!Autoguider_General_Reply_Add(reply,element_string))
+				return FALSE;
+			if(!Autoguider_General_Reply_Add(reply,"."))
+				return FALSE;
+			return TRUE;
+		}
+	}
+	else if(strcmp(type_string,"memory") == 0)
+	{
+#if AUTOGUIDER_DEBUG > 5
+		Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Status",
+				       LOG_VERBOSITY_TERSE,"COMMAND","memory status detected.");
+#endif
+		if(strcmp(element_string,"heap") == 0)
+		{
+			/* bytes in use = allocated arena chunks + mmapped chunks */
+			memory_info = mallinfo2();
+			if(!Autoguider_General_Reply_Add_Format(reply,"0 %lu %lu %lu %lu",
+					(unsigned long)(memory_info.uordblks+memory_info.hblkhd),
+					(unsigned long)memory_info.arena,(unsigned long)memory_info.hblkhd,
+					(unsigned long)memory_info.hblks))
 				return FALSE;
 			return TRUE;
 		}
 		else
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Unknown object element:"))
+			if(!Autoguider_General_Reply_Add(reply,"1 Unknown memory element:"))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,element_string))
+			if(!Autoguider_General_Reply_Add(reply,element_string))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,"."))
+			if(!Autoguider_General_Reply_Add(reply,"."))
 				return FALSE;
 			return TRUE;
 		}
 	}
 	else
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Unknown type:"))
+		if(!Autoguider_General_Reply_Add(reply,"1 Unknown type:"))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,type_string))
+		if(!Autoguider_General_Reply_Add(reply,type_string))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 		return TRUE;
 	}
@@ -1159,9 +1293,10 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
 /**
  * Handle a command of the form: "temperature [set <C>|cooler [on|off]".
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
@@ -1169,12 +1304,11 @@ int Autoguider_Command_Status(char *command_string,char **reply_string)
  * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Cooler_On
  * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Cooler_Off
  */
-int Autoguider_Command_Temperature(char *command_string,char **reply_string)
+int Autoguider_Command_Temperature(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	double target_temperature;
 	char type_string[64];
 	char parameter_string[64];
-	char buff[256];
 	int retval;
 
 #if AUTOGUIDER_DEBUG > 1
@@ -1199,9 +1333,9 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
 			"Failed to parse temperature command %s (%d).",command_string,retval);
 		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Temperature",
 			       LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Autoguider_General_Add_String(reply_string,"1 Failed to parse command string:"))
+		if(!Autoguider_General_Reply_Add(reply,"1 Failed to parse command string:"))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,command_string))
+		if(!Autoguider_General_Reply_Add(reply,command_string))
 			return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 			Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Temperature",
@@ -1214,9 +1348,9 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
 		retval = sscanf(parameter_string,"%lf",&target_temperature);
 		if(retval != 1)
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Failed to parse target temperature:"))
+			if(!Autoguider_General_Reply_Add(reply,"1 Failed to parse target temperature:"))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,parameter_string))
+			if(!Autoguider_General_Reply_Add(reply,parameter_string))
 				return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 			Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Temperature",
@@ -1237,7 +1371,7 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
 				"Failed to set temperature.");
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Temperature",
 			       LOG_VERBOSITY_TERSE,"COMMAND");
-			if(!Autoguider_General_Add_String(reply_string,"1 Failed to set target temperature."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Failed to set target temperature."))
 				return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 			Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Temperature",
@@ -1246,10 +1380,9 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
 			return TRUE;
 		}
 		/* reply ok */
-		if(!Autoguider_General_Add_String(reply_string,"0 target temperature now:"))
+		if(!Autoguider_General_Reply_Add(reply,"0 target temperature now:"))
 			return FALSE;
-		sprintf(buff,"%lf",target_temperature);
-		if(!Autoguider_General_Add_String(reply_string,buff))
+		if(!Autoguider_General_Reply_Add_Format(reply,"%lf",target_temperature))
 			return FALSE;
 	}
 	else if(strcmp(type_string,"cooler") == 0)
@@ -1269,7 +1402,7 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
 				Autoguider_General_Error("command","autoguider_command.c",
 							 "Autoguider_Command_Temperature",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,"1 Failed to turn cooler on."))
+				if(!Autoguider_General_Reply_Add(reply,"1 Failed to turn cooler on."))
 					return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 				Autoguider_General_Log("command","autoguider_command.c",
@@ -1278,7 +1411,7 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
 #endif
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 cooler on"))
+			if(!Autoguider_General_Reply_Add(reply,"0 cooler on"))
 				return FALSE;
 		}
 		else if(strcmp(parameter_string,"off")==0)
@@ -1296,7 +1429,7 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
 				Autoguider_General_Error("command","autoguider_command.c",
 							 "Autoguider_Command_Temperature",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,"1 Failed to turn cooler off."))
+				if(!Autoguider_General_Reply_Add(reply,"1 Failed to turn cooler off."))
 					return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 				Autoguider_General_Log("command","autoguider_command.c",
@@ -1305,26 +1438,26 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
 #endif
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 cooler off"))
+			if(!Autoguider_General_Reply_Add(reply,"0 cooler off"))
 				return FALSE;
 		}
 		else
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Unknown Parameter."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Unknown Parameter."))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,parameter_string))
+			if(!Autoguider_General_Reply_Add(reply,parameter_string))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,"."))
+			if(!Autoguider_General_Reply_Add(reply,"."))
 				return FALSE;
 		}
 	}
 	else
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Unknown type:"))
+		if(!Autoguider_General_Reply_Add(reply,"1 Unknown type:"))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,type_string))
+		if(!Autoguider_General_Reply_Add(reply,type_string))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 		Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Temperature",
@@ -1346,17 +1479,18 @@ int Autoguider_Command_Temperature(char *command_string,char **reply_string)
  * <li>"field <dark|flat|object> <on|off>"
  * </ul>
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see autoguider_cil.html#Autoguider_CIL_SDB_Packet_State_Set
  * @see autoguider_cil.html#Autoguider_CIL_SDB_Packet_Send
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_field.html#Autoguider_Field
  */
-int Autoguider_Command_Field(char *command_string,char **reply_string)
+int Autoguider_Command_Field(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	char parameter_string1[64];
 	char parameter_string2[64];
@@ -1373,11 +1507,11 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 	{
 		if(parameter_count != 2)
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Field parameter 2 not on or off:"))
+			if(!Autoguider_General_Reply_Add(reply,"1 Field parameter 2 not on or off:"))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,parameter_string2))
+			if(!Autoguider_General_Reply_Add(reply,parameter_string2))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,"."))
+			if(!Autoguider_General_Reply_Add(reply,"."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1392,11 +1526,11 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 		}
 		else
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Field parameter 2 not on or off:"))
+			if(!Autoguider_General_Reply_Add(reply,"1 Field parameter 2 not on or off:"))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,parameter_string2))
+			if(!Autoguider_General_Reply_Add(reply,parameter_string2))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,"."))
+			if(!Autoguider_General_Reply_Add(reply,"."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1408,12 +1542,12 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Field",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting field dark subtraction failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Field Do Dark Subtraction set."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Field Do Dark Subtraction set."))
 				return FALSE;
 		}
 		else if(strcmp(parameter_string1,"flat") == 0)
@@ -1423,12 +1557,12 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Field",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting field flat field failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Field Do Flat Fielding set."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Field Do Flat Fielding set."))
 				return FALSE;
 		}
 		else if(strcmp(parameter_string1,"object") == 0)
@@ -1438,12 +1572,12 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Field",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting field object detect failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Field Do Object Detect set."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Field Do Object Detect set."))
 				return FALSE;
 		}
 	}
@@ -1474,12 +1608,12 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 				}
 				else
 				{
-					if(!Autoguider_General_Add_String(reply_string,
+					if(!Autoguider_General_Reply_Add(reply,
 									  "1 Field parameter 2 not lock:"))
 						return FALSE;
-					if(!Autoguider_General_Add_String(reply_string,parameter_string2))
+					if(!Autoguider_General_Reply_Add(reply,parameter_string2))
 						return FALSE;
-					if(!Autoguider_General_Add_String(reply_string,"."))
+					if(!Autoguider_General_Reply_Add(reply,"."))
 						return FALSE;
 					return TRUE;
 				}
@@ -1489,7 +1623,7 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Field",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting field exposure length failed."))
 					return FALSE;
 				return TRUE;
@@ -1501,7 +1635,7 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 		{
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Field",
 						 LOG_VERBOSITY_TERSE,"COMMAND");
-			if(!Autoguider_General_Add_String(reply_string,"1 Field failed."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Field failed."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1516,7 +1650,7 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Field",
 						 LOG_VERBOSITY_TERSE,"COMMAND"); /* no need to fail */
 		}
-		if(!Autoguider_General_Add_String(reply_string,"0 Field suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Field suceeded."))
 			return FALSE;
 	}/* end else */
 #if AUTOGUIDER_DEBUG > 1
@@ -1529,16 +1663,17 @@ int Autoguider_Command_Field(char *command_string,char **reply_string)
 /**
  * Handle a command of the form: "expose <ms>".
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_field.html#Autoguider_Field_Expose
  * @see autoguider_field.html#Autoguider_Field_Exposure_Length_Set
  */
-int Autoguider_Command_Expose(char *command_string,char **reply_string)
+int Autoguider_Command_Expose(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	int retval,exposure_length;
 
@@ -1564,7 +1699,7 @@ int Autoguider_Command_Expose(char *command_string,char **reply_string)
 	{
 		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Expose",
 					 LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Autoguider_General_Add_String(reply_string,"1 Setting field exposure length failed."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Setting field exposure length failed."))
 			return FALSE;
 		return TRUE;
 	}
@@ -1573,11 +1708,11 @@ int Autoguider_Command_Expose(char *command_string,char **reply_string)
 	{
 		Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Expose",
 					 LOG_VERBOSITY_TERSE,"COMMAND");
-		if(!Autoguider_General_Add_String(reply_string,"1 Expose failed."))
+		if(!Autoguider_General_Reply_Add(reply,"1 Expose failed."))
 			return FALSE;
 		return TRUE;
 	}
-	if(!Autoguider_General_Add_String(reply_string,"0 Expose suceeded."))
+	if(!Autoguider_General_Reply_Add(reply,"0 Expose suceeded."))
 		return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Expose",
@@ -1597,10 +1732,11 @@ int Autoguider_Command_Expose(char *command_string,char **reply_string)
  * <li>guide timecode_scaling <float value>
  * </ul>
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see autoguider_cil.html#Autoguider_CIL_Guide_Packet_Send_Set
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
@@ -1616,7 +1752,7 @@ int Autoguider_Command_Expose(char *command_string,char **reply_string)
  * @see autoguider_guide.html#Autoguider_Guide_Set_Guide_Window_Tracking
  * @see autoguider_guide.html#Autoguider_Guide_Timecode_Scaling_Set
  */
-int Autoguider_Command_Guide(char *command_string,char **reply_string)
+int Autoguider_Command_Guide(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	char parameter_string1[64];
 	char parameter_string2[64];
@@ -1651,11 +1787,11 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 		{
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 						 LOG_VERBOSITY_TERSE,"COMMAND");
-			if(!Autoguider_General_Add_String(reply_string,"1 Guide on failed."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Guide on failed."))
 				return FALSE;
 			return TRUE;
 		}
-		if(!Autoguider_General_Add_String(reply_string,"0 Guide on suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Guide on suceeded."))
 			return FALSE;
 	}
 	else if(strcmp(parameter_string1,"off") == 0)
@@ -1665,11 +1801,11 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 		{
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 						 LOG_VERBOSITY_TERSE,"COMMAND");
-			if(!Autoguider_General_Add_String(reply_string,"1 Guide off failed."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Guide off failed."))
 				return FALSE;
 			return TRUE;
 		}
-		if(!Autoguider_General_Add_String(reply_string,"0 Guide off suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Guide off suceeded."))
 			return FALSE;
 	}
 	else if(strncmp(parameter_string1,"window",6) == 0)
@@ -1693,7 +1829,7 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,"1 Guide window failed."))
+				if(!Autoguider_General_Reply_Add(reply,"1 Guide window failed."))
 					return FALSE;
 				return TRUE;
 			}			
@@ -1705,12 +1841,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,"1 Guide window failed."))
+				if(!Autoguider_General_Reply_Add(reply,"1 Guide window failed."))
 					return FALSE;
 				return TRUE;
 			}
 		}
-		if(!Autoguider_General_Add_String(reply_string,"0 Guide window suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Guide window suceeded."))
 			return FALSE;
 	}
 	else if(strncmp(parameter_string1,"exposure_length",15) == 0)
@@ -1736,12 +1872,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			}
 			else
 			{
-				if(!Autoguider_General_Add_String(reply_string,"1 Setting guide exposure length:"
+				if(!Autoguider_General_Reply_Add(reply,"1 Setting guide exposure length:"
 								  "Illegal parameter 2:."))
 					return FALSE;
-				if(!Autoguider_General_Add_String(reply_string,parameter_string2))
+				if(!Autoguider_General_Reply_Add(reply,parameter_string2))
 					return FALSE;
-				if(!Autoguider_General_Add_String(reply_string,"."))
+				if(!Autoguider_General_Reply_Add(reply,"."))
 					return FALSE;
 				return TRUE;
 			}
@@ -1751,11 +1887,11 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 		{
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 						 LOG_VERBOSITY_TERSE,"COMMAND");
-			if(!Autoguider_General_Add_String(reply_string,"1 Setting guide exposure length failed."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Setting guide exposure length failed."))
 				return FALSE;
 			return TRUE;
 		}
-		if(!Autoguider_General_Add_String(reply_string,"0 Setting guide exposure length suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Setting guide exposure length suceeded."))
 			return FALSE;
 	}
 	else if((strncmp(parameter_string1,"dark",4) == 0)||(strncmp(parameter_string1,"flat",4) == 0)||
@@ -1763,7 +1899,7 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 	{
 		if(parameter_count != 2)
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Wrong number of parameters specified."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Wrong number of parameters specified."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1778,11 +1914,11 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 		}
 		else
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Guide parameter 2 not on or off:"))
+			if(!Autoguider_General_Reply_Add(reply,"1 Guide parameter 2 not on or off:"))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,parameter_string2))
+			if(!Autoguider_General_Reply_Add(reply,parameter_string2))
 				return FALSE;
-			if(!Autoguider_General_Add_String(reply_string,"."))
+			if(!Autoguider_General_Reply_Add(reply,"."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1794,12 +1930,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting guide dark subtraction failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Guide Do Dark Subtraction set."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Guide Do Dark Subtraction set."))
 				return FALSE;
 		}
 		else if(strcmp(parameter_string1,"flat") == 0)
@@ -1809,12 +1945,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting guide flat field failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Guide Do Flat Fielding set."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Guide Do Flat Fielding set."))
 				return FALSE;
 		}
 		else if(strcmp(parameter_string1,"packet") == 0)
@@ -1824,12 +1960,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting guide packet send failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Guide Packet Send set."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Guide Packet Send set."))
 				return FALSE;
 		}
 		else if(strcmp(parameter_string1,"window_track") == 0)
@@ -1839,12 +1975,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting guide window tracking failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Guide Window Tracking set."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Guide Window Tracking set."))
 				return FALSE;
 		}
 	}
@@ -1852,7 +1988,7 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 	{
 		if(parameter_count != 2)
 		{
-			if(!Autoguider_General_Add_String(reply_string,"1 Wrong number of parameters specified."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Wrong number of parameters specified."))
 				return FALSE;
 			return TRUE;
 		}
@@ -1871,12 +2007,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			retval = sscanf(parameter_string2,"%d",&object_index);
 			if(retval != 1)
 			{
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Guide parameter 2 not on/off/number:"))
 					return FALSE;
-				if(!Autoguider_General_Add_String(reply_string,parameter_string2))
+				if(!Autoguider_General_Reply_Add(reply,parameter_string2))
 					return FALSE;
-				if(!Autoguider_General_Add_String(reply_string,"."))
+				if(!Autoguider_General_Reply_Add(reply,"."))
 					return FALSE;
 				return TRUE;
 			}
@@ -1889,12 +2025,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting guide object detect failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Guide Do Object Detect set."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Guide Do Object Detect set."))
 				return FALSE;
 		}
 		else
@@ -1905,12 +2041,12 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 			{
 				Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 							 LOG_VERBOSITY_TERSE,"COMMAND");
-				if(!Autoguider_General_Add_String(reply_string,
+				if(!Autoguider_General_Reply_Add(reply,
 								  "1 Setting guide object failed."))
 					return FALSE;
 				return TRUE;
 			}
-			if(!Autoguider_General_Add_String(reply_string,"0 Setting guide object ok."))
+			if(!Autoguider_General_Reply_Add(reply,"0 Setting guide object ok."))
 				return FALSE;
 		}
 	}
@@ -1933,18 +2069,18 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 		{
 			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_Guide",
 						 LOG_VERBOSITY_TERSE,"COMMAND");
-			if(!Autoguider_General_Add_String(reply_string,"1 Setting guide timecode scaling failed."))
+			if(!Autoguider_General_Reply_Add(reply,"1 Setting guide timecode scaling failed."))
 				return FALSE;
 			return TRUE;
 		}
-		if(!Autoguider_General_Add_String(reply_string,"0 Setting guide timecode scaling suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Setting guide timecode scaling suceeded."))
 			return FALSE;
 	}
 	else
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Guide command failed:Unknown parameter:"))
+		if(!Autoguider_General_Reply_Add(reply,"1 Guide command failed:Unknown parameter:"))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,parameter_string1))
+		if(!Autoguider_General_Reply_Add(reply,parameter_string1))
 			return FALSE;
 	}
 #if AUTOGUIDER_DEBUG > 1
@@ -1955,30 +2091,38 @@ int Autoguider_Command_Guide(char *command_string,char **reply_string)
 }
 
 /**
- * Handle a command of the form: "getfits <field|guide|object> <raw|reduced>".
+ * Handle a command of the form: "getfits <field|guide|object> <raw|reduced> [compress=rice|none]".
+ * If compress=rice is specified, compress_element_size is set to the size of a pixel in the returned FITS image,
+ * so the caller can send it with Command_Server_Write_Binary_Message_Compressed. Raw and object images are
+ * unsigned short (2 bytes), reduced images are float (4 bytes).
  * @param command_string The command. This is not changed during this routine.
  * @param buffer_ptr The address of a pointer to allocate and store a FITS image in memory.
  * @param buffer_length The address of a word to store the length of the created returned data.
+ * @param compress_element_size The address of an integer, on a successful return set to the pixel size in bytes
+ *        to Rice compress the returned data with, or 0 if the data should be sent uncompressed.
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see #Autoguider_General_Add_String
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_get_fits.html#Autoguider_Get_Fits
+ * @see ../command_server/cdocs/command_server.html#Command_Server_Write_Binary_Message_Compressed
  */
-int Autoguider_Command_Get_Fits(char *command_string,void **buffer_ptr,size_t *buffer_length)
+int Autoguider_Command_Get_Fits(char *command_string,void **buffer_ptr,size_t *buffer_length,
+				int *compress_element_size)
 {
 	char type_parameter_string[64];
 	char state_parameter_string[64];
-	int retval,buffer_type,buffer_state;
+	char compress_parameter_string[64];
+	int retval,buffer_type,buffer_state,is_compressed;
 
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Get_Fits",
 			       LOG_VERBOSITY_TERSE,"COMMAND","started.");
 #endif
 	/* parse command */
-	retval = sscanf(command_string,"getfits %64s %64s",type_parameter_string,state_parameter_string);
-	if(retval != 2)
+	retval = sscanf(command_string,"getfits %64s %64s %64s",type_parameter_string,state_parameter_string,
+			compress_parameter_string);
+	if((retval != 2)&&(retval != 3))
 	{
 		Autoguider_General_Error_Number = 308;
 		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Get_Fits:"
@@ -2015,6 +2159,26 @@ int Autoguider_Command_Get_Fits(char *command_string,void **buffer_ptr,size_t *b
 			"Get FITS had illegal state parameter:%s.",state_parameter_string);
 		return FALSE;
 	}
+	/* parse optional compress parameter */
+	if((retval == 2)||(strcmp(compress_parameter_string,"compress=none") == 0))
+		is_compressed = FALSE;
+	else if(strcmp(compress_parameter_string,"compress=rice") == 0)
+		is_compressed = TRUE;
+	else
+	{
+		Autoguider_General_Error_Number = 345;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Get_Fits:"
+			"Get FITS had illegal compress parameter:%s.",compress_parameter_string);
+		return FALSE;
+	}
+	/* compress on the pixel size: object and raw images are unsigned short, reduced images are float */
+	if(is_compressed == FALSE)
+		(*compress_element_size) = 0;
+	else if((buffer_type == AUTOGUIDER_GET_FITS_BUFFER_TYPE_OBJECT)||
+		(buffer_state == AUTOGUIDER_GET_FITS_BUFFER_STATE_RAW))
+		(*compress_element_size) = sizeof(unsigned short);
+	else
+		(*compress_element_size) = sizeof(float);
 	/* get FITS in memory buffer */
 	retval = Autoguider_Get_Fits(buffer_type,buffer_state,-1,buffer_ptr,buffer_length);
 	if(retval == FALSE)
@@ -2028,12 +2192,114 @@ int Autoguider_Command_Get_Fits(char *command_string,void **buffer_ptr,size_t *b
 	return TRUE;
 }
 
+/**
+ * Handle a command of the form: "getpreview &lt;field|guide&gt; [bin &lt;n&gt;] [png|pgm] [zscale|percentile] [overlay]".
+ * The optional parameters can be in any order. The defaults are bin 1, png, zscale and no overlay.
+ * @param command_string The command. This is not changed during this routine.
+ * @param buffer_ptr The address of a pointer to allocate and store a preview image in memory.
+ * @param buffer_length The address of a word to store the length of the created returned data.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_general.html#Autoguider_General_Log
+ * @see autoguider_general.html#Autoguider_General_Error_Number
+ * @see autoguider_general.html#Autoguider_General_Error_String
+ * @see autoguider_preview.html#Autoguider_Preview_Get
+ */
+int Autoguider_Command_Get_Preview(char *command_string,void **buffer_ptr,size_t *buffer_length)
+{
+	char parameter_string_list[6][32];
+	int i,retval,parameter_count,buffer_type,bin,scale_type,format,overlay;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Get_Preview",
+			       LOG_VERBOSITY_TERSE,"COMMAND","started.");
+#endif
+	/* parse command */
+	parameter_count = sscanf(command_string,"getpreview %31s %31s %31s %31s %31s %31s",parameter_string_list[0],
+				 parameter_string_list[1],parameter_string_list[2],parameter_string_list[3],
+				 parameter_string_list[4],parameter_string_list[5]);
+	if(parameter_count < 1)
+	{
+		Autoguider_General_Error_Number = 341;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Get_Preview:"
+			"Failed to parse command %s (%d).",command_string,parameter_count);
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Get_Preview",
+				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
+#endif
+		return FALSE;
+	}
+	/* parse type parameter */
+	if(strcmp(parameter_string_list[0],"field") == 0)
+		buffer_type = AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD;
+	else if(strcmp(parameter_string_list[0],"guide") == 0)
+		buffer_type = AUTOGUIDER_PREVIEW_BUFFER_TYPE_GUIDE;
+	else
+	{
+		Autoguider_General_Error_Number = 342;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Command_Get_Preview:"
+			"Get preview had illegal type parameter:%s.",parameter_string_list[0]);
+		return FALSE;
+	}
+	/* parse optional parameters */
+	bin = 1;
+	format = AUTOGUIDER_PREVIEW_FORMAT_PNG;
+	scale_type = AUTOGUIDER_PREVIEW_SCALE_ZSCALE;
+	overlay = FALSE;
+	for(i = 1; i < parameter_count; i++)
+	{
+		if(strcmp(parameter_string_list[i],"bin") == 0)
+		{
+			i++;
+			if(i < parameter_count)
+				retval = sscanf(parameter_string_list[i],"%d",&bin);
+			else
+				retval = 0;
+			if(retval != 1)
+			{
+				Autoguider_General_Error_Number = 343;
+				sprintf(Autoguider_General_Error_String,"Autoguider_Command_Get_Preview:"
+					"Get preview bin parameter missing or not a number:%s.",command_string);
+				return FALSE;
+			}
+		}
+		else if(strcmp(parameter_string_list[i],"png") == 0)
+			format = AUTOGUIDER_PREVIEW_FORMAT_PNG;
+		else if(strcmp(parameter_string_list[i],"pgm") == 0)
+			format = AUTOGUIDER_PREVIEW_FORMAT_PGM;
+		else if(strcmp(parameter_string_list[i],"zscale") == 0)
+			scale_type = AUTOGUIDER_PREVIEW_SCALE_ZSCALE;
+		else if(strcmp(parameter_string_list[i],"percentile") == 0)
+			scale_type = AUTOGUIDER_PREVIEW_SCALE_PERCENTILE;
+		else if(strcmp(parameter_string_list[i],"overlay") == 0)
+			overlay = TRUE;
+		else
+		{
+			Autoguider_General_Error_Number = 344;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Command_Get_Preview:"
+				"Get preview had illegal parameter:%s.",parameter_string_list[i]);
+			return FALSE;
+		}
+	}
+	/* get preview image in memory buffer */
+	retval = Autoguider_Preview_Get(buffer_type,bin,scale_type,format,overlay,buffer_ptr,buffer_length);
+	if(retval == FALSE)
+	{
+		return FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_Get_Preview",
+			       LOG_VERBOSITY_TERSE,"COMMAND","finished.");
+#endif
+	return TRUE;
+}
+
 /**
  * Handle a command of the form: "log_level <autoguider|ccd|command_server|object|ngatcil> <n>".
  * @param command_string The command. This is not changed during this routine.
- * @param reply_string The address of a pointer to allocate and set the reply string.
+ * @param reply The address of a reply buffer to add the reply string to.
  * @return The routine returns TRUE on success and FALSE on failure.
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
@@ -2042,7 +2308,7 @@ int Autoguider_Command_Get_Fits(char *command_string,void **buffer_ptr,size_t *b
  * @see ../ngatcil/cdocs/ngatcil_general.html#NGATCil_General_Set_Log_Filter_Level
  * @see ../../libdprt/object/cdocs/object.html#Object_Set_Log_Filter_Level
  */
-int Autoguider_Command_Log_Level(char *command_string,char **reply_string)
+int Autoguider_Command_Log_Level(char *command_string,struct Autoguider_General_Reply_Struct *reply)
 {
 	char parameter_buff[32];
 	int retval,log_level;
@@ -2067,40 +2333,40 @@ int Autoguider_Command_Log_Level(char *command_string,char **reply_string)
 	if(strcmp(parameter_buff,"autoguider") == 0)
 	{
 		Autoguider_General_Set_Log_Filter_Level(log_level);
-		if(!Autoguider_General_Add_String(reply_string,"0 Setting autoguider log level suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Setting autoguider log level suceeded."))
 			return FALSE;
 	}
 	else if(strcmp(parameter_buff,"ccd") == 0)
 	{
 		CCD_General_Set_Log_Filter_Level(log_level);
-		if(!Autoguider_General_Add_String(reply_string,"0 Setting ccd log level suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Setting ccd log level suceeded."))
 			return FALSE;
 	}
 	else if(strcmp(parameter_buff,"command_server") == 0)
 	{
 		Command_Server_Set_Log_Filter_Level(log_level);
-		if(!Autoguider_General_Add_String(reply_string,"0 Setting command_server log level suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Setting command_server log level suceeded."))
 			return FALSE;
 	}
 	else if(strcmp(parameter_buff,"object") == 0)
 	{
 		Object_Set_Log_Filter_Level(log_level);
-		if(!Autoguider_General_Add_String(reply_string,"0 Setting object log level suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Setting object log level suceeded."))
 			return FALSE;
 	}
 	else if(strcmp(parameter_buff,"ngatcil") == 0)
 	{
 		NGATCil_General_Set_Log_Filter_Level(log_level);
-		if(!Autoguider_General_Add_String(reply_string,"0 Setting ngatcil log level suceeded."))
+		if(!Autoguider_General_Reply_Add(reply,"0 Setting ngatcil log level suceeded."))
 			return FALSE;
 	}
 	else
 	{
-		if(!Autoguider_General_Add_String(reply_string,"1 Setting log level failed:Illegal parameter:"))
+		if(!Autoguider_General_Reply_Add(reply,"1 Setting log level failed:Illegal parameter:"))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,parameter_buff))
+		if(!Autoguider_General_Reply_Add(reply,parameter_buff))
 			return FALSE;
-		if(!Autoguider_General_Add_String(reply_string,"."))
+		if(!Autoguider_General_Reply_Add(reply,"."))
 			return FALSE;
 	}
 #if AUTOGUIDER_DEBUG > 1
@@ -2110,6 +2376,191 @@ int Autoguider_Command_Log_Level(char *command_string,char **reply_string)
 	return TRUE;
 }
 
+/**
+ * Handle a command of the form: "ccd trace [on|off|clear|dump|save <filename>]".
+ * <ul>
+ * <li><b>on|off</b> Turn tracing of CCD driver calls on or off.
+ * <li><b>clear</b> Empty the trace ring.
+ * <li><b>dump</b> (the default) Return the traced calls, oldest first, one per line:
+ *     "&lt;sequence&gt; &lt;call&gt; &lt;start (monotonic seconds)&gt; &lt;duration ms&gt; &lt;result&gt;
+ *     &lt;arguments&gt;".
+ * <li><b>save</b> Write the traced calls in Chrome trace-event JSON format to the specified file, which must be a
+ *     leafname, in the log directory ("logging.directory_name").
+ * </ul>
+ * @param command_string The command. This is not changed during this routine.
+ * @param reply The address of a reply buffer to add the reply string to.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
+ * @see autoguider_general.html#Autoguider_General_Log
+ * @see autoguider_general.html#Autoguider_General_Error_Number
+ * @see autoguider_general.html#Autoguider_General_Error_String
+ * @see ../ccd/cdocs/ccd_trace.html#CCD_Trace_Enable_Set
+ * @see ../ccd/cdocs/ccd_trace.html#CCD_Trace_Clear
+ * @see ../ccd/cdocs/ccd_trace.html#CCD_Trace_Get
+ * @see ../ccd/cdocs/ccd_trace.html#CCD_Trace_Chrome_JSON_Write
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
+ * @see autoguider_general.html#Autoguider_General_Filename_Is_Leafname
+ */
+int Autoguider_Command_CCD(char *command_string,struct Autoguider_General_Reply_Struct *reply)
+{
+	struct CCD_Trace_Record_Struct *record_list = NULL;
+	char type_string[32];
+	char operation_string[32];
+	char filename[256];
+	char pathname[256];
+	char *directory_name = NULL;
+	double duration_ms;
+	FILE *fp = NULL;
+	int i,retval,record_count;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_CCD",
+			       LOG_VERBOSITY_TERSE,"COMMAND","started.");
+#endif
+	if(command_string == NULL)
+	{
+		Autoguider_General_Error_Number = 336;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Command_CCD:command_string was NULL.");
+		return FALSE;
+	}
+	strcpy(operation_string,"dump");
+	retval = sscanf(command_string,"ccd %31s %31s %255s",type_string,operation_string,filename);
+	if((retval < 1)||(strcmp(type_string,"trace") != 0))
+	{
+		if(!Autoguider_General_Reply_Add(reply,"1 Failed to parse command string:"))
+			return FALSE;
+		if(!Autoguider_General_Reply_Add(reply,command_string))
+			return FALSE;
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_CCD",
+				       LOG_VERBOSITY_TERSE,"COMMAND","finished (command parse failed).");
+#endif
+		return TRUE;
+	}
+	if(strcmp(operation_string,"on") == 0)
+	{
+		CCD_Trace_Enable_Set(TRUE);
+		if(!Autoguider_General_Reply_Add(reply,"0 ccd trace on"))
+			return FALSE;
+	}
+	else if(strcmp(operation_string,"off") == 0)
+	{
+		CCD_Trace_Enable_Set(FALSE);
+		if(!Autoguider_General_Reply_Add(reply,"0 ccd trace off"))
+			return FALSE;
+	}
+	else if(strcmp(operation_string,"clear") == 0)
+	{
+		CCD_Trace_Clear();
+		if(!Autoguider_General_Reply_Add(reply,"0 ccd trace cleared"))
+			return FALSE;
+	}
+	else if(strcmp(operation_string,"dump") == 0)
+	{
+		record_list = (struct CCD_Trace_Record_Struct *)malloc(CCD_TRACE_RING_LENGTH*
+								       sizeof(struct CCD_Trace_Record_Struct));
+		if(record_list == NULL)
+		{
+			Autoguider_General_Error_Number = 337;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Command_CCD:"
+				"Failed to allocate trace record list.");
+			return FALSE;
+		}
+		if(!CCD_Trace_Get(record_list,CCD_TRACE_RING_LENGTH,&record_count))
+		{
+			free(record_list);
+			Autoguider_General_Error_Number = 338;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Command_CCD:Failed to get trace.");
+			return FALSE;
+		}
+		if(!Autoguider_General_Reply_Add_Format(reply,"0 %d\n",record_count))
+		{
+			free(record_list);
+			return FALSE;
+		}
+		for(i = 0; i < record_count; i++)
+		{
+			duration_ms = fdifftime(record_list[i].End_Time,record_list[i].Start_Time)*
+				((double)AUTOGUIDER_GENERAL_ONE_SECOND_MS);
+			if(!Autoguider_General_Reply_Add_Format(reply,"%u %s %ld.%09ld %.3f %d %s\n",
+								record_list[i].Sequence,record_list[i].Name,
+								(long)record_list[i].Start_Time.tv_sec,
+								(long)record_list[i].Start_Time.tv_nsec,duration_ms,
+								record_list[i].Result,record_list[i].Arguments))
+			{
+				free(record_list);
+				return FALSE;
+			}
+		}
+		free(record_list);
+	}
+	else if((strcmp(operation_string,"save") == 0)&&(retval == 3))
+	{
+		/* only allow the trace to be written into the log directory */
+		if(!Autoguider_General_Filename_Is_Leafname(filename))
+		{
+			if(!Autoguider_General_Reply_Add_Format(reply,"1 Filename %s is not a leafname.",filename))
+				return FALSE;
+			return TRUE;
+		}
+		if(!CCD_Config_Get_String("logging.directory_name",&directory_name))
+		{
+			Autoguider_General_Error_Number = 346;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Command_CCD:"
+				"Failed to get config:'logging.directory_name'.");
+			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_CCD",
+						 LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Autoguider_General_Reply_Add(reply,"1 Failed to get trace directory."))
+				return FALSE;
+			return TRUE;
+		}
+		snprintf(pathname,sizeof(pathname),"%s/%s",directory_name,filename);
+		free(directory_name);
+		strcpy(filename,pathname);
+		fp = fopen(filename,"w");
+		if(fp == NULL)
+		{
+			if(!Autoguider_General_Reply_Add_Format(reply,"1 Failed to open %s (%d).",filename,errno))
+				return FALSE;
+#if AUTOGUIDER_DEBUG > 1
+			Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_CCD",
+					       LOG_VERBOSITY_TERSE,"COMMAND","finished (open failed).");
+#endif
+			return TRUE;
+		}
+		retval = CCD_Trace_Chrome_JSON_Write(fp);
+		fclose(fp);
+		if(retval == FALSE)
+		{
+			Autoguider_General_Error_Number = 339;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Command_CCD:"
+				"Failed to write trace to %s.",filename);
+			Autoguider_General_Error("command","autoguider_command.c","Autoguider_Command_CCD",
+						 LOG_VERBOSITY_TERSE,"COMMAND");
+			if(!Autoguider_General_Reply_Add(reply,"1 Failed to write trace."))
+				return FALSE;
+			return TRUE;
+		}
+		if(!Autoguider_General_Reply_Add_Format(reply,"0 ccd trace saved to %s",filename))
+			return FALSE;
+	}
+	else
+	{
+		if(!Autoguider_General_Reply_Add(reply,"1 Unknown operation:"))
+			return FALSE;
+		if(!Autoguider_General_Reply_Add(reply,operation_string))
+			return FALSE;
+		if(!Autoguider_General_Reply_Add(reply,"."))
+			return FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("command","autoguider_command.c","Autoguider_Command_CCD",
+			       LOG_VERBOSITY_TERSE,"COMMAND","finished.");
+#endif
+	return TRUE;
+}
+
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.17  2012/03/07 14:56:26  cjm
@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
@@ -31,12 +32,34 @@
 #include "ccd_general.h"
 #include "ccd_setup.h"
 
+#include "autoguider_calibration_cache.h"
 #include "autoguider_dark.h"
 #include "autoguider_field.h"
 #include "autoguider_general.h"
 #include "autoguider_guide.h"
 
 /* data types */
+/**
+ * Data type holding one dark synthesised from the dark model. This consists of the following:
+ * <dl>
+ * <dt>Bin_X</dt> <dd>X binning of the synthesised dark.</dd>
+ * <dt>Bin_Y</dt> <dd>Y binning of the synthesised dark.</dd>
+ * <dt>Exposure_Length</dt> <dd>The exposure length of the synthesised dark in milliseconds,
+ *     or -1 if this cache entry is unused.</dd>
+ * <dt>Last_Used</dt> <dd>The value of Dark_Data.Cache_Clock when this entry was last used,
+ *     the least recently used entry is re-used when the cache is full.</dd>
+ * <dt>Data</dt> <dd>Pointer to float data containing the synthesised dark, of Binned_NCols x Binned_NRows.</dd>
+ * </dl>
+ */
+struct Dark_Model_Cache_Struct
+{
+	int Bin_X;
+	int Bin_Y;
+	int Exposure_Length;
+	unsigned int Last_Used;
+	float *Data;
+};
+
 /**
  * Data type holding local data to autoguider_dark. This consists of the following:
  * <dl>
@@ -52,7 +75,29 @@
  * <dt>Exposure_Length_List</dt> <dd>An allocated list of exposure lengths read from the config file,
  *                               should match the available dark list.</dd>
  * <dt>Exposure_Length_Count</dt> <dd>The number of exposure lengths in the list.</dd>
+ * <dt>Current_Data</dt> <dd>Pointer to the dark currently used for dark subtraction. This is either
+ *     Reduced_Data, the Data of Calibration_Map, or the Data of an entry in Cache_List when the dark model
+ *     is enabled.</dd>
+ * <dt>Calibration_Map</dt> <dd>The calibration cache file mapped for the current dark, if any.</dd>
+ * <dt>Model_Enable</dt> <dd>A boolean, if TRUE darks are synthesised from a bias and a dark current frame
+ *     for any exposure length, rather than loaded from a dark FITS image per exposure length
+ *     (dark.model.enable).</dd>
+ * <dt>Min_Exposure_Length</dt> <dd>The minimum exposure length, in milliseconds (ccd.exposure.minimum).
+ *     Only used when the dark model is enabled.</dd>
+ * <dt>Max_Exposure_Length</dt> <dd>The maximum exposure length, in milliseconds (ccd.exposure.maximum).
+ *     Only used when the dark model is enabled.</dd>
+ * <dt>Model_Bin_X</dt> <dd>X binning of the loaded bias and dark current frames, or -1 if none are loaded.</dd>
+ * <dt>Model_Bin_Y</dt> <dd>Y binning of the loaded bias and dark current frames, or -1 if none are loaded.</dd>
+ * <dt>Bias_Data</dt> <dd>Pointer to float data containing the bias frame of the dark model.</dd>
+ * <dt>Rate_Data</dt> <dd>Pointer to float data containing the dark current frame of the dark model,
+ *     in counts per second.</dd>
+ * <dt>Cache_List</dt> <dd>An allocated list of darks synthesised from the dark model.</dd>
+ * <dt>Cache_Count</dt> <dd>The number of entries in Cache_List (dark.model.cache.count).</dd>
+ * <dt>Cache_Clock</dt> <dd>Incremented every time a cache entry is used, to find the least recently used
+ *     entry.</dd>
  * </dl>
+ * @see #Dark_Model_Cache_Struct
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Map_Struct
  */
 struct Dark_Struct
 {
@@ -67,6 +112,18 @@ struct Dark_Struct
 	pthread_mutex_t Reduced_Mutex;
 	int *Exposure_Length_List;
 	int Exposure_Length_Count;
+	float *Current_Data;
+	struct Autoguider_Calibration_Cache_Map_Struct Calibration_Map;
+	int Model_Enable;
+	int Min_Exposure_Length;
+	int Max_Exposure_Length;
+	int Model_Bin_X;
+	int Model_Bin_Y;
+	float *Bias_Data;
+	float *Rate_Data;
+	struct Dark_Model_Cache_Struct *Cache_List;
+	int Cache_Count;
+	unsigned int Cache_Clock;
 };
 
 /* internal data */
@@ -82,20 +139,31 @@ static struct Dark_Struct Dark_Data =
 {
 	0,0,-1,-1,0,0,
 	0,NULL,PTHREAD_MUTEX_INITIALIZER,
-	NULL,0
+	NULL,0,
+	NULL,{NULL,0,NULL},FALSE,0,0,-1,-1,NULL,NULL,
+	NULL,0,0
 };
 
 /* internal functions */
 static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_length);
 static int Dark_Exposure_Length_List_Initialise(void);
+static int Dark_Load_Image(char *filename,float *data_ptr);
+static int Dark_Model_Initialise(void);
+static int Dark_Model_Set(int bin_x,int bin_y,int exposure_length);
+static int Dark_Model_Load(int bin_x,int bin_y);
+static void Dark_Model_Synthesise(float *dark_ptr,float *bias_ptr,float *rate_ptr,float exposure_seconds,
+				  int pixel_count);
+static void Dark_Model_Cache_Free(void);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
 ** ---------------------------------------------------------------------------- */
 /**
  * Initialise the dark buffers. Reads the field dimensions from the config file, and calls 
- * Autoguider_Dark_Set_Dimension to setup the dark buffers.
+ * Autoguider_Dark_Set_Dimension to setup the dark buffers. Dark_Model_Initialise is called to 
+ * setup the dark model.
  * @see #Dark_Exposure_Length_List_Initialise
+ * @see #Dark_Model_Initialise
  * @see #Autoguider_Dark_Set_Dimension
  * @see autoguider.general.html#Autoguider_General_Log
  * @see autoguider.general.html#Autoguider_General_Error_Number
@@ -150,7 +218,10 @@ int Autoguider_Dark_Initialise(void)
 	retval = Dark_Exposure_Length_List_Initialise();
 	if(retval == FALSE)
 		return FALSE;
-
+	/* setup dark model */
+	retval = Dark_Model_Initialise();
+	if(retval == FALSE)
+		return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("dark","autoguider_dark.c","Autoguider_Dark_Initialise",LOG_VERBOSITY_INTERMEDIATE,
 			       "DARK","finished.");
@@ -160,6 +231,7 @@ int Autoguider_Dark_Initialise(void)
 
 /**
  * Set the dimensions, and (re) allocate the dark buffer accordingly.
+ * Any loaded dark model frames and synthesised darks are freed, as they are the wrong size.
  * Locks/unlocks the associated mutex.
  * @param ncols Number of unbinned columns.
  * @param nrows Number of unbinned rows.
@@ -167,6 +239,7 @@ int Autoguider_Dark_Initialise(void)
  * @param y_bin Y (row) binning.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Dark_Data
+ * @see #Dark_Model_Cache_Free
  * @see autoguider_general.html#Autoguider_General_Mutex_Lock
  * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
  * @see autoguider_general.html#Autoguider_General_Log
@@ -213,6 +286,15 @@ int Autoguider_Dark_Set_Dimension(int ncols,int nrows,int x_bin,int y_bin)
 			Dark_Data.Binned_NCols,Dark_Data.Binned_NRows);
 		return FALSE;
 	}
+	Dark_Data.Current_Data = Dark_Data.Reduced_Data;
+	/* the mapped dark, dark model frames and synthesised darks are now the wrong size, force a reload */
+	if(!Autoguider_Calibration_Cache_Unmap(&(Dark_Data.Calibration_Map)))
+	{
+		Autoguider_General_Error("dark","autoguider_dark.c","Autoguider_Dark_Set_Dimension",
+					 LOG_VERBOSITY_INTERMEDIATE,"DARK"); /* no need to fail */
+	}
+	Dark_Model_Cache_Free();
+	Dark_Data.Exposure_Length = -1;
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 	if(retval == FALSE)
@@ -227,12 +309,15 @@ int Autoguider_Dark_Set_Dimension(int ncols,int nrows,int x_bin,int y_bin)
 /**
  * Set which dark to load/use for dark subtraction.
  * Calls Dark_Load_Reduced to load a new dark, <b>only</b> if the exposure length/binning has changed.
+ * If the dark model is enabled, Dark_Model_Set is called instead, to synthesise a dark for the 
+ * exposure length.
  * @param bin_x The X binning factor.
  * @param bin_y The Y binning factor.
  * @param exposure_length The exposure length in milliseconds.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Dark_Data
  * @see #Dark_Load_Reduced
+ * @see #Dark_Model_Set
  * @see autoguider.general.html#Autoguider_General_Log
  * @see autoguider.general.html#Autoguider_General_Error_Number
  * @see autoguider.general.html#Autoguider_General_Error_String
@@ -275,6 +360,18 @@ int Autoguider_Dark_Set(int bin_x,int bin_y,int exposure_length)
 #if AUTOGUIDER_DEBUG > 5
 		Autoguider_General_Log("dark","autoguider_dark.c","Autoguider_Dark_Set",LOG_VERBOSITY_INTERMEDIATE,
 				       "DARK","Correct dark already loaded:exiting.");
+#endif
+		return TRUE;
+	}
+	/* synthesise a dark from the dark model */
+	if(Dark_Data.Model_Enable)
+	{
+		retval = Dark_Model_Set(bin_x,bin_y,exposure_length);
+		if(retval == FALSE)
+			return FALSE;
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("dark","autoguider_dark.c","Autoguider_Dark_Set",LOG_VERBOSITY_INTERMEDIATE,
+				       "DARK","finished.");
 #endif
 		return TRUE;
 	}
@@ -431,7 +528,7 @@ int Autoguider_Dark_Subtract(float *buffer_ptr,int pixel_count,int ncols,int nro
 	for(buffer_y=0;buffer_y<buffer_nrows;buffer_y++)
 	{
 		current_buffer_ptr = buffer_ptr+(buffer_y*buffer_ncols);
-		current_dark_ptr = Dark_Data.Reduced_Data+(((dark_start_y+buffer_y)*Dark_Data.Binned_NCols)+
+		current_dark_ptr = Dark_Data.Current_Data+(((dark_start_y+buffer_y)*Dark_Data.Binned_NCols)+
 							   dark_start_x);
 #if AUTOGUIDER_DEBUG > 9
 		if(buffer_y==0)
@@ -442,9 +539,9 @@ int Autoguider_Dark_Subtract(float *buffer_ptr,int pixel_count,int ncols,int nro
 					       current_buffer_ptr,buffer_ptr,buffer_y,buffer_ncols);
 			Autoguider_General_Log_Format("dark","autoguider_dark.c","Autoguider_Dark_Subtract",
 						      LOG_VERBOSITY_VERY_VERBOSE,"DARK",
-					       "current_dark_ptr %p = Dark_Data.Reduced_Data %p+ (((dark_start_y %d + "
+					       "current_dark_ptr %p = Dark_Data.Current_Data %p+ (((dark_start_y %d + "
 					       "buffer_y %d)*Dark_Data.Binned_NCols %d)+dark_start_x %d.",
-					       current_dark_ptr,Dark_Data.Reduced_Data,dark_start_y,buffer_y,
+					       current_dark_ptr,Dark_Data.Current_Data,dark_start_y,buffer_y,
 					       Dark_Data.Binned_NCols,dark_start_x);
 		}
 #endif
@@ -472,6 +569,73 @@ int Autoguider_Dark_Subtract(float *buffer_ptr,int pixel_count,int ncols,int nro
 	return TRUE;
 }
 
+/**
+ * Routine to subtract the currently loaded reduced dark data from a band of rows of a full frame buffer.
+ * This does the same per-pixel subtraction as an unwindowed Autoguider_Dark_Subtract, but only on rows
+ * start_row..(start_row+row_count-1), so different bands of the same frame can be dark subtracted in parallel.
+ * @param buffer_ptr The <b>full frame</b> buffer requiring the currently loaded dark to be subtacted off it.
+ *        If the buffer has an associated mutex, this should have been locked <b>before</b> calling this routine,
+ *        this routine does <b>not</b> lock/unclock mutexs.
+ * @param ncols The number of columns in the <b>full frame</b>.
+ * @param nrows The number of rows in the <b>full frame</b>.
+ * @param start_row The first row of the band to subtract the dark from.
+ * @param row_count The number of rows in the band.
+ * @param error_number The address of an integer, on failure set to the error number. As bands are processed by
+ *        different threads, errors are returned here rather than in Autoguider_General_Error_Number.
+ * @param error_string A string of AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH characters, on failure set to the
+ *        error message.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Autoguider_Dark_Subtract
+ * @see #Dark_Data
+ * @see autoguider.general.html#AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH
+ */
+int Autoguider_Dark_Subtract_Rows(float *buffer_ptr,int ncols,int nrows,int start_row,int row_count,
+				  int *error_number,char *error_string)
+{
+	float *current_buffer_ptr = NULL;
+	float *current_dark_ptr = NULL;
+	int i,pixel_count;
+
+	if((error_number == NULL)||(error_string == NULL))
+	{
+		Autoguider_General_Error_Number = 843;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Dark_Subtract_Rows:"
+			"error_number/error_string was NULL.");
+		return FALSE;
+	}
+	if(buffer_ptr == NULL)
+	{
+		(*error_number) = 828;
+		sprintf(error_string,"Autoguider_Dark_Subtract_Rows:buffer_ptr was NULL.");
+		return FALSE;
+	}
+	if((ncols != Dark_Data.Binned_NCols)||(nrows != Dark_Data.Binned_NRows))
+	{
+		(*error_number) = 829;
+		sprintf(error_string,"Autoguider_Dark_Subtract_Rows:"
+			"buffer dimension mismatch: (%d,%d) != dark (%d,%d).",ncols,nrows,
+			Dark_Data.Binned_NCols,Dark_Data.Binned_NRows);
+		return FALSE;
+	}
+	if((start_row < 0)||(row_count < 0)||((start_row+row_count) > nrows))
+	{
+		(*error_number) = 830;
+		sprintf(error_string,"Autoguider_Dark_Subtract_Rows:"
+			"Illegal band: start row %d, row count %d, nrows %d.",start_row,row_count,nrows);
+		return FALSE;
+	}
+	/* the buffer and dark rows are the same length, so the band is contiguous in both */
+	current_buffer_ptr = buffer_ptr+(start_row*ncols);
+	current_dark_ptr = Dark_Data.Current_Data+(start_row*ncols);
+	pixel_count = row_count*ncols;
+	for(i=0;i<pixel_count;i++)
+	{
+		current_buffer_ptr[i] -= current_dark_ptr[i];
+		/* no range checking is performed here. See Fault 1716 for details. */
+	}
+	return TRUE;
+}
+
 /**
  * Free the allocated buffers.
  * Locks/unlocks the associated mutex.
@@ -501,6 +665,18 @@ int Autoguider_Dark_Shutdown(void)
 	if(Dark_Data.Reduced_Data != NULL)
 		free(Dark_Data.Reduced_Data);
 	Dark_Data.Reduced_Data = NULL;
+	Dark_Data.Current_Data = NULL;
+	if(!Autoguider_Calibration_Cache_Unmap(&(Dark_Data.Calibration_Map)))
+	{
+		Autoguider_General_Error("dark","autoguider_dark.c","Autoguider_Dark_Shutdown",
+					 LOG_VERBOSITY_INTERMEDIATE,"DARK"); /* no need to fail */
+	}
+	/* dark model */
+	Dark_Model_Cache_Free();
+	if(Dark_Data.Cache_List != NULL)
+		free(Dark_Data.Cache_List);
+	Dark_Data.Cache_List = NULL;
+	Dark_Data.Cache_Count = 0;
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 	if(retval == FALSE)
@@ -517,12 +693,92 @@ int Autoguider_Dark_Shutdown(void)
 	return TRUE;
 }
 
+/**
+ * Mark the loaded dark as out of date, so the next call to Autoguider_Dark_Set reloads it from disc
+ * (through the calibration cache, which notices the FITS image has changed), even if the binning and
+ * exposure length are the same. Used after a new master dark has been written over the configured filename.
+ * Locks/unlocks the associated mutex.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Dark_Data
+ * @see #Autoguider_Dark_Set
+ * @see autoguider.general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider.general.html#Autoguider_General_Mutex_Unlock
+ */
+int Autoguider_Dark_Invalidate(void)
+{
+	int retval;
+
+	retval = Autoguider_General_Mutex_Lock(&(Dark_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	Dark_Data.Exposure_Length = -1;
+	retval = Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Copy a dark supplied by the caller into the reduced dark buffer, and use it for dark subtraction.
+ * The buffer must be the size set by Autoguider_Dark_Set_Dimension. The dark is marked out of date, so the next
+ * call to Autoguider_Dark_Set loads the configured dark over it. Used by test programs that have no dark
+ * FITS images. Locks/unlocks the associated mutex.
+ * @param data_ptr The dark data, Binned_NCols x Binned_NRows pixels.
+ * @param pixel_count The number of pixels in data_ptr.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Dark_Data
+ * @see #Autoguider_Dark_Set_Dimension
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Unmap
+ * @see autoguider.general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider.general.html#Autoguider_General_Mutex_Unlock
+ * @see autoguider.general.html#Autoguider_General_Error_Number
+ * @see autoguider.general.html#Autoguider_General_Error_String
+ */
+int Autoguider_Dark_Set_Data(float *data_ptr,int pixel_count)
+{
+	int retval;
+
+	if(data_ptr == NULL)
+	{
+		Autoguider_General_Error_Number = 841;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Dark_Set_Data:data_ptr was NULL.");
+		return FALSE;
+	}
+	retval = Autoguider_General_Mutex_Lock(&(Dark_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	if((Dark_Data.Reduced_Data == NULL)||(pixel_count != (Dark_Data.Binned_NCols*Dark_Data.Binned_NRows)))
+	{
+		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+		Autoguider_General_Error_Number = 842;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Dark_Set_Data:"
+			"pixel_count %d does not match dark dimensions (%d,%d).",pixel_count,
+			Dark_Data.Binned_NCols,Dark_Data.Binned_NRows);
+		return FALSE;
+	}
+	Dark_Data.Current_Data = Dark_Data.Reduced_Data;
+	if(!Autoguider_Calibration_Cache_Unmap(&(Dark_Data.Calibration_Map)))
+	{
+		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+		return FALSE;
+	}
+	memcpy(Dark_Data.Reduced_Data,data_ptr,pixel_count*sizeof(float));
+	Dark_Data.Exposure_Length = -1;
+	retval = Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	return TRUE;
+}
+
 /**
  * Change the passed in exposure length to the length nearest the parameter passed in.
+ * If the dark model is enabled, a dark can be synthesised for any exposure length, so the exposure length
+ * is only bounded by the minimum and maximum exposure lengths. The index of the nearest exposure length in the 
+ * exposure length list is still returned, so callers can step through the list.
  * @param exposure_length The address of an integer. The current exposure length is passed in,
  *       on successful return this is modified to be an exposure length equivalent to the nearest dark.
  * @param exposure_length_index The address of an integer. The index in the dark exposure_length_list
- *        of the returned nearest exposure length is returned. If NULL is passed in for this argument,
+ *        of the nearest exposure length is returned. If NULL is passed in for this argument,
  *        the index is not returned.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Dark_Data
@@ -568,7 +824,15 @@ int Autoguider_Dark_Get_Exposure_Length_Nearest(int *exposure_length,int *exposu
 				      "Nearest exposure length to %d was %d (index %d).",
 				      (*exposure_length),nearest_exposure_length,nearest_index);
 #endif
-	(*exposure_length) = nearest_exposure_length;
+	if(Dark_Data.Model_Enable)
+	{
+		if((*exposure_length) < Dark_Data.Min_Exposure_Length)
+			(*exposure_length) = Dark_Data.Min_Exposure_Length;
+		if((*exposure_length) > Dark_Data.Max_Exposure_Length)
+			(*exposure_length) = Dark_Data.Max_Exposure_Length;
+	}
+	else
+		(*exposure_length) = nearest_exposure_length;
 	if(exposure_length_index != NULL)
 		(*exposure_length_index) = nearest_index;
 #if AUTOGUIDER_DEBUG > 1
@@ -627,30 +891,44 @@ int Autoguider_Dark_Get_Exposure_Length_Count(void)
 	return Dark_Data.Exposure_Length_Count;
 }
 
+/**
+ * Get whether darks are synthesised from the dark model.
+ * @return The routine returns TRUE if darks are synthesised for any exposure length, and FALSE if
+ *         darks are only available for the exposure lengths in the exposure length list.
+ * @see #Dark_Data
+ */
+int Autoguider_Dark_Model_Is_Enabled(void)
+{
+	return Dark_Data.Model_Enable;
+}
+
 /* ----------------------------------------------------------------------------
 ** 		internal functions 
 ** ---------------------------------------------------------------------------- */
 /**
  * Load a dark from the filename. It is expected to be for the specified binning.
- * It is loaded into the Reduced_Data field, assuming the Reduced_Mutex is locked correctly.
- * The NAXIS1 / NAXIS2 keywords in the FITS image must agree with Dark_Data.Binned_NCols and Dark_Data.Binned_NRows
+ * If the calibration cache is enabled, and there is an up to date cache file for the dark, it is mapped
+ * using Autoguider_Calibration_Cache_Map and used directly. Otherwise the dark is 
+ * loaded into the Reduced_Data field using Dark_Load_Image, and a cache file is created using
+ * Autoguider_Calibration_Cache_Create for next time. The Reduced_Mutex is locked whilst this is done.
  * @param filename The filename of a FITS image containing the dark to load.
  * @param bin_x The expected X binning of the FITS image.
  * @param bin_y The expected Y binning of the FITS image.
  * @param exposure_length The expected exposure length of the image, in milliseconds.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Dark_Data
+ * @see #Dark_Load_Image
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Is_Enabled
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Map
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Unmap
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Create
  * @see autoguider.general.html#Autoguider_General_Mutex_Lock
  * @see autoguider.general.html#Autoguider_General_Mutex_Unlock
  * @see autoguider.general.html#Autoguider_General_Log
- * @see autoguider.general.html#Autoguider_General_Error_Number
- * @see autoguider.general.html#Autoguider_General_Error_String
  */
 static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_length)
 {
-	fitsfile *fits_fp = NULL;
-	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
-	int retval,naxis,naxis1,naxis2,cfitsio_status=0;
+	int retval,found;
 
 #if AUTOGUIDER_DEBUG > 5
 	Autoguider_General_Log("dark","autoguider_dark.c","Dark_Load_Reduced",
@@ -662,6 +940,78 @@ static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_len
 	retval = Autoguider_General_Mutex_Lock(&(Dark_Data.Reduced_Mutex));
 	if(retval == FALSE)
 		return FALSE;
+	/* release the previously mapped dark */
+	Dark_Data.Current_Data = Dark_Data.Reduced_Data;
+	if(!Autoguider_Calibration_Cache_Unmap(&(Dark_Data.Calibration_Map)))
+	{
+		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+		return FALSE;
+	}
+	found = FALSE;
+	if(Autoguider_Calibration_Cache_Is_Enabled())
+	{
+		if(!Autoguider_Calibration_Cache_Map(filename,AUTOGUIDER_CALIBRATION_CACHE_TYPE_DARK,
+				      Dark_Data.Binned_NCols,Dark_Data.Binned_NRows,bin_x,bin_y,exposure_length,
+						     &(Dark_Data.Calibration_Map),&found))
+		{
+			Autoguider_General_Error("dark","autoguider_dark.c","Dark_Load_Reduced",
+						 LOG_VERBOSITY_INTERMEDIATE,"DARK"); /* no need to fail */
+			found = FALSE;
+		}
+	}
+	if(found)
+		Dark_Data.Current_Data = Dark_Data.Calibration_Map.Data;
+	else
+	{
+		retval = Dark_Load_Image(filename,Dark_Data.Reduced_Data);
+		if(retval == FALSE)
+		{
+			Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+			return FALSE;
+		}
+		if(Autoguider_Calibration_Cache_Is_Enabled())
+		{
+			if(!Autoguider_Calibration_Cache_Create(filename,AUTOGUIDER_CALIBRATION_CACHE_TYPE_DARK,
+				      Dark_Data.Binned_NCols,Dark_Data.Binned_NRows,bin_x,bin_y,exposure_length,
+								Dark_Data.Reduced_Data))
+			{
+				Autoguider_General_Error("dark","autoguider_dark.c","Dark_Load_Reduced",
+							 LOG_VERBOSITY_INTERMEDIATE,"DARK"); /* no need to fail */
+			}
+		}
+	}
+	/* update current reduced dark meta-data */
+	Dark_Data.Bin_X = bin_x;
+	Dark_Data.Bin_Y = bin_y;
+	Dark_Data.Exposure_Length = exposure_length;
+	/* unlock mutex */
+	retval = Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log("dark","autoguider_dark.c","Dark_Load_Reduced",
+			       LOG_VERBOSITY_INTERMEDIATE,"DARK","finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Load a FITS image from the filename into a float buffer. The caller should have locked 
+ * the Reduced_Mutex if the buffer is one of Dark_Data's.
+ * The NAXIS1 / NAXIS2 keywords in the FITS image must agree with Dark_Data.Binned_NCols and Dark_Data.Binned_NRows
+ * @param filename The filename of a FITS image to load.
+ * @param data_ptr A buffer of at least Dark_Data.Binned_NCols x Dark_Data.Binned_NRows floats to load the image into.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Dark_Data
+ * @see autoguider.general.html#Autoguider_General_Error_Number
+ * @see autoguider.general.html#Autoguider_General_Error_String
+ */
+static int Dark_Load_Image(char *filename,float *data_ptr)
+{
+	fitsfile *fits_fp = NULL;
+	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
+	int retval,naxis,naxis1,naxis2,cfitsio_status=0;
+
 	/* initialise cfitsio status variable */
 	cfitsio_status=0;
 	/* open dark FITS file */
@@ -670,10 +1020,9 @@ static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_len
 	{
 		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
 		fits_report_error(stderr,cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 809;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
-			"fits_open_file failed(%d) : %s.",cfitsio_status,cfitsio_error_buff);
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
+			"fits_open_file(%s) failed(%d) : %s.",filename,cfitsio_status,cfitsio_error_buff);
 		return FALSE;
 	}
 	/* read and check NAXIS */
@@ -683,18 +1032,16 @@ static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_len
 		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
 		fits_report_error(stderr,cfitsio_status);
 		fits_close_file(fits_fp,&cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 810;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
 			"fits_read_key(NAXIS) failed(%d) : %s.",cfitsio_status,cfitsio_error_buff);
 		return FALSE;
 	}
 	if(naxis != 2)
 	{
 		fits_close_file(fits_fp,&cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 811;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
 			"Illegal value of NAXIS(%d).",naxis);
 		return FALSE;
 	}
@@ -705,9 +1052,8 @@ static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_len
 		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
 		fits_report_error(stderr,cfitsio_status);
 		fits_close_file(fits_fp,&cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 812;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
 			"fits_read_key(NAXIS1) failed(%d) : %s.",cfitsio_status,cfitsio_error_buff);
 		return FALSE;
 	}
@@ -717,9 +1063,8 @@ static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_len
 		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
 		fits_report_error(stderr,cfitsio_status);
 		fits_close_file(fits_fp,&cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 813;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
 			"fits_read_key(NAXIS2) failed(%d) : %s.",cfitsio_status,cfitsio_error_buff);
 		return FALSE;
 	}
@@ -727,9 +1072,8 @@ static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_len
 	if(naxis1 != Dark_Data.Binned_NCols)
 	{
 		fits_close_file(fits_fp,&cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 814;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
 			"naxis1 %d does not match expected binned ncols %d.",naxis1,Dark_Data.Binned_NCols);
 		return FALSE;
 	}
@@ -737,22 +1081,20 @@ static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_len
 	if(naxis2 != Dark_Data.Binned_NRows)
 	{
 		fits_close_file(fits_fp,&cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 815;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
 			"naxis2 %d does not match expected binned nrows %d.",naxis2,Dark_Data.Binned_NRows);
 		return FALSE;
 	}
-	/* read FITS image as FLOATS into the Dark_Data.Reduced_Data */
-	retval = fits_read_img(fits_fp,TFLOAT,1,naxis1*naxis2,NULL,Dark_Data.Reduced_Data,NULL,&cfitsio_status);
+	/* read FITS image as FLOATS into the data buffer */
+	retval = fits_read_img(fits_fp,TFLOAT,1,naxis1*naxis2,NULL,data_ptr,NULL,&cfitsio_status);
 	if(retval)
 	{
 		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
 		fits_report_error(stderr,cfitsio_status);
 		fits_close_file(fits_fp,&cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 816;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
 			"fits_read_img failed(%d) : %s.",cfitsio_status,cfitsio_error_buff);
 		return FALSE;
 	}
@@ -761,24 +1103,11 @@ static int Dark_Load_Reduced(char *filename,int bin_x,int bin_y,int exposure_len
 	{
 		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
 		fits_report_error(stderr,cfitsio_status);
-		Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
 		Autoguider_General_Error_Number = 817;
-		sprintf(Autoguider_General_Error_String,"Dark_Load_Reduced:"
+		sprintf(Autoguider_General_Error_String,"Dark_Load_Image:"
 			"fits_close_file failed(%d) : %s.",cfitsio_status,cfitsio_error_buff);
 		return FALSE;
 	}
-	/* update current reduced dark meta-data */
-	Dark_Data.Bin_X = bin_x;
-	Dark_Data.Bin_Y = bin_y;
-	Dark_Data.Exposure_Length = exposure_length;
-	/* unlock mutex */
-	retval = Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
-	if(retval == FALSE)
-		return FALSE;
-#if AUTOGUIDER_DEBUG > 5
-	Autoguider_General_Log("dark","autoguider_dark.c","Dark_Load_Reduced",
-			       LOG_VERBOSITY_INTERMEDIATE,"DARK","finished.");
-#endif
 	return TRUE;
 }
 
@@ -836,6 +1165,317 @@ static int Dark_Exposure_Length_List_Initialise(void)
 #endif
 	return TRUE;
 }
+
+/**
+ * Initialise the dark model. Loads the following config:
+ * <ul>
+ * <li>"dark.model.enable"
+ * </ul>
+ * and if the dark model is enabled:
+ * <ul>
+ * <li>"ccd.exposure.minimum"
+ * <li>"ccd.exposure.maximum"
+ * <li>"dark.model.cache.count"
+ * </ul>
+ * The cache list is then allocated. The bias and dark current frames are not loaded until Dark_Model_Set
+ * needs them.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Dark_Data
+ * @see #Dark_Model_Cache_Struct
+ * @see autoguider.general.html#Autoguider_General_Error_Number
+ * @see autoguider.general.html#Autoguider_General_Error_String
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Boolean
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ */
+static int Dark_Model_Initialise(void)
+{
+	int i,retval;
+
+	retval = CCD_Config_Get_Boolean("dark.model.enable",&(Dark_Data.Model_Enable));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 831;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Initialise:Getting dark model enable failed.");
+		return FALSE;
+	}
+	if(Dark_Data.Model_Enable == FALSE)
+		return TRUE;
+	retval = CCD_Config_Get_Integer("ccd.exposure.minimum",&(Dark_Data.Min_Exposure_Length));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 832;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Initialise:Getting minimum exposure length failed.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("ccd.exposure.maximum",&(Dark_Data.Max_Exposure_Length));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 833;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Initialise:Getting maximum exposure length failed.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("dark.model.cache.count",&(Dark_Data.Cache_Count));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 834;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Initialise:Getting dark model cache count failed.");
+		return FALSE;
+	}
+	if(Dark_Data.Cache_Count < 1)
+	{
+		Autoguider_General_Error_Number = 835;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Initialise:Illegal dark model cache count %d.",
+			Dark_Data.Cache_Count);
+		Dark_Data.Cache_Count = 0;
+		return FALSE;
+	}
+	Dark_Data.Cache_List = (struct Dark_Model_Cache_Struct *)calloc(Dark_Data.Cache_Count,
+								sizeof(struct Dark_Model_Cache_Struct));
+	if(Dark_Data.Cache_List == NULL)
+	{
+		Autoguider_General_Error_Number = 836;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Initialise:"
+			"Failed to allocate dark model cache list of %d entries.",Dark_Data.Cache_Count);
+		Dark_Data.Cache_Count = 0;
+		return FALSE;
+	}
+	for(i=0;i<Dark_Data.Cache_Count;i++)
+	{
+		Dark_Data.Cache_List[i].Exposure_Length = -1;
+		Dark_Data.Cache_List[i].Data = NULL;
+	}
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("dark","autoguider_dark.c","Dark_Model_Initialise",
+				      LOG_VERBOSITY_INTERMEDIATE,"DARK",
+				      "Dark model enabled:exposure length %d..%d ms, cache count %d.",
+				      Dark_Data.Min_Exposure_Length,Dark_Data.Max_Exposure_Length,Dark_Data.Cache_Count);
+#endif
+	return TRUE;
+}
+
+/**
+ * Make the current dark one synthesised from the dark model.
+ * <ul>
+ * <li>The Reduced_Mutex is locked.
+ * <li>If a dark with the binning and exposure length is in the cache, it is used.
+ * <li>Otherwise the least recently used (or an unused) cache entry is chosen. Dark_Model_Load is called to 
+ *     load the bias and dark current frames for the binning, if they are not already loaded. The dark is
+ *     synthesised into the cache entry using Dark_Model_Synthesise.
+ * <li>Current_Data is set to the cache entry's data, and the current dark meta-data updated.
+ * <li>The Reduced_Mutex is unlocked.
+ * </ul>
+ * @param bin_x The X binning factor.
+ * @param bin_y The Y binning factor.
+ * @param exposure_length The exposure length in milliseconds.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Dark_Data
+ * @see #Dark_Model_Load
+ * @see #Dark_Model_Synthesise
+ * @see autoguider.general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider.general.html#Autoguider_General_Mutex_Unlock
+ * @see autoguider.general.html#Autoguider_General_Error_Number
+ * @see autoguider.general.html#Autoguider_General_Error_String
+ */
+static int Dark_Model_Set(int bin_x,int bin_y,int exposure_length)
+{
+	struct Dark_Model_Cache_Struct *cache_entry = NULL;
+	int i,retval;
+
+	retval = Autoguider_General_Mutex_Lock(&(Dark_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	/* look for this dark in the cache */
+	for(i=0;i<Dark_Data.Cache_Count;i++)
+	{
+		if((Dark_Data.Cache_List[i].Data != NULL)&&(Dark_Data.Cache_List[i].Bin_X == bin_x)&&
+		   (Dark_Data.Cache_List[i].Bin_Y == bin_y)&&
+		   (Dark_Data.Cache_List[i].Exposure_Length == exposure_length))
+		{
+			cache_entry = &(Dark_Data.Cache_List[i]);
+			break;
+		}
+	}
+	if(cache_entry == NULL)
+	{
+		/* use an unused or the least recently used entry */
+		cache_entry = &(Dark_Data.Cache_List[0]);
+		for(i=1;i<Dark_Data.Cache_Count;i++)
+		{
+			if(cache_entry->Data == NULL)
+				break;
+			if((Dark_Data.Cache_List[i].Data == NULL)||
+			   (Dark_Data.Cache_List[i].Last_Used < cache_entry->Last_Used))
+				cache_entry = &(Dark_Data.Cache_List[i]);
+		}
+		/* invalidate the entry, in case we fail part way through */
+		cache_entry->Exposure_Length = -1;
+		if(cache_entry->Data == NULL)
+		{
+			cache_entry->Data = (float *)malloc(Dark_Data.Binned_NCols*Dark_Data.Binned_NRows*
+							    sizeof(float));
+			if(cache_entry->Data == NULL)
+			{
+				Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+				Autoguider_General_Error_Number = 837;
+				sprintf(Autoguider_General_Error_String,"Dark_Model_Set:"
+					"Failed to allocate synthesised dark (%d,%d).",Dark_Data.Binned_NCols,
+					Dark_Data.Binned_NRows);
+				return FALSE;
+			}
+		}
+		if((bin_x != Dark_Data.Model_Bin_X)||(bin_y != Dark_Data.Model_Bin_Y))
+		{
+			retval = Dark_Model_Load(bin_x,bin_y);
+			if(retval == FALSE)
+			{
+				Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+				return FALSE;
+			}
+		}
+		Dark_Model_Synthesise(cache_entry->Data,Dark_Data.Bias_Data,Dark_Data.Rate_Data,
+				      ((float)exposure_length)/1000.0f,Dark_Data.Binned_NCols*Dark_Data.Binned_NRows);
+		cache_entry->Bin_X = bin_x;
+		cache_entry->Bin_Y = bin_y;
+		cache_entry->Exposure_Length = exposure_length;
+#if AUTOGUIDER_DEBUG > 5
+		Autoguider_General_Log_Format("dark","autoguider_dark.c","Dark_Model_Set",
+					      LOG_VERBOSITY_INTERMEDIATE,"DARK",
+					      "Synthesised dark for %d,%d,%d ms.",bin_x,bin_y,exposure_length);
+#endif
+	}
+	Dark_Data.Cache_Clock++;
+	cache_entry->Last_Used = Dark_Data.Cache_Clock;
+	/* update current dark meta-data */
+	Dark_Data.Current_Data = cache_entry->Data;
+	Dark_Data.Bin_X = bin_x;
+	Dark_Data.Bin_Y = bin_y;
+	Dark_Data.Exposure_Length = exposure_length;
+	retval = Autoguider_General_Mutex_Unlock(&(Dark_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Load the bias and dark current frames of the dark model for the specified binning, using
+ * the "dark.model.bias.filename.<bin_x>.<bin_y>" and "dark.model.rate.filename.<bin_x>.<bin_y>" config.
+ * The dark current frame is in counts per second.
+ * The Reduced_Mutex should have been locked before calling this routine.
+ * @param bin_x The X binning factor.
+ * @param bin_y The Y binning factor.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Dark_Data
+ * @see #Dark_Load_Image
+ * @see autoguider.general.html#Autoguider_General_Error_Number
+ * @see autoguider.general.html#Autoguider_General_Error_String
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
+ */
+static int Dark_Model_Load(int bin_x,int bin_y)
+{
+	char keyword_string[64];
+	char *filename_string = NULL;
+	int retval;
+
+	/* invalidate the loaded model, in case we fail part way through */
+	Dark_Data.Model_Bin_X = -1;
+	Dark_Data.Model_Bin_Y = -1;
+	if(Dark_Data.Bias_Data == NULL)
+		Dark_Data.Bias_Data = (float *)malloc(Dark_Data.Binned_NCols*Dark_Data.Binned_NRows*sizeof(float));
+	if(Dark_Data.Rate_Data == NULL)
+		Dark_Data.Rate_Data = (float *)malloc(Dark_Data.Binned_NCols*Dark_Data.Binned_NRows*sizeof(float));
+	if((Dark_Data.Bias_Data == NULL)||(Dark_Data.Rate_Data == NULL))
+	{
+		Autoguider_General_Error_Number = 838;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Load:"
+			"Failed to allocate dark model frames (%d,%d).",Dark_Data.Binned_NCols,Dark_Data.Binned_NRows);
+		return FALSE;
+	}
+	/* bias */
+	sprintf(keyword_string,"dark.model.bias.filename.%d.%d",bin_x,bin_y);
+	retval = CCD_Config_Get_String(keyword_string,&filename_string);
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 839;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Load:"
+			"No bias configured for %d,%d (%s).",bin_x,bin_y,keyword_string);
+		return FALSE;
+	}
+	retval = Dark_Load_Image(filename_string,Dark_Data.Bias_Data);
+	if(filename_string != NULL)
+		free(filename_string);
+	filename_string = NULL;
+	if(retval == FALSE)
+		return FALSE;
+	/* dark current */
+	sprintf(keyword_string,"dark.model.rate.filename.%d.%d",bin_x,bin_y);
+	retval = CCD_Config_Get_String(keyword_string,&filename_string);
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 840;
+		sprintf(Autoguider_General_Error_String,"Dark_Model_Load:"
+			"No dark current configured for %d,%d (%s).",bin_x,bin_y,keyword_string);
+		return FALSE;
+	}
+	retval = Dark_Load_Image(filename_string,Dark_Data.Rate_Data);
+	if(filename_string != NULL)
+		free(filename_string);
+	if(retval == FALSE)
+		return FALSE;
+	Dark_Data.Model_Bin_X = bin_x;
+	Dark_Data.Model_Bin_Y = bin_y;
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("dark","autoguider_dark.c","Dark_Model_Load",
+				      LOG_VERBOSITY_INTERMEDIATE,"DARK","Loaded dark model for %d,%d.",bin_x,bin_y);
+#endif
+	return TRUE;
+}
+
+/**
+ * Synthesise a dark from the dark model: dark = bias + (dark current * exposure length).
+ * The loop is a single pass over three contiguous arrays with no branches, so the compiler can vectorise it.
+ * @param dark_ptr The buffer to put the synthesised dark into, of pixel_count floats.
+ * @param bias_ptr The bias frame, of pixel_count floats.
+ * @param rate_ptr The dark current frame in counts per second, of pixel_count floats.
+ * @param exposure_seconds The exposure length to synthesise the dark for, in seconds.
+ * @param pixel_count The number of pixels in each frame.
+ */
+static void Dark_Model_Synthesise(float *dark_ptr,float *bias_ptr,float *rate_ptr,float exposure_seconds,
+				  int pixel_count)
+{
+	int i;
+
+	for(i=0;i<pixel_count;i++)
+		dark_ptr[i] = bias_ptr[i]+(rate_ptr[i]*exposure_seconds);
+}
+
+/**
+ * Free the loaded dark model frames, and the synthesised darks in the cache. The cache list itself is
+ * not freed. If the current dark was a synthesised one, Current_Data is reset to Reduced_Data.
+ * The Reduced_Mutex should have been locked before calling this routine.
+ * @see #Dark_Data
+ */
+static void Dark_Model_Cache_Free(void)
+{
+	int i;
+
+	for(i=0;i<Dark_Data.Cache_Count;i++)
+	{
+		if(Dark_Data.Cache_List[i].Data == Dark_Data.Current_Data)
+			Dark_Data.Current_Data = Dark_Data.Reduced_Data;
+		if(Dark_Data.Cache_List[i].Data != NULL)
+			free(Dark_Data.Cache_List[i].Data);
+		Dark_Data.Cache_List[i].Data = NULL;
+		Dark_Data.Cache_List[i].Exposure_Length = -1;
+	}
+	if(Dark_Data.Bias_Data != NULL)
+		free(Dark_Data.Bias_Data);
+	Dark_Data.Bias_Data = NULL;
+	if(Dark_Data.Rate_Data != NULL)
+		free(Dark_Data.Rate_Data);
+	Dark_Data.Rate_Data = NULL;
+	Dark_Data.Model_Bin_X = -1;
+	Dark_Data.Model_Bin_Y = -1;
+}
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.4  2010/08/13 08:49:33  cjm
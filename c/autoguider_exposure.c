@@ -0,0 +1,272 @@
+/* autoguider_exposure.c
+** Autoguider exposure length prediction routines
+** $Header$
+*/
+/**
+ * Exposure length prediction routines for the autoguider program.
+ * A simple flux model is used: the object counts and background (median) are assumed to scale linearly with
+ * exposure length. From the counts in the last frame we estimate the count rate, and jump straight to the
+ * (available dark) exposure length that gives the target counts, rather than stepping along the dark exposure
+ * length list one frame at a time. Hysteresis stops the exposure length oscillating between two darks either
+ * side of the target.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+#include "ccd_setup.h"
+
+#include "autoguider_dark.h"
+#include "autoguider_exposure.h"
+#include "autoguider_general.h"
+
+/* data types */
+/**
+ * Data type holding local data to autoguider_exposure. This consists of the following:
+ * <dl>
+ * <dt>Min_Exposure_Length</dt> <dd>The minimum exposure length a prediction can return, in milliseconds
+ *     (ccd.exposure.minimum).</dd>
+ * <dt>Max_Exposure_Length</dt> <dd>The maximum exposure length a prediction can return, in milliseconds
+ *     (ccd.exposure.maximum).</dd>
+ * <dt>Hysteresis</dt> <dd>The fractional band around the target counts within which the exposure length is
+ *     not changed (exposure.model.hysteresis). i.e. counts between target/(1+hysteresis) and
+ *     target*(1+hysteresis) are accepted.</dd>
+ * <dt>Saturation_Counts</dt> <dd>The predicted peak plus background counts are kept below this
+ *     value (exposure.model.saturation).</dd>
+ * </dl>
+ */
+struct Exposure_Struct
+{
+	int Min_Exposure_Length;
+	int Max_Exposure_Length;
+	float Hysteresis;
+	float Saturation_Counts;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of exposure prediction data.
+ * @see #Exposure_Struct
+ */
+static struct Exposure_Struct Exposure_Data =
+{
+	0,0,0.0f,0.0f
+};
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Exposure prediction initialisation routine. Loads the following config:
+ * <ul>
+ * <li>"ccd.exposure.minimum"
+ * <li>"ccd.exposure.maximum"
+ * <li>"exposure.model.hysteresis"
+ * <li>"exposure.model.saturation"
+ * </ul>
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Exposure_Data
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Float
+ */
+int Autoguider_Exposure_Initialise(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("exposure","autoguider_exposure.c","Autoguider_Exposure_Initialise",
+			       LOG_VERBOSITY_TERSE,"EXPOSURE","started.");
+#endif
+	retval = CCD_Config_Get_Integer("ccd.exposure.minimum",&(Exposure_Data.Min_Exposure_Length));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1600;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Exposure_Initialise:"
+			"Getting minimum exposure length failed.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("ccd.exposure.maximum",&(Exposure_Data.Max_Exposure_Length));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1601;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Exposure_Initialise:"
+			"Getting maximum exposure length failed.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Float("exposure.model.hysteresis",&(Exposure_Data.Hysteresis));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1602;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Exposure_Initialise:"
+			"Getting exposure model hysteresis failed.");
+		return FALSE;
+	}
+	if(Exposure_Data.Hysteresis < 0.0f)
+	{
+		Autoguider_General_Error_Number = 1603;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Exposure_Initialise:"
+			"Illegal exposure model hysteresis %.2f.",Exposure_Data.Hysteresis);
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Float("exposure.model.saturation",&(Exposure_Data.Saturation_Counts));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1604;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Exposure_Initialise:"
+			"Getting exposure model saturation counts failed.");
+		return FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("exposure","autoguider_exposure.c","Autoguider_Exposure_Initialise",
+				      LOG_VERBOSITY_TERSE,"EXPOSURE",
+				      "finished:min = %d ms, max = %d ms, hysteresis = %.2f, saturation = %.2f.",
+				      Exposure_Data.Min_Exposure_Length,Exposure_Data.Max_Exposure_Length,
+				      Exposure_Data.Hysteresis,Exposure_Data.Saturation_Counts);
+#endif
+	return TRUE;
+}
+
+/**
+ * Predict the exposure length that will give the target counts in an object.
+ * <ul>
+ * <li>If the counts are within the hysteresis band around the target counts, the exposure length is not changed.
+ * <li>The count rate is estimated as counts/exposure_length, and the exposure length that gives target_counts
+ *     is computed.
+ * <li>If the predicted peak plus background counts would exceed the saturation counts, the exposure length is
+ *     reduced so they don't.
+ * <li>The exposure length is bounded by the minimum and maximum exposure lengths, and rounded to the
+ *     nearest dark using Autoguider_Dark_Get_Exposure_Length_Nearest. If that is predicted to saturate,
+ *     the next shortest dark is used. If the dark model is enabled (Autoguider_Dark_Model_Is_Enabled), 
+ *     a dark is synthesised for any exposure length, so no rounding is done.
+ * <li>The new exposure length is only used if it is a different dark (or a different exposure length 
+ *     if the dark model is enabled), and the counts predicted at the new
+ *     exposure length are nearer the target (by ratio) than the current counts.
+ *     This stops the exposure length oscillating when no dark gives counts within the hysteresis band.
+ * </ul>
+ * @param exposure_length The exposure length the counts were measured with, in milliseconds.
+ * @param peak_counts The object peak counts, above the background.
+ * @param counts The object counts to scale, either the peak counts or the integrated counts.
+ * @param background The background (median) counts of the frame.
+ * @param target_counts The counts wanted.
+ * @param new_exposure_length The address of an integer. On a successful return, the exposure length to use
+ *        next, in milliseconds. This is exposure_length if changed is FALSE.
+ * @param changed The address of an integer. On a successful return, set to TRUE if new_exposure_length should
+ *        be used, or FALSE if the exposure length should be left alone.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Exposure_Data
+ * @see autoguider_dark.html#Autoguider_Dark_Get_Exposure_Length_Nearest
+ * @see autoguider_dark.html#Autoguider_Dark_Get_Exposure_Length_Index
+ * @see autoguider_dark.html#Autoguider_Dark_Model_Is_Enabled
+ */
+int Autoguider_Exposure_Predict(int exposure_length,float peak_counts,float counts,float background,
+				float target_counts,int *new_exposure_length,int *changed)
+{
+	double count_rate,level_rate,predicted_exposure_length,predicted_counts;
+	int predicted_length,predicted_index,current_index,current_length;
+
+	if(new_exposure_length == NULL)
+	{
+		Autoguider_General_Error_Number = 1605;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Exposure_Predict:new_exposure_length was NULL.");
+		return FALSE;
+	}
+	if(changed == NULL)
+	{
+		Autoguider_General_Error_Number = 1606;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Exposure_Predict:changed was NULL.");
+		return FALSE;
+	}
+	(*new_exposure_length) = exposure_length;
+	(*changed) = FALSE;
+	if((exposure_length <= 0)||(counts <= 0.0f)||(target_counts <= 0.0f))
+	{
+		Autoguider_General_Error_Number = 1607;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Exposure_Predict:"
+			"Illegal arguments (exposure length %d ms, counts %.2f, target counts %.2f).",
+			exposure_length,counts,target_counts);
+		return FALSE;
+	}
+	/* within hysteresis band, leave the exposure length alone */
+	if((counts >= (target_counts/(1.0f+Exposure_Data.Hysteresis)))&&
+	   (counts <= (target_counts*(1.0f+Exposure_Data.Hysteresis))))
+	{
+#if AUTOGUIDER_DEBUG > 5
+		Autoguider_General_Log_Format("exposure","autoguider_exposure.c","Autoguider_Exposure_Predict",
+					      LOG_VERBOSITY_VERBOSE,"EXPOSURE",
+					      "Counts %.2f within hysteresis of target %.2f:no change.",
+					      counts,target_counts);
+#endif
+		return TRUE;
+	}
+	/* counts per millisecond */
+	count_rate = ((double)counts)/((double)exposure_length);
+	predicted_exposure_length = ((double)target_counts)/count_rate;
+	/* keep predicted peak + background below saturation */
+	if(background < 0.0f)
+		background = 0.0f;
+	level_rate = ((double)(peak_counts+background))/((double)exposure_length);
+	if((Exposure_Data.Saturation_Counts > 0.0f)&&(level_rate > 0.0)&&
+	   ((level_rate*predicted_exposure_length) > Exposure_Data.Saturation_Counts))
+		predicted_exposure_length = ((double)Exposure_Data.Saturation_Counts)/level_rate;
+	if(predicted_exposure_length < Exposure_Data.Min_Exposure_Length)
+		predicted_exposure_length = Exposure_Data.Min_Exposure_Length;
+	if(predicted_exposure_length > Exposure_Data.Max_Exposure_Length)
+		predicted_exposure_length = Exposure_Data.Max_Exposure_Length;
+	/* round to nearest available dark */
+	predicted_length = (int)predicted_exposure_length;
+	if(!Autoguider_Dark_Get_Exposure_Length_Nearest(&predicted_length,&predicted_index))
+		return FALSE;
+	if((Autoguider_Dark_Model_Is_Enabled() == FALSE)&&(Exposure_Data.Saturation_Counts > 0.0f)&&
+	   (predicted_index > 0)&&((level_rate*predicted_length) > Exposure_Data.Saturation_Counts))
+	{
+		predicted_index--;
+		if(!Autoguider_Dark_Get_Exposure_Length_Index(predicted_index,&predicted_length))
+			return FALSE;
+	}
+	current_length = exposure_length;
+	if(!Autoguider_Dark_Get_Exposure_Length_Nearest(&current_length,&current_index))
+		return FALSE;
+	predicted_counts = count_rate*((double)predicted_length);
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("exposure","autoguider_exposure.c","Autoguider_Exposure_Predict",
+				      LOG_VERBOSITY_VERBOSE,"EXPOSURE",
+				      "Counts %.2f in %d ms, target %.2f:predicted %.2f ms, nearest dark %d ms "
+				      "(index %d) giving %.2f counts.",counts,exposure_length,target_counts,
+				      predicted_exposure_length,predicted_length,predicted_index,predicted_counts);
+#endif
+	if(Autoguider_Dark_Model_Is_Enabled())
+	{
+		if(predicted_length == current_length)
+			return TRUE;
+	}
+	else if(predicted_index == current_index)
+		return TRUE;
+	if(fabs(log(predicted_counts/((double)target_counts))) >= fabs(log(((double)counts)/((double)target_counts))))
+		return TRUE;
+	(*new_exposure_length) = predicted_length;
+	(*changed) = TRUE;
+	return TRUE;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
@@ -17,8 +17,10 @@
 #define _POSIX_C_SOURCE 199309L
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
@@ -35,14 +37,36 @@
 #include "ngatcil_ags_sdb.h"
 
 #include "autoguider_buffer.h"
+#include "autoguider_calibrate.h"
 #include "autoguider_cil.h"
 #include "autoguider_dark.h"
+#include "autoguider_exposure.h"
 #include "autoguider_field.h"
+#include "autoguider_fits_header.h"
+#include "autoguider_fits_writer.h"
 #include "autoguider_flat.h"
 #include "autoguider_general.h"
 #include "autoguider_get_fits.h"
 #include "autoguider_guide.h"
+#include "autoguider_housekeeping.h"
 #include "autoguider_object.h"
+#include "autoguider_worker_pool.h"
+
+/* hash defines */
+/**
+ * The number of rows of a band processed at a time by Field_Reduce_Band, so the raw, reduced, dark and
+ * flat rows being worked on stay in cache between the conversion, dark subtraction and flat fielding steps.
+ */
+#define FIELD_REDUCE_CHUNK_ROWS         (16)
+/**
+ * The peak counts at or above which Field_Check_Done considers an object saturated.
+ */
+#define FIELD_OBJECT_PEAK_COUNTS_MAX    (40000)
+/**
+ * The time Field_Pipeline_Cancel waits between CCD_Exposure_Abort calls, until the speculative exposure
+ * thread has finished, in milliseconds.
+ */
+#define FIELD_PIPELINE_ABORT_PAUSE_MS   (10)
 
 /* data types */
 /**
@@ -100,6 +124,19 @@ struct Field_Bounds_Struct
  *     image (i.e. one that appears to have a guide star on it).</dd>
  * <dt>Save_FITS_Failed</dt> <dd>Boolean determining whether to save a FITS image of a failed field
  *     image (i.e. one that does <b>not</b> appear to have a guide star on it).</dd>
+ * <dt>Reduce_Thread_Count</dt> <dd>The number of threads used to convert, dark subtract and flat field
+ *     a field image, and the number of tiles it is object detected in (field.reduce.thread_count). 
+ *     1 means do it serially in the calling thread.</dd>
+ * <dt>Pipeline_Enable</dt> <dd>Boolean determining whether to start the next (predicted) field exposure
+ *     whilst the current one is being reduced (field.pipeline.enable).</dd>
+ * <dt>Trend_Exposure_Length</dt> <dd>The exposure length of the last checked field frame, or -1.</dd>
+ * <dt>Trend_Object_Count</dt> <dd>The number of objects detected in the last checked field frame, or -1.</dd>
+ * <dt>Trend_Peak_Counts</dt> <dd>The largest object peak counts in the last checked field frame.</dd>
+ * <dt>Trend_Unsaturated_Peak_Counts</dt> <dd>The largest object peak counts below FIELD_OBJECT_PEAK_COUNTS_MAX
+ *     in the last checked field frame, or 0 if there were none.</dd>
+ * <dt>Exposure_Model</dt> <dd>Boolean determining whether Field_Check_Done uses the flux model to choose the
+ *     next exposure length, rather than doubling/halving it (field.exposure_length.model).</dd>
+ * <dt>Target_Peak_Counts</dt> <dd>The object peak counts the flux model aims for (field.counts.target.peak).</dd>
  * </dl>
  * @see #Field_Bounds_Struct
  */
@@ -124,6 +161,73 @@ struct Field_Struct
 	struct Field_Bounds_Struct Bounds;
 	int Save_FITS_Successful;
 	int Save_FITS_Failed;
+	int Reduce_Thread_Count;
+	int Pipeline_Enable;
+	int Trend_Exposure_Length;
+	int Trend_Object_Count;
+	float Trend_Peak_Counts;
+	float Trend_Unsaturated_Peak_Counts;
+	int Exposure_Model;
+	int Target_Peak_Counts;
+};
+
+/**
+ * Data type holding the data for one band of rows of a field image, reduced by Field_Reduce_Band.
+ * <dl>
+ * <dt>Raw_Buffer_Ptr</dt> <dd>The full frame raw buffer.</dd>
+ * <dt>Reduced_Buffer_Ptr</dt> <dd>The full frame reduced buffer.</dd>
+ * <dt>Start_Row</dt> <dd>The first row in the band.</dd>
+ * <dt>Row_Count</dt> <dd>The number of rows in the band.</dd>
+ * <dt>Flat_Zero_Count</dt> <dd>The number of pixels in the band where the flat was zero.</dd>
+ * <dt>Retval</dt> <dd>The return value of reducing this band, TRUE on success and FALSE on failure.</dd>
+ * <dt>Error_Number</dt> <dd>The error number if reducing this band failed. The bands are reduced in parallel,
+ *     so each has its own error, copied to Autoguider_General_Error_Number after all the bands are done.</dd>
+ * <dt>Error_String</dt> <dd>The error string if reducing this band failed.</dd>
+ * </dl>
+ * @see #Field_Reduce_Band
+ */
+struct Field_Reduce_Band_Struct
+{
+	unsigned short *Raw_Buffer_Ptr;
+	float *Reduced_Buffer_Ptr;
+	int Start_Row;
+	int Row_Count;
+	int Flat_Zero_Count;
+	int Retval;
+	int Error_Number;
+	char Error_String[AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH];
+};
+
+/**
+ * Data type holding the state of a speculative field exposure, started by Field_Pipeline_Start whilst the
+ * previous frame is being reduced.
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex protecting Cancel, Exposure_Started and Is_Finished.</dd>
+ * <dt>Thread</dt> <dd>The thread doing the exposure.</dd>
+ * <dt>Is_Running</dt> <dd>Boolean, TRUE if Thread has been created and not yet joined.</dd>
+ * <dt>Buffer_Index</dt> <dd>The field buffer index the exposure is read out into.</dd>
+ * <dt>Exposure_Length</dt> <dd>The predicted exposure length in milliseconds.</dd>
+ * <dt>Dark_Exposure_Length_Index</dt> <dd>The index of Exposure_Length in the dark exposure list.</dd>
+ * <dt>Cancel</dt> <dd>Boolean, set when the exposure is no longer wanted.</dd>
+ * <dt>Exposure_Started</dt> <dd>Boolean, set by Thread just before it calls Field_Expose_Buffer.</dd>
+ * <dt>Is_Finished</dt> <dd>Boolean, set by Thread when Field_Expose_Buffer has returned.</dd>
+ * <dt>Retval</dt> <dd>The return value of Field_Expose_Buffer in Thread.</dd>
+ * </dl>
+ * @see #Field_Pipeline_Start
+ * @see #Field_Pipeline_Thread
+ */
+struct Field_Pipeline_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_t Thread;
+	int Is_Running;
+	int Buffer_Index;
+	int Exposure_Length;
+	int Dark_Exposure_Length_Index;
+	int Cancel;
+	int Exposure_Started;
+	int Is_Finished;
+	int Retval;
 };
 
 /* internal data */
@@ -143,7 +247,18 @@ static struct Field_Struct Field_Data =
 	TRUE,TRUE,TRUE,
 	0,0,
 	{{0,0},{0,0}},
-	FALSE,FALSE
+	FALSE,FALSE,
+	1,FALSE,
+	-1,-1,0.0f,0.0f,
+	FALSE,0
+};
+/**
+ * Instance of the speculative field exposure data.
+ * @see #Field_Pipeline_Struct
+ */
+static struct Field_Pipeline_Struct Field_Pipeline_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER
 };
 
 /* internal functions */
@@ -151,15 +266,27 @@ static int Field_Set_Dimensions(void);
 static void Field_Save_Raw_Image(unsigned short *image_data, int ncols, int nrows, int exposure_length,
 				 double current_temperature,struct timespec start_time); 
 static int Field_Reduce(int buffer_index);
+static int Field_Reduce_Parallel(int buffer_index);
+static void Field_Reduce_Band(void *user_arg);
 static int Field_Check_Done(int *done,int *dark_exposure_length_index);
+static int Field_Expose_Buffer(int buffer_index,int exposure_length);
+static void Field_Pipeline_Start(int buffer_index);
+static void *Field_Pipeline_Thread(void *user_arg);
+static int Field_Pipeline_Join(void);
+static void Field_Pipeline_Cancel(void);
+static void Field_Trend_Update(int exposure_length);
+static int Field_Exposure_Length_Next(float peak_counts,int increase);
+static int Field_Exposure_Length_Predict(int exposure_length,float peak_counts,int increase,int *new_exposure_length);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
 ** ---------------------------------------------------------------------------- */
 /**
  * Field initialisation routine. Loads default values from properties file.
+ * If "field.reduce.thread_count" is more than one, the worker pool is initialised with the extra threads.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Field_Data
+ * @see autoguider_worker_pool.html#Autoguider_Worker_Pool_Initialise
  */
 int Autoguider_Field_Initialise(void)
 {
@@ -244,6 +371,52 @@ int Autoguider_Field_Initialise(void)
 			"Getting whether to save failed field FITS images boolean failed.");
 		return FALSE;
 	}
+	/* get the number of threads to reduce field images with */
+	retval = CCD_Config_Get_Integer("field.reduce.thread_count",&(Field_Data.Reduce_Thread_Count));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 540;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Initialise:"
+			"Getting field reduction thread count failed.");
+		return FALSE;
+	}
+	if(Field_Data.Reduce_Thread_Count < 1)
+	{
+		Autoguider_General_Error_Number = 541;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Initialise:"
+			"Illegal field reduction thread count %d.",Field_Data.Reduce_Thread_Count);
+		return FALSE;
+	}
+	/* create the worker threads used to reduce and object detect field images, the thread calling
+	** Field_Reduce makes up the count */
+	if(!Autoguider_Worker_Pool_Initialise(Field_Data.Reduce_Thread_Count-1))
+		return FALSE;
+	/* get whether to expose the next field frame whilst reducing the current one */
+	retval = CCD_Config_Get_Boolean("field.pipeline.enable",&(Field_Data.Pipeline_Enable));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 545;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Initialise:"
+			"Getting field pipeline enable boolean failed.");
+		return FALSE;
+	}
+	/* get flux model exposure length config */
+	retval = CCD_Config_Get_Boolean("field.exposure_length.model",&(Field_Data.Exposure_Model));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 548;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Initialise:"
+			"Getting field exposure length model boolean failed.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("field.counts.target.peak",&(Field_Data.Target_Peak_Counts));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 549;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Initialise:"
+			"Getting field target peak counts failed.");
+		return FALSE;
+	}
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("field","autoguider_field.c","Autoguider_Field_Initialise",LOG_VERBOSITY_TERSE,
 			       "FIELD","Autoguider_Field_Initialise:finished.");
@@ -295,13 +468,17 @@ int Autoguider_Field_Exposure_Length_Set(int exposure_length,int lock)
  *     <ul>
  *     <li>Call Autoguider_Dark_Set to setup the correct dark filename for current exposure length.
  *     <li>Set the In_Use_Buffer_Index to be <b>not</b> the Last_Buffer_Index.
- *     <li>Lock the raw field buffer using Autoguider_Buffer_Raw_Field_Lock.
- *     <li>Call CCD_Exposure_Expose to do the exposure.
- *     <li>Unlock the raw field buffer using Autoguider_Buffer_Raw_Field_Unlock.
+ *     <li>If a speculative exposure was started last time round the loop, wait for it using
+ *         Field_Pipeline_Join, otherwise call Field_Expose_Buffer to do the exposure into In_Use_Buffer_Index.
+ *     <li>If pipelining is enabled, and the exposure length can change, call Field_Pipeline_Start to start
+ *         exposing the predicted next exposure length into the other buffer.
  *     <li>Call Field_Reduce on the In_Use_Buffer_Index to reduce the raw data.
  *     <li>Set Last_Buffer_Index to be In_Use_Buffer_Index and switch off In_Use_Buffer_Index.
  *     <li>Call Field_Check_Done to see if we have objects to guide on, this mofies the exposure length and will
  *         quit the field loop if appropriate.
+ *     <li>If we are done, or the speculative exposure length is not the new exposure length, call
+ *         Field_Pipeline_Cancel to abort it.
+ *     <li>Call Field_Trend_Update to save the peak counts of this frame for the next prediction.
  *     </ul>
  * <li>Switch off the Is_Fielding flag.
  * </ul>
@@ -310,6 +487,11 @@ int Autoguider_Field_Exposure_Length_Set(int exposure_length,int lock)
  * @see #Field_Reduce
  * @see #Field_Set_Dimensions
  * @see #Field_Check_Done
+ * @see #Field_Expose_Buffer
+ * @see #Field_Pipeline_Start
+ * @see #Field_Pipeline_Join
+ * @see #Field_Pipeline_Cancel
+ * @see #Field_Trend_Update
  * @see #Autoguider_Field_SDB_State_Failed_Then_Idle_Set(
  * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Field_Lock
  * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Field_Unlock
@@ -337,13 +519,9 @@ int Autoguider_Field_Exposure_Length_Set(int exposure_length,int lock)
 int Autoguider_Field(void)
 {
 	struct CCD_Setup_Window_Struct window;
-	enum CCD_TEMPERATURE_STATUS temperature_status;
-	double current_temperature;
-	struct timespec start_time;
 	time_t time_secs;
 	struct tm *time_tm = NULL;
-	unsigned short *buffer_ptr = NULL;
-	int retval,dark_exposure_length_index,done;
+	int retval,dark_exposure_length_index,done,exposure_length;
 
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("field","autoguider_field.c","Autoguider_Field",LOG_VERBOSITY_TERSE,
@@ -362,6 +540,12 @@ int Autoguider_Field(void)
 		sprintf(Autoguider_General_Error_String,"Autoguider_Field:Already guiding.");
 		return FALSE;
 	}
+	if(Autoguider_Calibrate_Is_Calibrating())
+	{
+		Autoguider_General_Error_Number = 550;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Field:Already calibrating.");
+		return FALSE;
+	}
 	Field_Data.Is_Fielding = TRUE;
 	/* update SDB */
 	if(!Autoguider_CIL_SDB_Packet_State_Set(E_AGG_STATE_WORKING))
@@ -476,6 +660,11 @@ int Autoguider_Field(void)
 	Autoguider_General_Log_Format("field","autoguider_field.c","Autoguider_Field",
 				      LOG_VERBOSITY_VERBOSE,"FIELD","Field Id = %d.",Field_Data.Field_Id);
 #endif
+	/* reset the peak counts trend used to predict the next exposure length */
+	Field_Data.Trend_Exposure_Length = -1;
+	Field_Data.Trend_Object_Count = -1;
+	Field_Data.Trend_Peak_Counts = 0.0f;
+	Field_Data.Trend_Unsaturated_Peak_Counts = 0.0f;
 	/* start field loop */
 	done = FALSE;
 	while(done == FALSE)
@@ -490,121 +679,36 @@ int Autoguider_Field(void)
 		retval = Autoguider_Dark_Set(Field_Data.Bin_X,Field_Data.Bin_Y,Field_Data.Exposure_Length);
 		if(retval == FALSE)
 		{
+			Field_Pipeline_Cancel();
 			/* update SDB */
 			Autoguider_Field_SDB_State_Failed_Then_Idle_Set();
 			/* reset fielding flag */
 			Field_Data.Is_Fielding = FALSE;
 			return FALSE;
 		}
-		/* lock out a readout buffer */
 		/* Use the buffer index _not_ used by the last completed field readout */
 		Field_Data.In_Use_Buffer_Index = (!Field_Data.Last_Buffer_Index);
-#if AUTOGUIDER_DEBUG > 9
-		Autoguider_General_Log_Format("field","autoguider_field.c","Autoguider_Field",
-					      LOG_VERBOSITY_VERBOSE,"FIELD",
-					      "Locking raw field buffer %d.",
-					      Field_Data.In_Use_Buffer_Index);
-#endif
-		retval = Autoguider_Buffer_Raw_Field_Lock(Field_Data.In_Use_Buffer_Index,&buffer_ptr);
-		if(retval == FALSE)
-		{
-			/* update SDB */
-			Autoguider_Field_SDB_State_Failed_Then_Idle_Set();
-			/* reset fielding flag */
-			Field_Data.Is_Fielding = FALSE;
-			/* reset in use buffer index */
-			Field_Data.In_Use_Buffer_Index = -1;
-			Autoguider_General_Error_Number = 506;
-			sprintf(Autoguider_General_Error_String,"Autoguider_Field:Autoguider_Buffer_Raw_Field_Lock failed.");
-			return FALSE;
-		}
-#if AUTOGUIDER_DEBUG > 9
-		Autoguider_General_Log("field","autoguider_field.c","Autoguider_Field",
-				       LOG_VERBOSITY_VERBOSE,"FIELD","field buffer locked.");
-#endif
-		/* do a field */
-		start_time.tv_sec = 0;
-		start_time.tv_nsec = 0;
-#if AUTOGUIDER_DEBUG > 5
-		Autoguider_General_Log_Format("field","autoguider_field.c","Autoguider_Field",
-					      LOG_VERBOSITY_VERBOSE,"FIELD",
-					      "Calling CCD_Exposure_Expose with exposure length %d ms.",
-					      Field_Data.Exposure_Length);
-#endif
-		retval = CCD_Exposure_Expose(TRUE,start_time,Field_Data.Exposure_Length,buffer_ptr,
-					     Autoguider_Buffer_Get_Field_Pixel_Count());
-		if(retval == FALSE)
-		{
-			/* update SDB */
-			Autoguider_Field_SDB_State_Failed_Then_Idle_Set();
-			/* reset fielding flag */
-			Field_Data.Is_Fielding = FALSE;
-			/* attempt buffer unlock, and reset in use index */
-			Autoguider_Buffer_Raw_Field_Unlock(Field_Data.In_Use_Buffer_Index);
-			/* reset in use buffer index */
-			Field_Data.In_Use_Buffer_Index = -1;
-			Autoguider_General_Error_Number = 507;
-			sprintf(Autoguider_General_Error_String,"Autoguider_Field:CCD_Exposure_Expose failed.");
-			return FALSE;
-		}
-		/* save the exposure length, start time, CCD temperature for this buffer 
-		** for future reference (FITS headers) */
-		if(!Autoguider_Buffer_Field_Exposure_Length_Set(Field_Data.In_Use_Buffer_Index,
-								Field_Data.Exposure_Length))
-		{
-			Autoguider_General_Error("field","autoguider_field.c","Autoguider_Field",
-						 LOG_VERBOSITY_VERBOSE,"FIELD");
-		}
-		retval = CCD_Exposure_Get_Exposure_Start_Time(&start_time);
-		if(retval == TRUE)
+		if(Field_Pipeline_Data.Is_Running)
 		{
-			if(!Autoguider_Buffer_Field_Exposure_Start_Time_Set(Field_Data.In_Use_Buffer_Index,start_time))
-			{
-				Autoguider_General_Error("field","autoguider_field.c","Autoguider_Field",
-							 LOG_VERBOSITY_VERBOSE,"FIELD");
-			}
+			/* this exposure was started by Field_Pipeline_Start whilst the last frame was reduced,
+			** wait for it to finish */
+			retval = Field_Pipeline_Join();
 		}
-		retval = CCD_Temperature_Get(&current_temperature,&temperature_status);
-		if(retval)
-		{
-#if AUTOGUIDER_DEBUG > 9
-			Autoguider_General_Log_Format("field","autoguider_field.c","Autoguider_Field",
-						      LOG_VERBOSITY_VERBOSE,"FIELD",
-						      "current temperature is %.2f C.",current_temperature);
-#endif
-			if(!Autoguider_Buffer_Field_CCD_Temperature_Set(Field_Data.In_Use_Buffer_Index,
-									current_temperature))
-			{
-				Autoguider_General_Error("field","autoguider_field.c","Autoguider_Field",
-				      LOG_VERBOSITY_VERBOSE,"FIELD");
-			}
-		}
-#if AUTOGUIDER_DEBUG > 7
-		Autoguider_General_Log("field","autoguider_field.c","Autoguider_Field",
-				       LOG_VERBOSITY_VERBOSE,"FIELD","exposure completed.");
-#endif
-		/* unlock readout buffer */
-#if AUTOGUIDER_DEBUG > 9
-		Autoguider_General_Log_Format("field","autoguider_field.c","Autoguider_Field",
-					      LOG_VERBOSITY_VERBOSE,"FIELD","Unlocking raw field buffer %d.",
-					      Field_Data.In_Use_Buffer_Index);
-#endif
-		/* save raw FITS file, for debugging */
-		Field_Save_Raw_Image(buffer_ptr, Autoguider_Buffer_Get_Field_Binned_NCols(), Autoguider_Buffer_Get_Field_Binned_NRows(), Field_Data.Exposure_Length, current_temperature,start_time);
-
-		retval = Autoguider_Buffer_Raw_Field_Unlock(Field_Data.In_Use_Buffer_Index);
+		else
+			retval = Field_Expose_Buffer(Field_Data.In_Use_Buffer_Index,Field_Data.Exposure_Length);
 		if(retval == FALSE)
 		{
 			/* update SDB */
 			Autoguider_Field_SDB_State_Failed_Then_Idle_Set();
 			/* reset fielding flag */
 			Field_Data.Is_Fielding = FALSE;
-			Autoguider_General_Error_Number = 508;
-			sprintf(Autoguider_General_Error_String,"Autoguider_Field:Autoguider_Buffer_Raw_Field_Unlock failed.");
 			/* reset in use buffer index */
 			Field_Data.In_Use_Buffer_Index = -1;
 			return FALSE;
 		}
+		/* start exposing the most likely next frame, whilst this one is reduced and checked */
+		if(Field_Data.Pipeline_Enable&&Field_Data.Do_Object_Detect&&(Field_Data.Exposure_Length_Lock == FALSE))
+			Field_Pipeline_Start(!Field_Data.In_Use_Buffer_Index);
 		/* reduce data */
 		/* Field_Reduce calls
 		** Autoguider_Buffer_Raw_To_Reduced_Field which re-locks the raw field mutex, so has to be called
@@ -613,6 +717,7 @@ int Autoguider_Field(void)
 		retval = Field_Reduce(Field_Data.In_Use_Buffer_Index);
 		if(retval == FALSE)
 		{
+			Field_Pipeline_Cancel();
 			/* update SDB */
 			Autoguider_Field_SDB_State_Failed_Then_Idle_Set();
 			/* reset fielding flag */
@@ -633,14 +738,30 @@ int Autoguider_Field(void)
 					      Field_Data.Last_Buffer_Index);
 #endif
 		/* Check whether we have found suitable objects to guide on */
+		exposure_length = Field_Data.Exposure_Length;
 		if(!Field_Check_Done(&done,&dark_exposure_length_index))
 		{
+			Field_Pipeline_Cancel();
 			/* update SDB */
 			Autoguider_Field_SDB_State_Failed_Then_Idle_Set();
 			/* reset fielding flag */
 			Field_Data.Is_Fielding = FALSE;
 			return FALSE;
 		}
+		/* cancel the speculative exposure if we have finished, or it was the wrong length */
+		if(Field_Pipeline_Data.Is_Running&&
+		   (done||(Field_Pipeline_Data.Exposure_Length != Field_Data.Exposure_Length)))
+		{
+#if AUTOGUIDER_DEBUG > 5
+			Autoguider_General_Log_Format("field","autoguider_field.c","Autoguider_Field",
+						      LOG_VERBOSITY_VERBOSE,"FIELD",
+						      "Cancelling speculative %d ms exposure (done = %d, next = %d ms).",
+						      Field_Pipeline_Data.Exposure_Length,done,
+						      Field_Data.Exposure_Length);
+#endif
+			Field_Pipeline_Cancel();
+		}
+		Field_Trend_Update(exposure_length);
 	}/* end while */
 	/* reset fielding flag */
 	Field_Data.Is_Fielding = FALSE;
@@ -682,7 +803,7 @@ int Autoguider_Field(void)
  * @see ../ccd/cdocs/ccd_setup.html#CCD_Setup_Dimensions
  * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Expose
  * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Get_Exposure_Start_Time
- * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Get
+ * @see autoguider_housekeeping.html#Autoguider_Housekeeping_Temperature_Get
  * @see ../ccd/cdocs/ccd_temperature.html#CCD_TEMPERATURE_STATUS
  */
 int Autoguider_Field_Expose(void)
@@ -690,6 +811,7 @@ int Autoguider_Field_Expose(void)
 	struct CCD_Setup_Window_Struct window;
 	enum CCD_TEMPERATURE_STATUS temperature_status;
 	double current_temperature;
+	int temperature_age;
 	struct timespec start_time;
 	time_t time_secs;
 	struct tm *time_tm = NULL;
@@ -713,6 +835,12 @@ int Autoguider_Field_Expose(void)
 		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Expose:Already guiding.");
 		return FALSE;
 	}
+	if(Autoguider_Calibrate_Is_Calibrating())
+	{
+		Autoguider_General_Error_Number = 551;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Expose:Already calibrating.");
+		return FALSE;
+	}
 	Field_Data.Is_Fielding = TRUE;
 	/* update SDB */
 	if(!Autoguider_CIL_SDB_Packet_State_Set(E_AGG_STATE_WORKING))
@@ -871,13 +999,15 @@ int Autoguider_Field_Expose(void)
 				      LOG_VERBOSITY_VERBOSE,"FIELD");
 		}
 	}
-	retval = CCD_Temperature_Get(&current_temperature,&temperature_status);
+	/* use the temperature published by the housekeeping thread, rather than querying the SDK */
+	retval = Autoguider_Housekeeping_Temperature_Get(&current_temperature,&temperature_status,&temperature_age);
 	if(retval)
 	{
 #if AUTOGUIDER_DEBUG > 9
 		Autoguider_General_Log_Format("field","autoguider_field.c","Autoguider_Field_Expose",
 					      LOG_VERBOSITY_VERBOSE,"FIELD",
-					      "current temperature is %.2f C.",current_temperature);
+					      "current temperature is %.2f C (%d ms old).",current_temperature,
+					      temperature_age);
 #endif
 		if(!Autoguider_Buffer_Field_CCD_Temperature_Set(Field_Data.In_Use_Buffer_Index,
 								current_temperature))
@@ -1194,7 +1324,8 @@ int Autoguider_Field_Get_Save_FITS_Successful(void)
 
 /**
  * Save the last reduced field buffer to a FITS image.
- * Autoguider_Get_Fits uses Last_Buffer_Index. 
+ * Autoguider_Get_Fits uses Last_Buffer_Index. The in-memory FITS image is passed to
+ * Autoguider_Fits_Writer_Buffer_Add, so the disk write happens in the FITS writer thread.
  * @param successful A boolean, if TRUE this field operation was successful (we have found a suitable guide star),
  *        otherwise it was a failed field.
  * @param object_index The index in the object list of the selected object to be used for guiding.
@@ -1203,11 +1334,11 @@ int Autoguider_Field_Get_Save_FITS_Successful(void)
  * @see #Field_Data
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
  * @see autoguider_get_fits.html#Autoguider_Get_Fits
+ * @see autoguider_fits_writer.html#Autoguider_Fits_Writer_Buffer_Add
  */
 int Autoguider_Field_Save_FITS(int successful,int object_index)
 {
-	FILE *fp = NULL;
-	int retval,my_errno;
+	int retval;
 	char *directory_name = NULL;
 	char filename[256];
 	char successful_string[16];
@@ -1256,53 +1387,12 @@ int Autoguider_Field_Save_FITS(int successful,int object_index)
 	Autoguider_General_Log_Format("field","autoguider_field.c","Autoguider_Field_Save_FITS",
 				      LOG_VERBOSITY_VERBOSE,"FIELD","Saving to %s.",filename);
 #endif
-	/* open file */
-	fp = fopen(filename,"wb");
-	if(fp == NULL)
-	{
-		my_errno = errno;
-		if(directory_name != NULL)
-			free(directory_name);
-		if(buffer_ptr != NULL)
-			free(buffer_ptr);
-		Autoguider_General_Error_Number = 502;
-		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Save_FITS:"
-			"Failed to open output filename '%s' (%d).",filename,my_errno);
+	/* hand the in-memory FITS image to the FITS writer, which writes it to disk in a background thread
+	** and frees it afterwards. */
+	if(directory_name != NULL)
+		free(directory_name);
+	if(!Autoguider_Fits_Writer_Buffer_Add(filename,buffer_ptr,buffer_length))
 		return FALSE;
-	}
-	/* write buffer to file */
-	retval = fwrite(buffer_ptr,sizeof(char),buffer_length,fp);
-	if(retval != buffer_length)
-	{
-		if(directory_name != NULL)
-			free(directory_name);
-		if(buffer_ptr != NULL)
-			free(buffer_ptr);
-		fclose(fp);
-		Autoguider_General_Error_Number = 503;
-		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Save_FITS:"
-			"Failed to write output (%d of %ld) to %s.",retval,buffer_length,filename);
-		return FALSE;
-	}
-	/* close file */
-	retval = fclose(fp);
-	if(retval != 0)
-	{
-		my_errno = errno;
-		if(directory_name != NULL)
-			free(directory_name);
-		if(buffer_ptr != NULL)
-			free(buffer_ptr);
-		Autoguider_General_Error_Number = 536;
-		sprintf(Autoguider_General_Error_String,"Autoguider_Field_Save_FITS:"
-			"Failed to close output filename '%s' (%d).",filename,my_errno);
-		return FALSE;
-	}
-	/* free allocated buffers */
-	if(buffer_ptr != NULL)
-		free(buffer_ptr);
-        if(directory_name != NULL)
-	        free(directory_name);
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("field","autoguider_field.c","Autoguider_Field_Save_FITS",
 			       LOG_VERBOSITY_TERSE,"FIELD","finished.");
@@ -1379,91 +1469,82 @@ static int Field_Set_Dimensions(void)
  * Developed as a debug routine to gather useful information for bug #1895
  * cjm (brain), nrc (hands and feet) 
  * 29/03/12
+ * The image data is copied, and passed with a FITS header to the FITS writer, 
+ * so the disk write happens in the FITS writer thread rather than in the field loop.
+ * The filename is /icc/tmp/field_raw_&lt;seconds&gt;_&lt;milliseconds&gt;_&lt;sequence number&gt;.fits.
  * @param image_data The image data itself
  * @param ncols The number of columns in the image
  * @param nrows The number of rows in the image
  * @param exposure_length The length of exposure used to create the image
  * @param current_temperature The temperature of the CCD when the image was taken.
  * @param start_time A timestamp of the start time of the exposure.
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Initialise
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Add_Float
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Free
+ * @see autoguider_fits_writer.html#Autoguider_Fits_Writer_Image_Add
  */ 
 static void Field_Save_Raw_Image(unsigned short *image_data, int ncols, int nrows, int exposure_length,
 				 double current_temperature,struct timespec start_time)
 {
-        fitsfile *fp = NULL;
-	char buff[32]; /* fits_get_errstatus returns 30 chars max */
+	struct Fits_Header_Struct fits_header;
+	unsigned short *image_copy = NULL;
 	char filename[256];
-	long axes[2];
-	
-	char exposure_start_time_string[64];
 	double exposure_length_s;
-	time_t now_time_s;
-	int status=0, retval;
+	struct timespec now_time;
+	static int sequence_number = 0;
 
-	now_time_s = time(NULL);
-	sprintf(filename, "/icc/tmp/field_raw_%ld.fits", now_time_s);
-	retval = fits_create_file(&fp,filename,&status);
-	if(retval)
-	{
-	        fits_get_errstatus(status,buff);
-		fits_report_error(stderr,status);
+	/* millisecond resolution and a sequence number, so images saved within the same second do not overwrite
+	** each other. Only called from the field thread, so the sequence number needs no mutex. */
+	clock_gettime(CLOCK_REALTIME,&now_time);
+	sequence_number++;
+	sprintf(filename, "/icc/tmp/field_raw_%ld_%03ld_%d.fits",(long)now_time.tv_sec,
+		(long)(now_time.tv_nsec/AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS),sequence_number);
+	/* take a snapshot of the image data, the FITS writer frees it */
+	image_copy = (unsigned short *)malloc(ncols*nrows*sizeof(unsigned short));
+	if(image_copy == NULL)
+	{
+		Autoguider_General_Error_Number = 539;
+		sprintf(Autoguider_General_Error_String,"Field_Save_Raw_Image:"
+			"Failed to allocate image copy (%d x %d).",ncols,nrows);
+		Autoguider_General_Error("field","autoguider_field.c","Field_Save_Raw_Image",
+					 LOG_VERBOSITY_VERBOSE,"FIELD"); /* no need to fail */
 		return;
 	}
-  
-	/* basic dimensions */
-	axes[0] = ncols;
-	axes[1] = nrows;
-  
-	retval = fits_create_img(fp,USHORT_IMG,2,axes,&status);
-	if(retval)
+	memcpy(image_copy,image_data,ncols*nrows*sizeof(unsigned short));
+	if(!Autoguider_Fits_Header_Initialise(&fits_header))
 	{
-	        fits_get_errstatus(status,buff);
-		fits_report_error(stderr,status);
-		fits_close_file(fp,&status);
+		free(image_copy);
+		Autoguider_General_Error("field","autoguider_field.c","Field_Save_Raw_Image",
+					 LOG_VERBOSITY_VERBOSE,"FIELD"); /* no need to fail */
 		return;
 	}
-  
-	retval = fits_write_img(fp,TUSHORT,1,ncols*nrows,image_data,&status);
-	if(retval)
-	{
-	        fits_get_errstatus(status,buff);
-		fits_report_error(stderr,status);
-		fits_close_file(fp,&status);
-		return;
-	}  
 	/* EXPTIME */
 	exposure_length_s = ((double)exposure_length)/1000.0;
-	retval = fits_update_key_fixdbl(fp,"EXPTIME",exposure_length_s,6,NULL,&status);
-	if(retval)
-	{
-	       fits_get_errstatus(status,buff);
-	       fits_report_error(stderr,status);
-	       fits_close_file(fp,&status);
-	       return;
-	}
 	/* CCCDATEMP */
-	retval = fits_update_key_fixdbl(fp,"CCDATEMP",current_temperature+273.16,6,
-				 "Temperature of CCD",&status);
-	if(retval)
+	if((!Autoguider_Fits_Header_Add_Float(&fits_header,"EXPTIME",exposure_length_s,NULL))||
+	   (!Autoguider_Fits_Header_Add_Float(&fits_header,"CCDATEMP",current_temperature+273.16,
+					      "Temperature of CCD")))
 	{
-	       fits_get_errstatus(status,buff);
-	       fits_report_error(stderr,status);
-	       fits_close_file(fp,&status);
-	       return;
+		free(image_copy);
+		Autoguider_Fits_Header_Free(&fits_header);
+		Autoguider_General_Error("field","autoguider_field.c","Field_Save_Raw_Image",
+					 LOG_VERBOSITY_VERBOSE,"FIELD"); /* no need to fail */
+		return;
 	}
-
-	/* close file */
-	retval = fits_close_file(fp,&status);
-	if(retval)
+	/* the FITS writer takes ownership of image_copy and fits_header */
+	if(!Autoguider_Fits_Writer_Image_Add(filename,TUSHORT,image_copy,ncols,nrows,fits_header))
 	{
-	       fits_get_errstatus(status,buff);
-	       fits_report_error(stderr,status);
-	       return;
+		Autoguider_General_Error("field","autoguider_field.c","Field_Save_Raw_Image",
+					 LOG_VERBOSITY_VERBOSE,"FIELD"); /* no need to fail */
 	}
 }
 
 /**
  * Internal routine to reduced the field data in the Field_Data.In_Use_Buffer_Index buffer.
  * The raw/reduced mutexs should <b>not</b> be locked when this is called.
+ * If Field_Data.Reduce_Thread_Count is greater than one, the raw to reduced conversion, dark subtraction and
+ * flat fielding are done in parallel bands by Field_Reduce_Parallel, which gives identical reduced pixel values
+ * to the serial path, and objects are detected in the same number of tiles by Autoguider_Object_Detect_Tiled.
  * @param buffer_index The buffer index to reduce, should usually be called with Field_Data.In_Use_Buffer_Index.
  *       Passed as a parameter to potentially allow this routine to run in a different thread.
  * @return The routine returns TRUE on success and FALSE on failure.
@@ -1476,6 +1557,9 @@ static void Field_Save_Raw_Image(unsigned short *image_data, int ncols, int nrow
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Log_Format
  * @see autoguider_object.html#Autoguider_Object_Detect
+ * @see autoguider_object.html#Autoguider_Object_Detect_Tiled
+ * @see #Field_Data
+ * @see #Field_Reduce_Parallel
  */
 static int Field_Reduce(int buffer_index)
 {
@@ -1487,73 +1571,87 @@ static int Field_Reduce(int buffer_index)
 	Autoguider_General_Log_Format("field","autoguider_field.c","Field_Reduce",
 				      LOG_VERBOSITY_TERSE,"FIELD","Field_Reduce(%d):started.",buffer_index);
 #endif
-	/* copy raw data to reduced data */
-	retval = Autoguider_Buffer_Raw_To_Reduced_Field(buffer_index);
-	if(retval == FALSE)
+	if(Field_Data.Reduce_Thread_Count > 1)
 	{
-#if AUTOGUIDER_DEBUG > 5
-		Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
-				       LOG_VERBOSITY_VERBOSE,"FIELD",
-				       "Autoguider_Buffer_Raw_To_Reduced_Field failed.");
-#endif
-		return FALSE;
+		/* convert, dark subtract and flat field bands of the image in parallel */
+		retval = Field_Reduce_Parallel(buffer_index);
+		if(retval == FALSE)
+			return FALSE;
+		/* lock reduction buffer */
+		retval = Autoguider_Buffer_Reduced_Field_Lock(buffer_index,&reduced_buffer_ptr);
+		if(retval == FALSE)
+			return FALSE;
 	}
-	/* lock reduction buffer */
-	retval = Autoguider_Buffer_Reduced_Field_Lock(buffer_index,&reduced_buffer_ptr);
-	if(retval == FALSE)
+	else
 	{
+		/* copy raw data to reduced data */
+		retval = Autoguider_Buffer_Raw_To_Reduced_Field(buffer_index);
+		if(retval == FALSE)
+		{
 #if AUTOGUIDER_DEBUG > 5
-		Autoguider_General_Log_Format("field","autoguider_field.c","Field_Reduce",
-					      LOG_VERBOSITY_VERBOSE,"FIELD",
-					      "Autoguider_Buffer_Reduced_Field_Lock(%d) failed.",buffer_index);
+			Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
+					       LOG_VERBOSITY_VERBOSE,"FIELD",
+					       "Autoguider_Buffer_Raw_To_Reduced_Field failed.");
 #endif
-		return FALSE;
-	}
-	/* dark subtraction */
-	if(Field_Data.Do_Dark_Subtract)
-	{
-		retval = Autoguider_Dark_Subtract(reduced_buffer_ptr,Autoguider_Buffer_Get_Field_Pixel_Count(),
-						  Field_Data.Binned_NCols,Field_Data.Binned_NRows,
-						  FALSE,blank_window);
+			return FALSE;
+		}
+		/* lock reduction buffer */
+		retval = Autoguider_Buffer_Reduced_Field_Lock(buffer_index,&reduced_buffer_ptr);
 		if(retval == FALSE)
 		{
-			Autoguider_Buffer_Reduced_Field_Unlock(buffer_index);
 #if AUTOGUIDER_DEBUG > 5
-			Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
-					       LOG_VERBOSITY_VERBOSE,"FIELD","Autoguider_Dark_Subtract failed.");
+			Autoguider_General_Log_Format("field","autoguider_field.c","Field_Reduce",
+						      LOG_VERBOSITY_VERBOSE,"FIELD",
+						      "Autoguider_Buffer_Reduced_Field_Lock(%d) failed.",buffer_index);
 #endif
 			return FALSE;
 		}
-	}
-	else
-	{
+		/* dark subtraction */
+		if(Field_Data.Do_Dark_Subtract)
+		{
+			retval = Autoguider_Dark_Subtract(reduced_buffer_ptr,Autoguider_Buffer_Get_Field_Pixel_Count(),
+							  Field_Data.Binned_NCols,Field_Data.Binned_NRows,
+							  FALSE,blank_window);
+			if(retval == FALSE)
+			{
+				Autoguider_Buffer_Reduced_Field_Unlock(buffer_index);
 #if AUTOGUIDER_DEBUG > 5
-		Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
-				       LOG_VERBOSITY_VERBOSE,"FIELD","Did NOT subtract dark.");
+				Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
+						       LOG_VERBOSITY_VERBOSE,"FIELD","Autoguider_Dark_Subtract failed.");
 #endif
-	}
-	/* flat field */
-	if(Field_Data.Do_Flat_Field)
-	{
-		retval = Autoguider_Flat_Field(reduced_buffer_ptr,Autoguider_Buffer_Get_Field_Pixel_Count(),
-						  Field_Data.Binned_NCols,Field_Data.Binned_NRows,
-						  FALSE,blank_window);
-		if(retval == FALSE)
+				return FALSE;
+			}
+		}
+		else
 		{
-			Autoguider_Buffer_Reduced_Field_Unlock(buffer_index);
 #if AUTOGUIDER_DEBUG > 5
 			Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
-					       LOG_VERBOSITY_VERBOSE,"FIELD","Autoguider_Flat_Field failed.");
+					       LOG_VERBOSITY_VERBOSE,"FIELD","Did NOT subtract dark.");
 #endif
-			return FALSE;
 		}
-	}
-	else
-	{
+		/* flat field */
+		if(Field_Data.Do_Flat_Field)
+		{
+			retval = Autoguider_Flat_Field(reduced_buffer_ptr,Autoguider_Buffer_Get_Field_Pixel_Count(),
+							  Field_Data.Binned_NCols,Field_Data.Binned_NRows,
+							  FALSE,blank_window);
+			if(retval == FALSE)
+			{
+				Autoguider_Buffer_Reduced_Field_Unlock(buffer_index);
 #if AUTOGUIDER_DEBUG > 5
-		Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
-				       LOG_VERBOSITY_VERBOSE,"FIELD","Did NOT flat field.");
+				Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
+						       LOG_VERBOSITY_VERBOSE,"FIELD","Autoguider_Flat_Field failed.");
+#endif
+				return FALSE;
+			}
+		}
+		else
+		{
+#if AUTOGUIDER_DEBUG > 5
+			Autoguider_General_Log("field","autoguider_field.c","Field_Reduce",
+					       LOG_VERBOSITY_VERBOSE,"FIELD","Did NOT flat field.");
 #endif
+		}
 	}
 	/* object detect */
 	if(Field_Data.Do_Object_Detect)
@@ -1561,8 +1659,18 @@ static int Field_Reduce(int buffer_index)
 		/* Whole detector image dimensions start at (1,1) not (0,0) (for at least Andor/PCO)
 		** We therefore pass in (1,1) as the start x/y pixel so the returned centroids have
 		** the same pixel position mapping as the windowed guide frames (1-based rather than 0-based) */
-		retval = Autoguider_Object_Detect(reduced_buffer_ptr,Field_Data.Binned_NCols,Field_Data.Binned_NRows,
-						  1,1,TRUE,Field_Data.Field_Id,Field_Data.Frame_Number);
+		if(Field_Data.Reduce_Thread_Count > 1)
+		{
+			retval = Autoguider_Object_Detect_Tiled(reduced_buffer_ptr,Field_Data.Binned_NCols,
+								Field_Data.Binned_NRows,1,1,TRUE,Field_Data.Field_Id,
+								Field_Data.Frame_Number,Field_Data.Reduce_Thread_Count);
+		}
+		else
+		{
+			retval = Autoguider_Object_Detect(reduced_buffer_ptr,Field_Data.Binned_NCols,
+							  Field_Data.Binned_NRows,1,1,TRUE,Field_Data.Field_Id,
+							  Field_Data.Frame_Number);
+		}
 		if(retval == FALSE)
 		{
 			Autoguider_Buffer_Reduced_Field_Unlock(buffer_index);
@@ -1593,6 +1701,179 @@ static int Field_Reduce(int buffer_index)
 	return TRUE;
 }
 
+/**
+ * Internal routine to convert, dark subtract and flat field the field data in the specified buffer in parallel.
+ * The image is split into Field_Data.Reduce_Thread_Count bands of rows, which are reduced by the worker pool
+ * (created by Autoguider_Field_Initialise) and the calling thread. Each pixel gets exactly the same operations
+ * as in the serial path, so the reduced image is identical.
+ * The raw and reduced buffers for buffer_index are locked whilst the bands are reduced.
+ * @param buffer_index The buffer index to reduce.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Field_Data
+ * @see #Field_Reduce_Band_Struct
+ * @see #Field_Reduce_Band
+ * @see autoguider_worker_pool.html#Autoguider_Worker_Pool_Run
+ * @see autoguider_buffer.html#Autoguider_Buffer_Get_Field_Pixel_Count
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Field_Lock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Field_Unlock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Reduced_Field_Lock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Reduced_Field_Unlock
+ */
+static int Field_Reduce_Parallel(int buffer_index)
+{
+	struct Field_Reduce_Band_Struct *band_list = NULL;
+	unsigned short *raw_buffer_ptr = NULL;
+	float *reduced_buffer_ptr = NULL;
+	int band_count,band_nrows,band_remainder,start_row,flat_zero_count,i,retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("field","autoguider_field.c","Field_Reduce_Parallel",
+				      LOG_VERBOSITY_VERBOSE,"FIELD","Field_Reduce_Parallel(%d) with %d threads:started.",
+				      buffer_index,Field_Data.Reduce_Thread_Count);
+#endif
+	if((Field_Data.Binned_NCols*Field_Data.Binned_NRows) != Autoguider_Buffer_Get_Field_Pixel_Count())
+	{
+		Autoguider_General_Error_Number = 542;
+		sprintf(Autoguider_General_Error_String,"Field_Reduce_Parallel:"
+			"Field dimensions (%d,%d) do not match buffer pixel count %d.",Field_Data.Binned_NCols,
+			Field_Data.Binned_NRows,Autoguider_Buffer_Get_Field_Pixel_Count());
+		return FALSE;
+	}
+	band_count = Field_Data.Reduce_Thread_Count;
+	if(band_count > Field_Data.Binned_NRows)
+		band_count = Field_Data.Binned_NRows;
+	band_list = (struct Field_Reduce_Band_Struct *)calloc(band_count,sizeof(struct Field_Reduce_Band_Struct));
+	if(band_list == NULL)
+	{
+		Autoguider_General_Error_Number = 543;
+		sprintf(Autoguider_General_Error_String,"Field_Reduce_Parallel:"
+			"Failed to allocate band list of length %d.",band_count);
+		return FALSE;
+	}
+	/* lock raw and reduced buffers, in the same order as Autoguider_Buffer_Raw_To_Reduced_Field */
+	if(!Autoguider_Buffer_Raw_Field_Lock(buffer_index,&raw_buffer_ptr))
+	{
+		free(band_list);
+		return FALSE;
+	}
+	if(!Autoguider_Buffer_Reduced_Field_Lock(buffer_index,&reduced_buffer_ptr))
+	{
+		Autoguider_Buffer_Raw_Field_Unlock(buffer_index);
+		free(band_list);
+		return FALSE;
+	}
+	/* split the rows into bands, the first band_remainder bands get an extra row */
+	band_nrows = Field_Data.Binned_NRows/band_count;
+	band_remainder = Field_Data.Binned_NRows%band_count;
+	start_row = 0;
+	for(i=0; i < band_count; i++)
+	{
+		band_list[i].Raw_Buffer_Ptr = raw_buffer_ptr;
+		band_list[i].Reduced_Buffer_Ptr = reduced_buffer_ptr;
+		band_list[i].Start_Row = start_row;
+		band_list[i].Row_Count = band_nrows;
+		if(i < band_remainder)
+			band_list[i].Row_Count++;
+		band_list[i].Retval = FALSE;
+		start_row += band_list[i].Row_Count;
+	}
+	/* reduce the bands on the worker pool */
+	retval = Autoguider_Worker_Pool_Run(Field_Reduce_Band,(void *)band_list,
+					    sizeof(struct Field_Reduce_Band_Struct),band_count);
+	if(!Autoguider_Buffer_Reduced_Field_Unlock(buffer_index))
+	{
+		Autoguider_Buffer_Raw_Field_Unlock(buffer_index);
+		free(band_list);
+		return FALSE;
+	}
+	if(!Autoguider_Buffer_Raw_Field_Unlock(buffer_index))
+	{
+		free(band_list);
+		return FALSE;
+	}
+	if(retval == FALSE)
+	{
+		free(band_list);
+		return FALSE;
+	}
+	flat_zero_count = 0;
+	for(i=0; i < band_count; i++)
+	{
+		/* copy the failed band's error, now no other band thread can be setting the error */
+		if(band_list[i].Retval == FALSE)
+		{
+			Autoguider_General_Error_Number = band_list[i].Error_Number;
+			strcpy(Autoguider_General_Error_String,band_list[i].Error_String);
+			free(band_list);
+			return FALSE;
+		}
+		flat_zero_count += band_list[i].Flat_Zero_Count;
+	}
+	free(band_list);
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("field","autoguider_field.c","Field_Reduce_Parallel",
+				      LOG_VERBOSITY_VERBOSE,"FIELD","flat has %d zero values:finished.",
+				      flat_zero_count);
+#endif
+	return TRUE;
+}
+
+/**
+ * Reduce one band of rows of a field image: convert the raw pixels to float, dark subtract (if
+ * Field_Data.Do_Dark_Subtract is set) and flat field (if Field_Data.Do_Flat_Field is set).
+ * The band is processed FIELD_REDUCE_CHUNK_ROWS rows at a time, so the data stays in cache between steps.
+ * This is the job routine Field_Reduce_Parallel runs on the worker pool, once per band.
+ * @param user_arg A pointer to the band's Field_Reduce_Band_Struct. The Retval and Flat_Zero_Count fields
+ *        are set by this routine, and on failure the band's Error_Number and Error_String, rather than
+ *        Autoguider_General_Error_Number and Autoguider_General_Error_String, which other bands may be setting.
+ * @see #Field_Data
+ * @see #Field_Reduce_Band_Struct
+ * @see #FIELD_REDUCE_CHUNK_ROWS
+ * @see autoguider_dark.html#Autoguider_Dark_Subtract_Rows
+ * @see autoguider_flat.html#Autoguider_Flat_Field_Rows
+ */
+static void Field_Reduce_Band(void *user_arg)
+{
+	struct Field_Reduce_Band_Struct *band = NULL;
+	unsigned short *raw_ptr = NULL;
+	float *reduced_ptr = NULL;
+	int row,chunk_nrows,pixel_count,zero_count,i;
+
+	band = (struct Field_Reduce_Band_Struct *)user_arg;
+	band->Retval = FALSE;
+	band->Flat_Zero_Count = 0;
+	band->Error_Number = 0;
+	band->Error_String[0] = '\0';
+	for(row = band->Start_Row; row < (band->Start_Row+band->Row_Count); row += chunk_nrows)
+	{
+		chunk_nrows = (band->Start_Row+band->Row_Count)-row;
+		if(chunk_nrows > FIELD_REDUCE_CHUNK_ROWS)
+			chunk_nrows = FIELD_REDUCE_CHUNK_ROWS;
+		/* raw to reduced conversion, as Autoguider_Buffer_Raw_To_Reduced_Field */
+		raw_ptr = band->Raw_Buffer_Ptr+(row*Field_Data.Binned_NCols);
+		reduced_ptr = band->Reduced_Buffer_Ptr+(row*Field_Data.Binned_NCols);
+		pixel_count = chunk_nrows*Field_Data.Binned_NCols;
+		for(i=0; i < pixel_count; i++)
+			reduced_ptr[i] = (float)(raw_ptr[i]);
+		if(Field_Data.Do_Dark_Subtract)
+		{
+			if(!Autoguider_Dark_Subtract_Rows(band->Reduced_Buffer_Ptr,Field_Data.Binned_NCols,
+							  Field_Data.Binned_NRows,row,chunk_nrows,
+							  &(band->Error_Number),band->Error_String))
+				return;
+		}
+		if(Field_Data.Do_Flat_Field)
+		{
+			if(!Autoguider_Flat_Field_Rows(band->Reduced_Buffer_Ptr,Field_Data.Binned_NCols,
+						       Field_Data.Binned_NRows,row,chunk_nrows,&zero_count,
+						       &(band->Error_Number),band->Error_String))
+				return;
+			band->Flat_Zero_Count += zero_count;
+		}
+	}
+	band->Retval = TRUE;
+}
+
 /**
  * Routine to check whether to stop field looping, and if not to adjust the Field_Data.Exposure_Length accordingly.
  * <ul>
@@ -1604,8 +1885,8 @@ static int Field_Reduce(int buffer_index)
  *     <ul>
  *     <li>We double the exposure length.
  *     <li>We use Autoguider_Dark_Get_Exposure_Length_Nearest to get the nearest index to that exposure length.
- *     <li>If the exposure list index hasn't changed neither has the exposure length, we stop fielding (done = TRUE)
- *         assuming we've reached the end of the list. (We should check that really!).
+ *     <li>If the exposure length hasn't changed, we stop fielding (done = TRUE)
+ *         assuming we've reached the end of the list (or the maximum exposure length).
  *     <li>We set (done = FALSE) to retry fielding with a longer exposure length.
  *     </ul>
  * <li>We go through the list of objects:
@@ -1623,12 +1904,12 @@ static int Field_Reduce(int buffer_index)
  *                 </ul>
  *             <li>else the object is too bright. If it is the only detected object:
  *                 <ul>
- *                 <li>We half the exposure length.
+ *                 <li>We call Field_Exposure_Length_Next to reduce the exposure length, using the flux
+ *                     model, or halving it.
  *                 <li>We use Autoguider_Dark_Get_Exposure_Length_Nearest to get the nearest index 
  *                     to that exposure length.
- *                 <li>If the exposure list index hasn't changed neither has the exposure length, 
- *                     we stop fielding (done = TRUE) assuming we've reached the end of the list. 
- *                     (We should check that really!).
+ *                 <li>If the exposure length hasn't changed, we stop fielding (done = TRUE)
+ *                     assuming we've reached the end of the list (or the minimum exposure length).
  *                 <li>We set (done = FALSE) to retry fielding with a shorter exposure length.
  *                 </ul>
  *             </ul>
@@ -1639,10 +1920,11 @@ static int Field_Reduce(int buffer_index)
  *     </ul>
  * <li>If the number of good objects are grerater than 1, we return (done is TRUE) as we have at 
  *     least one good guide star.
- * <li>Otherwise we double the exposure length.
+ * <li>Otherwise we call Field_Exposure_Length_Next with the brightest unsaturated object's peak counts, to
+ *     increase the exposure length using the flux model, or doubling it.
  * <li>We use Autoguider_Dark_Get_Exposure_Length_Nearest to get the nearest index to that exposure length.
- * <li>If the exposure list index hasn't changed neither has the exposure length, we stop fielding (done = TRUE)
- *     assuming we've reached the end of the list. (We should check that really!).
+ * <li>If the exposure length hasn't changed, we stop fielding (done = TRUE)
+ *     assuming we've reached the end of the list (or the maximum exposure length).
  * <li>We set (done = FALSE) to retry fielding with a longer exposure length.
  * </ul>
  * @param done Address of an integer. On exit from this routine, should be set to a boolean value, TRUE meaning
@@ -1653,6 +1935,7 @@ static int Field_Reduce(int buffer_index)
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Autoguider_Field_In_Object_Bounds
  * @see #Field_Data
+ * @see #Field_Exposure_Length_Next
  * @see autoguider_dark.html#Autoguider_Dark_Get_Exposure_Length_Nearest
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Log_Format
@@ -1662,8 +1945,8 @@ static int Field_Reduce(int buffer_index)
 static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 {
 	struct Autoguider_Object_Struct object;
-	int retval,object_count,new_dark_exposure_length_index,i,good_object_count;
-	float fwhm;
+	int retval,object_count,new_dark_exposure_length_index,i,good_object_count,last_exposure_length;
+	float fwhm,max_peak_counts;
 
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("field","autoguider_field.c","Field_Check_Done",
@@ -1687,6 +1970,7 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 				      Field_Data.Exposure_Length,(*dark_exposure_length_index));
 #endif
 	(*done) = FALSE;
+	last_exposure_length = Field_Data.Exposure_Length;
 	/* if we are not object detecting - nothing to determine how good fielding was - stop fielding. */
 	if(Field_Data.Do_Object_Detect == FALSE)
 	{
@@ -1739,7 +2023,7 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 			return FALSE;
 		}
 		/* if we've tried to increase the exposure length but failed, return done. */
-		if(new_dark_exposure_length_index == (*dark_exposure_length_index))
+		if(Field_Data.Exposure_Length == last_exposure_length)
 		{
 #if AUTOGUIDER_DEBUG > 1
 			Autoguider_General_Log_Format("field","autoguider_field.c","Field_Check_Done",
@@ -1764,6 +2048,7 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 	/* have we got a suitable object? */
 	/* Is it stellar? Is it near the edge of the CCD? Does it have sufficient counts? */
 	good_object_count = 0;
+	max_peak_counts = 0.0f;
 	for(i=0;i<object_count;i++)
 	{
 		/* get object */
@@ -1778,12 +2063,15 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 			(*done) = TRUE;
 			return FALSE;
 		}
+		/* brightest unsaturated object, for the flux model */
+		if((object.Peak_Counts > max_peak_counts)&&(object.Peak_Counts < FIELD_OBJECT_PEAK_COUNTS_MAX))
+			max_peak_counts = object.Peak_Counts;
 		/* Object selection now more relaxed than this in Autoguider_Object_Guide_Object_Get? */
 		if(object.Is_Stellar)
 		{
 			if(object.Peak_Counts > 100)
 			{
-				if(object.Peak_Counts < 40000)
+				if(object.Peak_Counts < FIELD_OBJECT_PEAK_COUNTS_MAX)
 				{
 					fwhm = (object.FWHM_X+object.FWHM_Y)/2.0f;
 					if(Autoguider_Field_In_Object_Bounds(object.CCD_X_Position,
@@ -1826,7 +2114,11 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 								     "Field_Check_Done",LOG_VERBOSITY_VERBOSE,"FIELD",
 			      	                        "Only object has too many counts:reduce exp len:retry field.");
 #endif
-						Field_Data.Exposure_Length = Field_Data.Exposure_Length/2.0f;
+						if(!Field_Exposure_Length_Next(object.Peak_Counts,FALSE))
+						{
+							(*done) = TRUE;
+							return FALSE;
+						}
 						/* round field exposure length to nearest available dark */
 						/* Currently assumes this will change the exposure length - 
 						** this is only true if list is spaced correctly - 
@@ -1845,7 +2137,7 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 						}
 						/* if we've tried to increase the exposure length but failed, 
 						** return done. */
-						if(new_dark_exposure_length_index == (*dark_exposure_length_index))
+						if(Field_Data.Exposure_Length == last_exposure_length)
 						{
 #if AUTOGUIDER_DEBUG > 1
 							Autoguider_General_Log_Format("field","autoguider_field.c",
@@ -1905,7 +2197,11 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 	}
 	else
 	{
-		Field_Data.Exposure_Length = Field_Data.Exposure_Length*2.0f;
+		if(!Field_Exposure_Length_Next(max_peak_counts,TRUE))
+		{
+			(*done) = TRUE;
+			return FALSE;
+		}
 		/* round field exposure length to nearest available dark */
 		/* Currently assumes this will change the exposure length - 
 		** this is only true if list is spaced correctly - need to do something more complicated here */
@@ -1921,7 +2217,7 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 			return FALSE;
 		}
 		/* if we've tried to increase the exposure length but failed, return done. */
-		if(new_dark_exposure_length_index == (*dark_exposure_length_index))
+		if(Field_Data.Exposure_Length == last_exposure_length)
 		{
 #if AUTOGUIDER_DEBUG > 1
 			Autoguider_General_Log_Format("field","autoguider_field.c",
@@ -1951,6 +2247,421 @@ static int Field_Check_Done(int *done,int *dark_exposure_length_index)
 	return TRUE;
 }
 
+/**
+ * Internal routine to do one field exposure into a field buffer.
+ * <ul>
+ * <li>Lock the raw field buffer using Autoguider_Buffer_Raw_Field_Lock.
+ * <li>Call CCD_Exposure_Expose to do the exposure.
+ * <li>Save the exposure length, start time and CCD temperature for the buffer.
+ * <li>Call Field_Save_Raw_Image to save the raw image.
+ * <li>Unlock the raw field buffer using Autoguider_Buffer_Raw_Field_Unlock.
+ * </ul>
+ * This routine is called from Autoguider_Field, and from Field_Pipeline_Thread for speculative exposures.
+ * It does not update the SDB or the fielding flags, the caller does that on failure.
+ * @param buffer_index The field buffer index to read out into.
+ * @param exposure_length The exposure length in milliseconds.
+ * @return The routine returns TRUE on success, and FALSE on failure.
+ * @see #Field_Save_Raw_Image
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Field_Lock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Field_Unlock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Get_Field_Pixel_Count
+ * @see autoguider_buffer.html#Autoguider_Buffer_Field_Exposure_Length_Set
+ * @see autoguider_buffer.html#Autoguider_Buffer_Field_Exposure_Start_Time_Set
+ * @see autoguider_buffer.html#Autoguider_Buffer_Field_CCD_Temperature_Set
+ * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Expose
+ * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Get_Exposure_Start_Time
+ * @see autoguider_housekeeping.html#Autoguider_Housekeeping_Temperature_Get
+ */
+static int Field_Expose_Buffer(int buffer_index,int exposure_length)
+{
+	enum CCD_TEMPERATURE_STATUS temperature_status;
+	double current_temperature = 0.0;
+	int temperature_age;
+	struct timespec start_time;
+	unsigned short *buffer_ptr = NULL;
+	int retval;
+
+	/* lock out a readout buffer */
+#if AUTOGUIDER_DEBUG > 9
+	Autoguider_General_Log_Format("field","autoguider_field.c","Field_Expose_Buffer",
+				      LOG_VERBOSITY_VERBOSE,"FIELD","Locking raw field buffer %d.",buffer_index);
+#endif
+	retval = Autoguider_Buffer_Raw_Field_Lock(buffer_index,&buffer_ptr);
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 506;
+		sprintf(Autoguider_General_Error_String,"Field_Expose_Buffer:Autoguider_Buffer_Raw_Field_Lock failed.");
+		return FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 9
+	Autoguider_General_Log("field","autoguider_field.c","Field_Expose_Buffer",
+			       LOG_VERBOSITY_VERBOSE,"FIELD","field buffer locked.");
+#endif
+	/* do a field */
+	start_time.tv_sec = 0;
+	start_time.tv_nsec = 0;
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("field","autoguider_field.c","Field_Expose_Buffer",
+				      LOG_VERBOSITY_VERBOSE,"FIELD",
+				      "Calling CCD_Exposure_Expose with exposure length %d ms.",exposure_length);
+#endif
+	retval = CCD_Exposure_Expose(TRUE,start_time,exposure_length,buffer_ptr,
+				     Autoguider_Buffer_Get_Field_Pixel_Count());
+	if(retval == FALSE)
+	{
+		/* attempt buffer unlock */
+		Autoguider_Buffer_Raw_Field_Unlock(buffer_index);
+		Autoguider_General_Error_Number = 507;
+		sprintf(Autoguider_General_Error_String,"Field_Expose_Buffer:CCD_Exposure_Expose failed.");
+		return FALSE;
+	}
+	/* save the exposure length, start time, CCD temperature for this buffer 
+	** for future reference (FITS headers) */
+	if(!Autoguider_Buffer_Field_Exposure_Length_Set(buffer_index,exposure_length))
+	{
+		Autoguider_General_Error("field","autoguider_field.c","Field_Expose_Buffer",
+					 LOG_VERBOSITY_VERBOSE,"FIELD");
+	}
+	retval = CCD_Exposure_Get_Exposure_Start_Time(&start_time);
+	if(retval == TRUE)
+	{
+		if(!Autoguider_Buffer_Field_Exposure_Start_Time_Set(buffer_index,start_time))
+		{
+			Autoguider_General_Error("field","autoguider_field.c","Field_Expose_Buffer",
+						 LOG_VERBOSITY_VERBOSE,"FIELD");
+		}
+	}
+	/* use the temperature published by the housekeeping thread, rather than querying the SDK */
+	retval = Autoguider_Housekeeping_Temperature_Get(&current_temperature,&temperature_status,&temperature_age);
+	if(retval)
+	{
+#if AUTOGUIDER_DEBUG > 9
+		Autoguider_General_Log_Format("field","autoguider_field.c","Field_Expose_Buffer",
+					      LOG_VERBOSITY_VERBOSE,"FIELD",
+					      "current temperature is %.2f C (%d ms old).",current_temperature,
+					      temperature_age);
+#endif
+		if(!Autoguider_Buffer_Field_CCD_Temperature_Set(buffer_index,current_temperature))
+		{
+			Autoguider_General_Error("field","autoguider_field.c","Field_Expose_Buffer",
+						 LOG_VERBOSITY_VERBOSE,"FIELD");
+		}
+	}
+#if AUTOGUIDER_DEBUG > 7
+	Autoguider_General_Log("field","autoguider_field.c","Field_Expose_Buffer",
+			       LOG_VERBOSITY_VERBOSE,"FIELD","exposure completed.");
+#endif
+	/* save raw FITS file, for debugging */
+	Field_Save_Raw_Image(buffer_ptr,Autoguider_Buffer_Get_Field_Binned_NCols(),
+			     Autoguider_Buffer_Get_Field_Binned_NRows(),exposure_length,current_temperature,start_time);
+	/* unlock readout buffer */
+#if AUTOGUIDER_DEBUG > 9
+	Autoguider_General_Log_Format("field","autoguider_field.c","Field_Expose_Buffer",
+				      LOG_VERBOSITY_VERBOSE,"FIELD","Unlocking raw field buffer %d.",buffer_index);
+#endif
+	retval = Autoguider_Buffer_Raw_Field_Unlock(buffer_index);
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 508;
+		sprintf(Autoguider_General_Error_String,"Field_Expose_Buffer:Autoguider_Buffer_Raw_Field_Unlock failed.");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Internal routine to speculatively start the next field exposure in another thread, whilst the current
+ * frame is reduced and checked. The exposure length is predicted from the peak counts of the last checked frame,
+ * scaled to the current exposure length, in the same way Field_Check_Done will choose it:
+ * <ul>
+ * <li>If there is no last checked frame, or it had no objects, we predict Field_Check_Done will double the
+ *     exposure length.
+ * <li>If the last checked frame had only one object, and its scaled peak counts are at least 
+ *     FIELD_OBJECT_PEAK_COUNTS_MAX, we predict Field_Check_Done will decrease the exposure length (saturated),
+ *     using Field_Exposure_Length_Predict on those peak counts.
+ * <li>Otherwise we predict Field_Check_Done will increase the exposure length (too faint), using
+ *     Field_Exposure_Length_Predict on the scaled brightest unsaturated peak counts.
+ * <li>The predicted exposure length is rounded to the nearest dark using Autoguider_Dark_Get_Exposure_Length_Nearest.
+ *     If this does not change the exposure length, Field_Check_Done would stop fielding, so
+ *     nothing is started.
+ * </ul>
+ * Failure to start the exposure is logged but not fatal, Autoguider_Field then just exposes serially.
+ * @param buffer_index The field buffer index to read the speculative exposure into. This should be the
+ *        buffer <b>not</b> being reduced.
+ * @see #Field_Data
+ * @see #Field_Pipeline_Data
+ * @see #Field_Pipeline_Thread
+ * @see #FIELD_OBJECT_PEAK_COUNTS_MAX
+ * @see #Field_Exposure_Length_Predict
+ * @see autoguider_dark.html#Autoguider_Dark_Get_Exposure_Length_Nearest
+ */
+static void Field_Pipeline_Start(int buffer_index)
+{
+	float scale,predicted_peak_counts;
+	int exposure_length,new_dark_exposure_length_index,retval;
+
+	exposure_length = Field_Data.Exposure_Length*2;
+	if((Field_Data.Trend_Object_Count > 0)&&(Field_Data.Trend_Exposure_Length > 0))
+	{
+		scale = ((float)Field_Data.Exposure_Length)/((float)Field_Data.Trend_Exposure_Length);
+		predicted_peak_counts = Field_Data.Trend_Peak_Counts*scale;
+		if((Field_Data.Trend_Object_Count == 1)&&(predicted_peak_counts >= FIELD_OBJECT_PEAK_COUNTS_MAX))
+			retval = Field_Exposure_Length_Predict(Field_Data.Exposure_Length,predicted_peak_counts,FALSE,
+							       &exposure_length);
+		else
+			retval = Field_Exposure_Length_Predict(Field_Data.Exposure_Length,
+							       Field_Data.Trend_Unsaturated_Peak_Counts*scale,TRUE,
+							       &exposure_length);
+		if(retval == FALSE)
+		{
+			Autoguider_General_Error("field","autoguider_field.c","Field_Pipeline_Start",
+						 LOG_VERBOSITY_VERBOSE,"FIELD"); /* no need to fail */
+			return;
+		}
+	}
+	if(!Autoguider_Dark_Get_Exposure_Length_Nearest(&exposure_length,&new_dark_exposure_length_index))
+	{
+		Autoguider_General_Error("field","autoguider_field.c","Field_Pipeline_Start",
+					 LOG_VERBOSITY_VERBOSE,"FIELD"); /* no need to fail */
+		return;
+	}
+	if(exposure_length == Field_Data.Exposure_Length)
+	{
+#if AUTOGUIDER_DEBUG > 5
+		Autoguider_General_Log_Format("field","autoguider_field.c","Field_Pipeline_Start",
+					      LOG_VERBOSITY_VERBOSE,"FIELD",
+					      "Predicted exposure length %d ms is the current one:not starting exposure.",
+					      exposure_length);
+#endif
+		return;
+	}
+	Field_Pipeline_Data.Buffer_Index = buffer_index;
+	Field_Pipeline_Data.Exposure_Length = exposure_length;
+	Field_Pipeline_Data.Dark_Exposure_Length_Index = new_dark_exposure_length_index;
+	Field_Pipeline_Data.Cancel = FALSE;
+	Field_Pipeline_Data.Exposure_Started = FALSE;
+	Field_Pipeline_Data.Is_Finished = FALSE;
+	Field_Pipeline_Data.Retval = FALSE;
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("field","autoguider_field.c","Field_Pipeline_Start",
+				      LOG_VERBOSITY_VERBOSE,"FIELD",
+				      "Starting speculative %d ms exposure (index %d) into buffer %d.",
+				      exposure_length,new_dark_exposure_length_index,buffer_index);
+#endif
+	retval = pthread_create(&(Field_Pipeline_Data.Thread),NULL,Field_Pipeline_Thread,(void *)NULL);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 546;
+		sprintf(Autoguider_General_Error_String,"Field_Pipeline_Start:pthread_create failed (%d).",retval);
+		Autoguider_General_Error("field","autoguider_field.c","Field_Pipeline_Start",
+					 LOG_VERBOSITY_VERBOSE,"FIELD"); /* no need to fail */
+		return;
+	}
+	Field_Pipeline_Data.Is_Running = TRUE;
+}
+
+/**
+ * Thread routine doing a speculative field exposure. Unless the exposure has already been cancelled,
+ * Exposure_Started is set and Field_Expose_Buffer called. The result is put in Field_Pipeline_Data.Retval,
+ * and Is_Finished is set to tell Field_Pipeline_Cancel to stop aborting.
+ * @param user_arg Not used.
+ * @return Always NULL.
+ * @see #Field_Pipeline_Data
+ * @see #Field_Expose_Buffer
+ * @see #Field_Pipeline_Cancel
+ */
+static void *Field_Pipeline_Thread(void *user_arg)
+{
+	int cancel;
+
+	pthread_mutex_lock(&(Field_Pipeline_Data.Mutex));
+	cancel = Field_Pipeline_Data.Cancel;
+	if(cancel == FALSE)
+		Field_Pipeline_Data.Exposure_Started = TRUE;
+	else
+		Field_Pipeline_Data.Is_Finished = TRUE;
+	pthread_mutex_unlock(&(Field_Pipeline_Data.Mutex));
+	if(cancel)
+		return NULL;
+	Field_Pipeline_Data.Retval = Field_Expose_Buffer(Field_Pipeline_Data.Buffer_Index,
+							 Field_Pipeline_Data.Exposure_Length);
+	pthread_mutex_lock(&(Field_Pipeline_Data.Mutex));
+	Field_Pipeline_Data.Is_Finished = TRUE;
+	pthread_mutex_unlock(&(Field_Pipeline_Data.Mutex));
+	return NULL;
+}
+
+/**
+ * Internal routine to wait for the speculative field exposure to finish.
+ * Field_Pipeline_Data.Is_Running should be TRUE when this is called.
+ * @return The routine returns TRUE if the exposure succeeded, and FALSE on failure.
+ * @see #Field_Pipeline_Data
+ */
+static int Field_Pipeline_Join(void)
+{
+	int retval;
+
+	retval = pthread_join(Field_Pipeline_Data.Thread,NULL);
+	Field_Pipeline_Data.Is_Running = FALSE;
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 547;
+		sprintf(Autoguider_General_Error_String,"Field_Pipeline_Join:pthread_join failed (%d).",retval);
+		return FALSE;
+	}
+	/* Field_Expose_Buffer has set the error number and string */
+	return Field_Pipeline_Data.Retval;
+}
+
+/**
+ * Internal routine to cancel the speculative field exposure, if one is running.
+ * The Cancel flag is set, so a thread that has not yet started exposing returns straight away.
+ * If the thread has already started exposing, CCD_Exposure_Abort is called every FIELD_PIPELINE_ABORT_PAUSE_MS
+ * milliseconds until the thread sets Is_Finished. The drivers reset their abort flag when an exposure starts,
+ * so a single abort sent before CCD_Exposure_Expose is reached would be lost, and the whole speculative exposure
+ * waited out. The thread is then joined. The (aborted) result of the exposure is ignored.
+ * Note the last frame of every successful field ends with a speculative exposure being aborted, so guiding starts
+ * up to the driver's abort latency (plus FIELD_PIPELINE_ABORT_PAUSE_MS) later than without pipelining.
+ * @see #Field_Pipeline_Data
+ * @see #FIELD_PIPELINE_ABORT_PAUSE_MS
+ * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Abort
+ */
+static void Field_Pipeline_Cancel(void)
+{
+	struct timespec sleep_time;
+	int exposure_started,is_finished;
+
+	if(Field_Pipeline_Data.Is_Running == FALSE)
+		return;
+	pthread_mutex_lock(&(Field_Pipeline_Data.Mutex));
+	Field_Pipeline_Data.Cancel = TRUE;
+	exposure_started = Field_Pipeline_Data.Exposure_Started;
+	is_finished = Field_Pipeline_Data.Is_Finished;
+	pthread_mutex_unlock(&(Field_Pipeline_Data.Mutex));
+	if(exposure_started)
+	{
+		while(is_finished == FALSE)
+		{
+			CCD_Exposure_Abort();
+			sleep_time.tv_sec = 0;
+			sleep_time.tv_nsec = FIELD_PIPELINE_ABORT_PAUSE_MS*AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS;
+			nanosleep(&sleep_time,NULL);
+			pthread_mutex_lock(&(Field_Pipeline_Data.Mutex));
+			is_finished = Field_Pipeline_Data.Is_Finished;
+			pthread_mutex_unlock(&(Field_Pipeline_Data.Mutex));
+		}
+	}
+	pthread_join(Field_Pipeline_Data.Thread,NULL);
+	Field_Pipeline_Data.Is_Running = FALSE;
+}
+
+/**
+ * Internal routine to save the number of objects, and the largest (and largest unsaturated) peak counts
+ * of the frame just checked, for Field_Pipeline_Start to predict the next exposure length from.
+ * @param exposure_length The exposure length of the frame just checked, in milliseconds.
+ * @see #Field_Data
+ * @see #Field_Pipeline_Start
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Count
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Object
+ */
+static void Field_Trend_Update(int exposure_length)
+{
+	struct Autoguider_Object_Struct object;
+	int object_count,i;
+
+	Field_Data.Trend_Exposure_Length = exposure_length;
+	Field_Data.Trend_Object_Count = -1;
+	Field_Data.Trend_Peak_Counts = 0.0f;
+	Field_Data.Trend_Unsaturated_Peak_Counts = 0.0f;
+	if(!Autoguider_Object_List_Get_Count(&object_count))
+		return;
+	for(i=0;i<object_count;i++)
+	{
+		if(!Autoguider_Object_List_Get_Object(i,&object))
+			return;
+		if(object.Peak_Counts > Field_Data.Trend_Peak_Counts)
+			Field_Data.Trend_Peak_Counts = object.Peak_Counts;
+		if((object.Peak_Counts > Field_Data.Trend_Unsaturated_Peak_Counts)&&
+		   (object.Peak_Counts < FIELD_OBJECT_PEAK_COUNTS_MAX))
+			Field_Data.Trend_Unsaturated_Peak_Counts = object.Peak_Counts;
+	}
+	Field_Data.Trend_Object_Count = object_count;
+}
+
+/**
+ * Internal routine to compute the next field exposure length, when Field_Check_Done has found objects but none
+ * are suitable to guide on. Field_Exposure_Length_Predict is used to compute the new exposure length, and
+ * Field_Data.Exposure_Length is set to it, which the caller rounds to the nearest dark.
+ * @param peak_counts The peak counts of the object to scale on.
+ * @param increase A boolean, TRUE if the exposure length should increase, FALSE if it should decrease.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Field_Data
+ * @see #Field_Check_Done
+ * @see #Field_Exposure_Length_Predict
+ */
+static int Field_Exposure_Length_Next(float peak_counts,int increase)
+{
+	int exposure_length;
+
+	if(!Field_Exposure_Length_Predict(Field_Data.Exposure_Length,peak_counts,increase,&exposure_length))
+		return FALSE;
+	Field_Data.Exposure_Length = exposure_length;
+	return TRUE;
+}
+
+/**
+ * Internal routine to predict the field exposure length to use after one of exposure_length.
+ * If Field_Data.Exposure_Model is TRUE, Autoguider_Exposure_Predict is used to jump to
+ * the exposure length that gives Field_Data.Target_Peak_Counts in the object with the specified peak counts.
+ * If the flux model is not in use, has no counts to work with, or does not move the exposure length in the
+ * specified direction, the exposure length is doubled (increase) or halved (decrease).
+ * This is used both by Field_Check_Done (through Field_Exposure_Length_Next) and Field_Pipeline_Start, so
+ * the speculative exposure is the one Field_Check_Done will ask for.
+ * @param exposure_length The exposure length the peak counts were (or are predicted to be) measured with,
+ *        in milliseconds.
+ * @param peak_counts The peak counts of the object to scale on.
+ * @param increase A boolean, TRUE if the exposure length should increase, FALSE if it should decrease.
+ * @param new_exposure_length The address of an integer, on a successful return set to the next exposure length
+ *        in milliseconds. This is not rounded to the nearest dark.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Field_Data
+ * @see #Field_Exposure_Length_Next
+ * @see #Field_Pipeline_Start
+ * @see autoguider_exposure.html#Autoguider_Exposure_Predict
+ * @see autoguider_object.html#Autoguider_Object_Median_Get
+ */
+static int Field_Exposure_Length_Predict(int exposure_length,float peak_counts,int increase,int *new_exposure_length)
+{
+	int changed;
+
+	changed = FALSE;
+	if(Field_Data.Exposure_Model&&(peak_counts > 0.0f))
+	{
+		if(!Autoguider_Exposure_Predict(exposure_length,peak_counts,peak_counts,
+						Autoguider_Object_Median_Get(),(float)(Field_Data.Target_Peak_Counts),
+						new_exposure_length,&changed))
+			return FALSE;
+		if(increase&&((*new_exposure_length) <= exposure_length))
+			changed = FALSE;
+		if((increase == FALSE)&&((*new_exposure_length) >= exposure_length))
+			changed = FALSE;
+	}
+	if(changed)
+	{
+#if AUTOGUIDER_DEBUG > 5
+		Autoguider_General_Log_Format("field","autoguider_field.c","Field_Exposure_Length_Predict",
+					      LOG_VERBOSITY_VERBOSE,"FIELD",
+					      "Peak counts %.2f in %d ms:flux model exposure length %d ms.",
+					      peak_counts,exposure_length,(*new_exposure_length));
+#endif
+	}
+	else if(increase)
+		(*new_exposure_length) = exposure_length*2.0f;
+	else
+		(*new_exposure_length) = exposure_length/2.0f;
+	return TRUE;
+}
+
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.17  2014/01/02 16:34:23  eng
@@ -0,0 +1,623 @@
+/* autoguider_fits_writer.c
+** Autoguider asynchronous FITS writer routines
+** $Header$
+*/
+/**
+ * Asynchronous FITS writer routines for the autoguider program.
+ * Callers hand over ownership of either an in-memory FITS image (as created by Autoguider_Get_Fits), or
+ * a snapshot of image data plus a FITS header, and a background writer thread writes it to disk, optionally
+ * Rice tile-compressing it. This keeps disk I/O out of the field and guide acquisition paths.
+ * Write failures are reported by the writer thread through Autoguider_General_Error.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fitsio.h"
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+
+#include "autoguider_fits_header.h"
+#include "autoguider_fits_writer.h"
+#include "autoguider_general.h"
+
+/* hash defines */
+/**
+ * The length of a job's filename.
+ */
+#define FITS_WRITER_FILENAME_LENGTH           (256)
+
+/* data types */
+/**
+ * Enumeration describing the type of a FITS writer job.
+ * <ul>
+ * <li>FITS_WRITER_JOB_BUFFER - Buffer contains a complete in-memory FITS image.
+ * <li>FITS_WRITER_JOB_IMAGE - Data contains NCols x NRows pixels of type Data_Type,
+ *     to be written with the keywords in Header.
+ * </ul>
+ */
+enum FITS_WRITER_JOB_TYPE
+{
+	FITS_WRITER_JOB_BUFFER=0,FITS_WRITER_JOB_IMAGE=1
+};
+
+/**
+ * Structure holding one FITS writer job. The job owns all allocated memory it points to.
+ * <dl>
+ * <dt>Type</dt> <dd>The type of job, see FITS_WRITER_JOB_TYPE.</dd>
+ * <dt>Filename</dt> <dd>The filename to write to.</dd>
+ * <dt>Buffer</dt> <dd>For FITS_WRITER_JOB_BUFFER, an allocated in-memory FITS image.</dd>
+ * <dt>Buffer_Length</dt> <dd>The length of Buffer in bytes.</dd>
+ * <dt>Data_Type</dt> <dd>For FITS_WRITER_JOB_IMAGE, the CFITSIO type of Data (TUSHORT or TFLOAT).</dd>
+ * <dt>Data</dt> <dd>For FITS_WRITER_JOB_IMAGE, the allocated pixel data.</dd>
+ * <dt>NCols</dt> <dd>For FITS_WRITER_JOB_IMAGE, the number of columns in Data.</dd>
+ * <dt>NRows</dt> <dd>For FITS_WRITER_JOB_IMAGE, the number of rows in Data.</dd>
+ * <dt>Header</dt> <dd>For FITS_WRITER_JOB_IMAGE, the FITS header keywords to write.</dd>
+ * <dt>Next</dt> <dd>The next job in the queue.</dd>
+ * </dl>
+ * @see #FITS_WRITER_JOB_TYPE
+ * @see autoguider_fits_header.html#Fits_Header_Struct
+ */
+struct Fits_Writer_Job_Struct
+{
+	enum FITS_WRITER_JOB_TYPE Type;
+	char Filename[FITS_WRITER_FILENAME_LENGTH];
+	void *Buffer;
+	size_t Buffer_Length;
+	int Data_Type;
+	void *Data;
+	int NCols;
+	int NRows;
+	struct Fits_Header_Struct Header;
+	struct Fits_Writer_Job_Struct *Next;
+};
+
+/**
+ * Structure holding FITS writer data.
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex protecting the job queue and statistics.</dd>
+ * <dt>Condition</dt> <dd>Condition variable signalled when a job is queued, or the writer is told to quit.</dd>
+ * <dt>Thread</dt> <dd>The writer thread.</dd>
+ * <dt>Compress</dt> <dd>Boolean, whether to Rice tile-compress the written images (fits.writer.compress).</dd>
+ * <dt>Max_Pending_Count</dt> <dd>The maximum number of queued jobs (fits.writer.queue_length).</dd>
+ * <dt>Head</dt> <dd>The oldest queued job.</dd>
+ * <dt>Tail</dt> <dd>The newest queued job.</dd>
+ * <dt>Pending_Count</dt> <dd>The number of queued jobs.</dd>
+ * <dt>Quit</dt> <dd>Boolean, set to tell the writer thread to write the queued jobs and quit.</dd>
+ * <dt>Is_Running</dt> <dd>Boolean, TRUE whilst the writer thread is running.</dd>
+ * <dt>Written_Count</dt> <dd>The number of images successfully written.</dd>
+ * <dt>Failed_Count</dt> <dd>The number of images that failed to be written.</dd>
+ * </dl>
+ * @see #Fits_Writer_Job_Struct
+ */
+struct Fits_Writer_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	pthread_t Thread;
+	int Compress;
+	int Max_Pending_Count;
+	struct Fits_Writer_Job_Struct *Head;
+	struct Fits_Writer_Job_Struct *Tail;
+	int Pending_Count;
+	int Quit;
+	int Is_Running;
+	int Written_Count;
+	int Failed_Count;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of FITS writer data. The mutex and condition variable are statically initialised.
+ * Until Autoguider_Fits_Writer_Initialise has started the writer thread, jobs are written synchronously.
+ * @see #Fits_Writer_Struct
+ */
+static struct Fits_Writer_Struct Fits_Writer_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER
+};
+
+/* internal functions */
+static int Fits_Writer_Job_Add(struct Fits_Writer_Job_Struct *job);
+static void *Fits_Writer_Thread(void *arg);
+static int Fits_Writer_Job_Write(struct Fits_Writer_Job_Struct *job);
+static void Fits_Writer_Job_Free(struct Fits_Writer_Job_Struct *job);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Initialise the FITS writer. Loads the following config:
+ * <ul>
+ * <li>"fits.writer.compress" - boolean.
+ * <li>"fits.writer.queue_length" - integer.
+ * </ul>
+ * and starts the writer thread.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Fits_Writer_Data
+ * @see #Fits_Writer_Thread
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Boolean
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ */
+int Autoguider_Fits_Writer_Initialise(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("fits_writer","autoguider_fits_writer.c","Autoguider_Fits_Writer_Initialise",
+			       LOG_VERBOSITY_TERSE,"FITS","started.");
+#endif
+	retval = CCD_Config_Get_Boolean("fits.writer.compress",&(Fits_Writer_Data.Compress));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1400;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Initialise:"
+			"Failed to load config:'fits.writer.compress'.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("fits.writer.queue_length",&(Fits_Writer_Data.Max_Pending_Count));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1401;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Initialise:"
+			"Failed to load config:'fits.writer.queue_length'.");
+		return FALSE;
+	}
+	if(Fits_Writer_Data.Max_Pending_Count < 1)
+	{
+		Autoguider_General_Error_Number = 1402;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Initialise:"
+			"Illegal fits.writer.queue_length %d.",Fits_Writer_Data.Max_Pending_Count);
+		return FALSE;
+	}
+	Fits_Writer_Data.Head = NULL;
+	Fits_Writer_Data.Tail = NULL;
+	Fits_Writer_Data.Pending_Count = 0;
+	Fits_Writer_Data.Quit = FALSE;
+	Fits_Writer_Data.Written_Count = 0;
+	Fits_Writer_Data.Failed_Count = 0;
+	retval = pthread_create(&(Fits_Writer_Data.Thread),NULL,&Fits_Writer_Thread,(void *)NULL);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 1403;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Initialise:"
+			"Failed to create writer thread (%d).",retval);
+		return FALSE;
+	}
+	Fits_Writer_Data.Is_Running = TRUE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("fits_writer","autoguider_fits_writer.c","Autoguider_Fits_Writer_Initialise",
+				      LOG_VERBOSITY_TERSE,"FITS","Compress = %d, queue length = %d:finished.",
+				      Fits_Writer_Data.Compress,Fits_Writer_Data.Max_Pending_Count);
+#endif
+	return TRUE;
+}
+
+/**
+ * Queue a complete in-memory FITS image (for instance, as returned by Autoguider_Get_Fits) to be written to disk.
+ * The FITS writer takes ownership of buffer_ptr, which is freed once written (or if an error occurs).
+ * @param filename The filename to write the image to.
+ * @param buffer_ptr A pointer to an allocated in-memory FITS image.
+ * @param buffer_length The length of the in-memory FITS image in bytes.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Fits_Writer_Job_Add
+ * @see autoguider_get_fits.html#Autoguider_Get_Fits
+ */
+int Autoguider_Fits_Writer_Buffer_Add(char *filename,void *buffer_ptr,size_t buffer_length)
+{
+	struct Fits_Writer_Job_Struct *job = NULL;
+
+	if(buffer_ptr == NULL)
+	{
+		Autoguider_General_Error_Number = 1404;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Buffer_Add:buffer_ptr was NULL.");
+		return FALSE;
+	}
+	if((filename == NULL)||(strlen(filename) >= FITS_WRITER_FILENAME_LENGTH))
+	{
+		free(buffer_ptr);
+		Autoguider_General_Error_Number = 1405;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Buffer_Add:Illegal filename.");
+		return FALSE;
+	}
+	job = (struct Fits_Writer_Job_Struct *)calloc(1,sizeof(struct Fits_Writer_Job_Struct));
+	if(job == NULL)
+	{
+		free(buffer_ptr);
+		Autoguider_General_Error_Number = 1406;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Buffer_Add:"
+			"Failed to allocate job for '%s'.",filename);
+		return FALSE;
+	}
+	job->Type = FITS_WRITER_JOB_BUFFER;
+	strcpy(job->Filename,filename);
+	job->Buffer = buffer_ptr;
+	job->Buffer_Length = buffer_length;
+	job->Next = NULL;
+	return Fits_Writer_Job_Add(job);
+}
+
+/**
+ * Queue an image snapshot and FITS header to be written to disk.
+ * The FITS writer takes ownership of data_ptr and the header's card list, which are freed once written
+ * (or if an error occurs).
+ * @param filename The filename to write the image to.
+ * @param data_type The CFITSIO data type of data_ptr, one of TUSHORT or TFLOAT.
+ * @param data_ptr A pointer to an allocated image of ncols x nrows pixels.
+ * @param ncols The number of columns in the image.
+ * @param nrows The number of rows in the image.
+ * @param header The FITS header keywords to write, after the basic image keywords.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Fits_Writer_Job_Add
+ * @see autoguider_fits_header.html#Fits_Header_Struct
+ */
+int Autoguider_Fits_Writer_Image_Add(char *filename,int data_type,void *data_ptr,int ncols,int nrows,
+				     struct Fits_Header_Struct header)
+{
+	struct Fits_Writer_Job_Struct *job = NULL;
+
+	if(data_ptr == NULL)
+	{
+		Autoguider_Fits_Header_Free(&header);
+		Autoguider_General_Error_Number = 1407;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Image_Add:data_ptr was NULL.");
+		return FALSE;
+	}
+	if((filename == NULL)||(strlen(filename) >= FITS_WRITER_FILENAME_LENGTH)||
+	   ((data_type != TUSHORT)&&(data_type != TFLOAT))||(ncols < 1)||(nrows < 1))
+	{
+		free(data_ptr);
+		Autoguider_Fits_Header_Free(&header);
+		Autoguider_General_Error_Number = 1408;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Image_Add:"
+			"Illegal argument (data_type=%d,ncols=%d,nrows=%d).",data_type,ncols,nrows);
+		return FALSE;
+	}
+	job = (struct Fits_Writer_Job_Struct *)calloc(1,sizeof(struct Fits_Writer_Job_Struct));
+	if(job == NULL)
+	{
+		free(data_ptr);
+		Autoguider_Fits_Header_Free(&header);
+		Autoguider_General_Error_Number = 1409;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Image_Add:"
+			"Failed to allocate job for '%s'.",filename);
+		return FALSE;
+	}
+	job->Type = FITS_WRITER_JOB_IMAGE;
+	strcpy(job->Filename,filename);
+	job->Data_Type = data_type;
+	job->Data = data_ptr;
+	job->NCols = ncols;
+	job->NRows = nrows;
+	job->Header = header;
+	job->Next = NULL;
+	return Fits_Writer_Job_Add(job);
+}
+
+/**
+ * Get the FITS writer statistics.
+ * @param written_count The address of an integer to store the number of images written.
+ * @param failed_count The address of an integer to store the number of images that failed to be written.
+ * @param pending_count The address of an integer to store the number of images waiting to be written.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Fits_Writer_Data
+ */
+int Autoguider_Fits_Writer_Stats_Get(int *written_count,int *failed_count,int *pending_count)
+{
+	if((written_count == NULL)||(failed_count == NULL)||(pending_count == NULL))
+	{
+		Autoguider_General_Error_Number = 1410;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Stats_Get:NULL argument.");
+		return FALSE;
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Fits_Writer_Data.Mutex)))
+		return FALSE;
+	(*written_count) = Fits_Writer_Data.Written_Count;
+	(*failed_count) = Fits_Writer_Data.Failed_Count;
+	(*pending_count) = Fits_Writer_Data.Pending_Count;
+	if(!Autoguider_General_Mutex_Unlock(&(Fits_Writer_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Shutdown the FITS writer. The writer thread is told to quit and joined. It writes any queued jobs first.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Fits_Writer_Data
+ */
+int Autoguider_Fits_Writer_Shutdown(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("fits_writer","autoguider_fits_writer.c","Autoguider_Fits_Writer_Shutdown",
+			       LOG_VERBOSITY_TERSE,"FITS","started.");
+#endif
+	if(Fits_Writer_Data.Is_Running)
+	{
+		if(!Autoguider_General_Mutex_Lock(&(Fits_Writer_Data.Mutex)))
+			return FALSE;
+		Fits_Writer_Data.Quit = TRUE;
+		pthread_cond_signal(&(Fits_Writer_Data.Condition));
+		if(!Autoguider_General_Mutex_Unlock(&(Fits_Writer_Data.Mutex)))
+			return FALSE;
+		retval = pthread_join(Fits_Writer_Data.Thread,NULL);
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1411;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Fits_Writer_Shutdown:"
+				"Failed to join writer thread (%d).",retval);
+			return FALSE;
+		}
+		Fits_Writer_Data.Is_Running = FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("fits_writer","autoguider_fits_writer.c","Autoguider_Fits_Writer_Shutdown",
+				      LOG_VERBOSITY_TERSE,"FITS","Written %d images, %d failed:finished.",
+				      Fits_Writer_Data.Written_Count,Fits_Writer_Data.Failed_Count);
+#endif
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Add a job to the tail of the writer queue, and signal the writer thread. If the writer thread is not running,
+ * the job is written synchronously. If the queue is full, the job is freed and an error returned.
+ * @param job The job to add, ownership is taken by this routine.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Fits_Writer_Data
+ * @see #Fits_Writer_Job_Write
+ * @see #Fits_Writer_Job_Free
+ */
+static int Fits_Writer_Job_Add(struct Fits_Writer_Job_Struct *job)
+{
+	int retval;
+
+	if(Fits_Writer_Data.Is_Running == FALSE)
+	{
+		retval = Fits_Writer_Job_Write(job);
+		Fits_Writer_Job_Free(job);
+		return retval;
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Fits_Writer_Data.Mutex)))
+	{
+		Fits_Writer_Job_Free(job);
+		return FALSE;
+	}
+	if(Fits_Writer_Data.Pending_Count >= Fits_Writer_Data.Max_Pending_Count)
+	{
+		Fits_Writer_Data.Failed_Count++;
+		Autoguider_General_Mutex_Unlock(&(Fits_Writer_Data.Mutex));
+		Autoguider_General_Error_Number = 1412;
+		sprintf(Autoguider_General_Error_String,"Fits_Writer_Job_Add:"
+			"Writer queue full (%d jobs):'%s' not written.",Fits_Writer_Data.Pending_Count,job->Filename);
+		Fits_Writer_Job_Free(job);
+		return FALSE;
+	}
+	if(Fits_Writer_Data.Tail == NULL)
+		Fits_Writer_Data.Head = job;
+	else
+		Fits_Writer_Data.Tail->Next = job;
+	Fits_Writer_Data.Tail = job;
+	Fits_Writer_Data.Pending_Count++;
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("fits_writer","autoguider_fits_writer.c","Fits_Writer_Job_Add",
+				      LOG_VERBOSITY_VERBOSE,"FITS","Queued '%s' (%d pending).",job->Filename,
+				      Fits_Writer_Data.Pending_Count);
+#endif
+	pthread_cond_signal(&(Fits_Writer_Data.Condition));
+	if(!Autoguider_General_Mutex_Unlock(&(Fits_Writer_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * The FITS writer thread. Waits for jobs to be queued, removes them from the queue and writes them.
+ * Failures are reported through Autoguider_General_Error. The thread quits when Fits_Writer_Data.Quit is set
+ * and the queue is empty.
+ * @param arg Not used.
+ * @return Always NULL.
+ * @see #Fits_Writer_Data
+ * @see #Fits_Writer_Job_Write
+ * @see #Fits_Writer_Job_Free
+ * @see autoguider_general.html#Autoguider_General_Error
+ */
+static void *Fits_Writer_Thread(void *arg)
+{
+	struct Fits_Writer_Job_Struct *job = NULL;
+	int retval;
+
+	if(!Autoguider_General_Mutex_Lock(&(Fits_Writer_Data.Mutex)))
+	{
+		Autoguider_General_Error("fits_writer","autoguider_fits_writer.c","Fits_Writer_Thread",
+					 LOG_VERBOSITY_TERSE,"FITS");
+		return NULL;
+	}
+	while(TRUE)
+	{
+		while((Fits_Writer_Data.Head == NULL)&&(Fits_Writer_Data.Quit == FALSE))
+			pthread_cond_wait(&(Fits_Writer_Data.Condition),&(Fits_Writer_Data.Mutex));
+		if(Fits_Writer_Data.Head == NULL)
+			break;
+		job = Fits_Writer_Data.Head;
+		Fits_Writer_Data.Head = job->Next;
+		if(Fits_Writer_Data.Head == NULL)
+			Fits_Writer_Data.Tail = NULL;
+		Autoguider_General_Mutex_Unlock(&(Fits_Writer_Data.Mutex));
+		retval = Fits_Writer_Job_Write(job);
+		if(retval == FALSE)
+		{
+			Autoguider_General_Error("fits_writer","autoguider_fits_writer.c","Fits_Writer_Thread",
+						 LOG_VERBOSITY_TERSE,"FITS");
+		}
+		Fits_Writer_Job_Free(job);
+		if(!Autoguider_General_Mutex_Lock(&(Fits_Writer_Data.Mutex)))
+		{
+			Autoguider_General_Error("fits_writer","autoguider_fits_writer.c","Fits_Writer_Thread",
+						 LOG_VERBOSITY_TERSE,"FITS");
+			return NULL;
+		}
+		Fits_Writer_Data.Pending_Count--;
+		if(retval)
+			Fits_Writer_Data.Written_Count++;
+		else
+			Fits_Writer_Data.Failed_Count++;
+	}
+	Autoguider_General_Mutex_Unlock(&(Fits_Writer_Data.Mutex));
+	return NULL;
+}
+
+/**
+ * Write a job to disk. Buffer jobs are written directly, or if Fits_Writer_Data.Compress is set, opened
+ * as a memory file and Rice tile-compressed into the output file. Image jobs are written with the
+ * basic image keywords, followed by the job's header keywords, optionally Rice tile-compressed.
+ * @param job The job to write.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Fits_Writer_Data
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Write_To_Fits
+ */
+static int Fits_Writer_Job_Write(struct Fits_Writer_Job_Struct *job)
+{
+	fitsfile *in_fits_fp = NULL;
+	fitsfile *out_fits_fp = NULL;
+	FILE *fp = NULL;
+	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
+	long axes[2];
+	size_t retval;
+	int cfitsio_status = 0;
+	int close_status = 0;
+
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("fits_writer","autoguider_fits_writer.c","Fits_Writer_Job_Write",
+				      LOG_VERBOSITY_VERBOSE,"FITS","Writing '%s'.",job->Filename);
+#endif
+	if((job->Type == FITS_WRITER_JOB_BUFFER)&&(Fits_Writer_Data.Compress == FALSE))
+	{
+		fp = fopen(job->Filename,"wb");
+		if(fp == NULL)
+		{
+			Autoguider_General_Error_Number = 1413;
+			sprintf(Autoguider_General_Error_String,"Fits_Writer_Job_Write:"
+				"Failed to open output filename '%s' (%d).",job->Filename,errno);
+			return FALSE;
+		}
+		retval = fwrite(job->Buffer,sizeof(char),job->Buffer_Length,fp);
+		if(retval != job->Buffer_Length)
+		{
+			fclose(fp);
+			Autoguider_General_Error_Number = 1414;
+			sprintf(Autoguider_General_Error_String,"Fits_Writer_Job_Write:"
+				"Failed to write output (%ld of %ld) to %s.",(long)retval,(long)job->Buffer_Length,
+				job->Filename);
+			return FALSE;
+		}
+		if(fclose(fp) != 0)
+		{
+			Autoguider_General_Error_Number = 1415;
+			sprintf(Autoguider_General_Error_String,"Fits_Writer_Job_Write:"
+				"Failed to close output filename '%s' (%d).",job->Filename,errno);
+			return FALSE;
+		}
+		return TRUE;
+	}
+	/* CFITSIO refuses to overwrite an existing file unless the filename is prefixed with '!' */
+	unlink(job->Filename);
+	fits_create_file(&out_fits_fp,job->Filename,&cfitsio_status);
+	if(job->Type == FITS_WRITER_JOB_BUFFER)
+	{
+		/* compress in-memory FITS image into the output file */
+		fits_open_memfile(&in_fits_fp,job->Filename,READONLY,&(job->Buffer),&(job->Buffer_Length),0,NULL,
+				  &cfitsio_status);
+		fits_set_compression_type(out_fits_fp,RICE_1,&cfitsio_status);
+		fits_img_compress(in_fits_fp,out_fits_fp,&cfitsio_status);
+		if(in_fits_fp != NULL)
+			fits_close_file(in_fits_fp,&close_status);
+	}
+	else
+	{
+		if(Fits_Writer_Data.Compress)
+			fits_set_compression_type(out_fits_fp,RICE_1,&cfitsio_status);
+		axes[0] = job->NCols;
+		axes[1] = job->NRows;
+		if(job->Data_Type == TUSHORT)
+			fits_create_img(out_fits_fp,USHORT_IMG,2,axes,&cfitsio_status);
+		else
+			fits_create_img(out_fits_fp,FLOAT_IMG,2,axes,&cfitsio_status);
+		fits_write_img(out_fits_fp,job->Data_Type,1,job->NCols*job->NRows,job->Data,&cfitsio_status);
+		if((cfitsio_status == 0)&&(!Autoguider_Fits_Header_Write_To_Fits(job->Header,out_fits_fp)))
+		{
+			cfitsio_status = 0;
+			fits_close_file(out_fits_fp,&cfitsio_status);
+			return FALSE;
+		}
+	}
+	if(cfitsio_status)
+	{
+		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+		if(out_fits_fp != NULL)
+		{
+			cfitsio_status = 0;
+			fits_close_file(out_fits_fp,&cfitsio_status);
+		}
+		Autoguider_General_Error_Number = 1416;
+		sprintf(Autoguider_General_Error_String,"Fits_Writer_Job_Write:"
+			"Failed to write '%s' : %s.",job->Filename,cfitsio_error_buff);
+		return FALSE;
+	}
+	fits_close_file(out_fits_fp,&cfitsio_status);
+	if(cfitsio_status)
+	{
+		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+		Autoguider_General_Error_Number = 1417;
+		sprintf(Autoguider_General_Error_String,"Fits_Writer_Job_Write:"
+			"Failed to close '%s' : %s.",job->Filename,cfitsio_error_buff);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Free a job, and all the memory it owns.
+ * @param job The job to free.
+ * @see autoguider_fits_header.html#Autoguider_Fits_Header_Free
+ */
+static void Fits_Writer_Job_Free(struct Fits_Writer_Job_Struct *job)
+{
+	if(job == NULL)
+		return;
+	if(job->Buffer != NULL)
+		free(job->Buffer);
+	if(job->Data != NULL)
+		free(job->Data);
+	if(job->Type == FITS_WRITER_JOB_IMAGE)
+		Autoguider_Fits_Header_Free(&(job->Header));
+	free(job);
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
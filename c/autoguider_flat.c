@@ -31,6 +31,7 @@
 #include "ccd_general.h"
 #include "ccd_setup.h"
 
+#include "autoguider_calibration_cache.h"
 #include "autoguider_field.h"
 #include "autoguider_flat.h"
 #include "autoguider_general.h"
@@ -52,7 +53,11 @@
  * <dt>Reduced_Inverted_Bin_Y</dt> <dd>Y binning in flat data actually loaded into Reduced_Inverted_Data.</dd>
  * <dt>Reduced_Inverted_Data</dt> <dd>Pointer to float data containing the reduced inverted flat.</dd>
  * <dt>Reduced_Mutex</dt> <dd>A mutex to lock access to the reduced data field.</dd>
+ * <dt>Current_Data</dt> <dd>Pointer to the reduced inverted flat currently used for flat fielding. This is either
+ *     Reduced_Inverted_Data, or the Data of Calibration_Map.</dd>
+ * <dt>Calibration_Map</dt> <dd>The calibration cache file mapped for the current flat, if any.</dd>
  * </dl>
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Map_Struct
  */
 struct Flat_Struct
 {
@@ -66,6 +71,8 @@ struct Flat_Struct
 	int Reduced_Inverted_Bin_Y;
 	float *Reduced_Inverted_Data;
 	pthread_mutex_t Reduced_Mutex;
+	float *Current_Data;
+	struct Autoguider_Calibration_Cache_Map_Struct Calibration_Map;
 };
 
 /* internal data */
@@ -80,7 +87,8 @@ static char rcsid[] = "$Id: autoguider_flat.c,v 1.5 2014-01-31 15:47:57 cjm Exp
 static struct Flat_Struct Flat_Data = 
 {
 	0,0,-1,-1,0,0,
-	-1,-1,NULL,PTHREAD_MUTEX_INITIALIZER
+	-1,-1,NULL,PTHREAD_MUTEX_INITIALIZER,
+	NULL,{NULL,0,NULL}
 };
 
 /* internal functions */
@@ -206,6 +214,15 @@ int Autoguider_Flat_Set_Dimension(int ncols,int nrows,int x_bin,int y_bin)
 			Flat_Data.Binned_NCols,Flat_Data.Binned_NRows);
 		return FALSE;
 	}
+	/* any mapped flat is now the wrong size, force a reload */
+	Flat_Data.Current_Data = Flat_Data.Reduced_Inverted_Data;
+	if(!Autoguider_Calibration_Cache_Unmap(&(Flat_Data.Calibration_Map)))
+	{
+		Autoguider_General_Error("flat","autoguider_flat.c","Autoguider_Flat_Set_Dimension",
+					 LOG_VERBOSITY_INTERMEDIATE,"FLAT"); /* no need to fail */
+	}
+	Flat_Data.Reduced_Inverted_Bin_X = -1;
+	Flat_Data.Reduced_Inverted_Bin_Y = -1;
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Flat_Data.Reduced_Mutex));
 	if(retval == FALSE)
@@ -429,7 +446,7 @@ int Autoguider_Flat_Field(float *buffer_ptr,int pixel_count,int ncols,int nrows,
 	for(buffer_y=0;buffer_y<buffer_nrows;buffer_y++)
 	{
 		current_buffer_ptr = buffer_ptr+(buffer_y*buffer_ncols);
-		current_flat_ptr = Flat_Data.Reduced_Inverted_Data+(((flat_start_y+buffer_y)*Flat_Data.Binned_NCols)+
+		current_flat_ptr = Flat_Data.Current_Data+(((flat_start_y+buffer_y)*Flat_Data.Binned_NCols)+
 							   flat_start_x);
 #if AUTOGUIDER_DEBUG > 9
 		if(buffer_y==0)
@@ -440,9 +457,9 @@ int Autoguider_Flat_Field(float *buffer_ptr,int pixel_count,int ncols,int nrows,
 					       current_buffer_ptr,buffer_ptr,buffer_y,buffer_ncols);
 			Autoguider_General_Log_Format("flat","autoguider_flat.c","Autoguider_Flat_Field",
 						      LOG_VERBOSITY_VERY_VERBOSE,"FLAT",
-				     "current_flat_ptr %p = Flat_Data.Reduced_Inverted_Data %p+ (((flat_start_y %d + "
+				     "current_flat_ptr %p = Flat_Data.Current_Data %p+ (((flat_start_y %d + "
 					       "buffer_y %d)*Flat_Data.Binned_NCols %d)+flat_start_x %d.",
-					       current_flat_ptr,Flat_Data.Reduced_Inverted_Data,flat_start_y,buffer_y,
+					       current_flat_ptr,Flat_Data.Current_Data,flat_start_y,buffer_y,
 					       Flat_Data.Binned_NCols,flat_start_x);
 		}
 #endif
@@ -494,6 +511,82 @@ int Autoguider_Flat_Field(float *buffer_ptr,int pixel_count,int ncols,int nrows,
 	return TRUE;
 }
 
+/**
+ * Routine to flat field a band of rows of a full frame buffer, using the currently loaded reduced (inverted) flat.
+ * This does the same per-pixel operation as an unwindowed Autoguider_Flat_Field, but only on rows
+ * start_row..(start_row+row_count-1), so different bands of the same frame can be flat fielded in parallel.
+ * Pixels where the flat is zero are left unchanged, and counted.
+ * @param buffer_ptr The <b>full frame</b> buffer requiring the currently loaded flat to be applied to it.
+ *        If the buffer has an associated mutex, this should have been locked <b>before</b> calling this routine,
+ *        this routine does <b>not</b> lock/unclock mutexs.
+ * @param ncols The number of columns in the <b>full frame</b>.
+ * @param nrows The number of rows in the <b>full frame</b>.
+ * @param start_row The first row of the band to flat field.
+ * @param row_count The number of rows in the band.
+ * @param flat_zero_count The address of an integer, on return set to the number of pixels in the band
+ *        where the flat was zero. Can be NULL.
+ * @param error_number The address of an integer, on failure set to the error number. As bands are processed by
+ *        different threads, errors are returned here rather than in Autoguider_General_Error_Number.
+ * @param error_string A string of AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH characters, on failure set to the
+ *        error message.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Autoguider_Flat_Field
+ * @see #Flat_Data
+ * @see autoguider.general.html#AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH
+ */
+int Autoguider_Flat_Field_Rows(float *buffer_ptr,int ncols,int nrows,int start_row,int row_count,
+			       int *flat_zero_count,int *error_number,char *error_string)
+{
+	float *current_buffer_ptr = NULL;
+	float *current_flat_ptr = NULL;
+	int i,pixel_count,zero_count;
+
+	if((error_number == NULL)||(error_string == NULL))
+	{
+		Autoguider_General_Error_Number = 930;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Flat_Field_Rows:"
+			"error_number/error_string was NULL.");
+		return FALSE;
+	}
+	if(buffer_ptr == NULL)
+	{
+		(*error_number) = 925;
+		sprintf(error_string,"Autoguider_Flat_Field_Rows:buffer_ptr was NULL.");
+		return FALSE;
+	}
+	if((ncols != Flat_Data.Binned_NCols)||(nrows != Flat_Data.Binned_NRows))
+	{
+		(*error_number) = 926;
+		sprintf(error_string,"Autoguider_Flat_Field_Rows:"
+			"buffer dimension mismatch: (%d,%d) != flat (%d,%d).",ncols,nrows,
+			Flat_Data.Binned_NCols,Flat_Data.Binned_NRows);
+		return FALSE;
+	}
+	if((start_row < 0)||(row_count < 0)||((start_row+row_count) > nrows))
+	{
+		(*error_number) = 927;
+		sprintf(error_string,"Autoguider_Flat_Field_Rows:"
+			"Illegal band: start row %d, row count %d, nrows %d.",start_row,row_count,nrows);
+		return FALSE;
+	}
+	/* the buffer and flat rows are the same length, so the band is contiguous in both */
+	current_buffer_ptr = buffer_ptr+(start_row*ncols);
+	current_flat_ptr = Flat_Data.Current_Data+(start_row*ncols);
+	pixel_count = row_count*ncols;
+	zero_count = 0;
+	for(i=0;i<pixel_count;i++)
+	{
+		/* flat should have been inverted at load time - so multiple through by it */
+		if(current_flat_ptr[i] != 0.0f)
+			current_buffer_ptr[i] *= current_flat_ptr[i];
+		else
+			zero_count++;
+	}
+	if(flat_zero_count != NULL)
+		(*flat_zero_count) = zero_count;
+	return TRUE;
+}
+
 /**
  * Free the allocated buffers.
  * Locks/unlocks the associated mutex.
@@ -522,6 +615,12 @@ int Autoguider_Flat_Shutdown(void)
 	if(Flat_Data.Reduced_Inverted_Data != NULL)
 		free(Flat_Data.Reduced_Inverted_Data);
 	Flat_Data.Reduced_Inverted_Data = NULL;
+	Flat_Data.Current_Data = NULL;
+	if(!Autoguider_Calibration_Cache_Unmap(&(Flat_Data.Calibration_Map)))
+	{
+		Autoguider_General_Error("flat","autoguider_flat.c","Autoguider_Flat_Shutdown",
+					 LOG_VERBOSITY_INTERMEDIATE,"FLAT"); /* no need to fail */
+	}
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Flat_Data.Reduced_Mutex));
 	if(retval == FALSE)
@@ -533,6 +632,87 @@ int Autoguider_Flat_Shutdown(void)
 	return TRUE;
 }
 
+/**
+ * Mark the loaded flat as out of date, so the next call to Autoguider_Flat_Set reloads it from disc
+ * (through the calibration cache, which notices the FITS image has changed), even if the binning is the same.
+ * Used after a new master flat has been written over the configured filename.
+ * Locks/unlocks the associated mutex.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Flat_Data
+ * @see #Autoguider_Flat_Set
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
+ */
+int Autoguider_Flat_Invalidate(void)
+{
+	int retval;
+
+	retval = Autoguider_General_Mutex_Lock(&(Flat_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	Flat_Data.Reduced_Inverted_Bin_X = -1;
+	Flat_Data.Reduced_Inverted_Bin_Y = -1;
+	retval = Autoguider_General_Mutex_Unlock(&(Flat_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Copy a flat supplied by the caller into the reduced flat buffer, inverting each pixel as Flat_Load_Reduced does,
+ * and use it for flat fielding. The buffer must be the size set by Autoguider_Flat_Set_Dimension. The flat is
+ * marked out of date, so the next call to Autoguider_Flat_Set loads the configured flat over it. Used by test
+ * programs that have no flat FITS images. Locks/unlocks the associated mutex.
+ * @param data_ptr The (non-inverted) flat data, Binned_NCols x Binned_NRows pixels. No pixel should be zero.
+ * @param pixel_count The number of pixels in data_ptr.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Flat_Data
+ * @see #Autoguider_Flat_Set_Dimension
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Unmap
+ * @see autoguider.general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider.general.html#Autoguider_General_Mutex_Unlock
+ * @see autoguider.general.html#Autoguider_General_Error_Number
+ * @see autoguider.general.html#Autoguider_General_Error_String
+ */
+int Autoguider_Flat_Set_Data(float *data_ptr,int pixel_count)
+{
+	int retval,i;
+
+	if(data_ptr == NULL)
+	{
+		Autoguider_General_Error_Number = 928;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Flat_Set_Data:data_ptr was NULL.");
+		return FALSE;
+	}
+	retval = Autoguider_General_Mutex_Lock(&(Flat_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	if((Flat_Data.Reduced_Inverted_Data == NULL)||
+	   (pixel_count != (Flat_Data.Binned_NCols*Flat_Data.Binned_NRows)))
+	{
+		Autoguider_General_Mutex_Unlock(&(Flat_Data.Reduced_Mutex));
+		Autoguider_General_Error_Number = 929;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Flat_Set_Data:"
+			"pixel_count %d does not match flat dimensions (%d,%d).",pixel_count,
+			Flat_Data.Binned_NCols,Flat_Data.Binned_NRows);
+		return FALSE;
+	}
+	Flat_Data.Current_Data = Flat_Data.Reduced_Inverted_Data;
+	if(!Autoguider_Calibration_Cache_Unmap(&(Flat_Data.Calibration_Map)))
+	{
+		Autoguider_General_Mutex_Unlock(&(Flat_Data.Reduced_Mutex));
+		return FALSE;
+	}
+	for(i=0;i<pixel_count;i++)
+		Flat_Data.Reduced_Inverted_Data[i] = 1.0f/data_ptr[i];
+	Flat_Data.Reduced_Inverted_Bin_X = -1;
+	Flat_Data.Reduced_Inverted_Bin_Y = -1;
+	retval = Autoguider_General_Mutex_Unlock(&(Flat_Data.Reduced_Mutex));
+	if(retval == FALSE)
+		return FALSE;
+	return TRUE;
+}
+
 
 /* ----------------------------------------------------------------------------
 ** 		internal functions 
@@ -543,10 +723,17 @@ int Autoguider_Flat_Shutdown(void)
  * The NAXIS1 / NAXIS2 keywords in the FITS image must agree with Flat_Data.Binned_NCols and Flat_Data.Binned_NRows.
  * Once the flat is loaded, it is inverted: each pixel = 1/pixel value. This allows the actual flat routine to
  * multiply through by the flat rather than divide through, this is quicker.
+ * If the calibration cache is enabled, and there is an up to date cache file for the flat, it is mapped
+ * using Autoguider_Calibration_Cache_Map and used directly instead. Otherwise, once the flat has been loaded
+ * and inverted, a cache file is created using Autoguider_Calibration_Cache_Create for next time.
  * @param filename The filename of a FITS image containing the flat to load.
  * @param bin_x The expected X binning of the FITS image.
  * @param bin_y The expected Y binning of the FITS image.
  * @see #Flat_Data
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Is_Enabled
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Map
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Unmap
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Create
  * @see autoguider.general.html#Autoguider_General_Mutex_Lock
  * @see autoguider.general.html#Autoguider_General_Mutex_Unlock
  * @see autoguider.general.html#Autoguider_General_Log
@@ -557,7 +744,7 @@ static int Flat_Load_Reduced(char *filename,int bin_x,int bin_y)
 {
 	fitsfile *fits_fp = NULL;
 	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
-	int retval,naxis,naxis1,naxis2,pixel_count,cfitsio_status=0,i;
+	int retval,naxis,naxis1,naxis2,pixel_count,cfitsio_status=0,i,found;
 
 #if AUTOGUIDER_DEBUG > 5
 	Autoguider_General_Log("flat","autoguider_flat.c","Flat_Load_Reduced",
@@ -569,6 +756,36 @@ static int Flat_Load_Reduced(char *filename,int bin_x,int bin_y)
 	retval = Autoguider_General_Mutex_Lock(&(Flat_Data.Reduced_Mutex));
 	if(retval == FALSE)
 		return FALSE;
+	/* release the previously mapped flat */
+	Flat_Data.Current_Data = Flat_Data.Reduced_Inverted_Data;
+	if(!Autoguider_Calibration_Cache_Unmap(&(Flat_Data.Calibration_Map)))
+	{
+		Autoguider_General_Mutex_Unlock(&(Flat_Data.Reduced_Mutex));
+		return FALSE;
+	}
+	/* use the cached inverted flat, if it is up to date */
+	if(Autoguider_Calibration_Cache_Is_Enabled())
+	{
+		found = FALSE;
+		if(!Autoguider_Calibration_Cache_Map(filename,AUTOGUIDER_CALIBRATION_CACHE_TYPE_FLAT,
+					      Flat_Data.Binned_NCols,Flat_Data.Binned_NRows,bin_x,bin_y,0,
+						     &(Flat_Data.Calibration_Map),&found))
+		{
+			Autoguider_General_Error("flat","autoguider_flat.c","Flat_Load_Reduced",
+						 LOG_VERBOSITY_INTERMEDIATE,"FLAT"); /* no need to fail */
+			found = FALSE;
+		}
+		if(found)
+		{
+			Flat_Data.Current_Data = Flat_Data.Calibration_Map.Data;
+			Flat_Data.Bin_X = bin_x;
+			Flat_Data.Bin_Y = bin_y;
+			retval = Autoguider_General_Mutex_Unlock(&(Flat_Data.Reduced_Mutex));
+			if(retval == FALSE)
+				return FALSE;
+			return TRUE;
+		}
+	}
 	/* initialise cfitsio status variable */
 	cfitsio_status=0;
 	/* open flat FITS file */
@@ -705,6 +922,17 @@ static int Flat_Load_Reduced(char *filename,int bin_x,int bin_y)
 			Flat_Data.Reduced_Inverted_Data[i] = 1.0f;
 		}
 	}
+	/* save the inverted flat in the calibration cache */
+	if(Autoguider_Calibration_Cache_Is_Enabled())
+	{
+		if(!Autoguider_Calibration_Cache_Create(filename,AUTOGUIDER_CALIBRATION_CACHE_TYPE_FLAT,
+					      Flat_Data.Binned_NCols,Flat_Data.Binned_NRows,bin_x,bin_y,0,
+							Flat_Data.Reduced_Inverted_Data))
+		{
+			Autoguider_General_Error("flat","autoguider_flat.c","Flat_Load_Reduced",
+						 LOG_VERBOSITY_INTERMEDIATE,"FLAT"); /* no need to fail */
+		}
+	}
 	/* update current reduced flat meta-data */
 	Flat_Data.Bin_X = bin_x;
 	Flat_Data.Bin_Y = bin_y;
@@ -785,6 +785,169 @@ int Autoguider_General_Add_String(char **string,char *add)
 	return TRUE;
 }
 
+/**
+ * Initialise a reply buffer, so it contains an empty reply and no allocated memory.
+ * @param reply The address of the reply buffer to initialise.
+ * @see #Autoguider_General_Reply_Struct
+ */
+void Autoguider_General_Reply_Initialise(struct Autoguider_General_Reply_Struct *reply)
+{
+	if(reply == NULL)
+		return;
+	reply->String = NULL;
+	reply->Length = 0;
+	reply->Allocated_Length = 0;
+}
+
+/**
+ * Make sure the reply buffer has room for at least add_length more characters (plus a terminating NULL).
+ * The allocated length is doubled (starting from AUTOGUIDER_GENERAL_REPLY_INITIAL_LENGTH) until it is large
+ * enough, so the cost of building a reply is linear in it's length.
+ * @param reply The address of the reply buffer.
+ * @param add_length The number of characters about to be added to the reply.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Autoguider_General_Reply_Struct
+ * @see #AUTOGUIDER_GENERAL_REPLY_INITIAL_LENGTH
+ * @see #Autoguider_General_Error_Number
+ * @see #Autoguider_General_Error_String
+ */
+int Autoguider_General_Reply_Reserve(struct Autoguider_General_Reply_Struct *reply,size_t add_length)
+{
+	char *new_string = NULL;
+	size_t new_length;
+
+	if(reply == NULL)
+	{
+		Autoguider_General_Error_Number = 114;
+		sprintf(Autoguider_General_Error_String,"Autoguider_General_Reply_Reserve:reply was NULL.");
+		return FALSE;
+	}
+	if((reply->Length+add_length+1) <= reply->Allocated_Length)
+		return TRUE;
+	new_length = reply->Allocated_Length;
+	if(new_length < AUTOGUIDER_GENERAL_REPLY_INITIAL_LENGTH)
+		new_length = AUTOGUIDER_GENERAL_REPLY_INITIAL_LENGTH;
+	while(new_length < (reply->Length+add_length+1))
+		new_length *= 2;
+	new_string = (char*)realloc(reply->String,new_length*sizeof(char));
+	if(new_string == NULL)
+	{
+		Autoguider_General_Error_Number = 115;
+		sprintf(Autoguider_General_Error_String,"Autoguider_General_Reply_Reserve:"
+			"Memory allocation error (%ld).",new_length);
+		return FALSE;
+	}
+	if(reply->String == NULL)
+		new_string[0] = '\0';
+	reply->String = new_string;
+	reply->Allocated_Length = new_length;
+	return TRUE;
+}
+
+/**
+ * Append a string to a reply buffer. 
+ * @param reply The address of the reply buffer.
+ * @param add A string to append to the current contents of the reply. If NULL nothing is added.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Autoguider_General_Reply_Struct
+ * @see #Autoguider_General_Reply_Reserve
+ */
+int Autoguider_General_Reply_Add(struct Autoguider_General_Reply_Struct *reply,char *add)
+{
+	size_t add_length;
+
+	if(add == NULL)
+		return TRUE;
+	add_length = strlen(add);
+	if(!Autoguider_General_Reply_Reserve(reply,add_length))
+		return FALSE;
+	memcpy(reply->String+reply->Length,add,add_length+1);
+	reply->Length += add_length;
+	return TRUE;
+}
+
+/**
+ * Append a printf style formatted string to a reply buffer. The string is formatted directly into the
+ * reply buffer.
+ * @param reply The address of the reply buffer.
+ * @param format The printf style format string.
+ * @param ... The arguments to the format string.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Autoguider_General_Reply_Struct
+ * @see #Autoguider_General_Reply_Reserve
+ * @see #Autoguider_General_Error_Number
+ * @see #Autoguider_General_Error_String
+ */
+int Autoguider_General_Reply_Add_Format(struct Autoguider_General_Reply_Struct *reply,char *format,...)
+{
+	va_list ap;
+	int add_length;
+
+	if(format == NULL)
+	{
+		Autoguider_General_Error_Number = 116;
+		sprintf(Autoguider_General_Error_String,"Autoguider_General_Reply_Add_Format:format was NULL.");
+		return FALSE;
+	}
+	/* try to format into the space already allocated */
+	if(!Autoguider_General_Reply_Reserve(reply,0))
+		return FALSE;
+	va_start(ap,format);
+	add_length = vsnprintf(reply->String+reply->Length,reply->Allocated_Length-reply->Length,format,ap);
+	va_end(ap);
+	if(add_length < 0)
+	{
+		reply->String[reply->Length] = '\0';
+		Autoguider_General_Error_Number = 117;
+		sprintf(Autoguider_General_Error_String,"Autoguider_General_Reply_Add_Format:"
+			"Formatting '%.80s' failed.",format);
+		return FALSE;
+	}
+	/* if it didn't fit, grow the buffer and format again */
+	if((reply->Length+add_length+1) > reply->Allocated_Length)
+	{
+		if(!Autoguider_General_Reply_Reserve(reply,add_length))
+		{
+			reply->String[reply->Length] = '\0';
+			return FALSE;
+		}
+		va_start(ap,format);
+		vsnprintf(reply->String+reply->Length,reply->Allocated_Length-reply->Length,format,ap);
+		va_end(ap);
+	}
+	reply->Length += add_length;
+	return TRUE;
+}
+
+/**
+ * Empty the reply buffer, without freeing it's memory, so it can be reused.
+ * @param reply The address of the reply buffer.
+ * @see #Autoguider_General_Reply_Struct
+ */
+void Autoguider_General_Reply_Reset(struct Autoguider_General_Reply_Struct *reply)
+{
+	if(reply == NULL)
+		return;
+	reply->Length = 0;
+	if(reply->String != NULL)
+		reply->String[0] = '\0';
+}
+
+/**
+ * Free the memory allocated to a reply buffer, and re-initialise it.
+ * @param reply The address of the reply buffer.
+ * @see #Autoguider_General_Reply_Struct
+ * @see #Autoguider_General_Reply_Initialise
+ */
+void Autoguider_General_Reply_Free(struct Autoguider_General_Reply_Struct *reply)
+{
+	if(reply == NULL)
+		return;
+	if(reply->String != NULL)
+		free(reply->String);
+	Autoguider_General_Reply_Initialise(reply);
+}
+
 /**
  * Add an integer to a list of integers.
  * @param add The integer value to add.
@@ -831,6 +994,23 @@ int Autoguider_General_Int_List_Sort(const void *f,const void *s)
 	return (*(int*)f) - (*(int*)s);
 }
 
+/**
+ * Routine to check a filename supplied by a client is a plain leafname, so it can be safely appended to a
+ * configured directory: it must not be empty, must not contain a '/', and must not be "." or "..".
+ * @param filename The filename to check.
+ * @return Returns TRUE if the filename is a plain leafname, FALSE otherwise.
+ */
+int Autoguider_General_Filename_Is_Leafname(char *filename)
+{
+	if((filename == NULL)||(filename[0] == '\0'))
+		return FALSE;
+	if(strchr(filename,'/') != NULL)
+		return FALSE;
+	if((strcmp(filename,".") == 0)||(strcmp(filename,"..") == 0))
+		return FALSE;
+	return TRUE;
+}
+
 /**
  * Routine to lock a access mutex. This will block until the mutex has been acquired,
  * unless an error occurs.
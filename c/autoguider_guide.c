@@ -38,13 +38,19 @@
 #include "ngatcil_tcs_guide_packet.h"
 
 #include "autoguider_buffer.h"
+#include "autoguider_calibrate.h"
 #include "autoguider_cil.h"
 #include "autoguider_dark.h"
+#include "autoguider_exposure.h"
 #include "autoguider_field.h"
 #include "autoguider_flat.h"
 #include "autoguider_general.h"
 #include "autoguider_guide.h"
+#include "autoguider_guide_recorder.h"
+#include "autoguider_housekeeping.h"
 #include "autoguider_object.h"
+#include "autoguider_realtime.h"
+#include "autoguider_telemetry.h"
 
 /* enums */
 /**
@@ -74,6 +80,8 @@ enum GUIDE_SCALE_TYPE
  *     ready for resacaling.</dd>
  * <dt>Scale_Count</dt> <dd>How many guide loops to wait before rescaling.</dd>
  * <dt>Scale_Up</dt> <dd>Boolean, if TRUE scale direction is up (increased exp length), otherwise down.</dd>
+ * <dt>Model</dt> <dd>Boolean, if TRUE use Autoguider_Exposure_Predict to jump straight to the exposure length
+ *     giving Target_Counts, rather than waiting Scale_Count loops (guide.exposure_length.model).</dd>
  * </dl>
  * @see #GUIDE_SCALE_TYPE
  */
@@ -89,6 +97,7 @@ struct Guide_Exposure_Length_Scaling_Struct
 	int Scale_Index;
 	int Scale_Count;
 	int Scale_Up;
+	int Model;
 };
 
 /**
@@ -156,6 +165,12 @@ struct Guide_Window_Tracking_Struct
  *     (before the guide loop is started). This is used within the guide loop to choose which object to guide upon 
  *     if multiple objects are detected within the guide window.</dd>
  * <dt>Last_Object</dt> <dd>A copy of the last guide object detected and used to send a guide centroid, for status purposes.</dd>
+ * <dt>Guide_Ellipticity</dt> <dd>A float, the object ellipticity above which the guide packet is flagged as
+ *     less reliable. Loaded from config at guide on, rather than every guide packet.</dd>
+ * <dt>Guide_Mag_Const</dt> <dd>A float, the magnitude constant used to estimate the guide object magnitude.
+ *     Loaded from config at guide on, rather than every guide packet.</dd>
+ * <dt>Last_Packet_Status_Char</dt> <dd>The status character of the last guide packet sent to the TCS,
+ *     or NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED if no reliable packet was sent. Used by the guide recorder.</dd>
  * </dl>
  * @see #Guide_Exposure_Length_Scaling_Struct
  * @see #Guide_Window_Tracking_Struct
@@ -191,6 +206,9 @@ struct Guide_Struct
 	float Initial_Object_CCD_X_Position;
 	float Initial_Object_CCD_Y_Position;
 	struct Autoguider_Object_Struct Last_Object;
+	float Guide_Ellipticity;
+	float Guide_Mag_Const;
+	char Last_Packet_Status_Char;
 };
 
 /* internal data */
@@ -213,20 +231,26 @@ static struct Guide_Struct Guide_Data =
 	TRUE,TRUE,TRUE,
 	0,0,
 	0.0,
-	{GUIDE_SCALE_TYPE_PEAK,FALSE,0,0,0,0,0,0,0,TRUE},
+	{GUIDE_SCALE_TYPE_PEAK,FALSE,0,0,0,0,0,0,0,TRUE,FALSE},
 	{FALSE,10,10,FALSE},
 	2.0f, FALSE, 0.0f, 0.0f,
-	{0,0.0f,0.0f,0.0f,0.0f,0.0f,0,0.0f,0,0.0f,0.0f}
+	{0,0.0f,0.0f,0.0f,0.0f,0.0f,0,0.0f,0,0.0f,0.0f},
+	0.0f,0.0f,
+	NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED
 };
 
 /* internal routines */
 static void *Guide_Thread(void *user_arg);
 static int Guide_Reduce(void);
 static int Guide_Exposure_Length_Scale(void);
+static int Guide_Exposure_Length_Model(struct Autoguider_Object_Struct object);
 static int Guide_Window_Track(void);
 static int Guide_Packet_Send(int terminating,float timecode_secs);
+static int Guide_Record(void);
+static int Guide_Telemetry(void);
 static int Guide_Scaling_Config_Load(void);
 static int Guide_Dimension_Config_Load(void);
+static int Guide_Packet_Config_Load(void);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -485,6 +509,8 @@ int Autoguider_Guide_Exposure_Length_Set(int exposure_length,int lock)
  * @see autoguider_general.html#Autoguider_General_Log_Format
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
+ * @see autoguider_realtime.html#Autoguider_Realtime_Guide_Thread_Attr_Set
+ * @see autoguider_realtime.html#Autoguider_Realtime_Is_Enabled
  */
 int Autoguider_Guide_On(void)
 {
@@ -512,6 +538,13 @@ int Autoguider_Guide_On(void)
 			"Failed to start guiding:Fielding operation already in progress.");
 		return FALSE;
 	}
+	if(Autoguider_Calibrate_Is_Calibrating() == TRUE)
+	{
+		Autoguider_General_Error_Number = 761;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_On:"
+			"Failed to start guiding:Calibrate operation already in progress.");
+		return FALSE;
+	}
 #if AUTOGUIDER_DEBUG > 5
 	Autoguider_General_Log("guide","autoguider_guide.c","Autoguider_Guide_On",LOG_VERBOSITY_VERBOSE,
 			       "GUIDE","Getting Dimensions.");
@@ -522,6 +555,9 @@ int Autoguider_Guide_On(void)
 	/* get/reload scaling config */
 	if(!Guide_Scaling_Config_Load())
 		return FALSE;
+	/* get/reload guide packet reliability config */
+	if(!Guide_Packet_Config_Load())
+		return FALSE;
 	/* default exposure length */
 	/* we have to do something more complicated here */
 	/* depending on whether we have moved on sky, we should start with the default and increase (loop!)
@@ -573,7 +609,27 @@ int Autoguider_Guide_On(void)
 	/* spawn guide thread */
 	pthread_attr_init(&attr);
 	pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+	/* in real-time mode, use the real-time scheduling policy, priority and CPU */
+	if(!Autoguider_Realtime_Guide_Thread_Attr_Set(&attr))
+	{
+		pthread_attr_destroy(&attr);
+		return FALSE;
+	}
 	retval = pthread_create(&guide_thread,&attr,&Guide_Thread,(void *)NULL);
+	pthread_attr_destroy(&attr);
+	/* we may not have the privilege to use SCHED_FIFO, in which case guide without it */
+	if((retval == EPERM)&&Autoguider_Realtime_Is_Enabled())
+	{
+		Autoguider_General_Error_Number = 760;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_On:"
+			"Not permitted to create real-time guide thread, using default scheduling.");
+		Autoguider_General_Error("guide","autoguider_guide.c","Autoguider_Guide_On",
+					 LOG_VERBOSITY_TERSE,"GUIDE"); /* no need to fail */
+		pthread_attr_init(&attr);
+		pthread_attr_setdetachstate(&attr,PTHREAD_CREATE_DETACHED);
+		retval = pthread_create(&guide_thread,&attr,&Guide_Thread,(void *)NULL);
+		pthread_attr_destroy(&attr);
+	}
 	if(retval != 0)
 	{
 		Autoguider_General_Error_Number = 709;
@@ -1233,10 +1289,11 @@ float Autoguider_Guide_Initial_Object_CCD_Y_Position_Get(void)
  * @see autoguider_general.html#fdifftime
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Log_Format
+ * @see autoguider_realtime.html#Autoguider_Realtime_Thread_Prefault
  * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Expose
  * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Get_Exposure_Start_Time
  * @see ../ccd/cdocs/ccd_setup.html#CCD_Setup_Dimensions
- * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Get
+ * @see autoguider_housekeeping.html#Autoguider_Housekeeping_Temperature_Get
  * @see ../ccd/cdocs/ccd_temperature.html#CCD_TEMPERATURE_STATUS
  * @see ../ngatcil/cdocs/ngatcil_ags_sdb.html#eAggState_e
  */
@@ -1246,12 +1303,15 @@ static void *Guide_Thread(void *user_arg)
 	struct timespec start_time,loop_start_time,current_time;
 	unsigned short *buffer_ptr = NULL;
 	double current_temperature;
+	int temperature_age;
 	int retval;
 
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("guide","autoguider_guide.c","Guide_Thread",
 			       LOG_VERBOSITY_VERY_TERSE,"GUIDE","started.");
 #endif
+	/* in real-time mode, fault in the stack before entering the loop */
+	Autoguider_Realtime_Thread_Prefault();
 	/* set is guiding flag */
 	Guide_Data.Is_Guiding = TRUE;
 	/* update SDB */
@@ -1483,13 +1543,16 @@ static void *Guide_Thread(void *user_arg)
 							 LOG_VERBOSITY_VERY_TERSE,"GUIDE");
 			}
 		}
-		retval = CCD_Temperature_Get(&current_temperature,&temperature_status);
+		/* use the temperature published by the housekeeping thread, rather than querying the SDK */
+		retval = Autoguider_Housekeeping_Temperature_Get(&current_temperature,&temperature_status,
+								 &temperature_age);
 		if(retval)
 		{
 #if AUTOGUIDER_DEBUG > 9
 			Autoguider_General_Log_Format("guide","autoguider_guide.c","Guide_Thread",
 						      LOG_VERBOSITY_VERY_VERBOSE,"GUIDE",
-						      "current temperature is %.2f C.",current_temperature);
+						      "current temperature is %.2f C (%d ms old).",current_temperature,
+						      temperature_age);
 #endif
 			if(!Autoguider_Buffer_Guide_CCD_Temperature_Set(Guide_Data.In_Use_Buffer_Index,
 									current_temperature))
@@ -1669,6 +1732,18 @@ static void *Guide_Thread(void *user_arg)
 							 LOG_VERBOSITY_VERY_TERSE,"GUIDE"); /* no need to fail */
 			}
 		}
+		/* pass the frame to the guide recorder, before window tracking changes the guide dimensions */
+		if(!Guide_Record())
+		{
+			Autoguider_General_Error("guide","autoguider_guide.c","Guide_Thread",
+						 LOG_VERBOSITY_VERY_TERSE,"GUIDE"); /* no need to fail */
+		}
+		/* pass the frame details to the telemetry log */
+		if(!Guide_Telemetry())
+		{
+			Autoguider_General_Error("guide","autoguider_guide.c","Guide_Thread",
+						 LOG_VERBOSITY_VERY_TERSE,"GUIDE"); /* no need to fail */
+		}
 		/* Do any necessary guide window tracking */
 		retval = Guide_Window_Track();
 		if(retval == FALSE)
@@ -1939,10 +2014,13 @@ static int Guide_Reduce(void)
  *         <li>Otherwise, reset "Guide_Data.Exposure_Length_Scaling.Scale_Index" to zero.
  *         </ul>
  *     </ul>
+ *     If "Guide_Data.Exposure_Length_Scaling.Model" is TRUE, Guide_Exposure_Length_Model is called instead
+ *     to rescale immediately using the flux model.
  * </ul>
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Guide_Data
  * @see #Guide_Scaling_Config_Load
+ * @see #Guide_Exposure_Length_Model
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Log_Format
  * @see autoguider_object.html#Autoguider_Object_List_Get_Count
@@ -2024,6 +2102,9 @@ static int Guide_Exposure_Length_Scale(void)
 #endif
 			return TRUE; /* don't stop guiding */
 		}
+		/* flux model - jump straight to the exposure length giving the target counts */
+		if(Guide_Data.Exposure_Length_Scaling.Model)
+			return Guide_Exposure_Length_Model(object);
 		/* check stats of object */
 		if(Guide_Data.Exposure_Length_Scaling.Type == GUIDE_SCALE_TYPE_PEAK)
 		{
@@ -2217,6 +2298,63 @@ static int Guide_Exposure_Length_Scale(void)
 	return TRUE;
 }
 
+/**
+ * Rescale the guide exposure length using the flux model in Autoguider_Exposure_Predict.
+ * The object's peak or integrated counts (depending on "Guide_Data.Exposure_Length_Scaling.Type") and
+ * the guide frame background are used to predict the exposure length giving
+ * "Guide_Data.Exposure_Length_Scaling.Target_Counts". If the prediction is outside the hysteresis band
+ * and a better dark is available, the new exposure length is set straight away, the correct dark loaded and
+ * the SDB updated. "Guide_Data.Exposure_Length_Scaling.Scale_Index" is always reset.
+ * @param object The single object detected in the guide window.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Guide_Data
+ * @see #Autoguider_Guide_Exposure_Length_Set
+ * @see autoguider_cil.html#Autoguider_CIL_SDB_Packet_Exp_Time_Set
+ * @see autoguider_dark.html#Autoguider_Dark_Set
+ * @see autoguider_exposure.html#Autoguider_Exposure_Predict
+ * @see autoguider_object.html#Autoguider_Object_Median_Get
+ */
+static int Guide_Exposure_Length_Model(struct Autoguider_Object_Struct object)
+{
+	float counts;
+	int guide_exposure_length,changed;
+
+	Guide_Data.Exposure_Length_Scaling.Scale_Index = 0;
+	if(Guide_Data.Exposure_Length_Scaling.Type == GUIDE_SCALE_TYPE_INTEGRATED)
+		counts = object.Total_Counts;
+	else
+		counts = object.Peak_Counts;
+	if(counts <= 0.0f)
+		return TRUE; /* nothing to scale on - don't stop guiding */
+	if(!Autoguider_Exposure_Predict(Guide_Data.Exposure_Length,object.Peak_Counts,counts,
+					Autoguider_Object_Median_Get(),
+					(float)(Guide_Data.Exposure_Length_Scaling.Target_Counts),
+					&guide_exposure_length,&changed))
+		return FALSE;
+	if(changed == FALSE)
+		return TRUE;
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("guide","autoguider_guide.c","Guide_Exposure_Length_Model",
+				      LOG_VERBOSITY_TERSE,"GUIDE",
+				      "Counts %.2f in %d ms:new guide exposure length %d ms for target %d.",
+				      counts,Guide_Data.Exposure_Length,guide_exposure_length,
+				      Guide_Data.Exposure_Length_Scaling.Target_Counts);
+#endif
+	/* set */
+	if(!Autoguider_Guide_Exposure_Length_Set(guide_exposure_length,FALSE))
+		return FALSE;
+	/* ensure the correct dark is loaded */
+	if(!Autoguider_Dark_Set(Guide_Data.Bin_X,Guide_Data.Bin_Y,Guide_Data.Exposure_Length))
+		return FALSE;
+	/* update SDB */
+	if(!Autoguider_CIL_SDB_Packet_Exp_Time_Set(Guide_Data.Exposure_Length))
+	{
+		Autoguider_General_Error("guide","autoguider_guide.c","Guide_Exposure_Length_Model",
+					 LOG_VERBOSITY_TERSE,"GUIDE"); /* no need to fail */
+	}
+	return TRUE;
+}
+
 /**
  * Determine whether to do guide window tracking, and if needed, move the guide window to
  * surround the centroid position.
@@ -2395,7 +2533,7 @@ static int Guide_Window_Track(void)
  * <li>If more than one object was detected, the one nearest the initial guide object's position is selected using
  *     Autoguider_Object_List_Get_Nearest_Object.
  * <li>Otherwise the first object is retrieved.
- * <li>We load config 'guide.counts.min.peak','guide.counts.max.peak' and 'guide.ellipticity' for reliability tests.
+ * <li>We use the min/max peak counts, ellipticity and magnitude constant loaded at guide on for reliability tests.
  * <li>A set of reliability tests are performed to get an integer between 0 and 7.
  * <li>The reliability number is transformed into a status char.
  * <li>We check whether the centroid is within 1 FWHM of the edge of the window, and if so set the status char to
@@ -2423,12 +2561,12 @@ static int Guide_Window_Track(void)
  * @see autoguider_object.htmlAutoguider_Object_List_Get_Object
  * @see ../ngatcil/cdocs/ngatcil_tcs_guide_packet.html#NGATCIL_TCS_GUIDE_PACKET_STATUS_WINDOW
  * @see ../ngatcil/cdocs/ngatcil_tcs_guide_packet.html#NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED
- * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
- * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Float
+ * @see #Guide_Scaling_Config_Load
+ * @see #Guide_Packet_Config_Load
  */
 static int Guide_Packet_Send(int terminating,float timecode_secs)
 {
-	int object_count,reliability,guide_counts_min_peak,guide_counts_max_peak,retval;
+	int object_count,reliability,guide_counts_min_peak,guide_counts_max_peak;
 	struct Autoguider_Object_Struct object;
 	char status_char;
 	float fwhm,guide_ellipticity,mag,guide_mag_const,exposure_length_s,counts_per_s,log_counts_per_s;
@@ -2437,6 +2575,8 @@ static int Guide_Packet_Send(int terminating,float timecode_secs)
 	Autoguider_General_Log("guide","autoguider_guide.c","Guide_Packet_Send",LOG_VERBOSITY_TERSE,"GUIDE",
 			       "started.");
 #endif
+	/* reset to reliable status char when/if a reliable packet is sent */
+	Guide_Data.Last_Packet_Status_Char = NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED;
 	if(Guide_Data.Do_Object_Detect)
 	{
 		/* how many objects found in guide frame */
@@ -2506,39 +2646,11 @@ static int Guide_Packet_Send(int terminating,float timecode_secs)
 		}
 		/* object is the best detected object on the guide frame */
 		/* reliability tests */
-		/* load config */
-		retval = CCD_Config_Get_Integer("guide.counts.min.peak",&guide_counts_min_peak);
-		if(retval == FALSE)
-		{
-			Autoguider_General_Error_Number = 731;
-			sprintf(Autoguider_General_Error_String,"Guide_Packet_Send:"
-				"Failed to load config:'guide.counts.min.peak'.");
-			return FALSE;
-		}
-		retval = CCD_Config_Get_Integer("guide.counts.max.peak",&guide_counts_max_peak);
-		if(retval == FALSE)
-		{
-			Autoguider_General_Error_Number = 732;
-			sprintf(Autoguider_General_Error_String,"Guide_Packet_Send:"
-				"Failed to load config:'guide.counts.max.peak'.");
-			return FALSE;
-		}
-		retval = CCD_Config_Get_Float("guide.ellipticity",&guide_ellipticity);
-		if(retval == FALSE)
-		{
-			Autoguider_General_Error_Number = 733;
-			sprintf(Autoguider_General_Error_String,"Guide_Packet_Send:"
-				"Failed to load config:'guide.ellipticity'.");
-			return FALSE;
-		}
-		retval = CCD_Config_Get_Float("guide.mag.const",&guide_mag_const);
-		if(retval == FALSE)
-		{
-			Autoguider_General_Error_Number = 756;
-			sprintf(Autoguider_General_Error_String,"Guide_Packet_Send:"
-				"Failed to load config:'guide.mag.const'.");
-			return FALSE;
-		}
+		/* config loaded at guide on */
+		guide_counts_min_peak = Guide_Data.Exposure_Length_Scaling.Min_Peak_Counts;
+		guide_counts_max_peak = Guide_Data.Exposure_Length_Scaling.Max_Peak_Counts;
+		guide_ellipticity = Guide_Data.Guide_Ellipticity;
+		guide_mag_const = Guide_Data.Guide_Mag_Const;
 		/*
 		** 0 means confident
 		** Bit 0 set means FWHM approaching limit
@@ -2613,6 +2725,8 @@ static int Guide_Packet_Send(int terminating,float timecode_secs)
 			Autoguider_General_Error("guide","autoguider_guide.c","Guide_Packet_Send",
 						 LOG_VERBOSITY_TERSE,"GUIDE");
 		}
+		else
+			Guide_Data.Last_Packet_Status_Char = status_char;
 		/* update SDB mag */
 		/* ensure exposure length will not cause div by zero, log10 arg is +ve */
 		if((Guide_Data.Exposure_Length != 0)&&(object.Total_Counts > 0.0f))
@@ -2679,6 +2793,130 @@ static int Guide_Packet_Send(int terminating,float timecode_secs)
 	return TRUE;
 }
 
+/**
+ * Pass the reduced guide frame in Guide_Data.In_Use_Buffer_Index, and the details of the guide packet
+ * just sent, to the guide recorder. Does nothing if the guide recorder is not enabled.
+ * The reduced guide buffer is locked whilst the recorder copies the frame into its queue.
+ * The recorder never blocks on disk I/O, it drops the frame if its queue is full.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Guide_Data
+ * @see autoguider_buffer.html#Autoguider_Buffer_Get_Guide_Binned_NCols
+ * @see autoguider_buffer.html#Autoguider_Buffer_Get_Guide_Binned_NRows
+ * @see autoguider_buffer.html#Autoguider_Buffer_Guide_Exposure_Start_Time_Get
+ * @see autoguider_buffer.html#Autoguider_Buffer_Guide_Exposure_Length_Get
+ * @see autoguider_buffer.html#Autoguider_Buffer_Guide_CCD_Temperature_Get
+ * @see autoguider_buffer.html#Autoguider_Buffer_Reduced_Guide_Lock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Reduced_Guide_Unlock
+ * @see autoguider_guide_recorder.html#Autoguider_Guide_Recorder_Frame_Struct
+ * @see autoguider_guide_recorder.html#Autoguider_Guide_Recorder_Is_Enabled
+ * @see autoguider_guide_recorder.html#Autoguider_Guide_Recorder_Frame_Add
+ */
+static int Guide_Record(void)
+{
+	struct Autoguider_Guide_Recorder_Frame_Struct frame;
+	struct timespec start_time;
+	float *reduced_buffer_ptr = NULL;
+	double ccd_temperature;
+
+	if(Autoguider_Guide_Recorder_Is_Enabled() == FALSE)
+		return TRUE;
+	memset(&frame,0,sizeof(struct Autoguider_Guide_Recorder_Frame_Struct));
+	frame.Guide_Id = Guide_Data.Guide_Id;
+	frame.Frame_Number = Guide_Data.Frame_Number;
+	if(!Autoguider_Buffer_Guide_Exposure_Start_Time_Get(Guide_Data.In_Use_Buffer_Index,&start_time))
+		return FALSE;
+	frame.Start_Time_Sec = start_time.tv_sec;
+	frame.Start_Time_NSec = start_time.tv_nsec;
+	if(!Autoguider_Buffer_Guide_Exposure_Length_Get(Guide_Data.In_Use_Buffer_Index,&(frame.Exposure_Length)))
+		return FALSE;
+	if(!Autoguider_Buffer_Guide_CCD_Temperature_Get(Guide_Data.In_Use_Buffer_Index,&ccd_temperature))
+		return FALSE;
+	frame.CCD_Temperature = (float)ccd_temperature;
+	frame.Bin_X = Guide_Data.Bin_X;
+	frame.Bin_Y = Guide_Data.Bin_Y;
+	frame.Window_X_Start = Guide_Data.Window.X_Start;
+	frame.Window_Y_Start = Guide_Data.Window.Y_Start;
+	frame.Window_X_End = Guide_Data.Window.X_End;
+	frame.Window_Y_End = Guide_Data.Window.Y_End;
+	frame.NCols = Autoguider_Buffer_Get_Guide_Binned_NCols();
+	frame.NRows = Autoguider_Buffer_Get_Guide_Binned_NRows();
+	frame.Loop_Cadence = (float)Guide_Data.Loop_Cadence;
+	frame.Status_Char = Guide_Data.Last_Packet_Status_Char;
+	if(Guide_Data.Last_Packet_Status_Char != NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED)
+	{
+		frame.Centroid_X = Guide_Data.Last_Object.CCD_X_Position;
+		frame.Centroid_Y = Guide_Data.Last_Object.CCD_Y_Position;
+		frame.FWHM_X = Guide_Data.Last_Object.FWHM_X;
+		frame.FWHM_Y = Guide_Data.Last_Object.FWHM_Y;
+		frame.Peak_Counts = Guide_Data.Last_Object.Peak_Counts;
+		frame.Total_Counts = Guide_Data.Last_Object.Total_Counts;
+	}
+	if(!Autoguider_Buffer_Reduced_Guide_Lock(Guide_Data.In_Use_Buffer_Index,&reduced_buffer_ptr))
+		return FALSE;
+	if(!Autoguider_Guide_Recorder_Frame_Add(frame,reduced_buffer_ptr))
+	{
+		Autoguider_Buffer_Reduced_Guide_Unlock(Guide_Data.In_Use_Buffer_Index);
+		return FALSE;
+	}
+	if(!Autoguider_Buffer_Reduced_Guide_Unlock(Guide_Data.In_Use_Buffer_Index))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Pass the details of the guide frame in Guide_Data.In_Use_Buffer_Index, and the guide packet just sent,
+ * to the telemetry log as a guide frame record. Does nothing if the telemetry log is not enabled.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Guide_Data
+ * @see autoguider_buffer.html#Autoguider_Buffer_Guide_Exposure_Start_Time_Get
+ * @see autoguider_buffer.html#Autoguider_Buffer_Guide_Exposure_Length_Get
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Count
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Record_Struct
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Is_Enabled
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Record_Add
+ */
+static int Guide_Telemetry(void)
+{
+	struct Autoguider_Telemetry_Record_Struct record;
+	struct timespec start_time;
+
+	if(Autoguider_Telemetry_Is_Enabled() == FALSE)
+		return TRUE;
+	memset(&record,0,sizeof(struct Autoguider_Telemetry_Record_Struct));
+	record.Type = AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME;
+	record.Id = Guide_Data.Guide_Id;
+	record.Frame_Number = Guide_Data.Frame_Number;
+	if(!Autoguider_Buffer_Guide_Exposure_Start_Time_Get(Guide_Data.In_Use_Buffer_Index,&start_time))
+		return FALSE;
+	record.Time_Sec = start_time.tv_sec;
+	record.Time_NSec = start_time.tv_nsec;
+	if(!Autoguider_Buffer_Guide_Exposure_Length_Get(Guide_Data.In_Use_Buffer_Index,&(record.Exposure_Length)))
+		return FALSE;
+	if(Guide_Data.Do_Object_Detect)
+	{
+		if(!Autoguider_Object_List_Get_Count(&(record.Object_Count)))
+			return FALSE;
+	}
+	record.Loop_Cadence = (float)Guide_Data.Loop_Cadence;
+	record.Status_Char = Guide_Data.Last_Packet_Status_Char;
+	if(Guide_Data.Last_Packet_Status_Char != NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED)
+	{
+		record.CCD_X_Position = Guide_Data.Last_Object.CCD_X_Position;
+		record.CCD_Y_Position = Guide_Data.Last_Object.CCD_Y_Position;
+		record.Buffer_X_Position = Guide_Data.Last_Object.Buffer_X_Position;
+		record.Buffer_Y_Position = Guide_Data.Last_Object.Buffer_Y_Position;
+		record.Total_Counts = Guide_Data.Last_Object.Total_Counts;
+		record.Peak_Counts = Guide_Data.Last_Object.Peak_Counts;
+		record.Pixel_Count = Guide_Data.Last_Object.Pixel_Count;
+		record.Is_Stellar = Guide_Data.Last_Object.Is_Stellar;
+		record.FWHM_X = Guide_Data.Last_Object.FWHM_X;
+		record.FWHM_Y = Guide_Data.Last_Object.FWHM_Y;
+	}
+	if(!Autoguider_Telemetry_Record_Add(&record))
+		return FALSE;
+	return TRUE;
+}
+
 /**
  * Load guide scaling configuration. Gets the following configuration:
  * <ul>
@@ -2800,6 +3038,14 @@ static int Guide_Scaling_Config_Load(void)
 			"Failed to load config:'guide.exposure_length.scale_count'.");
 		return FALSE;
 	}
+	retval = CCD_Config_Get_Boolean("guide.exposure_length.model",&(Guide_Data.Exposure_Length_Scaling.Model));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 759;
+		sprintf(Autoguider_General_Error_String,"Guide_Scaling_Config_Load:"
+			"Failed to load config:'guide.exposure_length.model'.");
+		return FALSE;
+	}
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("guide","autoguider_guide.c","Guide_Scaling_Config_Load",
 			       LOG_VERBOSITY_TERSE,"GUIDE","finished.");
@@ -2807,6 +3053,52 @@ static int Guide_Scaling_Config_Load(void)
 	return TRUE;
 }
 
+/**
+ * Load guide packet reliability configuration. Gets the following configuration:
+ * <ul>
+ * <li>"guide.ellipticity" - float.
+ * <li>"guide.mag.const" - float.
+ * </ul>
+ * The data is used to populate Guide_Data.Guide_Ellipticity and Guide_Data.Guide_Mag_Const, so
+ * Guide_Packet_Send does not have to look up the config for every guide packet. The min/max peak counts
+ * are loaded by Guide_Scaling_Config_Load.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Guide_Data
+ * @see #Guide_Packet_Send
+ * @see #Guide_Scaling_Config_Load
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Float
+ */
+static int Guide_Packet_Config_Load(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("guide","autoguider_guide.c","Guide_Packet_Config_Load",
+			       LOG_VERBOSITY_TERSE,"GUIDE","started.");
+#endif
+	retval = CCD_Config_Get_Float("guide.ellipticity",&(Guide_Data.Guide_Ellipticity));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 733;
+		sprintf(Autoguider_General_Error_String,"Guide_Packet_Config_Load:"
+			"Failed to load config:'guide.ellipticity'.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Float("guide.mag.const",&(Guide_Data.Guide_Mag_Const));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 756;
+		sprintf(Autoguider_General_Error_String,"Guide_Packet_Config_Load:"
+			"Failed to load config:'guide.mag.const'.");
+		return FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("guide","autoguider_guide.c","Guide_Packet_Config_Load",
+			       LOG_VERBOSITY_TERSE,"GUIDE","finished.");
+#endif
+	return TRUE;
+}
+
 /**
  * Load guide dimension configuration.
  * @return The routine returns TRUE on success and FALSE on failure.
@@ -0,0 +1,827 @@
+/* autoguider_guide_recorder.c
+** Autoguider guide frame recorder routines
+** $Header$
+*/
+/**
+ * Guide frame recorder routines for the autoguider program.
+ * Guide frames (or every Nth guide frame) and their associated metadata (centroid, exposure details,
+ * guide packet status) are copied into a bounded in-memory queue by the guide thread, and written to disk
+ * by a separate recorder thread. If the queue is full, the frame is dropped rather than stalling the guide thread.
+ * Frames are written either as Rice tile-compressed FITS image extensions, or appended to a binary container file.
+ * The output file is rotated when it exceeds a configured size or age.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fitsio.h"
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+
+#include "autoguider_general.h"
+#include "autoguider_guide_recorder.h"
+
+/* hash defines */
+/**
+ * The length of the output filename.
+ */
+#define RECORDER_FILENAME_LENGTH           (256)
+
+/* data types */
+/**
+ * Enumeration describing the format of the recorder output files.
+ * <ul>
+ * <li>RECORDER_FORMAT_FITS - Rice tile-compressed FITS, one image extension per guide frame.
+ * <li>RECORDER_FORMAT_BINARY - Append-only binary container, Autoguider_Guide_Recorder_Frame_Struct
+ *     followed by the reduced pixel data.
+ * </ul>
+ */
+enum RECORDER_FORMAT
+{
+	RECORDER_FORMAT_FITS=0,RECORDER_FORMAT_BINARY=1
+};
+
+/**
+ * Structure holding one slot in the recorder queue.
+ * <dl>
+ * <dt>Frame</dt> <dd>The frame metadata, of type Autoguider_Guide_Recorder_Frame_Struct.</dd>
+ * <dt>Buffer</dt> <dd>An allocated buffer holding a copy of the reduced guide frame pixels.</dd>
+ * <dt>Buffer_Pixel_Count</dt> <dd>The number of pixels allocated in Buffer.</dd>
+ * </dl>
+ * @see autoguider_guide_recorder.html#Autoguider_Guide_Recorder_Frame_Struct
+ */
+struct Recorder_Slot_Struct
+{
+	struct Autoguider_Guide_Recorder_Frame_Struct Frame;
+	float *Buffer;
+	int Buffer_Pixel_Count;
+};
+
+/**
+ * Structure holding guide recorder data.
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex protecting the queue and statistics.</dd>
+ * <dt>Condition</dt> <dd>Condition variable signalled when a frame is queued, or the recorder is told to quit.</dd>
+ * <dt>Thread</dt> <dd>The recorder thread.</dd>
+ * <dt>Enable</dt> <dd>Boolean, whether guide frame recording is enabled (guide.recorder.enable).</dd>
+ * <dt>Directory</dt> <dd>The directory to write recorder files into (guide.recorder.directory).</dd>
+ * <dt>Format</dt> <dd>The output file format (guide.recorder.format).</dd>
+ * <dt>Decimate</dt> <dd>Only every Decimate'th guide frame is recorded (guide.recorder.decimate).</dd>
+ * <dt>Rotate_Size</dt> <dd>Rotate the output file when it exceeds this many bytes (guide.recorder.rotate.size),
+ *     0 means never rotate on size.</dd>
+ * <dt>Rotate_Time</dt> <dd>Rotate the output file when it has been open this many seconds
+ *     (guide.recorder.rotate.time), 0 means never rotate on age.</dd>
+ * <dt>Queue</dt> <dd>An allocated list of Queue_Length queue slots.</dd>
+ * <dt>Queue_Length</dt> <dd>The number of slots in the queue (guide.recorder.queue_length).</dd>
+ * <dt>Queue_Head</dt> <dd>The index of the oldest queued frame.</dd>
+ * <dt>Queue_Count</dt> <dd>The number of queued frames.</dd>
+ * <dt>Quit</dt> <dd>Boolean, set to tell the recorder thread to write the queued frames and quit.</dd>
+ * <dt>Is_Running</dt> <dd>Boolean, TRUE whilst the recorder thread is running.</dd>
+ * <dt>Written_Count</dt> <dd>The number of frames written to disk.</dd>
+ * <dt>Dropped_Count</dt> <dd>The number of frames dropped because the queue was full, or the write failed.</dd>
+ * <dt>Fits_Fp</dt> <dd>The currently open FITS file, or NULL.</dd>
+ * <dt>Binary_Fp</dt> <dd>The currently open binary container file, or NULL.</dd>
+ * <dt>Filename</dt> <dd>The name of the currently open file.</dd>
+ * <dt>File_Size</dt> <dd>The number of bytes written to the currently open file (approximate for FITS).</dd>
+ * <dt>File_Open_Time</dt> <dd>When the currently open file was opened.</dd>
+ * </dl>
+ * @see #RECORDER_FORMAT
+ * @see #Recorder_Slot_Struct
+ */
+struct Recorder_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	pthread_t Thread;
+	int Enable;
+	char *Directory;
+	enum RECORDER_FORMAT Format;
+	int Decimate;
+	int Rotate_Size;
+	int Rotate_Time;
+	struct Recorder_Slot_Struct *Queue;
+	int Queue_Length;
+	int Queue_Head;
+	int Queue_Count;
+	int Quit;
+	int Is_Running;
+	int Written_Count;
+	int Dropped_Count;
+	fitsfile *Fits_Fp;
+	FILE *Binary_Fp;
+	char Filename[RECORDER_FILENAME_LENGTH];
+	long File_Size;
+	struct timespec File_Open_Time;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of guide recorder data. The mutex and condition variable are statically initialised, and
+ * recording is disabled until Autoguider_Guide_Recorder_Initialise has loaded the config.
+ * @see #Recorder_Struct
+ */
+static struct Recorder_Struct Recorder_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER
+};
+
+/* internal functions */
+static void *Recorder_Thread(void *arg);
+static int Recorder_File_Open(void);
+static int Recorder_File_Close(void);
+static int Recorder_Write_Fits(struct Recorder_Slot_Struct *slot);
+static int Recorder_Write_Binary(struct Recorder_Slot_Struct *slot);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Initialise the guide recorder. Loads the following config:
+ * <ul>
+ * <li>"guide.recorder.enable" - boolean.
+ * <li>"guide.recorder.directory" - string.
+ * <li>"guide.recorder.format" - string, "fits" or "binary".
+ * <li>"guide.recorder.decimate" - integer.
+ * <li>"guide.recorder.queue_length" - integer.
+ * <li>"guide.recorder.rotate.size" - integer, bytes.
+ * <li>"guide.recorder.rotate.time" - integer, seconds.
+ * </ul>
+ * If recording is enabled, the queue is allocated and the recorder thread started.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Recorder_Data
+ * @see #Recorder_Thread
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Boolean
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
+ */
+int Autoguider_Guide_Recorder_Initialise(void)
+{
+	char *format_string = NULL;
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("recorder","autoguider_guide_recorder.c","Autoguider_Guide_Recorder_Initialise",
+			       LOG_VERBOSITY_TERSE,"RECORDER","started.");
+#endif
+	retval = CCD_Config_Get_Boolean("guide.recorder.enable",&(Recorder_Data.Enable));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1300;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to load config:'guide.recorder.enable'.");
+		return FALSE;
+	}
+	if(Recorder_Data.Enable == FALSE)
+	{
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("recorder","autoguider_guide_recorder.c",
+				       "Autoguider_Guide_Recorder_Initialise",LOG_VERBOSITY_TERSE,"RECORDER",
+				       "Guide frame recording disabled:finished.");
+#endif
+		return TRUE;
+	}
+	retval = CCD_Config_Get_String("guide.recorder.directory",&(Recorder_Data.Directory));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1301;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to load config:'guide.recorder.directory'.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_String("guide.recorder.format",&format_string);
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1302;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to load config:'guide.recorder.format'.");
+		return FALSE;
+	}
+	if(strcmp(format_string,"fits") == 0)
+		Recorder_Data.Format = RECORDER_FORMAT_FITS;
+	else if(strcmp(format_string,"binary") == 0)
+		Recorder_Data.Format = RECORDER_FORMAT_BINARY;
+	else
+	{
+		Autoguider_General_Error_Number = 1303;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Illegal guide.recorder.format '%s'.",format_string);
+		free(format_string);
+		return FALSE;
+	}
+	free(format_string);
+	retval = CCD_Config_Get_Integer("guide.recorder.decimate",&(Recorder_Data.Decimate));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1304;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to load config:'guide.recorder.decimate'.");
+		return FALSE;
+	}
+	if(Recorder_Data.Decimate < 1)
+	{
+		Autoguider_General_Error_Number = 1305;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Illegal guide.recorder.decimate %d.",Recorder_Data.Decimate);
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("guide.recorder.queue_length",&(Recorder_Data.Queue_Length));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1306;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to load config:'guide.recorder.queue_length'.");
+		return FALSE;
+	}
+	if(Recorder_Data.Queue_Length < 1)
+	{
+		Autoguider_General_Error_Number = 1307;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Illegal guide.recorder.queue_length %d.",Recorder_Data.Queue_Length);
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("guide.recorder.rotate.size",&(Recorder_Data.Rotate_Size));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1308;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to load config:'guide.recorder.rotate.size'.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("guide.recorder.rotate.time",&(Recorder_Data.Rotate_Time));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1309;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to load config:'guide.recorder.rotate.time'.");
+		return FALSE;
+	}
+	/* allocate queue. Slot pixel buffers are allocated when first used. */
+	Recorder_Data.Queue = (struct Recorder_Slot_Struct *)calloc(Recorder_Data.Queue_Length,
+								     sizeof(struct Recorder_Slot_Struct));
+	if(Recorder_Data.Queue == NULL)
+	{
+		Autoguider_General_Error_Number = 1310;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to allocate queue of length %d.",Recorder_Data.Queue_Length);
+		return FALSE;
+	}
+	Recorder_Data.Queue_Head = 0;
+	Recorder_Data.Queue_Count = 0;
+	Recorder_Data.Quit = FALSE;
+	Recorder_Data.Written_Count = 0;
+	Recorder_Data.Dropped_Count = 0;
+	Recorder_Data.Fits_Fp = NULL;
+	Recorder_Data.Binary_Fp = NULL;
+	/* start the recorder thread */
+	retval = pthread_create(&(Recorder_Data.Thread),NULL,&Recorder_Thread,(void *)NULL);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 1311;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Initialise:"
+			"Failed to create recorder thread (%d).",retval);
+		return FALSE;
+	}
+	Recorder_Data.Is_Running = TRUE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("recorder","autoguider_guide_recorder.c","Autoguider_Guide_Recorder_Initialise",
+				      LOG_VERBOSITY_TERSE,"RECORDER","Recording every %d guide frames to '%s' "
+				      "(format %d,queue length %d,rotate size %d bytes,rotate time %d s):finished.",
+				      Recorder_Data.Decimate,Recorder_Data.Directory,Recorder_Data.Format,
+				      Recorder_Data.Queue_Length,Recorder_Data.Rotate_Size,Recorder_Data.Rotate_Time);
+#endif
+	return TRUE;
+}
+
+/**
+ * Return whether guide frame recording is enabled, and the recorder thread is running.
+ * The guide thread uses this to avoid locking the reduced guide buffer when recording is disabled.
+ * @return TRUE if guide frames should be passed to Autoguider_Guide_Recorder_Frame_Add, FALSE otherwise.
+ * @see #Recorder_Data
+ */
+int Autoguider_Guide_Recorder_Is_Enabled(void)
+{
+	return (Recorder_Data.Enable && Recorder_Data.Is_Running);
+}
+
+/**
+ * Add a guide frame to the recorder queue. This is called from the guide thread, and never blocks on disk I/O.
+ * Frames whose frame number is not a multiple of Recorder_Data.Decimate are ignored. If the queue is full,
+ * the frame is dropped (and counted in Recorder_Data.Dropped_Count). Otherwise the metadata and pixels
+ * are copied into the next free queue slot, and the recorder thread is signalled.
+ * @param frame The frame metadata. The Magic, Version and Record_Length fields are filled in by this routine.
+ * @param buffer_ptr The reduced guide frame, of frame.NCols*frame.NRows pixels.
+ *        The caller should hold the reduced guide buffer lock.
+ * @return The routine returns TRUE on success (including when the frame is ignored or dropped)
+ *         and FALSE on failure.
+ * @see #Recorder_Data
+ */
+int Autoguider_Guide_Recorder_Frame_Add(struct Autoguider_Guide_Recorder_Frame_Struct frame,float *buffer_ptr)
+{
+	struct Recorder_Slot_Struct *slot = NULL;
+	int pixel_count;
+
+	if(Autoguider_Guide_Recorder_Is_Enabled() == FALSE)
+		return TRUE;
+	if((frame.Frame_Number % Recorder_Data.Decimate) != 0)
+		return TRUE;
+	if(buffer_ptr == NULL)
+	{
+		Autoguider_General_Error_Number = 1312;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Frame_Add:buffer_ptr was NULL.");
+		return FALSE;
+	}
+	if((frame.NCols < 1)||(frame.NRows < 1))
+	{
+		Autoguider_General_Error_Number = 1313;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Frame_Add:"
+			"Illegal dimensions (%d,%d).",frame.NCols,frame.NRows);
+		return FALSE;
+	}
+	pixel_count = frame.NCols*frame.NRows;
+	frame.Magic = AUTOGUIDER_GUIDE_RECORDER_MAGIC;
+	frame.Version = AUTOGUIDER_GUIDE_RECORDER_VERSION;
+	frame.Record_Length = sizeof(struct Autoguider_Guide_Recorder_Frame_Struct)+(pixel_count*sizeof(float));
+	memset(frame.Pad,0,sizeof(frame.Pad));
+	if(!Autoguider_General_Mutex_Lock(&(Recorder_Data.Mutex)))
+		return FALSE;
+	if(Recorder_Data.Queue_Count >= Recorder_Data.Queue_Length)
+	{
+		Recorder_Data.Dropped_Count++;
+		if(!Autoguider_General_Mutex_Unlock(&(Recorder_Data.Mutex)))
+			return FALSE;
+#if AUTOGUIDER_DEBUG > 5
+		Autoguider_General_Log_Format("recorder","autoguider_guide_recorder.c",
+					      "Autoguider_Guide_Recorder_Frame_Add",LOG_VERBOSITY_VERBOSE,"RECORDER",
+					      "Queue full:Dropped frame %d of guide session %d.",frame.Frame_Number,
+					      frame.Guide_Id);
+#endif
+		return TRUE;
+	}
+	/* the recorder thread only removes a slot from the queue after it has written it,
+	** so the slot at Queue_Head+Queue_Count is not in use. */
+	slot = &(Recorder_Data.Queue[(Recorder_Data.Queue_Head+Recorder_Data.Queue_Count)%
+				     Recorder_Data.Queue_Length]);
+	if(slot->Buffer_Pixel_Count < pixel_count)
+	{
+		if(slot->Buffer != NULL)
+			free(slot->Buffer);
+		slot->Buffer = (float *)malloc(pixel_count*sizeof(float));
+		if(slot->Buffer == NULL)
+		{
+			slot->Buffer_Pixel_Count = 0;
+			Recorder_Data.Dropped_Count++;
+			Autoguider_General_Mutex_Unlock(&(Recorder_Data.Mutex));
+			Autoguider_General_Error_Number = 1314;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Frame_Add:"
+				"Failed to allocate slot buffer (%d pixels).",pixel_count);
+			return FALSE;
+		}
+		slot->Buffer_Pixel_Count = pixel_count;
+	}
+	slot->Frame = frame;
+	memcpy(slot->Buffer,buffer_ptr,pixel_count*sizeof(float));
+	Recorder_Data.Queue_Count++;
+	pthread_cond_signal(&(Recorder_Data.Condition));
+	if(!Autoguider_General_Mutex_Unlock(&(Recorder_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Get the recorder statistics.
+ * @param written_count The address of an integer to store the number of frames written to disk.
+ * @param dropped_count The address of an integer to store the number of frames dropped.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Recorder_Data
+ */
+int Autoguider_Guide_Recorder_Stats_Get(int *written_count,int *dropped_count)
+{
+	if((written_count == NULL)||(dropped_count == NULL))
+	{
+		Autoguider_General_Error_Number = 1315;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Stats_Get:NULL argument.");
+		return FALSE;
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Recorder_Data.Mutex)))
+		return FALSE;
+	(*written_count) = Recorder_Data.Written_Count;
+	(*dropped_count) = Recorder_Data.Dropped_Count;
+	if(!Autoguider_General_Mutex_Unlock(&(Recorder_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Shutdown the guide recorder. The recorder thread is told to quit, and joined. It writes any queued frames
+ * and closes the output file before quitting. The queue is then freed.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Recorder_Data
+ * @see #Recorder_Thread
+ */
+int Autoguider_Guide_Recorder_Shutdown(void)
+{
+	int i,retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("recorder","autoguider_guide_recorder.c","Autoguider_Guide_Recorder_Shutdown",
+			       LOG_VERBOSITY_TERSE,"RECORDER","started.");
+#endif
+	if(Recorder_Data.Is_Running)
+	{
+		if(!Autoguider_General_Mutex_Lock(&(Recorder_Data.Mutex)))
+			return FALSE;
+		Recorder_Data.Quit = TRUE;
+		pthread_cond_signal(&(Recorder_Data.Condition));
+		if(!Autoguider_General_Mutex_Unlock(&(Recorder_Data.Mutex)))
+			return FALSE;
+		retval = pthread_join(Recorder_Data.Thread,NULL);
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1316;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Guide_Recorder_Shutdown:"
+				"Failed to join recorder thread (%d).",retval);
+			return FALSE;
+		}
+		Recorder_Data.Is_Running = FALSE;
+	}
+	if(Recorder_Data.Queue != NULL)
+	{
+		for(i=0; i < Recorder_Data.Queue_Length; i++)
+		{
+			if(Recorder_Data.Queue[i].Buffer != NULL)
+				free(Recorder_Data.Queue[i].Buffer);
+		}
+		free(Recorder_Data.Queue);
+		Recorder_Data.Queue = NULL;
+	}
+	if(Recorder_Data.Directory != NULL)
+		free(Recorder_Data.Directory);
+	Recorder_Data.Directory = NULL;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("recorder","autoguider_guide_recorder.c","Autoguider_Guide_Recorder_Shutdown",
+				      LOG_VERBOSITY_TERSE,"RECORDER","Written %d frames, dropped %d frames:finished.",
+				      Recorder_Data.Written_Count,Recorder_Data.Dropped_Count);
+#endif
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * The recorder thread. Waits for frames to be queued, and writes them to the current output file,
+ * opening or rotating the file as necessary. The mutex is not held whilst writing, so the guide thread can
+ * queue further frames. The thread quits when Recorder_Data.Quit is set and the queue is empty,
+ * closing the output file.
+ * @param arg Not used.
+ * @return Always NULL.
+ * @see #Recorder_Data
+ * @see #Recorder_File_Open
+ * @see #Recorder_File_Close
+ * @see #Recorder_Write_Fits
+ * @see #Recorder_Write_Binary
+ */
+static void *Recorder_Thread(void *arg)
+{
+	struct Recorder_Slot_Struct *slot = NULL;
+	struct timespec current_time;
+	int retval,rotate;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("recorder","autoguider_guide_recorder.c","Recorder_Thread",
+			       LOG_VERBOSITY_TERSE,"RECORDER","started.");
+#endif
+	if(!Autoguider_General_Mutex_Lock(&(Recorder_Data.Mutex)))
+	{
+		Autoguider_General_Error("recorder","autoguider_guide_recorder.c","Recorder_Thread",
+					 LOG_VERBOSITY_TERSE,"RECORDER");
+		return NULL;
+	}
+	while(TRUE)
+	{
+		while((Recorder_Data.Queue_Count == 0)&&(Recorder_Data.Quit == FALSE))
+			pthread_cond_wait(&(Recorder_Data.Condition),&(Recorder_Data.Mutex));
+		if(Recorder_Data.Queue_Count == 0)
+			break;
+		slot = &(Recorder_Data.Queue[Recorder_Data.Queue_Head]);
+		Autoguider_General_Mutex_Unlock(&(Recorder_Data.Mutex));
+		/* rotate the output file if necessary */
+		if((Recorder_Data.Fits_Fp != NULL)||(Recorder_Data.Binary_Fp != NULL))
+		{
+			clock_gettime(CLOCK_REALTIME,&current_time);
+			rotate = FALSE;
+			if((Recorder_Data.Rotate_Size > 0)&&(Recorder_Data.File_Size >= Recorder_Data.Rotate_Size))
+				rotate = TRUE;
+			if((Recorder_Data.Rotate_Time > 0)&&
+			   (fdifftime(current_time,Recorder_Data.File_Open_Time) >= Recorder_Data.Rotate_Time))
+				rotate = TRUE;
+			if(rotate)
+			{
+				if(!Recorder_File_Close())
+				{
+					Autoguider_General_Error("recorder","autoguider_guide_recorder.c",
+								 "Recorder_Thread",LOG_VERBOSITY_TERSE,"RECORDER");
+				}
+			}
+		}
+		/* open a new output file if necessary, and write the frame */
+		retval = TRUE;
+		if((Recorder_Data.Fits_Fp == NULL)&&(Recorder_Data.Binary_Fp == NULL))
+			retval = Recorder_File_Open();
+		if(retval)
+		{
+			if(Recorder_Data.Format == RECORDER_FORMAT_FITS)
+				retval = Recorder_Write_Fits(slot);
+			else
+				retval = Recorder_Write_Binary(slot);
+		}
+		if(retval == FALSE)
+		{
+			Autoguider_General_Error("recorder","autoguider_guide_recorder.c","Recorder_Thread",
+						 LOG_VERBOSITY_TERSE,"RECORDER");
+			/* close the file, a new one will be opened for the next frame */
+			if(!Recorder_File_Close())
+			{
+				Autoguider_General_Error("recorder","autoguider_guide_recorder.c",
+							 "Recorder_Thread",LOG_VERBOSITY_TERSE,"RECORDER");
+			}
+		}
+		if(!Autoguider_General_Mutex_Lock(&(Recorder_Data.Mutex)))
+		{
+			Autoguider_General_Error("recorder","autoguider_guide_recorder.c","Recorder_Thread",
+						 LOG_VERBOSITY_TERSE,"RECORDER");
+			return NULL;
+		}
+		if(retval)
+			Recorder_Data.Written_Count++;
+		else
+			Recorder_Data.Dropped_Count++;
+		Recorder_Data.Queue_Head = (Recorder_Data.Queue_Head+1)%Recorder_Data.Queue_Length;
+		Recorder_Data.Queue_Count--;
+	}
+	Autoguider_General_Mutex_Unlock(&(Recorder_Data.Mutex));
+	if(!Recorder_File_Close())
+	{
+		Autoguider_General_Error("recorder","autoguider_guide_recorder.c","Recorder_Thread",
+					 LOG_VERBOSITY_TERSE,"RECORDER");
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("recorder","autoguider_guide_recorder.c","Recorder_Thread",
+			       LOG_VERBOSITY_TERSE,"RECORDER","finished.");
+#endif
+	return NULL;
+}
+
+/**
+ * Open a new output file in Recorder_Data.Directory, named after the current UTC time:
+ * guide_YYYYMMDD_HHMMSS.fits or guide_YYYYMMDD_HHMMSS.agr. FITS files are opened with
+ * Rice tile compression, so each image extension subsequently created is compressed (the float
+ * pixels are quantised using CFITSIO's default noise-based quantisation level).
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Recorder_Data
+ * @see #RECORDER_FORMAT
+ */
+static int Recorder_File_Open(void)
+{
+	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
+	char time_string[32];
+	struct tm *time_tm = NULL;
+	struct tm time_tm_buff;
+	int cfitsio_status = 0;
+
+	clock_gettime(CLOCK_REALTIME,&(Recorder_Data.File_Open_Time));
+	time_tm = gmtime_r(&(Recorder_Data.File_Open_Time.tv_sec),&time_tm_buff);
+	strftime(time_string,31,"%Y%m%d_%H%M%S",time_tm);
+	if(Recorder_Data.Format == RECORDER_FORMAT_FITS)
+		sprintf(Recorder_Data.Filename,"%s/guide_%s.fits",Recorder_Data.Directory,time_string);
+	else
+		sprintf(Recorder_Data.Filename,"%s/guide_%s.agr",Recorder_Data.Directory,time_string);
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("recorder","autoguider_guide_recorder.c","Recorder_File_Open",
+				      LOG_VERBOSITY_TERSE,"RECORDER","Opening '%s'.",Recorder_Data.Filename);
+#endif
+	Recorder_Data.File_Size = 0;
+	if(Recorder_Data.Format == RECORDER_FORMAT_FITS)
+	{
+		fits_create_file(&(Recorder_Data.Fits_Fp),Recorder_Data.Filename,&cfitsio_status);
+		/* an empty primary HDU, each guide frame is a compressed image extension */
+		fits_create_img(Recorder_Data.Fits_Fp,FLOAT_IMG,0,NULL,&cfitsio_status);
+		fits_set_compression_type(Recorder_Data.Fits_Fp,RICE_1,&cfitsio_status);
+		if(cfitsio_status)
+		{
+			fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+			if(Recorder_Data.Fits_Fp != NULL)
+			{
+				cfitsio_status = 0;
+				fits_close_file(Recorder_Data.Fits_Fp,&cfitsio_status);
+			}
+			Recorder_Data.Fits_Fp = NULL;
+			Autoguider_General_Error_Number = 1317;
+			sprintf(Autoguider_General_Error_String,"Recorder_File_Open:"
+				"Failed to create FITS file '%s' : %s.",Recorder_Data.Filename,cfitsio_error_buff);
+			return FALSE;
+		}
+	}
+	else
+	{
+		Recorder_Data.Binary_Fp = fopen(Recorder_Data.Filename,"ab");
+		if(Recorder_Data.Binary_Fp == NULL)
+		{
+			Autoguider_General_Error_Number = 1318;
+			sprintf(Autoguider_General_Error_String,"Recorder_File_Open:"
+				"Failed to open binary container '%s' (%d).",Recorder_Data.Filename,errno);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Close the currently open output file, if any.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Recorder_Data
+ */
+static int Recorder_File_Close(void)
+{
+	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
+	int cfitsio_status = 0;
+	int retval;
+
+	if(Recorder_Data.Fits_Fp != NULL)
+	{
+		retval = fits_close_file(Recorder_Data.Fits_Fp,&cfitsio_status);
+		Recorder_Data.Fits_Fp = NULL;
+		if(retval)
+		{
+			fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+			Autoguider_General_Error_Number = 1319;
+			sprintf(Autoguider_General_Error_String,"Recorder_File_Close:"
+				"Failed to close FITS file '%s' : %s.",Recorder_Data.Filename,cfitsio_error_buff);
+			return FALSE;
+		}
+	}
+	if(Recorder_Data.Binary_Fp != NULL)
+	{
+		retval = fclose(Recorder_Data.Binary_Fp);
+		Recorder_Data.Binary_Fp = NULL;
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1320;
+			sprintf(Autoguider_General_Error_String,"Recorder_File_Close:"
+				"Failed to close binary container '%s' (%d).",Recorder_Data.Filename,errno);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Write a queued guide frame to the open FITS file, as a new Rice compressed image extension.
+ * The frame metadata is written as FITS keywords. The approximate file size is updated by stat'ing the file.
+ * @param slot The queue slot containing the frame to write.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Recorder_Data
+ */
+static int Recorder_Write_Fits(struct Recorder_Slot_Struct *slot)
+{
+	struct Autoguider_Guide_Recorder_Frame_Struct *frame = NULL;
+	struct stat file_stat;
+	struct timespec start_time;
+	struct tm *time_tm = NULL;
+	struct tm time_tm_buff;
+	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
+	char date_obs_string[64];
+	char status_string[2];
+	long axes[2];
+	int cfitsio_status = 0;
+
+	frame = &(slot->Frame);
+	axes[0] = frame->NCols;
+	axes[1] = frame->NRows;
+	start_time.tv_sec = frame->Start_Time_Sec;
+	start_time.tv_nsec = frame->Start_Time_NSec;
+	time_tm = gmtime_r(&(start_time.tv_sec),&time_tm_buff);
+	strftime(date_obs_string,63,"%Y-%m-%dT%H:%M:%S",time_tm);
+	sprintf(date_obs_string+strlen(date_obs_string),".%03d",
+		(int)(start_time.tv_nsec/AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS));
+	status_string[0] = frame->Status_Char;
+	status_string[1] = '\0';
+	fits_create_img(Recorder_Data.Fits_Fp,FLOAT_IMG,2,axes,&cfitsio_status);
+	fits_write_img(Recorder_Data.Fits_Fp,TFLOAT,1,frame->NCols*frame->NRows,slot->Buffer,&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"AGGID",&(frame->Guide_Id),"Guide session id",&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"AGFRAME",&(frame->Frame_Number),"Guide frame number",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TSTRING,"DATE-OBS",date_obs_string,"Exposure start time (UTC)",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"EXPTIMEM",&(frame->Exposure_Length),"Exposure length (ms)",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"CCDXBIN",&(frame->Bin_X),"X binning",&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"CCDYBIN",&(frame->Bin_Y),"Y binning",&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"AGWINXS",&(frame->Window_X_Start),"Guide window X start",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"AGWINYS",&(frame->Window_Y_Start),"Guide window Y start",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"AGWINXE",&(frame->Window_X_End),"Guide window X end",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TINT,"AGWINYE",&(frame->Window_Y_End),"Guide window Y end",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TFLOAT,"CCDATEMP",&(frame->CCD_Temperature),
+			"CCD temperature (C)",&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TFLOAT,"AGCADENC",&(frame->Loop_Cadence),"Guide loop cadence (s)",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TFLOAT,"AGCENTX",&(frame->Centroid_X),"Guide centroid CCD X",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TFLOAT,"AGCENTY",&(frame->Centroid_Y),"Guide centroid CCD Y",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TFLOAT,"AGFWHMX",&(frame->FWHM_X),"Guide object FWHM X (pixels)",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TFLOAT,"AGFWHMY",&(frame->FWHM_Y),"Guide object FWHM Y (pixels)",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TFLOAT,"AGPEAK",&(frame->Peak_Counts),"Guide object peak counts",
+			&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TFLOAT,"AGTOTAL",&(frame->Total_Counts),
+			"Guide object integrated counts",&cfitsio_status);
+	fits_update_key(Recorder_Data.Fits_Fp,TSTRING,"AGSTATUS",status_string,"TCS guide packet status",
+			&cfitsio_status);
+	/* flush so the file on disk is usable if we crash, and so the size is meaningful */
+	fits_flush_buffer(Recorder_Data.Fits_Fp,0,&cfitsio_status);
+	if(cfitsio_status)
+	{
+		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+		Autoguider_General_Error_Number = 1321;
+		sprintf(Autoguider_General_Error_String,"Recorder_Write_Fits:"
+			"Failed to write frame %d of guide session %d to '%s' : %s.",frame->Frame_Number,
+			frame->Guide_Id,Recorder_Data.Filename,cfitsio_error_buff);
+		return FALSE;
+	}
+	if(stat(Recorder_Data.Filename,&file_stat) == 0)
+		Recorder_Data.File_Size = file_stat.st_size;
+	return TRUE;
+}
+
+/**
+ * Append a queued guide frame to the open binary container. The frame metadata
+ * (Autoguider_Guide_Recorder_Frame_Struct) is written followed by the pixel data.
+ * @param slot The queue slot containing the frame to write.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Recorder_Data
+ * @see autoguider_guide_recorder.html#Autoguider_Guide_Recorder_Frame_Struct
+ */
+static int Recorder_Write_Binary(struct Recorder_Slot_Struct *slot)
+{
+	size_t pixel_count;
+
+	pixel_count = slot->Frame.NCols*slot->Frame.NRows;
+	if(fwrite(&(slot->Frame),sizeof(struct Autoguider_Guide_Recorder_Frame_Struct),1,Recorder_Data.Binary_Fp) != 1)
+	{
+		Autoguider_General_Error_Number = 1322;
+		sprintf(Autoguider_General_Error_String,"Recorder_Write_Binary:"
+			"Failed to write frame %d header to '%s' (%d).",slot->Frame.Frame_Number,
+			Recorder_Data.Filename,errno);
+		return FALSE;
+	}
+	if(fwrite(slot->Buffer,sizeof(float),pixel_count,Recorder_Data.Binary_Fp) != pixel_count)
+	{
+		Autoguider_General_Error_Number = 1323;
+		sprintf(Autoguider_General_Error_String,"Recorder_Write_Binary:"
+			"Failed to write frame %d pixels to '%s' (%d).",slot->Frame.Frame_Number,
+			Recorder_Data.Filename,errno);
+		return FALSE;
+	}
+	if(fflush(Recorder_Data.Binary_Fp) != 0)
+	{
+		Autoguider_General_Error_Number = 1324;
+		sprintf(Autoguider_General_Error_String,"Recorder_Write_Binary:"
+			"Failed to flush '%s' (%d).",Recorder_Data.Filename,errno);
+		return FALSE;
+	}
+	Recorder_Data.File_Size += slot->Frame.Record_Length;
+	return TRUE;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
@@ -0,0 +1,370 @@
+/* autoguider_housekeeping.c
+** Autoguider housekeeping routines
+** $Header$
+*/
+/**
+ * Housekeeping routines for the autoguider program.
+ * When enabled (housekeeping.temperature.enable), a background housekeeping thread polls the CCD temperature
+ * and cooler status at a configured rate (housekeeping.temperature.poll.period), and publishes the last
+ * successful reading under a mutex. The field and guide loops read the published value (and its age) with
+ * Autoguider_Housekeeping_Temperature_Get to tag their buffers, rather than calling into the camera SDK
+ * after every exposure. The CCD library serializes the housekeeping thread's SDK calls against exposures
+ * (CCD_Driver_Lock), so a poll issued during an exposure waits until the readout has finished.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+#include "ccd_general.h"
+#include "ccd_temperature.h"
+
+#include "autoguider_general.h"
+#include "autoguider_housekeeping.h"
+
+/* data types */
+/**
+ * Data type holding local data to autoguider_housekeeping. This consists of the following:
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex protecting the published temperature data and the Quit flag.</dd>
+ * <dt>Condition</dt> <dd>Condition variable signalled when the housekeeping thread is told to quit.</dd>
+ * <dt>Thread</dt> <dd>The housekeeping thread.</dd>
+ * <dt>Enable</dt> <dd>Boolean, whether the housekeeping thread is used (housekeeping.temperature.enable).</dd>
+ * <dt>Poll_Period</dt> <dd>The time between temperature polls, in milliseconds
+ *     (housekeeping.temperature.poll.period).</dd>
+ * <dt>Quit</dt> <dd>Boolean, set to tell the housekeeping thread to quit.</dd>
+ * <dt>Is_Running</dt> <dd>Boolean, TRUE whilst the housekeeping thread is running.</dd>
+ * <dt>Is_Temperature_Valid</dt> <dd>Boolean, TRUE once a temperature has been successfully read.</dd>
+ * <dt>Temperature</dt> <dd>The last CCD temperature read, in degrees C.</dd>
+ * <dt>Temperature_Status</dt> <dd>The last temperature (cooler) status read.</dd>
+ * <dt>Temperature_Time_Stamp</dt> <dd>The CLOCK_REALTIME time the last temperature was read.</dd>
+ * <dt>Poll_Count</dt> <dd>The number of successful temperature polls.</dd>
+ * <dt>Failed_Count</dt> <dd>The number of failed temperature polls.</dd>
+ * </dl>
+ * @see ../ccd/cdocs/ccd_temperature.html#CCD_TEMPERATURE_STATUS
+ */
+struct Housekeeping_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	pthread_t Thread;
+	int Enable;
+	int Poll_Period;
+	int Quit;
+	int Is_Running;
+	int Is_Temperature_Valid;
+	double Temperature;
+	enum CCD_TEMPERATURE_STATUS Temperature_Status;
+	struct timespec Temperature_Time_Stamp;
+	int Poll_Count;
+	int Failed_Count;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of housekeeping data. The mutex and condition variable are statically initialised.
+ * @see #Housekeeping_Struct
+ */
+static struct Housekeeping_Struct Housekeeping_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER
+};
+
+/* internal functions */
+static void *Housekeeping_Thread(void *arg);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Initialise housekeeping. This should be called after the CCD has been initialised. Loads the following config:
+ * <ul>
+ * <li>"housekeeping.temperature.enable" - boolean.
+ * <li>"housekeeping.temperature.poll.period" - integer, the time between temperature polls in milliseconds.
+ * </ul>
+ * and, if enabled, starts the housekeeping thread.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Housekeeping_Data
+ * @see #Housekeeping_Thread
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Boolean
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ */
+int Autoguider_Housekeeping_Initialise(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("housekeeping","autoguider_housekeeping.c","Autoguider_Housekeeping_Initialise",
+			       LOG_VERBOSITY_TERSE,"HOUSEKEEPING","started.");
+#endif
+	retval = CCD_Config_Get_Boolean("housekeeping.temperature.enable",&(Housekeeping_Data.Enable));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1900;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Housekeeping_Initialise:"
+			"Failed to load config:'housekeeping.temperature.enable'.");
+		return FALSE;
+	}
+	if(Housekeeping_Data.Enable == FALSE)
+	{
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("housekeeping","autoguider_housekeeping.c",
+				       "Autoguider_Housekeeping_Initialise",LOG_VERBOSITY_TERSE,"HOUSEKEEPING",
+				       "finished:housekeeping thread disabled.");
+#endif
+		return TRUE;
+	}
+	retval = CCD_Config_Get_Integer("housekeeping.temperature.poll.period",&(Housekeeping_Data.Poll_Period));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1901;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Housekeeping_Initialise:"
+			"Failed to load config:'housekeeping.temperature.poll.period'.");
+		return FALSE;
+	}
+	if(Housekeeping_Data.Poll_Period < 1)
+	{
+		Autoguider_General_Error_Number = 1902;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Housekeeping_Initialise:"
+			"Illegal housekeeping.temperature.poll.period %d.",Housekeeping_Data.Poll_Period);
+		return FALSE;
+	}
+	Housekeeping_Data.Quit = FALSE;
+	Housekeeping_Data.Is_Temperature_Valid = FALSE;
+	Housekeeping_Data.Poll_Count = 0;
+	Housekeeping_Data.Failed_Count = 0;
+	retval = pthread_create(&(Housekeeping_Data.Thread),NULL,&Housekeeping_Thread,(void *)NULL);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 1903;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Housekeeping_Initialise:"
+			"Failed to create housekeeping thread (%d).",retval);
+		return FALSE;
+	}
+	Housekeeping_Data.Is_Running = TRUE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("housekeeping","autoguider_housekeeping.c",
+				      "Autoguider_Housekeeping_Initialise",LOG_VERBOSITY_TERSE,"HOUSEKEEPING",
+				      "Poll period = %d ms:finished.",Housekeeping_Data.Poll_Period);
+#endif
+	return TRUE;
+}
+
+/**
+ * Get the CCD temperature and temperature status last published by the housekeeping thread, and how old they are.
+ * If the housekeeping thread is not running (housekeeping.temperature.enable is false), the temperature is
+ * read directly from the CCD with CCD_Temperature_Get, and the age is zero.
+ * @param temperature The address of a double to store the temperature in, in degrees C.
+ * @param temperature_status The address of an enum to store the temperature status. Can be NULL.
+ * @param age_ms The address of an integer to store the age of the reading in milliseconds. Can be NULL.
+ * @return The routine returns TRUE on success and FALSE on failure. It fails if the housekeeping thread has
+ *         not yet read a temperature successfully.
+ * @see #Housekeeping_Data
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
+ * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Get
+ */
+int Autoguider_Housekeeping_Temperature_Get(double *temperature,
+					    enum CCD_TEMPERATURE_STATUS *temperature_status,int *age_ms)
+{
+	enum CCD_TEMPERATURE_STATUS current_temperature_status;
+	struct timespec time_stamp,current_time;
+	double current_temperature;
+	int elapsed_ms;
+
+	if(temperature == NULL)
+	{
+		Autoguider_General_Error_Number = 1904;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Housekeeping_Temperature_Get:temperature was NULL.");
+		return FALSE;
+	}
+	if(Housekeeping_Data.Is_Running == FALSE)
+	{
+		if(!CCD_Temperature_Get(&current_temperature,&current_temperature_status))
+		{
+			Autoguider_General_Error_Number = 1905;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Housekeeping_Temperature_Get:"
+				"CCD_Temperature_Get failed.");
+			return FALSE;
+		}
+		(*temperature) = current_temperature;
+		if(temperature_status != NULL)
+			(*temperature_status) = current_temperature_status;
+		if(age_ms != NULL)
+			(*age_ms) = 0;
+		return TRUE;
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Housekeeping_Data.Mutex)))
+		return FALSE;
+	if(Housekeeping_Data.Is_Temperature_Valid == FALSE)
+	{
+		Autoguider_General_Mutex_Unlock(&(Housekeeping_Data.Mutex));
+		Autoguider_General_Error_Number = 1906;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Housekeeping_Temperature_Get:"
+			"No temperature has been read yet (%d failed polls).",Housekeeping_Data.Failed_Count);
+		return FALSE;
+	}
+	current_temperature = Housekeeping_Data.Temperature;
+	current_temperature_status = Housekeeping_Data.Temperature_Status;
+	time_stamp = Housekeeping_Data.Temperature_Time_Stamp;
+	if(!Autoguider_General_Mutex_Unlock(&(Housekeeping_Data.Mutex)))
+		return FALSE;
+	clock_gettime(CLOCK_REALTIME,&current_time);
+	elapsed_ms = (int)((current_time.tv_sec-time_stamp.tv_sec)*AUTOGUIDER_GENERAL_ONE_SECOND_MS)+
+		(int)((current_time.tv_nsec-time_stamp.tv_nsec)/AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS);
+	if(elapsed_ms < 0)
+		elapsed_ms = 0;
+	(*temperature) = current_temperature;
+	if(temperature_status != NULL)
+		(*temperature_status) = current_temperature_status;
+	if(age_ms != NULL)
+		(*age_ms) = elapsed_ms;
+	return TRUE;
+}
+
+/**
+ * Shutdown housekeeping. The housekeeping thread is told to quit and joined. If the thread is waiting for an
+ * exposure to finish before polling, this waits for the exposure too.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Housekeeping_Data
+ */
+int Autoguider_Housekeeping_Shutdown(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("housekeeping","autoguider_housekeeping.c","Autoguider_Housekeeping_Shutdown",
+			       LOG_VERBOSITY_TERSE,"HOUSEKEEPING","started.");
+#endif
+	if(Housekeeping_Data.Is_Running)
+	{
+		if(!Autoguider_General_Mutex_Lock(&(Housekeeping_Data.Mutex)))
+			return FALSE;
+		Housekeeping_Data.Quit = TRUE;
+		pthread_cond_signal(&(Housekeeping_Data.Condition));
+		if(!Autoguider_General_Mutex_Unlock(&(Housekeeping_Data.Mutex)))
+			return FALSE;
+		retval = pthread_join(Housekeeping_Data.Thread,NULL);
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1907;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Housekeeping_Shutdown:"
+				"Failed to join housekeeping thread (%d).",retval);
+			return FALSE;
+		}
+		Housekeeping_Data.Is_Running = FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("housekeeping","autoguider_housekeeping.c","Autoguider_Housekeeping_Shutdown",
+				      LOG_VERBOSITY_TERSE,"HOUSEKEEPING","%d polls, %d failed:finished.",
+				      Housekeeping_Data.Poll_Count,Housekeeping_Data.Failed_Count);
+#endif
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * The housekeeping thread. Every Housekeeping_Data.Poll_Period milliseconds, reads the CCD temperature and
+ * temperature status with CCD_Temperature_Get (which waits for any exposure in progress to finish), and
+ * publishes them with a time stamp in Housekeeping_Data. Failed polls are reported through
+ * Autoguider_General_Error, and the previously published value is left in place. The thread quits when
+ * Housekeeping_Data.Quit is set.
+ * @param arg Not used.
+ * @return Always NULL.
+ * @see #Housekeeping_Data
+ * @see autoguider_general.html#Autoguider_General_Error
+ * @see ../ccd/cdocs/ccd_temperature.html#CCD_Temperature_Get
+ */
+static void *Housekeeping_Thread(void *arg)
+{
+	enum CCD_TEMPERATURE_STATUS temperature_status;
+	struct timespec time_stamp,wake_time;
+	double temperature;
+	int retval;
+
+	if(!Autoguider_General_Mutex_Lock(&(Housekeeping_Data.Mutex)))
+	{
+		Autoguider_General_Error("housekeeping","autoguider_housekeeping.c","Housekeeping_Thread",
+					 LOG_VERBOSITY_TERSE,"HOUSEKEEPING");
+		return NULL;
+	}
+	while(Housekeeping_Data.Quit == FALSE)
+	{
+		/* don't hold the mutex whilst talking to the CCD, readers must not wait for the SDK */
+		Autoguider_General_Mutex_Unlock(&(Housekeeping_Data.Mutex));
+		retval = CCD_Temperature_Get(&temperature,&temperature_status);
+		clock_gettime(CLOCK_REALTIME,&time_stamp);
+		if(retval == FALSE)
+		{
+			Autoguider_General_Error_Number = 1908;
+			sprintf(Autoguider_General_Error_String,"Housekeeping_Thread:CCD_Temperature_Get failed.");
+			Autoguider_General_Error("housekeeping","autoguider_housekeeping.c","Housekeeping_Thread",
+						 LOG_VERBOSITY_TERSE,"HOUSEKEEPING");
+		}
+		if(!Autoguider_General_Mutex_Lock(&(Housekeeping_Data.Mutex)))
+		{
+			Autoguider_General_Error("housekeeping","autoguider_housekeeping.c","Housekeeping_Thread",
+						 LOG_VERBOSITY_TERSE,"HOUSEKEEPING");
+			return NULL;
+		}
+		if(retval)
+		{
+			Housekeeping_Data.Temperature = temperature;
+			Housekeeping_Data.Temperature_Status = temperature_status;
+			Housekeeping_Data.Temperature_Time_Stamp = time_stamp;
+			Housekeeping_Data.Is_Temperature_Valid = TRUE;
+			Housekeeping_Data.Poll_Count++;
+#if AUTOGUIDER_DEBUG > 9
+			Autoguider_General_Log_Format("housekeeping","autoguider_housekeeping.c","Housekeeping_Thread",
+						      LOG_VERBOSITY_VERY_VERBOSE,"HOUSEKEEPING",
+						      "Temperature %.2f C, status %s.",temperature,
+						      CCD_Temperature_Status_To_String(temperature_status));
+#endif
+		}
+		else
+			Housekeeping_Data.Failed_Count++;
+		/* wait until the next poll is due, or we are told to quit */
+		wake_time = time_stamp;
+		wake_time.tv_sec += Housekeeping_Data.Poll_Period/AUTOGUIDER_GENERAL_ONE_SECOND_MS;
+		wake_time.tv_nsec += (Housekeeping_Data.Poll_Period%AUTOGUIDER_GENERAL_ONE_SECOND_MS)*
+			AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS;
+		if(wake_time.tv_nsec >= AUTOGUIDER_GENERAL_ONE_SECOND_NS)
+		{
+			wake_time.tv_sec++;
+			wake_time.tv_nsec -= AUTOGUIDER_GENERAL_ONE_SECOND_NS;
+		}
+		retval = 0;
+		while((Housekeeping_Data.Quit == FALSE)&&(retval != ETIMEDOUT))
+		{
+			retval = pthread_cond_timedwait(&(Housekeeping_Data.Condition),&(Housekeeping_Data.Mutex),
+							&wake_time);
+		}
+	}
+	Autoguider_General_Mutex_Unlock(&(Housekeeping_Data.Mutex));
+	return NULL;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
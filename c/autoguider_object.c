@@ -6,6 +6,8 @@
  * Object detection routines for the autoguider program.
  * Uses libdprt_object.
  * Has it's own buffer, as Object_List_Get destroys the data within it's buffer argument.
+ * Autoguider_Object_Detect_Tiled splits field images into tiles (bands of rows): the background statistics
+ * and Object_List_Get run per tile on the worker pool, and objects crossing tile boundaries are merged afterwards.
  * @author Chris Mottram
  * @version $Revision: 1.18 $
  */
@@ -22,6 +24,7 @@
 #include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
@@ -35,12 +38,28 @@
 #include "autoguider_field.h"
 #include "autoguider_general.h"
 #include "autoguider_object.h"
+#include "autoguider_realtime.h"
+#include "autoguider_telemetry.h"
+#include "autoguider_worker_pool.h"
 
 /* hash defines */
 /**
  * Maximum number of pixels to do stats on.
  */
 #define MAXIMUM_STATS_COUNT (100000)
+/**
+ * The default size of a cell in the object catalogue grid index, in pixels.
+ */
+#define OBJECT_CATALOGUE_GRID_CELL_SIZE     (32.0f)
+/**
+ * The maximum number of cells in the object catalogue grid index. If the detected objects span a larger area,
+ * the cell size is increased to keep the grid this size or smaller.
+ */
+#define OBJECT_CATALOGUE_GRID_MAX_CELLS     (4096)
+/**
+ * The minimum number of object mask spans to allocate space for, when Mask_Span_List is first allocated.
+ */
+#define OBJECT_MASK_SPAN_MIN_ALLOCATE       (256)
 
 /* data types */
 /**
@@ -56,6 +75,136 @@ enum OBJECT_THRESHOLD_STATS_TYPE
 	OBJECT_THRESHOLD_STATS_TYPE_SIMPLE,OBJECT_THRESHOLD_STATS_TYPE_SIGMA_CLIP
 };
 
+/**
+ * Data type holding a per-frame catalogue of the detected objects, stored as a structure of arrays,
+ * and a uniform grid index of the object positions. It is built once per frame after object detection
+ * (Object_Catalogue_Build), and is protected by Object_List_Mutex. Element i of each array refers to
+ * Object_List[i]. This consists of the following:
+ * <dl>
+ * <dt>X</dt> <dd>Allocated list of object CCD X positions.</dd>
+ * <dt>Y</dt> <dd>Allocated list of object CCD Y positions.</dd>
+ * <dt>Total_Counts</dt> <dd>Allocated list of object total counts.</dd>
+ * <dt>Rank_List</dt> <dd>Allocated list of the indices of objects inside the field object bounds, 
+ *                        brightest first.</dd>
+ * <dt>Count</dt> <dd>The number of objects in the catalogue.</dd>
+ * <dt>Rank_Count</dt> <dd>The number of indices in Rank_List.</dd>
+ * <dt>Allocated_Count</dt> <dd>The number of objects allocated space for in the lists.</dd>
+ * <dt>Grid_Min_X</dt> <dd>The CCD X position of the left edge of the grid.</dd>
+ * <dt>Grid_Min_Y</dt> <dd>The CCD Y position of the bottom edge of the grid.</dd>
+ * <dt>Cell_Size</dt> <dd>The size of a (square) grid cell, in pixels.</dd>
+ * <dt>Grid_NCols</dt> <dd>The number of grid columns.</dd>
+ * <dt>Grid_NRows</dt> <dd>The number of grid rows.</dd>
+ * <dt>Cell_Start</dt> <dd>Allocated list of (Grid_NCols*Grid_NRows)+1 offsets into Cell_Object_List. 
+ *                         The objects in cell c are at Cell_Object_List[Cell_Start[c]..Cell_Start[c+1]-1].</dd>
+ * <dt>Allocated_Cell_Count</dt> <dd>The number of cell offsets allocated space for in Cell_Start.</dd>
+ * <dt>Cell_Object_List</dt> <dd>Allocated list of object indices, sorted by grid cell. Within a cell the indices
+ *                               are in ascending (brightest first) order.</dd>
+ * </dl>
+ * @see #Object_Catalogue_Build
+ */
+struct Object_Catalogue_Struct
+{
+	float *X;
+	float *Y;
+	float *Total_Counts;
+	int *Rank_List;
+	int Count;
+	int Rank_Count;
+	int Allocated_Count;
+	float Grid_Min_X;
+	float Grid_Min_Y;
+	float Cell_Size;
+	int Grid_NCols;
+	int Grid_NRows;
+	int *Cell_Start;
+	int Allocated_Cell_Count;
+	int *Cell_Object_List;
+};
+
+/**
+ * Data type holding a span of object mask pixels, that are contiguous in the (binned) image data, 
+ * and belong to the same object. This consists of the following:
+ * <dl>
+ * <dt>Pixel_Index</dt> <dd>The index of the first pixel of the span, i.e. (y*Binned_NCols)+x.</dd>
+ * <dt>Length</dt> <dd>The number of pixels in the span.</dd>
+ * <dt>Label</dt> <dd>The object number (modulo 65536) the pixels belong to, the value of the pixels in the
+ *                    object mask image.</dd>
+ * </dl>
+ * @see #Object_Mask_Create
+ * @see #Autoguider_Object_Mask_Copy
+ */
+struct Object_Mask_Span_Struct
+{
+	int Pixel_Index;
+	int Length;
+	unsigned short Label;
+};
+
+/**
+ * Data type holding one tile (band of rows) of the image, for Autoguider_Object_Detect_Tiled. 
+ * This consists of the following:
+ * <dl>
+ * <dt>Start_Row</dt> <dd>The first row of the tile in Image_Data.</dd>
+ * <dt>Row_Count</dt> <dd>The number of rows in the tile.</dd>
+ * <dt>Stats_Start_Index</dt> <dd>The first element of Stats_List filled from this tile.</dd>
+ * <dt>Stats_Count</dt> <dd>The number of elements of Stats_List filled (and sorted) from this tile.</dd>
+ * <dt>Stats_Step</dt> <dd>The number of pixels in Image_Data between each pixel put into Stats_List.</dd>
+ * <dt>Stats_Merge_Index</dt> <dd>The next element of this tile's part of Stats_List to be merged.</dd>
+ * <dt>Object_List</dt> <dd>The objects Object_List_Get found in the tile. Their positions and pixels are
+ *     moved into whole image coordinates.</dd>
+ * <dt>Retval</dt> <dd>The return value of the tile's job, TRUE on success and FALSE on failure.</dd>
+ * </dl>
+ * @see #Object_Stats_Tile_Fill
+ * @see #Object_Tile_Detect
+ */
+struct Object_Tile_Struct
+{
+	int Start_Row;
+	int Row_Count;
+	int Stats_Start_Index;
+	int Stats_Count;
+	int Stats_Step;
+	int Stats_Merge_Index;
+	Object *Object_List;
+	int Retval;
+};
+
+/**
+ * Data type holding an object found in a tile which has pixels on a row next to another tile, so may be
+ * part of an object crossing the tile boundary. Pieces are grouped with a union-find forest.
+ * <dl>
+ * <dt>Object</dt> <dd>The object.</dd>
+ * <dt>Tile_Index</dt> <dd>The index of the tile the object was found in.</dd>
+ * <dt>Parent</dt> <dd>The index of the parent piece in the union-find forest.</dd>
+ * <dt>Group_Head</dt> <dd>For a root piece, the index of the first piece in its group, or -1.</dd>
+ * <dt>Group_Next</dt> <dd>The index of the next piece in this piece's group, or -1.</dd>
+ * </dl>
+ * @see #Object_Tile_Merge
+ */
+struct Object_Tile_Piece_Struct
+{
+	Object *Object;
+	int Tile_Index;
+	int Parent;
+	int Group_Head;
+	int Group_Next;
+};
+
+/**
+ * Data type holding an object kept by Object_Tile_Merge, with the index of its first pixel in raster order
+ * ((y*Binned_NCols)+x), which the merged objects are sorted by.
+ * <dl>
+ * <dt>Object</dt> <dd>The object.</dd>
+ * <dt>Raster_Index</dt> <dd>The smallest pixel index of the object's pixels.</dd>
+ * </dl>
+ * @see #Object_Tile_Merge
+ */
+struct Object_Tile_Keep_Struct
+{
+	Object *Object;
+	int Raster_Index;
+};
+
 /**
  * Data type holding local data to autoguider_object. This consists of the following:
  * <dl>
@@ -68,19 +217,31 @@ enum OBJECT_THRESHOLD_STATS_TYPE
  * <dt>Threshold_Sigma_Reject</dt> <dd>Loaded from config, used to compute the background S.D. 
  *                                 when Threshold_Stats_Type is OBJECT_THRESHOLD_STATS_TYPE_SIGMA_CLIP.</dd>
  * <dt>Min_Connected_Pixel_Count</dt> <dd>Number of connected pixels required for an object to be considered valid.</dd>
+ * <dt>Guide_Isolation_Radius</dt> <dd>Loaded from config, the radius in pixels within which a guide object
+ *                                 selected as the brightest must have no neighbouring objects. Zero disables the test.</dd>
  * <dt>Binned_NCols</dt> <dd>Number of binned columns in the image_data.</dd>
  * <dt>Binned_NRows</dt> <dd>Number of binned rows in the image_data.</dd>
  * <dt>Image_Data</dt> <dd>Pointer to float data containing the image data.</dd>
  * <dt>Image_Data_Allocated_Pixel_Count</dt> <dd>Number of pixels allocated for Image_Data.</dd>
  * <dt>Image_Data_Mutex</dt> <dd>A mutex to lock access to the image data.</dd>
- * <dt>Object_Mask_Data</dt> <dd>Pointer to an allocated array of unsigned short data containing mask data for each 
- *                               detected object in the image.</dd>
+ * <dt>Mask_Span_List</dt> <dd>Allocated list of spans of pixels belonging to each detected object in the image.
+ *                             The object mask image is only created from this list when it is asked for
+ *                             (Autoguider_Object_Mask_Copy). Protected by Image_Data_Mutex.</dd>
+ * <dt>Mask_Span_Count</dt> <dd>The number of spans in Mask_Span_List.</dd>
+ * <dt>Allocated_Mask_Span_Count</dt> <dd>The number of spans allocated space for in Mask_Span_List.</dd>
+ * <dt>Mask_Span_Count_Max</dt> <dd>Loaded from config in real-time mode, the number of spans preallocated in 
+ *                                  Mask_Span_List. The list is not grown past this in real-time mode.</dd>
+ * <dt>Mask_Span_Dropped_Pixel_Count</dt> <dd>The number of detected pixels left out of Mask_Span_List in the
+ *                                  last object detection, because the list was full.</dd>
  * <dt>Object_List</dt> <dd>A list of Autoguider_Object_Struct containing the objects found in the image data.</dd>
  * <dt>Object_Count</dt> <dd>The number of objects currently in Object_List.</dd>
  * <dt>Allocated_Object_Count</dt> <dd>The number of objects allocated space for in Object_List.</dd>
  * <dt>Object_List_Mutex</dt> <dd>A mutex to lock access to the object list.</dd>
+ * <dt>Catalogue</dt> <dd>The catalogue and grid index of the objects in Object_List, 
+ *                        also protected by Object_List_Mutex.</dd>
  * <dt>Stats_List</dt> <dd>A subset of pixel data messed around with to get mean/median/SD.</dd>
  * <dt>Stats_Count</dt> <dd>The number of pixels in Stats_List (up to a maximum of MAXIMUM_STATS_COUNT).</dd>
+ * <dt>Stats_Merge_List</dt> <dd>Where the sorted parts of Stats_List filled per tile are merged.</dd>
  * <dt>Median</dt> <dd>The median value in Stats_List.</dd>
  * <dt>Mean</dt> <dd>The mean value in Stats_List.</dd>
  * <dt>Background_Standard_Deviation</dt> <dd>The standard deviation of values in Stats_List.</dd>
@@ -90,6 +251,8 @@ enum OBJECT_THRESHOLD_STATS_TYPE
  * </dl>
  * @see #OBJECT_THRESHOLD_STATS_TYPE
  * @see #Autoguider_Object_Struct
+ * @see #Object_Catalogue_Struct
+ * @see #Object_Mask_Span_Struct
  * @see #MAXIMUM_STATS_COUNT
  */
 struct Object_Internal_Struct
@@ -100,22 +263,29 @@ struct Object_Internal_Struct
 	float Threshold_Sigma;
 	float Threshold_Sigma_Reject;
 	int Min_Connected_Pixel_Count;
+	float Guide_Isolation_Radius;
 	/* input image related data */
 	int Binned_NCols;
 	int Binned_NRows;
 	float *Image_Data;
 	int Image_Data_Allocated_Pixel_Count;
 	pthread_mutex_t Image_Data_Mutex;
-	/* a generated object mask image showing pixels belonging to each detected image */
-	unsigned short *Object_Mask_Data;
+	/* spans of pixels belonging to each detected object, used to generate the object mask image */
+	struct Object_Mask_Span_Struct *Mask_Span_List;
+	int Mask_Span_Count;
+	int Allocated_Mask_Span_Count;
+	int Mask_Span_Count_Max;
+	int Mask_Span_Dropped_Pixel_Count;
 	/* object data */
 	struct Autoguider_Object_Struct *Object_List;
 	int Object_Count;
 	int Allocated_Object_Count;
 	pthread_mutex_t Object_List_Mutex;
+	struct Object_Catalogue_Struct Catalogue;
 	/* stats data */
 	float Stats_List[MAXIMUM_STATS_COUNT];
 	int Stats_Count;
+	float Stats_Merge_List[MAXIMUM_STATS_COUNT];
 	float Median;
 	float Mean;
 	float Background_Standard_Deviation;
@@ -136,24 +306,45 @@ static char rcsid[] = "$Id: autoguider_object.c,v 1.18 2014-01-31 17:15:45 cjm E
  */
 static struct Object_Internal_Struct Object_Data = 
 {
-	0.5,OBJECT_THRESHOLD_STATS_TYPE_SIGMA_CLIP,7.0,5.0,8,
+	0.5,OBJECT_THRESHOLD_STATS_TYPE_SIGMA_CLIP,7.0,5.0,8,0.0f,
 	-1,-1,
-	NULL,0,PTHREAD_MUTEX_INITIALIZER,NULL,
+	NULL,0,PTHREAD_MUTEX_INITIALIZER,
+	NULL,0,0,0,0,
 	NULL,0,0,PTHREAD_MUTEX_INITIALIZER,
-	{0.0f,0.0f,0.0f,0.0f,0.0f},0,
+	{NULL,NULL,NULL,NULL,0,0,0,0.0f,0.0f,0.0f,0,0,NULL,0,NULL},
+	{0.0f,0.0f,0.0f,0.0f,0.0f},0,{0.0f},
 	0.0f,0.0f,0.0f,0.0f,0,0
 };
 
 static int Object_Buffer_Set(float *buffer,int naxis1,int naxis2);
 static int Object_Buffer_Copy(float *buffer,int naxis1,int naxis2);
-static int Object_Create_Object_List(int use_standard_deviation,int start_x,int start_y);
-static int Object_Set_Threshold(int use_standard_deviation);
+static int Object_Create_Object_List(float *buffer,int use_standard_deviation,int start_x,int start_y,
+				     int tile_count);
+static int Object_Set_Threshold(int use_standard_deviation,int tile_count);
 static void Object_Fill_Stats_List(void);
+static int Object_Fill_Stats_List_Tiled(int tile_count);
+static void Object_Stats_Tile_Fill(void *user_arg);
+static int Object_List_Get_Tiled(float *buffer,int tile_count,Object **object_list);
+static void Object_Tile_Detect(void *user_arg);
+static int Object_Tile_Merge(float *buffer,struct Object_Tile_Struct *tile_list,int tile_count,
+			     Object **object_list);
+static int Object_Tile_Is_Edge_Object(Object *object,struct Object_Tile_Struct *tile,int has_tile_above,
+				      int has_tile_below);
+static int Object_Tile_Piece_Find(struct Object_Tile_Piece_Struct *piece_list,int piece_index);
+static int Object_Tile_Group_Detect(float *buffer,struct Object_Tile_Piece_Struct *piece_list,int root_index,
+				    struct Object_Tile_Keep_Struct *keep_list,int *keep_count);
+static void Object_Translate(Object *object,int x_offset,int y_offset);
 static int Object_Get_Mean_Standard_Deviation_Simple(void);
 static int Object_Get_Mean_Standard_Deviation_Sigma_Reject(void);
-static void Object_Mask_Create(Object *object_list);
+static int Object_Mask_Create(Object *object_list);
+static int Object_Catalogue_Build(void);
+static int Object_Catalogue_Cell_Get(float x,float y);
+static void Object_Catalogue_Nearest(float x,float y,int exclude_index,int *nearest_index,float *distance_squared);
+static int Object_Catalogue_Radius(float x,float y,float radius,int *index_list,int max_index_count);
+static void Object_Catalogue_Free(void);
 static int Object_Sort_Float_List(const void *p1, const void *p2);
 static int Object_Sort_Object_List_By_Total_Counts(const void *p1, const void *p2);
+static int Object_Sort_Tile_Keep_List_By_Raster_Index(const void *p1, const void *p2);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -172,8 +363,18 @@ static int Object_Sort_Object_List_By_Total_Counts(const void *p1, const void *p
  *     used to compute the background S.D. when Threshold_Stats_Type is OBJECT_THRESHOLD_STATS_TYPE_SIGMA_CLIP.
  * <li>We load "object.min_connected_pixel_count" from config and set Object_Data.Min_Connected_Pixel_Count,
  *     which is the number of connected pixels required for an object to be considered valid.
+ * <li>We load "object.guide.isolation_radius" from config and set Object_Data.Guide_Isolation_Radius,
+ *     the radius within which a brightest guide object must have no neighbours (zero disables the test).
+ * <li>In real-time mode, we load "ccd.field.ncols" and "ccd.field.nrows" and call Object_Buffer_Set to
+ *     preallocate the image buffer for a full frame.
+ * <li>In real-time mode, we load "object.mask.span.count.max" into Object_Data.Mask_Span_Count_Max, and
+ *     preallocate Mask_Span_List to that many spans.
  * </ul>
  * @see #Object_Data
+ * @see #Object_Buffer_Set
+ * @see #Object_Mask_Span_Struct
+ * @see autoguider_realtime.html#Autoguider_Realtime_Is_Enabled
+ * @see autoguider_realtime.html#Autoguider_Realtime_Buffer_Allocate
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Float
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
  * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
@@ -182,7 +383,7 @@ static int Object_Sort_Object_List_By_Total_Counts(const void *p1, const void *p
 int Autoguider_Object_Initialise(void)
 {
 	char *stats_type_string = NULL;
-	int retval;
+	int retval,ncols,nrows;
 	
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("object","autoguider_object.c","Autoguider_Object_Detect",LOG_VERBOSITY_TERSE,
@@ -254,6 +455,75 @@ int Autoguider_Object_Initialise(void)
 			"Failed to load config:'object.min_connected_pixel_count'.");
 		return FALSE;
 	}
+	/* guide object isolation radius */
+	if(!CCD_Config_Get_Float("object.guide.isolation_radius",&(Object_Data.Guide_Isolation_Radius)))
+	{
+		Autoguider_General_Error_Number = 1042;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Object_Initialise:"
+			"Failed to load config:'object.guide.isolation_radius'.");
+		return FALSE;
+	}
+	if(Object_Data.Guide_Isolation_Radius < 0.0f)
+	{
+		Autoguider_General_Error_Number = 1043;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Object_Initialise:"
+			"Config:'object.guide.isolation_radius' was negative (%.2f).",
+			Object_Data.Guide_Isolation_Radius);
+		return FALSE;
+	}
+	/* in real-time mode, size the image buffer for a full frame and the mask span list to the configured
+	** limit now, so they are never reallocated whilst guiding */
+	if(Autoguider_Realtime_Is_Enabled())
+	{
+		if(!CCD_Config_Get_Integer("ccd.field.ncols",&ncols))
+		{
+			Autoguider_General_Error_Number = 1039;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Object_Initialise:"
+				"Failed to load config:'ccd.field.ncols'.");
+			return FALSE;
+		}
+		if(!CCD_Config_Get_Integer("ccd.field.nrows",&nrows))
+		{
+			Autoguider_General_Error_Number = 1040;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Object_Initialise:"
+				"Failed to load config:'ccd.field.nrows'.");
+			return FALSE;
+		}
+		if(!Object_Buffer_Set(NULL,ncols,nrows))
+			return FALSE;
+		if(!CCD_Config_Get_Integer("object.mask.span.count.max",&(Object_Data.Mask_Span_Count_Max)))
+		{
+			Autoguider_General_Error_Number = 1045;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Object_Initialise:"
+				"Failed to load config:'object.mask.span.count.max'.");
+			return FALSE;
+		}
+		if(Object_Data.Mask_Span_Count_Max < 1)
+		{
+			Autoguider_General_Error_Number = 1046;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Object_Initialise:"
+				"Config:'object.mask.span.count.max' was not positive (%d).",
+				Object_Data.Mask_Span_Count_Max);
+			return FALSE;
+		}
+		if(!Autoguider_General_Mutex_Lock(&(Object_Data.Image_Data_Mutex)))
+			return FALSE;
+		Object_Data.Mask_Span_Count = 0;
+		Object_Data.Allocated_Mask_Span_Count = 0;
+		if(!Autoguider_Realtime_Buffer_Allocate((void **)&(Object_Data.Mask_Span_List),
+				  Object_Data.Mask_Span_Count_Max*sizeof(struct Object_Mask_Span_Struct)))
+		{
+			Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
+			Autoguider_General_Error_Number = 1044;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Object_Initialise:"
+				"failed to allocate object mask span list (%d spans).",
+				Object_Data.Mask_Span_Count_Max);
+			return FALSE;
+		}
+		Object_Data.Allocated_Mask_Span_Count = Object_Data.Mask_Span_Count_Max;
+		if(!Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex)))
+			return FALSE;
+	}
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("object","autoguider_object.c","Autoguider_Object_Initialise",LOG_VERBOSITY_TERSE,
 			       "OBJECT","finished.");
@@ -310,7 +580,7 @@ int Autoguider_Object_Detect(float *buffer,int naxis1,int naxis2,int start_x,int
 		return FALSE;
 	Object_Data.Id = id;
 	Object_Data.Frame_Number = frame_number;
-	if(!Object_Create_Object_List(use_standard_deviation,start_x,start_y))
+	if(!Object_Create_Object_List(buffer,use_standard_deviation,start_x,start_y,1))
 		return FALSE;
 #if AUTOGUIDER_DEBUG > 1
 	Autoguider_General_Log("object","autoguider_object.c","Autoguider_Object_Detect",LOG_VERBOSITY_TERSE,
@@ -319,10 +589,76 @@ int Autoguider_Object_Detect(float *buffer,int naxis1,int naxis2,int start_x,int
 	return TRUE;
 }
 
+/**
+ * Detect objects on the passed in image data, splitting the image into tile_count tiles (bands of rows)
+ * processed on the worker pool. This is the same as Autoguider_Object_Detect, except:
+ * <ul>
+ * <li>The background statistics pixels are collected and sorted per tile (Object_Fill_Stats_List_Tiled).
+ * <li>Object_List_Get is called per tile, and objects crossing tile boundaries are merged (Object_List_Get_Tiled).
+ * </ul>
+ * The detected objects are the same as Autoguider_Object_Detect would find (up to floating point rounding
+ * in the positions, as each tile's positions are computed relative to the tile).
+ * Object_List_Get is called from the worker threads concurrently, on separate tiles.
+ * @param buffer A float array containing the buffer with reduced data in it. This is not modified, and
+ *        is re-read to detect objects crossing tile boundaries.
+ * @param naxis1 The number of columns in the buffer.
+ * @param naxis2 The number of rows in the buffer.
+ * @param start_x The start of the buffer's X position on the physical CCD. 0 for full frame.
+ * @param start_y The start of the buffer's Y position on the physical CCD. 0 for full frame.
+ * @param use_standard_deviation Whether to use the frame's standard deviation when calculating object threshold 
+ *        for detection. 
+ * @param id An identifier for the buffer/exposure that is about to be object detected. 
+ * @param frame_number The guide/field frame number that generated these objects.
+ * @param tile_count The number of tiles to split the image into. 1 is the same as Autoguider_Object_Detect.
+ * @return The routine returns TRUE on success, and FALSE on failure.
+ * @see #Object_Data
+ * @see #Object_Buffer_Set
+ * @see #Object_Buffer_Copy
+ * @see #Object_Create_Object_List
+ * @see #Autoguider_Object_Detect
+ * @see autoguider_worker_pool.html#Autoguider_Worker_Pool_Run
+ */
+int Autoguider_Object_Detect_Tiled(float *buffer,int naxis1,int naxis2,int start_x,int start_y,
+				   int use_standard_deviation,int id,int frame_number,int tile_count)
+{
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("object","autoguider_object.c","Autoguider_Object_Detect_Tiled",
+				      LOG_VERBOSITY_TERSE,"OBJECT","Autoguider_Object_Detect_Tiled(%d tiles):started.",
+				      tile_count);
+#endif
+	if(buffer == NULL)
+	{
+		Autoguider_General_Error_Number = 1047;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Object_Detect_Tiled:buffer was NULL.");
+		return FALSE;
+	}
+	if(tile_count < 1)
+	{
+		Autoguider_General_Error_Number = 1048;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Object_Detect_Tiled:"
+			"Illegal tile count %d.",tile_count);
+		return FALSE;
+	}
+	if(!Object_Buffer_Set(buffer,naxis1,naxis2))
+		return FALSE;
+	if(!Object_Buffer_Copy(buffer,naxis1,naxis2))
+		return FALSE;
+	Object_Data.Id = id;
+	Object_Data.Frame_Number = frame_number;
+	if(!Object_Create_Object_List(buffer,use_standard_deviation,start_x,start_y,tile_count))
+		return FALSE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("object","autoguider_object.c","Autoguider_Object_Detect_Tiled",LOG_VERBOSITY_TERSE,
+			       "OBJECT","finished.");
+#endif
+	return TRUE;
+}
+
 /**
  * Free up internal object data.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Object_Data
+ * @see #Object_Catalogue_Free
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Mutex_Lock
  * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
@@ -344,9 +680,12 @@ int Autoguider_Object_Shutdown(void)
 		free(Object_Data.Image_Data);
 	Object_Data.Image_Data = NULL;
 	Object_Data.Image_Data_Allocated_Pixel_Count = 0;
-	/* and also free object mask data */
-	if(Object_Data.Object_Mask_Data != NULL)
-		free(Object_Data.Object_Mask_Data);
+	/* and also free object mask span data */
+	if(Object_Data.Mask_Span_List != NULL)
+		free(Object_Data.Mask_Span_List);
+	Object_Data.Mask_Span_List = NULL;
+	Object_Data.Mask_Span_Count = 0;
+	Object_Data.Allocated_Mask_Span_Count = 0;
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
 	if(retval == FALSE)
@@ -361,6 +700,7 @@ int Autoguider_Object_Shutdown(void)
 	Object_Data.Object_List = NULL;
 	Object_Data.Object_Count = 0;
 	Object_Data.Allocated_Object_Count = 0;
+	Object_Catalogue_Free();
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
 	if(retval == FALSE)
@@ -451,12 +791,14 @@ int Autoguider_Object_List_Get_Object(int index,struct Autoguider_Object_Struct
 
 /**
  * Get the detected object nearest the specified CCD pixel position from the object list.
- * The relevant Object_List mutex is locked and un-locked.
+ * The relevant Object_List mutex is locked and un-locked. The search uses the catalogue grid index
+ * (Object_Catalogue_Nearest), rather than scanning the whole object list.
  * @param ccd_x_position The X position on the CCD.
  * @param ccd_y_position The Y position on the CCD.
  * @param object The address of an Autoguider_Object_Struct to store the selected object.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Object_Data
+ * @see #Object_Catalogue_Nearest
  * @see #Autoguider_Object_Struct
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
@@ -466,8 +808,8 @@ int Autoguider_Object_List_Get_Object(int index,struct Autoguider_Object_Struct
 int Autoguider_Object_List_Get_Nearest_Object(float ccd_x_position,float ccd_y_position,
 					      struct Autoguider_Object_Struct *object)
 {
-	int index,selected_object_index;
-	float distance,closest_distance,xsq,ysq,xdiff,ydiff;
+	int selected_object_index;
+	float distance_squared;
 	int retval;
 
 	if(object == NULL)
@@ -486,31 +828,25 @@ int Autoguider_Object_List_Get_Nearest_Object(float ccd_x_position,float ccd_y_p
 				      "Selecting object nearest (%.2f,%.2f) from %d objects.",
 				      ccd_x_position,ccd_y_position,Object_Data.Object_Count);
 #endif
-	closest_distance = 999999.9f;
-	for(index = 0; index < Object_Data.Object_Count; index++)
+	/* NB no test against field object bounds
+	** Probably not needed in this case - unless specified pixel is in a silly place */
+	Object_Catalogue_Nearest(ccd_x_position,ccd_y_position,-1,&selected_object_index,&distance_squared);
+	if(selected_object_index < 0)
 	{
-		/* NB no test against field object bounds
-		** Probably not needed in this case - unless specified pixel is in a silly place */
-		xdiff = Object_Data.Object_List[index].CCD_X_Position-ccd_x_position;
-		ydiff = Object_Data.Object_List[index].CCD_Y_Position-ccd_y_position;
-		xsq = xdiff*xdiff;
-		ysq = ydiff*ydiff;
-		distance = (float)sqrt((double)(xsq + ysq));
+		Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
+		Autoguider_General_Error_Number = 1032;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Object_List_Get_Nearest_Object:No objects.");
+		return FALSE;
+	}
 #if AUTOGUIDER_DEBUG > 9
-		Autoguider_General_Log_Format("object","autoguider_object.c",
-					      "Autoguider_Object_List_Get_Nearest_Object",
-					      LOG_VERBOSITY_VERBOSE,"OBJECT",
-					     "Object index %d (%.2f,%.2f) is %.2f pixels away from (%.2f,%.2f).",index,
-					      Object_Data.Object_List[index].CCD_X_Position,
-					      Object_Data.Object_List[index].CCD_Y_Position,
-					      distance,ccd_x_position,ccd_y_position);
+	Autoguider_General_Log_Format("object","autoguider_object.c",
+				      "Autoguider_Object_List_Get_Nearest_Object",LOG_VERBOSITY_VERBOSE,"OBJECT",
+				      "Object index %d (%.2f,%.2f) is %.2f pixels away from (%.2f,%.2f).",
+				      selected_object_index,
+				      Object_Data.Object_List[selected_object_index].CCD_X_Position,
+				      Object_Data.Object_List[selected_object_index].CCD_Y_Position,
+				      sqrt((double)distance_squared),ccd_x_position,ccd_y_position);
 #endif
-		if(distance <  closest_distance)
-		{
-			closest_distance = distance;
-			selected_object_index = index;
-		}
-	}/* end for */
 	(*object) = Object_Data.Object_List[selected_object_index];
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
@@ -520,7 +856,11 @@ int Autoguider_Object_List_Get_Nearest_Object(float ccd_x_position,float ccd_y_p
 }
 
 /**
- * Routine to select a suitable guide object from the list.
+ * Routine to select a suitable guide object from the list. The selection uses the object catalogue built
+ * after object detection: the brightest and rank selections use the catalogue's list of in bounds objects
+ * (Rank_List), and the pixel selection uses the catalogue grid index. The brightest selection picks the brightest
+ * object with no neighbour within Guide_Isolation_Radius pixels (a radius query on the grid index), 
+ * falling back to the brightest object if none are isolated.
  * @param on_type How to select the AG guide object.
  * @param pixel_x If on_type is COMMAND_AG_ON_TYPE_PIXEL, the x pixel position.
  * @param pixel_y If on_type is COMMAND_AG_ON_TYPE_PIXEL, the y pixel position.
@@ -529,8 +869,9 @@ int Autoguider_Object_List_Get_Nearest_Object(float ccd_x_position,float ccd_y_p
  * @param selected_object_index The address of an integer to store the selected object index.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Object_Data
+ * @see #Object_Catalogue_Nearest
+ * @see #Object_Catalogue_Radius
  * @see autoguider_command.html#COMMAND_AG_ON_TYPE
- * @see autoguider_field.html#Autoguider_Field_In_Object_Bounds
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Log
@@ -538,8 +879,8 @@ int Autoguider_Object_List_Get_Nearest_Object(float ccd_x_position,float ccd_y_p
 int Autoguider_Object_Guide_Object_Get(enum COMMAND_AG_ON_TYPE on_type,float pixel_x,float pixel_y,
 				       int rank,int *selected_object_index)
 {
-	int index,retval,in_bounds_count;
-	float max_total_counts,distance,closest_distance,xsq,ysq,xdiff,ydiff;
+	int retval,rank_index,index;
+	float distance_squared;
 
 	if(selected_object_index == NULL)
 	{
@@ -568,101 +909,83 @@ int Autoguider_Object_Guide_Object_Get(enum COMMAND_AG_ON_TYPE on_type,float pix
 	switch(on_type)
 	{
 		case COMMAND_AG_ON_TYPE_BRIGHTEST:
-			index = 0;
-			max_total_counts = 0.0f;
-			while(index < Object_Data.Object_Count)
+			/* Rank_List contains in bounds objects, sorted by total counts (brightest first).
+			** Select the brightest with no near neighbour. The object itself is always within 
+			** the radius, so an isolated object has a radius count of one. */
+			for(rank_index = 0; rank_index < Object_Data.Catalogue.Rank_Count; rank_index++)
 			{
-				if(Autoguider_Field_In_Object_Bounds(Object_Data.Object_List[index].CCD_X_Position,
-								     Object_Data.Object_List[index].CCD_Y_Position)&&
-				   (Object_Data.Object_List[index].Total_Counts > max_total_counts))
+				index = Object_Data.Catalogue.Rank_List[rank_index];
+				if(Object_Data.Catalogue.Total_Counts[index] <= 0.0f)
+					break;
+				if((Object_Data.Guide_Isolation_Radius <= 0.0f)||
+				   (Object_Catalogue_Radius(Object_Data.Catalogue.X[index],Object_Data.Catalogue.Y[index],
+							    Object_Data.Guide_Isolation_Radius,NULL,0) < 2))
 				{
-					max_total_counts = Object_Data.Object_List[index].Total_Counts;
 					(*selected_object_index) = index;
-#if AUTOGUIDER_DEBUG > 9
-					Autoguider_General_Log_Format("object","autoguider_object.c",
-								      "Autoguider_Object_Guide_Object_Get",
-								      LOG_VERBOSITY_VERBOSE,"OBJECT",
-								      "Object index %d (%.2f,%.2f) "
-								      "is brightest so far (%.2f).",index,
-							       Object_Data.Object_List[index].CCD_X_Position,
-							       Object_Data.Object_List[index].CCD_Y_Position,
-							       Object_Data.Object_List[index].Total_Counts);
-#endif
+					break;
 				}
-				index++;
-			}/* end while */
 #if AUTOGUIDER_DEBUG > 5
-			Autoguider_General_Log_Format("object","autoguider_object.c",
-						      "Autoguider_Object_Guide_Object_Get",LOG_VERBOSITY_VERBOSE,
-						      "OBJECT","Brightest Object index %d (%.2f,%.2f) "
-						  "with total counts (%.2f).",(*selected_object_index),
+				Autoguider_General_Log_Format("object","autoguider_object.c",
+							      "Autoguider_Object_Guide_Object_Get",LOG_VERBOSITY_VERBOSE,
+							      "OBJECT","Rejected object index %d (%.2f,%.2f):"
+							      "neighbour within %.2f pixels.",index,
+							      Object_Data.Catalogue.X[index],Object_Data.Catalogue.Y[index],
+							      Object_Data.Guide_Isolation_Radius);
+#endif
+			}
+			/* no isolated objects, fall back to the brightest */
+			if(((*selected_object_index) == -1)&&(Object_Data.Catalogue.Rank_Count > 0)&&
+			   (Object_Data.Catalogue.Total_Counts[Object_Data.Catalogue.Rank_List[0]] > 0.0f))
+			{
+				(*selected_object_index) = Object_Data.Catalogue.Rank_List[0];
+#if AUTOGUIDER_DEBUG > 5
+				Autoguider_General_Log("object","autoguider_object.c",
+						       "Autoguider_Object_Guide_Object_Get",LOG_VERBOSITY_VERBOSE,
+						       "OBJECT","No isolated objects:using brightest object.");
+#endif
+			}
+			if((*selected_object_index) > -1)
+			{
+#if AUTOGUIDER_DEBUG > 5
+				Autoguider_General_Log_Format("object","autoguider_object.c",
+							      "Autoguider_Object_Guide_Object_Get",LOG_VERBOSITY_VERBOSE,
+							      "OBJECT","Brightest Object index %d (%.2f,%.2f) "
+							      "with total counts (%.2f).",(*selected_object_index),
 						 Object_Data.Object_List[(*selected_object_index)].CCD_X_Position,
 						 Object_Data.Object_List[(*selected_object_index)].CCD_Y_Position,
 						 Object_Data.Object_List[(*selected_object_index)].Total_Counts);
 #endif
+			}
 			break;
 		case COMMAND_AG_ON_TYPE_PIXEL:
-			index = 0;
-			closest_distance = 999999.9f;
-			while(index < Object_Data.Object_Count)
+			/* NB no test against field object bounds
+			** Probably not needed in this case - unless specified pixel is in a silly place */
+			Object_Catalogue_Nearest(pixel_x,pixel_y,-1,selected_object_index,&distance_squared);
+#if AUTOGUIDER_DEBUG > 5
+			if((*selected_object_index) > -1)
 			{
-				/* NB no test against field object bounds
-				** Probably not needed in this case - unless specified pixel is in a silly place */
-				xdiff = Object_Data.Object_List[index].CCD_X_Position-pixel_x;
-				ydiff = Object_Data.Object_List[index].CCD_Y_Position-pixel_y;
-				xsq = xdiff*xdiff;
-				ysq = ydiff*ydiff;
-				distance = (float)sqrt((double)(xsq + ysq));
-#if AUTOGUIDER_DEBUG > 9
 				Autoguider_General_Log_Format("object","autoguider_object.c",
-							      "Autoguider_Object_Guide_Object_Get",
-							      LOG_VERBOSITY_VERBOSE,"OBJECT",
-							      "Object index %d (%.2f,%.2f) "
-							      "is %.2f pixels away from (%.2f,%.2f).",index,
-							      Object_Data.Object_List[index].CCD_X_Position,
-							      Object_Data.Object_List[index].CCD_Y_Position,
-							      distance,pixel_x,pixel_y);
-#endif
-				if(distance <  closest_distance)
-				{
-					closest_distance = distance;
-					(*selected_object_index) = index;
-				}
-				index++;
-			}/* end while */
-#if AUTOGUIDER_DEBUG > 5
-			Autoguider_General_Log_Format("object","autoguider_object.c",
-						      "Autoguider_Object_Guide_Object_Get",LOG_VERBOSITY_VERBOSE,
-						      "OBJECT","Closest Object index %d (%.2f,%.2f) "
-					       "is %.2f pixels away from (%.2f,%.2f).",(*selected_object_index),
+							      "Autoguider_Object_Guide_Object_Get",LOG_VERBOSITY_VERBOSE,
+							      "OBJECT","Closest Object index %d (%.2f,%.2f) "
+							      "is %.2f pixels away from (%.2f,%.2f).",(*selected_object_index),
 					       Object_Data.Object_List[(*selected_object_index)].CCD_X_Position,
 					       Object_Data.Object_List[(*selected_object_index)].CCD_Y_Position,
-					       closest_distance,pixel_x,pixel_y);
+					       sqrt((double)distance_squared),pixel_x,pixel_y);
+			}
 #endif
 			break;
 		case COMMAND_AG_ON_TYPE_RANK:
-			/* assumes object list sorted by total counts (Object_Sort_Object_List_By_Total_Counts) */
+			/* Rank_List contains in bounds objects, sorted by total counts (brightest first) */
 			/* assumes "first" rank is "1", not "0", as documented in the TCS manual */
-			index = 0;
-			in_bounds_count = 0;
-			while((index < Object_Data.Object_Count)&&(in_bounds_count < rank))
-			{
-				if(Autoguider_Field_In_Object_Bounds(Object_Data.Object_List[index].CCD_X_Position,
-								     Object_Data.Object_List[index].CCD_Y_Position))
-				{
-					in_bounds_count++;
-				}
-				index++;
-			}/* end while */
-			if(in_bounds_count < rank)
+			if((rank < 1)||(rank > Object_Data.Catalogue.Rank_Count))
 			{
 				Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
 				Autoguider_General_Error_Number = 1016;
 				sprintf(Autoguider_General_Error_String,"Autoguider_Object_Guide_Object_Get:"
-					"Rank %d out of range 0..%d.",rank,Object_Data.Object_Count);
+					"Rank %d out of range 1..%d.",rank,Object_Data.Catalogue.Rank_Count);
 				return FALSE;
 			}
-			(*selected_object_index) = index;
+			(*selected_object_index) = Object_Data.Catalogue.Rank_List[rank-1];
 			break;
 		default:
 			/* unlock mutex */
@@ -699,7 +1022,8 @@ int Autoguider_Object_Guide_Object_Get(enum COMMAND_AG_ON_TYPE on_type,float pix
  * </pre>
  * The relevant Object_List mutex is locked and un-locked.
  * See ngat.autoguider.command.StatusObjectList.java, parseReplyString for GUI software that decodes this string.
- * @param object_list_string The address of a character pointer to malloc and store a string.
+ * Each line is formatted directly onto the end of the reply buffer.
+ * @param reply The address of a reply buffer to append the object list string to.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Object_Data
  * @see #Autoguider_Object_Struct
@@ -707,69 +1031,47 @@ int Autoguider_Object_Guide_Object_Get(enum COMMAND_AG_ON_TYPE on_type,float pix
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Mutex_Lock
  * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
- * @see autoguider_general.html#Autoguider_General_Add_String
+ * @see autoguider_general.html#Autoguider_General_Reply_Add
+ * @see autoguider_general.html#Autoguider_General_Reply_Add_Format
  * @see ../javadocs/ngat/autoguider/command/StatusObjectList.html#parseReplyString
  */
-int Autoguider_Object_List_Get_Object_List_String(char **object_list_string)
+int Autoguider_Object_List_Get_Object_List_String(struct Autoguider_General_Reply_Struct *reply)
 {
-	char buff[256];
-	char is_stellar_string[32];
 	int i,retval;
 
-	if(object_list_string == NULL)
+	if(reply == NULL)
 	{
 		Autoguider_General_Error_Number = 1009;
 		sprintf(Autoguider_General_Error_String,"Autoguider_Object_List_Get_Object_List_String:"
-			"object_list_string was NULL.");
-		return FALSE;
-	}
-	if((*object_list_string) != NULL)
-	{
-		Autoguider_General_Error_Number = 1011;
-		sprintf(Autoguider_General_Error_String,"Autoguider_Object_List_Get_Object_List_String:"
-			"object_list_string was not initialised to NULL.");
+			"reply was NULL.");
 		return FALSE;
 	}
 	/* lock mutex */
 	retval = Autoguider_General_Mutex_Lock(&(Object_Data.Object_List_Mutex));
 	if(retval == FALSE)
 		return FALSE;
-	if(!Autoguider_General_Add_String(object_list_string,"Id Frame_Number Index CCD_Pos_X  CCD_Pos_Y "
-		"Buffer_Pos_X Buffer_Pos_Y Total_Counts Number_of_Pixels Peak_Counts Is_Stellar FWHM_X FWHM_Y"))
-	{
-		Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
-		return FALSE;
-	}
-	if(!Autoguider_General_Add_String(object_list_string,"\n"))
+	if(!Autoguider_General_Reply_Add(reply,"Id Frame_Number Index CCD_Pos_X  CCD_Pos_Y "
+		"Buffer_Pos_X Buffer_Pos_Y Total_Counts Number_of_Pixels Peak_Counts Is_Stellar FWHM_X FWHM_Y\n"))
 	{
 		Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
 		return FALSE;
 	}
 	for(i=0;i<Object_Data.Object_Count;i++)
 	{
-		if(Object_Data.Object_List[i].Is_Stellar)
-			strcpy(is_stellar_string,"TRUE");
-		else
-			strcpy(is_stellar_string,"FALSE");
-		retval = sprintf(buff,"%6d %6d %6d %6.2f %6.2f %6.2f %6.2f %6.2f %6d %6.2f %s %6.2f %6.2f",
-			Object_Data.Id,Object_Data.Frame_Number,Object_Data.Object_List[i].Index,
-			Object_Data.Object_List[i].CCD_X_Position,Object_Data.Object_List[i].CCD_Y_Position,
-			Object_Data.Object_List[i].Buffer_X_Position,Object_Data.Object_List[i].Buffer_Y_Position,
-			Object_Data.Object_List[i].Total_Counts,Object_Data.Object_List[i].Pixel_Count,
-			Object_Data.Object_List[i].Peak_Counts,is_stellar_string,
-			Object_Data.Object_List[i].FWHM_X,Object_Data.Object_List[i].FWHM_Y);
 #if AUTOGUIDER_DEBUG > 1
 		Autoguider_General_Log_Format("object","autoguider_object.c",
 					      "Autoguider_Object_List_Get_Object_List_String",
-					      LOG_VERBOSITY_VERBOSE,"OBJECT","index %d : '%s' (%d bytes).",
-					      i,buff,retval);
+					      LOG_VERBOSITY_VERBOSE,"OBJECT","adding index %d.",i);
 #endif
-		if(!Autoguider_General_Add_String(object_list_string,buff))
-		{
-			Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
-			return FALSE;
-		}
-		if(!Autoguider_General_Add_String(object_list_string,"\n"))
+		if(!Autoguider_General_Reply_Add_Format(reply,
+			"%6d %6d %6d %6.2f %6.2f %6.2f %6.2f %6.2f %6d %6.2f %s %6.2f %6.2f\n",
+			Object_Data.Id,Object_Data.Frame_Number,Object_Data.Object_List[i].Index,
+			Object_Data.Object_List[i].CCD_X_Position,Object_Data.Object_List[i].CCD_Y_Position,
+			Object_Data.Object_List[i].Buffer_X_Position,Object_Data.Object_List[i].Buffer_Y_Position,
+			Object_Data.Object_List[i].Total_Counts,Object_Data.Object_List[i].Pixel_Count,
+			Object_Data.Object_List[i].Peak_Counts,
+			Object_Data.Object_List[i].Is_Stellar ? "TRUE" : "FALSE",
+			Object_Data.Object_List[i].FWHM_X,Object_Data.Object_List[i].FWHM_Y))
 		{
 			Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
 			return FALSE;
@@ -983,16 +1285,21 @@ int Autoguider_Object_Get_Binned_NRows(void)
 }
 
 /**
- * Return a copy of the Object mask data in the specified memory.
+ * Return a copy of the Object mask data in the specified memory. The mask is generated from the 
+ * object mask spans created by the last object detection: the array is cleared, and each span's
+ * pixels are set to the span's label (object number). In real-time mode the mask may be incomplete, if
+ * the last detection found more spans than object.mask.span.count.max, in which case this is logged.
  * @param buffer_ptr An address pointing to an array of unsigned shorts of buffer_length_pixels length.
  *        On a successful return a copy of the current object mask will be in the array.
  * @param buffer_length_pixels The number of pixels in the array pointed to by buffer_ptr.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see #Object_Data
+ * @see #Object_Mask_Span_Struct
  */
 int Autoguider_Object_Mask_Copy(unsigned short *buffer_ptr,size_t buffer_length_pixels)
 {
-	int retval;
+	struct Object_Mask_Span_Struct *span = NULL;
+	int retval,i,j;
 	
 	if(buffer_length_pixels != (Object_Data.Binned_NCols*Object_Data.Binned_NRows))
 	{
@@ -1006,9 +1313,21 @@ int Autoguider_Object_Mask_Copy(unsigned short *buffer_ptr,size_t buffer_length_
 	retval = Autoguider_General_Mutex_Lock(&(Object_Data.Image_Data_Mutex));
 	if(retval == FALSE)
 		return FALSE;
-	/* do copy */
-	memcpy(buffer_ptr,Object_Data.Object_Mask_Data,
-	       ((Object_Data.Binned_NCols*Object_Data.Binned_NRows)*sizeof(unsigned short)));
+	/* generate mask from spans */
+	memset(buffer_ptr,0,((Object_Data.Binned_NCols*Object_Data.Binned_NRows)*sizeof(unsigned short)));
+	for(i = 0; i < Object_Data.Mask_Span_Count; i++)
+	{
+		span = &(Object_Data.Mask_Span_List[i]);
+		for(j = 0; j < span->Length; j++)
+			buffer_ptr[span->Pixel_Index+j] = span->Label;
+	}
+	if(Object_Data.Mask_Span_Dropped_Pixel_Count > 0)
+	{
+		Autoguider_General_Log_Format("object","autoguider_object.c","Autoguider_Object_Mask_Copy",
+					      LOG_VERBOSITY_TERSE,"OBJECT","Object mask is incomplete:%d pixels dropped "
+					      "(object.mask.span.count.max = %d).",
+					      Object_Data.Mask_Span_Dropped_Pixel_Count,Object_Data.Mask_Span_Count_Max);
+	}
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
 	if(retval == FALSE)
@@ -1021,7 +1340,9 @@ int Autoguider_Object_Mask_Copy(unsigned short *buffer_ptr,size_t buffer_length_
 ** ---------------------------------------------------------------------------- */
 /**
  * Setup buffer for object detection.
- * Locks the Image_Data_Mutex whilst resizing the buffer. Now also resizes the object mask buffer.
+ * Locks the Image_Data_Mutex whilst resizing the buffer.
+ * The buffers are only reallocated when they are too small, using Autoguider_Realtime_Buffer_Allocate
+ * so they are cache line aligned (and prefaulted in real-time mode).
  * @param buffer A float array containing the buffer with reduced data in it.
  * @param naxis1 The number of columns in the buffer.
  * @param naxis2 The number of rows in the buffer.
@@ -1032,6 +1353,8 @@ int Autoguider_Object_Mask_Copy(unsigned short *buffer_ptr,size_t buffer_length_
  * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
+ * @see autoguider_realtime.html#Autoguider_Realtime_Is_Enabled
+ * @see autoguider_realtime.html#Autoguider_Realtime_Buffer_Allocate
  */
 static int Object_Buffer_Set(float *buffer,int naxis1,int naxis2)
 {
@@ -1049,26 +1372,13 @@ static int Object_Buffer_Set(float *buffer,int naxis1,int naxis2)
 	if((naxis1*naxis2) > Object_Data.Image_Data_Allocated_Pixel_Count)
 	{
 		/* we need to allocate more space for image data */
-		if(Object_Data.Image_Data == NULL)
-		{
-#if AUTOGUIDER_DEBUG > 9
-			Autoguider_General_Log_Format("object","autoguider_object.c","Object_Buffer_Set",
-						      LOG_VERBOSITY_VERBOSE,"OBJECT","Allocating Image_Data (%d,%d).",
-						      naxis1,naxis2);
-#endif
-			Object_Data.Image_Data = (float *)malloc((naxis1*naxis2)*sizeof(float));
-		}
-		else
-		{
 #if AUTOGUIDER_DEBUG > 9
-			Autoguider_General_Log_Format("object","autoguider_object.c","Object_Buffer_Set",
-						      LOG_VERBOSITY_VERBOSE,"OBJECT",
-						      "Reallocating Image_Data (%d,%d).",naxis1,naxis2);
+		Autoguider_General_Log_Format("object","autoguider_object.c","Object_Buffer_Set",
+					      LOG_VERBOSITY_VERBOSE,"OBJECT","Allocating Image_Data (%d,%d).",
+					      naxis1,naxis2);
 #endif
-			Object_Data.Image_Data = (float *)realloc(Object_Data.Image_Data,
-								  (naxis1*naxis2)*sizeof(float));
-		}
-		if(Object_Data.Image_Data == NULL)
+		if(!Autoguider_Realtime_Buffer_Allocate((void **)&(Object_Data.Image_Data),
+							(naxis1*naxis2)*sizeof(float)))
 		{
 			Object_Data.Image_Data_Allocated_Pixel_Count = 0;
 			Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
@@ -1078,35 +1388,6 @@ static int Object_Buffer_Set(float *buffer,int naxis1,int naxis2)
 			return FALSE;
 		}
 		Object_Data.Image_Data_Allocated_Pixel_Count = naxis1*naxis2;
-		/* also allocate space for the object mask */
-		if(Object_Data.Object_Mask_Data == NULL)
-		{
-#if AUTOGUIDER_DEBUG > 9
-			Autoguider_General_Log_Format("object","autoguider_object.c","Object_Buffer_Set",
-						      LOG_VERBOSITY_VERBOSE,"OBJECT","Allocating Object_Mask_Data (%d,%d).",
-						      naxis1,naxis2);
-#endif
-			Object_Data.Object_Mask_Data = (unsigned short *)malloc((naxis1*naxis2)*sizeof(unsigned short));
-		}
-		else
-		{
-#if AUTOGUIDER_DEBUG > 9
-			Autoguider_General_Log_Format("object","autoguider_object.c","Object_Buffer_Set",
-						      LOG_VERBOSITY_VERBOSE,"OBJECT",
-						      "Reallocating Object_Mask_Data (%d,%d).",naxis1,naxis2);
-#endif
-			Object_Data.Object_Mask_Data = (unsigned short *)realloc(Object_Data.Object_Mask_Data,
-								  (naxis1*naxis2)*sizeof(unsigned short));
-		}
-		if(Object_Data.Object_Mask_Data == NULL)
-		{
-			Object_Data.Image_Data_Allocated_Pixel_Count = 0;
-			Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
-			Autoguider_General_Error_Number = 1030;
-			sprintf(Autoguider_General_Error_String,"Object_Buffer_Set:"
-				"failed to allocate object mask buffer (%d,%d).",naxis1,naxis2);
-			return FALSE;
-		}
 	}
 	/* update dimensional information */
 	Object_Data.Binned_NCols = naxis1;
@@ -1125,7 +1406,7 @@ static int Object_Buffer_Set(float *buffer,int naxis1,int naxis2)
 /**
  * Copy buffer for object detection. Assumes Object_Buffer_Set has been already called, so the buffer is
  * the right size.
- * Locks the Image_Data_Mutex whilst copying. Now also initialises the object mask buffer to 0.
+ * Locks the Image_Data_Mutex whilst copying. Now also empties the object mask span list.
  * @param buffer A float array containing the buffer with reduced data in it.
  * @param naxis1 The number of columns in the buffer.
  * @param naxis2 The number of rows in the buffer.
@@ -1160,8 +1441,9 @@ static int Object_Buffer_Copy(float *buffer,int naxis1,int naxis2)
 	memcpy(Object_Data.Image_Data,buffer,(naxis1*naxis2)*sizeof(float));
 	Object_Data.Binned_NCols = naxis1;
 	Object_Data.Binned_NRows = naxis2;
-	/* and initialise object mask buffer to 0 */
-	memset(Object_Data.Object_Mask_Data,0,(naxis1*naxis2)*sizeof(unsigned short));
+	/* and empty the object mask span list */
+	Object_Data.Mask_Span_Count = 0;
+	Object_Data.Mask_Span_Dropped_Pixel_Count = 0;
 	/* unlock mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
 	if(retval == FALSE)
@@ -1178,20 +1460,28 @@ static int Object_Buffer_Copy(float *buffer,int naxis1,int naxis2)
  * Locks the Image_Data_Mutex whilst accessing the image data.
  * Locks the Object_List_Mutex whilst modifying the object list.
  * Currently sorted (after setting the index!) into total count order (Object_Sort_Object_List_By_Total_Counts).
+ * The catalogue and grid index of the sorted list is then built (Object_Catalogue_Build).
+ * If the telemetry log is enabled, each object in the sorted list is passed to it as a telemetry record.
  * Object_Set_Threshold is used to compute the threshold pixel value, above which pixels are deemed to be part of objects.
  * The minimum number of connected pixels needed for an object to be valid is read from the Object_Data.Min_Connected_Pixel_Count
  * variable, which has been loaded from config as part of Autoguider_Object_Initialise.
+ * If tile_count is more than one, the objects are detected per tile by Object_List_Get_Tiled, rather than
+ * Object_List_Get on the whole image.
+ * @param buffer The image data Image_Data was copied from, needed by Object_List_Get_Tiled.
  * @param use_standard_deviation A boolean, whether to use standard deviation when calculating the object 
  *        threshold value. The SD is useful for sky gradients on field buffers, but the guide buffer SD is
  *        skewed by being mostly filled (hopefully) with a star, and so this variable should be set to FALSE
  *        for guide buffers.
  * @param start_x The start of the buffer's X position on the physical CCD. 0 for full frame.
  * @param start_y The start of the buffer's Y position on the physical CCD. 0 for full frame.
+ * @param tile_count The number of tiles to detect objects in, 1 to detect on the whole image.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Object_Data
+ * @see #Object_List_Get_Tiled
  * @see #Object_Mask_Create
  * @see #Object_Set_Threshold
  * @see #Object_Sort_Object_List_By_Total_Counts
+ * @see #Object_Catalogue_Build
  * @see autoguider_general.html#Autoguider_General_Log
  * @see autoguider_general.html#Autoguider_General_Mutex_Lock
  * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
@@ -1201,12 +1491,16 @@ static int Object_Buffer_Copy(float *buffer,int naxis1,int naxis2)
  * @see ../../libdprt/object/cdocs/object.html#Object_Get_Error_Number
  * @see ../../libdprt/object/cdocs/object.html#Object_Warning
  * @see ../../libdprt/object/cdocs/object.html#Object_Stellar_Ellipticity_Limit_Set
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Is_Enabled
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Record_Add
  */
-static int Object_Create_Object_List(int use_standard_deviation,int start_x,int start_y)
+static int Object_Create_Object_List(float *buffer,int use_standard_deviation,int start_x,int start_y,
+				     int tile_count)
 {
 	Object *object_list = NULL;
 	Object *current_object_ptr = NULL;
-	struct timespec start_time,stop_time;
+	struct Autoguider_Telemetry_Record_Struct telemetry_record;
+	struct timespec start_time,stop_time,list_time;
 	int retval,seeing_flag,index;
 	float seeing;
 
@@ -1238,7 +1532,7 @@ static int Object_Create_Object_List(int use_standard_deviation,int start_x,int
 	Autoguider_General_Log("object","autoguider_object.c","Object_Create_Object_List",
 			       LOG_VERBOSITY_VERBOSE,"OBJECT","Getting statistics.");
 #endif
-	if(!Object_Set_Threshold(use_standard_deviation))
+	if(!Object_Set_Threshold(use_standard_deviation,tile_count))
 	{
 		Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
 		return FALSE;
@@ -1249,9 +1543,21 @@ static int Object_Create_Object_List(int use_standard_deviation,int start_x,int
 #endif
 	/* clock_gettime(CLOCK_REALTIME,&start_time);*/
 	/* Call the object detection code */
-	retval = Object_List_Get(Object_Data.Image_Data,Object_Data.Median,Object_Data.Binned_NCols,
-				 Object_Data.Binned_NRows,Object_Data.Threshold,Object_Data.Min_Connected_Pixel_Count,
-				 &object_list,&seeing_flag,&seeing);
+	if(tile_count > 1)
+	{
+		if(!Object_List_Get_Tiled(buffer,tile_count,&object_list))
+		{
+			Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
+			return FALSE;
+		}
+		retval = TRUE;
+	}
+	else
+	{
+		retval = Object_List_Get(Object_Data.Image_Data,Object_Data.Median,Object_Data.Binned_NCols,
+					 Object_Data.Binned_NRows,Object_Data.Threshold,
+					 Object_Data.Min_Connected_Pixel_Count,&object_list,&seeing_flag,&seeing);
+	}
 	/* clock_gettime(CLOCK_REALTIME,&stop_time);*/
 	if(retval == FALSE)
 	{
@@ -1264,8 +1570,13 @@ static int Object_Create_Object_List(int use_standard_deviation,int start_x,int
 	Autoguider_General_Log("object","autoguider_object.c","Object_Create_Object_List",
 			       LOG_VERBOSITY_VERBOSE,"OBJECT","Object detection finished.");
 #endif
-	/* create an object mask of created objects */
-	Object_Mask_Create(object_list);
+	/* create the object mask spans of created objects */
+	if(!Object_Mask_Create(object_list))
+	{
+		Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
+		Object_List_Free(&object_list);
+		return FALSE;
+	}
 	/* unlock image data mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Object_Data.Image_Data_Mutex));
 	if(retval == FALSE)
@@ -1392,6 +1703,44 @@ static int Object_Create_Object_List(int use_standard_deviation,int start_x,int
 	/* sort by total (integrated) counts */
 	qsort(Object_Data.Object_List,Object_Data.Object_Count,sizeof(struct Autoguider_Object_Struct),
 	      Object_Sort_Object_List_By_Total_Counts);
+	/* build the catalogue and grid index of the sorted list */
+	if(!Object_Catalogue_Build())
+	{
+		Object_Data.Object_Count = 0;
+		Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
+		return FALSE;
+	}
+	/* pass the object list to the telemetry log */
+	if(Autoguider_Telemetry_Is_Enabled())
+	{
+		memset(&telemetry_record,0,sizeof(struct Autoguider_Telemetry_Record_Struct));
+		clock_gettime(CLOCK_REALTIME,&list_time);
+		telemetry_record.Type = AUTOGUIDER_TELEMETRY_RECORD_OBJECT;
+		telemetry_record.Id = Object_Data.Id;
+		telemetry_record.Frame_Number = Object_Data.Frame_Number;
+		telemetry_record.Time_Sec = list_time.tv_sec;
+		telemetry_record.Time_NSec = list_time.tv_nsec;
+		for(index = 0; index < Object_Data.Object_Count; index++)
+		{
+			telemetry_record.Index = Object_Data.Object_List[index].Index;
+			telemetry_record.CCD_X_Position = Object_Data.Object_List[index].CCD_X_Position;
+			telemetry_record.CCD_Y_Position = Object_Data.Object_List[index].CCD_Y_Position;
+			telemetry_record.Buffer_X_Position = Object_Data.Object_List[index].Buffer_X_Position;
+			telemetry_record.Buffer_Y_Position = Object_Data.Object_List[index].Buffer_Y_Position;
+			telemetry_record.Total_Counts = Object_Data.Object_List[index].Total_Counts;
+			telemetry_record.Pixel_Count = Object_Data.Object_List[index].Pixel_Count;
+			telemetry_record.Peak_Counts = Object_Data.Object_List[index].Peak_Counts;
+			telemetry_record.Is_Stellar = Object_Data.Object_List[index].Is_Stellar;
+			telemetry_record.FWHM_X = Object_Data.Object_List[index].FWHM_X;
+			telemetry_record.FWHM_Y = Object_Data.Object_List[index].FWHM_Y;
+			if(!Autoguider_Telemetry_Record_Add(&telemetry_record))
+			{
+				Autoguider_General_Error("object","autoguider_object.c","Object_Create_Object_List",
+							 LOG_VERBOSITY_VERBOSE,"OBJECT"); /* no need to fail */
+				break;
+			}
+		}
+	}
 	/* unlock object list mutex */
 	retval = Autoguider_General_Mutex_Unlock(&(Object_Data.Object_List_Mutex));
 	if(retval == FALSE)
@@ -1404,7 +1753,9 @@ static int Object_Create_Object_List(int use_standard_deviation,int start_x,int
 }
 
 /**
- * Set up the Stats_List with a (subset) of pixels in Image_Data, using Object_Fill_Stats_List.
+ * Set up the Stats_List with a (subset) of pixels in Image_Data, using Object_Fill_Stats_List and sorting it,
+ * or if tile_count is more than one, Object_Fill_Stats_List_Tiled which fills and sorts it per tile. Both give the
+ * same sorted Stats_List.
  * Find the mean, median and standard deviation of the subset, using Object_Get_Mean_Standard_Deviation_Simple or
  * Object_Get_Mean_Standard_Deviation_Sigma_Reject.
  * Assumes the Image_Data_Mutex has <b>already</b> been locked external to this routine, as it access
@@ -1416,10 +1767,12 @@ static int Object_Create_Object_List(int use_standard_deviation,int start_x,int
  *  <b>object.threshold.sigma</b> to determine the threshold value in this routine.
  * @param use_standard_deviation Whether to use the frame's standard deviation when calculating object threshold 
  *        for detection. Set to TRUE for field, FALSE for guide where the window is mainly filled with star.
+ * @param tile_count The number of tiles to collect the statistics pixels in.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Object_Data
  * @see #Object_Sort_Float_List
  * @see #Object_Fill_Stats_List
+ * @see #Object_Fill_Stats_List_Tiled
  * @see #Object_Get_Mean_Standard_Deviation_Simple
  * @see #Object_Get_Mean_Standard_Deviation_Sigma_Reject
  * @see #Image_Data
@@ -1429,7 +1782,7 @@ static int Object_Create_Object_List(int use_standard_deviation,int start_x,int
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  */
-static int Object_Set_Threshold(int use_standard_deviation)
+static int Object_Set_Threshold(int use_standard_deviation,int tile_count)
 {
 	int retval;
 	float total_value,difference_squared_total,tmp_float,variance,threshold_sigma;
@@ -1438,10 +1791,18 @@ static int Object_Set_Threshold(int use_standard_deviation)
 	Autoguider_General_Log("object","autoguider_object.c","Object_Set_Threshold",
 			       LOG_VERBOSITY_INTERMEDIATE,"OBJECT","started.");
 #endif
-	/* get a subset of image data into the Stats_List/Stats_Count */
-	Object_Fill_Stats_List();
+	/* get a sorted subset of image data into the Stats_List/Stats_Count */
+	if(tile_count > 1)
+	{
+		if(!Object_Fill_Stats_List_Tiled(tile_count))
+			return FALSE;
+	}
+	else
+	{
+		Object_Fill_Stats_List();
+		qsort(Object_Data.Stats_List,Object_Data.Stats_Count,sizeof(float),Object_Sort_Float_List);
+	}
 	/* median */
-	qsort(Object_Data.Stats_List,Object_Data.Stats_Count,sizeof(float),Object_Sort_Float_List);
 	Object_Data.Median = Object_Data.Stats_List[Object_Data.Stats_Count/2];
 #if AUTOGUIDER_DEBUG > 5
 	Autoguider_General_Log_Format("object","autoguider_object.c","Object_Set_Threshold",
@@ -1522,37 +1883,614 @@ static void Object_Fill_Stats_List(void)
 }
 
 /**
- * Get a simple mean and standard deviation measure from Object_Data.Stats_List / Object_Data.Stats_Count.
- * These are stored into Object_Data.Mean / Object_Data.Background_Standard_Deviation.
+ * Routine to fill Object_Data.Stats_Count/Object_Data.Stats_List with the same subset of Object_Data.Image_Data
+ * as Object_Fill_Stats_List, sorted in the same order as Object_Set_Threshold sorts it. Stats_List is split into
+ * tile_count parts, each filled from a band of rows of Image_Data and sorted by Object_Stats_Tile_Fill on the
+ * worker pool. The sorted parts are then merged into Stats_Merge_List, and copied back to Stats_List.
+ * Should be called with the Image_Data_Mutex locked.
+ * @param tile_count The number of parts to split Stats_List into.
+ * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Object_Data
- * @see autoguider_general.html#Autoguider_General_Log_Format
+ * @see #Object_Tile_Struct
+ * @see #Object_Stats_Tile_Fill
+ * @see #Object_Sort_Float_List
+ * @see #MAXIMUM_STATS_COUNT
+ * @see autoguider_worker_pool.html#Autoguider_Worker_Pool_Run
  */
-static int Object_Get_Mean_Standard_Deviation_Simple(void)
+static int Object_Fill_Stats_List_Tiled(int tile_count)
 {
-	int i;
-	float total_value,difference_squared_total,tmp_float,variance;
+	struct Object_Tile_Struct *tile_list = NULL;
+	int pixel_count,tile_stats_count,tile_remainder,start_index,best_tile,i,t;
 
-	/* find the total value of the Stats_List */
-	total_value = 0.0f;
-	for(i=0;i<Object_Data.Stats_Count;i++)
+	pixel_count = (Object_Data.Binned_NCols*Object_Data.Binned_NRows);
+	Object_Data.Stats_Count = MIN(pixel_count,MAXIMUM_STATS_COUNT);
+	if(tile_count > Object_Data.Stats_Count)
+		tile_count = Object_Data.Stats_Count;
+	if(tile_count < 1)
+		return TRUE;
+	tile_list = (struct Object_Tile_Struct *)calloc(tile_count,sizeof(struct Object_Tile_Struct));
+	if(tile_list == NULL)
 	{
-		total_value += Object_Data.Stats_List[i];
+		Autoguider_General_Error_Number = 1049;
+		sprintf(Autoguider_General_Error_String,"Object_Fill_Stats_List_Tiled:"
+			"Failed to allocate tile list of length %d.",tile_count);
+		return FALSE;
 	}
-	/* mean */
-	Object_Data.Mean = total_value/Object_Data.Stats_Count;
-#if AUTOGUIDER_DEBUG > 5
-	Autoguider_General_Log_Format("object","autoguider_object.c","Object_Get_Mean_Standard_Deviation_Simple",
-				      LOG_VERBOSITY_INTERMEDIATE,"OBJECT","Mean pixel value %.2f.",Object_Data.Mean);
-#endif
-	/* standard deviation */
-	difference_squared_total = 0.0f;
-	for(i=0;i<Object_Data.Stats_Count;i++)
+	/* split the Stats_List into parts, the first tile_remainder parts get an extra element */
+	tile_stats_count = Object_Data.Stats_Count/tile_count;
+	tile_remainder = Object_Data.Stats_Count%tile_count;
+	start_index = 0;
+	for(t=0; t < tile_count; t++)
 	{
-		tmp_float = Object_Data.Stats_List[i]-Object_Data.Mean;
-		difference_squared_total += tmp_float*tmp_float;
+		tile_list[t].Stats_Start_Index = start_index;
+		tile_list[t].Stats_Count = tile_stats_count;
+		if(t < tile_remainder)
+			tile_list[t].Stats_Count++;
+		tile_list[t].Stats_Step = pixel_count/Object_Data.Stats_Count;
+		tile_list[t].Stats_Merge_Index = start_index;
+		start_index += tile_list[t].Stats_Count;
 	}
-	variance = difference_squared_total/Object_Data.Stats_Count;
-	/* background SD */
+	if(!Autoguider_Worker_Pool_Run(Object_Stats_Tile_Fill,(void *)tile_list,sizeof(struct Object_Tile_Struct),
+				       tile_count))
+	{
+		free(tile_list);
+		return FALSE;
+	}
+	/* merge the sorted parts */
+	for(i=0; i < Object_Data.Stats_Count; i++)
+	{
+		best_tile = -1;
+		for(t=0; t < tile_count; t++)
+		{
+			if(tile_list[t].Stats_Merge_Index >= (tile_list[t].Stats_Start_Index+tile_list[t].Stats_Count))
+				continue;
+			if((best_tile < 0)||
+			   (Object_Sort_Float_List(&(Object_Data.Stats_List[tile_list[t].Stats_Merge_Index]),
+				   &(Object_Data.Stats_List[tile_list[best_tile].Stats_Merge_Index])) < 0))
+				best_tile = t;
+		}
+		Object_Data.Stats_Merge_List[i] = Object_Data.Stats_List[tile_list[best_tile].Stats_Merge_Index];
+		tile_list[best_tile].Stats_Merge_Index++;
+	}
+	memcpy(Object_Data.Stats_List,Object_Data.Stats_Merge_List,Object_Data.Stats_Count*sizeof(float));
+	free(tile_list);
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("object","autoguider_object.c","Object_Fill_Stats_List_Tiled",
+				      LOG_VERBOSITY_INTERMEDIATE,"OBJECT",
+				      "Using %d pixels in Stats list, from %d tiles.",Object_Data.Stats_Count,tile_count);
+#endif
+	return TRUE;
+}
+
+/**
+ * Fill and sort one tile's part of Object_Data.Stats_List, taking every Stats_Step'th pixel of Image_Data as
+ * Object_Fill_Stats_List does. This is the job routine Object_Fill_Stats_List_Tiled runs on the worker pool.
+ * @param user_arg A pointer to the tile's Object_Tile_Struct.
+ * @see #Object_Data
+ * @see #Object_Tile_Struct
+ * @see #Object_Sort_Float_List
+ */
+static void Object_Stats_Tile_Fill(void *user_arg)
+{
+	struct Object_Tile_Struct *tile = NULL;
+	int i;
+
+	tile = (struct Object_Tile_Struct *)user_arg;
+	for(i = tile->Stats_Start_Index; i < (tile->Stats_Start_Index+tile->Stats_Count); i++)
+		Object_Data.Stats_List[i] = Object_Data.Image_Data[i*tile->Stats_Step];
+	qsort(&(Object_Data.Stats_List[tile->Stats_Start_Index]),tile->Stats_Count,sizeof(float),
+	      Object_Sort_Float_List);
+	tile->Retval = TRUE;
+}
+
+/**
+ * Detect the objects in Image_Data in tiles. Image_Data is split into tile_count bands of rows, and
+ * Object_Tile_Detect calls Object_List_Get on each band on the worker pool. Object_Tile_Merge then merges the
+ * objects that cross tile boundaries, and returns the same objects Object_List_Get would find on the whole image.
+ * Should be called with the Image_Data_Mutex locked, after Object_Set_Threshold.
+ * @param buffer The (unmodified) image data Image_Data was copied from, as Object_List_Get destroys Image_Data.
+ * @param tile_count The number of tiles.
+ * @param object_list The address of an Object list pointer, on success set to the detected objects, which
+ *        should be freed with Object_List_Free.
+ * @return The routine returns TRUE on success, and FALSE on failure.
+ * @see #Object_Data
+ * @see #Object_Tile_Struct
+ * @see #Object_Tile_Detect
+ * @see #Object_Tile_Merge
+ * @see autoguider_worker_pool.html#Autoguider_Worker_Pool_Run
+ * @see ../../libdprt/object/cdocs/object.html#Object_List_Free
+ */
+static int Object_List_Get_Tiled(float *buffer,int tile_count,Object **object_list)
+{
+	struct Object_Tile_Struct *tile_list = NULL;
+	int tile_nrows,tile_remainder,start_row,failed_tile,retval,t;
+
+	(*object_list) = NULL;
+	if(tile_count > Object_Data.Binned_NRows)
+		tile_count = Object_Data.Binned_NRows;
+	tile_list = (struct Object_Tile_Struct *)calloc(tile_count,sizeof(struct Object_Tile_Struct));
+	if(tile_list == NULL)
+	{
+		Autoguider_General_Error_Number = 1050;
+		sprintf(Autoguider_General_Error_String,"Object_List_Get_Tiled:"
+			"Failed to allocate tile list of length %d.",tile_count);
+		return FALSE;
+	}
+	/* split the rows into tiles, the first tile_remainder tiles get an extra row */
+	tile_nrows = Object_Data.Binned_NRows/tile_count;
+	tile_remainder = Object_Data.Binned_NRows%tile_count;
+	start_row = 0;
+	for(t=0; t < tile_count; t++)
+	{
+		tile_list[t].Start_Row = start_row;
+		tile_list[t].Row_Count = tile_nrows;
+		if(t < tile_remainder)
+			tile_list[t].Row_Count++;
+		tile_list[t].Object_List = NULL;
+		tile_list[t].Retval = FALSE;
+		start_row += tile_list[t].Row_Count;
+	}
+	retval = Autoguider_Worker_Pool_Run(Object_Tile_Detect,(void *)tile_list,sizeof(struct Object_Tile_Struct),
+					    tile_count);
+	failed_tile = -1;
+	for(t=0; t < tile_count; t++)
+	{
+		if(tile_list[t].Retval == FALSE)
+			failed_tile = t;
+	}
+	if((retval == FALSE)||(failed_tile > -1))
+	{
+		if(retval)
+		{
+			Autoguider_General_Error_Number = 1051;
+			sprintf(Autoguider_General_Error_String,"Object_List_Get_Tiled:"
+				"Object_List_Get failed for tile %d (rows %d to %d).",failed_tile,
+				tile_list[failed_tile].Start_Row,
+				tile_list[failed_tile].Start_Row+tile_list[failed_tile].Row_Count-1);
+		}
+		for(t=0; t < tile_count; t++)
+			Object_List_Free(&(tile_list[t].Object_List));
+		free(tile_list);
+		return FALSE;
+	}
+	/* merge the objects crossing tile boundaries */
+	retval = Object_Tile_Merge(buffer,tile_list,tile_count,object_list);
+	free(tile_list);
+	return retval;
+}
+
+/**
+ * Detect the objects in one tile of Image_Data, by calling Object_List_Get on the tile's rows. The minimum
+ * connected pixel count passed to Object_List_Get is 1, so the pieces of objects that cross a tile boundary are
+ * all kept; Object_Tile_Merge applies Min_Connected_Pixel_Count. The objects' positions and pixels are moved from
+ * tile coordinates into whole image coordinates.
+ * This is the job routine Object_List_Get_Tiled runs on the worker pool.
+ * @param user_arg A pointer to the tile's Object_Tile_Struct. The Object_List and Retval fields are set.
+ * @see #Object_Data
+ * @see #Object_Tile_Struct
+ * @see #Object_Translate
+ * @see ../../libdprt/object/cdocs/object.html#Object_List_Get
+ */
+static void Object_Tile_Detect(void *user_arg)
+{
+	struct Object_Tile_Struct *tile = NULL;
+	Object *object = NULL;
+	int seeing_flag;
+	float seeing;
+
+	tile = (struct Object_Tile_Struct *)user_arg;
+	tile->Object_List = NULL;
+	tile->Retval = Object_List_Get(Object_Data.Image_Data+(tile->Start_Row*Object_Data.Binned_NCols),
+				       Object_Data.Median,Object_Data.Binned_NCols,tile->Row_Count,Object_Data.Threshold,
+				       1,&(tile->Object_List),&seeing_flag,&seeing);
+	if(tile->Retval == FALSE)
+		return;
+	object = tile->Object_List;
+	while(object != NULL)
+	{
+		Object_Translate(object,0,tile->Start_Row);
+		object = object->nextobject;
+	}
+}
+
+/**
+ * Merge the objects detected per tile into one list, the same as Object_List_Get finds on the whole image:
+ * <ul>
+ * <li>Objects with no pixels on a row next to another tile are complete. They are kept if they have at least
+ *     Min_Connected_Pixel_Count pixels.
+ * <li>The other objects are pieces. Pieces with pixels touching (including diagonally) across a tile boundary
+ *     are grouped, using a union-find forest over the pieces and the pixels either side of each boundary.
+ * <li>A group of one piece is a complete object, and is kept as above. Otherwise the group's bounding box is 
+ *     re-detected from buffer by Object_Tile_Group_Detect.
+ * <li>The kept objects are sorted into raster order of their first pixel (the order a whole image scan finds
+ *     them in), and renumbered from 1, as the object numbers of separate tiles overlap.
+ * </ul>
+ * The tiles' object lists are emptied, ownership of the objects being taken by this routine.
+ * @param buffer The (unmodified) image data, for Object_Tile_Group_Detect.
+ * @param tile_list The list of tiles.
+ * @param tile_count The number of tiles.
+ * @param object_list The address of an Object list pointer, on success set to the merged objects.
+ * @return The routine returns TRUE on success, and FALSE on failure.
+ * @see #Object_Data
+ * @see #Object_Tile_Struct
+ * @see #Object_Tile_Piece_Struct
+ * @see #Object_Tile_Keep_Struct
+ * @see #Object_Tile_Is_Edge_Object
+ * @see #Object_Tile_Piece_Find
+ * @see #Object_Tile_Group_Detect
+ * @see #Object_Sort_Tile_Keep_List_By_Raster_Index
+ * @see ../../libdprt/object/cdocs/object.html#Object_List_Free
+ */
+static int Object_Tile_Merge(float *buffer,struct Object_Tile_Struct *tile_list,int tile_count,
+			     Object **object_list)
+{
+	struct Object_Tile_Piece_Struct *piece_list = NULL;
+	struct Object_Tile_Keep_Struct *keep_list = NULL;
+	Object *object = NULL;
+	Object *next_object = NULL;
+	HighPixel *high_pixel = NULL;
+	int *above_list = NULL;
+	int *below_list = NULL;
+	int ncols,object_count,piece_count,keep_count,boundary_count,retval,t,i,p,x,dx,root_a,root_b;
+
+	ncols = Object_Data.Binned_NCols;
+	boundary_count = tile_count-1;
+	/* count the objects, all of which could be kept */
+	object_count = 0;
+	for(t=0; t < tile_count; t++)
+	{
+		for(object = tile_list[t].Object_List; object != NULL; object = object->nextobject)
+			object_count++;
+	}
+	piece_list = (struct Object_Tile_Piece_Struct *)malloc((object_count+1)*
+							       sizeof(struct Object_Tile_Piece_Struct));
+	keep_list = (struct Object_Tile_Keep_Struct *)malloc((object_count+1)*sizeof(struct Object_Tile_Keep_Struct));
+	above_list = (int *)malloc(((boundary_count*ncols)+1)*sizeof(int));
+	below_list = (int *)malloc(((boundary_count*ncols)+1)*sizeof(int));
+	if((piece_list == NULL)||(keep_list == NULL)||(above_list == NULL)||(below_list == NULL))
+	{
+		for(t=0; t < tile_count; t++)
+			Object_List_Free(&(tile_list[t].Object_List));
+		if(piece_list != NULL)
+			free(piece_list);
+		if(keep_list != NULL)
+			free(keep_list);
+		if(above_list != NULL)
+			free(above_list);
+		if(below_list != NULL)
+			free(below_list);
+		Autoguider_General_Error_Number = 1052;
+		sprintf(Autoguider_General_Error_String,"Object_Tile_Merge:"
+			"Failed to allocate merge lists (%d objects, %d boundaries).",object_count,boundary_count);
+		return FALSE;
+	}
+	/* split the objects into complete objects and pieces, detaching them from the tile lists */
+	piece_count = 0;
+	keep_count = 0;
+	for(t=0; t < tile_count; t++)
+	{
+		object = tile_list[t].Object_List;
+		tile_list[t].Object_List = NULL;
+		while(object != NULL)
+		{
+			next_object = object->nextobject;
+			object->nextobject = NULL;
+			if(Object_Tile_Is_Edge_Object(object,&(tile_list[t]),(t > 0),(t < boundary_count)))
+			{
+				piece_list[piece_count].Object = object;
+				piece_list[piece_count].Tile_Index = t;
+				piece_list[piece_count].Parent = piece_count;
+				piece_list[piece_count].Group_Head = -1;
+				piece_list[piece_count].Group_Next = -1;
+				piece_count++;
+			}
+			else if(object->numpix >= Object_Data.Min_Connected_Pixel_Count)
+			{
+				keep_list[keep_count].Object = object;
+				keep_count++;
+			}
+			else
+				Object_List_Free(&object);
+			object = next_object;
+		}
+	}
+	/* note which piece each pixel either side of each tile boundary belongs to */
+	for(i=0; i < (boundary_count*ncols); i++)
+	{
+		above_list[i] = -1;
+		below_list[i] = -1;
+	}
+	for(p=0; p < piece_count; p++)
+	{
+		t = piece_list[p].Tile_Index;
+		for(high_pixel = piece_list[p].Object->highpixel; high_pixel != NULL; high_pixel = high_pixel->next_pixel)
+		{
+			if((t < boundary_count)&&(high_pixel->y == (tile_list[t].Start_Row+tile_list[t].Row_Count-1)))
+				above_list[(t*ncols)+high_pixel->x] = p;
+			if((t > 0)&&(high_pixel->y == tile_list[t].Start_Row))
+				below_list[((t-1)*ncols)+high_pixel->x] = p;
+		}
+	}
+	/* join pieces with pixels touching across a boundary */
+	for(t=0; t < boundary_count; t++)
+	{
+		for(x=0; x < ncols; x++)
+		{
+			if(below_list[(t*ncols)+x] < 0)
+				continue;
+			for(dx = -1; dx <= 1; dx++)
+			{
+				if(((x+dx) < 0)||((x+dx) >= ncols)||(above_list[(t*ncols)+x+dx] < 0))
+					continue;
+				root_a = Object_Tile_Piece_Find(piece_list,below_list[(t*ncols)+x]);
+				root_b = Object_Tile_Piece_Find(piece_list,above_list[(t*ncols)+x+dx]);
+				if(root_a != root_b)
+					piece_list[root_a].Parent = root_b;
+			}
+		}
+	}
+	free(above_list);
+	free(below_list);
+	/* list the pieces in each group */
+	for(p=0; p < piece_count; p++)
+	{
+		root_a = Object_Tile_Piece_Find(piece_list,p);
+		piece_list[p].Group_Next = piece_list[root_a].Group_Head;
+		piece_list[root_a].Group_Head = p;
+	}
+	/* keep single piece groups, and re-detect the others */
+	retval = TRUE;
+	for(p=0; (p < piece_count) && retval; p++)
+	{
+		if(piece_list[p].Group_Head < 0)
+			continue;
+		if(piece_list[piece_list[p].Group_Head].Group_Next < 0)
+		{
+			object = piece_list[p].Object;
+			if(object->numpix >= Object_Data.Min_Connected_Pixel_Count)
+			{
+				keep_list[keep_count].Object = object;
+				keep_count++;
+				piece_list[p].Object = NULL;
+			}
+		}
+		else
+			retval = Object_Tile_Group_Detect(buffer,piece_list,p,keep_list,&keep_count);
+	}
+	for(p=0; p < piece_count; p++)
+		Object_List_Free(&(piece_list[p].Object));
+	free(piece_list);
+	if(retval == FALSE)
+	{
+		for(i=0; i < keep_count; i++)
+			Object_List_Free(&(keep_list[i].Object));
+		free(keep_list);
+		return FALSE;
+	}
+	/* sort into raster order, renumber and link */
+	for(i=0; i < keep_count; i++)
+	{
+		keep_list[i].Raster_Index = Object_Data.Binned_NCols*Object_Data.Binned_NRows;
+		for(high_pixel = keep_list[i].Object->highpixel; high_pixel != NULL; high_pixel = high_pixel->next_pixel)
+		{
+			if(((high_pixel->y*ncols)+high_pixel->x) < keep_list[i].Raster_Index)
+				keep_list[i].Raster_Index = (high_pixel->y*ncols)+high_pixel->x;
+		}
+	}
+	qsort(keep_list,keep_count,sizeof(struct Object_Tile_Keep_Struct),Object_Sort_Tile_Keep_List_By_Raster_Index);
+	(*object_list) = NULL;
+	for(i=keep_count-1; i >= 0; i--)
+	{
+		keep_list[i].Object->objnum = i+1;
+		keep_list[i].Object->nextobject = (*object_list);
+		(*object_list) = keep_list[i].Object;
+	}
+	free(keep_list);
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("object","autoguider_object.c","Object_Tile_Merge",
+				      LOG_VERBOSITY_VERBOSE,"OBJECT","Merged %d tile objects (%d pieces) into %d objects.",
+				      object_count,piece_count,keep_count);
+#endif
+	return TRUE;
+}
+
+/**
+ * Whether an object found in a tile has any pixels on the tile's first row (when there is a tile above) or
+ * last row (when there is a tile below), so may continue into the next tile.
+ * @param object The object, with pixels in whole image coordinates.
+ * @param tile The tile the object was found in.
+ * @param has_tile_above Boolean, whether there is a tile above (before) this one.
+ * @param has_tile_below Boolean, whether there is a tile below (after) this one.
+ * @return TRUE if the object has pixels on a row next to another tile, FALSE otherwise.
+ * @see #Object_Tile_Struct
+ */
+static int Object_Tile_Is_Edge_Object(Object *object,struct Object_Tile_Struct *tile,int has_tile_above,
+				      int has_tile_below)
+{
+	HighPixel *high_pixel = NULL;
+
+	for(high_pixel = object->highpixel; high_pixel != NULL; high_pixel = high_pixel->next_pixel)
+	{
+		if(has_tile_above && (high_pixel->y == tile->Start_Row))
+			return TRUE;
+		if(has_tile_below && (high_pixel->y == (tile->Start_Row+tile->Row_Count-1)))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/**
+ * Find the root of a piece's group in the union-find forest, halving the path to it as we go.
+ * @param piece_list The list of pieces.
+ * @param piece_index The index of the piece.
+ * @return The index of the root piece of the group.
+ * @see #Object_Tile_Piece_Struct
+ */
+static int Object_Tile_Piece_Find(struct Object_Tile_Piece_Struct *piece_list,int piece_index)
+{
+	while(piece_list[piece_index].Parent != piece_index)
+	{
+		piece_list[piece_index].Parent = piece_list[piece_list[piece_index].Parent].Parent;
+		piece_index = piece_list[piece_index].Parent;
+	}
+	return piece_index;
+}
+
+/**
+ * Re-detect a group of pieces crossing tile boundaries. The group's pieces, from every tile they cross, together
+ * make up one or more complete objects, which lie inside the group's bounding box. The bounding box is copied
+ * from buffer and Object_List_Get called on it, with Min_Connected_Pixel_Count. The objects found whose first 
+ * pixel is one of the group's pixels are moved into whole image coordinates and added to keep_list; the others
+ * (unrelated objects passing through the bounding box, which are found whole elsewhere) are freed.
+ * @param buffer The (unmodified) image data.
+ * @param piece_list The list of pieces.
+ * @param root_index The index of the group's root piece, whose Group_Head starts the list of the group's pieces.
+ * @param keep_list The list of kept objects to add to.
+ * @param keep_count The address of the number of objects in keep_list, incremented for each object added.
+ * @return The routine returns TRUE on success, and FALSE on failure.
+ * @see #Object_Data
+ * @see #Object_Tile_Piece_Struct
+ * @see #Object_Tile_Keep_Struct
+ * @see #Object_Translate
+ * @see ../../libdprt/object/cdocs/object.html#Object_List_Get
+ * @see ../../libdprt/object/cdocs/object.html#Object_List_Free
+ */
+static int Object_Tile_Group_Detect(float *buffer,struct Object_Tile_Piece_Struct *piece_list,int root_index,
+				    struct Object_Tile_Keep_Struct *keep_list,int *keep_count)
+{
+	Object *group_object_list = NULL;
+	Object *object = NULL;
+	Object *next_object = NULL;
+	HighPixel *high_pixel = NULL;
+	unsigned char *mask = NULL;
+	float *window = NULL;
+	int min_x,min_y,max_x,max_y,ncols,nrows,seeing_flag,p,y;
+	float seeing;
+
+	/* find the group's bounding box */
+	min_x = Object_Data.Binned_NCols;
+	min_y = Object_Data.Binned_NRows;
+	max_x = -1;
+	max_y = -1;
+	for(p = piece_list[root_index].Group_Head; p > -1; p = piece_list[p].Group_Next)
+	{
+		for(high_pixel = piece_list[p].Object->highpixel; high_pixel != NULL; high_pixel = high_pixel->next_pixel)
+		{
+			min_x = MIN(min_x,high_pixel->x);
+			min_y = MIN(min_y,high_pixel->y);
+			max_x = MAX(max_x,high_pixel->x);
+			max_y = MAX(max_y,high_pixel->y);
+		}
+	}
+	ncols = (max_x-min_x)+1;
+	nrows = (max_y-min_y)+1;
+	mask = (unsigned char *)calloc(ncols*nrows,sizeof(unsigned char));
+	window = (float *)malloc(ncols*nrows*sizeof(float));
+	if((mask == NULL)||(window == NULL))
+	{
+		if(mask != NULL)
+			free(mask);
+		if(window != NULL)
+			free(window);
+		Autoguider_General_Error_Number = 1053;
+		sprintf(Autoguider_General_Error_String,"Object_Tile_Group_Detect:"
+			"Failed to allocate window (%d,%d).",ncols,nrows);
+		return FALSE;
+	}
+	/* mark the group's pixels, and copy the bounding box */
+	for(p = piece_list[root_index].Group_Head; p > -1; p = piece_list[p].Group_Next)
+	{
+		for(high_pixel = piece_list[p].Object->highpixel; high_pixel != NULL; high_pixel = high_pixel->next_pixel)
+			mask[((high_pixel->y-min_y)*ncols)+(high_pixel->x-min_x)] = TRUE;
+	}
+	for(y=0; y < nrows; y++)
+	{
+		memcpy(window+(y*ncols),buffer+(((min_y+y)*Object_Data.Binned_NCols)+min_x),ncols*sizeof(float));
+	}
+	if(!Object_List_Get(window,Object_Data.Median,ncols,nrows,Object_Data.Threshold,
+			    Object_Data.Min_Connected_Pixel_Count,&group_object_list,&seeing_flag,&seeing))
+	{
+		free(mask);
+		free(window);
+		Autoguider_General_Error_Number = 1054;
+		sprintf(Autoguider_General_Error_String,"Object_Tile_Group_Detect:"
+			"Object_List_Get failed for window (%d,%d) to (%d,%d).",min_x,min_y,max_x,max_y);
+		return FALSE;
+	}
+	free(window);
+	object = group_object_list;
+	while(object != NULL)
+	{
+		next_object = object->nextobject;
+		object->nextobject = NULL;
+		high_pixel = object->highpixel;
+		if((high_pixel != NULL)&&(high_pixel->x > -1)&&(high_pixel->x < ncols)&&(high_pixel->y > -1)&&
+		   (high_pixel->y < nrows)&&mask[(high_pixel->y*ncols)+high_pixel->x])
+		{
+			Object_Translate(object,min_x,min_y);
+			keep_list[(*keep_count)].Object = object;
+			(*keep_count)++;
+		}
+		else
+			Object_List_Free(&object);
+		object = next_object;
+	}
+	free(mask);
+	return TRUE;
+}
+
+/**
+ * Move an object's position and pixels by the specified offset, from tile or window coordinates to
+ * whole image coordinates.
+ * @param object The object.
+ * @param x_offset The number of pixels to add to the X position and pixel coordinates.
+ * @param y_offset The number of pixels to add to the Y position and pixel coordinates.
+ */
+static void Object_Translate(Object *object,int x_offset,int y_offset)
+{
+	HighPixel *high_pixel = NULL;
+
+	object->xpos += x_offset;
+	object->ypos += y_offset;
+	for(high_pixel = object->highpixel; high_pixel != NULL; high_pixel = high_pixel->next_pixel)
+	{
+		high_pixel->x += x_offset;
+		high_pixel->y += y_offset;
+	}
+}
+
+/**
+ * Get a simple mean and standard deviation measure from Object_Data.Stats_List / Object_Data.Stats_Count.
+ * These are stored into Object_Data.Mean / Object_Data.Background_Standard_Deviation.
+ * @see #Object_Data
+ * @see autoguider_general.html#Autoguider_General_Log_Format
+ */
+static int Object_Get_Mean_Standard_Deviation_Simple(void)
+{
+	int i;
+	float total_value,difference_squared_total,tmp_float,variance;
+
+	/* find the total value of the Stats_List */
+	total_value = 0.0f;
+	for(i=0;i<Object_Data.Stats_Count;i++)
+	{
+		total_value += Object_Data.Stats_List[i];
+	}
+	/* mean */
+	Object_Data.Mean = total_value/Object_Data.Stats_Count;
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("object","autoguider_object.c","Object_Get_Mean_Standard_Deviation_Simple",
+				      LOG_VERBOSITY_INTERMEDIATE,"OBJECT","Mean pixel value %.2f.",Object_Data.Mean);
+#endif
+	/* standard deviation */
+	difference_squared_total = 0.0f;
+	for(i=0;i<Object_Data.Stats_Count;i++)
+	{
+		tmp_float = Object_Data.Stats_List[i]-Object_Data.Mean;
+		difference_squared_total += tmp_float*tmp_float;
+	}
+	variance = difference_squared_total/Object_Data.Stats_Count;
+	/* background SD */
 	Object_Data.Background_Standard_Deviation = (float)sqrt(((double)variance));
 #if AUTOGUIDER_DEBUG > 5
 	Autoguider_General_Log_Format("object","autoguider_object.c","Object_Get_Mean_Standard_Deviation_Simple",
@@ -1585,16 +2523,31 @@ static int Object_Get_Mean_Standard_Deviation_Sigma_Reject(void)
 }
 
 /**
- * Create an output object mask from pixel data in object list.
+ * Create the object mask spans from pixel data in object list. Rather than writing each object's pixels into
+ * an object mask image (most frames never have their mask retrieved), the pixels are stored as spans
+ * in Mask_Span_List. A pixel that follows on from the last span (the next pixel in the image data, with the
+ * same object number) extends it, otherwise a new span is started. Mask_Span_List is reallocated if more space
+ * is needed when real-time mode is disabled. In real-time mode the list is preallocated to Mask_Span_Count_Max 
+ * spans by Autoguider_Object_Initialise, and pixels that would need a new span once it is full are counted in
+ * Mask_Span_Dropped_Pixel_Count and left out of the mask, rather than growing the list on the guide thread. 
+ * Should be called with the Image_Data_Mutex locked, after Object_Buffer_Copy has
+ * emptied the list.
  * @param object_list The objects to create.
  * @return TRUE on success, FALSE on failure.
  * @see #Object_Data
+ * @see #Object_Mask_Span_Struct
+ * @see #OBJECT_MASK_SPAN_MIN_ALLOCATE
+ * @see #Autoguider_Object_Initialise
+ * @see #Autoguider_Object_Mask_Copy
+ * @see autoguider_realtime.html#Autoguider_Realtime_Is_Enabled
  */
-static void Object_Mask_Create(Object *object_list)
+static int Object_Mask_Create(Object *object_list)
 {
+	struct Object_Mask_Span_Struct *span = NULL;
+	struct Object_Mask_Span_Struct *new_span_list = NULL;
 	Object *object = NULL;
 	HighPixel *high_pixel = NULL;
-	int x,y,objnum;
+	int x,y,objnum,pixel_index,new_allocated_count;
 
 	object = object_list;
 	while(object != NULL)
@@ -1607,20 +2560,395 @@ static void Object_Mask_Create(Object *object_list)
 			x = high_pixel->x;
 			y = high_pixel->y;
 			if((x > -1) &&(x < Object_Data.Binned_NCols)&&(y > -1) &&(y < Object_Data.Binned_NRows))
-				Object_Data.Object_Mask_Data[(y*Object_Data.Binned_NCols)+x] = objnum;
+			{
+				pixel_index = (y*Object_Data.Binned_NCols)+x;
+				if(Object_Data.Mask_Span_Count > 0)
+					span = &(Object_Data.Mask_Span_List[Object_Data.Mask_Span_Count-1]);
+				else
+					span = NULL;
+				if((span != NULL)&&(span->Label == objnum)&&
+				   ((span->Pixel_Index+span->Length) == pixel_index))
+				{
+					span->Length++;
+				}
+				else if(Autoguider_Realtime_Is_Enabled() &&
+					(Object_Data.Mask_Span_Count >= Object_Data.Allocated_Mask_Span_Count))
+				{
+					Object_Data.Mask_Span_Dropped_Pixel_Count++;
+				}
+				else
+				{
+					if(Object_Data.Mask_Span_Count >= Object_Data.Allocated_Mask_Span_Count)
+					{
+						new_allocated_count = Object_Data.Allocated_Mask_Span_Count*2;
+						if(new_allocated_count < OBJECT_MASK_SPAN_MIN_ALLOCATE)
+							new_allocated_count = OBJECT_MASK_SPAN_MIN_ALLOCATE;
+						new_span_list = (struct Object_Mask_Span_Struct *)realloc(
+							    Object_Data.Mask_Span_List,
+							    new_allocated_count*sizeof(struct Object_Mask_Span_Struct));
+						if(new_span_list == NULL)
+						{
+							Autoguider_General_Error_Number = 1041;
+							sprintf(Autoguider_General_Error_String,"Object_Mask_Create:"
+								"Failed to reallocate mask span list to %d spans.",
+								new_allocated_count);
+							return FALSE;
+						}
+						Object_Data.Mask_Span_List = new_span_list;
+						Object_Data.Allocated_Mask_Span_Count = new_allocated_count;
+					}
+					span = &(Object_Data.Mask_Span_List[Object_Data.Mask_Span_Count]);
+					span->Pixel_Index = pixel_index;
+					span->Length = 1;
+					span->Label = objnum;
+					Object_Data.Mask_Span_Count++;
+				}
+			}
 			/* and to next pixel */
 			high_pixel = high_pixel->next_pixel;
 		}
-		/* highlight centre-point */
-		/* diddly
-		x = (int)(object->xpos);
-		y = (int)(object->ypos);
-		if((x > -1) &&(x < Object_Data.Binned_NCols)&&(y > -1) &&(y < Object_Data.Binned_NRows))
-			Object_Mask_Data[(y*Object_Data.Binned_NCols)+x] = 65535;
-		*/
 		/* and to next object */
 		object = object->nextobject;
 	}
+	return TRUE;
+}
+
+/**
+ * Build the object catalogue and grid index from the (sorted) object list. 
+ * Should be called with the Object_List_Mutex locked.
+ * <ul>
+ * <li>The catalogue lists are (re)allocated if Object_Count is more than Catalogue.Allocated_Count.
+ * <li>Each object's position and total counts are copied into the catalogue. Objects inside the
+ *     field object bounds (Autoguider_Field_In_Object_Bounds) are added to Rank_List, which is therefore in
+ *     total counts order as the object list has already been sorted.
+ * <li>The grid covers the bounding box of the object positions, with cells of OBJECT_CATALOGUE_GRID_CELL_SIZE
+ *     pixels, increased if necessary so the grid has at most OBJECT_CATALOGUE_GRID_MAX_CELLS cells.
+ * <li>Cell_Start is (re)allocated if needed, and Cell_Start / Cell_Object_List are filled in using a counting sort
+ *     of the object indices by grid cell.
+ * </ul>
+ * @return The routine returns TRUE on success, and FALSE on failure.
+ * @see #Object_Data
+ * @see #Object_Catalogue_Struct
+ * @see #OBJECT_CATALOGUE_GRID_CELL_SIZE
+ * @see #OBJECT_CATALOGUE_GRID_MAX_CELLS
+ * @see #Object_Catalogue_Cell_Get
+ * @see autoguider_field.html#Autoguider_Field_In_Object_Bounds
+ * @see autoguider_general.html#Autoguider_General_Error_Number
+ * @see autoguider_general.html#Autoguider_General_Error_String
+ */
+static int Object_Catalogue_Build(void)
+{
+	struct Object_Catalogue_Struct *catalogue = &(Object_Data.Catalogue);
+	float *float_list = NULL;
+	int *int_list = NULL;
+	float min_x,min_y,max_x,max_y;
+	int index,cell,cell_count,allocate_failed;
+
+	catalogue->Count = 0;
+	catalogue->Rank_Count = 0;
+	/* (re)allocate per object lists. On failure realloc leaves the old list allocated,
+	** so only replace each list when it succeeds, and let Object_Catalogue_Free free the old ones. */
+	if(Object_Data.Object_Count > catalogue->Allocated_Count)
+	{
+		allocate_failed = FALSE;
+		float_list = (float*)realloc(catalogue->X,Object_Data.Object_Count*sizeof(float));
+		if(float_list != NULL)
+			catalogue->X = float_list;
+		else
+			allocate_failed = TRUE;
+		float_list = (float*)realloc(catalogue->Y,Object_Data.Object_Count*sizeof(float));
+		if(float_list != NULL)
+			catalogue->Y = float_list;
+		else
+			allocate_failed = TRUE;
+		float_list = (float*)realloc(catalogue->Total_Counts,Object_Data.Object_Count*sizeof(float));
+		if(float_list != NULL)
+			catalogue->Total_Counts = float_list;
+		else
+			allocate_failed = TRUE;
+		int_list = (int*)realloc(catalogue->Rank_List,Object_Data.Object_Count*sizeof(int));
+		if(int_list != NULL)
+			catalogue->Rank_List = int_list;
+		else
+			allocate_failed = TRUE;
+		int_list = (int*)realloc(catalogue->Cell_Object_List,Object_Data.Object_Count*sizeof(int));
+		if(int_list != NULL)
+			catalogue->Cell_Object_List = int_list;
+		else
+			allocate_failed = TRUE;
+		if(allocate_failed)
+		{
+			Object_Catalogue_Free();
+			Autoguider_General_Error_Number = 1037;
+			sprintf(Autoguider_General_Error_String,"Object_Catalogue_Build:"
+				"Allocating catalogue failed(%d).",Object_Data.Object_Count);
+			return FALSE;
+		}
+		catalogue->Allocated_Count = Object_Data.Object_Count;
+	}
+	/* copy object data into catalogue */
+	min_x = 0.0f;
+	min_y = 0.0f;
+	max_x = 0.0f;
+	max_y = 0.0f;
+	for(index = 0; index < Object_Data.Object_Count; index++)
+	{
+		catalogue->X[index] = Object_Data.Object_List[index].CCD_X_Position;
+		catalogue->Y[index] = Object_Data.Object_List[index].CCD_Y_Position;
+		catalogue->Total_Counts[index] = Object_Data.Object_List[index].Total_Counts;
+		if(Autoguider_Field_In_Object_Bounds(catalogue->X[index],catalogue->Y[index]))
+			catalogue->Rank_List[catalogue->Rank_Count++] = index;
+		if((index == 0)||(catalogue->X[index] < min_x))
+			min_x = catalogue->X[index];
+		if((index == 0)||(catalogue->Y[index] < min_y))
+			min_y = catalogue->Y[index];
+		if((index == 0)||(catalogue->X[index] > max_x))
+			max_x = catalogue->X[index];
+		if((index == 0)||(catalogue->Y[index] > max_y))
+			max_y = catalogue->Y[index];
+	}
+	catalogue->Count = Object_Data.Object_Count;
+	/* size the grid to the bounding box of the objects */
+	catalogue->Grid_Min_X = min_x;
+	catalogue->Grid_Min_Y = min_y;
+	catalogue->Cell_Size = OBJECT_CATALOGUE_GRID_CELL_SIZE;
+	do
+	{
+		catalogue->Grid_NCols = ((int)((max_x-min_x)/catalogue->Cell_Size))+1;
+		catalogue->Grid_NRows = ((int)((max_y-min_y)/catalogue->Cell_Size))+1;
+		cell_count = catalogue->Grid_NCols*catalogue->Grid_NRows;
+		if(cell_count > OBJECT_CATALOGUE_GRID_MAX_CELLS)
+			catalogue->Cell_Size *= 2.0f;
+	} while(cell_count > OBJECT_CATALOGUE_GRID_MAX_CELLS);
+	if((cell_count+1) > catalogue->Allocated_Cell_Count)
+	{
+		int_list = (int*)realloc(catalogue->Cell_Start,(cell_count+1)*sizeof(int));
+		if(int_list == NULL)
+		{
+			Object_Catalogue_Free();
+			Autoguider_General_Error_Number = 1038;
+			sprintf(Autoguider_General_Error_String,"Object_Catalogue_Build:"
+				"Allocating grid index failed(%d).",cell_count);
+			return FALSE;
+		}
+		catalogue->Cell_Start = int_list;
+		catalogue->Allocated_Cell_Count = cell_count+1;
+	}
+	/* count objects per cell, offset by one */
+	for(cell = 0; cell <= cell_count; cell++)
+		catalogue->Cell_Start[cell] = 0;
+	for(index = 0; index < catalogue->Count; index++)
+	{
+		cell = Object_Catalogue_Cell_Get(catalogue->X[index],catalogue->Y[index]);
+		catalogue->Cell_Start[cell+1]++;
+	}
+	/* prefix sum the counts, Cell_Start[cell+1] is now the end offset of each cell */
+	for(cell = 0; cell < cell_count; cell++)
+		catalogue->Cell_Start[cell+1] += catalogue->Cell_Start[cell];
+	/* scatter the indices into their cells, backwards, so the indices in each cell stay in ascending order.
+	** Each cell's end offset is decremented to it's start offset as we go. */
+	for(index = catalogue->Count-1; index >= 0; index--)
+	{
+		cell = Object_Catalogue_Cell_Get(catalogue->X[index],catalogue->Y[index]);
+		catalogue->Cell_Object_List[--(catalogue->Cell_Start[cell+1])] = index;
+	}
+	/* Cell_Start[cell+1] now holds the start offset of each cell, shift them down */
+	for(cell = 0; cell < cell_count; cell++)
+		catalogue->Cell_Start[cell] = catalogue->Cell_Start[cell+1];
+	catalogue->Cell_Start[cell_count] = catalogue->Count;
+	return TRUE;
+}
+
+/**
+ * Get the catalogue grid cell containing the specified position. Positions outside the grid are clamped
+ * to the nearest edge cell. Should be called with the Object_List_Mutex locked, after the grid has been sized.
+ * @param x The CCD X position.
+ * @param y The CCD Y position.
+ * @return The index of the cell, in the range 0..(Grid_NCols*Grid_NRows)-1.
+ * @see #Object_Data
+ */
+static int Object_Catalogue_Cell_Get(float x,float y)
+{
+	int cell_x,cell_y;
+
+	cell_x = (int)floor((double)((x-Object_Data.Catalogue.Grid_Min_X)/Object_Data.Catalogue.Cell_Size));
+	cell_y = (int)floor((double)((y-Object_Data.Catalogue.Grid_Min_Y)/Object_Data.Catalogue.Cell_Size));
+	if(cell_x < 0)
+		cell_x = 0;
+	if(cell_x >= Object_Data.Catalogue.Grid_NCols)
+		cell_x = Object_Data.Catalogue.Grid_NCols-1;
+	if(cell_y < 0)
+		cell_y = 0;
+	if(cell_y >= Object_Data.Catalogue.Grid_NRows)
+		cell_y = Object_Data.Catalogue.Grid_NRows-1;
+	return (cell_y*Object_Data.Catalogue.Grid_NCols)+cell_x;
+}
+
+/**
+ * Find the catalogue object nearest the specified position, using the grid index.
+ * Should be called with the Object_List_Mutex locked.
+ * The cells are searched in square rings of increasing size around the cell containing the position
+ * (clamped to the grid). The search stops when the nearest object found so far is closer than 
+ * any unsearched cell, or the whole grid has been searched. Where two objects are the same distance away,
+ * the one with the lower index (the brighter one) is returned, as the old linear search did.
+ * @param x The CCD X position.
+ * @param y The CCD Y position.
+ * @param exclude_index The index of an object to ignore (used to find an object's neighbours), or -1.
+ * @param nearest_index The address of an integer to store the index of the nearest object. 
+ *        This is set to -1 if there is no such object.
+ * @param distance_squared The address of a float to store the square of the distance to the nearest object, 
+ *        in pixels.
+ * @see #Object_Data
+ * @see #Object_Catalogue_Cell_Get
+ */
+static void Object_Catalogue_Nearest(float x,float y,int exclude_index,int *nearest_index,float *distance_squared)
+{
+	struct Object_Catalogue_Struct *catalogue = &(Object_Data.Catalogue);
+	float xdiff,ydiff,dsq,margin,edge;
+	int centre_cell,centre_x,centre_y,ring,cell_x,cell_y,cell_x_step,cell,offset,index;
+
+	(*nearest_index) = -1;
+	(*distance_squared) = 0.0f;
+	if(catalogue->Count < 1)
+		return;
+	centre_cell = Object_Catalogue_Cell_Get(x,y);
+	centre_x = centre_cell % catalogue->Grid_NCols;
+	centre_y = centre_cell / catalogue->Grid_NCols;
+	for(ring = 0; ; ring++)
+	{
+		for(cell_y = centre_y-ring; cell_y <= centre_y+ring; cell_y++)
+		{
+			if((cell_y < 0)||(cell_y >= catalogue->Grid_NRows))
+				continue;
+			/* only the top and bottom rows of the ring are searched in full */
+			if((ring == 0)||(cell_y == centre_y-ring)||(cell_y == centre_y+ring))
+				cell_x_step = 1;
+			else
+				cell_x_step = 2*ring;
+			for(cell_x = centre_x-ring; cell_x <= centre_x+ring; cell_x += cell_x_step)
+			{
+				if((cell_x < 0)||(cell_x >= catalogue->Grid_NCols))
+					continue;
+				cell = (cell_y*catalogue->Grid_NCols)+cell_x;
+				for(offset = catalogue->Cell_Start[cell]; offset < catalogue->Cell_Start[cell+1]; offset++)
+				{
+					index = catalogue->Cell_Object_List[offset];
+					if(index == exclude_index)
+						continue;
+					xdiff = catalogue->X[index]-x;
+					ydiff = catalogue->Y[index]-y;
+					dsq = (xdiff*xdiff)+(ydiff*ydiff);
+					if(((*nearest_index) < 0)||(dsq < (*distance_squared))||
+					   ((dsq == (*distance_squared))&&(index < (*nearest_index))))
+					{
+						(*nearest_index) = index;
+						(*distance_squared) = dsq;
+					}
+				}
+			}
+		}
+		/* have we searched the whole grid? */
+		if((centre_x-ring <= 0)&&(centre_y-ring <= 0)&&(centre_x+ring >= catalogue->Grid_NCols-1)&&
+		   (centre_y+ring >= catalogue->Grid_NRows-1))
+			break;
+		/* is the nearest object found closer than any unsearched cell? */
+		if((*nearest_index) > -1)
+		{
+			margin = x-(catalogue->Grid_Min_X+((centre_x-ring)*catalogue->Cell_Size));
+			edge = (catalogue->Grid_Min_X+((centre_x+ring+1)*catalogue->Cell_Size))-x;
+			if(edge < margin)
+				margin = edge;
+			edge = y-(catalogue->Grid_Min_Y+((centre_y-ring)*catalogue->Cell_Size));
+			if(edge < margin)
+				margin = edge;
+			edge = (catalogue->Grid_Min_Y+((centre_y+ring+1)*catalogue->Cell_Size))-y;
+			if(edge < margin)
+				margin = edge;
+			if((margin > 0.0f)&&((*distance_squared) < (margin*margin)))
+				break;
+		}
+	}
+}
+
+/**
+ * Find the catalogue objects within a radius of the specified position, using the grid index.
+ * Should be called with the Object_List_Mutex locked.
+ * @param x The CCD X position.
+ * @param y The CCD Y position.
+ * @param radius The search radius in pixels.
+ * @param index_list A list to store the indices of the objects found in, or NULL.
+ * @param max_index_count The maximum number of indices to store in index_list.
+ * @return The number of objects within the radius.
+ * @see #Object_Data
+ * @see #Object_Catalogue_Cell_Get
+ */
+static int Object_Catalogue_Radius(float x,float y,float radius,int *index_list,int max_index_count)
+{
+	struct Object_Catalogue_Struct *catalogue = &(Object_Data.Catalogue);
+	float xdiff,ydiff,radius_squared;
+	int start_cell,end_cell,cell_x,cell_y,cell,offset,index,count;
+
+	if(catalogue->Count < 1)
+		return 0;
+	/* the objects are all in the grid, so clamping the search box to the grid is safe */
+	start_cell = Object_Catalogue_Cell_Get(x-radius,y-radius);
+	end_cell = Object_Catalogue_Cell_Get(x+radius,y+radius);
+	radius_squared = radius*radius;
+	count = 0;
+	for(cell_y = start_cell / catalogue->Grid_NCols; cell_y <= end_cell / catalogue->Grid_NCols; cell_y++)
+	{
+		for(cell_x = start_cell % catalogue->Grid_NCols; cell_x <= end_cell % catalogue->Grid_NCols; cell_x++)
+		{
+			cell = (cell_y*catalogue->Grid_NCols)+cell_x;
+			for(offset = catalogue->Cell_Start[cell]; offset < catalogue->Cell_Start[cell+1]; offset++)
+			{
+				index = catalogue->Cell_Object_List[offset];
+				xdiff = catalogue->X[index]-x;
+				ydiff = catalogue->Y[index]-y;
+				if(((xdiff*xdiff)+(ydiff*ydiff)) <= radius_squared)
+				{
+					if(count < max_index_count)
+						index_list[count] = index;
+					count++;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+/**
+ * Free the object catalogue lists and grid index. Should be called with the Object_List_Mutex locked.
+ * @see #Object_Data
+ */
+static void Object_Catalogue_Free(void)
+{
+	struct Object_Catalogue_Struct *catalogue = &(Object_Data.Catalogue);
+
+	if(catalogue->X != NULL)
+		free(catalogue->X);
+	catalogue->X = NULL;
+	if(catalogue->Y != NULL)
+		free(catalogue->Y);
+	catalogue->Y = NULL;
+	if(catalogue->Total_Counts != NULL)
+		free(catalogue->Total_Counts);
+	catalogue->Total_Counts = NULL;
+	if(catalogue->Rank_List != NULL)
+		free(catalogue->Rank_List);
+	catalogue->Rank_List = NULL;
+	if(catalogue->Cell_Start != NULL)
+		free(catalogue->Cell_Start);
+	catalogue->Cell_Start = NULL;
+	if(catalogue->Cell_Object_List != NULL)
+		free(catalogue->Cell_Object_List);
+	catalogue->Cell_Object_List = NULL;
+	catalogue->Count = 0;
+	catalogue->Rank_Count = 0;
+	catalogue->Allocated_Count = 0;
+	catalogue->Allocated_Cell_Count = 0;
+	catalogue->Grid_NCols = 0;
+	catalogue->Grid_NRows = 0;
 }
 
 /**
@@ -1658,6 +2986,22 @@ static int Object_Sort_Object_List_By_Total_Counts(const void *p1, const void *p
 		return 0;
 }
 
+/**
+ * Object_Tile_Keep_Struct list sort comparator, for use with qsort. Sorts by raster index, smallest first.
+ */
+static int Object_Sort_Tile_Keep_List_By_Raster_Index(const void *p1, const void *p2)
+{
+	const struct Object_Tile_Keep_Struct *k1 = (const struct Object_Tile_Keep_Struct *)p1;
+	const struct Object_Tile_Keep_Struct *k2 = (const struct Object_Tile_Keep_Struct *)p2;
+
+	if(k1->Raster_Index < k2->Raster_Index)
+		return -1;
+	else if(k1->Raster_Index > k2->Raster_Index)
+		return 1;
+	else
+		return 0;
+}
+
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.17  2009/06/12 13:41:25  cjm
@@ -0,0 +1,891 @@
+/* autoguider_preview.c
+** Autoguider preview image routines
+** $Header$
+*/
+/**
+ * Routines to return a small 8 bit quick-look image of the last field or guide frame, for GUIs and
+ * engineering scripts, in place of a full float FITS image ("getpreview" rather than "getfits").
+ * The last reduced buffer is binned server side, whilst the buffer is locked (the field/guide loop
+ * only writes into the other buffer of the pair, so this does not hold the loop up). The binned image is
+ * then scaled into 8 bits (zscale or percentile) and encoded as a PNG or PGM.
+ * The objects detected in the frame are sent alongside, as text in the image (a PNG tEXt chunk or PGM comments),
+ * and can optionally be overlaid on the image as crosses.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+
+#include "autoguider_buffer.h"
+#include "autoguider_field.h"
+#include "autoguider_general.h"
+#include "autoguider_guide.h"
+#include "autoguider_object.h"
+#include "autoguider_preview.h"
+
+/* hash defines */
+/**
+ * The maximum number of binned pixels sampled to compute the scaling.
+ */
+#define PREVIEW_SAMPLE_COUNT          (10000)
+/**
+ * The low percentile used for AUTOGUIDER_PREVIEW_SCALE_PERCENTILE.
+ */
+#define PREVIEW_PERCENTILE_LOW        (0.005)
+/**
+ * The high percentile used for AUTOGUIDER_PREVIEW_SCALE_PERCENTILE.
+ */
+#define PREVIEW_PERCENTILE_HIGH       (0.995)
+/**
+ * The zscale contrast, as IRAF's display task.
+ */
+#define PREVIEW_ZSCALE_CONTRAST       (0.25)
+/**
+ * The zscale rejection threshold, in standard deviations of the line fit residuals.
+ */
+#define PREVIEW_ZSCALE_KREJ           (2.5)
+/**
+ * The maximum number of zscale line fit iterations.
+ */
+#define PREVIEW_ZSCALE_MAX_ITERATIONS (5)
+/**
+ * The minimum number of samples left after zscale rejection, for the line fit to be used.
+ */
+#define PREVIEW_ZSCALE_MIN_PIXELS     (5)
+/**
+ * The half size, in preview pixels, of the crosses drawn over objects.
+ */
+#define PREVIEW_OVERLAY_RADIUS        (5)
+/**
+ * The half size, in preview pixels, of the gap in the centre of the crosses drawn over objects.
+ */
+#define PREVIEW_OVERLAY_GAP           (2)
+/**
+ * The largest amount of data in a stored (uncompressed) deflate block.
+ */
+#define PREVIEW_DEFLATE_BLOCK_LENGTH  (65535)
+
+/* data types */
+/**
+ * Data type holding a preview image whilst it is being made. This consists of the following:
+ * <dl>
+ * <dt>Binned_Data</dt> <dd>The binned reduced image data, NCols by NRows.</dd>
+ * <dt>Image_Data</dt> <dd>The scaled 8 bit image data, NCols by NRows, top row first.</dd>
+ * <dt>NCols</dt> <dd>The number of columns in the preview.</dd>
+ * <dt>NRows</dt> <dd>The number of rows in the preview.</dd>
+ * <dt>Low</dt> <dd>The pixel value scaled to 0.</dd>
+ * <dt>High</dt> <dd>The pixel value scaled to 255.</dd>
+ * <dt>Text</dt> <dd>The text sent alongside the image, describing the scaling and objects.</dd>
+ * </dl>
+ */
+struct Preview_Struct
+{
+	float *Binned_Data;
+	unsigned char *Image_Data;
+	int NCols;
+	int NRows;
+	float Low;
+	float High;
+	struct Autoguider_General_Reply_Struct Text;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+
+/* internal functions */
+static int Preview_Bin(int buffer_type,int bin,struct Preview_Struct *preview,int *buffer_ncols,int *buffer_nrows);
+static int Preview_Scale_Get(int scale_type,struct Preview_Struct *preview);
+static void Preview_Zscale(float *sample_list,int sample_count,float *low,float *high);
+static void Preview_Image_Create(struct Preview_Struct *preview);
+static int Preview_Objects(int buffer_type,int bin,int overlay,int buffer_ncols,int buffer_nrows,
+			   struct Preview_Struct *preview);
+static void Preview_Overlay_Set(struct Preview_Struct *preview,int x,int y);
+static int Preview_PGM_Create(struct Preview_Struct *preview,void **buffer_ptr,size_t *buffer_length);
+static int Preview_PNG_Create(struct Preview_Struct *preview,void **buffer_ptr,size_t *buffer_length);
+static unsigned char *Preview_PNG_Chunk_Add(unsigned char *ptr,char *type,unsigned char *data,size_t data_length,
+					    unsigned int *crc_table);
+static void Preview_Put_Int_BE(unsigned char *ptr,unsigned int value);
+static void Preview_Free(struct Preview_Struct *preview);
+static int Preview_Sort_Float_List(const void *p1,const void *p2);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Create an in memory 8 bit preview image of the last reduced field or guide buffer.
+ * <ul>
+ * <li>Preview_Bin bins the last reduced buffer by bin.
+ * <li>Preview_Scale_Get works out the scaling from a sample of the binned pixels.
+ * <li>Preview_Image_Create scales the binned image into 8 bits, top row first.
+ * <li>Preview_Objects adds the detected objects to the text sent alongside the image, and optionally overlays them.
+ * <li>Preview_PNG_Create or Preview_PGM_Create encodes the image.
+ * </ul>
+ * @param buffer_type Which buffer to get the latest image from, AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD or
+ *        AUTOGUIDER_PREVIEW_BUFFER_TYPE_GUIDE.
+ * @param bin The binning factor, in X and Y, from 1 to AUTOGUIDER_PREVIEW_BIN_MAX.
+ * @param scale_type How to scale the image, AUTOGUIDER_PREVIEW_SCALE_ZSCALE or AUTOGUIDER_PREVIEW_SCALE_PERCENTILE.
+ * @param format The image format, AUTOGUIDER_PREVIEW_FORMAT_PNG or AUTOGUIDER_PREVIEW_FORMAT_PGM.
+ * @param overlay A boolean, if TRUE crosses are drawn over the detected objects.
+ * @param buffer_ptr The address of a pointer, on return an allocated buffer containing the image.
+ *        This should be freed by the caller.
+ * @param buffer_length The address of a word, on return the number of bytes in the image buffer.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD
+ * @see #AUTOGUIDER_PREVIEW_BUFFER_TYPE_GUIDE
+ * @see #AUTOGUIDER_PREVIEW_SCALE_ZSCALE
+ * @see #AUTOGUIDER_PREVIEW_SCALE_PERCENTILE
+ * @see #AUTOGUIDER_PREVIEW_FORMAT_PNG
+ * @see #AUTOGUIDER_PREVIEW_FORMAT_PGM
+ * @see #AUTOGUIDER_PREVIEW_BIN_MAX
+ * @see #Preview_Bin
+ * @see #Preview_Scale_Get
+ * @see #Preview_Image_Create
+ * @see #Preview_Objects
+ * @see #Preview_PNG_Create
+ * @see #Preview_PGM_Create
+ * @see #Preview_Free
+ * @see autoguider_general.html#Autoguider_General_Log
+ * @see autoguider_general.html#Autoguider_General_Error_Number
+ * @see autoguider_general.html#Autoguider_General_Error_String
+ */
+int Autoguider_Preview_Get(int buffer_type,int bin,int scale_type,int format,int overlay,
+			   void **buffer_ptr,size_t *buffer_length)
+{
+	struct Preview_Struct preview;
+	int retval,buffer_ncols,buffer_nrows;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("preview","autoguider_preview.c","Autoguider_Preview_Get",
+				      LOG_VERBOSITY_INTERMEDIATE,"PREVIEW","started(type=%d,bin=%d,scale=%d,format=%d,"
+				      "overlay=%d).",buffer_type,bin,scale_type,format,overlay);
+#endif
+	/* check parameters */
+	if((buffer_type != AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD)&&(buffer_type != AUTOGUIDER_PREVIEW_BUFFER_TYPE_GUIDE))
+	{
+		Autoguider_General_Error_Number = 2200;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Preview_Get:Illegal buffer type %d.",buffer_type);
+		return FALSE;
+	}
+	if((bin < 1)||(bin > AUTOGUIDER_PREVIEW_BIN_MAX))
+	{
+		Autoguider_General_Error_Number = 2201;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Preview_Get:Binning %d out of range (1..%d).",
+			bin,AUTOGUIDER_PREVIEW_BIN_MAX);
+		return FALSE;
+	}
+	if((scale_type != AUTOGUIDER_PREVIEW_SCALE_ZSCALE)&&(scale_type != AUTOGUIDER_PREVIEW_SCALE_PERCENTILE))
+	{
+		Autoguider_General_Error_Number = 2202;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Preview_Get:Illegal scale type %d.",scale_type);
+		return FALSE;
+	}
+	if((format != AUTOGUIDER_PREVIEW_FORMAT_PNG)&&(format != AUTOGUIDER_PREVIEW_FORMAT_PGM))
+	{
+		Autoguider_General_Error_Number = 2203;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Preview_Get:Illegal format %d.",format);
+		return FALSE;
+	}
+	if(!AUTOGUIDER_GENERAL_IS_BOOLEAN(overlay))
+	{
+		Autoguider_General_Error_Number = 2204;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Preview_Get:Illegal overlay value %d.",overlay);
+		return FALSE;
+	}
+	if((buffer_ptr == NULL)||(buffer_length == NULL))
+	{
+		Autoguider_General_Error_Number = 2205;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Preview_Get:buffer_ptr or buffer_length was NULL.");
+		return FALSE;
+	}
+	preview.Binned_Data = NULL;
+	preview.Image_Data = NULL;
+	preview.NCols = 0;
+	preview.NRows = 0;
+	Autoguider_General_Reply_Initialise(&(preview.Text));
+	/* bin, scale and overlay */
+	if(!Preview_Bin(buffer_type,bin,&preview,&buffer_ncols,&buffer_nrows))
+	{
+		Preview_Free(&preview);
+		return FALSE;
+	}
+	if(!Preview_Scale_Get(scale_type,&preview))
+	{
+		Preview_Free(&preview);
+		return FALSE;
+	}
+	Preview_Image_Create(&preview);
+	if(!Autoguider_General_Reply_Add_Format(&(preview.Text),"bin %d\nscale %.2f %.2f\n",bin,preview.Low,
+						preview.High))
+	{
+		Preview_Free(&preview);
+		return FALSE;
+	}
+	if(!Preview_Objects(buffer_type,bin,overlay,buffer_ncols,buffer_nrows,&preview))
+	{
+		Preview_Free(&preview);
+		return FALSE;
+	}
+	/* encode */
+	if(format == AUTOGUIDER_PREVIEW_FORMAT_PNG)
+		retval = Preview_PNG_Create(&preview,buffer_ptr,buffer_length);
+	else
+		retval = Preview_PGM_Create(&preview,buffer_ptr,buffer_length);
+	Preview_Free(&preview);
+	if(retval == FALSE)
+		return FALSE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("preview","autoguider_preview.c","Autoguider_Preview_Get",
+				      LOG_VERBOSITY_INTERMEDIATE,"PREVIEW","finished(%ld bytes).",
+				      (long)(*buffer_length));
+#endif
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Bin the last reduced field or guide buffer into preview->Binned_Data. Each binned pixel is the mean of
+ * a bin by bin block of reduced pixels, any partial blocks at the right and top edges are ignored.
+ * The reduced buffer is locked whilst it is binned, rather than copied: the field/guide loop only writes
+ * into the other buffer of the pair, and binning reads the buffer once, and writes 1/(bin*bin) of it.
+ * @param buffer_type Which buffer to use, AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD or AUTOGUIDER_PREVIEW_BUFFER_TYPE_GUIDE.
+ * @param bin The binning factor.
+ * @param preview The preview, on return Binned_Data is allocated and filled in, and NCols/NRows are set.
+ * @param buffer_ncols The address of an integer, on return the number of columns in the reduced buffer.
+ * @param buffer_nrows The address of an integer, on return the number of rows in the reduced buffer.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_buffer.html#Autoguider_Buffer_Reduced_Field_Lock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Reduced_Field_Unlock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Reduced_Guide_Lock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Reduced_Guide_Unlock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Get_Field_Binned_NCols
+ * @see autoguider_buffer.html#Autoguider_Buffer_Get_Field_Binned_NRows
+ * @see autoguider_buffer.html#Autoguider_Buffer_Get_Guide_Binned_NCols
+ * @see autoguider_buffer.html#Autoguider_Buffer_Get_Guide_Binned_NRows
+ * @see autoguider_field.html#Autoguider_Field_Get_Last_Buffer_Index
+ * @see autoguider_guide.html#Autoguider_Guide_Get_Last_Buffer_Index
+ */
+static int Preview_Bin(int buffer_type,int bin,struct Preview_Struct *preview,int *buffer_ncols,int *buffer_nrows)
+{
+	float *buffer_data = NULL;
+	float scale;
+	int buffer_index,retval,x,y,bx,by;
+
+	if(buffer_type == AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD)
+	{
+		buffer_index = Autoguider_Field_Get_Last_Buffer_Index();
+		(*buffer_ncols) = Autoguider_Buffer_Get_Field_Binned_NCols();
+		(*buffer_nrows) = Autoguider_Buffer_Get_Field_Binned_NRows();
+	}
+	else
+	{
+		buffer_index = Autoguider_Guide_Get_Last_Buffer_Index();
+		(*buffer_ncols) = Autoguider_Buffer_Get_Guide_Binned_NCols();
+		(*buffer_nrows) = Autoguider_Buffer_Get_Guide_Binned_NRows();
+	}
+	if(buffer_index < 0)
+	{
+		Autoguider_General_Error_Number = 2206;
+		sprintf(Autoguider_General_Error_String,"Preview_Bin:buffer_index less than 0.");
+		return FALSE;
+	}
+	preview->NCols = (*buffer_ncols)/bin;
+	preview->NRows = (*buffer_nrows)/bin;
+	if((preview->NCols < 1)||(preview->NRows < 1))
+	{
+		Autoguider_General_Error_Number = 2207;
+		sprintf(Autoguider_General_Error_String,"Preview_Bin:Binning %d too large for buffer (%d,%d).",bin,
+			(*buffer_ncols),(*buffer_nrows));
+		return FALSE;
+	}
+	preview->Binned_Data = (float *)calloc(preview->NCols*preview->NRows,sizeof(float));
+	if(preview->Binned_Data == NULL)
+	{
+		Autoguider_General_Error_Number = 2208;
+		sprintf(Autoguider_General_Error_String,"Preview_Bin:Failed to allocate binned data (%d,%d).",
+			preview->NCols,preview->NRows);
+		return FALSE;
+	}
+	if(buffer_type == AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD)
+		retval = Autoguider_Buffer_Reduced_Field_Lock(buffer_index,&buffer_data);
+	else
+		retval = Autoguider_Buffer_Reduced_Guide_Lock(buffer_index,&buffer_data);
+	if(retval == FALSE)
+		return FALSE;
+	for(y = 0; y < preview->NRows*bin; y++)
+	{
+		by = y/bin;
+		for(x = 0; x < preview->NCols*bin; x++)
+		{
+			bx = x/bin;
+			preview->Binned_Data[(by*preview->NCols)+bx] += buffer_data[(y*(*buffer_ncols))+x];
+		}
+	}
+	if(buffer_type == AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD)
+		retval = Autoguider_Buffer_Reduced_Field_Unlock(buffer_index);
+	else
+		retval = Autoguider_Buffer_Reduced_Guide_Unlock(buffer_index);
+	if(retval == FALSE)
+		return FALSE;
+	if(bin > 1)
+	{
+		scale = 1.0f/((float)(bin*bin));
+		for(x = 0; x < preview->NCols*preview->NRows; x++)
+			preview->Binned_Data[x] *= scale;
+	}
+	return TRUE;
+}
+
+/**
+ * Work out the pixel values scaled to 0 and 255 in the preview. Up to PREVIEW_SAMPLE_COUNT binned pixels, evenly
+ * spaced through the binned image, are sorted. For AUTOGUIDER_PREVIEW_SCALE_PERCENTILE the scale runs between
+ * the PREVIEW_PERCENTILE_LOW and PREVIEW_PERCENTILE_HIGH samples, for AUTOGUIDER_PREVIEW_SCALE_ZSCALE
+ * Preview_Zscale is used.
+ * @param scale_type How to scale the image.
+ * @param preview The preview, with Binned_Data filled in. On return Low and High are set.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #PREVIEW_SAMPLE_COUNT
+ * @see #PREVIEW_PERCENTILE_LOW
+ * @see #PREVIEW_PERCENTILE_HIGH
+ * @see #Preview_Zscale
+ * @see #Preview_Sort_Float_List
+ */
+static int Preview_Scale_Get(int scale_type,struct Preview_Struct *preview)
+{
+	float *sample_list = NULL;
+	int i,pixel_count,sample_count,step;
+
+	pixel_count = preview->NCols*preview->NRows;
+	step = (pixel_count+PREVIEW_SAMPLE_COUNT-1)/PREVIEW_SAMPLE_COUNT;
+	if(step < 1)
+		step = 1;
+	sample_list = (float *)malloc(((pixel_count/step)+1)*sizeof(float));
+	if(sample_list == NULL)
+	{
+		Autoguider_General_Error_Number = 2209;
+		sprintf(Autoguider_General_Error_String,"Preview_Scale_Get:Failed to allocate sample list.");
+		return FALSE;
+	}
+	sample_count = 0;
+	for(i = 0; i < pixel_count; i += step)
+		sample_list[sample_count++] = preview->Binned_Data[i];
+	qsort(sample_list,sample_count,sizeof(float),Preview_Sort_Float_List);
+	if(scale_type == AUTOGUIDER_PREVIEW_SCALE_PERCENTILE)
+	{
+		preview->Low = sample_list[(int)(PREVIEW_PERCENTILE_LOW*(double)(sample_count-1))];
+		preview->High = sample_list[(int)(PREVIEW_PERCENTILE_HIGH*(double)(sample_count-1))];
+	}
+	else
+		Preview_Zscale(sample_list,sample_count,&(preview->Low),&(preview->High));
+	free(sample_list);
+	if(preview->High <= preview->Low)
+		preview->High = preview->Low+1.0f;
+	return TRUE;
+}
+
+/**
+ * The IRAF zscale algorithm. A straight line is fitted to the sorted samples, with iterative rejection of
+ * samples more than PREVIEW_ZSCALE_KREJ standard deviations from the line. The scale is centred on the median,
+ * and covers the range of the line with its slope divided by PREVIEW_ZSCALE_CONTRAST, limited to the
+ * range of the samples. If too few samples are left after rejection, the whole range of the samples is used.
+ * @param sample_list The samples, sorted into ascending order.
+ * @param sample_count The number of samples.
+ * @param low The address of a float, on return the pixel value scaled to 0.
+ * @param high The address of a float, on return the pixel value scaled to 255.
+ * @see #PREVIEW_ZSCALE_CONTRAST
+ * @see #PREVIEW_ZSCALE_KREJ
+ * @see #PREVIEW_ZSCALE_MAX_ITERATIONS
+ * @see #PREVIEW_ZSCALE_MIN_PIXELS
+ */
+static void Preview_Zscale(float *sample_list,int sample_count,float *low,float *high)
+{
+	double sum_x,sum_y,sum_xx,sum_xy,x,residual,sum_residual_sq,sigma,intercept,slope,median,x_scale,denominator;
+	int i,iteration,good_count,last_good_count,min_good_count,center;
+	char *reject_list = NULL;
+
+	(*low) = sample_list[0];
+	(*high) = sample_list[sample_count-1];
+	center = (sample_count+1)/2;
+	if((sample_count%2) == 1)
+		median = sample_list[center-1];
+	else
+		median = (sample_list[center-1]+sample_list[center])/2.0;
+	min_good_count = sample_count/2;
+	if(min_good_count < PREVIEW_ZSCALE_MIN_PIXELS)
+		min_good_count = PREVIEW_ZSCALE_MIN_PIXELS;
+	if(sample_count < min_good_count)
+		return;
+	reject_list = (char *)calloc(sample_count,sizeof(char));
+	if(reject_list == NULL)
+		return;
+	/* fit y = intercept + slope * x, with x normalised to -1..1 */
+	x_scale = 2.0/((double)(sample_count-1));
+	slope = 0.0;
+	intercept = median;
+	good_count = sample_count;
+	last_good_count = sample_count+1;
+	for(iteration = 0; (iteration < PREVIEW_ZSCALE_MAX_ITERATIONS)&&(good_count >= min_good_count)&&
+		    (good_count < last_good_count); iteration++)
+	{
+		sum_x = sum_y = sum_xx = sum_xy = 0.0;
+		for(i = 0; i < sample_count; i++)
+		{
+			if(reject_list[i])
+				continue;
+			x = (i*x_scale)-1.0;
+			sum_x += x;
+			sum_y += sample_list[i];
+			sum_xx += x*x;
+			sum_xy += x*sample_list[i];
+		}
+		denominator = (good_count*sum_xx)-(sum_x*sum_x);
+		if(denominator == 0.0)
+			break;
+		slope = ((good_count*sum_xy)-(sum_x*sum_y))/denominator;
+		intercept = (sum_y-(slope*sum_x))/good_count;
+		/* reject outliers */
+		sum_residual_sq = 0.0;
+		for(i = 0; i < sample_count; i++)
+		{
+			if(reject_list[i])
+				continue;
+			residual = sample_list[i]-(intercept+(slope*((i*x_scale)-1.0)));
+			sum_residual_sq += residual*residual;
+		}
+		sigma = sqrt(sum_residual_sq/good_count);
+		last_good_count = good_count;
+		for(i = 0; i < sample_count; i++)
+		{
+			if(reject_list[i])
+				continue;
+			residual = sample_list[i]-(intercept+(slope*((i*x_scale)-1.0)));
+			if(fabs(residual) > (PREVIEW_ZSCALE_KREJ*sigma))
+			{
+				reject_list[i] = TRUE;
+				good_count--;
+			}
+		}
+	}
+	free(reject_list);
+	if(good_count < min_good_count)
+		return;
+	/* slope per sample, increased by the contrast */
+	slope = (slope*x_scale)/PREVIEW_ZSCALE_CONTRAST;
+	if((median-((center-1)*slope)) > (*low))
+		(*low) = (float)(median-((center-1)*slope));
+	if((median+((sample_count-center)*slope)) < (*high))
+		(*high) = (float)(median+((sample_count-center)*slope));
+}
+
+/**
+ * Scale the binned data into the 8 bit image data. The rows are flipped, so the image is displayed
+ * the same way up as the FITS image (row 0 of the FITS image is the bottom row).
+ * @param preview The preview, with Binned_Data, Low and High set. On return Image_Data is filled in.
+ *        If Image_Data cannot be allocated, it is left NULL, and the image encoding routines fail.
+ */
+static void Preview_Image_Create(struct Preview_Struct *preview)
+{
+	float scale,value;
+	int x,y;
+
+	preview->Image_Data = (unsigned char *)malloc(preview->NCols*preview->NRows*sizeof(unsigned char));
+	if(preview->Image_Data == NULL)
+		return;
+	scale = 255.0f/(preview->High-preview->Low);
+	for(y = 0; y < preview->NRows; y++)
+	{
+		for(x = 0; x < preview->NCols; x++)
+		{
+			value = (preview->Binned_Data[(y*preview->NCols)+x]-preview->Low)*scale;
+			if(value < 0.0f)
+				value = 0.0f;
+			else if(value > 255.0f)
+				value = 255.0f;
+			preview->Image_Data[((preview->NRows-1-y)*preview->NCols)+x] = (unsigned char)(value+0.5f);
+		}
+	}
+}
+
+/**
+ * Add the detected objects to the preview text, and optionally overlay them on the image. The object list
+ * is only used if it was detected on a buffer of the same size as the one previewed (the object list
+ * is shared between field and guide object detection). Each object adds a text line of the form:
+ * "object &lt;index&gt; &lt;preview x&gt; &lt;preview y&gt; &lt;buffer x&gt; &lt;buffer y&gt;
+ * &lt;total counts&gt; &lt;fwhm x&gt; &lt;fwhm y&gt;", where the preview position is in image pixels from
+ * the top left.
+ * @param buffer_type Which buffer was previewed.
+ * @param bin The binning factor.
+ * @param overlay A boolean, if TRUE crosses are drawn over the objects.
+ * @param buffer_ncols The number of columns in the reduced buffer.
+ * @param buffer_nrows The number of rows in the reduced buffer.
+ * @param preview The preview.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Preview_Overlay_Set
+ * @see autoguider_object.html#Autoguider_Object_Get_Binned_NCols
+ * @see autoguider_object.html#Autoguider_Object_Get_Binned_NRows
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Count
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Object
+ */
+static int Preview_Objects(int buffer_type,int bin,int overlay,int buffer_ncols,int buffer_nrows,
+			   struct Preview_Struct *preview)
+{
+	struct Autoguider_Object_Struct object;
+	float preview_x,preview_y;
+	int i,j,count,x,y;
+
+	if((Autoguider_Object_Get_Binned_NCols() != buffer_ncols)||
+	   (Autoguider_Object_Get_Binned_NRows() != buffer_nrows))
+	{
+		return Autoguider_General_Reply_Add(&(preview->Text),"objects 0\n");
+	}
+	if(!Autoguider_Object_List_Get_Count(&count))
+		return FALSE;
+	if(!Autoguider_General_Reply_Add_Format(&(preview->Text),"objects %d\n",count))
+		return FALSE;
+	for(i = 0; i < count; i++)
+	{
+		/* the list may have been changed by a new detection since it was counted */
+		if(!Autoguider_Object_List_Get_Object(i,&object))
+			break;
+		/* pixel centres: buffer pixel 0 spans preview pixel -0.5..(1/bin)-0.5, and the rows are flipped */
+		preview_x = ((object.Buffer_X_Position+0.5f)/((float)bin))-0.5f;
+		preview_y = ((float)(preview->NRows-1))-(((object.Buffer_Y_Position+0.5f)/((float)bin))-0.5f);
+		if(!Autoguider_General_Reply_Add_Format(&(preview->Text),"object %d %.2f %.2f %.2f %.2f %.2f %.2f %.2f\n",
+							object.Index,preview_x,preview_y,object.Buffer_X_Position,
+							object.Buffer_Y_Position,object.Total_Counts,object.FWHM_X,
+							object.FWHM_Y))
+			return FALSE;
+		if(overlay && (preview->Image_Data != NULL))
+		{
+			x = (int)floor(preview_x+0.5f);
+			y = (int)floor(preview_y+0.5f);
+			for(j = PREVIEW_OVERLAY_GAP; j <= PREVIEW_OVERLAY_RADIUS; j++)
+			{
+				Preview_Overlay_Set(preview,x-j,y);
+				Preview_Overlay_Set(preview,x+j,y);
+				Preview_Overlay_Set(preview,x,y-j);
+				Preview_Overlay_Set(preview,x,y+j);
+			}
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Set an overlay pixel in the preview image to white, if it is on the image.
+ * @param preview The preview.
+ * @param x The column.
+ * @param y The row, from the top.
+ */
+static void Preview_Overlay_Set(struct Preview_Struct *preview,int x,int y)
+{
+	if((x < 0)||(x >= preview->NCols)||(y < 0)||(y >= preview->NRows))
+		return;
+	preview->Image_Data[(y*preview->NCols)+x] = 255;
+}
+
+/**
+ * Encode the preview as a binary PGM (P5) image. The preview text is added as comment lines in the header.
+ * @param preview The preview.
+ * @param buffer_ptr The address of a pointer, on return an allocated buffer containing the image.
+ * @param buffer_length The address of a word, on return the number of bytes in the image buffer.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ */
+static int Preview_PGM_Create(struct Preview_Struct *preview,void **buffer_ptr,size_t *buffer_length)
+{
+	struct Autoguider_General_Reply_Struct header;
+	char *line = NULL;
+	char *next_line = NULL;
+	unsigned char *buffer = NULL;
+	size_t image_length;
+
+	if(preview->Image_Data == NULL)
+	{
+		Autoguider_General_Error_Number = 2210;
+		sprintf(Autoguider_General_Error_String,"Preview_PGM_Create:Image data was not allocated.");
+		return FALSE;
+	}
+	Autoguider_General_Reply_Initialise(&header);
+	if(!Autoguider_General_Reply_Add(&header,"P5\n"))
+		return FALSE;
+	/* each line of text is a comment line */
+	line = preview->Text.String;
+	while((line != NULL)&&((*line) != '\0'))
+	{
+		next_line = strchr(line,'\n');
+		if(next_line != NULL)
+			(*next_line) = '\0';
+		if((!Autoguider_General_Reply_Add(&header,"# "))||(!Autoguider_General_Reply_Add(&header,line))||
+		   (!Autoguider_General_Reply_Add(&header,"\n")))
+		{
+			Autoguider_General_Reply_Free(&header);
+			return FALSE;
+		}
+		if(next_line != NULL)
+		{
+			(*next_line) = '\n';
+			line = next_line+1;
+		}
+		else
+			line = NULL;
+	}
+	if(!Autoguider_General_Reply_Add_Format(&header,"%d %d\n255\n",preview->NCols,preview->NRows))
+	{
+		Autoguider_General_Reply_Free(&header);
+		return FALSE;
+	}
+	image_length = preview->NCols*preview->NRows;
+	buffer = (unsigned char *)malloc(header.Length+image_length);
+	if(buffer == NULL)
+	{
+		Autoguider_General_Reply_Free(&header);
+		Autoguider_General_Error_Number = 2211;
+		sprintf(Autoguider_General_Error_String,"Preview_PGM_Create:Failed to allocate %ld bytes.",
+			(long)(header.Length+image_length));
+		return FALSE;
+	}
+	memcpy(buffer,header.String,header.Length);
+	memcpy(buffer+header.Length,preview->Image_Data,image_length);
+	(*buffer_ptr) = buffer;
+	(*buffer_length) = header.Length+image_length;
+	Autoguider_General_Reply_Free(&header);
+	return TRUE;
+}
+
+/**
+ * Encode the preview as an 8 bit greyscale PNG image. The preview text is put in a "Comment" tEXt chunk.
+ * The autoguider is not linked with zlib, so the image data is stored in uncompressed deflate blocks
+ * (the preview is already binned and 8 bit, so it is a quarter of the size of the equivalent float image
+ * before binning). Any PNG reader can read the result.
+ * @param preview The preview.
+ * @param buffer_ptr The address of a pointer, on return an allocated buffer containing the image.
+ * @param buffer_length The address of a word, on return the number of bytes in the image buffer.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #PREVIEW_DEFLATE_BLOCK_LENGTH
+ * @see #Preview_PNG_Chunk_Add
+ * @see #Preview_Put_Int_BE
+ */
+static int Preview_PNG_Create(struct Preview_Struct *preview,void **buffer_ptr,size_t *buffer_length)
+{
+	static unsigned char png_signature[8] = {137,80,78,71,13,10,26,10};
+	unsigned int crc_table[256];
+	unsigned char ihdr[13];
+	unsigned char *buffer = NULL;
+	unsigned char *text = NULL;
+	unsigned char *zlib_data = NULL;
+	unsigned char *ptr = NULL;
+	unsigned char *scanline_ptr = NULL;
+	unsigned int crc,adler_a,adler_b;
+	size_t scanline_length,raw_length,block_count,zlib_length,text_length,length,block_length,offset;
+	int i,j,y;
+
+	if(preview->Image_Data == NULL)
+	{
+		Autoguider_General_Error_Number = 2212;
+		sprintf(Autoguider_General_Error_String,"Preview_PNG_Create:Image data was not allocated.");
+		return FALSE;
+	}
+	/* CRC table, as in the PNG specification */
+	for(i = 0; i < 256; i++)
+	{
+		crc = (unsigned int)i;
+		for(j = 0; j < 8; j++)
+		{
+			if(crc & 1)
+				crc = 0xedb88320U^(crc >> 1);
+			else
+				crc = crc >> 1;
+		}
+		crc_table[i] = crc;
+	}
+	/* header */
+	Preview_Put_Int_BE(ihdr,(unsigned int)preview->NCols);
+	Preview_Put_Int_BE(ihdr+4,(unsigned int)preview->NRows);
+	ihdr[8] = 8;  /* bit depth */
+	ihdr[9] = 0;  /* greyscale */
+	ihdr[10] = 0; /* deflate */
+	ihdr[11] = 0; /* adaptive filtering */
+	ihdr[12] = 0; /* not interlaced */
+	/* text: "Comment" keyword, NULL separator, text */
+	text_length = strlen("Comment")+1+preview->Text.Length;
+	/* zlib stream of stored deflate blocks, each scanline preceeded by filter type 0 */
+	scanline_length = preview->NCols+1;
+	raw_length = scanline_length*preview->NRows;
+	block_count = (raw_length+PREVIEW_DEFLATE_BLOCK_LENGTH-1)/PREVIEW_DEFLATE_BLOCK_LENGTH;
+	zlib_length = 2+(block_count*5)+raw_length+4;
+	/* signature, IHDR, tEXt, IDAT, IEND: each chunk has length, type and CRC words */
+	length = 8+(12+13)+(12+text_length)+(12+zlib_length)+12;
+	buffer = (unsigned char *)malloc(length);
+	text = (unsigned char *)malloc(text_length);
+	zlib_data = (unsigned char *)malloc(zlib_length);
+	if((buffer == NULL)||(text == NULL)||(zlib_data == NULL))
+	{
+		if(buffer != NULL)
+			free(buffer);
+		if(text != NULL)
+			free(text);
+		if(zlib_data != NULL)
+			free(zlib_data);
+		Autoguider_General_Error_Number = 2213;
+		sprintf(Autoguider_General_Error_String,"Preview_PNG_Create:Failed to allocate %ld bytes.",(long)length);
+		return FALSE;
+	}
+	memcpy(text,"Comment",strlen("Comment")+1);
+	if(preview->Text.Length > 0)
+		memcpy(text+strlen("Comment")+1,preview->Text.String,preview->Text.Length);
+	/* zlib header: deflate, 32k window, no dictionary, fastest */
+	ptr = zlib_data;
+	(*ptr++) = 0x78;
+	(*ptr++) = 0x01;
+	adler_a = 1;
+	adler_b = 0;
+	offset = 0;
+	y = 0;
+	scanline_ptr = NULL;
+	while(offset < raw_length)
+	{
+		block_length = raw_length-offset;
+		if(block_length > PREVIEW_DEFLATE_BLOCK_LENGTH)
+			block_length = PREVIEW_DEFLATE_BLOCK_LENGTH;
+		(*ptr++) = ((offset+block_length) == raw_length) ? 1 : 0; /* BFINAL, BTYPE stored */
+		(*ptr++) = block_length & 0xff;
+		(*ptr++) = (block_length >> 8) & 0xff;
+		(*ptr++) = (~block_length) & 0xff;
+		(*ptr++) = ((~block_length) >> 8) & 0xff;
+		for(i = 0; i < (int)block_length; i++)
+		{
+			/* byte offset+i of the raw image data: filter byte at the start of each scanline */
+			if(((offset+i) % scanline_length) == 0)
+			{
+				y = (offset+i)/scanline_length;
+				scanline_ptr = preview->Image_Data+(y*preview->NCols);
+				(*ptr) = 0;
+			}
+			else
+				(*ptr) = scanline_ptr[((offset+i) % scanline_length)-1];
+			adler_a = (adler_a+(*ptr)) % 65521;
+			adler_b = (adler_b+adler_a) % 65521;
+			ptr++;
+		}
+		offset += block_length;
+	}
+	Preview_Put_Int_BE(ptr,(adler_b << 16)|adler_a);
+	/* assemble the PNG */
+	ptr = buffer;
+	memcpy(ptr,png_signature,8);
+	ptr += 8;
+	ptr = Preview_PNG_Chunk_Add(ptr,"IHDR",ihdr,13,crc_table);
+	ptr = Preview_PNG_Chunk_Add(ptr,"tEXt",text,text_length,crc_table);
+	ptr = Preview_PNG_Chunk_Add(ptr,"IDAT",zlib_data,zlib_length,crc_table);
+	ptr = Preview_PNG_Chunk_Add(ptr,"IEND",NULL,0,crc_table);
+	free(text);
+	free(zlib_data);
+	(*buffer_ptr) = buffer;
+	(*buffer_length) = length;
+	return TRUE;
+}
+
+/**
+ * Add a chunk to a PNG image: the data length, type, data and CRC of the type and data.
+ * @param ptr Where in the PNG image buffer to write the chunk.
+ * @param type The four character chunk type.
+ * @param data The chunk data, or NULL if data_length is 0.
+ * @param data_length The number of bytes of chunk data.
+ * @param crc_table The PNG CRC table.
+ * @return A pointer to the byte after the chunk in the PNG image buffer.
+ * @see #Preview_Put_Int_BE
+ */
+static unsigned char *Preview_PNG_Chunk_Add(unsigned char *ptr,char *type,unsigned char *data,size_t data_length,
+					    unsigned int *crc_table)
+{
+	unsigned char *crc_start_ptr = NULL;
+	unsigned int crc;
+
+	Preview_Put_Int_BE(ptr,(unsigned int)data_length);
+	ptr += 4;
+	crc_start_ptr = ptr;
+	memcpy(ptr,type,4);
+	ptr += 4;
+	if(data_length > 0)
+		memcpy(ptr,data,data_length);
+	ptr += data_length;
+	crc = 0xffffffffU;
+	while(crc_start_ptr < ptr)
+	{
+		crc = crc_table[(crc^(*crc_start_ptr)) & 0xff]^(crc >> 8);
+		crc_start_ptr++;
+	}
+	Preview_Put_Int_BE(ptr,crc^0xffffffffU);
+	return ptr+4;
+}
+
+/**
+ * Write a 32 bit word in network (big endian) byte order.
+ * @param ptr Where to write the word.
+ * @param value The value to write.
+ */
+static void Preview_Put_Int_BE(unsigned char *ptr,unsigned int value)
+{
+	ptr[0] = (value >> 24) & 0xff;
+	ptr[1] = (value >> 16) & 0xff;
+	ptr[2] = (value >> 8) & 0xff;
+	ptr[3] = value & 0xff;
+}
+
+/**
+ * Free the data allocated in a preview.
+ * @param preview The preview.
+ */
+static void Preview_Free(struct Preview_Struct *preview)
+{
+	if(preview->Binned_Data != NULL)
+		free(preview->Binned_Data);
+	preview->Binned_Data = NULL;
+	if(preview->Image_Data != NULL)
+		free(preview->Image_Data);
+	preview->Image_Data = NULL;
+	Autoguider_General_Reply_Free(&(preview->Text));
+}
+
+/**
+ * Routine to pass to qsort to sort a list of floats in ascending order.
+ * @param p1 A pointer to the first float.
+ * @param p2 A pointer to the second float.
+ * @return Less than zero, zero, or greater than zero if the first float is less than, equal to, or
+ *         greater than the second.
+ */
+static int Preview_Sort_Float_List(const void *p1,const void *p2)
+{
+	float f1,f2;
+
+	f1 = *(const float *)p1;
+	f2 = *(const float *)p2;
+	if(f1 < f2)
+		return -1;
+	if(f1 > f2)
+		return 1;
+	return 0;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
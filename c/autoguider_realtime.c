@@ -0,0 +1,413 @@
+/* autoguider_realtime.c
+** Autoguider real-time execution routines
+** $Header$
+*/
+/**
+ * Real-time execution routines for the autoguider program.
+ * When real-time mode is enabled (realtime.enable), the guide thread is created with the SCHED_FIFO
+ * scheduling policy at a configured priority. If a guide CPU is configured, the guide thread is pinned to it,
+ * and the rest of the process (and therefore every thread created after Autoguider_Realtime_Initialise, i.e. the
+ * command server, CIL, field, FITS writer and telemetry threads) is excluded from it. The process memory can
+ * also be locked with mlockall, and image buffers allocated through Autoguider_Realtime_Buffer_Allocate are
+ * cache line aligned and prefaulted, so the guide loop does not take page faults.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+/**
+ * This hash define is needed before including sched.h and pthread.h to give us the CPU affinity (CPU_SET,
+ * pthread_attr_setaffinity_np) prototypes.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+
+#include "autoguider_general.h"
+#include "autoguider_realtime.h"
+
+/* hash defines */
+/**
+ * The number of bytes of stack touched by Autoguider_Realtime_Thread_Prefault.
+ */
+#define REALTIME_STACK_PREFAULT_LENGTH        (64*1024)
+
+/* data types */
+/**
+ * Data type holding local data to autoguider_realtime. This consists of the following:
+ * <dl>
+ * <dt>Enable</dt> <dd>Boolean, whether real-time mode is enabled (realtime.enable).</dd>
+ * <dt>Guide_Priority</dt> <dd>The SCHED_FIFO priority of the guide thread (realtime.guide.priority).</dd>
+ * <dt>Guide_CPU</dt> <dd>The CPU the guide thread is pinned to, or -1 for no pinning (realtime.guide.cpu).</dd>
+ * <dt>Memory_Lock</dt> <dd>Boolean, whether to lock the process memory with mlockall (realtime.memory.lock).</dd>
+ * <dt>Is_Memory_Locked</dt> <dd>Boolean, whether mlockall succeeded.</dd>
+ * </dl>
+ */
+struct Realtime_Struct
+{
+	int Enable;
+	int Guide_Priority;
+	int Guide_CPU;
+	int Memory_Lock;
+	int Is_Memory_Locked;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of real-time data.
+ * @see #Realtime_Struct
+ */
+static struct Realtime_Struct Realtime_Data =
+{
+	FALSE,1,-1,FALSE,FALSE
+};
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Real-time initialisation routine. This should be called before any other threads are created, as the
+ * CPU affinity set here is inherited by them. Loads the following config:
+ * <ul>
+ * <li>"realtime.enable" - boolean.
+ * <li>"realtime.guide.priority" - integer, the SCHED_FIFO priority of the guide thread.
+ * <li>"realtime.guide.cpu" - integer, the CPU to pin the guide thread to, or -1.
+ * <li>"realtime.memory.lock" - boolean, whether to mlockall the process memory.
+ * </ul>
+ * The last three are only loaded if real-time mode is enabled. The guide CPU must be -1 or a valid CPU number.
+ * If a guide CPU is configured, the calling thread's affinity is set to all the available CPUs except the
+ * guide CPU. If memory locking is configured, mlockall(MCL_CURRENT) is called, locking the memory already
+ * mapped; buffers allocated later with Autoguider_Realtime_Buffer_Allocate are locked with mlock, other
+ * later allocations are not locked. Failing to set the affinity or lock memory (usually a missing
+ * privilege) is logged but not fatal.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Realtime_Data
+ * @see autoguider_general.html#Autoguider_General_Error
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Boolean
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ */
+int Autoguider_Realtime_Initialise(void)
+{
+	cpu_set_t cpu_set;
+	int retval,min_priority,max_priority;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("realtime","autoguider_realtime.c","Autoguider_Realtime_Initialise",
+			       LOG_VERBOSITY_TERSE,"REALTIME","started.");
+#endif
+	retval = CCD_Config_Get_Boolean("realtime.enable",&(Realtime_Data.Enable));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1800;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+			"Failed to load config:'realtime.enable'.");
+		return FALSE;
+	}
+	if(Realtime_Data.Enable == FALSE)
+	{
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("realtime","autoguider_realtime.c","Autoguider_Realtime_Initialise",
+				       LOG_VERBOSITY_TERSE,"REALTIME","finished:real-time mode disabled.");
+#endif
+		return TRUE;
+	}
+	retval = CCD_Config_Get_Integer("realtime.guide.priority",&(Realtime_Data.Guide_Priority));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1801;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+			"Failed to load config:'realtime.guide.priority'.");
+		return FALSE;
+	}
+	min_priority = sched_get_priority_min(SCHED_FIFO);
+	max_priority = sched_get_priority_max(SCHED_FIFO);
+	if((Realtime_Data.Guide_Priority < min_priority)||(Realtime_Data.Guide_Priority > max_priority))
+	{
+		Autoguider_General_Error_Number = 1802;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+			"Guide priority %d out of SCHED_FIFO range (%d,%d).",Realtime_Data.Guide_Priority,
+			min_priority,max_priority);
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("realtime.guide.cpu",&(Realtime_Data.Guide_CPU));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1803;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+			"Failed to load config:'realtime.guide.cpu'.");
+		return FALSE;
+	}
+	if((Realtime_Data.Guide_CPU < -1)||(Realtime_Data.Guide_CPU >= CPU_SETSIZE))
+	{
+		Autoguider_General_Error_Number = 1804;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+			"Guide CPU %d out of range.",Realtime_Data.Guide_CPU);
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Boolean("realtime.memory.lock",&(Realtime_Data.Memory_Lock));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1805;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+			"Failed to load config:'realtime.memory.lock'.");
+		return FALSE;
+	}
+	/* move everything but the guide thread off the guide CPU. Threads created later inherit this. */
+	if(Realtime_Data.Guide_CPU >= 0)
+	{
+		CPU_ZERO(&cpu_set);
+		if(sched_getaffinity(0,sizeof(cpu_set),&cpu_set) != 0)
+		{
+			Autoguider_General_Error_Number = 1806;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+				"Failed to get CPU affinity (%d).",errno);
+			Autoguider_General_Error("realtime","autoguider_realtime.c","Autoguider_Realtime_Initialise",
+						 LOG_VERBOSITY_TERSE,"REALTIME"); /* no need to fail */
+		}
+		else
+		{
+			CPU_CLR(Realtime_Data.Guide_CPU,&cpu_set);
+			if(CPU_COUNT(&cpu_set) == 0)
+			{
+				Autoguider_General_Error_Number = 1807;
+				sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+					"No CPUs left for housekeeping threads after reserving guide CPU %d.",
+					Realtime_Data.Guide_CPU);
+				Autoguider_General_Error("realtime","autoguider_realtime.c",
+							 "Autoguider_Realtime_Initialise",
+							 LOG_VERBOSITY_TERSE,"REALTIME"); /* no need to fail */
+			}
+			else if(sched_setaffinity(0,sizeof(cpu_set),&cpu_set) != 0)
+			{
+				Autoguider_General_Error_Number = 1808;
+				sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+					"Failed to exclude housekeeping threads from guide CPU %d (%d).",
+					Realtime_Data.Guide_CPU,errno);
+				Autoguider_General_Error("realtime","autoguider_realtime.c",
+							 "Autoguider_Realtime_Initialise",
+							 LOG_VERBOSITY_TERSE,"REALTIME"); /* no need to fail */
+			}
+		}
+	}
+	/* lock the current process memory. MCL_FUTURE is not used, as it would pin every later allocation
+	** (FITS writer queues, reply buffers, libraries' heaps); Autoguider_Realtime_Buffer_Allocate locks the
+	** image buffers individually instead. */
+	if(Realtime_Data.Memory_Lock)
+	{
+		if(mlockall(MCL_CURRENT) != 0)
+		{
+			Autoguider_General_Error_Number = 1809;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Initialise:"
+				"mlockall failed (%d).",errno);
+			Autoguider_General_Error("realtime","autoguider_realtime.c","Autoguider_Realtime_Initialise",
+						 LOG_VERBOSITY_TERSE,"REALTIME"); /* no need to fail */
+		}
+		else
+			Realtime_Data.Is_Memory_Locked = TRUE;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("realtime","autoguider_realtime.c","Autoguider_Realtime_Initialise",
+				      LOG_VERBOSITY_TERSE,"REALTIME",
+				      "finished:guide priority = %d, guide cpu = %d, memory locked = %d.",
+				      Realtime_Data.Guide_Priority,Realtime_Data.Guide_CPU,
+				      Realtime_Data.Is_Memory_Locked);
+#endif
+	return TRUE;
+}
+
+/**
+ * Return whether real-time mode is enabled.
+ * @return TRUE if real-time mode is enabled, FALSE if it is not.
+ * @see #Realtime_Data
+ */
+int Autoguider_Realtime_Is_Enabled(void)
+{
+	return Realtime_Data.Enable;
+}
+
+/**
+ * Set the scheduling attributes of the guide thread. If real-time mode is disabled this does nothing.
+ * Otherwise the attributes are set to use an explicit SCHED_FIFO policy at the configured guide priority,
+ * and if a guide CPU is configured, an affinity of just that CPU.
+ * @param attr The address of an initialised thread attribute structure to modify.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Realtime_Data
+ */
+int Autoguider_Realtime_Guide_Thread_Attr_Set(pthread_attr_t *attr)
+{
+	struct sched_param param;
+	cpu_set_t cpu_set;
+	int retval;
+
+	if(attr == NULL)
+	{
+		Autoguider_General_Error_Number = 1810;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Guide_Thread_Attr_Set:attr was NULL.");
+		return FALSE;
+	}
+	if(Realtime_Data.Enable == FALSE)
+		return TRUE;
+	retval = pthread_attr_setinheritsched(attr,PTHREAD_EXPLICIT_SCHED);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 1811;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Guide_Thread_Attr_Set:"
+			"pthread_attr_setinheritsched failed (%d).",retval);
+		return FALSE;
+	}
+	retval = pthread_attr_setschedpolicy(attr,SCHED_FIFO);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 1812;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Guide_Thread_Attr_Set:"
+			"pthread_attr_setschedpolicy failed (%d).",retval);
+		return FALSE;
+	}
+	param.sched_priority = Realtime_Data.Guide_Priority;
+	retval = pthread_attr_setschedparam(attr,&param);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 1813;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Guide_Thread_Attr_Set:"
+			"pthread_attr_setschedparam(%d) failed (%d).",Realtime_Data.Guide_Priority,retval);
+		return FALSE;
+	}
+	if(Realtime_Data.Guide_CPU >= 0)
+	{
+		CPU_ZERO(&cpu_set);
+		CPU_SET(Realtime_Data.Guide_CPU,&cpu_set);
+		retval = pthread_attr_setaffinity_np(attr,sizeof(cpu_set),&cpu_set);
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1814;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Guide_Thread_Attr_Set:"
+				"pthread_attr_setaffinity_np(%d) failed (%d).",Realtime_Data.Guide_CPU,retval);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Prefault the calling thread's stack, by touching REALTIME_STACK_PREFAULT_LENGTH bytes of it.
+ * This should be called at the start of a real-time thread, so the loop itself does not take stack page faults.
+ * If real-time mode is disabled this does nothing.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Realtime_Data
+ * @see #REALTIME_STACK_PREFAULT_LENGTH
+ */
+int Autoguider_Realtime_Thread_Prefault(void)
+{
+	volatile unsigned char stack_buff[REALTIME_STACK_PREFAULT_LENGTH];
+	volatile unsigned int sink;
+	int i;
+
+	if(Realtime_Data.Enable == FALSE)
+		return TRUE;
+	for(i = 0; i < REALTIME_STACK_PREFAULT_LENGTH; i += 256)
+		stack_buff[i] = 0;
+	/* read the touched bytes back, so the writes are not optimised away */
+	sink = 0;
+	for(i = 0; i < REALTIME_STACK_PREFAULT_LENGTH; i += 256)
+		sink += stack_buff[i];
+	return TRUE;
+}
+
+/**
+ * (Re)allocate an image buffer. Any existing buffer is freed, as the callers always overwrite the contents.
+ * The new buffer is aligned to AUTOGUIDER_REALTIME_CACHE_LINE_LENGTH. If real-time mode is enabled, the buffer
+ * is also zeroed, so every page is faulted in now rather than on first use, and if the process memory was
+ * locked by Autoguider_Realtime_Initialise, the buffer is locked with mlock. Failing to lock the buffer is
+ * logged but not fatal.
+ * The buffer should be freed with free().
+ * @param buffer_ptr The address of a buffer pointer. On entry, either NULL or a buffer to free.
+ *        On a successful return, the new buffer. On failure, NULL.
+ * @param length The length of the buffer in bytes.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Realtime_Data
+ * @see #AUTOGUIDER_REALTIME_CACHE_LINE_LENGTH
+ */
+int Autoguider_Realtime_Buffer_Allocate(void **buffer_ptr,size_t length)
+{
+	void *buffer = NULL;
+	int retval;
+
+	if(buffer_ptr == NULL)
+	{
+		Autoguider_General_Error_Number = 1815;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Buffer_Allocate:buffer_ptr was NULL.");
+		return FALSE;
+	}
+	if((*buffer_ptr) != NULL)
+		free((*buffer_ptr));
+	(*buffer_ptr) = NULL;
+	retval = posix_memalign(&buffer,AUTOGUIDER_REALTIME_CACHE_LINE_LENGTH,length);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 1816;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Buffer_Allocate:"
+			"Failed to allocate %lu bytes (%d).",(unsigned long)length,retval);
+		return FALSE;
+	}
+	if(Realtime_Data.Enable)
+		memset(buffer,0,length);
+	if(Realtime_Data.Is_Memory_Locked)
+	{
+		if(mlock(buffer,length) != 0)
+		{
+			Autoguider_General_Error_Number = 1818;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Buffer_Allocate:"
+				"mlock of %lu bytes failed (%d).",(unsigned long)length,errno);
+			Autoguider_General_Error("realtime","autoguider_realtime.c","Autoguider_Realtime_Buffer_Allocate",
+						 LOG_VERBOSITY_TERSE,"REALTIME"); /* no need to fail */
+		}
+	}
+	(*buffer_ptr) = buffer;
+	return TRUE;
+}
+
+/**
+ * Real-time shutdown routine. Unlocks the process memory if it was locked.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Realtime_Data
+ */
+int Autoguider_Realtime_Shutdown(void)
+{
+	if(Realtime_Data.Is_Memory_Locked)
+	{
+		if(munlockall() != 0)
+		{
+			Autoguider_General_Error_Number = 1817;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Realtime_Shutdown:"
+				"munlockall failed (%d).",errno);
+			return FALSE;
+		}
+		Realtime_Data.Is_Memory_Locked = FALSE;
+	}
+	return TRUE;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
@@ -51,7 +51,9 @@ static unsigned short Command_Server_Port_Number = 1234;
 /* internal functions */
 static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connection_handle);
 static int Send_Reply(Command_Server_Handle_T connection_handle,char *reply_message);
-static int Send_Binary_Reply(Command_Server_Handle_T connection_handle,void *buffer_ptr,size_t buffer_length);
+static int Send_Reply_Buffer(Command_Server_Handle_T connection_handle,struct Autoguider_General_Reply_Struct *reply);
+static int Send_Binary_Reply(Command_Server_Handle_T connection_handle,void *buffer_ptr,size_t buffer_length,
+			     int compress_element_size);
 static int Send_Binary_Reply_Error(Command_Server_Handle_T connection_handle);
 
 /* ----------------------------------------------------------------------------
@@ -173,10 +175,13 @@ int Autoguider_Server_Stop(void)
  * <li><b>abort</b> Autoguider_Command_Abort
  * <li><b>autoguide</b> Autoguider_Command_Autoguide
  * <li><b>agstate</b> Autoguider_Command_Agstate
+ * <li><b>calibrate</b> Autoguider_Command_Calibrate
+ * <li><b>ccd</b> Autoguider_Command_CCD
  * <li><b>configload</b> Autoguider_Command_Config_Load
  * <li><b>expose</b> Autoguider_Command_Expose
  * <li><b>field</b> Autoguider_Command_Field
  * <li><b>getfits</b> Autoguider_Command_Get_Fits
+ * <li><b>getpreview</b> Autoguider_Command_Get_Preview
  * <li><b>guide</b> Autoguider_Command_Guide
  * <li><b>log_level</b> Autoguider_Command_Log_Level
  * <li><b>object</b> Autoguider_Command_Object
@@ -188,18 +193,23 @@ int Autoguider_Server_Stop(void)
  * <li><b>help</b> Returns a help message describing the commandset.
  * <li><b>shutdown</b> Calls Autoguider_Server_Stop to stop the command server (and eventually the whole autoguider process).
  * </ul>
+ * The reply buffer is allocated per connection, and freed when the connection has been dealt with.
  * @param connection_handle Connection handle for this thread.
  * @see #Send_Reply
+ * @see #Send_Reply_Buffer
  * @see #Send_Binary_Reply
  * @see #Send_Binary_Reply_Error
  * @see #Autoguider_Server_Stop
  * @see autoguider_command.html#Autoguider_Command_Abort
  * @see autoguider_command.html#Autoguider_Command_Autoguide
  * @see autoguider_command.html#Autoguider_Command_Agstate
+ * @see autoguider_command.html#Autoguider_Command_Calibrate
+ * @see autoguider_command.html#Autoguider_Command_CCD
  * @see autoguider_command.html#Autoguider_Command_Config_Load
  * @see autoguider_command.html#Autoguider_Command_Expose
  * @see autoguider_command.html#Autoguider_Command_Field
  * @see autoguider_command.html#Autoguider_Command_Get_Fits
+ * @see autoguider_command.html#Autoguider_Command_Get_Preview
  * @see autoguider_command.html#Autoguider_Command_Guide
  * @see autoguider_command.html#Autoguider_Command_Log_Level
  * @see autoguider_command.html#Autoguider_Command_Object
@@ -214,11 +224,13 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 {
 	void *buffer_ptr = NULL;
 	size_t buffer_length = 0;
-	char *reply_string = NULL;
+	struct Autoguider_General_Reply_Struct reply;
 	char *client_message = NULL;
-	int retval;
+	int retval,compress_element_size;
 	int seconds,i;
 
+	/* the reply buffer for this connection, filled in by the command routines */
+	Autoguider_General_Reply_Initialise(&reply);
 	/* get message from client */
 	retval = Command_Server_Read_Message(connection_handle, &client_message);
 	if(retval == FALSE)
@@ -241,12 +253,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 				       LOG_VERBOSITY_VERY_TERSE,"SERVER","abort detected.");
 #endif
-		retval = Autoguider_Command_Abort(client_message,&reply_string);
+		retval = Autoguider_Command_Abort(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -274,12 +284,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 				       LOG_VERBOSITY_VERY_TERSE,"SERVER","autoguide detected.");
 #endif
-		retval = Autoguider_Command_Autoguide(client_message,&reply_string);
+		retval = Autoguider_Command_Autoguide(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -307,12 +315,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 				       LOG_VERBOSITY_VERY_TERSE,"SERVER","agstate detected.");
 #endif
-		retval = Autoguider_Command_Agstate(client_message,&reply_string);
+		retval = Autoguider_Command_Agstate(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -334,18 +340,78 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 			}
 		}
 	}
+	else if(strncmp(client_message,"calibrate",9) == 0)
+	{
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
+				       LOG_VERBOSITY_VERY_TERSE,"SERVER","calibrate detected.");
+#endif
+		retval = Autoguider_Command_Calibrate(client_message,&reply);
+		if(retval == TRUE)
+		{
+			retval = Send_Reply_Buffer(connection_handle,&reply);
+			if(retval == FALSE)
+			{
+				Autoguider_General_Error("server","autoguider_server.c",
+							 "Autoguider_Server_Connection_Callback",
+							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			}
+		}
+		else
+		{
+			Autoguider_General_Error("server","autoguider_server.c",
+						 "Autoguider_Server_Connection_Callback",
+						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			retval = Send_Reply(connection_handle, "1 Autoguider_Command_Calibrate failed.");
+			if(retval == FALSE)
+			{
+				Autoguider_General_Error("server","autoguider_server.c",
+							 "Autoguider_Server_Connection_Callback",
+							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			}
+		}
+	}
+	else if(strncmp(client_message,"ccd",3) == 0)
+	{
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
+				       LOG_VERBOSITY_VERY_TERSE,"SERVER","ccd detected.");
+#endif
+		retval = Autoguider_Command_CCD(client_message,&reply);
+		if(retval == TRUE)
+		{
+			retval = Send_Reply_Buffer(connection_handle,&reply);
+			if(retval == FALSE)
+			{
+				Autoguider_General_Error("server","autoguider_server.c",
+							 "Autoguider_Server_Connection_Callback",
+							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			}
+		}
+		else
+		{
+			Autoguider_General_Error("server","autoguider_server.c",
+						 "Autoguider_Server_Connection_Callback",
+						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			retval = Send_Reply(connection_handle, "1 Autoguider_Command_CCD failed.");
+			if(retval == FALSE)
+			{
+				Autoguider_General_Error("server","autoguider_server.c",
+							 "Autoguider_Server_Connection_Callback",
+							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			}
+		}
+	}
 	else if(strncmp(client_message,"configload",10) == 0)
 	{
 #if AUTOGUIDER_DEBUG > 1
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 				       LOG_VERBOSITY_VERY_TERSE,"SERVER","configload detected.");
 #endif
-		retval = Autoguider_Command_Config_Load(client_message,&reply_string);
+		retval = Autoguider_Command_Config_Load(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -373,12 +439,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 				       LOG_VERBOSITY_VERY_TERSE,"SERVER","expose detected.");
 #endif
-		retval = Autoguider_Command_Expose(client_message,&reply_string);
+		retval = Autoguider_Command_Expose(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -406,12 +470,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 				       LOG_VERBOSITY_VERY_TERSE,"SERVER","field detected.");
 #endif
-		retval = Autoguider_Command_Field(client_message,&reply_string);
+		retval = Autoguider_Command_Field(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -439,10 +501,40 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 				       LOG_VERBOSITY_VERY_TERSE,"SERVER","getfits detected.");
 #endif
-		retval = Autoguider_Command_Get_Fits(client_message,&buffer_ptr,&buffer_length);
+		retval = Autoguider_Command_Get_Fits(client_message,&buffer_ptr,&buffer_length,&compress_element_size);
+		if(retval == TRUE)
+		{
+			retval = Send_Binary_Reply(connection_handle,buffer_ptr,buffer_length,compress_element_size);
+			if(buffer_ptr != NULL)
+				free(buffer_ptr);
+			if(retval == FALSE)
+			{
+				Autoguider_General_Error("server","autoguider_server.c",
+							 "Autoguider_Server_Connection_Callback",
+							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			}
+		}
+		else
+		{
+			retval = Send_Binary_Reply_Error(connection_handle);
+			if(retval == FALSE)
+			{
+				Autoguider_General_Error("server","autoguider_server.c",
+							 "Autoguider_Server_Connection_Callback",
+							 LOG_VERBOSITY_VERY_TERSE,"SERVER");
+			}
+		}
+	}
+	else if(strncmp(client_message,"getpreview",10) == 0)
+	{
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
+				       LOG_VERBOSITY_VERY_TERSE,"SERVER","getpreview detected.");
+#endif
+		retval = Autoguider_Command_Get_Preview(client_message,&buffer_ptr,&buffer_length);
 		if(retval == TRUE)
 		{
-			retval = Send_Binary_Reply(connection_handle,buffer_ptr,buffer_length);
+			retval = Send_Binary_Reply(connection_handle,buffer_ptr,buffer_length,0);
 			if(buffer_ptr != NULL)
 				free(buffer_ptr);
 			if(retval == FALSE)
@@ -469,12 +561,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 							 LOG_VERBOSITY_VERY_TERSE,"SERVER","guide detected.");
 #endif
-		retval = Autoguider_Command_Guide(client_message,&reply_string);
+		retval = Autoguider_Command_Guide(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -502,12 +592,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 							 LOG_VERBOSITY_VERY_TERSE,"SERVER","log_level detected.");
 #endif
-		retval = Autoguider_Command_Log_Level(client_message,&reply_string);
+		retval = Autoguider_Command_Log_Level(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -535,12 +623,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 							 LOG_VERBOSITY_VERY_TERSE,"SERVER","object detected.");
 #endif
-		retval = Autoguider_Command_Object(client_message,&reply_string);
+		retval = Autoguider_Command_Object(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -573,11 +659,14 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 			   "\tagstate <n>\n"
 			   "\tautoguide on <brightest|pixel <x> <y>|rank <n>>\n"
 			   "\tautoguide off\n"
+			   "\tcalibrate <dark|flat> <bin> <ms> <count> [<filename>]\n"
+			   "\tccd trace [on|off|clear|dump|save <filename>]\n"
 			   "\tconfigload\n"
 			   "\texpose <ms>\n"
 			   "\tfield [<ms> [lock]]\n"
 			   "\tfield <dark|flat|object> <on|off>\n"
-			   "\tgetfits [field|guide|object] [raw|reduced]\n"
+			   "\tgetfits [field|guide|object] [raw|reduced] [compress=rice|none]\n"
+			   "\tgetpreview [field|guide] [bin <n>] [png|pgm] [zscale|percentile] [overlay]\n"
 			   "\tguide [on|off]\n"
 			   "\tguide window <sx> <sy> <ex> <ey>\n"
 			   "\tguide window <cx> <cy>\n"
@@ -592,9 +681,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 			   "\tstatus field <active|dark|flat|object>\n"
 			   "\tstatus guide <active|dark|flat|object|packet>\n"
 			   "\tstatus guide <cadence|timecode_scaling|exposure_length|window>\n"
-			   "\tstatus guide <last_object|initial_position>\n"
+			   "\tstatus guide <last_object|initial_position|packet_latency>\n"
 			   "\tstatus object <list|count|median|mean|background_standard_deviation|threshold>\n"
 			   "\tstatus object <sigma|sigma_reject|ellipticity_limit|min_con_pix>\n"
+			   "\tstatus memory heap\n"
 			   "\ttemperature [set <C>|cooler [on|off]]\n"
 			   "\tshutdown\n");
 	}
@@ -604,12 +694,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 	Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 			       LOG_VERBOSITY_VERY_TERSE,"SERVER","status detected.");
 #endif
-		retval = Autoguider_Command_Status(client_message,&reply_string);
+		retval = Autoguider_Command_Status(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -637,12 +725,10 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 		Autoguider_General_Log("server","autoguider_server.c","Autoguider_Server_Connection_Callback",
 				       LOG_VERBOSITY_VERY_TERSE,"SERVER","temperature detected.");
 #endif
-		retval = Autoguider_Command_Temperature(client_message,&reply_string);
+		retval = Autoguider_Command_Temperature(client_message,&reply);
 		if(retval == TRUE)
 		{
-			retval = Send_Reply(connection_handle,reply_string);
-			if(reply_string != NULL)
-				free(reply_string);
+			retval = Send_Reply_Buffer(connection_handle,&reply);
 			if(retval == FALSE)
 			{
 				Autoguider_General_Error("server","autoguider_server.c",
@@ -698,8 +784,9 @@ static void Autoguider_Server_Connection_Callback(Command_Server_Handle_T connec
 						 LOG_VERBOSITY_VERY_TERSE,"SERVER");
 		}
 	}
-	/* free message */
+	/* free message and reply */
 	free(client_message);
+	Autoguider_General_Reply_Free(&reply);
 }
 
 /**
@@ -736,18 +823,56 @@ static int Send_Reply(Command_Server_Handle_T connection_handle,char *reply_mess
 	return TRUE;
 }
 
+/**
+ * Send the contents of a reply buffer back to the client. The reply's known length is passed to
+ * Command_Server_Write_Message_Length, so the reply is sent without being copied or re-measured.
+ * @param connection_handle Globus_io connection handle for this thread.
+ * @param reply The address of the reply buffer containing the reply to send.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_general.html#Autoguider_General_Reply_Struct
+ * @see autoguider_general.html#Autoguider_General_Error_Number
+ * @see autoguider_general.html#Autoguider_General_Error_String
+ * @see autoguider_general.html#Autoguider_General_Log_Format
+ * @see ../command_server/cdocs/command_server.html#Command_Server_Write_Message_Length
+ */
+static int Send_Reply_Buffer(Command_Server_Handle_T connection_handle,struct Autoguider_General_Reply_Struct *reply)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("server","autoguider_server.c","Send_Reply_Buffer",LOG_VERBOSITY_TERSE,"SERVER",
+				      "about to send '%.80s'... (%ld bytes).",reply->String,reply->Length);
+#endif
+	retval = Command_Server_Write_Message_Length(connection_handle,reply->String,reply->Length);
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 207;
+		sprintf(Autoguider_General_Error_String,"Send_Reply_Buffer:"
+			"Writing message of length %ld to connection failed.",reply->Length);
+		return FALSE;
+	}
+#if AUTOGUIDER_DEBUG > 5
+	Autoguider_General_Log_Format("server","autoguider_server.c","Send_Reply_Buffer",LOG_VERBOSITY_TERSE,"SERVER",
+				      "sent %ld bytes.",reply->Length);
+#endif
+	return TRUE;
+}
+
 /**
  * Send a binary message back to the client.
  * @param connection_handle Globus_io connection handle for this thread.
  * @param buffer_ptr A pointer to the binary data to send.
  * @param buffer_length The number of bytes in the binary buffer.
+ * @param compress_element_size The size in bytes of the integer samples to Rice compress the buffer as,
+ *        or 0 to send it uncompressed.
  * @return The routine returns TRUE on success and FALSE on failure.
  * @see autoguider_general.html#Autoguider_General_Error_Number
  * @see autoguider_general.html#Autoguider_General_Error_String
  * @see autoguider_general.html#Autoguider_General_Log_Format
- * @see ../command_server/cdocs/command_server.html#Command_Server_Write_Binary_Message
+ * @see ../command_server/cdocs/command_server.html#Command_Server_Write_Binary_Message_Compressed
  */
-static int Send_Binary_Reply(Command_Server_Handle_T connection_handle,void *buffer_ptr,size_t buffer_length)
+static int Send_Binary_Reply(Command_Server_Handle_T connection_handle,void *buffer_ptr,size_t buffer_length,
+			     int compress_element_size)
 {
 	int retval;
 
@@ -756,7 +881,8 @@ static int Send_Binary_Reply(Command_Server_Handle_T connection_handle,void *buf
 				      LOG_VERBOSITY_INTERMEDIATE,"SERVER",
 				      "about to send %ld bytes.",buffer_length);
 #endif
-	retval = Command_Server_Write_Binary_Message(connection_handle,buffer_ptr,buffer_length);
+	retval = Command_Server_Write_Binary_Message_Compressed(connection_handle,buffer_ptr,buffer_length,
+								compress_element_size);
 	if(retval == FALSE)
 	{
 		Autoguider_General_Error_Number = 206;
@@ -0,0 +1,531 @@
+/* autoguider_telemetry.c
+** Autoguider binary telemetry log routines
+** $Header$
+*/
+/**
+ * Binary telemetry log routines for the autoguider program.
+ * Fixed size records describing each guide frame (centroid, counts, FWHM, loop cadence, exposure length and
+ * TCS guide packet status) and each detected object are copied into a bounded in-memory queue, and appended
+ * to a binary telemetry file by a separate telemetry thread. If the queue is full, the record is dropped
+ * rather than stalling the caller. A new telemetry file is started each UTC day. Each file consists of an
+ * Autoguider_Telemetry_File_Header_Struct followed by Autoguider_Telemetry_Record_Struct records, so it
+ * can be mmap'ed and read directly by analysis tools.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+
+#include "autoguider_general.h"
+#include "autoguider_telemetry.h"
+
+/* hash defines */
+/**
+ * The length of the telemetry filename.
+ */
+#define TELEMETRY_FILENAME_LENGTH          (256)
+
+/* data types */
+/**
+ * Structure holding telemetry log data.
+ * <dl>
+ * <dt>Mutex</dt> <dd>Mutex protecting the queue and statistics.</dd>
+ * <dt>Condition</dt> <dd>Condition variable signalled when a record is queued, or the thread is told to quit.</dd>
+ * <dt>Thread</dt> <dd>The telemetry thread.</dd>
+ * <dt>Enable</dt> <dd>Boolean, whether the telemetry log is enabled (telemetry.enable).</dd>
+ * <dt>Directory</dt> <dd>The directory to write telemetry files into (telemetry.directory).</dd>
+ * <dt>Queue</dt> <dd>An allocated ring of Queue_Length records.</dd>
+ * <dt>Queue_Length</dt> <dd>The number of records in the queue (telemetry.queue_length).</dd>
+ * <dt>Queue_Head</dt> <dd>The index of the oldest queued record.</dd>
+ * <dt>Queue_Count</dt> <dd>The number of queued records.</dd>
+ * <dt>Quit</dt> <dd>Boolean, set to tell the telemetry thread to write the queued records and quit.</dd>
+ * <dt>Is_Running</dt> <dd>Boolean, TRUE whilst the telemetry thread is running.</dd>
+ * <dt>Written_Count</dt> <dd>The number of records written to disk.</dd>
+ * <dt>Dropped_Count</dt> <dd>The number of records dropped because the queue was full, or the write failed.</dd>
+ * <dt>Fp</dt> <dd>The currently open telemetry file, or NULL.</dd>
+ * <dt>Filename</dt> <dd>The name of the currently open file.</dd>
+ * <dt>File_Year_Day</dt> <dd>The UTC day of the year the currently open file was opened on.</dd>
+ * </dl>
+ */
+struct Telemetry_Struct
+{
+	pthread_mutex_t Mutex;
+	pthread_cond_t Condition;
+	pthread_t Thread;
+	int Enable;
+	char *Directory;
+	struct Autoguider_Telemetry_Record_Struct *Queue;
+	int Queue_Length;
+	int Queue_Head;
+	int Queue_Count;
+	int Quit;
+	int Is_Running;
+	int Written_Count;
+	int Dropped_Count;
+	FILE *Fp;
+	char Filename[TELEMETRY_FILENAME_LENGTH];
+	int File_Year_Day;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of telemetry log data. The mutex and condition variable are statically initialised, and
+ * the telemetry log is disabled until Autoguider_Telemetry_Initialise has loaded the config.
+ * @see #Telemetry_Struct
+ */
+static struct Telemetry_Struct Telemetry_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER
+};
+
+/* internal functions */
+static void *Telemetry_Thread(void *arg);
+static int Telemetry_File_Open(struct tm *time_tm);
+static int Telemetry_File_Close(void);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Initialise the telemetry log. Loads the following config:
+ * <ul>
+ * <li>"telemetry.enable" - boolean.
+ * <li>"telemetry.directory" - string.
+ * <li>"telemetry.queue_length" - integer, number of records.
+ * </ul>
+ * If the telemetry log is enabled, the queue is allocated and the telemetry thread started.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Telemetry_Data
+ * @see #Telemetry_Thread
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Boolean
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
+ */
+int Autoguider_Telemetry_Initialise(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("telemetry","autoguider_telemetry.c","Autoguider_Telemetry_Initialise",
+			       LOG_VERBOSITY_TERSE,"TELEMETRY","started.");
+#endif
+	retval = CCD_Config_Get_Boolean("telemetry.enable",&(Telemetry_Data.Enable));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1500;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Initialise:"
+			"Failed to load config:'telemetry.enable'.");
+		return FALSE;
+	}
+	if(Telemetry_Data.Enable == FALSE)
+	{
+#if AUTOGUIDER_DEBUG > 1
+		Autoguider_General_Log("telemetry","autoguider_telemetry.c","Autoguider_Telemetry_Initialise",
+				       LOG_VERBOSITY_TERSE,"TELEMETRY","Telemetry log disabled:finished.");
+#endif
+		return TRUE;
+	}
+	retval = CCD_Config_Get_String("telemetry.directory",&(Telemetry_Data.Directory));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1501;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Initialise:"
+			"Failed to load config:'telemetry.directory'.");
+		return FALSE;
+	}
+	retval = CCD_Config_Get_Integer("telemetry.queue_length",&(Telemetry_Data.Queue_Length));
+	if(retval == FALSE)
+	{
+		Autoguider_General_Error_Number = 1502;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Initialise:"
+			"Failed to load config:'telemetry.queue_length'.");
+		return FALSE;
+	}
+	if(Telemetry_Data.Queue_Length < 1)
+	{
+		Autoguider_General_Error_Number = 1503;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Initialise:"
+			"Illegal telemetry.queue_length %d.",Telemetry_Data.Queue_Length);
+		return FALSE;
+	}
+	Telemetry_Data.Queue = (struct Autoguider_Telemetry_Record_Struct *)calloc(Telemetry_Data.Queue_Length,
+								sizeof(struct Autoguider_Telemetry_Record_Struct));
+	if(Telemetry_Data.Queue == NULL)
+	{
+		Autoguider_General_Error_Number = 1504;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Initialise:"
+			"Failed to allocate queue of length %d.",Telemetry_Data.Queue_Length);
+		return FALSE;
+	}
+	Telemetry_Data.Queue_Head = 0;
+	Telemetry_Data.Queue_Count = 0;
+	Telemetry_Data.Quit = FALSE;
+	Telemetry_Data.Written_Count = 0;
+	Telemetry_Data.Dropped_Count = 0;
+	Telemetry_Data.Fp = NULL;
+	Telemetry_Data.File_Year_Day = -1;
+	retval = pthread_create(&(Telemetry_Data.Thread),NULL,&Telemetry_Thread,(void *)NULL);
+	if(retval != 0)
+	{
+		Autoguider_General_Error_Number = 1505;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Initialise:"
+			"Failed to create telemetry thread (%d).",retval);
+		return FALSE;
+	}
+	Telemetry_Data.Is_Running = TRUE;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("telemetry","autoguider_telemetry.c","Autoguider_Telemetry_Initialise",
+				      LOG_VERBOSITY_TERSE,"TELEMETRY","Writing telemetry to '%s' "
+				      "(queue length %d):finished.",Telemetry_Data.Directory,
+				      Telemetry_Data.Queue_Length);
+#endif
+	return TRUE;
+}
+
+/**
+ * Return whether the telemetry log is enabled, and the telemetry thread is running.
+ * Callers use this to avoid filling in records that will not be written.
+ * @return TRUE if records should be passed to Autoguider_Telemetry_Record_Add, FALSE otherwise.
+ * @see #Telemetry_Data
+ */
+int Autoguider_Telemetry_Is_Enabled(void)
+{
+	return (Telemetry_Data.Enable && Telemetry_Data.Is_Running);
+}
+
+/**
+ * Add a record to the telemetry queue. This never blocks on disk I/O. If the queue is full,
+ * the record is dropped (and counted in Telemetry_Data.Dropped_Count).
+ * @param record The address of the record to copy into the queue. The Pad field is zeroed by this routine.
+ * @return The routine returns TRUE on success (including when the record is dropped) and FALSE on failure.
+ * @see #Telemetry_Data
+ */
+int Autoguider_Telemetry_Record_Add(struct Autoguider_Telemetry_Record_Struct *record)
+{
+	struct Autoguider_Telemetry_Record_Struct *queue_record = NULL;
+
+	if(Autoguider_Telemetry_Is_Enabled() == FALSE)
+		return TRUE;
+	if(record == NULL)
+	{
+		Autoguider_General_Error_Number = 1506;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Record_Add:record was NULL.");
+		return FALSE;
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Telemetry_Data.Mutex)))
+		return FALSE;
+	if(Telemetry_Data.Queue_Count >= Telemetry_Data.Queue_Length)
+	{
+		Telemetry_Data.Dropped_Count++;
+		if(!Autoguider_General_Mutex_Unlock(&(Telemetry_Data.Mutex)))
+			return FALSE;
+		return TRUE;
+	}
+	/* the telemetry thread only removes records from the queue after it has written them,
+	** so the record at Queue_Head+Queue_Count is not in use. */
+	queue_record = &(Telemetry_Data.Queue[(Telemetry_Data.Queue_Head+Telemetry_Data.Queue_Count)%
+					      Telemetry_Data.Queue_Length]);
+	(*queue_record) = (*record);
+	memset(queue_record->Pad,0,sizeof(queue_record->Pad));
+	Telemetry_Data.Queue_Count++;
+	pthread_cond_signal(&(Telemetry_Data.Condition));
+	if(!Autoguider_General_Mutex_Unlock(&(Telemetry_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Get the telemetry log statistics.
+ * @param written_count The address of an integer to store the number of records written to disk.
+ * @param dropped_count The address of an integer to store the number of records dropped.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Telemetry_Data
+ */
+int Autoguider_Telemetry_Stats_Get(int *written_count,int *dropped_count)
+{
+	if((written_count == NULL)||(dropped_count == NULL))
+	{
+		Autoguider_General_Error_Number = 1507;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Stats_Get:NULL argument.");
+		return FALSE;
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Telemetry_Data.Mutex)))
+		return FALSE;
+	(*written_count) = Telemetry_Data.Written_Count;
+	(*dropped_count) = Telemetry_Data.Dropped_Count;
+	if(!Autoguider_General_Mutex_Unlock(&(Telemetry_Data.Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Shutdown the telemetry log. The telemetry thread is told to quit, and joined. It writes any queued records
+ * and closes the telemetry file before quitting. The queue is then freed.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Telemetry_Data
+ * @see #Telemetry_Thread
+ */
+int Autoguider_Telemetry_Shutdown(void)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("telemetry","autoguider_telemetry.c","Autoguider_Telemetry_Shutdown",
+			       LOG_VERBOSITY_TERSE,"TELEMETRY","started.");
+#endif
+	if(Telemetry_Data.Is_Running)
+	{
+		if(!Autoguider_General_Mutex_Lock(&(Telemetry_Data.Mutex)))
+			return FALSE;
+		Telemetry_Data.Quit = TRUE;
+		pthread_cond_signal(&(Telemetry_Data.Condition));
+		if(!Autoguider_General_Mutex_Unlock(&(Telemetry_Data.Mutex)))
+			return FALSE;
+		retval = pthread_join(Telemetry_Data.Thread,NULL);
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1508;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Telemetry_Shutdown:"
+				"Failed to join telemetry thread (%d).",retval);
+			return FALSE;
+		}
+		Telemetry_Data.Is_Running = FALSE;
+	}
+	if(Telemetry_Data.Queue != NULL)
+		free(Telemetry_Data.Queue);
+	Telemetry_Data.Queue = NULL;
+	if(Telemetry_Data.Directory != NULL)
+		free(Telemetry_Data.Directory);
+	Telemetry_Data.Directory = NULL;
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("telemetry","autoguider_telemetry.c","Autoguider_Telemetry_Shutdown",
+				      LOG_VERBOSITY_TERSE,"TELEMETRY","Written %d records, dropped %d records:finished.",
+				      Telemetry_Data.Written_Count,Telemetry_Data.Dropped_Count);
+#endif
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * The telemetry thread. Waits for records to be queued, and appends them to the current telemetry file,
+ * opening a new file when the UTC day changes. All the records contiguous in the ring from Queue_Head
+ * are written with one fwrite and then flushed, the mutex is not held whilst writing.
+ * The thread quits when Telemetry_Data.Quit is set and the queue is empty, closing the telemetry file.
+ * @param arg Not used.
+ * @return Always NULL.
+ * @see #Telemetry_Data
+ * @see #Telemetry_File_Open
+ * @see #Telemetry_File_Close
+ */
+static void *Telemetry_Thread(void *arg)
+{
+	struct timespec current_time;
+	struct tm *time_tm = NULL;
+	struct tm time_tm_buff;
+	size_t write_count;
+	int record_count,retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("telemetry","autoguider_telemetry.c","Telemetry_Thread",
+			       LOG_VERBOSITY_TERSE,"TELEMETRY","started.");
+#endif
+	if(!Autoguider_General_Mutex_Lock(&(Telemetry_Data.Mutex)))
+	{
+		Autoguider_General_Error("telemetry","autoguider_telemetry.c","Telemetry_Thread",
+					 LOG_VERBOSITY_TERSE,"TELEMETRY");
+		return NULL;
+	}
+	while(TRUE)
+	{
+		while((Telemetry_Data.Queue_Count == 0)&&(Telemetry_Data.Quit == FALSE))
+			pthread_cond_wait(&(Telemetry_Data.Condition),&(Telemetry_Data.Mutex));
+		if(Telemetry_Data.Queue_Count == 0)
+			break;
+		/* the records from Queue_Head to the end of the ring are contiguous */
+		record_count = Telemetry_Data.Queue_Count;
+		if(Telemetry_Data.Queue_Head+record_count > Telemetry_Data.Queue_Length)
+			record_count = Telemetry_Data.Queue_Length-Telemetry_Data.Queue_Head;
+		Autoguider_General_Mutex_Unlock(&(Telemetry_Data.Mutex));
+		/* start a new file each UTC day */
+		clock_gettime(CLOCK_REALTIME,&current_time);
+		time_tm = gmtime_r(&(current_time.tv_sec),&time_tm_buff);
+		retval = TRUE;
+		if((Telemetry_Data.Fp != NULL)&&(Telemetry_Data.File_Year_Day != time_tm->tm_yday))
+		{
+			if(!Telemetry_File_Close())
+			{
+				Autoguider_General_Error("telemetry","autoguider_telemetry.c","Telemetry_Thread",
+							 LOG_VERBOSITY_TERSE,"TELEMETRY");
+			}
+		}
+		if(Telemetry_Data.Fp == NULL)
+			retval = Telemetry_File_Open(time_tm);
+		if(retval)
+		{
+			write_count = fwrite(&(Telemetry_Data.Queue[Telemetry_Data.Queue_Head]),
+					     sizeof(struct Autoguider_Telemetry_Record_Struct),record_count,
+					     Telemetry_Data.Fp);
+			fflush(Telemetry_Data.Fp);
+			if(write_count != record_count)
+			{
+				Autoguider_General_Error_Number = 1509;
+				sprintf(Autoguider_General_Error_String,"Telemetry_Thread:"
+					"Failed to write %d records to '%s' (%ld,%d).",record_count,
+					Telemetry_Data.Filename,(long)write_count,errno);
+				retval = FALSE;
+			}
+		}
+		if(retval == FALSE)
+		{
+			Autoguider_General_Error("telemetry","autoguider_telemetry.c","Telemetry_Thread",
+						 LOG_VERBOSITY_TERSE,"TELEMETRY");
+			/* close the file, it is reopened for the next records */
+			if(!Telemetry_File_Close())
+			{
+				Autoguider_General_Error("telemetry","autoguider_telemetry.c","Telemetry_Thread",
+							 LOG_VERBOSITY_TERSE,"TELEMETRY");
+			}
+		}
+		if(!Autoguider_General_Mutex_Lock(&(Telemetry_Data.Mutex)))
+		{
+			Autoguider_General_Error("telemetry","autoguider_telemetry.c","Telemetry_Thread",
+						 LOG_VERBOSITY_TERSE,"TELEMETRY");
+			return NULL;
+		}
+		if(retval)
+			Telemetry_Data.Written_Count += record_count;
+		else
+			Telemetry_Data.Dropped_Count += record_count;
+		Telemetry_Data.Queue_Head = (Telemetry_Data.Queue_Head+record_count)%Telemetry_Data.Queue_Length;
+		Telemetry_Data.Queue_Count -= record_count;
+	}
+	Autoguider_General_Mutex_Unlock(&(Telemetry_Data.Mutex));
+	if(!Telemetry_File_Close())
+	{
+		Autoguider_General_Error("telemetry","autoguider_telemetry.c","Telemetry_Thread",
+					 LOG_VERBOSITY_TERSE,"TELEMETRY");
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("telemetry","autoguider_telemetry.c","Telemetry_Thread",
+			       LOG_VERBOSITY_TERSE,"TELEMETRY","finished.");
+#endif
+	return NULL;
+}
+
+/**
+ * Open the telemetry file for the current UTC day in Telemetry_Data.Directory, named
+ * telemetry_YYYYMMDD.agt, for appending. If the file is empty, an Autoguider_Telemetry_File_Header_Struct is
+ * written to the start of it. If the file already exists, its header is checked so records of a different
+ * layout are not appended to it.
+ * @param time_tm The current UTC time, the day of the year is saved in Telemetry_Data.File_Year_Day.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Telemetry_Data
+ */
+static int Telemetry_File_Open(struct tm *time_tm)
+{
+	struct Autoguider_Telemetry_File_Header_Struct header;
+	char time_string[32];
+	long file_length;
+
+	strftime(time_string,31,"%Y%m%d",time_tm);
+	sprintf(Telemetry_Data.Filename,"%s/telemetry_%s.agt",Telemetry_Data.Directory,time_string);
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("telemetry","autoguider_telemetry.c","Telemetry_File_Open",
+				      LOG_VERBOSITY_TERSE,"TELEMETRY","Opening '%s'.",Telemetry_Data.Filename);
+#endif
+	Telemetry_Data.Fp = fopen(Telemetry_Data.Filename,"a+b");
+	if(Telemetry_Data.Fp == NULL)
+	{
+		Autoguider_General_Error_Number = 1510;
+		sprintf(Autoguider_General_Error_String,"Telemetry_File_Open:Failed to open '%s' (%d).",
+			Telemetry_Data.Filename,errno);
+		return FALSE;
+	}
+	Telemetry_Data.File_Year_Day = time_tm->tm_yday;
+	fseek(Telemetry_Data.Fp,0L,SEEK_END);
+	file_length = ftell(Telemetry_Data.Fp);
+	if(file_length > 0)
+	{
+		rewind(Telemetry_Data.Fp);
+		if((fread(&header,sizeof(struct Autoguider_Telemetry_File_Header_Struct),1,Telemetry_Data.Fp) != 1)||
+		   (header.Magic != AUTOGUIDER_TELEMETRY_MAGIC)||(header.Version != AUTOGUIDER_TELEMETRY_VERSION)||
+		   (header.Record_Length != sizeof(struct Autoguider_Telemetry_Record_Struct)))
+		{
+			fclose(Telemetry_Data.Fp);
+			Telemetry_Data.Fp = NULL;
+			Autoguider_General_Error_Number = 1511;
+			sprintf(Autoguider_General_Error_String,"Telemetry_File_Open:"
+				"'%s' is not a version %d telemetry file.",Telemetry_Data.Filename,
+				AUTOGUIDER_TELEMETRY_VERSION);
+			return FALSE;
+		}
+		/* "a" mode means writes always go to the end of the file */
+		return TRUE;
+	}
+	header.Magic = AUTOGUIDER_TELEMETRY_MAGIC;
+	header.Version = AUTOGUIDER_TELEMETRY_VERSION;
+	header.Header_Length = sizeof(struct Autoguider_Telemetry_File_Header_Struct);
+	header.Record_Length = sizeof(struct Autoguider_Telemetry_Record_Struct);
+	if(fwrite(&header,sizeof(struct Autoguider_Telemetry_File_Header_Struct),1,Telemetry_Data.Fp) != 1)
+	{
+		fclose(Telemetry_Data.Fp);
+		Telemetry_Data.Fp = NULL;
+		Autoguider_General_Error_Number = 1512;
+		sprintf(Autoguider_General_Error_String,"Telemetry_File_Open:"
+			"Failed to write header to '%s' (%d).",Telemetry_Data.Filename,errno);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Close the currently open telemetry file, if any.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Telemetry_Data
+ */
+static int Telemetry_File_Close(void)
+{
+	int retval;
+
+	if(Telemetry_Data.Fp != NULL)
+	{
+		retval = fclose(Telemetry_Data.Fp);
+		Telemetry_Data.Fp = NULL;
+		if(retval != 0)
+		{
+			Autoguider_General_Error_Number = 1513;
+			sprintf(Autoguider_General_Error_String,"Telemetry_File_Close:"
+				"Failed to close '%s' (%d).",Telemetry_Data.Filename,errno);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
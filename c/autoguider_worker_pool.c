@@ -0,0 +1,336 @@
+/* autoguider_worker_pool.c
+** Autoguider worker thread pool routines
+** $Header$
+*/
+/**
+ * Worker thread pool routines for the autoguider program.
+ * A fixed number of worker threads is created once at startup (by Autoguider_Field_Initialise), and used to
+ * run lists of independent jobs (for instance, one per band or tile of a field image), so field reduction does
+ * not create and join threads for every frame. The thread calling Autoguider_Worker_Pool_Run also runs jobs,
+ * and the call returns when every job in the list has been run.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_udp.h"
+
+#include "autoguider_general.h"
+#include "autoguider_worker_pool.h"
+
+/* hash defines */
+/**
+ * The maximum number of worker threads in the pool.
+ */
+#define WORKER_POOL_THREAD_COUNT_MAX      (64)
+
+/* data types */
+/**
+ * Structure holding the worker pool data.
+ * <dl>
+ * <dt>Run_Mutex</dt> <dd>Mutex held for the whole of Autoguider_Worker_Pool_Run, so only one job list
+ *                        is run at a time.</dd>
+ * <dt>Mutex</dt> <dd>Mutex protecting the rest of the structure.</dd>
+ * <dt>Job_Condition</dt> <dd>Condition variable signalled when a job list is started, or the workers are
+ *                            told to quit.</dd>
+ * <dt>Done_Condition</dt> <dd>Condition variable signalled when the last job in a list has been run.</dd>
+ * <dt>Thread_List</dt> <dd>The worker threads.</dd>
+ * <dt>Thread_Count</dt> <dd>The number of worker threads in Thread_List.</dd>
+ * <dt>Job_Routine</dt> <dd>The routine to call for each job in the current job list.</dd>
+ * <dt>Job_Arg_List</dt> <dd>The start of the current job list's array of job arguments.</dd>
+ * <dt>Job_Arg_Size</dt> <dd>The size in bytes of each job argument in Job_Arg_List.</dd>
+ * <dt>Job_Count</dt> <dd>The number of jobs in the current job list.</dd>
+ * <dt>Next_Job_Index</dt> <dd>The index of the next job to be run.</dd>
+ * <dt>Done_Count</dt> <dd>The number of jobs in the current job list that have been run.</dd>
+ * <dt>Quit</dt> <dd>Boolean, set to tell the worker threads to quit.</dd>
+ * </dl>
+ * @see #WORKER_POOL_THREAD_COUNT_MAX
+ */
+struct Worker_Pool_Struct
+{
+	pthread_mutex_t Run_Mutex;
+	pthread_mutex_t Mutex;
+	pthread_cond_t Job_Condition;
+	pthread_cond_t Done_Condition;
+	pthread_t Thread_List[WORKER_POOL_THREAD_COUNT_MAX];
+	int Thread_Count;
+	Autoguider_Worker_Pool_Job_Routine Job_Routine;
+	char *Job_Arg_List;
+	size_t Job_Arg_Size;
+	int Job_Count;
+	int Next_Job_Index;
+	int Done_Count;
+	int Quit;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Instance of the worker pool data. The mutexs and condition variables are statically initialised.
+ * Until Autoguider_Worker_Pool_Initialise has created the worker threads, jobs are run in the calling thread.
+ * @see #Worker_Pool_Struct
+ */
+static struct Worker_Pool_Struct Worker_Pool_Data =
+{
+	PTHREAD_MUTEX_INITIALIZER,PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER,PTHREAD_COND_INITIALIZER
+};
+
+/* internal functions */
+static void *Worker_Pool_Thread(void *arg);
+static void Worker_Pool_Jobs_Run(void);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Initialise the worker pool, creating thread_count worker threads. These wait for job lists
+ * to be started by Autoguider_Worker_Pool_Run.
+ * @param thread_count The number of worker threads to create, from 0 to WORKER_POOL_THREAD_COUNT_MAX.
+ *        With no worker threads, all jobs are run by the thread calling Autoguider_Worker_Pool_Run.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Worker_Pool_Data
+ * @see #Worker_Pool_Thread
+ * @see #WORKER_POOL_THREAD_COUNT_MAX
+ * @see #Autoguider_Worker_Pool_Shutdown
+ */
+int Autoguider_Worker_Pool_Initialise(int thread_count)
+{
+	int retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log_Format("worker_pool","autoguider_worker_pool.c","Autoguider_Worker_Pool_Initialise",
+				      LOG_VERBOSITY_TERSE,"WORKER","Autoguider_Worker_Pool_Initialise(%d):started.",
+				      thread_count);
+#endif
+	if((thread_count < 0)||(thread_count > WORKER_POOL_THREAD_COUNT_MAX))
+	{
+		Autoguider_General_Error_Number = 2300;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Worker_Pool_Initialise:"
+			"Illegal thread count %d (0..%d).",thread_count,WORKER_POOL_THREAD_COUNT_MAX);
+		return FALSE;
+	}
+	if(Worker_Pool_Data.Thread_Count > 0)
+	{
+		Autoguider_General_Error_Number = 2301;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Worker_Pool_Initialise:"
+			"Worker pool already has %d threads.",Worker_Pool_Data.Thread_Count);
+		return FALSE;
+	}
+	Worker_Pool_Data.Job_Count = 0;
+	Worker_Pool_Data.Next_Job_Index = 0;
+	Worker_Pool_Data.Done_Count = 0;
+	Worker_Pool_Data.Quit = FALSE;
+	while(Worker_Pool_Data.Thread_Count < thread_count)
+	{
+		retval = pthread_create(&(Worker_Pool_Data.Thread_List[Worker_Pool_Data.Thread_Count]),NULL,
+					&Worker_Pool_Thread,(void *)NULL);
+		if(retval != 0)
+		{
+			/* stop the threads already created */
+			Autoguider_Worker_Pool_Shutdown();
+			Autoguider_General_Error_Number = 2302;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Worker_Pool_Initialise:"
+				"Failed to create worker thread %d of %d (%d).",Worker_Pool_Data.Thread_Count,
+				thread_count,retval);
+			return FALSE;
+		}
+		Worker_Pool_Data.Thread_Count++;
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("worker_pool","autoguider_worker_pool.c","Autoguider_Worker_Pool_Initialise",
+			       LOG_VERBOSITY_TERSE,"WORKER","finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Run a list of jobs on the worker pool, and wait for them all to finish. The calling thread runs jobs as well
+ * as the worker threads. Only one job list is run at a time, other callers wait for the current list to finish.
+ * @param job_routine The routine to call for each job. This must not set Autoguider_General_Error_Number,
+ *        but report errors through its job argument.
+ * @param job_arg_list The start of an array of job_count job arguments, each job_arg_size bytes long.
+ *        job_routine is called with the address of each one in turn.
+ * @param job_arg_size The size in bytes of each job argument.
+ * @param job_count The number of jobs.
+ * @return The routine returns TRUE on success and FALSE on failure. Note the job routines' own success
+ *         or failure has to be checked in their job arguments.
+ * @see #Worker_Pool_Data
+ * @see #Worker_Pool_Jobs_Run
+ * @see autoguider_general.html#Autoguider_General_Mutex_Lock
+ * @see autoguider_general.html#Autoguider_General_Mutex_Unlock
+ */
+int Autoguider_Worker_Pool_Run(Autoguider_Worker_Pool_Job_Routine job_routine,void *job_arg_list,
+			       size_t job_arg_size,int job_count)
+{
+	if(job_routine == NULL)
+	{
+		Autoguider_General_Error_Number = 2303;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Worker_Pool_Run:job_routine was NULL.");
+		return FALSE;
+	}
+	if((job_arg_list == NULL)||(job_count < 0))
+	{
+		Autoguider_General_Error_Number = 2304;
+		sprintf(Autoguider_General_Error_String,"Autoguider_Worker_Pool_Run:"
+			"Illegal job list (%p,%d).",job_arg_list,job_count);
+		return FALSE;
+	}
+	if(!Autoguider_General_Mutex_Lock(&(Worker_Pool_Data.Run_Mutex)))
+		return FALSE;
+	if(!Autoguider_General_Mutex_Lock(&(Worker_Pool_Data.Mutex)))
+	{
+		Autoguider_General_Mutex_Unlock(&(Worker_Pool_Data.Run_Mutex));
+		return FALSE;
+	}
+	Worker_Pool_Data.Job_Routine = job_routine;
+	Worker_Pool_Data.Job_Arg_List = (char *)job_arg_list;
+	Worker_Pool_Data.Job_Arg_Size = job_arg_size;
+	Worker_Pool_Data.Job_Count = job_count;
+	Worker_Pool_Data.Next_Job_Index = 0;
+	Worker_Pool_Data.Done_Count = 0;
+	pthread_cond_broadcast(&(Worker_Pool_Data.Job_Condition));
+	/* run jobs in this thread too */
+	Worker_Pool_Jobs_Run();
+	/* wait for the jobs taken by the worker threads */
+	while(Worker_Pool_Data.Done_Count < Worker_Pool_Data.Job_Count)
+		pthread_cond_wait(&(Worker_Pool_Data.Done_Condition),&(Worker_Pool_Data.Mutex));
+	Worker_Pool_Data.Job_Count = 0;
+	Worker_Pool_Data.Next_Job_Index = 0;
+	Worker_Pool_Data.Done_Count = 0;
+	Autoguider_General_Mutex_Unlock(&(Worker_Pool_Data.Mutex));
+	if(!Autoguider_General_Mutex_Unlock(&(Worker_Pool_Data.Run_Mutex)))
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * Get the number of worker threads in the pool.
+ * @return The number of worker threads (not including the thread calling Autoguider_Worker_Pool_Run).
+ * @see #Worker_Pool_Data
+ */
+int Autoguider_Worker_Pool_Thread_Count_Get(void)
+{
+	return Worker_Pool_Data.Thread_Count;
+}
+
+/**
+ * Shutdown the worker pool. The worker threads are told to quit and joined.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Worker_Pool_Data
+ */
+int Autoguider_Worker_Pool_Shutdown(void)
+{
+	int i,retval,join_retval;
+
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("worker_pool","autoguider_worker_pool.c","Autoguider_Worker_Pool_Shutdown",
+			       LOG_VERBOSITY_TERSE,"WORKER","started.");
+#endif
+	if(Worker_Pool_Data.Thread_Count > 0)
+	{
+		if(!Autoguider_General_Mutex_Lock(&(Worker_Pool_Data.Mutex)))
+			return FALSE;
+		Worker_Pool_Data.Quit = TRUE;
+		pthread_cond_broadcast(&(Worker_Pool_Data.Job_Condition));
+		if(!Autoguider_General_Mutex_Unlock(&(Worker_Pool_Data.Mutex)))
+			return FALSE;
+		join_retval = 0;
+		for(i=0; i < Worker_Pool_Data.Thread_Count; i++)
+		{
+			retval = pthread_join(Worker_Pool_Data.Thread_List[i],NULL);
+			if(retval != 0)
+				join_retval = retval;
+		}
+		Worker_Pool_Data.Thread_Count = 0;
+		Worker_Pool_Data.Quit = FALSE;
+		if(join_retval != 0)
+		{
+			Autoguider_General_Error_Number = 2305;
+			sprintf(Autoguider_General_Error_String,"Autoguider_Worker_Pool_Shutdown:"
+				"Failed to join worker thread (%d).",join_retval);
+			return FALSE;
+		}
+	}
+#if AUTOGUIDER_DEBUG > 1
+	Autoguider_General_Log("worker_pool","autoguider_worker_pool.c","Autoguider_Worker_Pool_Shutdown",
+			       LOG_VERBOSITY_TERSE,"WORKER","finished.");
+#endif
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * A worker thread. Waits for a job list to be started by Autoguider_Worker_Pool_Run, and runs jobs from it
+ * until none are left. The thread quits when Worker_Pool_Data.Quit is set.
+ * @param arg Not used.
+ * @return Always NULL.
+ * @see #Worker_Pool_Data
+ * @see #Worker_Pool_Jobs_Run
+ * @see autoguider_general.html#Autoguider_General_Error
+ */
+static void *Worker_Pool_Thread(void *arg)
+{
+	if(!Autoguider_General_Mutex_Lock(&(Worker_Pool_Data.Mutex)))
+	{
+		Autoguider_General_Error("worker_pool","autoguider_worker_pool.c","Worker_Pool_Thread",
+					 LOG_VERBOSITY_TERSE,"WORKER");
+		return NULL;
+	}
+	while(TRUE)
+	{
+		while((Worker_Pool_Data.Next_Job_Index >= Worker_Pool_Data.Job_Count)&&
+		      (Worker_Pool_Data.Quit == FALSE))
+			pthread_cond_wait(&(Worker_Pool_Data.Job_Condition),&(Worker_Pool_Data.Mutex));
+		if(Worker_Pool_Data.Quit)
+			break;
+		Worker_Pool_Jobs_Run();
+	}
+	Autoguider_General_Mutex_Unlock(&(Worker_Pool_Data.Mutex));
+	return NULL;
+}
+
+/**
+ * Take jobs from the current job list and run them, until none are left to take.
+ * Must be called with Worker_Pool_Data.Mutex locked, which is unlocked whilst each job is run.
+ * Done_Condition is signalled when the last job in the list is done.
+ * @see #Worker_Pool_Data
+ */
+static void Worker_Pool_Jobs_Run(void)
+{
+	void *job_arg = NULL;
+	int job_index;
+
+	while(Worker_Pool_Data.Next_Job_Index < Worker_Pool_Data.Job_Count)
+	{
+		job_index = Worker_Pool_Data.Next_Job_Index++;
+		job_arg = (void *)(Worker_Pool_Data.Job_Arg_List+(job_index*Worker_Pool_Data.Job_Arg_Size));
+		pthread_mutex_unlock(&(Worker_Pool_Data.Mutex));
+		Worker_Pool_Data.Job_Routine(job_arg);
+		pthread_mutex_lock(&(Worker_Pool_Data.Mutex));
+		Worker_Pool_Data.Done_Count++;
+		if(Worker_Pool_Data.Done_Count == Worker_Pool_Data.Job_Count)
+			pthread_cond_signal(&(Worker_Pool_Data.Done_Condition));
+	}
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
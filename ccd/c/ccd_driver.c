@@ -5,6 +5,10 @@
 /**
  * Driver routines for the autoguider CCD library.
  * Sets up function pointers to driver routines from a loaded shared library.
+ * A process can drive more than one camera by creating a driver context per camera (CCD_Driver_Context_Create),
+ * and selecting it (CCD_Driver_Context_Select) in the thread(s) that use that camera. The other CCD library
+ * routines then call into the driver loaded in the calling thread's context, and keep their per-camera data
+ * in that context. Threads that select no context use the default context, so single camera programs are unchanged.
  * @author Chris Mottram
  * @version $Revision: 1.2 $
  */
@@ -13,12 +17,15 @@
  */
 #define _POSIX_SOURCE 1
 /**
- * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes,
+ * and the POSIX 1003.1c mutex protocol (PTHREAD_PRIO_INHERIT) prototypes.
  */
-#define _POSIX_C_SOURCE 199309L
+#define _POSIX_C_SOURCE 199506L
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include <unistd.h>
 /* dynamic library loader */
 #include <dlfcn.h>
@@ -31,20 +38,34 @@
 
 /* data types */
 /**
- * Structure holding local data to ccd_driver.
+ * Structure holding the data for one driver context (one camera). The library has a default
+ * context, used by any thread that has not selected another with CCD_Driver_Context_Select.
  * <ul>
  * <li><b>Dynamic_Library_Handle</b> Void pointer containing handle returned from dlopen.
  * <li><b>Register</b> Function pointer to registration function symbol retrieved from loaded dynamic library.
  * <li><b>Functions</b> Structure containing function pointers into the loaded driver. Filled in by a call
  *       to the libraries register function.
+ * <li><b>Mutex</b> Mutex used to serialize calls into this context's driver, see CCD_Driver_Lock.
+ * <li><b>Data_Mutex</b> Mutex protecting Data_List and Data_Free_List. This is not Mutex, as driver routines
+ *       (called with Mutex held) retrieve their data.
+ * <li><b>Data_List</b> The per-camera data of each module, indexed by CCD_DRIVER_CONTEXT_DATA.
+ * <li><b>Data_Free_List</b> The routine used to free each item in Data_List, or NULL.
+ * <li><b>Next</b> The next context in the list of contexts (Context_List).
  * </ul>
  * @see #CCD_Driver_Function_Struct
+ * @see #CCD_DRIVER_CONTEXT_DATA
+ * @see #Context_List
  */
-struct Driver_Struct
+struct CCD_Driver_Context_Struct
 {
 	void *Dynamic_Library_Handle;
 	int (*Register)(struct CCD_Driver_Function_Struct *functions);
 	struct CCD_Driver_Function_Struct Functions;
+	pthread_mutex_t Mutex;
+	pthread_mutex_t Data_Mutex;
+	void *Data_List[CCD_DRIVER_CONTEXT_DATA_COUNT];
+	void (*Data_Free_List[CCD_DRIVER_CONTEXT_DATA_COUNT])(void *data);
+	struct CCD_Driver_Context_Struct *Next;
 };
 
 /* internal data */
@@ -53,25 +74,62 @@ struct Driver_Struct
  */
 static char rcsid[] = "$Id: ccd_driver.c,v 1.2 2009-01-30 18:00:24 cjm Exp $";
 /**
- * Instance of the loaded driver.
- * @see #Driver_Struct
+ * The default driver context, used by threads that have not selected another context.
+ * Its mutexes are initialised in Driver_Context_Initialise.
+ * @see #CCD_Driver_Context_Struct
+ * @see #Driver_Context_Initialise
+ */
+static struct CCD_Driver_Context_Struct Driver_Data;
+/**
+ * A list of all the driver contexts, starting with the default context (Driver_Data).
+ * Protected by Context_List_Mutex.
+ * @see #Driver_Data
+ * @see #Context_List_Mutex
+ */
+static struct CCD_Driver_Context_Struct *Context_List = &Driver_Data;
+/**
+ * Mutex protecting Context_List.
+ * @see #Context_List
  */
-static struct Driver_Struct Driver_Data;
+static pthread_mutex_t Context_List_Mutex = PTHREAD_MUTEX_INITIALIZER;
+/**
+ * Thread specific data key, holding the context each thread has selected with CCD_Driver_Context_Select.
+ * @see #CCD_Driver_Context_Select
+ */
+static pthread_key_t Context_Key;
+/**
+ * Used to call Driver_Context_Initialise once only.
+ * @see #Driver_Context_Initialise
+ */
+static pthread_once_t Context_Once = PTHREAD_ONCE_INIT;
+
+/* internal functions */
+static void Driver_Context_Initialise(void);
+static struct CCD_Driver_Context_Struct *Driver_Context_Get(void);
+static int Driver_Mutex_Initialise(pthread_mutex_t *mutex);
+static void Driver_Context_Data_Free(struct CCD_Driver_Context_Struct *context,enum CCD_DRIVER_CONTEXT_DATA which);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
 ** ---------------------------------------------------------------------------- */
 /**
- * Load the shared library, and call the registration function to register a driver.
+ * Load the shared library, and call the registration function to register a driver, in the calling thread's
+ * driver context (see CCD_Driver_Context_Select). dlopen returns the same copy of a library already loaded in
+ * another context, so a library can only be registered in more than one context if its registration function
+ * keeps the camera state in the context's driver data (CCD_Driver_Context_Data_Set) rather than in file statics.
  * @param shared_library_name The name of the shared library to load e.g. "libm.so".
  * @param registration_function The registration function to call in the loaded shared library e.g. "cos".
  * @return The function returns TRUE on success and FALSE on failure.
- * @see #Driver_Data
+ * @see #Driver_Context_Get
+ * @see #Driver_Context_Data_Free
+ * @see #Context_List
  */
 int CCD_Driver_Register(char *shared_library_name,char *registration_function)
 {
+	struct CCD_Driver_Context_Struct *context = NULL;
+	struct CCD_Driver_Context_Struct *other_context = NULL;
 	char *error_string = NULL;
-	int retval;
+	int context_instance_safe,other_instance_safe,retval;
 
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_driver.c","CCD_Driver_Register",LOG_VERBOSITY_TERSE,NULL,"started.");
@@ -88,9 +146,10 @@ int CCD_Driver_Register(char *shared_library_name,char *registration_function)
 		sprintf(CCD_General_Error_String,"CCD_Driver_Register:registration_function is NULL.");
 		return FALSE;
 	}
+	context = Driver_Context_Get();
 	/* open shared library */
-	Driver_Data.Dynamic_Library_Handle = dlopen(shared_library_name,RTLD_NOW);
-	if(Driver_Data.Dynamic_Library_Handle == NULL)
+	context->Dynamic_Library_Handle = dlopen(shared_library_name,RTLD_NOW);
+	if(context->Dynamic_Library_Handle == NULL)
 	{
 		CCD_General_Error_Number = 202;
 		sprintf(CCD_General_Error_String,"CCD_Driver_Register:dlopen(%s) failed (%s).",shared_library_name,
@@ -98,7 +157,7 @@ int CCD_Driver_Register(char *shared_library_name,char *registration_function)
 		return FALSE;
 	}
 	/* get registration fn pointer */
-	Driver_Data.Register = dlsym(Driver_Data.Dynamic_Library_Handle, registration_function);
+	context->Register = dlsym(context->Dynamic_Library_Handle, registration_function);
 	/* check whether dlsym failed. This should be done by calling dlerror, as the symbol
 	 * may actually be NULL. The return from dlerror is saved, as a second call to dlerror returns NULL. */
 	error_string = dlerror();
@@ -110,13 +169,13 @@ int CCD_Driver_Register(char *shared_library_name,char *registration_function)
 		return FALSE;
 	}
 	/* returning a function pointer of NULL may not be an error according to dlsym, but it is to us! */
-	if(Driver_Data.Register == NULL)
+	if(context->Register == NULL)
 	{
 		CCD_General_Error_Number = 204;
 		sprintf(CCD_General_Error_String,"CCD_Driver_Register:dlsym(%s) returned NULL.",registration_function);
 		return FALSE;
 	}
-	retval = (*Driver_Data.Register)(&Driver_Data.Functions);
+	retval = (*context->Register)(&context->Functions);
 	if(retval == FALSE)
 	{
 		/* hopefully the register function will have set a sensible error message */
@@ -129,6 +188,32 @@ int CCD_Driver_Register(char *shared_library_name,char *registration_function)
 		}
 		return FALSE;
 	}
+	/* if this library is also registered in another context, both registrations must have set driver data */
+	context_instance_safe = (CCD_Driver_Context_Data_Get(CCD_DRIVER_CONTEXT_DATA_DRIVER) != NULL);
+	pthread_mutex_lock(&Context_List_Mutex);
+	for(other_context = Context_List;other_context != NULL;other_context = other_context->Next)
+	{
+		if((other_context == context)||
+		   (other_context->Dynamic_Library_Handle != context->Dynamic_Library_Handle))
+			continue;
+		pthread_mutex_lock(&(other_context->Data_Mutex));
+		other_instance_safe = (other_context->Data_List[CCD_DRIVER_CONTEXT_DATA_DRIVER] != NULL);
+		pthread_mutex_unlock(&(other_context->Data_Mutex));
+		if((context_instance_safe == FALSE)||(other_instance_safe == FALSE))
+			break;
+	}
+	pthread_mutex_unlock(&Context_List_Mutex);
+	if(other_context != NULL)
+	{
+		Driver_Context_Data_Free(context,CCD_DRIVER_CONTEXT_DATA_DRIVER);
+		dlclose(context->Dynamic_Library_Handle);
+		context->Dynamic_Library_Handle = NULL;
+		memset(&(context->Functions),0,sizeof(struct CCD_Driver_Function_Struct));
+		CCD_General_Error_Number = 210;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Register:%s is already registered in context %p, "
+			"and is not instance-safe.",shared_library_name,(void*)other_context);
+		return FALSE;
+	}
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_driver.c","CCD_Driver_Register",LOG_VERBOSITY_TERSE,NULL,"finished.");
 #endif
@@ -136,11 +221,11 @@ int CCD_Driver_Register(char *shared_library_name,char *registration_function)
 }
 
 /**
- * Get the functions registered by the loaded driver library. Copied from Driver_Data.
+ * Get the functions registered by the loaded driver library, in the calling thread's driver context.
  * @param functions The address of a CCD_Driver_Function_Struct structure to store the function pointers in.
  * @return The function returns TRUE on success and FALSE on failure.
  * @see #CCD_Driver_Function_Struct
- * @see #Driver_Data
+ * @see #Driver_Context_Get
  */
 int CCD_Driver_Get_Functions(struct CCD_Driver_Function_Struct *functions)
 {
@@ -150,35 +235,399 @@ int CCD_Driver_Get_Functions(struct CCD_Driver_Function_Struct *functions)
 		sprintf(CCD_General_Error_String,"CCD_Driver_Get_Functions:functions is NULL.");
 		return FALSE;
 	}
-	(*functions) = Driver_Data.Functions;
+	(*functions) = Driver_Context_Get()->Functions;
 	return TRUE;
 }
 
 /**
- * Close the opened dynamic library using dlclose(Driver_Data.Dynamic_Library_Handle);
+ * Close the dynamic library opened in the calling thread's driver context, using dlclose.
+ * The driver's per-context data is freed first, as its free routine is in the library.
  * @return The function returns TRUE on success and FALSE on failure.
- * @see #Driver_Data
+ * @see #Driver_Context_Get
+ * @see #Driver_Context_Data_Free
  */
 int CCD_Driver_Close(void)
 {
+	struct CCD_Driver_Context_Struct *context = NULL;
 	int retval;
 
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_driver.c","CCD_Driver_Close",LOG_VERBOSITY_VERBOSE,NULL,"started.");
 #endif
-	retval = dlclose(Driver_Data.Dynamic_Library_Handle);
+	context = Driver_Context_Get();
+	Driver_Context_Data_Free(context,CCD_DRIVER_CONTEXT_DATA_DRIVER);
+	retval = dlclose(context->Dynamic_Library_Handle);
 	if(retval != 0)
 	{
 		CCD_General_Error_Number = 207;
 		sprintf(CCD_General_Error_String,"CCD_Driver_Close:dlclose(%p) failed (%s).",
-			Driver_Data.Dynamic_Library_Handle,dlerror());
+			context->Dynamic_Library_Handle,dlerror());
 		return FALSE;
 	}
+	context->Dynamic_Library_Handle = NULL;
+	memset(&(context->Functions),0,sizeof(struct CCD_Driver_Function_Struct));
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_driver.c","CCD_Driver_Close",LOG_VERBOSITY_VERBOSE,NULL,"finished.");
 #endif
 	return TRUE;
 }
+/**
+ * Lock the driver mutex of the calling thread's driver context. This blocks until no other thread is inside
+ * a serialized call into the same camera, so a background temperature poll cannot be issued whilst an
+ * exposure is in progress. Calls into cameras in other contexts are not blocked.
+ * Every successful call must be matched by a call to CCD_Driver_Unlock.
+ * @return The function returns TRUE on success and FALSE on failure.
+ * @see #Driver_Context_Get
+ * @see #CCD_Driver_Unlock
+ */
+int CCD_Driver_Lock(void)
+{
+	int retval;
+
+	retval = pthread_mutex_lock(&(Driver_Context_Get()->Mutex));
+	if(retval != 0)
+	{
+		CCD_General_Error_Number = 208;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Lock:pthread_mutex_lock failed (%d).",retval);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Unlock the driver mutex of the calling thread's driver context, previously locked with CCD_Driver_Lock.
+ * @return The function returns TRUE on success and FALSE on failure.
+ * @see #Driver_Context_Get
+ * @see #CCD_Driver_Lock
+ */
+int CCD_Driver_Unlock(void)
+{
+	int retval;
+
+	retval = pthread_mutex_unlock(&(Driver_Context_Get()->Mutex));
+	if(retval != 0)
+	{
+		CCD_General_Error_Number = 209;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Unlock:pthread_mutex_unlock failed (%d).",retval);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Create a new driver context, so a process can drive more than one camera. The new context has no driver
+ * registered: select it in a thread with CCD_Driver_Context_Select, then call CCD_Driver_Register and the
+ * other CCD library routines from that thread.
+ * @param context The address of a pointer to store the new context in.
+ * @return The function returns TRUE on success and FALSE on failure.
+ * @see #CCD_Driver_Context_Struct
+ * @see #CCD_Driver_Context_Select
+ * @see #CCD_Driver_Context_Destroy
+ * @see #Context_List
+ * @see #Driver_Mutex_Initialise
+ */
+int CCD_Driver_Context_Create(struct CCD_Driver_Context_Struct **context)
+{
+	int retval;
+
+	if(context == NULL)
+	{
+		CCD_General_Error_Number = 211;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Create:context is NULL.");
+		return FALSE;
+	}
+	pthread_once(&Context_Once,Driver_Context_Initialise);
+	(*context) = (struct CCD_Driver_Context_Struct *)calloc(1,sizeof(struct CCD_Driver_Context_Struct));
+	if((*context) == NULL)
+	{
+		CCD_General_Error_Number = 212;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Create:Failed to allocate context.");
+		return FALSE;
+	}
+	retval = Driver_Mutex_Initialise(&((*context)->Mutex));
+	if(retval == 0)
+	{
+		retval = pthread_mutex_init(&((*context)->Data_Mutex),NULL);
+		if(retval != 0)
+			pthread_mutex_destroy(&((*context)->Mutex));
+	}
+	if(retval != 0)
+	{
+		free(*context);
+		(*context) = NULL;
+		CCD_General_Error_Number = 213;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Create:pthread_mutex_init failed (%d).",retval);
+		return FALSE;
+	}
+	pthread_mutex_lock(&Context_List_Mutex);
+	(*context)->Next = Context_List->Next;
+	Context_List->Next = (*context);
+	pthread_mutex_unlock(&Context_List_Mutex);
+	return TRUE;
+}
+
+/**
+ * Select the driver context the calling thread's CCD library calls use. Each thread starts using the
+ * default context. Every thread that calls into a camera, including threads that only abort its exposures
+ * or poll its temperature, must select that camera's context.
+ * @param context The context to use, created by CCD_Driver_Context_Create, or NULL to use the default context.
+ * @return The function returns TRUE on success and FALSE on failure.
+ * @see #Context_Key
+ * @see #Driver_Context_Get
+ */
+int CCD_Driver_Context_Select(struct CCD_Driver_Context_Struct *context)
+{
+	int retval;
+
+	pthread_once(&Context_Once,Driver_Context_Initialise);
+	if(context == &Driver_Data)
+		context = NULL;
+	retval = pthread_setspecific(Context_Key,context);
+	if(retval != 0)
+	{
+		CCD_General_Error_Number = 214;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Select:pthread_setspecific failed (%d).",retval);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Destroy a driver context created by CCD_Driver_Context_Create. Any driver registered in the context
+ * should already have been shut down (CCD_Setup_Shutdown), and no thread apart from the calling thread
+ * should still have the context selected. If the calling thread has it selected, it reverts to the default
+ * context. The driver is closed if CCD_Driver_Close has not been called, and all the context's data is freed.
+ * @param context The address of the context pointer, which is set to NULL.
+ * @return The function returns TRUE on success and FALSE on failure.
+ * @see #CCD_Driver_Context_Create
+ * @see #Context_List
+ * @see #Driver_Context_Data_Free
+ */
+int CCD_Driver_Context_Destroy(struct CCD_Driver_Context_Struct **context)
+{
+	struct CCD_Driver_Context_Struct *previous_context = NULL;
+	int which;
+
+	if((context == NULL)||((*context) == NULL))
+	{
+		CCD_General_Error_Number = 215;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Destroy:context is NULL.");
+		return FALSE;
+	}
+	if((*context) == &Driver_Data)
+	{
+		CCD_General_Error_Number = 216;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Destroy:Cannot destroy the default context.");
+		return FALSE;
+	}
+	pthread_once(&Context_Once,Driver_Context_Initialise);
+	if(pthread_getspecific(Context_Key) == (*context))
+		pthread_setspecific(Context_Key,NULL);
+	pthread_mutex_lock(&Context_List_Mutex);
+	for(previous_context = Context_List;previous_context != NULL;previous_context = previous_context->Next)
+	{
+		if(previous_context->Next == (*context))
+		{
+			previous_context->Next = (*context)->Next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&Context_List_Mutex);
+	/* the driver data free routine is in the library, so free it before closing the library */
+	Driver_Context_Data_Free((*context),CCD_DRIVER_CONTEXT_DATA_DRIVER);
+	if((*context)->Dynamic_Library_Handle != NULL)
+		dlclose((*context)->Dynamic_Library_Handle);
+	for(which = 0; which < CCD_DRIVER_CONTEXT_DATA_COUNT; which++)
+		Driver_Context_Data_Free((*context),which);
+	pthread_mutex_destroy(&((*context)->Data_Mutex));
+	pthread_mutex_destroy(&((*context)->Mutex));
+	free(*context);
+	(*context) = NULL;
+	return TRUE;
+}
+
+/**
+ * Get a per-camera data item of the calling thread's driver context.
+ * @param which Which data item to get.
+ * @return The data item, or NULL if it has not been set (or which is out of range).
+ * @see #CCD_DRIVER_CONTEXT_DATA
+ * @see #Driver_Context_Get
+ */
+void *CCD_Driver_Context_Data_Get(enum CCD_DRIVER_CONTEXT_DATA which)
+{
+	struct CCD_Driver_Context_Struct *context = NULL;
+	void *data = NULL;
+
+	if((which < 0)||(which >= CCD_DRIVER_CONTEXT_DATA_COUNT))
+		return NULL;
+	context = Driver_Context_Get();
+	pthread_mutex_lock(&(context->Data_Mutex));
+	data = context->Data_List[which];
+	pthread_mutex_unlock(&(context->Data_Mutex));
+	return data;
+}
+
+/**
+ * Get a per-camera data item of the calling thread's driver context, allocating it the first time it is
+ * retrieved in each context. The allocated item is freed with free when the context is destroyed.
+ * @param which Which data item to get.
+ * @param size The size of the data item, in bytes.
+ * @param initial_data The address of size bytes, copied into the data item when it is allocated.
+ * @param data The address of a pointer to store the data item in.
+ * @return The function returns TRUE on success and FALSE on failure.
+ * @see #CCD_DRIVER_CONTEXT_DATA
+ * @see #Driver_Context_Get
+ */
+int CCD_Driver_Context_Data_Create(enum CCD_DRIVER_CONTEXT_DATA which,size_t size,void *initial_data,void **data)
+{
+	struct CCD_Driver_Context_Struct *context = NULL;
+
+	if((which < 0)||(which >= CCD_DRIVER_CONTEXT_DATA_COUNT))
+	{
+		CCD_General_Error_Number = 217;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Data_Create:which %d out of range.",which);
+		return FALSE;
+	}
+	if((initial_data == NULL)||(data == NULL))
+	{
+		CCD_General_Error_Number = 218;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Data_Create:initial_data or data is NULL.");
+		return FALSE;
+	}
+	context = Driver_Context_Get();
+	pthread_mutex_lock(&(context->Data_Mutex));
+	if(context->Data_List[which] == NULL)
+	{
+		context->Data_List[which] = malloc(size);
+		if(context->Data_List[which] == NULL)
+		{
+			pthread_mutex_unlock(&(context->Data_Mutex));
+			CCD_General_Error_Number = 219;
+			sprintf(CCD_General_Error_String,"CCD_Driver_Context_Data_Create:"
+				"Failed to allocate data %d (%lu bytes).",which,(unsigned long)size);
+			return FALSE;
+		}
+		memcpy(context->Data_List[which],initial_data,size);
+		context->Data_Free_List[which] = free;
+	}
+	(*data) = context->Data_List[which];
+	pthread_mutex_unlock(&(context->Data_Mutex));
+	return TRUE;
+}
+
+/**
+ * Set a per-camera data item of the calling thread's driver context. Any item already set is freed first.
+ * A driver's registration function sets CCD_DRIVER_CONTEXT_DATA_DRIVER to make the driver instance-safe.
+ * @param which Which data item to set.
+ * @param data The data item, or NULL to just free the current item.
+ * @param data_free A routine to free the data item with, when it is replaced, the driver is closed, or the
+ *        context is destroyed. This can be NULL, if the data item need not be freed.
+ * @return The function returns TRUE on success and FALSE on failure.
+ * @see #CCD_DRIVER_CONTEXT_DATA
+ * @see #Driver_Context_Get
+ * @see #Driver_Context_Data_Free
+ */
+int CCD_Driver_Context_Data_Set(enum CCD_DRIVER_CONTEXT_DATA which,void *data,void (*data_free)(void *data))
+{
+	struct CCD_Driver_Context_Struct *context = NULL;
+
+	if((which < 0)||(which >= CCD_DRIVER_CONTEXT_DATA_COUNT))
+	{
+		CCD_General_Error_Number = 220;
+		sprintf(CCD_General_Error_String,"CCD_Driver_Context_Data_Set:which %d out of range.",which);
+		return FALSE;
+	}
+	context = Driver_Context_Get();
+	Driver_Context_Data_Free(context,which);
+	pthread_mutex_lock(&(context->Data_Mutex));
+	context->Data_List[which] = data;
+	context->Data_Free_List[which] = data_free;
+	pthread_mutex_unlock(&(context->Data_Mutex));
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions 
+** ---------------------------------------------------------------------------- */
+/**
+ * Called once (through pthread_once) to create the thread specific data key holding each thread's
+ * selected context, and initialise the default context's mutexes.
+ * @see #Context_Key
+ * @see #Driver_Data
+ * @see #Driver_Mutex_Initialise
+ */
+static void Driver_Context_Initialise(void)
+{
+	pthread_key_create(&Context_Key,NULL);
+	Driver_Mutex_Initialise(&(Driver_Data.Mutex));
+	pthread_mutex_init(&(Driver_Data.Data_Mutex),NULL);
+}
+
+/**
+ * Get the calling thread's driver context.
+ * @return The context selected by the calling thread, or the default context (Driver_Data) if none is selected.
+ * @see #Context_Key
+ * @see #Context_Once
+ * @see #Driver_Data
+ */
+static struct CCD_Driver_Context_Struct *Driver_Context_Get(void)
+{
+	struct CCD_Driver_Context_Struct *context = NULL;
+
+	pthread_once(&Context_Once,Driver_Context_Initialise);
+	context = (struct CCD_Driver_Context_Struct *)pthread_getspecific(Context_Key);
+	if(context == NULL)
+		return &Driver_Data;
+	return context;
+}
+
+/**
+ * Initialise a context's driver mutex with the PTHREAD_PRIO_INHERIT protocol.
+ * The mutex is held for the length of an exposure, and is shared between the (possibly SCHED_FIFO) guide thread
+ * and normal priority threads, e.g. the housekeeping thread polling the temperature. Priority inheritance stops
+ * a medium priority thread preempting a low priority holder whilst the guide thread waits for the mutex.
+ * If the protocol cannot be set, a default mutex is initialised instead.
+ * @param mutex The address of the mutex to initialise.
+ * @return The return value of pthread_mutex_init, zero on success.
+ * @see #CCD_Driver_Context_Struct
+ */
+static int Driver_Mutex_Initialise(pthread_mutex_t *mutex)
+{
+	pthread_mutexattr_t attr;
+	int retval;
+
+	if(pthread_mutexattr_init(&attr) != 0)
+		return pthread_mutex_init(mutex,NULL);
+	if(pthread_mutexattr_setprotocol(&attr,PTHREAD_PRIO_INHERIT) != 0)
+		retval = pthread_mutex_init(mutex,NULL);
+	else
+		retval = pthread_mutex_init(mutex,&attr);
+	pthread_mutexattr_destroy(&attr);
+	return retval;
+}
+
+/**
+ * Free a context's data item with its free routine (if it has one), and clear it.
+ * The free routine is called without the context's Data_Mutex held.
+ * @param context The context.
+ * @param which Which data item to free.
+ * @see #CCD_Driver_Context_Struct
+ */
+static void Driver_Context_Data_Free(struct CCD_Driver_Context_Struct *context,enum CCD_DRIVER_CONTEXT_DATA which)
+{
+	void (*data_free)(void *data) = NULL;
+	void *data = NULL;
+
+	pthread_mutex_lock(&(context->Data_Mutex));
+	data = context->Data_List[which];
+	data_free = context->Data_Free_List[which];
+	context->Data_List[which] = NULL;
+	context->Data_Free_List[which] = NULL;
+	pthread_mutex_unlock(&(context->Data_Mutex));
+	if((data != NULL)&&(data_free != NULL))
+		(*data_free)(data);
+}
+
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.1  2006/04/28 14:27:23  cjm
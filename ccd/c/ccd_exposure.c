@@ -27,6 +27,7 @@
 #include "ccd_exposure.h"
 #include "ccd_general.h"
 #include "ccd_setup.h"
+#include "ccd_trace.h"
 
 /* internal data */
 /**
@@ -36,8 +37,6 @@ static char rcsid[] = "$Id: ccd_exposure.c,v 1.6 2014-01-31 17:23:56 cjm Exp $";
 
 /* internal function declarations */
 static int fexist(char *filename);
-static void Exposure_Flip_X(int ncols,int nrows,unsigned short *exposure_data);
-static void Exposure_Flip_Y(int ncols,int nrows,unsigned short *exposure_data);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -69,9 +68,13 @@ void CCD_Exposure_Initialise(void)
  * @param buffer_length The length of the buffer in <b>pixels</b>.
  * @return Returns TRUE if the exposure succeeds and the data read out into the buffer, returns FALSE if an error
  *	occurs or the exposure is aborted.
- * @see #Exposure_Flip_X
+ * @see #CCD_Exposure_Flip_X
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_driver.html#CCD_Driver_Lock
+ * @see ccd_driver.html#CCD_Driver_Unlock
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -85,6 +88,7 @@ int CCD_Exposure_Expose(int open_shutter,struct timespec start_time,int exposure
 			void *buffer,size_t buffer_length)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -101,18 +105,24 @@ int CCD_Exposure_Expose(int open_shutter,struct timespec start_time,int exposure
 		sprintf(CCD_General_Error_String,"CCD_Exposure_Expose:Exposure_Expose function was NULL.");
 		return FALSE;
 	}
-	/* call driver function */
+	/* call driver function, serialized against other exposure/temperature driver calls */
+	if(!CCD_Driver_Lock())
+		return FALSE;
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Exposure_Expose))(open_shutter,start_time,exposure_time,buffer,buffer_length);
+	CCD_Trace_Record("Exposure_Expose",trace_start_time,retval,"open_shutter=%d,exposure_time=%d,buffer_length=%lu",
+			 open_shutter,exposure_time,(unsigned long)buffer_length);
+	CCD_Driver_Unlock();
 	if(retval == FALSE)
 		return FALSE;
 	/* do we need to flip the output data */
 	if(CCD_Setup_Get_Flip_X())
 	{
-		Exposure_Flip_X(CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),buffer);
+		CCD_Exposure_Flip_X(CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),buffer);
 	}
 	if(CCD_Setup_Get_Flip_Y())
 	{
-		Exposure_Flip_Y(CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),buffer);
+		CCD_Exposure_Flip_Y(CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),buffer);
 	}
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_exposure.c","CCD_Exposure_Expose",LOG_VERBOSITY_VERY_TERSE,NULL,"finished.");
@@ -128,9 +138,13 @@ int CCD_Exposure_Expose(int open_shutter,struct timespec start_time,int exposure
  * @param buffer_length The length of the buffer in bytes.
  * @return Returns TRUE if the exposure succeeds and the data read out into the buffer, returns FALSE if an error
  *	occurs or the exposure is aborted.
- * @see #Exposure_Flip_X
+ * @see #CCD_Exposure_Flip_X
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_driver.html#CCD_Driver_Lock
+ * @see ccd_driver.html#CCD_Driver_Unlock
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -143,6 +157,7 @@ int CCD_Exposure_Expose(int open_shutter,struct timespec start_time,int exposure
 int CCD_Exposure_Bias(void *buffer,size_t buffer_length)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -159,18 +174,23 @@ int CCD_Exposure_Bias(void *buffer,size_t buffer_length)
 		sprintf(CCD_General_Error_String,"CCD_Exposure_Bias:Exposure_Bias function was NULL.");
 		return FALSE;
 	}
-	/* call driver function */
+	/* call driver function, serialized against other exposure/temperature driver calls */
+	if(!CCD_Driver_Lock())
+		return FALSE;
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Exposure_Bias))(buffer,buffer_length);
+	CCD_Trace_Record("Exposure_Bias",trace_start_time,retval,"buffer_length=%lu",(unsigned long)buffer_length);
+	CCD_Driver_Unlock();
 	if(retval == FALSE)
 		return FALSE;
 	/* do we need to flip the output data */
 	if(CCD_Setup_Get_Flip_X())
 	{
-		Exposure_Flip_X(CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),buffer);
+		CCD_Exposure_Flip_X(CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),buffer);
 	}
 	if(CCD_Setup_Get_Flip_Y())
 	{
-		Exposure_Flip_Y(CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),buffer);
+		CCD_Exposure_Flip_Y(CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),buffer);
 	}
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_exposure.c","CCD_Exposure_Bias",LOG_VERBOSITY_TERSE,NULL,"finished.");
@@ -183,6 +203,8 @@ int CCD_Exposure_Bias(void *buffer,size_t buffer_length)
  * @return Returns TRUE if the routine succeeds and FALSE if an error occurs.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -191,6 +213,7 @@ int CCD_Exposure_Bias(void *buffer,size_t buffer_length)
 int CCD_Exposure_Abort(void)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -208,7 +231,9 @@ int CCD_Exposure_Abort(void)
 		return FALSE;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Exposure_Abort))();
+	CCD_Trace_Record("Exposure_Abort",trace_start_time,retval,"");
 	if(retval == FALSE)
 		return FALSE;
 #ifdef CCD_DEBUG
@@ -222,6 +247,8 @@ int CCD_Exposure_Abort(void)
  * @return The time stamp for the start of the exposure.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -230,6 +257,7 @@ int CCD_Exposure_Abort(void)
 int CCD_Exposure_Get_Exposure_Start_Time(struct timespec *timespec)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -256,7 +284,9 @@ int CCD_Exposure_Get_Exposure_Start_Time(struct timespec *timespec)
 		return FALSE;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	(*timespec) = (*(functions.Exposure_Get_Exposure_Start_Time))();
+	CCD_Trace_Record("Exposure_Get_Exposure_Start_Time",trace_start_time,TRUE,"");
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_exposure.c","CCD_Exposure_Get_Exposure_Start_Time",LOG_VERBOSITY_VERY_VERBOSE,
 			NULL,"finished.");
@@ -270,6 +300,8 @@ int CCD_Exposure_Get_Exposure_Start_Time(struct timespec *timespec)
  * @return Returns TRUE if the routine succeeds and FALSE if an error occurs.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -278,6 +310,7 @@ int CCD_Exposure_Get_Exposure_Start_Time(struct timespec *timespec)
 int CCD_Exposure_Loop_Pause_Length_Set(int ms)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -297,7 +330,9 @@ int CCD_Exposure_Loop_Pause_Length_Set(int ms)
 		return FALSE;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Exposure_Loop_Pause_Length_Set))(ms);
+	CCD_Trace_Record("Exposure_Loop_Pause_Length_Set",trace_start_time,retval,"ms=%d",ms);
 	if(retval == FALSE)
 		return FALSE;
 #ifdef CCD_DEBUG
@@ -403,28 +438,9 @@ int CCD_Exposure_Save(char *filename,void *buffer,size_t buffer_length,int ncols
 	return TRUE;
 }
 
-/* ----------------------------------------------------------------------------
-** 		internal functions 
-** ---------------------------------------------------------------------------- */
-
 /**
- * Return whether the specified filename exists or not.
- * @param filename A string representing the filename to test.
- * @return The routine returns TRUE if the filename exists, and FALSE if it does not exist. 
- */
-static int fexist(char *filename)
-{
-	FILE *fptr = NULL;
-
-	fptr = fopen(filename,"r");
-	if(fptr == NULL )
-		return FALSE;
-	fclose(fptr);
-	return TRUE;
-}
-
-/**
- * Flip the image data in the X direction.
+ * Flip the image data in the X direction. Called by CCD_Exposure_Expose/CCD_Exposure_Bias when the setup
+ * code has been configured to do this, and callable directly (e.g. by benchmarks).
  * @param ncols The number of columns in the image data.
  * @param nrows The number of rows in the image data.
  * @param exposure_data The image data received from the CCD, as an unsigned short. 
@@ -434,13 +450,13 @@ static int fexist(char *filename)
  * @see ccd_general.html#CCD_General_Error_Number
  * @see ccd_general.html#CCD_General_Error_String
  */
-static void Exposure_Flip_X(int ncols,int nrows,unsigned short *exposure_data)
+void CCD_Exposure_Flip_X(int ncols,int nrows,unsigned short *exposure_data)
 {
 	int x,y;
 	unsigned short int tempval;
 
 #ifdef CCD_DEBUG
-	CCD_General_Log_Format("ccd","ccd_exposure.c","Exposure_Flip_X",LOG_VERBOSITY_INTERMEDIATE,"exposure",
+	CCD_General_Log_Format("ccd","ccd_exposure.c","CCD_Exposure_Flip_X",LOG_VERBOSITY_INTERMEDIATE,"exposure",
 				  "Started flipping image of size (%d,%d) in X.",ncols,nrows);
 #endif
 	/* for each row */
@@ -460,12 +476,13 @@ static void Exposure_Flip_X(int ncols,int nrows,unsigned short *exposure_data)
 		}
 	}
 #ifdef CCD_DEBUG
-	CCD_General_Log("ccd","ccd_exposure.c","Exposure_Flip_X",LOG_VERBOSITY_INTERMEDIATE,"exposure","Finished.");
+	CCD_General_Log("ccd","ccd_exposure.c","CCD_Exposure_Flip_X",LOG_VERBOSITY_INTERMEDIATE,"exposure","Finished.");
 #endif
 }
 
 /**
- * Flip the image data in the Y direction.
+ * Flip the image data in the Y direction. Called by CCD_Exposure_Expose/CCD_Exposure_Bias when the setup
+ * code has been configured to do this, and callable directly (e.g. by benchmarks).
  * @param ncols The number of columns in the image data.
  * @param nrows The number of rows in the image data.
  * @param exposure_data The image data received from the CCD, as an unsigned short. 
@@ -475,13 +492,13 @@ static void Exposure_Flip_X(int ncols,int nrows,unsigned short *exposure_data)
  * @see ccd_general.html#CCD_General_Error_Number
  * @see ccd_general.html#CCD_General_Error_String
  */
-static void Exposure_Flip_Y(int ncols,int nrows,unsigned short *exposure_data)
+void CCD_Exposure_Flip_Y(int ncols,int nrows,unsigned short *exposure_data)
 {
 	int x,y;
 	unsigned short int tempval;
 
 #ifdef CCD_DEBUG
-	CCD_General_Log_Format("ccd","ccd_exposure.c","Exposure_Flip_Y",LOG_VERBOSITY_INTERMEDIATE,"exposure",
+	CCD_General_Log_Format("ccd","ccd_exposure.c","CCD_Exposure_Flip_Y",LOG_VERBOSITY_INTERMEDIATE,"exposure",
 				  "Started flipping image of size (%d,%d) in Y.",ncols,nrows);
 #endif
 	/* for the first half of the rows.
@@ -501,10 +518,29 @@ static void Exposure_Flip_Y(int ncols,int nrows,unsigned short *exposure_data)
 		}
 	}
 #ifdef CCD_DEBUG
-	CCD_General_Log("ccd","ccd_exposure.c","Exposure_Flip_Y",LOG_VERBOSITY_INTERMEDIATE,"exposure","Finished.");
+	CCD_General_Log("ccd","ccd_exposure.c","CCD_Exposure_Flip_Y",LOG_VERBOSITY_INTERMEDIATE,"exposure","Finished.");
 #endif
 }
 
+/* ----------------------------------------------------------------------------
+** 		internal functions 
+** ---------------------------------------------------------------------------- */
+
+/**
+ * Return whether the specified filename exists or not.
+ * @param filename A string representing the filename to test.
+ * @return The routine returns TRUE if the filename exists, and FALSE if it does not exist. 
+ */
+static int fexist(char *filename)
+{
+	FILE *fptr = NULL;
+
+	fptr = fopen(filename,"r");
+	if(fptr == NULL )
+		return FALSE;
+	fclose(fptr);
+	return TRUE;
+}
 
 /*
 ** $Log: not supported by cvs2svn $
@@ -24,6 +24,7 @@
 #include "ccd_driver.h"
 #include "ccd_general.h"
 #include "ccd_setup.h"
+#include "ccd_trace.h"
 
 /* internal data */
 /**
@@ -49,12 +50,14 @@ struct Setup_Struct
 
 /* internal variables */
 /**
- * Internal setup Data.
+ * Initial setup data, copied into each driver context's setup data when it is first used.
  * @see #Setup_Struct
+ * @see #Setup_Data_Get
  */
-static struct Setup_Struct Setup_Data = {FALSE,FALSE};
+static struct Setup_Struct Setup_Data_Initial = {FALSE,FALSE};
 
 /* internal functions */
+static struct Setup_Struct *Setup_Data_Get(void);
 static int Setup_Dimensions_Flip(int ncols,int nrows,int nsbin,int npbin,int window_flags,
 				 struct CCD_Setup_Window_Struct window,struct CCD_Setup_Window_Struct *flipped_window);
 
@@ -63,8 +66,9 @@ static int Setup_Dimensions_Flip(int ncols,int nrows,int nsbin,int npbin,int win
 ** ---------------------------------------------------------------------------- */
 /**
  * Load the flip data from the ccd config file, which should be initialised and loaded before this routine is called.
+ * The flip data is kept per driver context (camera), so this should be called in each context.
  * @return The routine returns TRUE on success, and FALSE if an error occurs.
- * @see #Setup_Data
+ * @see #Setup_Data_Get
  * @see ccd_config.html#CCD_Config_Get_Boolean
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
@@ -73,12 +77,17 @@ static int Setup_Dimensions_Flip(int ncols,int nrows,int nsbin,int npbin,int win
  */
 int CCD_Setup_Initialise(void)
 {
+	struct Setup_Struct *setup_data = NULL;
+
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_setup.c","CCD_Setup_Initialise",LOG_VERBOSITY_VERY_VERBOSE,NULL,"started.");
 #endif
-	if(!CCD_Config_Get_Boolean("ccd.flip.x",&(Setup_Data.Flip_X)))
+	setup_data = Setup_Data_Get();
+	if(setup_data == NULL)
+		return FALSE;
+	if(!CCD_Config_Get_Boolean("ccd.flip.x",&(setup_data->Flip_X)))
 		return FALSE;
-	if(!CCD_Config_Get_Boolean("ccd.flip.y",&(Setup_Data.Flip_Y)))
+	if(!CCD_Config_Get_Boolean("ccd.flip.y",&(setup_data->Flip_Y)))
 		return FALSE;
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_setup.c","CCD_Setup_Initialise",LOG_VERBOSITY_VERY_VERBOSE,NULL,"finished.");
@@ -91,6 +100,8 @@ int CCD_Setup_Initialise(void)
  * @return The routine returns TRUE on success, and FALSE if an error occurs.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -99,6 +110,7 @@ int CCD_Setup_Initialise(void)
 int CCD_Setup_Startup(void)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -116,7 +128,9 @@ int CCD_Setup_Startup(void)
 		return FALSE;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Setup_Startup))();
+	CCD_Trace_Record("Setup_Startup",trace_start_time,retval,"");
 	if(retval == FALSE)
 		return FALSE;
 #ifdef CCD_DEBUG
@@ -130,6 +144,8 @@ int CCD_Setup_Startup(void)
  * @return The routine returns TRUE on success, and FALSE if an error occurs.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -138,6 +154,7 @@ int CCD_Setup_Startup(void)
 int CCD_Setup_Shutdown(void)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -155,7 +172,9 @@ int CCD_Setup_Shutdown(void)
 		return FALSE;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Setup_Shutdown))();
+	CCD_Trace_Record("Setup_Shutdown",trace_start_time,retval,"");
 	if(retval == FALSE)
 		return FALSE;
 #ifdef CCD_DEBUG
@@ -178,6 +197,8 @@ int CCD_Setup_Shutdown(void)
  * @see #Setup_Dimensions_Flip
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -187,6 +208,7 @@ int CCD_Setup_Dimensions_Check(int *ncols,int *nrows,int *nsbin,int *npbin,
 			       int window_flags,struct CCD_Setup_Window_Struct *window)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	struct CCD_Setup_Window_Struct buffer_window,ccd_window;
 	int retval,buffer_ncols,buffer_nrows,buffer_nsbin,buffer_npbin;
 	
@@ -260,7 +282,11 @@ int CCD_Setup_Dimensions_Check(int *ncols,int *nrows,int *nsbin,int *npbin,
 		return FALSE;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Setup_Dimensions_Check))(ncols,nrows,nsbin,npbin,window_flags,&ccd_window);
+	CCD_Trace_Record("Setup_Dimensions_Check",trace_start_time,retval,
+			 "ncols=%d,nrows=%d,nsbin=%d,npbin=%d,window_flags=%d,window=%d:%d:%d:%d",
+			 (*ncols),(*nrows),(*nsbin),(*npbin),window_flags,ccd_window.X_Start,ccd_window.Y_Start,ccd_window.X_End,ccd_window.Y_End);
 	if(retval == FALSE)
 		return FALSE;
 #ifdef CCD_DEBUG
@@ -304,6 +330,8 @@ int CCD_Setup_Dimensions_Check(int *ncols,int *nrows,int *nsbin,int *npbin,
  * @see #Setup_Dimensions_Flip
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -313,6 +341,7 @@ int CCD_Setup_Dimensions(int ncols,int nrows,int nsbin,int npbin,
 			 int window_flags,struct CCD_Setup_Window_Struct window)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	struct CCD_Setup_Window_Struct ccd_window;
 	int retval;
 
@@ -347,7 +376,11 @@ int CCD_Setup_Dimensions(int ncols,int nrows,int nsbin,int npbin,
 		return FALSE;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Setup_Dimensions))(ncols,nrows,nsbin,npbin,window_flags,ccd_window);
+	CCD_Trace_Record("Setup_Dimensions",trace_start_time,retval,
+			 "ncols=%d,nrows=%d,nsbin=%d,npbin=%d,window_flags=%d,window=%d:%d:%d:%d",
+			 ncols,nrows,nsbin,npbin,window_flags,ccd_window.X_Start,ccd_window.Y_Start,ccd_window.X_End,ccd_window.Y_End);
 	if(retval == FALSE)
 		return FALSE;
 #ifdef CCD_DEBUG
@@ -360,6 +393,8 @@ int CCD_Setup_Dimensions(int ncols,int nrows,int nsbin,int npbin,
  * Try to abort a setup.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -368,6 +403,7 @@ int CCD_Setup_Dimensions(int ncols,int nrows,int nsbin,int npbin,
 void CCD_Setup_Abort(void)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -385,7 +421,9 @@ void CCD_Setup_Abort(void)
 		return;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	(*(functions.Setup_Abort))();
+	CCD_Trace_Record("Setup_Abort",trace_start_time,TRUE,"");
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_setup.c","CCD_Setup_Abort",LOG_VERBOSITY_TERSE,NULL,"finished.");
 #endif
@@ -396,6 +434,8 @@ void CCD_Setup_Abort(void)
  * @return The number of binned column pixels, or -1 if an internal driver related error occured.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -404,6 +444,7 @@ void CCD_Setup_Abort(void)
 int CCD_Setup_Get_NCols(void)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -421,7 +462,9 @@ int CCD_Setup_Get_NCols(void)
 		return -1;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Setup_Get_NCols))();
+	CCD_Trace_Record("Setup_Get_NCols",trace_start_time,retval,"");
 #ifdef CCD_DEBUG
 	CCD_General_Log_Format("ccd","ccd_setup.c","CCD_Setup_Get_NCols",LOG_VERBOSITY_VERY_VERBOSE,NULL,
 			       "finished with ncols %d.",retval);
@@ -434,6 +477,8 @@ int CCD_Setup_Get_NCols(void)
  * @return The number of binned row pixels, or -1 if an internal driver related error occured.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -442,6 +487,7 @@ int CCD_Setup_Get_NCols(void)
 int CCD_Setup_Get_NRows(void)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -459,7 +505,9 @@ int CCD_Setup_Get_NRows(void)
 		return -1;
 	}
 	/* call driver function */
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Setup_Get_NRows))();
+	CCD_Trace_Record("Setup_Get_NRows",trace_start_time,retval,"");
 #ifdef CCD_DEBUG
 	CCD_General_Log_Format("ccd","ccd_setup.c","CCD_Setup_Get_NRows",LOG_VERBOSITY_VERY_VERBOSE,NULL,
 			       "finished with nrows %d.",retval);
@@ -469,22 +517,34 @@ int CCD_Setup_Get_NRows(void)
 
 /**
  * Return whether or not we are configured to flip read-out image data in the X direction.
- * @return A boolean as an integer, true if the read-out image data should be flipped in X and false if it is not flipped.
- * @see #Setup_Data
+ * @return A boolean as an integer, true if the read-out image data should be flipped in X and false if it is not flipped
+ *         (or the setup data could not be allocated).
+ * @see #Setup_Data_Get
  */
 int CCD_Setup_Get_Flip_X(void)
 {
-	return Setup_Data.Flip_X;
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	if(setup_data == NULL)
+		return FALSE;
+	return setup_data->Flip_X;
 }
 
 /**
  * Return whether or not we are configured to flip read-out image data in the Y direction.
- * @return A boolean as an integer, true if the read-out image data should be flipped in Y and false if it is not flipped.
- * @see #Setup_Data
+ * @return A boolean as an integer, true if the read-out image data should be flipped in Y and false if it is not flipped
+ *         (or the setup data could not be allocated).
+ * @see #Setup_Data_Get
  */
 int CCD_Setup_Get_Flip_Y(void)
 {
-	return Setup_Data.Flip_Y;
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	if(setup_data == NULL)
+		return FALSE;
+	return setup_data->Flip_Y;
 }
 
 /* ----------------------------------------------------------------------------
@@ -503,10 +563,10 @@ int CCD_Setup_Get_Flip_Y(void)
  * @param window A structure containing window data. These dimensions are inclusive, and in binned pixels.
  * @param window A pointer to a structure containing window data. On a successful return from the function, if
  *        window_flags are true, these will contain a window whose coordinates are flipped in the direction
- *        configured by Setup_Data.Flip_X/Setup_Data.Flip_X, taking into account the binned detector dimensions 
+ *        configured by the setup data Flip_X/Flip_Y, taking into account the binned detector dimensions 
  *        computer from ncols/nrows/hbin/vbin/.
  * @return The routine returns TRUE on success, and FALSE if an error occurs.
- * @see #Setup_Data
+ * @see #Setup_Data_Get
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_General_Error_Number
@@ -515,6 +575,7 @@ int CCD_Setup_Get_Flip_Y(void)
 static int Setup_Dimensions_Flip(int ncols,int nrows,int hbin,int vbin,int window_flags,
 				 struct CCD_Setup_Window_Struct window,struct CCD_Setup_Window_Struct *flipped_window)
 {
+	struct Setup_Struct *setup_data = NULL;
 	int binned_ncols;
 	int binned_nrows;
 
@@ -546,11 +607,14 @@ static int Setup_Dimensions_Flip(int ncols,int nrows,int hbin,int vbin,int windo
 	/* compute binned image size */
 	binned_ncols = ncols/hbin;
 	binned_nrows = nrows/vbin;
+	setup_data = Setup_Data_Get();
+	if(setup_data == NULL)
+		return FALSE;
 	/* flip window if setup to do so
 	** The input window should have X_Start < X_End, and Y_Start < Y_End.
 	** The output window also needs to have X_Start < X_End, and Y_Start < Y_End.
 	** Therefore the output window X|Y_Start is derived from the input window X|Y_End, and visa versa. */
-	if(Setup_Data.Flip_X)
+	if(setup_data->Flip_X)
 	{
 		flipped_window->X_Start = binned_ncols-window.X_End;
 		flipped_window->X_End = binned_ncols-window.X_Start;
@@ -560,7 +624,7 @@ static int Setup_Dimensions_Flip(int ncols,int nrows,int hbin,int vbin,int windo
 		flipped_window->X_Start = window.X_Start;
 		flipped_window->X_End = window.X_End;
 	}
-	if(Setup_Data.Flip_Y)
+	if(setup_data->Flip_Y)
 	{
 		flipped_window->Y_Start = binned_nrows-window.Y_End;
 		flipped_window->Y_End = binned_nrows-window.Y_Start;
@@ -573,6 +637,24 @@ static int Setup_Dimensions_Flip(int ncols,int nrows,int hbin,int vbin,int windo
 	return TRUE;
 }
 
+/**
+ * Get the setup data of the calling thread's driver context (camera), allocating it from
+ * Setup_Data_Initial the first time it is used in each context.
+ * @return The setup data, or NULL if it could not be allocated (the error has been set).
+ * @see #Setup_Struct
+ * @see #Setup_Data_Initial
+ * @see ccd_driver.html#CCD_Driver_Context_Data_Create
+ */
+static struct Setup_Struct *Setup_Data_Get(void)
+{
+	void *setup_data = NULL;
+
+	if(!CCD_Driver_Context_Data_Create(CCD_DRIVER_CONTEXT_DATA_SETUP,sizeof(struct Setup_Struct),
+					   &Setup_Data_Initial,&setup_data))
+		return NULL;
+	return (struct Setup_Struct *)setup_data;
+}
+
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.1  2006/06/01 15:27:37  cjm
@@ -23,6 +23,7 @@
 #include "ccd_driver.h"
 #include "ccd_general.h"
 #include "ccd_temperature.h"
+#include "ccd_trace.h"
 
 /* internal data */
 /**
@@ -51,10 +52,14 @@ struct Temperature_Struct
 
 /* internal variables */
 /**
- * Internal temperature Data.
+ * Initial temperature data, copied into each driver context's temperature data when it is first used.
  * @see #Temperature_Struct
+ * @see #Temperature_Data_Get
  */
-static struct Temperature_Struct Temperature_Data = {0.0,0.0,CCD_TEMPERATURE_STATUS_UNKNOWN,{0,0L}};
+static struct Temperature_Struct Temperature_Data_Initial = {0.0,0.0,CCD_TEMPERATURE_STATUS_UNKNOWN,{0,0L}};
+
+/* internal functions */
+static struct Temperature_Struct *Temperature_Data_Get(void);
 
 /* ----------------------------------------------------------------------------
 ** 		external functions 
@@ -65,10 +70,14 @@ static struct Temperature_Struct Temperature_Data = {0.0,0.0,CCD_TEMPERATURE_STA
  * @param temperature The address of a double to return ther temperature in, in degrees centigrade.
  * @param temperature_status The address of a enum to store the temperature status.
  * @return Returns TRUE on success, and FALSE if an error occurs.
- * @see #Temperature_Data
+ * @see #Temperature_Data_Get
  * @see ccd_temperature.html#CCD_TEMPERATURE_STATUS
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_driver.html#CCD_Driver_Lock
+ * @see ccd_driver.html#CCD_Driver_Unlock
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_CCD_General_Error_Number
@@ -76,7 +85,9 @@ static struct Temperature_Struct Temperature_Data = {0.0,0.0,CCD_TEMPERATURE_STA
  */
 int CCD_Temperature_Get(double *temperature,enum CCD_TEMPERATURE_STATUS *temperature_status)
 {
+	struct Temperature_Struct *temperature_data = NULL;
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -94,14 +105,22 @@ int CCD_Temperature_Get(double *temperature,enum CCD_TEMPERATURE_STATUS *tempera
 		sprintf(CCD_General_Error_String,"CCD_Temperature_Get:Temperature_Get function was NULL.");
 		return FALSE;
 	}
-	/* call driver function */
+	/* call driver function, serialized against other exposure/temperature driver calls */
+	if(!CCD_Driver_Lock())
+		return FALSE;
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Temperature_Get))(temperature,temperature_status);
+	CCD_Trace_Record("Temperature_Get",trace_start_time,retval,"");
+	CCD_Driver_Unlock();
 	if(retval == FALSE)
 		return FALSE;
 	/* update temperature cache data */
-	Temperature_Data.Cached_Temperature = (*temperature);
-	Temperature_Data.Cached_Temperature_Status = (*temperature_status);
-	clock_gettime(CLOCK_REALTIME,&(Temperature_Data.Cache_Date_Stamp));
+	temperature_data = Temperature_Data_Get();
+	if(temperature_data == NULL)
+		return FALSE;
+	temperature_data->Cached_Temperature = (*temperature);
+	temperature_data->Cached_Temperature_Status = (*temperature_status);
+	clock_gettime(CLOCK_REALTIME,&(temperature_data->Cache_Date_Stamp));
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_temperature.c","CCD_Temperature_Get",LOG_VERBOSITY_INTERMEDIATE,NULL,
 			"finished.");
@@ -113,10 +132,14 @@ int CCD_Temperature_Get(double *temperature,enum CCD_TEMPERATURE_STATUS *tempera
  * Set the current target temperature of the CCD. The cooler also needs to be switched on for this to take effect.
  * @param temperature The temperature to ramp the CCD to, in degrees centigrade.
  * @return Returns TRUE on success, and FALSE if an error occurs.
- * @see #Temperature_Data
+ * @see #Temperature_Data_Get
  * @see ccd_temperature.html#CCD_TEMPERATURE_STATUS
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_driver.html#CCD_Driver_Lock
+ * @see ccd_driver.html#CCD_Driver_Unlock
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_CCD_General_Error_Number
@@ -124,7 +147,9 @@ int CCD_Temperature_Get(double *temperature,enum CCD_TEMPERATURE_STATUS *tempera
  */
 int CCD_Temperature_Set(double target_temperature)
 {
+	struct Temperature_Struct *temperature_data = NULL;
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -142,12 +167,20 @@ int CCD_Temperature_Set(double target_temperature)
 		sprintf(CCD_General_Error_String,"CCD_Temperature_Set:Temperature_Set function was NULL.");
 		return FALSE;
 	}
-	/* call driver function */
+	/* call driver function, serialized against other exposure/temperature driver calls */
+	if(!CCD_Driver_Lock())
+		return FALSE;
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Temperature_Set))(target_temperature);
+	CCD_Trace_Record("Temperature_Set",trace_start_time,retval,"target_temperature=%.2f",target_temperature);
+	CCD_Driver_Unlock();
 	if(retval == FALSE)
 		return FALSE;
 	/* save target temperature in cache. */
-	Temperature_Data.Target_Temperature = target_temperature;
+	temperature_data = Temperature_Data_Get();
+	if(temperature_data == NULL)
+		return FALSE;
+	temperature_data->Target_Temperature = target_temperature;
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_temperature.c","CCD_Temperature_Set",LOG_VERBOSITY_INTERMEDIATE,NULL,
 			"finished.");
@@ -160,6 +193,10 @@ int CCD_Temperature_Set(double target_temperature)
  * @return Returns TRUE on success, and FALSE if an error occurs.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_driver.html#CCD_Driver_Lock
+ * @see ccd_driver.html#CCD_Driver_Unlock
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_CCD_General_Error_Number
@@ -168,6 +205,7 @@ int CCD_Temperature_Set(double target_temperature)
 int CCD_Temperature_Cooler_On(void)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -185,8 +223,13 @@ int CCD_Temperature_Cooler_On(void)
 		sprintf(CCD_General_Error_String,"CCD_Temperature_Cooler_On:Temperature_Cooler_On function was NULL.");
 		return FALSE;
 	}
-	/* call driver function */
+	/* call driver function, serialized against other exposure/temperature driver calls */
+	if(!CCD_Driver_Lock())
+		return FALSE;
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Temperature_Cooler_On))();
+	CCD_Trace_Record("Temperature_Cooler_On",trace_start_time,retval,"");
+	CCD_Driver_Unlock();
 	if(retval == FALSE)
 		return FALSE;
 #ifdef CCD_DEBUG
@@ -201,6 +244,10 @@ int CCD_Temperature_Cooler_On(void)
  * @return Returns TRUE on success, and FALSE if an error occurs.
  * @see ccd_driver.html#CCD_Driver_Get_Functions
  * @see ccd_driver.html#CCD_Driver_Function_Struct
+ * @see ccd_driver.html#CCD_Driver_Lock
+ * @see ccd_driver.html#CCD_Driver_Unlock
+ * @see ccd_trace.html#CCD_Trace_Start
+ * @see ccd_trace.html#CCD_Trace_Record
  * @see ccd_general.html#CCD_General_Log_Format
  * @see ccd_general.html#CCD_General_Log
  * @see ccd_general.html#CCD_CCD_General_Error_Number
@@ -209,6 +256,7 @@ int CCD_Temperature_Cooler_On(void)
 int CCD_Temperature_Cooler_Off(void)
 {
 	struct CCD_Driver_Function_Struct functions;
+	struct timespec trace_start_time;
 	int retval;
 
 #ifdef CCD_DEBUG
@@ -227,8 +275,13 @@ int CCD_Temperature_Cooler_Off(void)
 			"Temperature_Cooler_Off function was NULL.");
 		return FALSE;
 	}
-	/* call driver function */
+	/* call driver function, serialized against other exposure/temperature driver calls */
+	if(!CCD_Driver_Lock())
+		return FALSE;
+	CCD_Trace_Start(&trace_start_time);
 	retval = (*(functions.Temperature_Cooler_Off))();
+	CCD_Trace_Record("Temperature_Cooler_Off",trace_start_time,retval,"");
+	CCD_Driver_Unlock();
 	if(retval == FALSE)
 		return FALSE;
 #ifdef CCD_DEBUG
@@ -245,50 +298,54 @@ int CCD_Temperature_Cooler_Off(void)
  *        temperature status.
  * @param cache_date_stamp A pointer to a struct timespec. If non-null, on return filled with the cache date stamp.
  * @return The routine returns TRUE if successful, and FALSE if it fails.
- * @see #Temperature_Data
+ * @see #Temperature_Data_Get
  * @see #CCD_Temperature_Status_To_String
  * @see #CCD_TEMPERATURE_STATUS
  */
 int CCD_Temperature_Cached_Temperature_Get(double *temperature,enum CCD_TEMPERATURE_STATUS *temperature_status,
 					   struct timespec *cache_date_stamp)
 {
+	struct Temperature_Struct *temperature_data = NULL;
 	char time_buff[32];
 
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_temperature.c","CCD_Temperature_Cached_Temperature_Get",LOG_VERBOSITY_VERBOSE,NULL,
 		       "CCD_Temperature_Cached_Temperature_Get() started.");
 #endif
+	temperature_data = Temperature_Data_Get();
+	if(temperature_data == NULL)
+		return FALSE;
 	if(temperature != NULL)
 	{
-		(*temperature) = Temperature_Data.Cached_Temperature;
+		(*temperature) = temperature_data->Cached_Temperature;
 #ifdef CCD_DEBUG
 		CCD_General_Log_Format("ccd","ccd_temperature.c","CCD_Temperature_Cached_Temperature_Get",
 				      LOG_VERBOSITY_VERBOSE,NULL,
 				      "CCD_Temperature_Cached_Temperature_Get() found cached temperature %.2f.",
-				      Temperature_Data.Cached_Temperature);
+				      temperature_data->Cached_Temperature);
 #endif
 	}
 	if(temperature_status != NULL)
 	{
-		(*temperature_status) = Temperature_Data.Cached_Temperature_Status;
+		(*temperature_status) = temperature_data->Cached_Temperature_Status;
 #ifdef CCD_DEBUG
 		CCD_General_Log_Format("ccd","ccd_temperature.c","CCD_Temperature_Cached_Temperature_Get",
 				      LOG_VERBOSITY_VERBOSE,NULL,
 				   "CCD_Temperature_Cached_Temperature_Get() found cached temperature status %d(%s).",
-				      Temperature_Data.Cached_Temperature_Status,
-				      CCD_Temperature_Status_To_String(Temperature_Data.Cached_Temperature_Status));
+				      temperature_data->Cached_Temperature_Status,
+				      CCD_Temperature_Status_To_String(temperature_data->Cached_Temperature_Status));
 #endif
 	}
 	if(cache_date_stamp != NULL)
 	{
-		(*cache_date_stamp) = Temperature_Data.Cache_Date_Stamp;
+		(*cache_date_stamp) = temperature_data->Cache_Date_Stamp;
 
 #ifdef CCD_DEBUG
-		CCD_General_Get_Time_String(Temperature_Data.Cache_Date_Stamp,time_buff,31);
+		CCD_General_Get_Time_String(temperature_data->Cache_Date_Stamp,time_buff,31);
 		CCD_General_Log_Format("ccd","ccd_temperature.c","CCD_Temperature_Cached_Temperature_Get",
 				      LOG_VERBOSITY_VERBOSE,NULL,
 				      "CCD_Temperature_Cached_Temperature_Get() found cache date stamp %d(%s).",
-				      Temperature_Data.Cache_Date_Stamp.tv_sec,time_buff);
+				      temperature_data->Cache_Date_Stamp.tv_sec,time_buff);
 #endif
 	}
 #ifdef CCD_DEBUG
@@ -302,16 +359,21 @@ int CCD_Temperature_Cached_Temperature_Get(double *temperature,enum CCD_TEMPERAT
  * Routine to get the last temperature target sent to the temperature controller.
  * @param target_temperature The address of a double to store the last target temperature.
  * @return The routine returns TRUE if successful, and FALSE if it fails.
- * @see #Temperature_Data
+ * @see #Temperature_Data_Get
  */
 int CCD_Temperature_Target_Temperature_Get(double *target_temperature)
 {
+	struct Temperature_Struct *temperature_data = NULL;
+
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_temperature.c","CCD_Temperature_Target_Temperature_Get",LOG_VERBOSITY_VERBOSE,NULL,
 			"CCD_Temperature_Target_Temperature_Get() started.");
 #endif
+	temperature_data = Temperature_Data_Get();
+	if(temperature_data == NULL)
+		return FALSE;
 	if(target_temperature != NULL)
-		(*target_temperature) = Temperature_Data.Target_Temperature;
+		(*target_temperature) = temperature_data->Target_Temperature;
 #ifdef CCD_DEBUG
 	CCD_General_Log("ccd","ccd_temperature.c","CCD_Temperature_Target_Temperature_Get",LOG_VERBOSITY_VERBOSE,NULL,
 			"CCD_Temperature_Target_Temperature_Get() returned TRUE.");
@@ -346,6 +408,27 @@ char *CCD_Temperature_Status_To_String(enum CCD_TEMPERATURE_STATUS temperature_s
 	return "UNKNOWN";
 }
 
+/* ----------------------------------------------------------------------------
+** 		internal functions 
+** ---------------------------------------------------------------------------- */
+/**
+ * Get the temperature data of the calling thread's driver context (camera), allocating it from
+ * Temperature_Data_Initial the first time it is used in each context.
+ * @return The temperature data, or NULL if it could not be allocated (the error has been set).
+ * @see #Temperature_Struct
+ * @see #Temperature_Data_Initial
+ * @see ccd_driver.html#CCD_Driver_Context_Data_Create
+ */
+static struct Temperature_Struct *Temperature_Data_Get(void)
+{
+	void *temperature_data = NULL;
+
+	if(!CCD_Driver_Context_Data_Create(CCD_DRIVER_CONTEXT_DATA_TEMPERATURE,sizeof(struct Temperature_Struct),
+					   &Temperature_Data_Initial,&temperature_data))
+		return NULL;
+	return (struct Temperature_Struct *)temperature_data;
+}
+
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.2  2009/01/30 18:00:24  cjm
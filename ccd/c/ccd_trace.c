@@ -0,0 +1,315 @@
+/* ccd_trace.c
+** Autoguider CCD Library driver call tracing routines
+** $Header$
+*/
+/**
+ * Driver call tracing routines for the autoguider CCD library.
+ * The ccd_exposure, ccd_setup and ccd_temperature wrappers call CCD_Trace_Start before, and CCD_Trace_Record after,
+ * each call into the driver. When tracing is enabled, each call is recorded into a fixed length ring of
+ * CCD_Trace_Record_Struct, with the call name, a summary of the arguments, the CLOCK_MONOTONIC start and end times
+ * and the result. When tracing is disabled, the cost is one test of Trace_Data.Enable per call.
+ * Writers claim a slot with an atomic increment of Trace_Data.Next_Sequence, so recording never blocks, and
+ * a driver call in the guide thread is never held up by a reader. Each record's Sequence field is zeroed whilst
+ * it is being written and set last, so readers can detect (and skip) records that are being overwritten.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "log_udp.h"
+#include "ccd_general.h"
+#include "ccd_trace.h"
+
+/* hash defines */
+/**
+ * The length of a string holding one Chrome trace event.
+ */
+#define TRACE_CHROME_JSON_EVENT_LENGTH   (512)
+
+/* data types */
+/**
+ * Internal trace data structure.
+ * <dl>
+ * <dt>Enable</dt> <dd>Boolean, whether driver calls are being traced.</dd>
+ * <dt>Next_Sequence</dt> <dd>The sequence number of the last claimed record. Record N lives in slot
+ *     (N-1) % CCD_TRACE_RING_LENGTH.</dd>
+ * <dt>Ring</dt> <dd>The ring of trace records.</dd>
+ * </dl>
+ * @see #CCD_TRACE_RING_LENGTH
+ */
+struct Trace_Struct
+{
+	volatile int Enable;
+	volatile unsigned int Next_Sequence;
+	struct CCD_Trace_Record_Struct Ring[CCD_TRACE_RING_LENGTH];
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Internal trace data.
+ * @see #Trace_Struct
+ */
+static struct Trace_Struct Trace_Data;
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Turn driver call tracing on or off. Records already in the ring are kept.
+ * @param enable A boolean, TRUE to trace driver calls, FALSE to stop tracing them.
+ * @see #Trace_Data
+ */
+void CCD_Trace_Enable_Set(int enable)
+{
+	Trace_Data.Enable = enable;
+#ifdef CCD_DEBUG
+	CCD_General_Log_Format("ccd","ccd_trace.c","CCD_Trace_Enable_Set",LOG_VERBOSITY_INTERMEDIATE,NULL,
+			       "Driver call tracing now %d.",enable);
+#endif
+}
+
+/**
+ * Return whether driver call tracing is enabled.
+ * @return TRUE if driver calls are being traced, FALSE if they are not.
+ * @see #Trace_Data
+ */
+int CCD_Trace_Is_Enabled(void)
+{
+	return Trace_Data.Enable;
+}
+
+/**
+ * Get the start time of a driver call, if tracing is enabled. Call this just before calling the driver function.
+ * @param start_time The address of a timespec to fill in with the CLOCK_MONOTONIC time. If tracing is disabled,
+ *        the fields are set to zero.
+ * @see #Trace_Data
+ */
+void CCD_Trace_Start(struct timespec *start_time)
+{
+	if(Trace_Data.Enable)
+		clock_gettime(CLOCK_MONOTONIC,start_time);
+	else
+	{
+		start_time->tv_sec = 0;
+		start_time->tv_nsec = 0;
+	}
+}
+
+/**
+ * Record a driver call into the trace ring, if tracing is enabled. Call this just after the driver function
+ * returns. If tracing was enabled between CCD_Trace_Start and this call, the call is not recorded.
+ * @param name The name of the driver function. This must be a static string, as only the pointer is stored.
+ * @param start_time The start time returned by CCD_Trace_Start.
+ * @param result The value the driver function returned.
+ * @param format A printf style format for the arguments summary, followed by the arguments.
+ * @see #Trace_Data
+ * @see #CCD_TRACE_RING_LENGTH
+ * @see #CCD_TRACE_ARGUMENTS_LENGTH
+ */
+void CCD_Trace_Record(const char *name,struct timespec start_time,int result,const char *format,...)
+{
+	struct CCD_Trace_Record_Struct *record = NULL;
+	struct timespec end_time;
+	unsigned int sequence;
+	va_list ap;
+
+	if(Trace_Data.Enable == FALSE)
+		return;
+	if((start_time.tv_sec == 0)&&(start_time.tv_nsec == 0))
+		return;
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	/* claim a slot */
+	sequence = __sync_add_and_fetch(&(Trace_Data.Next_Sequence),1);
+	record = &(Trace_Data.Ring[(sequence-1)%CCD_TRACE_RING_LENGTH]);
+	/* mark the record as being written */
+	record->Sequence = 0;
+	__sync_synchronize();
+	record->Name = name;
+	va_start(ap,format);
+	vsnprintf(record->Arguments,CCD_TRACE_ARGUMENTS_LENGTH,format,ap);
+	va_end(ap);
+	record->Start_Time = start_time;
+	record->End_Time = end_time;
+	record->Result = result;
+	record->Thread_Id = (unsigned long)pthread_self();
+	/* publish the record */
+	__sync_synchronize();
+	record->Sequence = sequence;
+}
+
+/**
+ * Empty the trace ring. Records being written whilst the ring is cleared may survive.
+ * @see #Trace_Data
+ * @see #CCD_TRACE_RING_LENGTH
+ */
+void CCD_Trace_Clear(void)
+{
+	int i;
+
+	for(i = 0; i < CCD_TRACE_RING_LENGTH; i++)
+		Trace_Data.Ring[i].Sequence = 0;
+	__sync_synchronize();
+}
+
+/**
+ * Get a copy of the records currently in the trace ring, oldest first. Records that are being written, or that are
+ * overwritten whilst being copied, are skipped.
+ * @param record_list An array of at least max_record_count records to copy the trace into.
+ * @param max_record_count The number of records in record_list.
+ * @param record_count The address of an integer, on return set to the number of records copied.
+ * @return Returns TRUE on success, and FALSE if an error occurs.
+ * @see #Trace_Data
+ * @see #CCD_TRACE_RING_LENGTH
+ */
+int CCD_Trace_Get(struct CCD_Trace_Record_Struct *record_list,int max_record_count,int *record_count)
+{
+	struct CCD_Trace_Record_Struct *record = NULL;
+	unsigned int last_sequence,sequence;
+
+	if(record_list == NULL)
+	{
+		CCD_General_Error_Number = 600;
+		sprintf(CCD_General_Error_String,"CCD_Trace_Get:record_list was NULL.");
+		return FALSE;
+	}
+	if(record_count == NULL)
+	{
+		CCD_General_Error_Number = 601;
+		sprintf(CCD_General_Error_String,"CCD_Trace_Get:record_count was NULL.");
+		return FALSE;
+	}
+	(*record_count) = 0;
+	last_sequence = Trace_Data.Next_Sequence;
+	if(last_sequence > CCD_TRACE_RING_LENGTH)
+		sequence = last_sequence-CCD_TRACE_RING_LENGTH+1;
+	else
+		sequence = 1;
+	for(; (sequence <= last_sequence)&&((*record_count) < max_record_count); sequence++)
+	{
+		record = &(Trace_Data.Ring[(sequence-1)%CCD_TRACE_RING_LENGTH]);
+		if(record->Sequence != sequence)
+			continue;
+		__sync_synchronize();
+		record_list[(*record_count)] = (*record);
+		__sync_synchronize();
+		/* was the record overwritten whilst we were copying it? */
+		if(record->Sequence != sequence)
+			continue;
+		record_list[(*record_count)].Sequence = sequence;
+		(*record_count)++;
+	}
+	return TRUE;
+}
+
+/**
+ * Format a trace record as a Chrome trace-event format "complete" (ph "X") event, which can be loaded into
+ * chrome://tracing or Perfetto. Timestamps and durations are in microseconds of CLOCK_MONOTONIC.
+ * @param record The record to format.
+ * @param string The string to write the JSON object into.
+ * @param string_length The length of string.
+ * @return Returns TRUE on success, and FALSE if an error occurs.
+ */
+int CCD_Trace_Record_To_Chrome_JSON(struct CCD_Trace_Record_Struct *record,char *string,int string_length)
+{
+	double start_us,duration_us;
+	int retval;
+
+	if(record == NULL)
+	{
+		CCD_General_Error_Number = 602;
+		sprintf(CCD_General_Error_String,"CCD_Trace_Record_To_Chrome_JSON:record was NULL.");
+		return FALSE;
+	}
+	if(string == NULL)
+	{
+		CCD_General_Error_Number = 603;
+		sprintf(CCD_General_Error_String,"CCD_Trace_Record_To_Chrome_JSON:string was NULL.");
+		return FALSE;
+	}
+	start_us = (((double)record->Start_Time.tv_sec)*CCD_GENERAL_ONE_SECOND_US)+
+		(((double)record->Start_Time.tv_nsec)/CCD_GENERAL_ONE_MICROSECOND_NS);
+	duration_us = (((double)(record->End_Time.tv_sec-record->Start_Time.tv_sec))*CCD_GENERAL_ONE_SECOND_US)+
+		(((double)(record->End_Time.tv_nsec-record->Start_Time.tv_nsec))/CCD_GENERAL_ONE_MICROSECOND_NS);
+	/* the arguments are formatted by the ccd library wrappers, and never contain quotes or backslashes */
+	retval = snprintf(string,string_length,"{\"name\":\"%s\",\"cat\":\"ccd\",\"ph\":\"X\",\"ts\":%.3f,"
+			  "\"dur\":%.3f,\"pid\":1,\"tid\":%lu,\"args\":{\"sequence\":%u,\"arguments\":\"%s\","
+			  "\"result\":%d}}",record->Name,start_us,duration_us,record->Thread_Id,record->Sequence,
+			  record->Arguments,record->Result);
+	if((retval < 0)||(retval >= string_length))
+	{
+		CCD_General_Error_Number = 604;
+		sprintf(CCD_General_Error_String,"CCD_Trace_Record_To_Chrome_JSON:"
+			"string too short (%d vs %d).",retval,string_length);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Write the contents of the trace ring to a file, as a Chrome trace-event format JSON document.
+ * @param fp The file to write to.
+ * @return Returns TRUE on success, and FALSE if an error occurs.
+ * @see #TRACE_CHROME_JSON_EVENT_LENGTH
+ * @see #CCD_Trace_Get
+ * @see #CCD_Trace_Record_To_Chrome_JSON
+ */
+int CCD_Trace_Chrome_JSON_Write(FILE *fp)
+{
+	static struct CCD_Trace_Record_Struct record_list[CCD_TRACE_RING_LENGTH];
+	static pthread_mutex_t record_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+	char event_string[TRACE_CHROME_JSON_EVENT_LENGTH];
+	int i,record_count;
+
+	if(fp == NULL)
+	{
+		CCD_General_Error_Number = 605;
+		sprintf(CCD_General_Error_String,"CCD_Trace_Chrome_JSON_Write:fp was NULL.");
+		return FALSE;
+	}
+	/* the copy of the ring is too big for the stack, only one writer at a time uses it */
+	pthread_mutex_lock(&record_list_mutex);
+	if(!CCD_Trace_Get(record_list,CCD_TRACE_RING_LENGTH,&record_count))
+	{
+		pthread_mutex_unlock(&record_list_mutex);
+		return FALSE;
+	}
+	fprintf(fp,"{\"traceEvents\":[\n");
+	for(i = 0; i < record_count; i++)
+	{
+		if(!CCD_Trace_Record_To_Chrome_JSON(&(record_list[i]),event_string,TRACE_CHROME_JSON_EVENT_LENGTH))
+		{
+			pthread_mutex_unlock(&record_list_mutex);
+			return FALSE;
+		}
+		fprintf(fp,"%s%s\n",event_string,(i < (record_count-1)) ? "," : "");
+	}
+	fprintf(fp,"],\"displayTimeUnit\":\"ms\"}\n");
+	pthread_mutex_unlock(&record_list_mutex);
+	if(ferror(fp))
+	{
+		CCD_General_Error_Number = 606;
+		sprintf(CCD_General_Error_String,"CCD_Trace_Chrome_JSON_Write:Failed to write trace.");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
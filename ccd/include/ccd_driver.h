@@ -4,6 +4,8 @@
 #ifndef CCD_DRIVER_H
 #define CCD_DRIVER_H
 
+/* needed for size_t */
+#include <stdlib.h>
 /* needed for struct timespec in function struct */
 #include <time.h>
 /* needed for CCD_Setup_Window_Struct in function struct */
@@ -73,10 +75,44 @@ struct CCD_Driver_Function_Struct
 	int (*Temperature_Cooler_Off)(void);
 };
 
+/**
+ * A driver context, holding one loaded driver, its lock and its per-camera data. The structure is private to
+ * ccd_driver.c.
+ * @see #CCD_Driver_Context_Create
+ */
+struct CCD_Driver_Context_Struct;
+
+/**
+ * Which per-camera data slot of a driver context to get or set.
+ * <ul>
+ * <li><b>CCD_DRIVER_CONTEXT_DATA_SETUP</b> The ccd_setup data (image flip configuration).
+ * <li><b>CCD_DRIVER_CONTEXT_DATA_TEMPERATURE</b> The ccd_temperature data (target and cached temperature).
+ * <li><b>CCD_DRIVER_CONTEXT_DATA_DRIVER</b> The loaded driver's camera state, set by its registration function.
+ *     A driver that sets this is instance-safe, and can be registered in more than one context at once.
+ * <li><b>CCD_DRIVER_CONTEXT_DATA_COUNT</b> The number of slots.
+ * </ul>
+ * @see #CCD_Driver_Context_Data_Get
+ * @see #CCD_Driver_Context_Data_Create
+ * @see #CCD_Driver_Context_Data_Set
+ */
+enum CCD_DRIVER_CONTEXT_DATA
+{
+	CCD_DRIVER_CONTEXT_DATA_SETUP, CCD_DRIVER_CONTEXT_DATA_TEMPERATURE, CCD_DRIVER_CONTEXT_DATA_DRIVER,
+	CCD_DRIVER_CONTEXT_DATA_COUNT
+};
 
 extern int CCD_Driver_Register(char *shared_library_name,char *registration_function);
 extern int CCD_Driver_Get_Functions(struct CCD_Driver_Function_Struct *functions);
 extern int CCD_Driver_Close(void);
+extern int CCD_Driver_Lock(void);
+extern int CCD_Driver_Unlock(void);
+extern int CCD_Driver_Context_Create(struct CCD_Driver_Context_Struct **context);
+extern int CCD_Driver_Context_Select(struct CCD_Driver_Context_Struct *context);
+extern int CCD_Driver_Context_Destroy(struct CCD_Driver_Context_Struct **context);
+extern void *CCD_Driver_Context_Data_Get(enum CCD_DRIVER_CONTEXT_DATA which);
+extern int CCD_Driver_Context_Data_Create(enum CCD_DRIVER_CONTEXT_DATA which,size_t size,void *initial_data,
+					  void **data);
+extern int CCD_Driver_Context_Data_Set(enum CCD_DRIVER_CONTEXT_DATA which,void *data,void (*data_free)(void *data));
 
 /*
 ** $Log: not supported by cvs2svn $
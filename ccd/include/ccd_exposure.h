@@ -61,6 +61,8 @@ extern int CCD_Exposure_Abort(void);
 extern int CCD_Exposure_Get_Exposure_Start_Time(struct timespec *timespec);
 extern int CCD_Exposure_Loop_Pause_Length_Set(int ms);
 extern int CCD_Exposure_Save(char *filename,void *buffer,size_t buffer_length,int ncols,int nrows);
+extern void CCD_Exposure_Flip_X(int ncols,int nrows,unsigned short *exposure_data);
+extern void CCD_Exposure_Flip_Y(int ncols,int nrows,unsigned short *exposure_data);
 
 /*
 ** $Log: not supported by cvs2svn $
@@ -0,0 +1,58 @@
+/* ccd_trace.h
+** $Header$
+*/
+#ifndef CCD_TRACE_H
+#define CCD_TRACE_H
+
+#include <stdio.h>
+#include <time.h>
+
+/* hash defines */
+/**
+ * The number of records in the trace ring. When the ring is full the oldest records are overwritten.
+ */
+#define CCD_TRACE_RING_LENGTH           (4096)
+/**
+ * The length of the arguments summary string in a trace record.
+ */
+#define CCD_TRACE_ARGUMENTS_LENGTH      (96)
+
+/* data types */
+/**
+ * Structure holding one traced driver call.
+ * <dl>
+ * <dt>Sequence</dt> <dd>The sequence number of the call, starting at 1. Zero means the record is empty or
+ *     is being written.</dd>
+ * <dt>Name</dt> <dd>The name of the driver function called (a static string).</dd>
+ * <dt>Arguments</dt> <dd>A summary of the arguments passed to the driver function.</dd>
+ * <dt>Start_Time</dt> <dd>The CLOCK_MONOTONIC time the driver function was called.</dd>
+ * <dt>End_Time</dt> <dd>The CLOCK_MONOTONIC time the driver function returned.</dd>
+ * <dt>Result</dt> <dd>The value returned by the driver function.</dd>
+ * <dt>Thread_Id</dt> <dd>An identifier of the calling thread.</dd>
+ * </dl>
+ * @see #CCD_TRACE_ARGUMENTS_LENGTH
+ */
+struct CCD_Trace_Record_Struct
+{
+	volatile unsigned int Sequence;
+	const char *Name;
+	char Arguments[CCD_TRACE_ARGUMENTS_LENGTH];
+	struct timespec Start_Time;
+	struct timespec End_Time;
+	int Result;
+	unsigned long Thread_Id;
+};
+
+extern void CCD_Trace_Enable_Set(int enable);
+extern int CCD_Trace_Is_Enabled(void);
+extern void CCD_Trace_Start(struct timespec *start_time);
+extern void CCD_Trace_Record(const char *name,struct timespec start_time,int result,const char *format,...);
+extern void CCD_Trace_Clear(void);
+extern int CCD_Trace_Get(struct CCD_Trace_Record_Struct *record_list,int max_record_count,int *record_count);
+extern int CCD_Trace_Record_To_Chrome_JSON(struct CCD_Trace_Record_Struct *record,char *string,int string_length);
+extern int CCD_Trace_Chrome_JSON_Write(FILE *fp);
+
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
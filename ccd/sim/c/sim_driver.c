@@ -0,0 +1,169 @@
+/* sim_driver.c
+** Autoguider simulated CCD camera library driver interface routines
+** $Header$
+*/
+/**
+ * Driver interface routines for the simulated autoguider CCD library.
+ * Each registration creates a new simulated camera (Sim_Driver_Instance_Struct) in the calling thread's CCD driver
+ * context, so the simulated driver can be registered in several contexts at once.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_udp.h"
+#include "ccd_general.h"
+#include "sim_driver.h"
+#include "sim_exposure.h"
+#include "sim_general.h"
+#include "sim_setup.h"
+#include "sim_temperature.h"
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+
+/* internal functions */
+static void Driver_Instance_Free(void *instance);
+
+/* ----------------------------------------------------------------------------
+** 		external functions 
+** ---------------------------------------------------------------------------- */
+/**
+ * Create a new simulated camera instance, and store it as the driver data of the calling thread's CCD driver
+ * context. Then fill in the driver function structure.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Sim_Driver_Instance_Struct
+ * @see #Driver_Instance_Free
+ * @see sim_setup.html#Sim_Setup_Data_Create
+ * @see sim_exposure.html#Sim_Exposure_Data_Create
+ * @see sim_temperature.html#Sim_Temperature_Data_Create
+ * @see ../../cdocs/ccd_driver.html#CCD_Driver_Context_Data_Set
+ * @see sim_setup.html#Sim_Setup_Startup
+ * @see sim_setup.html#Sim_Setup_Dimensions_Check
+ * @see sim_setup.html#Sim_Setup_Dimensions
+ * @see sim_setup.html#Sim_Setup_Abort
+ * @see sim_setup.html#Sim_Setup_Get_NCols
+ * @see sim_setup.html#Sim_Setup_Get_NRows
+ * @see sim_setup.html#Sim_Setup_Shutdown
+ * @see sim_exposure.html#Sim_Exposure_Expose
+ * @see sim_exposure.html#Sim_Exposure_Bias
+ * @see sim_exposure.html#Sim_Exposure_Abort
+ * @see sim_exposure.html#Sim_Exposure_Get_Exposure_Start_Time
+ * @see sim_temperature.html#Sim_Temperature_Get
+ * @see sim_temperature.html#Sim_Temperature_Set
+ * @see sim_temperature.html#Sim_Temperature_Cooler_On
+ * @see sim_temperature.html#Sim_Temperature_Cooler_Off
+ */
+int Sim_Driver_Register(struct CCD_Driver_Function_Struct *functions)
+{
+	struct Sim_Driver_Instance_Struct *instance = NULL;
+
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_driver.c","Sim_Driver_Register",LOG_VERBOSITY_INTERMEDIATE,NULL,
+			"started.");
+#endif
+	if(functions == NULL)
+	{
+		CCD_General_Error_Number = 1000;
+		sprintf(CCD_General_Error_String,"Sim_Driver_Register: functions were NULL.");
+		return FALSE;
+	}
+	/* create this camera's data */
+	instance = (struct Sim_Driver_Instance_Struct *)calloc(1,sizeof(struct Sim_Driver_Instance_Struct));
+	if(instance == NULL)
+	{
+		CCD_General_Error_Number = 1001;
+		sprintf(CCD_General_Error_String,"Sim_Driver_Register: Failed to allocate instance.");
+		return FALSE;
+	}
+	instance->Setup_Data = Sim_Setup_Data_Create();
+	instance->Exposure_Data = Sim_Exposure_Data_Create();
+	instance->Temperature_Data = Sim_Temperature_Data_Create();
+	if((instance->Setup_Data == NULL)||(instance->Exposure_Data == NULL)||(instance->Temperature_Data == NULL))
+	{
+		Driver_Instance_Free(instance);
+		CCD_General_Error_Number = 1002;
+		sprintf(CCD_General_Error_String,"Sim_Driver_Register: Failed to allocate instance data.");
+		return FALSE;
+	}
+	if(!CCD_Driver_Context_Data_Set(CCD_DRIVER_CONTEXT_DATA_DRIVER,instance,Driver_Instance_Free))
+	{
+		Driver_Instance_Free(instance);
+		return FALSE;
+	}
+	/* setup */
+	functions->Setup_Startup = Sim_Setup_Startup;
+	functions->Setup_Dimensions_Check = Sim_Setup_Dimensions_Check;
+	functions->Setup_Dimensions = Sim_Setup_Dimensions;
+	functions->Setup_Abort = Sim_Setup_Abort;
+	functions->Setup_Get_NCols = Sim_Setup_Get_NCols;
+	functions->Setup_Get_NRows = Sim_Setup_Get_NRows;
+	functions->Setup_Shutdown = Sim_Setup_Shutdown;
+	/* exposure */
+	functions->Exposure_Expose = Sim_Exposure_Expose;
+	functions->Exposure_Bias = Sim_Exposure_Bias;
+	functions->Exposure_Abort = Sim_Exposure_Abort;
+	functions->Exposure_Get_Exposure_Start_Time = Sim_Exposure_Get_Exposure_Start_Time;
+	functions->Exposure_Loop_Pause_Length_Set = Sim_Exposure_Loop_Pause_Length_Set;
+	/* temperature */
+	functions->Temperature_Get = Sim_Temperature_Get;
+	functions->Temperature_Set = Sim_Temperature_Set;
+	functions->Temperature_Cooler_On = Sim_Temperature_Cooler_On;
+	functions->Temperature_Cooler_Off = Sim_Temperature_Cooler_Off;
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_driver.c","Sim_Driver_Register",LOG_VERBOSITY_INTERMEDIATE,NULL,
+			"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Get the simulated camera instance registered in the calling thread's CCD driver context.
+ * @return The instance, or NULL if Sim_Driver_Register has not been called in this context.
+ * @see #Sim_Driver_Instance_Struct
+ * @see ../../cdocs/ccd_driver.html#CCD_Driver_Context_Data_Get
+ */
+struct Sim_Driver_Instance_Struct *Sim_Driver_Instance_Get(void)
+{
+	return (struct Sim_Driver_Instance_Struct *)CCD_Driver_Context_Data_Get(CCD_DRIVER_CONTEXT_DATA_DRIVER);
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions 
+** ---------------------------------------------------------------------------- */
+/**
+ * Free a simulated camera instance, and its setup, exposure and temperature data. This is called by the
+ * CCD library when the driver is closed, or its context destroyed.
+ * @param instance The instance to free, a pointer to a Sim_Driver_Instance_Struct.
+ * @see #Sim_Driver_Instance_Struct
+ * @see sim_setup.html#Sim_Setup_Data_Free
+ * @see sim_exposure.html#Sim_Exposure_Data_Free
+ * @see sim_temperature.html#Sim_Temperature_Data_Free
+ */
+static void Driver_Instance_Free(void *instance)
+{
+	struct Sim_Driver_Instance_Struct *sim_instance = (struct Sim_Driver_Instance_Struct *)instance;
+
+	if(sim_instance == NULL)
+		return;
+	Sim_Setup_Data_Free(sim_instance->Setup_Data);
+	Sim_Exposure_Data_Free(sim_instance->Exposure_Data);
+	Sim_Temperature_Data_Free(sim_instance->Temperature_Data);
+	free(sim_instance);
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
@@ -0,0 +1,575 @@
+/* sim_exposure.c
+** Autoguider simulated CCD Library exposure routines
+** $Header$
+*/
+/**
+ * Exposure routines for the simulated autoguider CCD library.
+ * A fixed pseudo-random star field is generated at startup. Each exposure waits for the exposure length
+ * and the configured readout time, and then renders the stars (with a slow sinusoidal drift, so the guide loop
+ * has something to correct), sky, bias, photon and read noise into the binned, windowed buffer.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "log_udp.h"
+#include "ccd_config.h"
+#include "ccd_exposure.h"
+#include "ccd_general.h"
+#include "sim_driver.h"
+#include "sim_general.h"
+#include "sim_setup.h"
+#include "sim_exposure.h"
+#include "autoguider_test_util.h"
+
+/* hash defines */
+/**
+ * The value of pi.
+ */
+#ifndef M_PI
+#define M_PI			(3.14159265358979323846)
+#endif
+/**
+ * The maximum value a pixel can hold (16 bit unsigned).
+ */
+#define SIM_PIXEL_MAX		(65535.0)
+/**
+ * How far out from a star's centre (in units of the star's Gaussian sigma) we bother rendering flux.
+ */
+#define SIM_STAR_CUTOFF_SIGMA	(5.0)
+
+/* data types */
+/**
+ * Structure holding one simulated star.
+ * <dl>
+ * <dt>X</dt> <dd>The unbinned X position of the star on the detector (pixels, starting at 1).</dd>
+ * <dt>Y</dt> <dd>The unbinned Y position of the star on the detector (pixels, starting at 1).</dd>
+ * <dt>Peak_Rate</dt> <dd>The peak count rate of the star (counts per second per unbinned pixel).</dd>
+ * </dl>
+ */
+struct Sim_Star_Struct
+{
+	double X;
+	double Y;
+	double Peak_Rate;
+};
+
+/**
+ * Structure used to hold local data to sim_exposure.
+ * <dl>
+ * <dt>Exposure_Status</dt> <dd>Whether an operation is being performed to CLEAR, EXPOSE or READOUT the CCD.</dd>
+ * <dt>Exposure_Length</dt> <dd>The last exposure length to be set (ms).</dd>
+ * <dt>Abort</dt> <dd>Whether to abort an exposure.</dd>
+ * <dt>Exposure_Start_Time</dt> <dd>The time stamp when an exposure was started.</dd>
+ * <dt>Exposure_Loop_Pause_Length</dt> <dd>An amount of time to pause/sleep, in milliseconds, each time
+ *     round the loop whilst waiting for an exposure to be done.</dd>
+ * <dt>Startup_Time</dt> <dd>When Sim_Exposure_Startup was called, the zero point of the drift sinusoid.</dd>
+ * <dt>Bias</dt> <dd>The bias level added to every pixel (counts).</dd>
+ * <dt>Read_Noise</dt> <dd>The read noise (counts RMS) per read out pixel.</dd>
+ * <dt>Sky_Rate</dt> <dd>The sky background, in counts per second per unbinned pixel.</dd>
+ * <dt>Readout_Length</dt> <dd>How long (ms) the simulated readout takes.</dd>
+ * <dt>Star_Sigma</dt> <dd>The Gaussian sigma of the stellar profile, in unbinned pixels.</dd>
+ * <dt>Drift_Amplitude</dt> <dd>The amplitude of the sinusoidal star field drift, in unbinned pixels.</dd>
+ * <dt>Drift_Period</dt> <dd>The period of the drift in seconds. Zero or less disables the drift.</dd>
+ * <dt>Star_List</dt> <dd>The simulated star field.</dd>
+ * <dt>Star_Count</dt> <dd>The number of stars in Star_List.</dd>
+ * <dt>Random_State</dt> <dd>The state of the noise random number generator.</dd>
+ * </dl>
+ * @see ../../cdocs/ccd_exposure.html#CCD_EXPOSURE_STATUS
+ * @see #Sim_Star_Struct
+ */
+struct Exposure_Struct
+{
+	enum CCD_EXPOSURE_STATUS Exposure_Status;
+	int Exposure_Length;
+	int Abort;
+	struct timespec Exposure_Start_Time;
+	int Exposure_Loop_Pause_Length;
+	struct timespec Startup_Time;
+	int Bias;
+	double Read_Noise;
+	double Sky_Rate;
+	int Readout_Length;
+	double Star_Sigma;
+	double Drift_Amplitude;
+	double Drift_Period;
+	struct Sim_Star_Struct *Star_List;
+	int Star_Count;
+	unsigned int Random_State;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Initial exposure data, copied into each simulated camera's exposure data by Sim_Exposure_Data_Create.
+ * @see #Exposure_Struct
+ */
+static struct Exposure_Struct Exposure_Data_Initial =
+{
+	CCD_EXPOSURE_STATUS_NONE,
+	0,FALSE,
+	{0L,0L},
+	1,
+	{0L,0L},
+	0,0.0,0.0,0,1.0,0.0,0.0,
+	NULL,0,1
+};
+
+/* internal functions */
+static struct Exposure_Struct *Exposure_Data_Get(void);
+static int Exposure_Wait(int length_ms,int error_number);
+static void Exposure_Render(int open_shutter,unsigned short *image_data);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Create the exposure data for a new simulated camera, called from Sim_Driver_Register.
+ * The star field is generated later, by Sim_Exposure_Startup.
+ * @return A pointer to the new exposure data, or NULL if it could not be allocated.
+ * @see #Exposure_Struct
+ * @see #Exposure_Data_Initial
+ * @see sim_driver.html#Sim_Driver_Register
+ */
+void *Sim_Exposure_Data_Create(void)
+{
+	struct Exposure_Struct *exposure_data = NULL;
+
+	exposure_data = (struct Exposure_Struct *)malloc(sizeof(struct Exposure_Struct));
+	if(exposure_data == NULL)
+		return NULL;
+	(*exposure_data) = Exposure_Data_Initial;
+	return exposure_data;
+}
+
+/**
+ * Free exposure data created by Sim_Exposure_Data_Create, and its star field.
+ * @param exposure_data The exposure data to free.
+ * @see #Sim_Exposure_Data_Create
+ */
+void Sim_Exposure_Data_Free(void *exposure_data)
+{
+	struct Exposure_Struct *sim_exposure_data = (struct Exposure_Struct *)exposure_data;
+
+	if(sim_exposure_data == NULL)
+		return;
+	if(sim_exposure_data->Star_List != NULL)
+		free(sim_exposure_data->Star_List);
+	free(sim_exposure_data);
+}
+
+/**
+ * Read the simulated camera configuration, and generate the star field.
+ * The following keywords are read from the properties file:
+ * <ul>
+ * <li><b>ccd.sim.exposure.bias</b> The bias level (counts).
+ * <li><b>ccd.sim.exposure.read_noise</b> The read noise (counts).
+ * <li><b>ccd.sim.exposure.sky_rate</b> The sky level (counts/s/pixel).
+ * <li><b>ccd.sim.exposure.readout_length</b> The readout time (ms).
+ * <li><b>ccd.sim.exposure.star.count</b> The number of stars in the field.
+ * <li><b>ccd.sim.exposure.star.peak_rate</b> The peak count rate (counts/s/pixel) of the brightest star.
+ *     Other stars are randomly fainter, down to a tenth of this.
+ * <li><b>ccd.sim.exposure.star.fwhm</b> The FWHM of the stellar profile (unbinned pixels).
+ * <li><b>ccd.sim.exposure.drift.amplitude</b> The amplitude of the field drift (unbinned pixels).
+ * <li><b>ccd.sim.exposure.drift.period</b> The period of the field drift (seconds).
+ * <li><b>ccd.sim.exposure.seed</b> The random number seed, the same seed always produces the same field.
+ * </ul>
+ * This must be called after Sim_Setup_Startup has read the detector size.
+ * @return The routine returns TRUE on success, and FALSE if an error occurs.
+ * @see #SIM_EXPOSURE_KEYWORD_ROOT
+ * @see #Exposure_Data_Get
+ * @see ../../../test/autoguider_test_random.html#Autoguider_Test_Random_Uniform
+ * @see sim_setup.html#Sim_Setup_Get_Detector_Columns
+ * @see sim_setup.html#Sim_Setup_Get_Detector_Rows
+ * @see ../../cdocs/ccd_config.html#CCD_Config_Get_Integer
+ * @see ../../cdocs/ccd_config.html#CCD_Config_Get_Double
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_Number
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_String
+ */
+int Sim_Exposure_Startup(void)
+{
+	struct Exposure_Struct *exposure_data = NULL;
+	double fwhm,peak_rate;
+	int seed,i;
+
+	exposure_data = Exposure_Data_Get();
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_exposure.c","Sim_Exposure_Startup",LOG_VERBOSITY_INTERMEDIATE,NULL,"started.");
+#endif
+	if(!CCD_Config_Get_Integer(SIM_EXPOSURE_KEYWORD_ROOT"bias",&(exposure_data->Bias)))
+		return FALSE;
+	if(!CCD_Config_Get_Double(SIM_EXPOSURE_KEYWORD_ROOT"read_noise",&(exposure_data->Read_Noise)))
+		return FALSE;
+	if(!CCD_Config_Get_Double(SIM_EXPOSURE_KEYWORD_ROOT"sky_rate",&(exposure_data->Sky_Rate)))
+		return FALSE;
+	if(!CCD_Config_Get_Integer(SIM_EXPOSURE_KEYWORD_ROOT"readout_length",&(exposure_data->Readout_Length)))
+		return FALSE;
+	if(!CCD_Config_Get_Integer(SIM_EXPOSURE_KEYWORD_ROOT"star.count",&(exposure_data->Star_Count)))
+		return FALSE;
+	if(!CCD_Config_Get_Double(SIM_EXPOSURE_KEYWORD_ROOT"star.peak_rate",&peak_rate))
+		return FALSE;
+	if(!CCD_Config_Get_Double(SIM_EXPOSURE_KEYWORD_ROOT"star.fwhm",&fwhm))
+		return FALSE;
+	if(!CCD_Config_Get_Double(SIM_EXPOSURE_KEYWORD_ROOT"drift.amplitude",&(exposure_data->Drift_Amplitude)))
+		return FALSE;
+	if(!CCD_Config_Get_Double(SIM_EXPOSURE_KEYWORD_ROOT"drift.period",&(exposure_data->Drift_Period)))
+		return FALSE;
+	if(!CCD_Config_Get_Integer(SIM_EXPOSURE_KEYWORD_ROOT"seed",&seed))
+		return FALSE;
+	if((exposure_data->Star_Count < 0)||(fwhm <= 0.0))
+	{
+		CCD_General_Error_Number = 1200;
+		sprintf(CCD_General_Error_String,"Sim_Exposure_Startup: Illegal star count %d or FWHM %.2f.",
+			exposure_data->Star_Count,fwhm);
+		return FALSE;
+	}
+	exposure_data->Star_Sigma = fwhm/(2.0*sqrt(2.0*log(2.0)));
+	/* (re)generate the star field */
+	if(exposure_data->Star_List != NULL)
+		free(exposure_data->Star_List);
+	exposure_data->Star_List = NULL;
+	if(exposure_data->Star_Count > 0)
+	{
+		exposure_data->Star_List = (struct Sim_Star_Struct *)malloc(exposure_data->Star_Count*
+									 sizeof(struct Sim_Star_Struct));
+		if(exposure_data->Star_List == NULL)
+		{
+			CCD_General_Error_Number = 1201;
+			sprintf(CCD_General_Error_String,"Sim_Exposure_Startup: Failed to allocate %d stars.",
+				exposure_data->Star_Count);
+			exposure_data->Star_Count = 0;
+			return FALSE;
+		}
+	}
+	exposure_data->Random_State = (unsigned int)seed;
+	for(i = 0; i < exposure_data->Star_Count; i++)
+	{
+		exposure_data->Star_List[i].X = 1.0+(Autoguider_Test_Random_Uniform(&(exposure_data->Random_State))*
+						    (Sim_Setup_Get_Detector_Columns()-1));
+		exposure_data->Star_List[i].Y = 1.0+(Autoguider_Test_Random_Uniform(&(exposure_data->Random_State))*
+						    (Sim_Setup_Get_Detector_Rows()-1));
+		/* the first star is the brightest */
+		if(i == 0)
+			exposure_data->Star_List[i].Peak_Rate = peak_rate;
+		else
+			exposure_data->Star_List[i].Peak_Rate = peak_rate*
+				(0.1+(0.8*Autoguider_Test_Random_Uniform(&(exposure_data->Random_State))));
+#ifdef SIM_DEBUG
+		CCD_General_Log_Format("ccd","sim_exposure.c","Sim_Exposure_Startup",LOG_VERBOSITY_VERY_VERBOSE,NULL,
+				       "Star %d at (%.2f,%.2f) peak rate %.2f.",i,exposure_data->Star_List[i].X,
+				       exposure_data->Star_List[i].Y,exposure_data->Star_List[i].Peak_Rate);
+#endif
+	}
+	clock_gettime(CLOCK_REALTIME,&(exposure_data->Startup_Time));
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_exposure.c","Sim_Exposure_Startup",LOG_VERBOSITY_INTERMEDIATE,NULL,"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Perform a simulated exposure and save it into the specified buffer.
+ * <ul>
+ * <li>We check the buffer is not NULL, and return an error if it is.
+ * <li>We check the buffer length is not too short to hold the read out image.
+ * <li>If a start time is configured, we wait for the start time.
+ * <li>We record the exposure start time, and wait for the exposure length.
+ * <li>We wait for the configured readout length.
+ * <li>We render the simulated image into the buffer.
+ * </ul>
+ * The abort flag is checked every Exposure_Loop_Pause_Length milliseconds throughout.
+ * @param open_shutter A boolean, TRUE to open the shutter, FALSE to leave it closed (dark).
+ * @param start_time The time to start the exposure. If both the fields in the <i>struct timespec</i> are zero,
+ * 	the exposure can be started at any convenient time.
+ * @param exposure_length The length of time to open the shutter for in milliseconds.
+ * @param buffer A pointer to a previously allocated area of memory, of length buffer_length.
+ * @param buffer_length The length of the buffer in <b>pixels</b>.
+ * @return Returns TRUE if the exposure succeeds and the data read out into the buffer, returns FALSE if an error
+ *	occurs or the exposure is aborted.
+ * @see #Exposure_Data_Get
+ * @see #Exposure_Wait
+ * @see #Exposure_Render
+ * @see sim_setup.html#Sim_Setup_Get_Buffer_Length
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_Number
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_String
+ * @see ../../cdocs/ccd_general.html#CCD_General_Log
+ */
+int Sim_Exposure_Expose(int open_shutter,struct timespec start_time,int exposure_length,
+			void *buffer,size_t buffer_length)
+{
+	struct Exposure_Struct *exposure_data = NULL;
+	struct timespec current_time;
+	int wait_ms;
+
+	exposure_data = Exposure_Data_Get();
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_exposure.c","Sim_Exposure_Expose",LOG_VERBOSITY_TERSE,NULL,"started.");
+#endif
+	if(buffer == NULL)
+	{
+		CCD_General_Error_Number = 1202;
+		sprintf(CCD_General_Error_String,"Sim_Exposure_Expose: buffer was NULL.");
+		return FALSE;
+	}
+	if(buffer_length < Sim_Setup_Get_Buffer_Length())
+	{
+		CCD_General_Error_Number = 1203;
+		sprintf(CCD_General_Error_String,"Sim_Exposure_Expose: buffer_length (%ld) was too small (%d).",
+			buffer_length,Sim_Setup_Get_Buffer_Length());
+		return FALSE;
+	}
+	if(exposure_length < 0)
+	{
+		CCD_General_Error_Number = 1204;
+		sprintf(CCD_General_Error_String,"Sim_Exposure_Expose: Illegal exposure length %d.",exposure_length);
+		return FALSE;
+	}
+	/* reset abort */
+	exposure_data->Abort = FALSE;
+	exposure_data->Exposure_Length = exposure_length;
+	/* wait for start_time, if applicable */
+	if(start_time.tv_sec > 0)
+	{
+		exposure_data->Exposure_Status = CCD_EXPOSURE_STATUS_WAIT_START;
+		clock_gettime(CLOCK_REALTIME,&current_time);
+		wait_ms = (int)(fdifftime(start_time,current_time)*CCD_GENERAL_ONE_SECOND_MS);
+		if(!Exposure_Wait(wait_ms,1205))
+			return FALSE;
+	}
+	clock_gettime(CLOCK_REALTIME,&(exposure_data->Exposure_Start_Time));
+	exposure_data->Exposure_Status = CCD_EXPOSURE_STATUS_EXPOSE;
+	if(!Exposure_Wait(exposure_data->Exposure_Length,1206))
+		return FALSE;
+	exposure_data->Exposure_Status = CCD_EXPOSURE_STATUS_READOUT;
+	if(!Exposure_Wait(exposure_data->Readout_Length,1207))
+		return FALSE;
+	Exposure_Render(open_shutter,(unsigned short *)buffer);
+	exposure_data->Exposure_Status = CCD_EXPOSURE_STATUS_NONE;
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_exposure.c","Sim_Exposure_Expose",LOG_VERBOSITY_TERSE,NULL,"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Take a bias.
+ * @param buffer A pointer to a previously allocated area of memory, of length buffer_length.
+ * @param buffer_length The length of the buffer in <b>pixels</b>.
+ * @return Returns TRUE on success, and FALSE if an error occurs or the exposure is aborted.
+ * @see #Sim_Exposure_Expose
+ */
+int Sim_Exposure_Bias(void *buffer,size_t buffer_length)
+{
+	struct timespec start_time = {0,0};
+
+	return Sim_Exposure_Expose(FALSE,start_time,0,buffer,buffer_length);
+}
+
+/**
+ * Abort an exposure. The exposure in progress notices within Exposure_Loop_Pause_Length milliseconds.
+ * @return Returns TRUE.
+ * @see #Exposure_Data_Get
+ */
+int Sim_Exposure_Abort(void)
+{
+	struct Exposure_Struct *exposure_data = NULL;
+
+	exposure_data = Exposure_Data_Get();
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_exposure.c","Sim_Exposure_Abort",LOG_VERBOSITY_INTERMEDIATE,NULL,"started.");
+#endif
+	exposure_data->Abort = TRUE;
+	return TRUE;
+}
+
+/**
+ * This routine gets the time stamp for the start of the exposure.
+ * @return The time stamp for the start of the exposure.
+ * @see #Exposure_Data_Get
+ */
+struct timespec Sim_Exposure_Get_Exposure_Start_Time(void)
+{
+	struct Exposure_Struct *exposure_data = NULL;
+
+	exposure_data = Exposure_Data_Get();
+	return exposure_data->Exposure_Start_Time;
+}
+
+/**
+ * Set how long to pause in the loop waiting for an exposure to complete in Sim_Exposure_Expose.
+ * @param ms The length of time to sleep for, in milliseconds (between 1 and 1000).
+ * @return Returns TRUE on success, and FALSE if an error occurs.
+ * @see #Exposure_Data_Get
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_Number
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_String
+ */
+int Sim_Exposure_Loop_Pause_Length_Set(int ms)
+{
+	struct Exposure_Struct *exposure_data = NULL;
+
+	exposure_data = Exposure_Data_Get();
+	if((ms < 1) || (ms > 1000))
+	{
+		CCD_General_Error_Number = 1208;
+		sprintf(CCD_General_Error_String,"Sim_Exposure_Loop_Pause_Length_Set: Milliseconds %d out of range.",
+			ms);
+		return FALSE;
+	}
+	exposure_data->Exposure_Loop_Pause_Length = ms;
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Get the exposure data of the simulated camera registered in the calling thread's CCD driver context.
+ * @return The exposure data.
+ * @see #Exposure_Struct
+ * @see sim_driver.html#Sim_Driver_Instance_Get
+ */
+static struct Exposure_Struct *Exposure_Data_Get(void)
+{
+	return (struct Exposure_Struct *)(Sim_Driver_Instance_Get()->Exposure_Data);
+}
+
+/**
+ * Sleep for length_ms milliseconds, in chunks of at most Exposure_Loop_Pause_Length milliseconds,
+ * checking the abort flag after each chunk.
+ * @param length_ms The length of time to wait, in milliseconds. Zero or negative values return immediately
+ *        (after the abort flag has been checked).
+ * @param error_number The error number to use if the wait is aborted.
+ * @return Returns TRUE if the wait completed, FALSE if it was aborted.
+ * @see #Exposure_Data_Get
+ */
+static int Exposure_Wait(int length_ms,int error_number)
+{
+	struct Exposure_Struct *exposure_data = NULL;
+	struct timespec sleep_time;
+	int remaining_ms,pause_ms;
+
+	exposure_data = Exposure_Data_Get();
+	remaining_ms = length_ms;
+	while(TRUE)
+	{
+		if(exposure_data->Abort)
+		{
+			exposure_data->Exposure_Status = CCD_EXPOSURE_STATUS_NONE;
+			CCD_General_Error_Number = error_number;
+			sprintf(CCD_General_Error_String,"Sim_Exposure_Expose:Aborted.");
+			return FALSE;
+		}
+		if(remaining_ms <= 0)
+			return TRUE;
+		pause_ms = exposure_data->Exposure_Loop_Pause_Length;
+		if(pause_ms > remaining_ms)
+			pause_ms = remaining_ms;
+		sleep_time.tv_sec = pause_ms/CCD_GENERAL_ONE_SECOND_MS;
+		sleep_time.tv_nsec = (pause_ms%CCD_GENERAL_ONE_SECOND_MS)*CCD_GENERAL_ONE_MILLISECOND_NS;
+		nanosleep(&sleep_time,NULL);
+		remaining_ms -= pause_ms;
+	}
+	return TRUE;
+}
+
+/**
+ * Render the simulated image for the current setup into the buffer.
+ * Each binned pixel is given the bias, plus (if the shutter was open) the sky and the flux of each star
+ * (evaluated at the centre of the binned pixel) scaled by exposure length and binned area,
+ * plus Gaussian photon and read noise. The star field is offset by the drift sinusoid evaluated at the
+ * exposure start time.
+ * @param open_shutter Whether the shutter was open (TRUE) or this is a bias/dark (FALSE).
+ * @param image_data The buffer to render into, at least Sim_Setup_Get_Buffer_Length pixels long.
+ * @see #Exposure_Data_Get
+ * @see ../../../test/autoguider_test_random.html#Autoguider_Test_Random_Gaussian
+ * @see sim_setup.html#Sim_Setup_Get_NCols
+ * @see sim_setup.html#Sim_Setup_Get_NRows
+ * @see sim_setup.html#Sim_Setup_Get_Horizontal_Bin
+ * @see sim_setup.html#Sim_Setup_Get_Vertical_Bin
+ * @see sim_setup.html#Sim_Setup_Get_X_Start
+ * @see sim_setup.html#Sim_Setup_Get_Y_Start
+ */
+static void Exposure_Render(int open_shutter,unsigned short *image_data)
+{
+	struct Exposure_Struct *exposure_data = NULL;
+	struct Sim_Star_Struct *star = NULL;
+	double exposure_s,pixel_area,drift_x,drift_y,phase,cutoff,two_sigma_squared;
+	double centre_x,centre_y,dx,dy,signal,value;
+	int ncols,nrows,hbin,vbin,x_start,y_start,x,y,i;
+
+	exposure_data = Exposure_Data_Get();
+	ncols = Sim_Setup_Get_NCols();
+	nrows = Sim_Setup_Get_NRows();
+	hbin = Sim_Setup_Get_Horizontal_Bin();
+	vbin = Sim_Setup_Get_Vertical_Bin();
+	x_start = Sim_Setup_Get_X_Start();
+	y_start = Sim_Setup_Get_Y_Start();
+	exposure_s = ((double)exposure_data->Exposure_Length)/((double)CCD_GENERAL_ONE_SECOND_MS);
+	pixel_area = (double)(hbin*vbin);
+	drift_x = 0.0;
+	drift_y = 0.0;
+	if(exposure_data->Drift_Period > 0.0)
+	{
+		phase = 2.0*M_PI*fdifftime(exposure_data->Exposure_Start_Time,exposure_data->Startup_Time)/
+			exposure_data->Drift_Period;
+		drift_x = exposure_data->Drift_Amplitude*sin(phase);
+		drift_y = exposure_data->Drift_Amplitude*sin(phase+(M_PI/4.0));
+	}
+	cutoff = SIM_STAR_CUTOFF_SIGMA*exposure_data->Star_Sigma;
+	two_sigma_squared = 2.0*exposure_data->Star_Sigma*exposure_data->Star_Sigma;
+	for(y = 0; y < nrows; y++)
+	{
+		/* unbinned coordinate of the centre of this binned row */
+		centre_y = ((double)((y_start+y-1)*vbin))+(((double)vbin+1.0)/2.0);
+		for(x = 0; x < ncols; x++)
+		{
+			signal = 0.0;
+			if(open_shutter)
+			{
+				centre_x = ((double)((x_start+x-1)*hbin))+(((double)hbin+1.0)/2.0);
+				signal = exposure_data->Sky_Rate;
+				for(i = 0; i < exposure_data->Star_Count; i++)
+				{
+					star = &(exposure_data->Star_List[i]);
+					dx = centre_x-(star->X+drift_x);
+					if((dx > cutoff)||(dx < -cutoff))
+						continue;
+					dy = centre_y-(star->Y+drift_y);
+					if((dy > cutoff)||(dy < -cutoff))
+						continue;
+					signal += star->Peak_Rate*exp(-((dx*dx)+(dy*dy))/two_sigma_squared);
+				}
+				signal *= exposure_s*pixel_area;
+			}
+			value = ((double)exposure_data->Bias)+signal+
+				(Autoguider_Test_Random_Gaussian(&(exposure_data->Random_State))*
+				 sqrt(signal+(exposure_data->Read_Noise*exposure_data->Read_Noise)));
+			if(value < 0.0)
+				value = 0.0;
+			if(value > SIM_PIXEL_MAX)
+				value = SIM_PIXEL_MAX;
+			image_data[(y*ncols)+x] = (unsigned short)value;
+		}
+	}
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
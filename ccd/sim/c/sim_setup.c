@@ -0,0 +1,466 @@
+/* sim_setup.c
+** Autoguider simulated CCD Library setup routines
+** $Header$
+*/
+
+/**
+ * Setup routines for the simulated autoguider CCD library. The simulated camera has no hardware behind it,
+ * it allows the autoguider (and test programs) to be run end to end on a machine with no camera attached.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "log_udp.h"
+#include "ccd_config.h"
+#include "ccd_general.h"
+#include "sim_driver.h"
+#include "sim_exposure.h"
+#include "sim_setup.h"
+#include "sim_temperature.h"
+
+/* structs */
+/**
+ * Data type holding local data to sim_setup. This consists of the following:
+ * <dl>
+ * <dt>Detector_Columns</dt> <dd>The number of unbinned columns on the simulated detector.</dd>
+ * <dt>Detector_Rows</dt> <dd>The number of unbinned rows on the simulated detector.</dd>
+ * <dt>Horizontal_Bin</dt> <dd>Horizontal (X) binning factor.</dd>
+ * <dt>Vertical_Bin</dt> <dd>Vertical (Y) binning factor.</dd>
+ * <dt>Image_Area</dt> <dd>The current window/in use imaging area. This is inclusive, in binned pixels,
+ *     and starts from pixel 1 (the same coordinate system as the windows passed into Sim_Setup_Dimensions).</dd>
+ * </dl>
+ * @see ../../cdocs/ccd_setup.html#CCD_Setup_Window_Struct
+ */
+struct Setup_Struct
+{
+	int Detector_Columns;
+	int Detector_Rows;
+	int Horizontal_Bin;
+	int Vertical_Bin;
+	struct CCD_Setup_Window_Struct Image_Area;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+
+/**
+ * Initial setup data, copied into each simulated camera's setup data by Sim_Setup_Data_Create.
+ * @see #Setup_Struct
+ */
+static struct Setup_Struct Setup_Data_Initial =
+{
+	0,0,1,1,{0,0,0,0}
+};
+
+/* internal functions */
+static struct Setup_Struct *Setup_Data_Get(void);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Create the setup data for a new simulated camera, called from Sim_Driver_Register.
+ * @return A pointer to the new setup data, or NULL if it could not be allocated.
+ * @see #Setup_Struct
+ * @see #Setup_Data_Initial
+ * @see sim_driver.html#Sim_Driver_Register
+ */
+void *Sim_Setup_Data_Create(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = (struct Setup_Struct *)malloc(sizeof(struct Setup_Struct));
+	if(setup_data == NULL)
+		return NULL;
+	(*setup_data) = Setup_Data_Initial;
+	return setup_data;
+}
+
+/**
+ * Free setup data created by Sim_Setup_Data_Create.
+ * @param setup_data The setup data to free.
+ * @see #Sim_Setup_Data_Create
+ */
+void Sim_Setup_Data_Free(void *setup_data)
+{
+	if(setup_data != NULL)
+		free(setup_data);
+}
+
+/**
+ * Do startup for the simulated CCD.
+ * <ul>
+ * <li>We call CCD_Config_Get_Integer to get the size of the simulated detector from the properties file:
+ *     <b>ccd.sim.setup.ncols</b> and <b>ccd.sim.setup.nrows</b>.
+ * <li>We initially set the image area to the whole detector, unbinned.
+ * <li>We call Sim_Exposure_Startup to create the simulated star field.
+ * <li>We call Sim_Temperature_Startup to initialise the simulated cooler.
+ * </ul>
+ * @return The routine returns TRUE on success, and FALSE if an error occurs.
+ * @see #SIM_SETUP_KEYWORD_ROOT
+ * @see #Setup_Data_Get
+ * @see sim_exposure.html#Sim_Exposure_Startup
+ * @see sim_temperature.html#Sim_Temperature_Startup
+ * @see ../../cdocs/ccd_config.html#CCD_Config_Get_Integer
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_Number
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_String
+ * @see ../../cdocs/ccd_general.html#CCD_General_Log
+ */
+int Sim_Setup_Startup(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_setup.c","Sim_Setup_Startup",LOG_VERBOSITY_INTERMEDIATE,NULL,"started.");
+#endif
+	if(!CCD_Config_Get_Integer(SIM_SETUP_KEYWORD_ROOT"ncols",&(setup_data->Detector_Columns)))
+		return FALSE;
+	if(!CCD_Config_Get_Integer(SIM_SETUP_KEYWORD_ROOT"nrows",&(setup_data->Detector_Rows)))
+		return FALSE;
+	if((setup_data->Detector_Columns < 1)||(setup_data->Detector_Rows < 1))
+	{
+		CCD_General_Error_Number = 1100;
+		sprintf(CCD_General_Error_String,"Sim_Setup_Startup: Illegal detector size (%d,%d).",
+			setup_data->Detector_Columns,setup_data->Detector_Rows);
+		return FALSE;
+	}
+#ifdef SIM_DEBUG
+	CCD_General_Log_Format("ccd","sim_setup.c","Sim_Setup_Startup",LOG_VERBOSITY_VERBOSE,NULL,
+			       "Simulated detector is %d x %d.",setup_data->Detector_Columns,
+			       setup_data->Detector_Rows);
+#endif
+	setup_data->Horizontal_Bin = 1;
+	setup_data->Vertical_Bin = 1;
+	setup_data->Image_Area.X_Start = 1;
+	setup_data->Image_Area.Y_Start = 1;
+	setup_data->Image_Area.X_End = setup_data->Detector_Columns;
+	setup_data->Image_Area.Y_End = setup_data->Detector_Rows;
+	if(!Sim_Exposure_Startup())
+		return FALSE;
+	if(!Sim_Temperature_Startup())
+		return FALSE;
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_setup.c","Sim_Setup_Startup",LOG_VERBOSITY_INTERMEDIATE,NULL,"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Shutdown the simulated CCD. There is nothing to close.
+ * @return The routine returns TRUE.
+ */
+int Sim_Setup_Shutdown(void)
+{
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_setup.c","Sim_Setup_Shutdown",LOG_VERBOSITY_INTERMEDIATE,NULL,"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Check the dimensions (particularily the window dimensions) are valid for the simulated camera.
+ * The binning must be at least 1. If a window is specified it is clipped to the binned detector size,
+ * as a real camera would only read out the pixels it has.
+ * @param ncols The address of an integer, on entry to the function containing the number of unbinned image columns (X).
+ * @param nrows The address of an integer, on entry to the function containing the number of unbinned image rows (Y).
+ * @param hbin The address of an integer, on entry to the function containing the binning in X.
+ * @param vbin The address of an integer, on entry to the function containing the binning in Y.
+ * @param window_flags Whether to use the specified window or not.
+ * @param window A pointer to a structure containing window data. These dimensions are inclusive, and in binned pixels.
+ * @return The routine returns TRUE on success, and FALSE if an error occurs.
+ * @see #Setup_Data_Get
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_Number
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_String
+ * @see ../../cdocs/ccd_general.html#CCD_General_Log
+ */
+int Sim_Setup_Dimensions_Check(int *ncols,int *nrows,int *hbin,int *vbin,
+			       int window_flags,struct CCD_Setup_Window_Struct *window)
+{
+	struct Setup_Struct *setup_data = NULL;
+	int binned_ncols,binned_nrows;
+
+	setup_data = Setup_Data_Get();
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_setup.c","Sim_Setup_Dimensions_Check",LOG_VERBOSITY_VERBOSE,NULL,"started.");
+#endif
+	if((ncols == NULL)||(nrows == NULL)||(hbin == NULL)||(vbin == NULL))
+	{
+		CCD_General_Error_Number = 1101;
+		sprintf(CCD_General_Error_String,"Sim_Setup_Dimensions_Check: NULL dimension parameter.");
+		return FALSE;
+	}
+	if(((*hbin) < 1)||((*vbin) < 1))
+	{
+		CCD_General_Error_Number = 1102;
+		sprintf(CCD_General_Error_String,"Sim_Setup_Dimensions_Check: Illegal binning (%d,%d).",
+			(*hbin),(*vbin));
+		return FALSE;
+	}
+	if((*ncols) > setup_data->Detector_Columns)
+		(*ncols) = setup_data->Detector_Columns;
+	if((*nrows) > setup_data->Detector_Rows)
+		(*nrows) = setup_data->Detector_Rows;
+	if(window_flags > 0)
+	{
+		if(window == NULL)
+		{
+			CCD_General_Error_Number = 1103;
+			sprintf(CCD_General_Error_String,"Sim_Setup_Dimensions_Check: window was NULL.");
+			return FALSE;
+		}
+		binned_ncols = setup_data->Detector_Columns/(*hbin);
+		binned_nrows = setup_data->Detector_Rows/(*vbin);
+		if(window->X_Start < 1)
+			window->X_Start = 1;
+		if(window->Y_Start < 1)
+			window->Y_Start = 1;
+		if(window->X_End > binned_ncols)
+			window->X_End = binned_ncols;
+		if(window->Y_End > binned_nrows)
+			window->Y_End = binned_nrows;
+		if((window->X_End < window->X_Start)||(window->Y_End < window->Y_Start))
+		{
+			CCD_General_Error_Number = 1104;
+			sprintf(CCD_General_Error_String,"Sim_Setup_Dimensions_Check: "
+				"Window (%d,%d,%d,%d) is not on the detector.",window->X_Start,window->Y_Start,
+				window->X_End,window->Y_End);
+			return FALSE;
+		}
+	}
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_setup.c","Sim_Setup_Dimensions_Check",LOG_VERBOSITY_VERBOSE,NULL,"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Setup dimension information.
+ * <ul>
+ * <li>We save the supplied binning values in the camera's setup data.
+ * <li>If the windows_flags is set, we set the setup data Image_Area to the defined window.
+ *     The window is inclusive, i.e. it goes from window.X_Start to window.X_End (with both pixels being included).
+ * <li>If the windows_flags is <b>not</b> set, we set the setup data Image_Area to the binned full frame
+ *     (1,1,ncols/hbin,nrows/vbin).
+ * </ul>
+ * @param ncols Number of unbinned image columns (X).
+ * @param nrows Number of unbinned image rows (Y).
+ * @param hbin Binning in X.
+ * @param vbin Binning in Y.
+ * @param window_flags Whether to use the specified window or not.
+ * @param window A structure containing window data, inclusive and in binned pixels.
+ * @return The routine returns TRUE on success, and FALSE if an error occurs.
+ * @see #Setup_Data_Get
+ * @see ../../cdocs/ccd_setup.html#CCD_Setup_Window_Struct
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_Number
+ * @see ../../cdocs/ccd_general.html#CCD_General_Error_String
+ * @see ../../cdocs/ccd_general.html#CCD_General_Log
+ */
+int Sim_Setup_Dimensions(int ncols,int nrows,int hbin,int vbin,
+			 int window_flags,struct CCD_Setup_Window_Struct window)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+#ifdef SIM_DEBUG
+	CCD_General_Log("ccd","sim_setup.c","Sim_Setup_Dimensions",LOG_VERBOSITY_VERBOSE,NULL,"started.");
+#endif
+	if((hbin < 1)||(vbin < 1))
+	{
+		CCD_General_Error_Number = 1105;
+		sprintf(CCD_General_Error_String,"Sim_Setup_Dimensions: Illegal binning (%d,%d).",hbin,vbin);
+		return FALSE;
+	}
+	if((ncols < 1)||(nrows < 1)||(ncols > setup_data->Detector_Columns)||(nrows > setup_data->Detector_Rows))
+	{
+		CCD_General_Error_Number = 1106;
+		sprintf(CCD_General_Error_String,"Sim_Setup_Dimensions: Illegal dimensions (%d,%d) for detector (%d,%d).",
+			ncols,nrows,setup_data->Detector_Columns,setup_data->Detector_Rows);
+		return FALSE;
+	}
+	setup_data->Horizontal_Bin = hbin;
+	setup_data->Vertical_Bin = vbin;
+	if(window_flags > 0)
+	{
+		if((window.X_Start < 1)||(window.Y_Start < 1)||(window.X_End < window.X_Start)||
+		   (window.Y_End < window.Y_Start)||(window.X_End > (setup_data->Detector_Columns/hbin))||
+		   (window.Y_End > (setup_data->Detector_Rows/vbin)))
+		{
+			CCD_General_Error_Number = 1107;
+			sprintf(CCD_General_Error_String,"Sim_Setup_Dimensions: Illegal window (%d,%d,%d,%d).",
+				window.X_Start,window.Y_Start,window.X_End,window.Y_End);
+			return FALSE;
+		}
+		setup_data->Image_Area = window;
+	}
+	else
+	{
+		setup_data->Image_Area.X_Start = 1;
+		setup_data->Image_Area.Y_Start = 1;
+		setup_data->Image_Area.X_End = ncols/hbin;
+		setup_data->Image_Area.Y_End = nrows/vbin;
+	}
+#ifdef SIM_DEBUG
+	CCD_General_Log_Format("ccd","sim_setup.c","Sim_Setup_Dimensions",LOG_VERBOSITY_VERBOSE,NULL,
+			       "Image area (%d,%d,%d,%d) binned (%d,%d).",
+			       setup_data->Image_Area.X_Start,setup_data->Image_Area.Y_Start,
+			       setup_data->Image_Area.X_End,setup_data->Image_Area.Y_End,
+			       setup_data->Horizontal_Bin,setup_data->Vertical_Bin);
+	CCD_General_Log("ccd","sim_setup.c","Sim_Setup_Dimensions",LOG_VERBOSITY_VERBOSE,NULL,"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Abort a setup. Does nothing, setup is instantaneous.
+ */
+void Sim_Setup_Abort(void)
+{
+}
+
+/**
+ * Get the number of binned columns setup to be read out from the last Sim_Setup_Dimensions.
+ * @return The number of binned columns.
+ * @see #Setup_Data_Get
+ */
+int Sim_Setup_Get_NCols(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	return (setup_data->Image_Area.X_End-setup_data->Image_Area.X_Start)+1;
+}
+
+/**
+ * Get the number of binned rows setup to be read out from the last Sim_Setup_Dimensions.
+ * @return The number of binned rows.
+ * @see #Setup_Data_Get
+ */
+int Sim_Setup_Get_NRows(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	return (setup_data->Image_Area.Y_End-setup_data->Image_Area.Y_Start)+1;
+}
+
+/**
+ * Return the length of buffer required to hold one image with the current setup.
+ * @return The required length of buffer in pixels.
+ * @see #Sim_Setup_Get_NCols
+ * @see #Sim_Setup_Get_NRows
+ */
+int Sim_Setup_Get_Buffer_Length(void)
+{
+	return Sim_Setup_Get_NCols() * Sim_Setup_Get_NRows();
+}
+
+/**
+ * Get the number of unbinned detector columns, as read from the config file in Sim_Setup_Startup.
+ * @return The number of columns on the simulated detector.
+ * @see #Setup_Data_Get
+ */
+int Sim_Setup_Get_Detector_Columns(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	return setup_data->Detector_Columns;
+}
+
+/**
+ * Get the number of unbinned detector rows, as read from the config file in Sim_Setup_Startup.
+ * @return The number of rows on the simulated detector.
+ * @see #Setup_Data_Get
+ */
+int Sim_Setup_Get_Detector_Rows(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	return setup_data->Detector_Rows;
+}
+
+/**
+ * Get the current horizontal (X) binning.
+ * @return The binning.
+ * @see #Setup_Data_Get
+ */
+int Sim_Setup_Get_Horizontal_Bin(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	return setup_data->Horizontal_Bin;
+}
+
+/**
+ * Get the current vertical (Y) binning.
+ * @return The binning.
+ * @see #Setup_Data_Get
+ */
+int Sim_Setup_Get_Vertical_Bin(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	return setup_data->Vertical_Bin;
+}
+
+/**
+ * Get the first binned column read out (1 for a full frame, else the window start).
+ * @return The binned X start pixel.
+ * @see #Setup_Data_Get
+ */
+int Sim_Setup_Get_X_Start(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	return setup_data->Image_Area.X_Start;
+}
+
+/**
+ * Get the first binned row read out (1 for a full frame, else the window start).
+ * @return The binned Y start pixel.
+ * @see #Setup_Data_Get
+ */
+int Sim_Setup_Get_Y_Start(void)
+{
+	struct Setup_Struct *setup_data = NULL;
+
+	setup_data = Setup_Data_Get();
+	return setup_data->Image_Area.Y_Start;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Get the setup data of the simulated camera registered in the calling thread's CCD driver context.
+ * @return The setup data.
+ * @see #Setup_Struct
+ * @see sim_driver.html#Sim_Driver_Instance_Get
+ */
+static struct Setup_Struct *Setup_Data_Get(void)
+{
+	return (struct Setup_Struct *)(Sim_Driver_Instance_Get()->Setup_Data);
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
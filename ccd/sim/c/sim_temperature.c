@@ -0,0 +1,269 @@
+/* sim_temperature.c
+** Autoguider simulated CCD Library temperature routines
+** $Header$
+*/
+/**
+ * Temperature routines for the simulated autoguider CCD library. The simulated cold finger moves linearly
+ * towards the target temperature (cooler on) or ambient temperature (cooler off) at a configured rate.
+ * @author Chris Mottram
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "log_udp.h"
+#include "ccd_config.h"
+#include "ccd_general.h"
+#include "ccd_temperature.h"
+#include "sim_driver.h"
+#include "sim_general.h"
+#include "sim_temperature.h"
+
+/* structs */
+/**
+ * Data type holding local data to sim_temperature. This consists of the following:
+ * <dl>
+ * <dt>Ambient_Temperature</dt> <dd>The temperature the detector warms up to with the cooler off (C).</dd>
+ * <dt>Ramp_Rate</dt> <dd>How fast the temperature changes (degrees C per second).</dd>
+ * <dt>Target_Temperature</dt> <dd>The temperature last set by Sim_Temperature_Set.</dd>
+ * <dt>Current_Temperature</dt> <dd>The simulated temperature at Last_Update_Time.</dd>
+ * <dt>Cooler_On</dt> <dd>A boolean, whether the simulated cooler is on.</dd>
+ * <dt>Last_Update_Time</dt> <dd>When Current_Temperature was last updated.</dd>
+ * </dl>
+ */
+struct Temperature_Struct
+{
+	double Ambient_Temperature;
+	double Ramp_Rate;
+	double Target_Temperature;
+	double Current_Temperature;
+	int Cooler_On;
+	struct timespec Last_Update_Time;
+};
+
+/* internal data */
+/**
+ * Revision Control System identifier.
+ */
+static char rcsid[] = "$Id$";
+
+/**
+ * Initial temperature data, copied into each simulated camera's temperature data by Sim_Temperature_Data_Create.
+ * @see #Temperature_Struct
+ */
+static struct Temperature_Struct Temperature_Data_Initial =
+{
+	20.0,1.0,20.0,20.0,FALSE,{0L,0L}
+};
+
+/* internal functions */
+static struct Temperature_Struct *Temperature_Data_Get(void);
+static void Temperature_Update(void);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Create the temperature data for a new simulated camera, called from Sim_Driver_Register.
+ * @return A pointer to the new temperature data, or NULL if it could not be allocated.
+ * @see #Temperature_Struct
+ * @see #Temperature_Data_Initial
+ * @see sim_driver.html#Sim_Driver_Register
+ */
+void *Sim_Temperature_Data_Create(void)
+{
+	struct Temperature_Struct *temperature_data = NULL;
+
+	temperature_data = (struct Temperature_Struct *)malloc(sizeof(struct Temperature_Struct));
+	if(temperature_data == NULL)
+		return NULL;
+	(*temperature_data) = Temperature_Data_Initial;
+	return temperature_data;
+}
+
+/**
+ * Free temperature data created by Sim_Temperature_Data_Create.
+ * @param temperature_data The temperature data to free.
+ * @see #Sim_Temperature_Data_Create
+ */
+void Sim_Temperature_Data_Free(void *temperature_data)
+{
+	if(temperature_data != NULL)
+		free(temperature_data);
+}
+
+/**
+ * Read the simulated cooler configuration: <b>ccd.sim.temperature.ambient</b> (C) and
+ * <b>ccd.sim.temperature.ramp_rate</b> (C/s). The detector starts at ambient with the cooler off.
+ * @return Returns TRUE on success, and FALSE if an error occurs.
+ * @see #SIM_TEMPERATURE_KEYWORD_ROOT
+ * @see #Temperature_Data_Get
+ * @see ../../cdocs/ccd_config.html#CCD_Config_Get_Double
+ */
+int Sim_Temperature_Startup(void)
+{
+	struct Temperature_Struct *temperature_data = NULL;
+
+	temperature_data = Temperature_Data_Get();
+	if(!CCD_Config_Get_Double(SIM_TEMPERATURE_KEYWORD_ROOT"ambient",&(temperature_data->Ambient_Temperature)))
+		return FALSE;
+	if(!CCD_Config_Get_Double(SIM_TEMPERATURE_KEYWORD_ROOT"ramp_rate",&(temperature_data->Ramp_Rate)))
+		return FALSE;
+	temperature_data->Current_Temperature = temperature_data->Ambient_Temperature;
+	temperature_data->Target_Temperature = temperature_data->Ambient_Temperature;
+	temperature_data->Cooler_On = FALSE;
+	clock_gettime(CLOCK_REALTIME,&(temperature_data->Last_Update_Time));
+	return TRUE;
+}
+
+/**
+ * Get the current temperature of the simulated CCD.
+ * @param temperature The address of a double to return ther temperature in, in degrees centigrade.
+ * @param temperature_status The address of a enum to store the temperature status.
+ * @return Returns TRUE on success, and FALSE if an error occurs.
+ * @see #Temperature_Data_Get
+ * @see #Temperature_Update
+ * @see ../../cdocs/ccd_temperature.html#CCD_TEMPERATURE_STATUS
+ */
+int Sim_Temperature_Get(double *temperature,enum CCD_TEMPERATURE_STATUS *temperature_status)
+{
+	struct Temperature_Struct *temperature_data = NULL;
+
+	temperature_data = Temperature_Data_Get();
+	if(temperature == NULL)
+	{
+		CCD_General_Error_Number = 1300;
+		sprintf(CCD_General_Error_String,"Sim_Temperature_Get: temperature was NULL.");
+		return FALSE;
+	}
+	if(temperature_status == NULL)
+	{
+		CCD_General_Error_Number = 1301;
+		sprintf(CCD_General_Error_String,"Sim_Temperature_Get: temperature_status was NULL.");
+		return FALSE;
+	}
+	Temperature_Update();
+	(*temperature) = temperature_data->Current_Temperature;
+	if(temperature_data->Cooler_On == FALSE)
+	{
+		if(fabs(temperature_data->Current_Temperature-temperature_data->Ambient_Temperature) > 1.0)
+			(*temperature_status) = CCD_TEMPERATURE_STATUS_OFF;
+		else
+			(*temperature_status) = CCD_TEMPERATURE_STATUS_AMBIENT;
+	}
+	else if(fabs(temperature_data->Current_Temperature-temperature_data->Target_Temperature) > 1.0)
+		(*temperature_status) = CCD_TEMPERATURE_STATUS_RAMPING;
+	else
+		(*temperature_status) = CCD_TEMPERATURE_STATUS_OK;
+#ifdef SIM_DEBUG
+	CCD_General_Log_Format("ccd","sim_temperature.c","Sim_Temperature_Get",LOG_VERBOSITY_VERBOSE,NULL,
+			       "Temperature %.2f C (status %d).",(*temperature),(*temperature_status));
+#endif
+	return TRUE;
+}
+
+/**
+ * Set the target temperature of the simulated CCD.
+ * @param target_temperature The temperature to ramp the CCD to, in degrees centigrade.
+ * @return Returns TRUE.
+ * @see #Temperature_Data_Get
+ * @see #Temperature_Update
+ */
+int Sim_Temperature_Set(double target_temperature)
+{
+	struct Temperature_Struct *temperature_data = NULL;
+
+	temperature_data = Temperature_Data_Get();
+	Temperature_Update();
+	temperature_data->Target_Temperature = target_temperature;
+	return TRUE;
+}
+
+/**
+ * Turn the simulated cooler on.
+ * @return Returns TRUE.
+ * @see #Temperature_Data_Get
+ * @see #Temperature_Update
+ */
+int Sim_Temperature_Cooler_On(void)
+{
+	struct Temperature_Struct *temperature_data = NULL;
+
+	temperature_data = Temperature_Data_Get();
+	Temperature_Update();
+	temperature_data->Cooler_On = TRUE;
+	return TRUE;
+}
+
+/**
+ * Turn the simulated cooler off.
+ * @return Returns TRUE.
+ * @see #Temperature_Data_Get
+ * @see #Temperature_Update
+ */
+int Sim_Temperature_Cooler_Off(void)
+{
+	struct Temperature_Struct *temperature_data = NULL;
+
+	temperature_data = Temperature_Data_Get();
+	Temperature_Update();
+	temperature_data->Cooler_On = FALSE;
+	return TRUE;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Get the temperature data of the simulated camera registered in the calling thread's CCD driver context.
+ * @return The temperature data.
+ * @see #Temperature_Struct
+ * @see sim_driver.html#Sim_Driver_Instance_Get
+ */
+static struct Temperature_Struct *Temperature_Data_Get(void)
+{
+	return (struct Temperature_Struct *)(Sim_Driver_Instance_Get()->Temperature_Data);
+}
+
+/**
+ * Move Current_Temperature towards the target (cooler on) or ambient (cooler off) temperature,
+ * by Ramp_Rate degrees for each second elapsed since the last update.
+ * @see #Temperature_Data_Get
+ */
+static void Temperature_Update(void)
+{
+	struct Temperature_Struct *temperature_data = NULL;
+	struct timespec current_time;
+	double goal,step;
+
+	temperature_data = Temperature_Data_Get();
+	clock_gettime(CLOCK_REALTIME,&current_time);
+	step = fdifftime(current_time,temperature_data->Last_Update_Time)*temperature_data->Ramp_Rate;
+	temperature_data->Last_Update_Time = current_time;
+	if(temperature_data->Cooler_On)
+		goal = temperature_data->Target_Temperature;
+	else
+		goal = temperature_data->Ambient_Temperature;
+	if(fabs(goal-temperature_data->Current_Temperature) <= step)
+		temperature_data->Current_Temperature = goal;
+	else if(goal < temperature_data->Current_Temperature)
+		temperature_data->Current_Temperature -= step;
+	else
+		temperature_data->Current_Temperature += step;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
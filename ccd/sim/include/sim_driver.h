@@ -0,0 +1,32 @@
+/* sim_driver.h
+** $Header$
+*/
+#ifndef SIM_DRIVER_H
+#define SIM_DRIVER_H
+
+#include "ccd_driver.h"
+
+/* data types */
+/**
+ * Structure holding the state of one simulated camera. One is created by each Sim_Driver_Register call, and
+ * stored as the driver data of the calling thread's CCD driver context, so one process can drive several
+ * simulated cameras. Each member is private to the sim_*.c file that owns it.
+ * <dl>
+ * <dt>Setup_Data</dt> <dd>The camera's sim_setup data, see Sim_Setup_Data_Create.</dd>
+ * <dt>Exposure_Data</dt> <dd>The camera's sim_exposure data, see Sim_Exposure_Data_Create.</dd>
+ * <dt>Temperature_Data</dt> <dd>The camera's sim_temperature data, see Sim_Temperature_Data_Create.</dd>
+ * </dl>
+ */
+struct Sim_Driver_Instance_Struct
+{
+	void *Setup_Data;
+	void *Exposure_Data;
+	void *Temperature_Data;
+};
+
+extern int Sim_Driver_Register(struct CCD_Driver_Function_Struct *functions);
+extern struct Sim_Driver_Instance_Struct *Sim_Driver_Instance_Get(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
@@ -0,0 +1,38 @@
+/* sim_exposure.h
+** $Header$
+*/
+#ifndef SIM_EXPOSURE_H
+#define SIM_EXPOSURE_H
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes
+ * for time.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes
+ * for time.
+ */
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include "sim_general.h"
+
+/**
+ * Root string of keywords used by the simulated camera exposure code.
+ * @see sim_general.h#SIM_CCD_KEYWORD_ROOT
+ */
+#define SIM_EXPOSURE_KEYWORD_ROOT    SIM_CCD_KEYWORD_ROOT"exposure."
+
+extern void *Sim_Exposure_Data_Create(void);
+extern void Sim_Exposure_Data_Free(void *exposure_data);
+extern int Sim_Exposure_Startup(void);
+extern int Sim_Exposure_Expose(int open_shutter,struct timespec start_time,int exposure_time,
+			       void *buffer,size_t buffer_length);
+extern int Sim_Exposure_Bias(void *buffer,size_t buffer_length);
+extern int Sim_Exposure_Abort(void);
+extern struct timespec Sim_Exposure_Get_Exposure_Start_Time(void);
+extern int Sim_Exposure_Loop_Pause_Length_Set(int ms);
+
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
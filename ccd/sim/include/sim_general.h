@@ -0,0 +1,33 @@
+/* sim_general.h
+** $Header$
+*/
+#ifndef SIM_GENERAL_H
+#define SIM_GENERAL_H
+
+/* get config keyword root. */
+#include "ccd_config.h"
+/* get log block. */
+#include "ccd_general.h"
+
+/* hash defines */
+/**
+ * Root string of keywords used by the simulated camera driver.
+ * @see ../cdocs/ccd_config.html#CCD_CONFIG_KEYWORD_ROOT
+ */
+#define SIM_CCD_KEYWORD_ROOT                  CCD_CONFIG_KEYWORD_ROOT"sim."
+
+#ifndef fdifftime
+/**
+ * Return double difference (in seconds) between two struct timespec's.
+ * @param t0 A struct timespec.
+ * @param t1 A struct timespec.
+ * @return A double, in seconds, representing the time elapsed from t0 to t1.
+ * @see #CCD_GENERAL_ONE_SECOND_NS
+ */
+#define fdifftime(t1, t0) (((double)(((t1).tv_sec)-((t0).tv_sec))+(double)(((t1).tv_nsec)-((t0).tv_nsec))/CCD_GENERAL_ONE_SECOND_NS))
+#endif
+
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
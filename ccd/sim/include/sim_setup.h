@@ -0,0 +1,40 @@
+/* sim_setup.h
+** $Header$
+*/
+#ifndef SIM_SETUP_H
+#define SIM_SETUP_H
+
+/* get CCD_Setup_Window_Struct structure definition. */
+#include "ccd_setup.h"
+/* get config keyword root. */
+#include "sim_general.h"
+
+/**
+ * Root string of keywords used by the simulated camera setup code.
+ * @see sim_general.h#SIM_CCD_KEYWORD_ROOT
+ */
+#define SIM_SETUP_KEYWORD_ROOT    SIM_CCD_KEYWORD_ROOT"setup."
+
+extern void *Sim_Setup_Data_Create(void);
+extern void Sim_Setup_Data_Free(void *setup_data);
+extern int Sim_Setup_Startup(void);
+extern int Sim_Setup_Shutdown(void);
+extern int Sim_Setup_Dimensions_Check(int *ncols,int *nrows,int *hbin,int *vbin,
+				      int window_flags,struct CCD_Setup_Window_Struct *window);
+extern int Sim_Setup_Dimensions(int ncols,int nrows,int hbin,int vbin,
+				int window_flags,struct CCD_Setup_Window_Struct window);
+extern void Sim_Setup_Abort(void);
+extern int Sim_Setup_Get_NCols(void);
+extern int Sim_Setup_Get_NRows(void);
+extern int Sim_Setup_Get_Buffer_Length(void);
+extern int Sim_Setup_Get_Detector_Columns(void);
+extern int Sim_Setup_Get_Detector_Rows(void);
+extern int Sim_Setup_Get_Horizontal_Bin(void);
+extern int Sim_Setup_Get_Vertical_Bin(void);
+extern int Sim_Setup_Get_X_Start(void);
+extern int Sim_Setup_Get_Y_Start(void);
+
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
@@ -0,0 +1,28 @@
+/* sim_temperature.h
+** $Header$
+*/
+#ifndef SIM_TEMPERATURE_H
+#define SIM_TEMPERATURE_H
+
+/* get enum CCD_TEMPERATURE_STATUS */
+#include "ccd_temperature.h"
+/* get config keyword root. */
+#include "sim_general.h"
+
+/**
+ * Root string of keywords used by the simulated camera temperature code.
+ * @see sim_general.h#SIM_CCD_KEYWORD_ROOT
+ */
+#define SIM_TEMPERATURE_KEYWORD_ROOT    SIM_CCD_KEYWORD_ROOT"temperature."
+
+extern void *Sim_Temperature_Data_Create(void);
+extern void Sim_Temperature_Data_Free(void *temperature_data);
+extern int Sim_Temperature_Startup(void);
+extern int Sim_Temperature_Get(double *temperature,enum CCD_TEMPERATURE_STATUS *temperature_status);
+extern int Sim_Temperature_Set(double target_temperature);
+extern int Sim_Temperature_Cooler_On(void);
+extern int Sim_Temperature_Cooler_Off(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
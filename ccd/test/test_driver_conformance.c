@@ -0,0 +1,1111 @@
+/* test_driver_conformance.c
+ * $Id$
+ * Check a CCD driver conforms to the CCD library's driver contract, and measure its throughput.
+ */
+/**
+ * Check a CCD driver conforms to the CCD library's driver contract, and measure its throughput. The driver is
+ * loaded through CCD_Driver_Register, using the "ccd.driver.shared_library" and "ccd.driver.registration_function"
+ * keywords in the config file, so the same program runs against the simulated driver (sim.properties) and real
+ * cameras. The conformance tests are:
+ * <ul>
+ * <li>dimensions_full_frame - A full frame, unbinned, is accepted by CCD_Setup_Dimensions_Check and
+ *     CCD_Setup_Dimensions, and CCD_Setup_Get_NCols/NRows then return the detector size.
+ * <li>dimensions_reject_* - Illegal geometries (zero binning, an inverted window, a window off the detector)
+ *     are rejected by CCD_Setup_Dimensions_Check or CCD_Setup_Dimensions.
+ * <li>dimensions_clip_window - A window partly off the detector is either rejected, or adjusted by
+ *     CCD_Setup_Dimensions_Check to one on the detector that CCD_Setup_Dimensions accepts.
+ * <li>dimensions_window - A binned window is accepted, and NCols/NRows are then the window size.
+ * <li>buffer_short - CCD_Exposure_Expose fails when the buffer is one pixel shorter than NCols x NRows.
+ * <li>buffer_exact - CCD_Exposure_Expose succeeds with a buffer of exactly NCols x NRows pixels.
+ *     In both buffer tests the pixels after the length passed to the driver are guard pixels, that must not
+ *     be written.
+ * <li>start_time_now - With a zero start time, the reported exposure start time (CLOCK_REALTIME) is between
+ *     the call to CCD_Exposure_Expose and its return.
+ * <li>start_time_future - With a start time in the future, the reported exposure start time is within the
+ *     tolerance of the requested start time.
+ * <li>abort_latency - An exposure aborted (CCD_Exposure_Abort, from another thread) part way through returns
+ *     FALSE within the abort latency limit.
+ * <li>expose_after_abort - An exposure after an aborted exposure succeeds.
+ * <li>expose_after_idle_abort - An exposure after an abort when no exposure was in progress succeeds.
+ * </ul>
+ * The throughput test then configures a matrix of binnings and (centred, square) windows, and for each
+ * times the CCD_Setup_Dimensions call and a number of exposures, writing a CSV line with the frames per
+ * second and the per-call latency. Errors in the throughput test are reported in the CSV, and count as failures.
+ * <pre>
+ * test_driver_conformance -co[nfig_filename] &lt;filename&gt; [-xs[ize] &lt;n&gt;] [-ys[ize] &lt;n&gt;]
+ * 	[-exposure_length &lt;ms&gt;] [-frames &lt;n&gt;] [-csv &lt;filename&gt;] [-label &lt;string&gt;]
+ * 	[-abort_limit &lt;ms&gt;] [-start_tolerance &lt;ms&gt;] [-l[og_level] &lt;verbosity&gt;]
+ * </pre>
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ccd_config.h"
+#include "ccd_driver.h"
+#include "ccd_exposure.h"
+#include "ccd_general.h"
+#include "ccd_setup.h"
+
+/* hash definitions */
+/**
+ * Default number of columns on the detector.
+ */
+#define DEFAULT_SIZE_X		(1024)
+/**
+ * Default number of rows on the detector.
+ */
+#define DEFAULT_SIZE_Y		(1024)
+/**
+ * Default exposure length used by the conformance and throughput tests, in milliseconds.
+ */
+#define DEFAULT_EXPOSURE_LENGTH	(10)
+/**
+ * Default number of timed exposures per throughput configuration.
+ */
+#define DEFAULT_FRAME_COUNT	(10)
+/**
+ * Default longest time an aborted exposure may take to return, in milliseconds.
+ */
+#define DEFAULT_ABORT_LIMIT	(1000)
+/**
+ * Default tolerance on the reported exposure start time, in milliseconds.
+ */
+#define DEFAULT_START_TOLERANCE	(100)
+/**
+ * Length of the exposure that is aborted by the abort test, in milliseconds.
+ */
+#define ABORT_EXPOSURE_LENGTH	(10000)
+/**
+ * How long into the exposure the abort test aborts it, in milliseconds.
+ */
+#define ABORT_DELAY		(500)
+/**
+ * How far in the future the start_time_future test asks the exposure to start, in milliseconds.
+ */
+#define START_DELAY		(1000)
+/**
+ * The number of guard pixels after the buffer length passed to the driver.
+ */
+#define GUARD_PIXEL_COUNT	(1024)
+/**
+ * The value the buffer pixels are filled with before an exposure, to detect writes past the buffer length.
+ */
+#define GUARD_PIXEL_VALUE	(0xa5a5)
+/**
+ * The number of binnings in the throughput matrix.
+ */
+#define BIN_COUNT		(3)
+/**
+ * The number of window sizes in the throughput matrix.
+ */
+#define WINDOW_COUNT		(5)
+
+/* data types */
+/**
+ * Data passed to, and returned from, the thread running the exposure that is aborted.
+ * <dl>
+ * <dt>Buffer</dt> <dd>The image buffer.</dd>
+ * <dt>Buffer_Length</dt> <dd>The image buffer length in pixels.</dd>
+ * <dt>Retval</dt> <dd>The return value of CCD_Exposure_Expose.</dd>
+ * <dt>End_Time</dt> <dd>When CCD_Exposure_Expose returned (CLOCK_MONOTONIC).</dd>
+ * </dl>
+ */
+struct Abort_Thread_Struct
+{
+	unsigned short *Buffer;
+	size_t Buffer_Length;
+	int Retval;
+	struct timespec End_Time;
+};
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Filename for configuration file.
+ */
+static char *Config_Filename = NULL;
+/**
+ * The shared library name of the driver under test, written to the CSV.
+ */
+static char *Shared_Library_Name = NULL;
+/**
+ * The number of columns on the detector.
+ * @see #DEFAULT_SIZE_X
+ */
+static int Size_X = DEFAULT_SIZE_X;
+/**
+ * The number of rows on the detector.
+ * @see #DEFAULT_SIZE_Y
+ */
+static int Size_Y = DEFAULT_SIZE_Y;
+/**
+ * The exposure length used by the tests, in milliseconds.
+ * @see #DEFAULT_EXPOSURE_LENGTH
+ */
+static int Exposure_Length = DEFAULT_EXPOSURE_LENGTH;
+/**
+ * The number of timed exposures per throughput configuration. Zero skips the throughput test.
+ * @see #DEFAULT_FRAME_COUNT
+ */
+static int Frame_Count = DEFAULT_FRAME_COUNT;
+/**
+ * The longest time an aborted exposure may take to return, in milliseconds.
+ * @see #DEFAULT_ABORT_LIMIT
+ */
+static int Abort_Limit = DEFAULT_ABORT_LIMIT;
+/**
+ * The tolerance on the reported exposure start time, in milliseconds.
+ * @see #DEFAULT_START_TOLERANCE
+ */
+static int Start_Tolerance = DEFAULT_START_TOLERANCE;
+/**
+ * The CSV filename to write the throughput results to, or NULL to write to stdout.
+ */
+static char *CSV_Filename = NULL;
+/**
+ * A label written in the first column of every CSV line, e.g. the camera serial number.
+ */
+static char *Label = "";
+/**
+ * The binnings in the throughput matrix (the same in X and Y).
+ * @see #BIN_COUNT
+ */
+static int Bin_List[BIN_COUNT] = {1,2,4};
+/**
+ * The window sizes (binned pixels, square) in the throughput matrix. Zero means the full frame.
+ * @see #WINDOW_COUNT
+ */
+static int Window_Size_List[WINDOW_COUNT] = {0,512,256,128,64};
+/**
+ * The number of conformance tests run.
+ */
+static int Test_Count = 0;
+/**
+ * The number of conformance tests (and throughput configurations) that failed.
+ */
+static int Fail_Count = 0;
+
+/* internal routines */
+static void Test_Result(char *name,int passed,char *format,...);
+static int Test_Dimensions(void);
+static int Test_Dimensions_Rejected(char *name,int ncols,int nrows,int hbin,int vbin,int window_flags,
+				    struct CCD_Setup_Window_Struct window);
+static int Test_Buffer_Length(void);
+static int Test_Start_Time(void);
+static int Test_Abort(void);
+static void *Test_Abort_Thread(void *user_arg);
+static int Throughput(FILE *fp);
+static int Setup_Full_Frame(int bin);
+static unsigned short *Buffer_Create(size_t buffer_length);
+static int Buffer_Guard_Intact(unsigned short *buffer,size_t buffer_length);
+static void Error_Clear(void);
+static double Time_Difference_Ms(struct timespec end_time,struct timespec start_time);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* -----------------------------------------------------------------------------
+**      External routines
+** ----------------------------------------------------------------------------- */
+/**
+ * Main program.
+ * <ul>
+ * <li>We call Parse_Arguments to parse the command line.
+ * <li>We load the config file, and register the driver it specifies with CCD_Driver_Register.
+ * <li>We call CCD_Setup_Initialise and CCD_Setup_Startup. If "ccd.exposure.loop.pause.length" is in the config,
+ *     it is passed to CCD_Exposure_Loop_Pause_Length_Set, as the autoguider does.
+ * <li>We run the conformance tests (Test_Dimensions, Test_Buffer_Length, Test_Start_Time, Test_Abort).
+ * <li>We run the throughput test (Throughput), unless Frame_Count is zero.
+ * <li>We call CCD_Setup_Shutdown and CCD_Config_Shutdown.
+ * </ul>
+ * @param argc The number of arguments to the program.
+ * @param argv An array of argument strings.
+ * @return This function returns 0 if every test passed, 1 if a test failed, and a larger integer if
+ *         the driver could not be loaded or started.
+ * @see #Parse_Arguments
+ * @see #Test_Dimensions
+ * @see #Test_Buffer_Length
+ * @see #Test_Start_Time
+ * @see #Test_Abort
+ * @see #Throughput
+ * @see ../cdocs/ccd_config.html#CCD_Config_Load
+ * @see ../cdocs/ccd_driver.html#CCD_Driver_Register
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Startup
+ * @see ../cdocs/ccd_exposure.html#CCD_Exposure_Loop_Pause_Length_Set
+ */
+int main(int argc, char *argv[])
+{
+	char *registration_function = NULL;
+	FILE *fp = stdout;
+	int retval,loop_pause_length;
+
+	if(!Parse_Arguments(argc,argv))
+		return 2;
+	CCD_General_Set_Log_Handler_Function(CCD_General_Log_Handler_Stdout);
+	CCD_Config_Initialise();
+	if(Config_Filename == NULL)
+	{
+		fprintf(stderr, "test_driver_conformance: Config filename was NULL.\n");
+		Help();
+		return 2;
+	}
+	retval = CCD_Config_Load(Config_Filename);
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 3;
+	}
+	retval = CCD_Config_Get_String("ccd.driver.shared_library",&Shared_Library_Name);
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 4;
+	}
+	retval = CCD_Config_Get_String("ccd.driver.registration_function",&registration_function);
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 5;
+	}
+	retval = CCD_Driver_Register(Shared_Library_Name,registration_function);
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 6;
+	}
+	free(registration_function);
+	CCD_Setup_Initialise();
+	retval = CCD_Setup_Startup();
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 7;
+	}
+	if(CCD_Config_Get_Integer("ccd.exposure.loop.pause.length",&loop_pause_length))
+	{
+		if(!CCD_Exposure_Loop_Pause_Length_Set(loop_pause_length))
+		{
+			CCD_General_Error();
+			return 8;
+		}
+	}
+	Error_Clear();
+	fprintf(stdout,"test_driver_conformance:Testing %s (%d x %d).\n",Shared_Library_Name,Size_X,Size_Y);
+	/* conformance tests */
+	Test_Dimensions();
+	Test_Buffer_Length();
+	Test_Start_Time();
+	Test_Abort();
+	/* throughput */
+	if(Frame_Count > 0)
+	{
+		if(CSV_Filename != NULL)
+		{
+			fp = fopen(CSV_Filename,"w");
+			if(fp == NULL)
+			{
+				fprintf(stderr,"test_driver_conformance:Failed to open CSV file '%s'.\n",CSV_Filename);
+				return 9;
+			}
+		}
+		Throughput(fp);
+		if(fp != stdout)
+			fclose(fp);
+	}
+	retval = CCD_Setup_Shutdown();
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 10;
+	}
+	retval = CCD_Config_Shutdown();
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 11;
+	}
+	free(Shared_Library_Name);
+	fprintf(stdout,"test_driver_conformance:%d tests, %d failures:%s.\n",Test_Count,Fail_Count,
+		(Fail_Count == 0) ? "PASS" : "FAIL");
+	if(Fail_Count > 0)
+		return 1;
+	return 0;
+}
+
+/* -----------------------------------------------------------------------------
+**      Internal routines
+** ----------------------------------------------------------------------------- */
+/**
+ * Record and print the result of a conformance test. If the test failed, and a CCD library error is set,
+ * the error is printed too (and cleared).
+ * @param name The test name.
+ * @param passed Whether the test passed.
+ * @param format A printf format string describing the result, followed by its arguments.
+ * @see #Test_Count
+ * @see #Fail_Count
+ * @see ../cdocs/ccd_general.html#CCD_General_Is_Error
+ * @see ../cdocs/ccd_general.html#CCD_General_Error
+ */
+static void Test_Result(char *name,int passed,char *format,...)
+{
+	va_list ap;
+
+	Test_Count++;
+	if(passed == FALSE)
+		Fail_Count++;
+	fprintf(stdout,"%s %s:",passed ? "PASS" : "FAIL",name);
+	va_start(ap,format);
+	vfprintf(stdout,format,ap);
+	va_end(ap);
+	fprintf(stdout,"\n");
+	if((passed == FALSE)&&CCD_General_Is_Error())
+		CCD_General_Error();
+	Error_Clear();
+	fflush(stdout);
+}
+
+/**
+ * Test the dimensions contract: a legal full frame and window are accepted and give the right image size,
+ * and illegal geometries are rejected. The camera is left set up full frame, unbinned.
+ * @return The routine returns TRUE if every test passed, and FALSE otherwise.
+ * @see #Test_Result
+ * @see #Test_Dimensions_Rejected
+ * @see #Setup_Full_Frame
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Dimensions_Check
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Dimensions
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Get_NCols
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Get_NRows
+ */
+static int Test_Dimensions(void)
+{
+	struct CCD_Setup_Window_Struct window;
+	int ncols,nrows,hbin,vbin,passed,all_passed,check_retval;
+
+	all_passed = TRUE;
+	/* full frame */
+	passed = Setup_Full_Frame(1);
+	if(passed)
+		passed = ((CCD_Setup_Get_NCols() == Size_X)&&(CCD_Setup_Get_NRows() == Size_Y));
+	Test_Result("dimensions_full_frame",passed,"expected %d x %d, got %d x %d.",Size_X,Size_Y,
+		    CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows());
+	all_passed &= passed;
+	/* illegal geometries */
+	window.X_Start = 1;
+	window.Y_Start = 1;
+	window.X_End = 16;
+	window.Y_End = 16;
+	all_passed &= Test_Dimensions_Rejected("dimensions_reject_zero_x_bin",Size_X,Size_Y,0,1,FALSE,window);
+	all_passed &= Test_Dimensions_Rejected("dimensions_reject_zero_y_bin",Size_X,Size_Y,1,0,FALSE,window);
+	window.X_Start = 32;
+	window.X_End = 16;
+	all_passed &= Test_Dimensions_Rejected("dimensions_reject_inverted_window",Size_X,Size_Y,1,1,TRUE,window);
+	window.X_Start = Size_X+10;
+	window.Y_Start = Size_Y+10;
+	window.X_End = Size_X+20;
+	window.Y_End = Size_Y+20;
+	all_passed &= Test_Dimensions_Rejected("dimensions_reject_off_detector",Size_X,Size_Y,1,1,TRUE,window);
+	/* window partly off the detector: reject, or clip to a legal window */
+	ncols = Size_X;
+	nrows = Size_Y;
+	hbin = 1;
+	vbin = 1;
+	window.X_Start = Size_X-15;
+	window.Y_Start = Size_Y-15;
+	window.X_End = Size_X+16;
+	window.Y_End = Size_Y+16;
+	check_retval = CCD_Setup_Dimensions_Check(&ncols,&nrows,&hbin,&vbin,TRUE,&window);
+	if(check_retval == FALSE)
+		Test_Result("dimensions_clip_window",TRUE,"rejected by CCD_Setup_Dimensions_Check.");
+	else
+	{
+		passed = ((window.X_Start >= 1)&&(window.Y_Start >= 1)&&(window.X_End <= (ncols/hbin))&&
+			  (window.Y_End <= (nrows/vbin))&&(window.X_Start <= window.X_End)&&
+			  (window.Y_Start <= window.Y_End));
+		if(passed)
+			passed = CCD_Setup_Dimensions(ncols,nrows,hbin,vbin,TRUE,window);
+		Test_Result("dimensions_clip_window",passed,"adjusted to (%d,%d,%d,%d).",window.X_Start,window.Y_Start,
+			    window.X_End,window.Y_End);
+		all_passed &= passed;
+	}
+	/* a binned window */
+	ncols = Size_X;
+	nrows = Size_Y;
+	hbin = 2;
+	vbin = 2;
+	window.X_Start = 11;
+	window.Y_Start = 21;
+	window.X_End = 74;
+	window.Y_End = 84;
+	passed = CCD_Setup_Dimensions_Check(&ncols,&nrows,&hbin,&vbin,TRUE,&window);
+	if(passed)
+		passed = CCD_Setup_Dimensions(ncols,nrows,hbin,vbin,TRUE,window);
+	if(passed)
+	{
+		passed = ((CCD_Setup_Get_NCols() == (window.X_End-window.X_Start+1))&&
+			  (CCD_Setup_Get_NRows() == (window.Y_End-window.Y_Start+1)));
+	}
+	Test_Result("dimensions_window",passed,"window (%d,%d,%d,%d) binned 2x2: expected %d x %d, got %d x %d.",
+		    window.X_Start,window.Y_Start,window.X_End,window.Y_End,window.X_End-window.X_Start+1,
+		    window.Y_End-window.Y_Start+1,CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows());
+	all_passed &= passed;
+	if(!Setup_Full_Frame(1))
+	{
+		CCD_General_Error();
+		Error_Clear();
+		return FALSE;
+	}
+	return all_passed;
+}
+
+/**
+ * Test an illegal geometry is rejected, by CCD_Setup_Dimensions_Check or (if that accepts it) by
+ * CCD_Setup_Dimensions. If the geometry is accepted, the camera is reset to full frame.
+ * @param name The test name.
+ * @param ncols The number of unbinned columns.
+ * @param nrows The number of unbinned rows.
+ * @param hbin The binning in X.
+ * @param vbin The binning in Y.
+ * @param window_flags Whether to use the window.
+ * @param window The window (binned pixels, inclusive).
+ * @return The routine returns TRUE if the geometry was rejected, and FALSE if it was accepted.
+ * @see #Test_Result
+ * @see #Setup_Full_Frame
+ */
+static int Test_Dimensions_Rejected(char *name,int ncols,int nrows,int hbin,int vbin,int window_flags,
+				    struct CCD_Setup_Window_Struct window)
+{
+	if(!CCD_Setup_Dimensions_Check(&ncols,&nrows,&hbin,&vbin,window_flags,&window))
+	{
+		Test_Result(name,TRUE,"rejected by CCD_Setup_Dimensions_Check.");
+		return TRUE;
+	}
+	if(!CCD_Setup_Dimensions(ncols,nrows,hbin,vbin,window_flags,window))
+	{
+		Test_Result(name,TRUE,"rejected by CCD_Setup_Dimensions.");
+		return TRUE;
+	}
+	Test_Result(name,FALSE,"accepted ncols=%d,nrows=%d,hbin=%d,vbin=%d,window_flags=%d,window=(%d,%d,%d,%d).",
+		    ncols,nrows,hbin,vbin,window_flags,window.X_Start,window.Y_Start,window.X_End,window.Y_End);
+	Setup_Full_Frame(1);
+	Error_Clear();
+	return FALSE;
+}
+
+/**
+ * Test the buffer length contract, full frame unbinned: an exposure into a buffer one pixel short fails,
+ * one into a buffer of exactly NCols x NRows succeeds, and neither writes past the buffer length passed.
+ * @return The routine returns TRUE if every test passed, and FALSE otherwise.
+ * @see #Buffer_Create
+ * @see #Buffer_Guard_Intact
+ * @see ../cdocs/ccd_exposure.html#CCD_Exposure_Expose
+ */
+static int Test_Buffer_Length(void)
+{
+	struct timespec start_time;
+	unsigned short *buffer = NULL;
+	size_t buffer_length;
+	int retval,guard_intact,all_passed;
+
+	buffer_length = CCD_Setup_Get_NCols()*CCD_Setup_Get_NRows();
+	buffer = Buffer_Create(buffer_length);
+	if(buffer == NULL)
+		return FALSE;
+	start_time.tv_sec = 0;
+	start_time.tv_nsec = 0;
+	/* one pixel short */
+	retval = CCD_Exposure_Expose(TRUE,start_time,Exposure_Length,buffer,buffer_length-1);
+	guard_intact = Buffer_Guard_Intact(buffer,buffer_length-1);
+	Test_Result("buffer_short",(retval == FALSE)&&guard_intact,"CCD_Exposure_Expose returned %d, guard %s.",
+		    retval,guard_intact ? "intact" : "overwritten");
+	all_passed = (retval == FALSE)&&guard_intact;
+	/* exact length */
+	free(buffer);
+	buffer = Buffer_Create(buffer_length);
+	if(buffer == NULL)
+		return FALSE;
+	retval = CCD_Exposure_Expose(TRUE,start_time,Exposure_Length,buffer,buffer_length);
+	guard_intact = Buffer_Guard_Intact(buffer,buffer_length);
+	Test_Result("buffer_exact",retval&&guard_intact,"CCD_Exposure_Expose returned %d, guard %s.",retval,
+		    guard_intact ? "intact" : "overwritten");
+	all_passed &= retval&&guard_intact;
+	free(buffer);
+	return all_passed;
+}
+
+/**
+ * Test the exposure start time contract. With a zero start time the reported start time must be between the call
+ * and its return. With a start time START_DELAY ms in the future, the reported start time must be within
+ * Start_Tolerance ms of it, and the exposure must not return before the start time plus the exposure length.
+ * @return The routine returns TRUE if both tests passed, and FALSE otherwise.
+ * @see #START_DELAY
+ * @see #Start_Tolerance
+ * @see ../cdocs/ccd_exposure.html#CCD_Exposure_Expose
+ * @see ../cdocs/ccd_exposure.html#CCD_Exposure_Get_Exposure_Start_Time
+ */
+static int Test_Start_Time(void)
+{
+	struct timespec zero_time,call_time,return_time,start_time,reported_start_time;
+	unsigned short *buffer = NULL;
+	size_t buffer_length;
+	double early_ms,late_ms,return_ms;
+	int retval,passed,all_passed;
+
+	buffer_length = CCD_Setup_Get_NCols()*CCD_Setup_Get_NRows();
+	buffer = Buffer_Create(buffer_length);
+	if(buffer == NULL)
+		return FALSE;
+	/* start now */
+	zero_time.tv_sec = 0;
+	zero_time.tv_nsec = 0;
+	clock_gettime(CLOCK_REALTIME,&call_time);
+	retval = CCD_Exposure_Expose(TRUE,zero_time,Exposure_Length,buffer,buffer_length);
+	clock_gettime(CLOCK_REALTIME,&return_time);
+	passed = retval&&CCD_Exposure_Get_Exposure_Start_Time(&reported_start_time);
+	early_ms = Time_Difference_Ms(reported_start_time,call_time);
+	late_ms = Time_Difference_Ms(return_time,reported_start_time);
+	if(passed)
+		passed = (early_ms >= -Start_Tolerance)&&(late_ms >= 0.0);
+	Test_Result("start_time_now",passed,"start time %.1f ms after the call, %.1f ms before the return.",
+		    early_ms,late_ms);
+	all_passed = passed;
+	/* start in the future */
+	clock_gettime(CLOCK_REALTIME,&start_time);
+	start_time.tv_sec += START_DELAY/CCD_GENERAL_ONE_SECOND_MS;
+	start_time.tv_nsec += (START_DELAY%CCD_GENERAL_ONE_SECOND_MS)*CCD_GENERAL_ONE_MILLISECOND_NS;
+	if(start_time.tv_nsec >= CCD_GENERAL_ONE_SECOND_NS)
+	{
+		start_time.tv_sec++;
+		start_time.tv_nsec -= CCD_GENERAL_ONE_SECOND_NS;
+	}
+	retval = CCD_Exposure_Expose(TRUE,start_time,Exposure_Length,buffer,buffer_length);
+	clock_gettime(CLOCK_REALTIME,&return_time);
+	passed = retval&&CCD_Exposure_Get_Exposure_Start_Time(&reported_start_time);
+	late_ms = Time_Difference_Ms(reported_start_time,start_time);
+	return_ms = Time_Difference_Ms(return_time,start_time);
+	if(passed)
+		passed = (late_ms >= -Start_Tolerance)&&(late_ms <= Start_Tolerance)&&(return_ms >= Exposure_Length);
+	Test_Result("start_time_future",passed,"start time %.1f ms after the requested time, returned %.1f ms after it.",
+		    late_ms,return_ms);
+	all_passed &= passed;
+	free(buffer);
+	return all_passed;
+}
+
+/**
+ * Test the abort contract. An ABORT_EXPOSURE_LENGTH ms exposure is started in another thread, and aborted
+ * ABORT_DELAY ms later. The exposure must return FALSE within Abort_Limit ms of the abort. An exposure after
+ * the aborted one must then succeed, as must an exposure after an abort with no exposure in progress.
+ * @return The routine returns TRUE if every test passed, and FALSE otherwise.
+ * @see #Test_Abort_Thread
+ * @see #ABORT_EXPOSURE_LENGTH
+ * @see #ABORT_DELAY
+ * @see #Abort_Limit
+ * @see ../cdocs/ccd_exposure.html#CCD_Exposure_Abort
+ */
+static int Test_Abort(void)
+{
+	struct Abort_Thread_Struct thread_data;
+	struct timespec sleep_time,abort_time,zero_time;
+	pthread_t thread;
+	double latency_ms;
+	int retval,passed,all_passed;
+
+	thread_data.Buffer_Length = CCD_Setup_Get_NCols()*CCD_Setup_Get_NRows();
+	thread_data.Buffer = Buffer_Create(thread_data.Buffer_Length);
+	if(thread_data.Buffer == NULL)
+		return FALSE;
+	retval = pthread_create(&thread,NULL,Test_Abort_Thread,&thread_data);
+	if(retval != 0)
+	{
+		Test_Result("abort_latency",FALSE,"pthread_create failed (%d).",retval);
+		free(thread_data.Buffer);
+		return FALSE;
+	}
+	sleep_time.tv_sec = ABORT_DELAY/CCD_GENERAL_ONE_SECOND_MS;
+	sleep_time.tv_nsec = (ABORT_DELAY%CCD_GENERAL_ONE_SECOND_MS)*CCD_GENERAL_ONE_MILLISECOND_NS;
+	nanosleep(&sleep_time,NULL);
+	clock_gettime(CLOCK_MONOTONIC,&abort_time);
+	retval = CCD_Exposure_Abort();
+	pthread_join(thread,NULL);
+	latency_ms = Time_Difference_Ms(thread_data.End_Time,abort_time);
+	passed = retval&&(thread_data.Retval == FALSE)&&(latency_ms <= Abort_Limit);
+	Test_Result("abort_latency",passed,"CCD_Exposure_Abort returned %d, the exposure returned %d "
+		    "%.1f ms after the abort (limit %d ms).",retval,thread_data.Retval,latency_ms,Abort_Limit);
+	all_passed = passed;
+	Error_Clear();
+	/* the next exposure must work */
+	zero_time.tv_sec = 0;
+	zero_time.tv_nsec = 0;
+	retval = CCD_Exposure_Expose(TRUE,zero_time,Exposure_Length,thread_data.Buffer,thread_data.Buffer_Length);
+	Test_Result("expose_after_abort",retval,"CCD_Exposure_Expose returned %d.",retval);
+	all_passed &= retval;
+	/* an abort with nothing in progress must not abort the next exposure */
+	CCD_Exposure_Abort();
+	Error_Clear();
+	retval = CCD_Exposure_Expose(TRUE,zero_time,Exposure_Length,thread_data.Buffer,thread_data.Buffer_Length);
+	Test_Result("expose_after_idle_abort",retval,"CCD_Exposure_Expose returned %d.",retval);
+	all_passed &= retval;
+	free(thread_data.Buffer);
+	return all_passed;
+}
+
+/**
+ * Thread routine for Test_Abort, runs an ABORT_EXPOSURE_LENGTH ms exposure and records when it returned.
+ * @param user_arg A pointer to the Abort_Thread_Struct.
+ * @return The routine returns NULL.
+ * @see #Abort_Thread_Struct
+ */
+static void *Test_Abort_Thread(void *user_arg)
+{
+	struct Abort_Thread_Struct *thread_data = (struct Abort_Thread_Struct *)user_arg;
+	struct timespec zero_time;
+
+	zero_time.tv_sec = 0;
+	zero_time.tv_nsec = 0;
+	thread_data->Retval = CCD_Exposure_Expose(TRUE,zero_time,ABORT_EXPOSURE_LENGTH,thread_data->Buffer,
+						  thread_data->Buffer_Length);
+	clock_gettime(CLOCK_MONOTONIC,&(thread_data->End_Time));
+	return NULL;
+}
+
+/**
+ * Measure the driver throughput over the matrix of binnings (Bin_List) and window sizes (Window_Size_List).
+ * For each configuration CCD_Setup_Dimensions is timed, then one untimed exposure is taken, then Frame_Count
+ * timed exposures. A CSV line is written per configuration. Window sizes larger than the binned detector are
+ * skipped. A configuration that fails is written with its error, and counted as a failure.
+ * @param fp The file to write the CSV to.
+ * @return The routine returns TRUE if every configuration succeeded, and FALSE otherwise.
+ * @see #Bin_List
+ * @see #Window_Size_List
+ * @see #Frame_Count
+ * @see #Fail_Count
+ */
+static int Throughput(FILE *fp)
+{
+	struct CCD_Setup_Window_Struct window;
+	struct timespec start_time,end_time,zero_time;
+	char error_string[CCD_GENERAL_ERROR_STRING_LENGTH];
+	unsigned short *buffer = NULL;
+	size_t buffer_length;
+	double setup_ms,latency_ms,total_ms,min_ms,max_ms;
+	int b,w,frame,bin,size,ncols,nrows,retval,all_passed;
+
+	fprintf(fp,"label,driver,x_bin,y_bin,window_size,ncols,nrows,frames,exposure_ms,setup_ms,fps,"
+		"latency_mean_ms,latency_min_ms,latency_max_ms,overhead_ms,error\n");
+	zero_time.tv_sec = 0;
+	zero_time.tv_nsec = 0;
+	all_passed = TRUE;
+	for(b=0;b<BIN_COUNT;b++)
+	{
+		bin = Bin_List[b];
+		for(w=0;w<WINDOW_COUNT;w++)
+		{
+			size = Window_Size_List[w];
+			if((size > (Size_X/bin))||(size > (Size_Y/bin)))
+				continue;
+			ncols = Size_X;
+			nrows = Size_Y;
+			window.X_Start = (((Size_X/bin)-size)/2)+1;
+			window.Y_Start = (((Size_Y/bin)-size)/2)+1;
+			window.X_End = window.X_Start+size-1;
+			window.Y_End = window.Y_Start+size-1;
+			clock_gettime(CLOCK_MONOTONIC,&start_time);
+			retval = CCD_Setup_Dimensions(ncols,nrows,bin,bin,(size > 0),window);
+			clock_gettime(CLOCK_MONOTONIC,&end_time);
+			setup_ms = Time_Difference_Ms(end_time,start_time);
+			buffer = NULL;
+			buffer_length = CCD_Setup_Get_NCols()*CCD_Setup_Get_NRows();
+			if(retval)
+			{
+				buffer = (unsigned short*)malloc(buffer_length*sizeof(unsigned short));
+				retval = (buffer != NULL);
+				if(retval == FALSE)
+				{
+					CCD_General_Error_Number = 1;
+					sprintf(CCD_General_Error_String,"Failed to allocate %ld pixels.",buffer_length);
+				}
+			}
+			if(retval)
+				retval = CCD_Exposure_Expose(TRUE,zero_time,Exposure_Length,buffer,buffer_length);
+			total_ms = 0.0;
+			min_ms = 0.0;
+			max_ms = 0.0;
+			for(frame=0;retval&&(frame<Frame_Count);frame++)
+			{
+				clock_gettime(CLOCK_MONOTONIC,&start_time);
+				retval = CCD_Exposure_Expose(TRUE,zero_time,Exposure_Length,buffer,buffer_length);
+				clock_gettime(CLOCK_MONOTONIC,&end_time);
+				latency_ms = Time_Difference_Ms(end_time,start_time);
+				total_ms += latency_ms;
+				if((frame == 0)||(latency_ms < min_ms))
+					min_ms = latency_ms;
+				if((frame == 0)||(latency_ms > max_ms))
+					max_ms = latency_ms;
+			}
+			if(buffer != NULL)
+				free(buffer);
+			if(retval)
+			{
+				fprintf(fp,"%s,%s,%d,%d,%d,%d,%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,\n",Label,
+					Shared_Library_Name,bin,bin,size,CCD_Setup_Get_NCols(),CCD_Setup_Get_NRows(),
+					Frame_Count,Exposure_Length,setup_ms,(1000.0*Frame_Count)/total_ms,
+					total_ms/Frame_Count,min_ms,max_ms,(total_ms/Frame_Count)-Exposure_Length);
+			}
+			else
+			{
+				CCD_General_Error_To_String(error_string);
+				/* keep the error in one CSV field */
+				for(frame=0;error_string[frame] != '\0';frame++)
+				{
+					if((error_string[frame] == ',')||(error_string[frame] == '\n'))
+						error_string[frame] = ' ';
+				}
+				fprintf(fp,"%s,%s,%d,%d,%d,,,%d,%d,%.2f,,,,,,%s\n",Label,Shared_Library_Name,bin,bin,size,
+					Frame_Count,Exposure_Length,setup_ms,error_string);
+				Fail_Count++;
+				all_passed = FALSE;
+				Error_Clear();
+			}
+			fflush(fp);
+		}
+	}
+	Setup_Full_Frame(1);
+	return all_passed;
+}
+
+/**
+ * Set up the camera full frame (no window) with the specified binning, through CCD_Setup_Dimensions_Check
+ * and CCD_Setup_Dimensions.
+ * @param bin The binning in X and Y.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Dimensions_Check
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Dimensions
+ */
+static int Setup_Full_Frame(int bin)
+{
+	struct CCD_Setup_Window_Struct window;
+	int ncols,nrows,hbin,vbin;
+
+	ncols = Size_X;
+	nrows = Size_Y;
+	hbin = bin;
+	vbin = bin;
+	window.X_Start = 0;
+	window.Y_Start = 0;
+	window.X_End = 0;
+	window.Y_End = 0;
+	if(!CCD_Setup_Dimensions_Check(&ncols,&nrows,&hbin,&vbin,FALSE,&window))
+		return FALSE;
+	return CCD_Setup_Dimensions(ncols,nrows,hbin,vbin,FALSE,window);
+}
+
+/**
+ * Allocate an image buffer of buffer_length pixels plus GUARD_PIXEL_COUNT guard pixels, with every pixel
+ * set to GUARD_PIXEL_VALUE.
+ * @param buffer_length The number of image pixels.
+ * @return The buffer (to be freed by the caller), or NULL if it could not be allocated.
+ * @see #GUARD_PIXEL_COUNT
+ * @see #GUARD_PIXEL_VALUE
+ */
+static unsigned short *Buffer_Create(size_t buffer_length)
+{
+	unsigned short *buffer = NULL;
+	size_t i;
+
+	buffer = (unsigned short*)malloc((buffer_length+GUARD_PIXEL_COUNT)*sizeof(unsigned short));
+	if(buffer == NULL)
+	{
+		fprintf(stderr,"Buffer_Create:Failed to allocate %ld pixels.\n",buffer_length+GUARD_PIXEL_COUNT);
+		return NULL;
+	}
+	for(i=0;i<(buffer_length+GUARD_PIXEL_COUNT);i++)
+		buffer[i] = GUARD_PIXEL_VALUE;
+	return buffer;
+}
+
+/**
+ * Check the pixels after the buffer length passed to the driver still have the guard value.
+ * @param buffer The buffer, created by Buffer_Create.
+ * @param buffer_length The buffer length passed to the driver.
+ * @return The routine returns TRUE if the guard pixels are intact, and FALSE if any were overwritten.
+ * @see #GUARD_PIXEL_COUNT
+ * @see #GUARD_PIXEL_VALUE
+ */
+static int Buffer_Guard_Intact(unsigned short *buffer,size_t buffer_length)
+{
+	size_t i;
+
+	for(i=buffer_length;i<(buffer_length+GUARD_PIXEL_COUNT);i++)
+	{
+		if(buffer[i] != GUARD_PIXEL_VALUE)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Clear the CCD library error, after an expected failure.
+ * @see ../cdocs/ccd_general.html#CCD_General_Error_Number
+ * @see ../cdocs/ccd_general.html#CCD_General_Error_String
+ */
+static void Error_Clear(void)
+{
+	CCD_General_Error_Number = 0;
+	CCD_General_Error_String[0] = '\0';
+}
+
+/**
+ * Return the difference between two times, in milliseconds.
+ * @param end_time The later time.
+ * @param start_time The earlier time.
+ * @return end_time - start_time, in milliseconds.
+ */
+static double Time_Difference_Ms(struct timespec end_time,struct timespec start_time)
+{
+	return (((double)(end_time.tv_sec-start_time.tv_sec))*1000.0)+
+		(((double)(end_time.tv_nsec-start_time.tv_nsec))/CCD_GENERAL_ONE_MILLISECOND_NS);
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Test Driver Conformance:Help.\n");
+	fprintf(stdout,"This program loads the driver in the config file, checks it conforms to the CCD driver contract,\n");
+	fprintf(stdout,"and measures its throughput over a matrix of binnings and window sizes.\n");
+	fprintf(stdout,"test_driver_conformance -co[nfig_filename] <filename>\n");
+	fprintf(stdout,"\t[-xs[ize] <no. of pixels>][-ys[ize] <no. of pixels>]\n");
+	fprintf(stdout,"\t[-exposure_length <ms>][-frames <n>][-csv <filename>][-label <string>]\n");
+	fprintf(stdout,"\t[-abort_limit <ms>][-start_tolerance <ms>][-l[og_level] <verbosity>][-h[elp]]\n");
+	fprintf(stdout,"\n");
+	fprintf(stdout,"\t-xsize and -ysize are the unbinned detector size (default %d x %d).\n",DEFAULT_SIZE_X,
+		DEFAULT_SIZE_Y);
+	fprintf(stdout,"\t-exposure_length defaults to %d ms, -frames (per throughput configuration) to %d,\n",
+		DEFAULT_EXPOSURE_LENGTH,DEFAULT_FRAME_COUNT);
+	fprintf(stdout,"\t-frames 0 skips the throughput test. -csv defaults to stdout.\n");
+	fprintf(stdout,"\t-abort_limit defaults to %d ms, -start_tolerance to %d ms.\n",DEFAULT_ABORT_LIMIT,
+		DEFAULT_START_TOLERANCE);
+}
+
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @return The routine returns TRUE on success, and FALSE if an argument was not recognised or illegal.
+ * @see #Help
+ * @see #Config_Filename
+ * @see #Size_X
+ * @see #Size_Y
+ * @see #Exposure_Length
+ * @see #Frame_Count
+ * @see #CSV_Filename
+ * @see #Label
+ * @see #Abort_Limit
+ * @see #Start_Tolerance
+ * @see ../cdocs/ccd_general.html#CCD_General_Set_Log_Filter_Function
+ * @see ../cdocs/ccd_general.html#CCD_General_Log_Filter_Level_Absolute
+ * @see ../cdocs/ccd_general.html#CCD_General_Set_Log_Filter_Level
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval,log_level;
+
+	for(i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"-abort_limit")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Abort_Limit);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing abort limit %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:abort limit requires a number of milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-config_filename")==0)||(strcmp(argv[i],"-co")==0))
+		{
+			if((i+1)<argc)
+			{
+				Config_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:config filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-csv")==0)
+		{
+			if((i+1)<argc)
+			{
+				CSV_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:CSV filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-exposure_length")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Exposure_Length);
+				if((retval != 1)||(Exposure_Length < 0))
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing exposure length %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:exposure length requires a number of milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-frames")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Frame_Count);
+				if((retval != 1)||(Frame_Count < 0))
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing frame count %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:frames requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if(strcmp(argv[i],"-label")==0)
+		{
+			if((i+1)<argc)
+			{
+				Label = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:label required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-log_level")==0)||(strcmp(argv[i],"-l")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&log_level);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing log level %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				CCD_General_Set_Log_Filter_Function(CCD_General_Log_Filter_Level_Absolute);
+				CCD_General_Set_Log_Filter_Level(log_level);
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:Log Level requires a level.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-start_tolerance")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Start_Tolerance);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing start tolerance %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:start tolerance requires a number of milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-xsize")==0)||(strcmp(argv[i],"-xs")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Size_X);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing X Size %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:size required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-ysize")==0)||(strcmp(argv[i],"-ys")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Size_Y);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing Y Size %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:size required.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
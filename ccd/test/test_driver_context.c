@@ -0,0 +1,727 @@
+/* test_driver_context.c
+ * $Id$
+ * Drive two simulated cameras at once from one process, each in its own CCD driver context.
+ */
+/**
+ * Drive two simulated cameras at once from one process, each in its own CCD driver context
+ * (CCD_Driver_Context_Create). Each camera is run by its own thread, which selects the camera's context,
+ * registers the driver given by the "ccd.driver.shared_library" and "ccd.driver.registration_function" keywords
+ * in the config file (which must be instance-safe, e.g. the simulated driver in sim.properties), and then:
+ * <ul>
+ * <li>sets up a different geometry (camera 0 full frame unbinned, camera 1 a binned window).
+ * <li>sets a different cooler state (camera 0 cooling to a target, camera 1 cooler off).
+ * <li>takes a number of exposures, checking after each one that the image size is still its own.
+ * </ul>
+ * The tests are:
+ * <ul>
+ * <li>context_N_startup - Camera N's driver registered and started in its own context.
+ * <li>context_N_dimensions - Camera N's image size was its own geometry after every exposure.
+ * <li>context_N_temperature - Camera N's target and cached temperature are its own, and its cooler state
+ *     is its own (camera 0 has cooled below camera 1, and camera 1 is at ambient).
+ * <li>context_concurrent - The two cameras exposed at the same time, rather than serialized by one driver lock:
+ *     the total time is less than 75% of the sum of the two cameras' exposure times.
+ * </ul>
+ * <pre>
+ * test_driver_context -co[nfig_filename] &lt;filename&gt; [-xs[ize] &lt;n&gt;] [-ys[ize] &lt;n&gt;]
+ * 	[-exposure_length &lt;ms&gt;] [-frames &lt;n&gt;] [-l[og_level] &lt;verbosity&gt;]
+ * </pre>
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ccd_config.h"
+#include "ccd_driver.h"
+#include "ccd_exposure.h"
+#include "ccd_general.h"
+#include "ccd_setup.h"
+#include "ccd_temperature.h"
+
+/* hash definitions */
+/**
+ * Number of simulated cameras driven at once.
+ */
+#define CAMERA_COUNT		(2)
+/**
+ * Default number of columns on the detector.
+ */
+#define DEFAULT_SIZE_X		(1024)
+/**
+ * Default number of rows on the detector.
+ */
+#define DEFAULT_SIZE_Y		(1024)
+/**
+ * Default exposure length, in milliseconds.
+ */
+#define DEFAULT_EXPOSURE_LENGTH	(500)
+/**
+ * Default number of exposures each camera takes.
+ */
+#define DEFAULT_FRAME_COUNT	(4)
+/**
+ * The target temperature camera 0 cools to, in degrees C.
+ */
+#define COOLED_TARGET_TEMPERATURE	(-40.0)
+/**
+ * The target temperature set on camera 1, whose cooler is left off, in degrees C.
+ */
+#define UNCOOLED_TARGET_TEMPERATURE	(-10.0)
+/**
+ * The largest fraction of the serialized exposure time (the sum of both cameras' exposure times)
+ * the concurrent exposures may take.
+ */
+#define CONCURRENT_TIME_FRACTION	(0.75)
+
+/* data types */
+/**
+ * Data passed to, and returned from, the thread driving one camera.
+ * <dl>
+ * <dt>Index</dt> <dd>The camera number.</dd>
+ * <dt>Context</dt> <dd>The camera's CCD driver context.</dd>
+ * <dt>Bin</dt> <dd>The binning (the same in X and Y) the camera is set up with.</dd>
+ * <dt>Window_Flags</dt> <dd>Whether the camera is set up with Window.</dd>
+ * <dt>Window</dt> <dd>The window the camera is set up with, if Window_Flags is set.</dd>
+ * <dt>Cooler_On</dt> <dd>Whether the camera's cooler is turned on.</dd>
+ * <dt>Target_Temperature</dt> <dd>The target temperature set on the camera.</dd>
+ * <dt>Expected_NCols</dt> <dd>The number of binned columns the camera should read out.</dd>
+ * <dt>Expected_NRows</dt> <dd>The number of binned rows the camera should read out.</dd>
+ * <dt>Started</dt> <dd>Set if the driver was registered and started.</dd>
+ * <dt>Dimensions_Passed</dt> <dd>Set if every exposure succeeded, and the image size was right after each.</dd>
+ * <dt>NCols</dt> <dd>The number of binned columns after the last exposure.</dd>
+ * <dt>NRows</dt> <dd>The number of binned rows after the last exposure.</dd>
+ * <dt>Temperature_Retrieved</dt> <dd>Set if the temperature was retrieved after the exposures.</dd>
+ * <dt>Temperature</dt> <dd>The temperature after the exposures.</dd>
+ * <dt>Temperature_Status</dt> <dd>The temperature status after the exposures.</dd>
+ * <dt>Cached_Temperature</dt> <dd>The cached temperature, retrieved straight after Temperature.</dd>
+ * <dt>Cached_Target_Temperature</dt> <dd>The cached target temperature.</dd>
+ * <dt>Exposure_Time</dt> <dd>How long the exposures took, in milliseconds.</dd>
+ * </dl>
+ */
+struct Camera_Struct
+{
+	int Index;
+	struct CCD_Driver_Context_Struct *Context;
+	int Bin;
+	int Window_Flags;
+	struct CCD_Setup_Window_Struct Window;
+	int Cooler_On;
+	double Target_Temperature;
+	int Expected_NCols;
+	int Expected_NRows;
+	int Started;
+	int Dimensions_Passed;
+	int NCols;
+	int NRows;
+	int Temperature_Retrieved;
+	double Temperature;
+	enum CCD_TEMPERATURE_STATUS Temperature_Status;
+	double Cached_Temperature;
+	double Cached_Target_Temperature;
+	double Exposure_Time;
+};
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * Filename for configuration file.
+ */
+static char *Config_Filename = NULL;
+/**
+ * The shared library name of the driver under test.
+ */
+static char *Shared_Library_Name = NULL;
+/**
+ * The name of the driver's registration function.
+ */
+static char *Registration_Function = NULL;
+/**
+ * The number of columns on the detector.
+ * @see #DEFAULT_SIZE_X
+ */
+static int Size_X = DEFAULT_SIZE_X;
+/**
+ * The number of rows on the detector.
+ * @see #DEFAULT_SIZE_Y
+ */
+static int Size_Y = DEFAULT_SIZE_Y;
+/**
+ * The exposure length, in milliseconds.
+ * @see #DEFAULT_EXPOSURE_LENGTH
+ */
+static int Exposure_Length = DEFAULT_EXPOSURE_LENGTH;
+/**
+ * The number of exposures each camera takes.
+ * @see #DEFAULT_FRAME_COUNT
+ */
+static int Frame_Count = DEFAULT_FRAME_COUNT;
+/**
+ * The exposure loop pause length from the config file, or zero if it is not configured.
+ */
+static int Loop_Pause_Length = 0;
+/**
+ * The cameras.
+ * @see #CAMERA_COUNT
+ */
+static struct Camera_Struct Camera_List[CAMERA_COUNT];
+/**
+ * The number of tests run.
+ */
+static int Test_Count = 0;
+/**
+ * The number of tests that failed.
+ */
+static int Fail_Count = 0;
+
+/* internal routines */
+static void *Camera_Thread(void *user_arg);
+static int Camera_Start(struct Camera_Struct *camera);
+static void Camera_Expose(struct Camera_Struct *camera);
+static void Camera_Temperature(struct Camera_Struct *camera);
+static void Test_Result(char *name,int passed,char *format,...);
+static double Time_Difference_Ms(struct timespec end_time,struct timespec start_time);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* -----------------------------------------------------------------------------
+**      External routines
+** ----------------------------------------------------------------------------- */
+/**
+ * Main program.
+ * <ul>
+ * <li>We call Parse_Arguments to parse the command line, and load the config file.
+ * <li>We create a driver context for each camera, and set up each camera's geometry and cooler state.
+ * <li>We start a Camera_Thread for each camera, and wait for them all to finish.
+ * <li>We report the test results, and destroy the driver contexts.
+ * </ul>
+ * @param argc The number of arguments to the program.
+ * @param argv An array of argument strings.
+ * @return This function returns 0 if every test passed, 1 if a test failed, and a larger integer if
+ *         the test could not be run.
+ * @see #Parse_Arguments
+ * @see #Camera_List
+ * @see #Camera_Thread
+ * @see #Test_Result
+ * @see ../cdocs/ccd_config.html#CCD_Config_Load
+ * @see ../cdocs/ccd_driver.html#CCD_Driver_Context_Create
+ * @see ../cdocs/ccd_driver.html#CCD_Driver_Context_Destroy
+ */
+int main(int argc, char *argv[])
+{
+	pthread_t thread_list[CAMERA_COUNT];
+	struct timespec start_time,end_time;
+	struct Camera_Struct *camera = NULL;
+	char test_name[64];
+	double total_time,serialized_time;
+	int retval,i;
+
+	if(!Parse_Arguments(argc,argv))
+		return 2;
+	CCD_General_Set_Log_Handler_Function(CCD_General_Log_Handler_Stdout);
+	CCD_Config_Initialise();
+	if(Config_Filename == NULL)
+	{
+		fprintf(stderr, "test_driver_context: Config filename was NULL.\n");
+		Help();
+		return 2;
+	}
+	retval = CCD_Config_Load(Config_Filename);
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 3;
+	}
+	retval = CCD_Config_Get_String("ccd.driver.shared_library",&Shared_Library_Name);
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 4;
+	}
+	retval = CCD_Config_Get_String("ccd.driver.registration_function",&Registration_Function);
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 5;
+	}
+	if(!CCD_Config_Get_Integer("ccd.exposure.loop.pause.length",&Loop_Pause_Length))
+		Loop_Pause_Length = 0;
+	/* camera 0 is full frame, unbinned, cooling. camera 1 is a binned window, with the cooler off. */
+	memset(Camera_List,0,sizeof(Camera_List));
+	for(i = 0; i < CAMERA_COUNT; i++)
+	{
+		camera = &(Camera_List[i]);
+		camera->Index = i;
+		if(!CCD_Driver_Context_Create(&(camera->Context)))
+		{
+			CCD_General_Error();
+			return 6;
+		}
+		if(i == 0)
+		{
+			camera->Bin = 1;
+			camera->Window_Flags = FALSE;
+			camera->Cooler_On = TRUE;
+			camera->Target_Temperature = COOLED_TARGET_TEMPERATURE;
+			camera->Expected_NCols = Size_X;
+			camera->Expected_NRows = Size_Y;
+		}
+		else
+		{
+			camera->Bin = 2;
+			camera->Window_Flags = TRUE;
+			camera->Window.X_Start = 11;
+			camera->Window.Y_Start = 21;
+			camera->Window.X_End = 138;
+			camera->Window.Y_End = 84;
+			camera->Cooler_On = FALSE;
+			camera->Target_Temperature = UNCOOLED_TARGET_TEMPERATURE;
+			camera->Expected_NCols = (camera->Window.X_End-camera->Window.X_Start)+1;
+			camera->Expected_NRows = (camera->Window.Y_End-camera->Window.Y_Start)+1;
+		}
+	}
+	fprintf(stdout,"test_driver_context:Testing %d cameras of %s (%d x %d).\n",CAMERA_COUNT,Shared_Library_Name,
+		Size_X,Size_Y);
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	for(i = 0; i < CAMERA_COUNT; i++)
+	{
+		retval = pthread_create(&(thread_list[i]),NULL,Camera_Thread,&(Camera_List[i]));
+		if(retval != 0)
+		{
+			fprintf(stderr,"test_driver_context:pthread_create failed (%d).\n",retval);
+			return 7;
+		}
+	}
+	for(i = 0; i < CAMERA_COUNT; i++)
+		pthread_join(thread_list[i],NULL);
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	total_time = Time_Difference_Ms(end_time,start_time);
+	/* results */
+	serialized_time = 0.0;
+	for(i = 0; i < CAMERA_COUNT; i++)
+	{
+		camera = &(Camera_List[i]);
+		sprintf(test_name,"context_%d_startup",i);
+		Test_Result(test_name,camera->Started,"bin %d, window %s.",camera->Bin,
+			    camera->Window_Flags ? "TRUE" : "FALSE");
+		sprintf(test_name,"context_%d_dimensions",i);
+		Test_Result(test_name,camera->Started&&camera->Dimensions_Passed,"expected %d x %d, got %d x %d.",
+			    camera->Expected_NCols,camera->Expected_NRows,camera->NCols,camera->NRows);
+		serialized_time += camera->Exposure_Time;
+	}
+	for(i = 0; i < CAMERA_COUNT; i++)
+	{
+		camera = &(Camera_List[i]);
+		retval = camera->Temperature_Retrieved&&
+			(camera->Cached_Temperature == camera->Temperature)&&
+			(camera->Cached_Target_Temperature == camera->Target_Temperature);
+		if(i == 0)
+			retval = retval&&(camera->Temperature < Camera_List[1].Temperature);
+		else
+			retval = retval&&(camera->Temperature_Status == CCD_TEMPERATURE_STATUS_AMBIENT);
+		sprintf(test_name,"context_%d_temperature",i);
+		Test_Result(test_name,retval,"cooler %s, temperature %.2f (cached %.2f) status %s, "
+			    "target %.2f (cached %.2f).",camera->Cooler_On ? "on" : "off",camera->Temperature,
+			    camera->Cached_Temperature,CCD_Temperature_Status_To_String(camera->Temperature_Status),
+			    camera->Target_Temperature,camera->Cached_Target_Temperature);
+	}
+	Test_Result("context_concurrent",(total_time < (serialized_time*CONCURRENT_TIME_FRACTION)),
+		    "took %.1f ms, the cameras' exposures took %.1f ms in total.",total_time,serialized_time);
+	/* tidy up */
+	for(i = 0; i < CAMERA_COUNT; i++)
+	{
+		if(!CCD_Driver_Context_Destroy(&(Camera_List[i].Context)))
+			CCD_General_Error();
+	}
+	retval = CCD_Config_Shutdown();
+	if(retval == FALSE)
+	{
+		CCD_General_Error();
+		return 8;
+	}
+	free(Shared_Library_Name);
+	free(Registration_Function);
+	fprintf(stdout,"test_driver_context:%d tests, %d failures:%s.\n",Test_Count,Fail_Count,
+		(Fail_Count == 0) ? "PASS" : "FAIL");
+	if(Fail_Count > 0)
+		return 1;
+	return 0;
+}
+
+/* -----------------------------------------------------------------------------
+**      Internal routines
+** ----------------------------------------------------------------------------- */
+/**
+ * Thread driving one camera. It selects the camera's driver context, and then starts the camera,
+ * takes the exposures and retrieves the temperature. The driver is then shut down and closed.
+ * The results are stored in the camera structure. CCD library errors are printed as they occur, but as both
+ * threads share the CCD library error, an error printed may belong to the other camera.
+ * @param user_arg A pointer to the camera's Camera_Struct.
+ * @return The routine returns NULL.
+ * @see #Camera_Struct
+ * @see #Camera_Start
+ * @see #Camera_Expose
+ * @see #Camera_Temperature
+ * @see ../cdocs/ccd_driver.html#CCD_Driver_Context_Select
+ * @see ../cdocs/ccd_driver.html#CCD_Driver_Close
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Shutdown
+ */
+static void *Camera_Thread(void *user_arg)
+{
+	struct Camera_Struct *camera = (struct Camera_Struct *)user_arg;
+
+	if(!CCD_Driver_Context_Select(camera->Context))
+	{
+		CCD_General_Error();
+		return NULL;
+	}
+	camera->Started = Camera_Start(camera);
+	if(camera->Started == FALSE)
+	{
+		CCD_General_Error();
+		return NULL;
+	}
+	Camera_Expose(camera);
+	Camera_Temperature(camera);
+	if(!CCD_Setup_Shutdown())
+		CCD_General_Error();
+	if(!CCD_Driver_Close())
+		CCD_General_Error();
+	return NULL;
+}
+
+/**
+ * Register and start the driver in the calling thread's driver context, and set up the camera's
+ * geometry and cooler state.
+ * @param camera The camera.
+ * @return The routine returns TRUE on success, and FALSE on failure.
+ * @see #Shared_Library_Name
+ * @see #Registration_Function
+ * @see #Loop_Pause_Length
+ * @see ../cdocs/ccd_driver.html#CCD_Driver_Register
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Initialise
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Startup
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Dimensions
+ * @see ../cdocs/ccd_exposure.html#CCD_Exposure_Loop_Pause_Length_Set
+ * @see ../cdocs/ccd_temperature.html#CCD_Temperature_Set
+ * @see ../cdocs/ccd_temperature.html#CCD_Temperature_Cooler_On
+ * @see ../cdocs/ccd_temperature.html#CCD_Temperature_Cooler_Off
+ */
+static int Camera_Start(struct Camera_Struct *camera)
+{
+	if(!CCD_Driver_Register(Shared_Library_Name,Registration_Function))
+		return FALSE;
+	/* the flip keywords are optional here, as in test_driver_conformance */
+	CCD_Setup_Initialise();
+	if(!CCD_Setup_Startup())
+		return FALSE;
+	if(Loop_Pause_Length > 0)
+	{
+		if(!CCD_Exposure_Loop_Pause_Length_Set(Loop_Pause_Length))
+			return FALSE;
+	}
+	if(!CCD_Setup_Dimensions(Size_X,Size_Y,camera->Bin,camera->Bin,camera->Window_Flags,camera->Window))
+		return FALSE;
+	if(!CCD_Temperature_Set(camera->Target_Temperature))
+		return FALSE;
+	if(camera->Cooler_On)
+	{
+		if(!CCD_Temperature_Cooler_On())
+			return FALSE;
+	}
+	else
+	{
+		if(!CCD_Temperature_Cooler_Off())
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Take Frame_Count exposures with the camera, checking the image size after each one.
+ * Dimensions_Passed, NCols, NRows and Exposure_Time are set in the camera structure.
+ * @param camera The camera.
+ * @see #Frame_Count
+ * @see #Exposure_Length
+ * @see #Time_Difference_Ms
+ * @see ../cdocs/ccd_exposure.html#CCD_Exposure_Expose
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Get_NCols
+ * @see ../cdocs/ccd_setup.html#CCD_Setup_Get_NRows
+ */
+static void Camera_Expose(struct Camera_Struct *camera)
+{
+	struct timespec exposure_start_time,start_time,end_time;
+	unsigned short *buffer = NULL;
+	size_t buffer_length;
+	int i;
+
+	camera->Dimensions_Passed = TRUE;
+	buffer_length = camera->Expected_NCols*camera->Expected_NRows;
+	buffer = (unsigned short *)malloc(buffer_length*sizeof(unsigned short));
+	if(buffer == NULL)
+	{
+		fprintf(stderr,"Camera_Expose:Failed to allocate buffer for camera %d.\n",camera->Index);
+		camera->Dimensions_Passed = FALSE;
+		return;
+	}
+	exposure_start_time.tv_sec = 0;
+	exposure_start_time.tv_nsec = 0;
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	for(i = 0; i < Frame_Count; i++)
+	{
+		if(!CCD_Exposure_Expose(TRUE,exposure_start_time,Exposure_Length,buffer,buffer_length))
+		{
+			CCD_General_Error();
+			camera->Dimensions_Passed = FALSE;
+			break;
+		}
+		camera->NCols = CCD_Setup_Get_NCols();
+		camera->NRows = CCD_Setup_Get_NRows();
+		if((camera->NCols != camera->Expected_NCols)||(camera->NRows != camera->Expected_NRows))
+			camera->Dimensions_Passed = FALSE;
+	}
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	camera->Exposure_Time = Time_Difference_Ms(end_time,start_time);
+	free(buffer);
+}
+
+/**
+ * Retrieve the camera's temperature, and then its cached temperature and target temperature.
+ * Temperature_Retrieved, Temperature, Temperature_Status, Cached_Temperature and Cached_Target_Temperature
+ * are set in the camera structure.
+ * @param camera The camera.
+ * @see ../cdocs/ccd_temperature.html#CCD_Temperature_Get
+ * @see ../cdocs/ccd_temperature.html#CCD_Temperature_Cached_Temperature_Get
+ * @see ../cdocs/ccd_temperature.html#CCD_Temperature_Target_Temperature_Get
+ */
+static void Camera_Temperature(struct Camera_Struct *camera)
+{
+	camera->Temperature_Retrieved = FALSE;
+	if(!CCD_Temperature_Get(&(camera->Temperature),&(camera->Temperature_Status)))
+	{
+		CCD_General_Error();
+		return;
+	}
+	if(!CCD_Temperature_Cached_Temperature_Get(&(camera->Cached_Temperature),NULL,NULL))
+	{
+		CCD_General_Error();
+		return;
+	}
+	if(!CCD_Temperature_Target_Temperature_Get(&(camera->Cached_Target_Temperature)))
+	{
+		CCD_General_Error();
+		return;
+	}
+	camera->Temperature_Retrieved = TRUE;
+}
+
+/**
+ * Record and print the result of a test.
+ * @param name The test name.
+ * @param passed Whether the test passed.
+ * @param format A printf format string describing the result, followed by its arguments.
+ * @see #Test_Count
+ * @see #Fail_Count
+ */
+static void Test_Result(char *name,int passed,char *format,...)
+{
+	va_list ap;
+
+	Test_Count++;
+	if(passed == FALSE)
+		Fail_Count++;
+	fprintf(stdout,"%s %s:",passed ? "PASS" : "FAIL",name);
+	va_start(ap,format);
+	vfprintf(stdout,format,ap);
+	va_end(ap);
+	fprintf(stdout,"\n");
+	fflush(stdout);
+}
+
+/**
+ * Return the difference between two times, in milliseconds.
+ * @param end_time The later time.
+ * @param start_time The earlier time.
+ * @return end_time - start_time, in milliseconds.
+ */
+static double Time_Difference_Ms(struct timespec end_time,struct timespec start_time)
+{
+	return (((double)(end_time.tv_sec-start_time.tv_sec))*1000.0)+
+		(((double)(end_time.tv_nsec-start_time.tv_nsec))/CCD_GENERAL_ONE_MILLISECOND_NS);
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Test Driver Context:Help.\n");
+	fprintf(stdout,"This program drives two cameras of the (instance-safe) driver in the config file at once,\n");
+	fprintf(stdout,"each in its own CCD driver context, and checks their setup and temperature are independent.\n");
+	fprintf(stdout,"test_driver_context -co[nfig_filename] <filename>\n");
+	fprintf(stdout,"\t[-xs[ize] <no. of pixels>][-ys[ize] <no. of pixels>]\n");
+	fprintf(stdout,"\t[-exposure_length <ms>][-frames <n>][-l[og_level] <verbosity>][-h[elp]]\n");
+	fprintf(stdout,"\n");
+	fprintf(stdout,"\t-xsize and -ysize are the unbinned detector size (default %d x %d).\n",DEFAULT_SIZE_X,
+		DEFAULT_SIZE_Y);
+	fprintf(stdout,"\t-exposure_length defaults to %d ms, -frames (per camera) to %d.\n",
+		DEFAULT_EXPOSURE_LENGTH,DEFAULT_FRAME_COUNT);
+}
+
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @return The routine returns TRUE on success, and FALSE if an argument was not recognised or illegal.
+ * @see #Help
+ * @see #Config_Filename
+ * @see #Size_X
+ * @see #Size_Y
+ * @see #Exposure_Length
+ * @see #Frame_Count
+ * @see ../cdocs/ccd_general.html#CCD_General_Set_Log_Filter_Function
+ * @see ../cdocs/ccd_general.html#CCD_General_Log_Filter_Level_Absolute
+ * @see ../cdocs/ccd_general.html#CCD_General_Set_Log_Filter_Level
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval,log_level;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-config_filename")==0)||(strcmp(argv[i],"-co")==0))
+		{
+			if((i+1)<argc)
+			{
+				Config_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:config filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-exposure_length")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Exposure_Length);
+				if((retval != 1)||(Exposure_Length < 0))
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing exposure length %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:exposure length requires a number of milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-frames")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Frame_Count);
+				if((retval != 1)||(Frame_Count < 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing frame count %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:frames requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if((strcmp(argv[i],"-log_level")==0)||(strcmp(argv[i],"-l")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&log_level);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing log level %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				CCD_General_Set_Log_Filter_Function(CCD_General_Log_Filter_Level_Absolute);
+				CCD_General_Set_Log_Filter_Level(log_level);
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:Log Level requires a level.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-xsize")==0)||(strcmp(argv[i],"-xs")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Size_X);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing X Size %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:size required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-ysize")==0)||(strcmp(argv[i],"-ys")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Size_Y);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Parsing Y Size %s failed.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:size required.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+** $Log: not supported by cvs2svn $
+*/
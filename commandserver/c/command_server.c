@@ -37,6 +37,7 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/select.h>
+#include <sys/uio.h> /* writev */
 #include <netinet/in.h>
 #include <netinet/tcp.h> /* TCP_NODELAY */
 
@@ -77,6 +78,44 @@
  * connection.
  */
 #define IO_MESSAGE_SIZE_LENGTH	                  (sizeof(long))
+/**
+ * The magic bytes at the start of a binary message payload written by
+ * Command_Server_Write_Binary_Message_Compressed, marking it as Rice compressed.
+ * Command_Server_Read_Binary_Message checks for these to decompress the payload transparently.
+ * @see #Command_Server_Write_Binary_Message_Compressed
+ * @see #Command_Server_Read_Binary_Message
+ */
+#define COMPRESS_MAGIC                            ("CSRICE1")
+/**
+ * The number of magic bytes at the start of a compressed payload (including the terminating NULL).
+ * @see #COMPRESS_MAGIC
+ */
+#define COMPRESS_MAGIC_LENGTH                     (8)
+/**
+ * The length of the compressed payload header: the magic bytes, the element size (1 byte),
+ * three reserved bytes, and the uncompressed length (4 bytes, big endian).
+ * @see #COMPRESS_MAGIC_LENGTH
+ */
+#define COMPRESS_HEADER_LENGTH                    (16)
+/**
+ * The number of samples Rice encoded with the same k parameter.
+ */
+#define COMPRESS_BLOCK_SIZE                       (32)
+/**
+ * The number of bits used to store the k parameter at the start of each block.
+ */
+#define COMPRESS_K_BITS                           (5)
+/**
+ * The k parameter value signifying a block of samples stored verbatim (the differences did not compress).
+ */
+#define COMPRESS_K_ESCAPE                         (31)
+/**
+ * The largest uncompressed length Decompress_Rice will accept, in bytes. This is larger than the largest frame
+ * sent over a connection (a 2048x2048 image of 4 byte pixels, plus FITS headers), so a corrupt or malicious
+ * header cannot make the reader allocate an arbitrary amount of memory.
+ * @see #Decompress_Rice
+ */
+#define COMPRESS_UNCOMPRESSED_LENGTH_MAX          (32*1024*1024)
 
 
 /**
@@ -163,6 +202,27 @@ struct Command_Server_Server_Connection_Context_Struct
  */
 typedef struct Command_Server_Server_Connection_Context_Struct Command_Server_Server_Connection_Context_T;
 
+/**
+ * Structure holding the state of a bit stream being written or read by the Rice codec.
+ * <dl>
+ * <dt>Buffer</dt> <dd>The byte buffer being written to or read from.</dd>
+ * <dt>Buffer_Length</dt> <dd>The number of bytes in (or allocated for) Buffer.</dd>
+ * <dt>Byte_Index</dt> <dd>The index in Buffer of the next byte to write or read.</dd>
+ * <dt>Accumulator</dt> <dd>Bits not yet flushed to (or consumed from) Buffer, least significant bits latest.</dd>
+ * <dt>Accumulator_Bit_Count</dt> <dd>The number of valid bits in Accumulator.</dd>
+ * </dl>
+ * @see #Compress_Rice
+ * @see #Decompress_Rice
+ */
+struct Compress_Bit_Stream_Struct
+{
+	unsigned char *Buffer;
+	size_t Buffer_Length;
+	size_t Byte_Index;
+	unsigned long long Accumulator;
+	int Accumulator_Bit_Count;
+};
+
 /**
  * Structure declaration for holding global data to the command server.
  * <dl>
@@ -190,8 +250,17 @@ struct Command_Server_Data_Struct
 
 /* internal functions */
 static void *Command_Server_Server_Connection_Thread(void *user_arg);
-static int Write_Buffer(Command_Server_Handle_T handle,void *buffer,size_t buffer_length);
+static int Write_Vector(Command_Server_Handle_T handle,struct iovec *iov,int iov_count);
 static int Read_Binary_Buffer(Command_Server_Handle_T handle,void *data_buffer,size_t data_buffer_length);
+static int Compress_Rice(void *data_buffer,size_t data_buffer_length,int element_size,
+			 void **compressed_buffer,size_t *compressed_buffer_length);
+static int Decompress_Rice(void *compressed_buffer,size_t compressed_buffer_length,
+			   void **data_buffer,size_t *data_buffer_length);
+static void Compress_Put_Bits(struct Compress_Bit_Stream_Struct *stream,unsigned long value,int bit_count);
+static void Compress_Flush_Bits(struct Compress_Bit_Stream_Struct *stream);
+static int Compress_Get_Bits(struct Compress_Bit_Stream_Struct *stream,int bit_count,unsigned long *value);
+static unsigned long Compress_Get_Sample(unsigned char *buffer,int element_size);
+static void Compress_Set_Sample(unsigned char *buffer,int element_size,unsigned long value);
 
 
 /*===========================================================================*/
@@ -720,52 +789,77 @@ int Command_Server_Close_Server(Command_Server_Server_Context_T *server_context)
  * @param message A NULL terminated character string, that should not be NULL.
  * @return the success state of this function call
  * @see #Command_Server_Read_Message
- * @see #COMMAND_SERVER_MESSAGE_SIZE_LENGTH
- * @see #Write_Buffer
+ * @see #Command_Server_Write_Message_Length
  */
 int Command_Server_Write_Message(Command_Server_Handle_T handle,char *message)
 {
-	char *ch_ptr = NULL;
+	if(message == NULL)
+	{
+		Command_Server_Error_Number = 1;
+		sprintf(Command_Server_Error_String,
+			 "Command_Server_Write_Message:message was NULL.");
+		return(FALSE);
+	}
+	return Command_Server_Write_Message_Length(handle,message,strlen(message));
+}
+
+/**
+ * Routine to write a text message of known length to an Command_Server_IO stream represented by
+ * handle. A newline is sent after the message, if it does not altready contain one. The message and
+ * newline are sent with one call to Write_Vector, so the message is not copied.
+ * Command_Server_Read_Message will read a mesage sent with this routine.
+ * @param handle The IO handle used to make communications
+ * @param message A character string, that should not be NULL. It need not be NULL terminated.
+ * @param message_length The number of characters in message to send.
+ * @return the success state of this function call
+ * @see #Command_Server_Read_Message
+ * @see #Write_Vector
+ */
+int Command_Server_Write_Message_Length(Command_Server_Handle_T handle,char *message,size_t message_length)
+{
+	struct iovec iov[2];
+	int iov_count;
 
 	if(handle == NULL)
 	{
 		Command_Server_Error_Number = 4;
 		sprintf(Command_Server_Error_String,
-			 "Command_Server_Write_Message:handle was NULL.");
+			 "Command_Server_Write_Message_Length:handle was NULL.");
 		return(FALSE);
 	}
 	if(message == NULL)
 	{
 		Command_Server_Error_Number = 1;
 		sprintf(Command_Server_Error_String,
-			 "Command_Server_Write_Message:message was NULL.");
+			 "Command_Server_Write_Message_Length:message was NULL.");
 		return(FALSE);
 	}
 	/* send message block */
 #if COMMAND_SERVER_DEBUG > 5
-	Command_Server_Log_Format("command server","command_server.c","Command_Server_Write_Message",
+	Command_Server_Log_Format("command server","command_server.c","Command_Server_Write_Message_Length",
 				   LOG_VERBOSITY_VERBOSE,NULL,
-				  "about to send '%.80s'... of length %ld bytes .",message,strlen(message));
+				  "about to send '%.80s'... of length %ld bytes .",message,message_length);
 #endif
-	if(!Write_Buffer(handle,message,strlen(message)))
-		return FALSE;
+	iov[0].iov_base = message;
+	iov[0].iov_len = message_length;
+	iov_count = 1;
 	/* check newline, if not already sent send one */
-	ch_ptr = strchr(message,'\n');
-	if(ch_ptr == NULL)
+	if(memchr(message,'\n',message_length) == NULL)
 	{
 #if COMMAND_SERVER_DEBUG > 9
-		Command_Server_Log_Format("command server","command_server.c","Command_Server_Write_Message",
-					  LOG_VERBOSITY_VERY_VERBOSE,NULL,
-					  "about to write newline (seperately) to handle.");
+		Command_Server_Log_Format("command server","command_server.c","Command_Server_Write_Message_Length",
+					  LOG_VERBOSITY_VERY_VERBOSE,NULL,"about to append newline to message.");
 #endif
-		if(!Write_Buffer(handle,"\n",strlen("\n")))
-			return FALSE;
+		iov[1].iov_base = "\n";
+		iov[1].iov_len = strlen("\n");
+		iov_count = 2;
 	}
+	if(!Write_Vector(handle,iov,iov_count))
+		return FALSE;
 #if COMMAND_SERVER_DEBUG > 5
-	Command_Server_Log_Format("command server","command_server.c","Command_Server_Write_Message",
+	Command_Server_Log_Format("command server","command_server.c","Command_Server_Write_Message_Length",
 				   LOG_VERBOSITY_VERY_VERBOSE,NULL,"sent message.");
 #endif
-	/* free allocated memory */
 	return(TRUE);
 }
 
@@ -937,13 +1031,13 @@ int Command_Server_Read_Message(Command_Server_Handle_T handle,char **message)
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Command_Server_Read_Binary_Message
  * @see #IO_MESSAGE_SIZE_LENGTH
+ * @see #Write_Vector
  */
 int Command_Server_Write_Binary_Message(Command_Server_Handle_T handle,void *data_buffer,
 					       size_t data_buffer_length)
 {
-	void *message_block = NULL;
-	size_t bytes_written,total_bytes_written,message_block_len,message_length;
-	int i;
+	struct iovec iov[2];
+	size_t message_length;
 
 	/* check arguments */
 	if(handle == NULL)
@@ -958,42 +1052,88 @@ int Command_Server_Write_Binary_Message(Command_Server_Handle_T handle,void *dat
 		sprintf(Command_Server_Error_String,"Command_Server_Write_Binary_Message: data buffer was NULL.");
 		return(FALSE);
 	}
-	message_block_len = data_buffer_length + IO_MESSAGE_SIZE_LENGTH;
-	/* allocate message block */
-	message_block = malloc(message_block_len * sizeof(char));
-	if(message_block == NULL)
-	{
-		i = errno;
-		Command_Server_Error_Number = 8;
-		sprintf(Command_Server_Error_String,
-			 "Command_Server_Write_Binary_Message: memory allocation error: %s",strerror(i));
-		return(FALSE);
-	}
-	/* setup message block */
+	/* setup message block: length then data, written together without copying the data */
 	message_length = htonl(data_buffer_length);
-	memcpy(message_block,&message_length,IO_MESSAGE_SIZE_LENGTH);
-	memcpy((void *)((char *)message_block + IO_MESSAGE_SIZE_LENGTH),data_buffer,data_buffer_length);
+	iov[0].iov_base = &message_length;
+	iov[0].iov_len = IO_MESSAGE_SIZE_LENGTH;
+	iov[1].iov_base = data_buffer;
+	iov[1].iov_len = data_buffer_length;
 	/* send message block */
 #if COMMAND_SERVER_DEBUG > 3
 	Command_Server_Log_Format("command server","command_server.c","Command_Server_Write_Binary_Message",
 				  LOG_VERBOSITY_VERY_VERBOSE,NULL,"about to send buffer of %d bytes.",
 				  (data_buffer_length + IO_MESSAGE_SIZE_LENGTH) *sizeof(char));
 #endif
-	if(!Write_Buffer(handle,message_block,message_block_len))
+	if(!Write_Vector(handle,iov,2))
 		return FALSE;
 #if COMMAND_SERVER_DEBUG > 3
 	Command_Server_Log_Format("command server","command_server.c","Command_Server_Write_Binary_Message",
-				  LOG_VERBOSITY_VERY_VERBOSE,NULL,"sent buffer of length %d.",bytes_written);
+				  LOG_VERBOSITY_VERY_VERBOSE,NULL,"sent buffer of length %d.",
+				  data_buffer_length + IO_MESSAGE_SIZE_LENGTH);
 #endif
-	/* free allocated memory */
-	free(message_block);
 	return(TRUE);
 
 }
 
+/**
+ * Routine to write some binary data of the specified length over the open handle, Rice compressing it first.
+ * The data is treated as a series of big endian integers of element_size bytes (e.g. a FITS image), 
+ * each of which is predicted from the previous one, and the differences Rice coded in blocks of
+ * COMPRESS_BLOCK_SIZE samples. The compressed payload starts with a COMPRESS_HEADER_LENGTH header,
+ * which Command_Server_Read_Binary_Message recognises, and decompresses transparently.
+ * If element_size is 0, or the data does not get any smaller when compressed, the data is sent
+ * uncompressed with Command_Server_Write_Binary_Message.
+ * @param handle The handle to write the data to.
+ * @param data_buffer Pointer to the data.
+ * @param data_buffer_length The number of bytes of data.
+ * @param element_size The size of each integer sample in the data, in bytes: 0 (don't compress), 2 or 4.
+ * @return The routine returns TRUE on success, and FALSE on failure.
+ * @see #Command_Server_Write_Binary_Message
+ * @see #Command_Server_Read_Binary_Message
+ * @see #Compress_Rice
+ */
+int Command_Server_Write_Binary_Message_Compressed(Command_Server_Handle_T handle,void *data_buffer,
+						   size_t data_buffer_length,int element_size)
+{
+	void *compressed_buffer = NULL;
+	size_t compressed_buffer_length;
+	int retval;
+
+	if(element_size == 0)
+		return Command_Server_Write_Binary_Message(handle,data_buffer,data_buffer_length);
+	if((element_size != 2)&&(element_size != 4))
+	{
+		Command_Server_Error_Number = 51;
+		sprintf(Command_Server_Error_String,"Command_Server_Write_Binary_Message_Compressed: "
+			"Illegal element size %d.",element_size);
+		return(FALSE);
+	}
+	if(data_buffer == NULL)
+	{
+		Command_Server_Error_Number = 52;
+		sprintf(Command_Server_Error_String,"Command_Server_Write_Binary_Message_Compressed: "
+			"data buffer was NULL.");
+		return(FALSE);
+	}
+	if(!Compress_Rice(data_buffer,data_buffer_length,element_size,&compressed_buffer,&compressed_buffer_length))
+		return FALSE;
+	/* if compression didn't help, send the original data */
+	if(compressed_buffer == NULL)
+		return Command_Server_Write_Binary_Message(handle,data_buffer,data_buffer_length);
+#if COMMAND_SERVER_DEBUG > 3
+	Command_Server_Log_Format("command server","command_server.c",
+				  "Command_Server_Write_Binary_Message_Compressed",LOG_VERBOSITY_VERY_VERBOSE,NULL,
+				  "compressed %ld bytes to %ld bytes.",data_buffer_length,compressed_buffer_length);
+#endif
+	retval = Command_Server_Write_Binary_Message(handle,compressed_buffer,compressed_buffer_length);
+	free(compressed_buffer);
+	return retval;
+}
+
 /**
  * Routine to read some binary data over the open handle. The remote end of the handle should have 
- * sent the message using Command_Server_Write_Binary_Message.
+ * sent the message using Command_Server_Write_Binary_Message, or Command_Server_Write_Binary_Message_Compressed.
+ * In the latter case the data is decompressed before being returned.
  * @param handle The handle to read the data from.
  * @param data_buffer Address of a void pointer. On return from the routine, this will point to the read binary data
  *                    if the routine returns TRUE.
@@ -1001,14 +1141,19 @@ int Command_Server_Write_Binary_Message(Command_Server_Handle_T handle,void *dat
  *                    data in the data_buffer.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Command_Server_Write_Binary_Message
+ * @see #Command_Server_Write_Binary_Message_Compressed
  * @see #COMMAND_SERVER_ONE_MILLISECOND_NS
+ * @see #COMPRESS_MAGIC
  * @see #Read_Binary_Buffer
+ * @see #Decompress_Rice
  */
 int Command_Server_Read_Binary_Message(Command_Server_Handle_T handle,void **data_buffer,
 					      size_t *data_buffer_length)
 {
 	size_t bytes_read,total_bytes_read,message_length;
 	char message_length_buffer[IO_MESSAGE_SIZE_LENGTH];
+	void *compressed_buffer = NULL;
+	size_t compressed_buffer_length;
 	int i;
 
 	/* check arguments */
@@ -1074,6 +1219,26 @@ int Command_Server_Read_Binary_Message(Command_Server_Handle_T handle,void **dat
 	Command_Server_Log_Format("command server","command_server.c","Command_Server_Read_Binary_Message",
 				  LOG_VERBOSITY_VERY_VERBOSE,NULL,"received %d bytes of data.",message_length);
 #endif
+	/* if the data was sent by Command_Server_Write_Binary_Message_Compressed, decompress it */
+	if((message_length >= COMPRESS_HEADER_LENGTH)&&
+	   (memcmp((*data_buffer),COMPRESS_MAGIC,COMPRESS_MAGIC_LENGTH) == 0))
+	{
+		compressed_buffer = (*data_buffer);
+		compressed_buffer_length = message_length;
+		(*data_buffer) = NULL;
+		(*data_buffer_length) = 0;
+		if(!Decompress_Rice(compressed_buffer,compressed_buffer_length,data_buffer,data_buffer_length))
+		{
+			free(compressed_buffer);
+			return FALSE;
+		}
+		free(compressed_buffer);
+#if COMMAND_SERVER_DEBUG > 3
+		Command_Server_Log_Format("command server","command_server.c","Command_Server_Read_Binary_Message",
+					  LOG_VERBOSITY_VERY_VERBOSE,NULL,"decompressed %ld bytes to %ld bytes.",
+					  compressed_buffer_length,(*data_buffer_length));
+#endif
+	}
 	return(TRUE);
 
 }
@@ -1362,48 +1527,61 @@ static void *Command_Server_Server_Connection_Thread(void *user_arg)
 }
 
 /**
- * Write the contents of the buffer to a socket specified by handle.
- * Calls <b>write</b> in a loop until all the bytes are written, or an error occurs.
+ * Write the contents of a list of buffers to a socket specified by handle, in order.
+ * Calls <b>writev</b> in a loop until all the bytes are written, or an error occurs. After a partial write the
+ * iovec list is advanced past the bytes already written, so the contents of iov are modified.
  * @param handle The handle containing the socket to write to.
- * @param buffer A pointer to an area of memory containing something to write.
- * @param buffer_length The length of data in the buffer to be written, in bytes.
+ * @param iov A list of iovec structures, each describing an area of memory containing something to write.
+ * @param iov_count The number of iovec structures in iov.
  * @return The routine returns TRUE on success, and FALSE on failure.
  * @see #Command_Server_Handle_T
  */
-static int Write_Buffer(Command_Server_Handle_T handle,void *buffer,size_t buffer_length)
+static int Write_Vector(Command_Server_Handle_T handle,struct iovec *iov,int iov_count)
 {
-	size_t total_bytes_written,bytes_written;
-	int write_errno,retval;
+	ssize_t bytes_written;
+	int write_errno;
 
-#if COMMAND_SERVER_DEBUG > 9
-	Command_Server_Log_Format("command server","command_server.c","Write_Buffer",
-				  LOG_VERBOSITY_VERY_VERBOSE,NULL,"About to write %ld bytes.",buffer_length);
-#endif
-	total_bytes_written = 0;
-	while(total_bytes_written < buffer_length)
+	while(iov_count > 0)
 	{
+		/* skip any empty (or completely written) buffers */
+		if(iov->iov_len == 0)
+		{
+			iov++;
+			iov_count--;
+			continue;
+		}
 #if COMMAND_SERVER_DEBUG > 9
-		Command_Server_Log_Format("command server","command_server.c","Write_Buffer",
+		Command_Server_Log_Format("command server","command_server.c","Write_Vector",
 					  LOG_VERBOSITY_VERY_VERBOSE,NULL,
-					  "Writing %ld bytes starting at offset %ld.",
-					  buffer_length-total_bytes_written,total_bytes_written);
+					  "Writing %d buffers starting with %ld bytes.",iov_count,iov->iov_len);
 #endif
-		bytes_written = write(handle->Socket_fd,buffer+total_bytes_written,
-				      buffer_length-total_bytes_written);
+		bytes_written = writev(handle->Socket_fd,iov,iov_count);
 		if(bytes_written == -1)
 		{
 			write_errno = errno;
-			Command_Server_Error_Number = 3;
-			sprintf(Command_Server_Error_String,
-				"Write_Buffer: write error(%ld + %ld/%ld : %s).",
-				total_bytes_written,bytes_written,buffer_length,strerror(write_errno));
+			if(write_errno == EINTR)
+				continue;
+			Command_Server_Error_Number = 50;
+			sprintf(Command_Server_Error_String,"Write_Vector: writev error(%d buffers : %s).",
+				iov_count,strerror(write_errno));
 			return(FALSE);
 		}
 #if COMMAND_SERVER_DEBUG > 9
-		Command_Server_Log_Format("command server","command_server.c","Write_Buffer",
+		Command_Server_Log_Format("command server","command_server.c","Write_Vector",
 					  LOG_VERBOSITY_VERY_VERBOSE,NULL,"Wrote %ld bytes.",bytes_written);
 #endif
-		total_bytes_written += bytes_written;
+		/* advance past the written bytes */
+		while((iov_count > 0)&&(bytes_written >= (ssize_t)(iov->iov_len)))
+		{
+			bytes_written -= iov->iov_len;
+			iov++;
+			iov_count--;
+		}
+		if(iov_count > 0)
+		{
+			iov->iov_base = (char *)(iov->iov_base) + bytes_written;
+			iov->iov_len -= bytes_written;
+		}
 	}
 	return TRUE;
 }
@@ -1456,6 +1634,404 @@ static int Read_Binary_Buffer(Command_Server_Handle_T handle,void *data_buffer,s
 	return TRUE;
 }
 
+/**
+ * Rice compress a buffer of big endian integer samples. The first sample is stored verbatim, 
+ * then each subsequent sample is predicted by the previous one. The differences are zigzag mapped
+ * (so small negative differences become small positive numbers), and Rice coded in blocks
+ * of COMPRESS_BLOCK_SIZE samples, each block prefixed by a COMPRESS_K_BITS k parameter. The k parameter is
+ * chosen to minimise the encoded length of the block, and a block that would be longer Rice coded than
+ * verbatim is stored verbatim with a k of COMPRESS_K_ESCAPE, so noisy data (or the FITS header) can only
+ * grow by a few bits per block. Any trailing bytes (data_buffer_length not a multiple of element_size) are 
+ * appended verbatim.
+ * @param data_buffer Pointer to the data.
+ * @param data_buffer_length The number of bytes of data.
+ * @param element_size The size of each integer sample in the data, in bytes: 2 or 4.
+ * @param compressed_buffer The address of a void pointer, on return pointing to an allocated buffer
+ *        containing the header and compressed data. This should be freed by the caller. If the compressed
+ *        data was no smaller than the original, this is NULL on return.
+ * @param compressed_buffer_length The address of a size_t, on return containing the number of bytes
+ *        in compressed_buffer.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #COMPRESS_MAGIC
+ * @see #COMPRESS_HEADER_LENGTH
+ * @see #COMPRESS_BLOCK_SIZE
+ * @see #COMPRESS_K_BITS
+ * @see #COMPRESS_K_ESCAPE
+ * @see #Compress_Put_Bits
+ * @see #Compress_Flush_Bits
+ * @see #Compress_Get_Sample
+ * @see #Decompress_Rice
+ */
+static int Compress_Rice(void *data_buffer,size_t data_buffer_length,int element_size,
+			 void **compressed_buffer,size_t *compressed_buffer_length)
+{
+	struct Compress_Bit_Stream_Struct stream;
+	unsigned char *data = (unsigned char *)data_buffer;
+	unsigned long zigzag_list[COMPRESS_BLOCK_SIZE];
+	unsigned long mask,sample,previous_sample,difference,mean;
+	unsigned long long sum,cost,best_cost;
+	size_t sample_count,trailing_count,block_start,allocated_length,quotient;
+	int bit_count,block_count,max_k,k,best_k,k_estimate,j;
+
+	(*compressed_buffer) = NULL;
+	(*compressed_buffer_length) = 0;
+	bit_count = element_size*8;
+	mask = (unsigned long)((1ULL << bit_count)-1);
+	max_k = bit_count-2;
+	sample_count = data_buffer_length/element_size;
+	trailing_count = data_buffer_length%element_size;
+	/* too small to be worth compressing */
+	if(sample_count < 2)
+		return TRUE;
+	if(data_buffer_length > 0xffffffffUL)
+	{
+		Command_Server_Error_Number = 53;
+		sprintf(Command_Server_Error_String,"Compress_Rice: data buffer length %ld too long.",
+			data_buffer_length);
+		return(FALSE);
+	}
+	/* worst case: the header, every block verbatim plus its k parameter, the trailing bytes, 
+	** and the last partially filled byte */
+	allocated_length = COMPRESS_HEADER_LENGTH+data_buffer_length+(sample_count/COMPRESS_BLOCK_SIZE)+2;
+	stream.Buffer = (unsigned char *)malloc(allocated_length*sizeof(unsigned char));
+	if(stream.Buffer == NULL)
+	{
+		Command_Server_Error_Number = 54;
+		sprintf(Command_Server_Error_String,"Compress_Rice: Failed to allocate compressed buffer(%ld).",
+			allocated_length);
+		return(FALSE);
+	}
+	stream.Buffer_Length = allocated_length;
+	/* header */
+	memset(stream.Buffer,0,COMPRESS_HEADER_LENGTH);
+	memcpy(stream.Buffer,COMPRESS_MAGIC,COMPRESS_MAGIC_LENGTH);
+	stream.Buffer[COMPRESS_MAGIC_LENGTH] = (unsigned char)element_size;
+	Compress_Set_Sample(stream.Buffer+COMPRESS_HEADER_LENGTH-4,4,(unsigned long)data_buffer_length);
+	stream.Byte_Index = COMPRESS_HEADER_LENGTH;
+	stream.Accumulator = 0;
+	stream.Accumulator_Bit_Count = 0;
+	/* first sample verbatim */
+	previous_sample = Compress_Get_Sample(data,element_size);
+	Compress_Put_Bits(&stream,previous_sample,bit_count);
+	for(block_start = 1; block_start < sample_count; block_start += COMPRESS_BLOCK_SIZE)
+	{
+		block_count = min(COMPRESS_BLOCK_SIZE,sample_count-block_start);
+		/* zigzag map the differences from the previous sample */
+		sum = 0;
+		for(j = 0; j < block_count; j++)
+		{
+			sample = Compress_Get_Sample(data+((block_start+j)*element_size),element_size);
+			difference = (sample-previous_sample)&mask;
+			if(difference & (1UL << (bit_count-1)))
+				zigzag_list[j] = ((difference << 1)^mask)&mask;
+			else
+				zigzag_list[j] = (difference << 1)&mask;
+			sum += zigzag_list[j];
+			previous_sample = sample;
+		}
+		/* estimate k from the mean mapped difference, then pick the cheapest k around the estimate */
+		mean = (unsigned long)(sum/block_count);
+		k_estimate = 0;
+		while((mean >> (k_estimate+1)) > 0)
+			k_estimate++;
+		best_k = COMPRESS_K_ESCAPE;
+		best_cost = ((unsigned long long)block_count)*bit_count;
+		for(k = max(0,k_estimate-1); k <= min(max_k,k_estimate+1); k++)
+		{
+			cost = ((unsigned long long)block_count)*(k+1);
+			for(j = 0; j < block_count; j++)
+				cost += zigzag_list[j] >> k;
+			if(cost < best_cost)
+			{
+				best_cost = cost;
+				best_k = k;
+			}
+		}
+		/* write block */
+		Compress_Put_Bits(&stream,best_k,COMPRESS_K_BITS);
+		for(j = 0; j < block_count; j++)
+		{
+			if(best_k == COMPRESS_K_ESCAPE)
+			{
+				Compress_Put_Bits(&stream,zigzag_list[j],bit_count);
+			}
+			else
+			{
+				/* quotient in unary (zeros terminated by a one), then the remainder in best_k bits */
+				quotient = zigzag_list[j] >> best_k;
+				while(quotient > 32)
+				{
+					Compress_Put_Bits(&stream,0,32);
+					quotient -= 32;
+				}
+				Compress_Put_Bits(&stream,0,(int)quotient);
+				Compress_Put_Bits(&stream,1,1);
+				Compress_Put_Bits(&stream,zigzag_list[j],best_k);
+			}
+		}
+	}/* end for on blocks */
+	Compress_Flush_Bits(&stream);
+	/* if compression didn't help, return NULL and let the caller send the original */
+	if((stream.Byte_Index+trailing_count) >= data_buffer_length)
+	{
+		free(stream.Buffer);
+		return TRUE;
+	}
+	/* trailing bytes verbatim */
+	memcpy(stream.Buffer+stream.Byte_Index,data+(sample_count*element_size),trailing_count);
+	(*compressed_buffer) = stream.Buffer;
+	(*compressed_buffer_length) = stream.Byte_Index+trailing_count;
+	return TRUE;
+}
+
+/**
+ * Decompress a payload compressed by Compress_Rice. The header is checked, and every read from the bit stream
+ * is bounds checked, so a corrupt payload fails rather than overrunning either buffer. The uncompressed length
+ * in the header is checked against COMPRESS_UNCOMPRESSED_LENGTH_MAX, and against the number of bits in the
+ * stream, before the data buffer is allocated.
+ * @param compressed_buffer The compressed payload, starting with the COMPRESS_HEADER_LENGTH header.
+ * @param compressed_buffer_length The number of bytes in compressed_buffer.
+ * @param data_buffer The address of a void pointer, on return pointing to an allocated buffer containing
+ *        the decompressed data. This should be freed by the caller.
+ * @param data_buffer_length The address of a size_t, on return containing the number of bytes in data_buffer.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Compress_Rice
+ * @see #Compress_Get_Bits
+ * @see #Compress_Get_Sample
+ * @see #Compress_Set_Sample
+ * @see #COMPRESS_UNCOMPRESSED_LENGTH_MAX
+ */
+static int Decompress_Rice(void *compressed_buffer,size_t compressed_buffer_length,
+			   void **data_buffer,size_t *data_buffer_length)
+{
+	struct Compress_Bit_Stream_Struct stream;
+	unsigned char *compressed_data = (unsigned char *)compressed_buffer;
+	unsigned char *data = NULL;
+	unsigned long mask,sample,difference,zigzag,k,bit,remainder;
+	size_t uncompressed_length,sample_count,trailing_count,block_start,quotient;
+	int element_size,bit_count,block_count,max_k,j;
+
+	(*data_buffer) = NULL;
+	(*data_buffer_length) = 0;
+	element_size = compressed_data[COMPRESS_MAGIC_LENGTH];
+	if((element_size != 2)&&(element_size != 4))
+	{
+		Command_Server_Error_Number = 55;
+		sprintf(Command_Server_Error_String,"Decompress_Rice: Illegal element size %d.",element_size);
+		return(FALSE);
+	}
+	bit_count = element_size*8;
+	mask = (unsigned long)((1ULL << bit_count)-1);
+	max_k = bit_count-2;
+	uncompressed_length = Compress_Get_Sample(compressed_data+COMPRESS_HEADER_LENGTH-4,4);
+	sample_count = uncompressed_length/element_size;
+	trailing_count = uncompressed_length%element_size;
+	if((sample_count < 1)||(compressed_buffer_length < (COMPRESS_HEADER_LENGTH+trailing_count)))
+	{
+		Command_Server_Error_Number = 56;
+		sprintf(Command_Server_Error_String,"Decompress_Rice: Illegal uncompressed length %ld "
+			"(compressed length %ld).",uncompressed_length,compressed_buffer_length);
+		return(FALSE);
+	}
+	/* every sample after the first takes at least one bit of the stream, so the header cannot claim more
+	** samples than there are bits, nor more than the largest frame */
+	if((uncompressed_length > COMPRESS_UNCOMPRESSED_LENGTH_MAX)||
+	   (sample_count > ((compressed_buffer_length-COMPRESS_HEADER_LENGTH-trailing_count)*8)))
+	{
+		Command_Server_Error_Number = 61;
+		sprintf(Command_Server_Error_String,"Decompress_Rice: Uncompressed length %ld too large "
+			"(compressed length %ld, maximum %ld).",uncompressed_length,compressed_buffer_length,
+			(size_t)COMPRESS_UNCOMPRESSED_LENGTH_MAX);
+		return(FALSE);
+	}
+	data = (unsigned char *)malloc(uncompressed_length*sizeof(unsigned char));
+	if(data == NULL)
+	{
+		Command_Server_Error_Number = 57;
+		sprintf(Command_Server_Error_String,"Decompress_Rice: Failed to allocate data buffer(%ld).",
+			uncompressed_length);
+		return(FALSE);
+	}
+	stream.Buffer = compressed_data+COMPRESS_HEADER_LENGTH;
+	stream.Buffer_Length = compressed_buffer_length-COMPRESS_HEADER_LENGTH-trailing_count;
+	stream.Byte_Index = 0;
+	stream.Accumulator = 0;
+	stream.Accumulator_Bit_Count = 0;
+	/* first sample verbatim */
+	if(!Compress_Get_Bits(&stream,bit_count,&sample))
+	{
+		free(data);
+		return FALSE;
+	}
+	Compress_Set_Sample(data,element_size,sample);
+	for(block_start = 1; block_start < sample_count; block_start += COMPRESS_BLOCK_SIZE)
+	{
+		block_count = min(COMPRESS_BLOCK_SIZE,sample_count-block_start);
+		if(!Compress_Get_Bits(&stream,COMPRESS_K_BITS,&k))
+		{
+			free(data);
+			return FALSE;
+		}
+		if((k != COMPRESS_K_ESCAPE)&&(k > max_k))
+		{
+			free(data);
+			Command_Server_Error_Number = 58;
+			sprintf(Command_Server_Error_String,"Decompress_Rice: Illegal k %ld in block starting at %ld.",
+				k,block_start);
+			return(FALSE);
+		}
+		for(j = 0; j < block_count; j++)
+		{
+			if(k == COMPRESS_K_ESCAPE)
+			{
+				if(!Compress_Get_Bits(&stream,bit_count,&zigzag))
+				{
+					free(data);
+					return FALSE;
+				}
+			}
+			else
+			{
+				quotient = 0;
+				do
+				{
+					if(!Compress_Get_Bits(&stream,1,&bit))
+					{
+						free(data);
+						return FALSE;
+					}
+					if(bit == 0)
+						quotient++;
+				}
+				while(bit == 0);
+				if(quotient > (mask >> k))
+				{
+					free(data);
+					Command_Server_Error_Number = 59;
+					sprintf(Command_Server_Error_String,"Decompress_Rice: Illegal quotient %ld "
+						"for k %ld at sample %ld.",quotient,k,block_start+j);
+					return(FALSE);
+				}
+				if(!Compress_Get_Bits(&stream,(int)k,&remainder))
+				{
+					free(data);
+					return FALSE;
+				}
+				zigzag = (quotient << k)|remainder;
+			}
+			/* undo the zigzag mapping, and add the difference to the previous sample */
+			if(zigzag & 1)
+				difference = ((zigzag >> 1)^mask)&mask;
+			else
+				difference = zigzag >> 1;
+			sample = (sample+difference)&mask;
+			Compress_Set_Sample(data+((block_start+j)*element_size),element_size,sample);
+		}
+	}/* end for on blocks */
+	/* trailing bytes verbatim */
+	memcpy(data+(sample_count*element_size),compressed_data+compressed_buffer_length-trailing_count,
+	       trailing_count);
+	(*data_buffer) = data;
+	(*data_buffer_length) = uncompressed_length;
+	return TRUE;
+}
+
+/**
+ * Append the bottom bit_count bits of value to the bit stream, most significant bit first.
+ * The stream buffer must be large enough, Compress_Rice allocates the worst case length.
+ * @param stream The bit stream to write to.
+ * @param value The value to write.
+ * @param bit_count The number of bits of value to write, from 0 to 32.
+ * @see #Compress_Bit_Stream_Struct
+ */
+static void Compress_Put_Bits(struct Compress_Bit_Stream_Struct *stream,unsigned long value,int bit_count)
+{
+	stream->Accumulator = (stream->Accumulator << bit_count)|(value&((1ULL << bit_count)-1));
+	stream->Accumulator_Bit_Count += bit_count;
+	while(stream->Accumulator_Bit_Count >= 8)
+	{
+		stream->Accumulator_Bit_Count -= 8;
+		stream->Buffer[stream->Byte_Index++] = (unsigned char)((stream->Accumulator >>
+									stream->Accumulator_Bit_Count)&0xff);
+	}
+}
+
+/**
+ * Write any bits remaining in the bit stream accumulator to the buffer, padding the last byte with zeros.
+ * @param stream The bit stream to flush.
+ * @see #Compress_Bit_Stream_Struct
+ */
+static void Compress_Flush_Bits(struct Compress_Bit_Stream_Struct *stream)
+{
+	if(stream->Accumulator_Bit_Count > 0)
+	{
+		stream->Buffer[stream->Byte_Index++] = (unsigned char)((stream->Accumulator <<
+								     (8-stream->Accumulator_Bit_Count))&0xff);
+		stream->Accumulator_Bit_Count = 0;
+	}
+}
+
+/**
+ * Read the next bit_count bits from the bit stream, most significant bit first.
+ * @param stream The bit stream to read from.
+ * @param bit_count The number of bits to read, from 0 to 32.
+ * @param value The address of an unsigned long, on a successful return containing the bits read.
+ * @return The routine returns TRUE on success and FALSE if the stream ran out of data.
+ * @see #Compress_Bit_Stream_Struct
+ */
+static int Compress_Get_Bits(struct Compress_Bit_Stream_Struct *stream,int bit_count,unsigned long *value)
+{
+	while(stream->Accumulator_Bit_Count < bit_count)
+	{
+		if(stream->Byte_Index >= stream->Buffer_Length)
+		{
+			Command_Server_Error_Number = 60;
+			sprintf(Command_Server_Error_String,"Compress_Get_Bits: Ran out of compressed data "
+				"after %ld bytes.",stream->Byte_Index);
+			return(FALSE);
+		}
+		stream->Accumulator = (stream->Accumulator << 8)|stream->Buffer[stream->Byte_Index++];
+		stream->Accumulator_Bit_Count += 8;
+	}
+	stream->Accumulator_Bit_Count -= bit_count;
+	(*value) = (unsigned long)((stream->Accumulator >> stream->Accumulator_Bit_Count)&((1ULL << bit_count)-1));
+	return TRUE;
+}
+
+/**
+ * Get a big endian unsigned integer sample from a byte buffer.
+ * @param buffer The address of the first (most significant) byte of the sample.
+ * @param element_size The number of bytes in the sample.
+ * @return The sample value.
+ */
+static unsigned long Compress_Get_Sample(unsigned char *buffer,int element_size)
+{
+	unsigned long value;
+	int i;
+
+	value = 0;
+	for(i = 0; i < element_size; i++)
+		value = (value << 8)|buffer[i];
+	return value;
+}
+
+/**
+ * Set a big endian unsigned integer sample in a byte buffer.
+ * @param buffer The address of the first (most significant) byte of the sample.
+ * @param element_size The number of bytes in the sample.
+ * @param value The sample value.
+ */
+static void Compress_Set_Sample(unsigned char *buffer,int element_size,unsigned long value)
+{
+	int i;
+
+	for(i = element_size-1; i >= 0; i--)
+	{
+		buffer[i] = (unsigned char)(value&0xff);
+		value >>= 8;
+	}
+}
+
 /**
  * Internal routine to get the current time in a string. The string is returned in the format
  * '01/01/2000 13:59:59', or the string "Unknown time" if the routine failed.
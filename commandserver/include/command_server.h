@@ -50,9 +50,12 @@ extern int Command_Server_Start_Server ( unsigned short *port,void (*connection_
 					    Command_Server_Server_Context_T *server_context);
 extern int Command_Server_Open_Client(char *hostname,int port,Command_Server_Handle_T *handle);
 extern int Command_Server_Write_Message(Command_Server_Handle_T handle,char *message);
+extern int Command_Server_Write_Message_Length(Command_Server_Handle_T handle,char *message,size_t message_length);
 extern int Command_Server_Read_Message(Command_Server_Handle_T handle,char **message);
 extern int Command_Server_Write_Binary_Message(Command_Server_Handle_T handle,void *data_buffer,
 					       size_t data_buffer_length );
+extern int Command_Server_Write_Binary_Message_Compressed(Command_Server_Handle_T handle,void *data_buffer,
+							  size_t data_buffer_length,int element_size);
 extern int Command_Server_Read_Binary_Message(Command_Server_Handle_T handle,void **data_buffer,
 					      size_t *data_buffer_length);
 extern int Command_Server_Close_Client(Command_Server_Handle_T *handle);
@@ -1,6 +1,8 @@
 /**
  * Test program to send a "getfits" command to the test_server, and store the returned image data in a file.
- * test_getfits_command -h &lt;hostname&gt; -p &lt;port number&gt; -f &lt;FITS filename&gt;
+ * test_getfits_command -h &lt;hostname&gt; -p &lt;port number&gt; -f &lt;FITS filename&gt; -c &lt;getfits command&gt;
+ * If the command ends in compress=rice the server Rice compresses the image, Command_Server_Read_Binary_Message
+ * decompresses it, so the saved FITS file is the same.
  */
 
 /**
@@ -185,4 +187,5 @@ static void help(void)
 	printf("send_command help:\n");
 	printf("send_command -h <hostname> -p <port number> -f <FITS filename> -c <getfits command>\n");
 	printf("Use commands:'getfits field' or 'getfits guide'\n");
+	printf("Add 'compress=rice' to the command to compress the image in transit, e.g. 'getfits field raw compress=rice'\n");
 }
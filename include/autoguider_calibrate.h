@@ -0,0 +1,46 @@
+/* autoguider_calibrate.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_CALIBRATE_H
+#define AUTOGUIDER_CALIBRATE_H
+
+/* hash defines */
+/**
+ * The maximum length of a master calibration frame filename.
+ */
+#define AUTOGUIDER_CALIBRATE_FILENAME_LENGTH	(256)
+
+/* structures */
+/**
+ * Structure returned describing a master calibration frame built by Autoguider_Calibrate_Dark or
+ * Autoguider_Calibrate_Flat.
+ * <dl>
+ * <dt>Filename</dt> <dd>The FITS filename the master was written to.</dd>
+ * <dt>Frame_Count</dt> <dd>The number of frames combined.</dd>
+ * <dt>Mean</dt> <dd>The mean of the master frame (darks), or of the raw flat frames before normalisation (flats),
+ *     in counts.</dd>
+ * <dt>Elapsed_Time</dt> <dd>The time taken to acquire and combine the frames, and write the master,
+ *     in seconds.</dd>
+ * <dt>Is_Swapped</dt> <dd>A boolean, TRUE if the master was written to the configured dark/flat filename,
+ *     and will be used for the next dark subtraction/flat fielding.</dd>
+ * </dl>
+ */
+struct Autoguider_Calibrate_Result_Struct
+{
+	char Filename[AUTOGUIDER_CALIBRATE_FILENAME_LENGTH];
+	int Frame_Count;
+	double Mean;
+	double Elapsed_Time;
+	int Is_Swapped;
+};
+
+extern int Autoguider_Calibrate_Dark(int bin,int exposure_length,int exposure_count,char *filename,
+				     struct Autoguider_Calibrate_Result_Struct *result);
+extern int Autoguider_Calibrate_Flat(int bin,int exposure_length,int exposure_count,char *filename,
+				     struct Autoguider_Calibrate_Result_Struct *result);
+extern int Autoguider_Calibrate_Abort(void);
+extern int Autoguider_Calibrate_Is_Calibrating(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
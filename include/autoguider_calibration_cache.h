@@ -0,0 +1,101 @@
+/* autoguider_calibration_cache.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_CALIBRATION_CACHE_H
+#define AUTOGUIDER_CALIBRATION_CACHE_H
+#include <stdlib.h> /* size_t */
+
+/* hash defines */
+/**
+ * The magic number at the start of a calibration cache file ("AGCC").
+ */
+#define AUTOGUIDER_CALIBRATION_CACHE_MAGIC        (0x43434741)
+/**
+ * The version number of the calibration cache file format.
+ */
+#define AUTOGUIDER_CALIBRATION_CACHE_VERSION      (1)
+/**
+ * Calibration cache type for a dark.
+ */
+#define AUTOGUIDER_CALIBRATION_CACHE_TYPE_DARK    (1)
+/**
+ * Calibration cache type for a flat. The cached data is the inverted flat.
+ */
+#define AUTOGUIDER_CALIBRATION_CACHE_TYPE_FLAT    (2)
+/**
+ * The length of the source filename stored in the calibration cache file header.
+ */
+#define AUTOGUIDER_CALIBRATION_CACHE_SOURCE_FILENAME_LENGTH (256)
+
+/* structures */
+/**
+ * Structure at the start of every calibration cache file. The float pixel data starts Header_Length bytes
+ * into the file, which is a multiple of the page size so the data can be mmap'ed page aligned.
+ * All fields are in native byte order.
+ * <dl>
+ * <dt>Magic</dt> <dd>AUTOGUIDER_CALIBRATION_CACHE_MAGIC.</dd>
+ * <dt>Version</dt> <dd>AUTOGUIDER_CALIBRATION_CACHE_VERSION.</dd>
+ * <dt>Header_Length</dt> <dd>The offset of the pixel data in the file, in bytes.</dd>
+ * <dt>Type</dt> <dd>AUTOGUIDER_CALIBRATION_CACHE_TYPE_DARK or AUTOGUIDER_CALIBRATION_CACHE_TYPE_FLAT.</dd>
+ * <dt>NCols</dt> <dd>The number of binned columns in the pixel data.</dd>
+ * <dt>NRows</dt> <dd>The number of binned rows in the pixel data.</dd>
+ * <dt>Bin_X</dt> <dd>The X binning.</dd>
+ * <dt>Bin_Y</dt> <dd>The Y binning.</dd>
+ * <dt>Exposure_Length</dt> <dd>Darks: the exposure length in milliseconds. Flats: zero.</dd>
+ * <dt>Source_Size</dt> <dd>The size in bytes of the source FITS image when the cache file was made.</dd>
+ * <dt>Source_MTime</dt> <dd>The modification time of the source FITS image when the cache file was made.</dd>
+ * <dt>Source_Inode</dt> <dd>The inode number of the source FITS image when the cache file was made.</dd>
+ * <dt>Source_Checksum</dt> <dd>An Adler-32 checksum of the first FITS block (the primary header) of the
+ *     source FITS image.</dd>
+ * <dt>Source_Filename</dt> <dd>The filename of the source FITS image.</dd>
+ * </dl>
+ * @see #AUTOGUIDER_CALIBRATION_CACHE_MAGIC
+ * @see #AUTOGUIDER_CALIBRATION_CACHE_VERSION
+ * @see #AUTOGUIDER_CALIBRATION_CACHE_SOURCE_FILENAME_LENGTH
+ */
+struct Autoguider_Calibration_Cache_Header_Struct
+{
+	int Magic;
+	int Version;
+	int Header_Length;
+	int Type;
+	int NCols;
+	int NRows;
+	int Bin_X;
+	int Bin_Y;
+	int Exposure_Length;
+	int Source_Size;
+	int Source_MTime;
+	int Source_Inode;
+	unsigned int Source_Checksum;
+	char Source_Filename[AUTOGUIDER_CALIBRATION_CACHE_SOURCE_FILENAME_LENGTH];
+};
+
+/**
+ * Structure describing a mapped calibration cache file.
+ * <dl>
+ * <dt>Map_Address</dt> <dd>The address the file is mapped at, or NULL if nothing is mapped.</dd>
+ * <dt>Map_Length</dt> <dd>The length of the mapping in bytes.</dd>
+ * <dt>Data</dt> <dd>The (read only) pixel data in the mapping.</dd>
+ * </dl>
+ */
+struct Autoguider_Calibration_Cache_Map_Struct
+{
+	void *Map_Address;
+	size_t Map_Length;
+	float *Data;
+};
+
+extern int Autoguider_Calibration_Cache_Initialise(void);
+extern int Autoguider_Calibration_Cache_Is_Enabled(void);
+extern int Autoguider_Calibration_Cache_Map(char *source_filename,int type,int ncols,int nrows,int bin_x,int bin_y,
+					    int exposure_length,struct Autoguider_Calibration_Cache_Map_Struct *map,
+					    int *found);
+extern int Autoguider_Calibration_Cache_Create(char *source_filename,int type,int ncols,int nrows,
+					       int bin_x,int bin_y,int exposure_length,float *data);
+extern int Autoguider_Calibration_Cache_Unmap(struct Autoguider_Calibration_Cache_Map_Struct *map);
+extern int Autoguider_Calibration_Cache_Shutdown(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
@@ -16,6 +16,8 @@ extern int Autoguider_CIL_Guide_Packet_Send(float x_pos,float y_pos,int terminat
 extern int Autoguider_CIL_Guide_Packet_Close(void);
 extern int Autoguider_CIL_Guide_Packet_Send_Set(int on);
 extern int Autoguider_CIL_Guide_Packet_Send_Get(void);
+extern int Autoguider_CIL_Guide_Packet_Latency_Get(int *send_count,int *fail_count,double *last_latency,
+						   double *max_latency,double *mean_latency);
 
 extern int Autoguider_CIL_SDB_Packet_State_Set(eAggState_t state);
 extern int Autoguider_CIL_SDB_Packet_Exp_Time_Set(int ms);
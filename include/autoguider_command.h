@@ -3,6 +3,8 @@
 */
 #ifndef AUTOGUIDER_COMMAND_H
 #define AUTOGUIDER_COMMAND_H
+/* for Autoguider_General_Reply_Struct */
+#include "autoguider_general.h"
 
 /* enum */
 /**
@@ -20,19 +22,23 @@ enum COMMAND_AG_ON_TYPE
 	COMMAND_AG_ON_TYPE_RANK
 };
 
-extern int Autoguider_Command_Abort(char *command_string,char **reply_string);
-extern int Autoguider_Command_Agstate(char *command_string,char **reply_string);
-extern int Autoguider_Command_Autoguide(char *command_string,char **reply_string);
+extern int Autoguider_Command_Abort(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Agstate(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Autoguide(char *command_string,struct Autoguider_General_Reply_Struct *reply);
 extern int Autoguider_Command_Autoguide_On(enum COMMAND_AG_ON_TYPE on_type,float pixel_x,float pixel_y,int rank);
-extern int Autoguider_Command_Config_Load(char *command_string,char **reply_string);
-extern int Autoguider_Command_Object(char *command_string,char **reply_string);
-extern int Autoguider_Command_Status(char *command_string,char **reply_string);
-extern int Autoguider_Command_Temperature(char *command_string,char **reply_string);
-extern int Autoguider_Command_Expose(char *command_string,char **reply_string);
-extern int Autoguider_Command_Field(char *command_string,char **reply_string);
-extern int Autoguider_Command_Guide(char *command_string,char **reply_string);
-extern int Autoguider_Command_Get_Fits(char *command_string,void **buffer_ptr,size_t *buffer_length);
-extern int Autoguider_Command_Log_Level(char *command_string,char **reply_string);
+extern int Autoguider_Command_Calibrate(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Config_Load(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Object(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Status(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Temperature(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Expose(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Field(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Guide(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_Get_Fits(char *command_string,void **buffer_ptr,size_t *buffer_length,
+				       int *compress_element_size);
+extern int Autoguider_Command_Get_Preview(char *command_string,void **buffer_ptr,size_t *buffer_length);
+extern int Autoguider_Command_Log_Level(char *command_string,struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_Command_CCD(char *command_string,struct Autoguider_General_Reply_Struct *reply);
 
 /*
 ** $Log: not supported by cvs2svn $
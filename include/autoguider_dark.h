@@ -9,10 +9,15 @@ extern int Autoguider_Dark_Set_Dimension(int ncols,int nrows,int x_bin,int y_bin
 extern int Autoguider_Dark_Set(int bin_x,int bin_y,int exposure_length);
 extern int Autoguider_Dark_Subtract(float *buffer_ptr,int pixel_count,int ncols,int nrows,int use_window,
 				    struct CCD_Setup_Window_Struct window);
+extern int Autoguider_Dark_Subtract_Rows(float *buffer_ptr,int ncols,int nrows,int start_row,int row_count,
+					 int *error_number,char *error_string);
 extern int Autoguider_Dark_Shutdown(void);
+extern int Autoguider_Dark_Invalidate(void);
+extern int Autoguider_Dark_Set_Data(float *data_ptr,int pixel_count);
 extern int Autoguider_Dark_Get_Exposure_Length_Nearest(int *exposure_length,int *exposure_length_index);
 extern int Autoguider_Dark_Get_Exposure_Length_Index(int index,int *exposure_length);
 extern int Autoguider_Dark_Get_Exposure_Length_Count(void);
+extern int Autoguider_Dark_Model_Is_Enabled(void);
 /*
 ** $Log: not supported by cvs2svn $
 */
@@ -0,0 +1,13 @@
+/* autoguider_exposure.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_EXPOSURE_H
+#define AUTOGUIDER_EXPOSURE_H
+
+extern int Autoguider_Exposure_Initialise(void);
+extern int Autoguider_Exposure_Predict(int exposure_length,float peak_counts,float counts,float background,
+				       float target_counts,int *new_exposure_length,int *changed);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
@@ -0,0 +1,20 @@
+/* autoguider_fits_writer.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_FITS_WRITER_H
+#define AUTOGUIDER_FITS_WRITER_H
+/* for size_t */
+#include <stdlib.h>
+/* for Fits_Header_Struct */
+#include "autoguider_fits_header.h"
+
+extern int Autoguider_Fits_Writer_Initialise(void);
+extern int Autoguider_Fits_Writer_Buffer_Add(char *filename,void *buffer_ptr,size_t buffer_length);
+extern int Autoguider_Fits_Writer_Image_Add(char *filename,int data_type,void *data_ptr,int ncols,int nrows,
+					    struct Fits_Header_Struct header);
+extern int Autoguider_Fits_Writer_Stats_Get(int *written_count,int *failed_count,int *pending_count);
+extern int Autoguider_Fits_Writer_Shutdown(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
@@ -9,7 +9,11 @@ extern int Autoguider_Flat_Set_Dimension(int ncols,int nrows,int x_bin,int y_bin
 extern int Autoguider_Flat_Set(int bin_x,int bin_y);
 extern int Autoguider_Flat_Field(float *buffer_ptr,int pixel_count,int ncols,int nrows,int use_window,
 			  struct CCD_Setup_Window_Struct window);
+extern int Autoguider_Flat_Field_Rows(float *buffer_ptr,int ncols,int nrows,int start_row,int row_count,
+				      int *flat_zero_count,int *error_number,char *error_string);
 extern int Autoguider_Flat_Shutdown(void);
+extern int Autoguider_Flat_Invalidate(void);
+extern int Autoguider_Flat_Set_Data(float *data_ptr,int pixel_count);
 
 /*
 ** $Log: not supported by cvs2svn $
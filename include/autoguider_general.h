@@ -5,6 +5,7 @@
 #define AUTOGUIDER_GENERAL_H
 
 #include <pthread.h>
+#include <stdlib.h> /* size_t */
 
 /* hash defines */
 /**
@@ -43,6 +44,11 @@
  */
 #define AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH	(1024)
 
+/**
+ * The initial number of characters allocated to a reply buffer (Autoguider_General_Reply_Struct).
+ */
+#define AUTOGUIDER_GENERAL_REPLY_INITIAL_LENGTH	(1024)
+
 /**
  * The number of nanoseconds in one second. A struct timespec has fields in nanoseconds.
  */
@@ -71,6 +77,24 @@
 #define fdifftime(t1, t0) (((double)(((t1).tv_sec)-((t0).tv_sec))+(double)(((t1).tv_nsec)-((t0).tv_nsec))/AUTOGUIDER_GENERAL_ONE_SECOND_NS))
 #endif
 
+/* structures */
+/**
+ * A reply buffer, used to build command replies. The buffer grows by doubling it's allocated length,
+ * and keeps track of the length of the reply, so a reply can be built and sent in time linear in it's length.
+ * <dl>
+ * <dt>String</dt> <dd>The allocated reply string, NULL terminated. NULL if nothing has been allocated yet.</dd>
+ * <dt>Length</dt> <dd>The number of characters in the reply string (not including the NULL terminator).</dd>
+ * <dt>Allocated_Length</dt> <dd>The number of characters allocated for String.</dd>
+ * </dl>
+ * @see #AUTOGUIDER_GENERAL_REPLY_INITIAL_LENGTH
+ */
+struct Autoguider_General_Reply_Struct
+{
+	char *String;
+	size_t Length;
+	size_t Allocated_Length;
+};
+
 /* external variabless */
 extern int Autoguider_General_Error_Number;
 extern char Autoguider_General_Error_String[];
@@ -123,8 +147,15 @@ extern int Autoguider_General_Log_Filter_Level_Bitwise(const char *sub_system,co
 
 /* utility routines */
 extern int Autoguider_General_Add_String(char **string,char *add);
+extern void Autoguider_General_Reply_Initialise(struct Autoguider_General_Reply_Struct *reply);
+extern int Autoguider_General_Reply_Reserve(struct Autoguider_General_Reply_Struct *reply,size_t add_length);
+extern int Autoguider_General_Reply_Add(struct Autoguider_General_Reply_Struct *reply,char *add);
+extern int Autoguider_General_Reply_Add_Format(struct Autoguider_General_Reply_Struct *reply,char *format,...);
+extern void Autoguider_General_Reply_Reset(struct Autoguider_General_Reply_Struct *reply);
+extern void Autoguider_General_Reply_Free(struct Autoguider_General_Reply_Struct *reply);
 extern int Autoguider_General_Int_List_Add(int add,int **list,int *count);
 extern int Autoguider_General_Int_List_Sort(const void *f,const void *s);
+extern int Autoguider_General_Filename_Is_Leafname(char *filename);
 extern int Autoguider_General_Mutex_Lock(pthread_mutex_t *mutex);
 extern int Autoguider_General_Mutex_Unlock(pthread_mutex_t *mutex);
 
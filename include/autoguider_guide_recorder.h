@@ -0,0 +1,90 @@
+/* autoguider_guide_recorder.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_GUIDE_RECORDER_H
+#define AUTOGUIDER_GUIDE_RECORDER_H
+
+/* hash defines */
+/**
+ * The magic number at the start of each record in a binary guide recorder container ("AGFR").
+ */
+#define AUTOGUIDER_GUIDE_RECORDER_MAGIC           (0x52464741)
+/**
+ * The version number of the binary guide recorder container record format.
+ */
+#define AUTOGUIDER_GUIDE_RECORDER_VERSION         (1)
+
+/* structures */
+/**
+ * Structure holding the metadata for one recorded guide frame. In the binary container format
+ * this structure is written (in native byte order) followed by NCols*NRows floats of reduced pixel data.
+ * <dl>
+ * <dt>Magic</dt> <dd>AUTOGUIDER_GUIDE_RECORDER_MAGIC, filled in by the recorder.</dd>
+ * <dt>Version</dt> <dd>AUTOGUIDER_GUIDE_RECORDER_VERSION, filled in by the recorder.</dd>
+ * <dt>Record_Length</dt> <dd>Length of the record in bytes, including this header, filled in by the recorder.</dd>
+ * <dt>Guide_Id</dt> <dd>The guide session identifier.</dd>
+ * <dt>Frame_Number</dt> <dd>The frame number within the guide session.</dd>
+ * <dt>Start_Time_Sec</dt> <dd>The exposure start time, seconds since the epoch.</dd>
+ * <dt>Start_Time_NSec</dt> <dd>The exposure start time, nanoseconds part.</dd>
+ * <dt>Exposure_Length</dt> <dd>The exposure length in milliseconds.</dd>
+ * <dt>Bin_X</dt> <dd>X binning.</dd>
+ * <dt>Bin_Y</dt> <dd>Y binning.</dd>
+ * <dt>Window_X_Start</dt> <dd>Guide window start X position (inclusive).</dd>
+ * <dt>Window_Y_Start</dt> <dd>Guide window start Y position (inclusive).</dd>
+ * <dt>Window_X_End</dt> <dd>Guide window end X position (inclusive).</dd>
+ * <dt>Window_Y_End</dt> <dd>Guide window end Y position (inclusive).</dd>
+ * <dt>NCols</dt> <dd>Number of columns of pixel data.</dd>
+ * <dt>NRows</dt> <dd>Number of rows of pixel data.</dd>
+ * <dt>CCD_Temperature</dt> <dd>The CCD temperature at the start of the exposure, in degrees centigrade.</dd>
+ * <dt>Loop_Cadence</dt> <dd>The time taken for the last guide loop, in seconds.</dd>
+ * <dt>Centroid_X</dt> <dd>The CCD X position of the guide centroid sent to the TCS.</dd>
+ * <dt>Centroid_Y</dt> <dd>The CCD Y position of the guide centroid sent to the TCS.</dd>
+ * <dt>FWHM_X</dt> <dd>The FWHM of the guide object in X, in pixels.</dd>
+ * <dt>FWHM_Y</dt> <dd>The FWHM of the guide object in Y, in pixels.</dd>
+ * <dt>Peak_Counts</dt> <dd>The peak counts of the guide object.</dd>
+ * <dt>Total_Counts</dt> <dd>The integrated counts of the guide object.</dd>
+ * <dt>Status_Char</dt> <dd>The status character sent in the TCS guide packet.</dd>
+ * <dt>Pad</dt> <dd>Padding, zeroed.</dd>
+ * </dl>
+ * @see #AUTOGUIDER_GUIDE_RECORDER_MAGIC
+ * @see #AUTOGUIDER_GUIDE_RECORDER_VERSION
+ */
+struct Autoguider_Guide_Recorder_Frame_Struct
+{
+	int Magic;
+	int Version;
+	int Record_Length;
+	int Guide_Id;
+	int Frame_Number;
+	int Start_Time_Sec;
+	int Start_Time_NSec;
+	int Exposure_Length;
+	int Bin_X;
+	int Bin_Y;
+	int Window_X_Start;
+	int Window_Y_Start;
+	int Window_X_End;
+	int Window_Y_End;
+	int NCols;
+	int NRows;
+	float CCD_Temperature;
+	float Loop_Cadence;
+	float Centroid_X;
+	float Centroid_Y;
+	float FWHM_X;
+	float FWHM_Y;
+	float Peak_Counts;
+	float Total_Counts;
+	char Status_Char;
+	char Pad[3];
+};
+
+extern int Autoguider_Guide_Recorder_Initialise(void);
+extern int Autoguider_Guide_Recorder_Is_Enabled(void);
+extern int Autoguider_Guide_Recorder_Frame_Add(struct Autoguider_Guide_Recorder_Frame_Struct frame,float *buffer_ptr);
+extern int Autoguider_Guide_Recorder_Stats_Get(int *written_count,int *dropped_count);
+extern int Autoguider_Guide_Recorder_Shutdown(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
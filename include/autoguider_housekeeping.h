@@ -0,0 +1,16 @@
+/* autoguider_housekeeping.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_HOUSEKEEPING_H
+#define AUTOGUIDER_HOUSEKEEPING_H
+/* for enum CCD_TEMPERATURE_STATUS */
+#include "ccd_temperature.h"
+
+extern int Autoguider_Housekeeping_Initialise(void);
+extern int Autoguider_Housekeeping_Temperature_Get(double *temperature,
+						   enum CCD_TEMPERATURE_STATUS *temperature_status,int *age_ms);
+extern int Autoguider_Housekeeping_Shutdown(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
@@ -49,6 +49,8 @@ extern int Autoguider_Object_Initialise(void);
 /* extern int Autoguider_Object_Set_Dimension(int ncols,int nrows,int x_bin,int y_bin);*/
 extern int Autoguider_Object_Detect(float *buffer,int naxis1,int naxis2,int start_x,int start_y,
 				    int use_standard_deviation,int id,int frame_number);
+extern int Autoguider_Object_Detect_Tiled(float *buffer,int naxis1,int naxis2,int start_x,int start_y,
+					  int use_standard_deviation,int id,int frame_number,int tile_count);
 extern int Autoguider_Object_Shutdown(void);
 extern int Autoguider_Object_List_Get_Count(int *count);
 extern int Autoguider_Object_List_Get_Object(int index,struct Autoguider_Object_Struct *object);
@@ -56,7 +58,7 @@ extern int Autoguider_Object_List_Get_Nearest_Object(float ccd_x_position,float
 					      struct Autoguider_Object_Struct *object);
 extern int Autoguider_Object_Guide_Object_Get(enum COMMAND_AG_ON_TYPE on_type,float pixel_x,float pixel_y,
 					      int rank,int *selected_object_index);
-extern int Autoguider_Object_List_Get_Object_List_String(char **object_list_string);
+extern int Autoguider_Object_List_Get_Object_List_String(struct Autoguider_General_Reply_Struct *reply);
 /* get some of the image stats used when finding objects */
 extern float Autoguider_Object_Median_Get(void);
 extern float Autoguider_Object_Mean_Get(void);
@@ -0,0 +1,46 @@
+/* autoguider_preview.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_PREVIEW_H
+#define AUTOGUIDER_PREVIEW_H
+
+/* hash defines */
+/**
+ * Which buffer to get the preview image for.
+ */
+#define AUTOGUIDER_PREVIEW_BUFFER_TYPE_FIELD      (0)
+/**
+ * Which buffer to get the preview image for.
+ */
+#define AUTOGUIDER_PREVIEW_BUFFER_TYPE_GUIDE      (1)
+
+/**
+ * How to scale the binned image into 8 bits: the IRAF zscale algorithm.
+ */
+#define AUTOGUIDER_PREVIEW_SCALE_ZSCALE           (0)
+/**
+ * How to scale the binned image into 8 bits: between the 0.5 and 99.5 percentiles.
+ */
+#define AUTOGUIDER_PREVIEW_SCALE_PERCENTILE       (1)
+
+/**
+ * The preview image format: an 8 bit greyscale PNG.
+ */
+#define AUTOGUIDER_PREVIEW_FORMAT_PNG             (0)
+/**
+ * The preview image format: an 8 bit binary PGM (P5).
+ */
+#define AUTOGUIDER_PREVIEW_FORMAT_PGM             (1)
+
+/**
+ * The maximum preview binning factor.
+ */
+#define AUTOGUIDER_PREVIEW_BIN_MAX                (32)
+
+extern int Autoguider_Preview_Get(int buffer_type,int bin,int scale_type,int format,int overlay,
+				  void **buffer_ptr,size_t *buffer_length);
+
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
@@ -0,0 +1,25 @@
+/* autoguider_realtime.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_REALTIME_H
+#define AUTOGUIDER_REALTIME_H
+#include <pthread.h>
+#include <stdlib.h> /* size_t */
+
+/* hash defines */
+/**
+ * The alignment in bytes of buffers allocated with Autoguider_Realtime_Buffer_Allocate. This is the
+ * cache line length, so rows of pixel data do not share cache lines with unrelated data.
+ */
+#define AUTOGUIDER_REALTIME_CACHE_LINE_LENGTH     (64)
+
+extern int Autoguider_Realtime_Initialise(void);
+extern int Autoguider_Realtime_Is_Enabled(void);
+extern int Autoguider_Realtime_Guide_Thread_Attr_Set(pthread_attr_t *attr);
+extern int Autoguider_Realtime_Thread_Prefault(void);
+extern int Autoguider_Realtime_Buffer_Allocate(void **buffer_ptr,size_t length);
+extern int Autoguider_Realtime_Shutdown(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
@@ -0,0 +1,116 @@
+/* autoguider_telemetry.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_TELEMETRY_H
+#define AUTOGUIDER_TELEMETRY_H
+
+/* hash defines */
+/**
+ * The magic number at the start of a telemetry file ("AGTL").
+ */
+#define AUTOGUIDER_TELEMETRY_MAGIC                (0x4c544741)
+/**
+ * The version number of the telemetry file format.
+ */
+#define AUTOGUIDER_TELEMETRY_VERSION              (1)
+/**
+ * Telemetry record type for a guide frame record.
+ */
+#define AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME   (1)
+/**
+ * Telemetry record type for a detected object record.
+ */
+#define AUTOGUIDER_TELEMETRY_RECORD_OBJECT        (2)
+
+/* structures */
+/**
+ * Structure at the start of every telemetry file. It is followed by zero or more
+ * Autoguider_Telemetry_Record_Struct records, so the file can be mmap'ed and indexed directly.
+ * All fields are in native byte order.
+ * <dl>
+ * <dt>Magic</dt> <dd>AUTOGUIDER_TELEMETRY_MAGIC.</dd>
+ * <dt>Version</dt> <dd>AUTOGUIDER_TELEMETRY_VERSION.</dd>
+ * <dt>Header_Length</dt> <dd>The length of this structure in bytes.</dd>
+ * <dt>Record_Length</dt> <dd>The length of each following record in bytes.</dd>
+ * </dl>
+ * @see #AUTOGUIDER_TELEMETRY_MAGIC
+ * @see #AUTOGUIDER_TELEMETRY_VERSION
+ */
+struct Autoguider_Telemetry_File_Header_Struct
+{
+	int Magic;
+	int Version;
+	int Header_Length;
+	int Record_Length;
+};
+
+/**
+ * Structure holding one fixed size telemetry record. The same structure is used for guide frame and
+ * object records, fields not relevant to the record type are zero.
+ * <dl>
+ * <dt>Type</dt> <dd>AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME or AUTOGUIDER_TELEMETRY_RECORD_OBJECT.</dd>
+ * <dt>Id</dt> <dd>The guide session (or field) identifier.</dd>
+ * <dt>Frame_Number</dt> <dd>The frame number within the guide session.</dd>
+ * <dt>Time_Sec</dt> <dd>Seconds since the epoch. For guide frames this is the exposure start time,
+ *     for objects the time the object list was created.</dd>
+ * <dt>Time_NSec</dt> <dd>Nanoseconds part of the time.</dd>
+ * <dt>Index</dt> <dd>Object records: the index of the object in the detected object list.</dd>
+ * <dt>Object_Count</dt> <dd>Guide frame records: the number of objects detected in the guide window.</dd>
+ * <dt>Exposure_Length</dt> <dd>Guide frame records: the exposure length in milliseconds.</dd>
+ * <dt>Pixel_Count</dt> <dd>The number of pixels the (guide) object covers.</dd>
+ * <dt>Is_Stellar</dt> <dd>Whether the (guide) object is stellar.</dd>
+ * <dt>CCD_X_Position</dt> <dd>Guide frames: the guide centroid sent to the TCS. Objects: the object centroid.</dd>
+ * <dt>CCD_Y_Position</dt> <dd>Guide frames: the guide centroid sent to the TCS. Objects: the object centroid.</dd>
+ * <dt>Buffer_X_Position</dt> <dd>The (guide) object centroid in the (sub)window buffer.</dd>
+ * <dt>Buffer_Y_Position</dt> <dd>The (guide) object centroid in the (sub)window buffer.</dd>
+ * <dt>Total_Counts</dt> <dd>The integrated counts of the (guide) object.</dd>
+ * <dt>Peak_Counts</dt> <dd>The peak counts of the (guide) object.</dd>
+ * <dt>FWHM_X</dt> <dd>The FWHM of the (guide) object in X, in pixels.</dd>
+ * <dt>FWHM_Y</dt> <dd>The FWHM of the (guide) object in Y, in pixels.</dd>
+ * <dt>Loop_Cadence</dt> <dd>Guide frame records: the time taken for the last guide loop, in seconds.</dd>
+ * <dt>Status_Char</dt> <dd>Guide frame records: the status character sent in the TCS guide packet.</dd>
+ * <dt>Pad</dt> <dd>Padding, zeroed.</dd>
+ * </dl>
+ * @see #AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME
+ * @see #AUTOGUIDER_TELEMETRY_RECORD_OBJECT
+ */
+struct Autoguider_Telemetry_Record_Struct
+{
+	int Type;
+	int Id;
+	int Frame_Number;
+	int Time_Sec;
+	int Time_NSec;
+	int Index;
+	int Object_Count;
+	int Exposure_Length;
+	int Pixel_Count;
+	int Is_Stellar;
+	float CCD_X_Position;
+	float CCD_Y_Position;
+	float Buffer_X_Position;
+	float Buffer_Y_Position;
+	float Total_Counts;
+	float Peak_Counts;
+	float FWHM_X;
+	float FWHM_Y;
+	float Loop_Cadence;
+	char Status_Char;
+	char Pad[3];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern int Autoguider_Telemetry_Initialise(void);
+extern int Autoguider_Telemetry_Is_Enabled(void);
+extern int Autoguider_Telemetry_Record_Add(struct Autoguider_Telemetry_Record_Struct *record);
+extern int Autoguider_Telemetry_Stats_Get(int *written_count,int *dropped_count);
+extern int Autoguider_Telemetry_Shutdown(void);
+#ifdef __cplusplus
+}
+#endif
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
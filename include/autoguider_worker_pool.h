@@ -0,0 +1,24 @@
+/* autoguider_worker_pool.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_WORKER_POOL_H
+#define AUTOGUIDER_WORKER_POOL_H
+/* for size_t */
+#include <stdlib.h>
+
+/**
+ * Type of a worker pool job routine. The routine is passed a pointer to its job's argument, and must
+ * report any error through that argument rather than Autoguider_General_Error_Number, which other jobs
+ * running at the same time may be setting.
+ */
+typedef void (*Autoguider_Worker_Pool_Job_Routine)(void *job_arg);
+
+extern int Autoguider_Worker_Pool_Initialise(int thread_count);
+extern int Autoguider_Worker_Pool_Run(Autoguider_Worker_Pool_Job_Routine job_routine,void *job_arg_list,
+				      size_t job_arg_size,int job_count);
+extern int Autoguider_Worker_Pool_Thread_Count_Get(void);
+extern int Autoguider_Worker_Pool_Shutdown(void);
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif
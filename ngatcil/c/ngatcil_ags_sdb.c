@@ -636,8 +636,6 @@ static char Remote_Hostname[HOSTNAME_LENGTH] = NGATCIL_AGS_SDB_MCC_DEFAULT;
 static int Sequence_Number = 0;
 
 /* internal function declarations */
-static int AGS_SDB_Packet_Send_To(int socket_id,char *hostname,int port_number,
-			       struct NGATCil_AGS_SDB_Packet_Struct packet,int packet_length);
 static int AGS_SDB_Packet_To_Network_Byte_Order(struct NGATCil_AGS_SDB_Packet_Struct *sdb_packet,int packet_length);
 
 /* ----------------------------------------------------------------------------
@@ -722,40 +720,90 @@ int NGATCil_AGS_SDB_Remote_Host_Set(char *hostname,int port_number)
 	return TRUE;
 }
 /**
- * Send an SDB packet containing latest status.
+ * Send an SDB packet containing latest status. The packet is formatted using NGATCil_AGS_SDB_Status_Format,
+ * and sent using NGATCil_AGS_SDB_Status_Buffer_Send. Nothing is sent if no datums have changed.
  * @param socket_id The file descriptor of an open socket to send the packet on.
- * @param hostname A string representing the remote host to send the status to (mcc).
- * @param port_number The remote port number to send the packet to (NGATCIL_AGS_SDB_CIL_PORT_DEFAULT).
+ * @return The routine returns TRUE on success and FALSE on failure. If the routine failed,
+ *      NGATCil_General_Error_Number and NGATCil_General_Error_String should be set.
+ * @see #NGATCil_AGS_SDB_Status_Format
+ * @see #NGATCil_AGS_SDB_Status_Buffer_Send
+ * @see #NGATCIL_AGS_SDB_PACKET_LENGTH_MAX
+ * @see ngatcil_general.html#NGATCil_General_Log
+ */
+int NGATCil_AGS_SDB_Status_Send(int socket_id)
+{
+	char packet_buff[NGATCIL_AGS_SDB_PACKET_LENGTH_MAX];
+	int packet_length;
+
+#if NGATCIL_DEBUG > 1
+	NGATCil_General_Log("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Send",
+			    LOG_VERBOSITY_VERBOSE,NULL,"started.");
+#endif
+	if(!NGATCil_AGS_SDB_Status_Format(packet_buff,NGATCIL_AGS_SDB_PACKET_LENGTH_MAX,&packet_length))
+		return FALSE;
+	if(packet_length > 0)
+	{
+		if(!NGATCil_AGS_SDB_Status_Buffer_Send(socket_id,packet_buff,packet_length))
+			return FALSE;
+	}
+#if NGATCIL_DEBUG > 1
+	NGATCil_General_Log("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Send",
+			    LOG_VERBOSITY_VERBOSE,NULL,"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Format an SDB packet containing the datums that have changed since the last call, in network byte order,
+ * into a buffer. The changed flags of the datums are cleared, as the packet now holds them.
+ * This is the only part of sending an SDB packet that reads the datum table, so a caller that shares the 
+ * table between threads only needs to hold its lock whilst calling this routine, and can then send the buffer
+ * with NGATCil_AGS_SDB_Status_Buffer_Send without the lock.
+ * @param packet_buff A buffer to hold the formatted packet, at least NGATCIL_AGS_SDB_PACKET_LENGTH_MAX bytes long.
+ * @param packet_buff_length The length of packet_buff in bytes.
+ * @param packet_length The address of an integer, on return set to the length of the formatted packet in bytes.
+ *        This is set to zero if no datums have changed, in which case there is nothing to send.
  * @return The routine returns TRUE on success and FALSE on failure. If the routine failed,
  *      NGATCil_General_Error_Number and NGATCil_General_Error_String should be set.
  * @see #AGS_SDB_Packet_To_Network_Byte_Order
- * @see #AGS_SDB_Packet_Send_To
- * @see #Remote_Hostname
- * @see #Remote_Port_Number
- * @see #NGATCIL_AGS_SDB_CIL_PORT_DEFAULT
+ * @see #NGATCIL_AGS_SDB_PACKET_LENGTH_MAX
  * @see #TTL_TIMESTAMP_OFFSET
  * @see #iAgsOidTable
+ * @see #Sequence_Number
  * @see ngatcil_general.html#NGATCil_General_Error_Number
  * @see ngatcil_general.html#NGATCil_General_Error_String
  * @see ngatcil_general.html#NGATCil_General_Log
  */
-int NGATCil_AGS_SDB_Status_Send(int socket_id)
+int NGATCil_AGS_SDB_Status_Format(char *packet_buff,int packet_buff_length,int *packet_length)
 {
 	struct NGATCil_AGS_SDB_Packet_Struct sdb_packet;
 	struct timespec current_time;
-	int retval,oid_index,sdb_index,data_length,packet_length;
+	int oid_index,sdb_index,data_length;
 
 #if NGATCIL_DEBUG > 1
-	NGATCil_General_Log("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Send",
+	NGATCil_General_Log("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Format",
 			    LOG_VERBOSITY_VERBOSE,NULL,"started.");
 #endif
+	if(packet_buff == NULL)
+	{
+		NGATCil_General_Error_Number = 403;
+		sprintf(NGATCil_General_Error_String,"NGATCil_AGS_SDB_Status_Format: packet_buff was NULL.");
+		return FALSE;
+	}
+	if(packet_length == NULL)
+	{
+		NGATCil_General_Error_Number = 404;
+		sprintf(NGATCil_General_Error_String,"NGATCil_AGS_SDB_Status_Format: packet_length was NULL.");
+		return FALSE;
+	}
+	(*packet_length) = 0;
 	sdb_index = 0;
 	for ( oid_index = I_AGS_FIRST_DATUMID; oid_index <= I_AGS_FINAL_DATUMID; oid_index++ )
 	{
 		if(iAgsOidTable[oid_index].Changed == TRUE)
 		{
 #if NGATCIL_DEBUG > 5
-			NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Send",
+			NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Format",
 						   LOG_VERBOSITY_VERBOSE,NULL,
 						   "Found changed OID %d at index %d.",
 						   iAgsOidTable[oid_index].Oid,oid_index);
@@ -780,29 +828,36 @@ int NGATCil_AGS_SDB_Status_Send(int socket_id)
 		sdb_packet.Cil_Base.Timestamp_Nanoseconds = current_time.tv_nsec;
 		sdb_packet.Datums.NumElts = (Uint32_t)sdb_index;
 #if NGATCIL_DEBUG > 5
-		NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Send",
+		NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Format",
 					   LOG_VERBOSITY_VERBOSE,NULL,"Found %d changed OIDs.",sdb_index);
 #endif
 		/* length of Datum data to submit */
 		data_length = sizeof(Int32_t) + (sdb_index * sizeof(eSdbDatum_t));
-#if NGATCIL_DEBUG > 5
-		NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Send",
-					   LOG_VERBOSITY_VERBOSE,NULL,"Data length %d.",data_length);
-#endif
 		/* packet has 7 int header (CilPrivate.h:I_CIL_HDRBLK_SIZE  28) */
-		packet_length = data_length + (7 * sizeof(Uint32_t)); 
+		(*packet_length) = data_length + (7 * sizeof(Uint32_t)); 
 #if NGATCIL_DEBUG > 5
-		NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Send",
-					   LOG_VERBOSITY_VERBOSE,NULL,"Packet length %d.",packet_length);
+		NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Format",
+					   LOG_VERBOSITY_VERBOSE,NULL,"Data length %d, packet length %d.",
+					   data_length,(*packet_length));
 #endif
-		/* change to network byte order */
-		if(!AGS_SDB_Packet_To_Network_Byte_Order(&sdb_packet,packet_length))
+		if((*packet_length) > packet_buff_length)
+		{
+			NGATCil_General_Error_Number = 405;
+			sprintf(NGATCil_General_Error_String,"NGATCil_AGS_SDB_Status_Format: "
+				"Packet length %d too long for buffer of length %d.",(*packet_length),
+				packet_buff_length);
+			(*packet_length) = 0;
 			return FALSE;
-		/* submit to sdb */
-		if(!AGS_SDB_Packet_Send_To(socket_id,Remote_Hostname,Remote_Port_Number,sdb_packet,packet_length))
+		}
+		/* change to network byte order */
+		if(!AGS_SDB_Packet_To_Network_Byte_Order(&sdb_packet,(*packet_length)))
+		{
+			(*packet_length) = 0;
 			return FALSE;
+		}
+		memcpy(packet_buff,&sdb_packet,(*packet_length));
 	}
-	/* clear changed values if SDB has been updated */
+	/* clear changed values, they are now in the packet */
 	for ( oid_index = I_AGS_FIRST_DATUMID; oid_index <= I_AGS_FINAL_DATUMID; oid_index++ )
 	{
 		if(iAgsOidTable[oid_index].Changed == TRUE)
@@ -811,12 +866,45 @@ int NGATCil_AGS_SDB_Status_Send(int socket_id)
 		}
 	}
 #if NGATCIL_DEBUG > 1
-	NGATCil_General_Log("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Send",
+	NGATCil_General_Log("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Format",
 			    LOG_VERBOSITY_VERBOSE,NULL,"finished.");
 #endif
 	return TRUE;
 }
 
+/**
+ * Send an SDB packet previously formatted by NGATCil_AGS_SDB_Status_Format to the remote host 
+ * (Remote_Hostname and Remote_Port_Number). The datum table is not accessed.
+ * @param socket_id The file descriptor of an open socket to send the packet on.
+ * @param packet_buff The formatted packet, in network byte order.
+ * @param packet_length The length of the formatted packet in bytes.
+ * @return The routine returns TRUE on success and FALSE on failure. If the routine failed,
+ *      NGATCil_General_Error_Number and NGATCil_General_Error_String should be set.
+ * @see #NGATCil_AGS_SDB_Status_Format
+ * @see #Remote_Hostname
+ * @see #Remote_Port_Number
+ * @see ngatcil_udp_raw.html#NGATCil_UDP_Raw_Send_To
+ * @see ngatcil_general.html#NGATCil_General_Log
+ */
+int NGATCil_AGS_SDB_Status_Buffer_Send(int socket_id,char *packet_buff,int packet_length)
+{
+	int retval;
+
+#if NGATCIL_DEBUG > 1
+	NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Buffer_Send",
+				   LOG_VERBOSITY_VERBOSE,NULL,
+				   "started (socket_id=%d,hostname=%s,port_number=%d,Packet_length=%d).",
+				   socket_id,Remote_Hostname,Remote_Port_Number,packet_length);
+#endif
+	retval = NGATCil_UDP_Raw_Send_To(socket_id,Remote_Hostname,Remote_Port_Number,(void*)packet_buff,
+					 packet_length);
+#if NGATCIL_DEBUG > 1
+	NGATCil_General_Log("ngatcil","ngatcil_ags_sdb.c","NGATCil_AGS_SDB_Status_Buffer_Send",
+			    LOG_VERBOSITY_VERBOSE,NULL,"finished.");
+#endif
+	return retval;
+}
+
 /**
  * Set a datum value.
  * @param datum_id The datum to set, of type eAgsDataId_t.
@@ -917,37 +1005,6 @@ static int AGS_SDB_Packet_To_Network_Byte_Order(struct NGATCil_AGS_SDB_Packet_St
 	return TRUE;
 }
 
-/**
- * Send an AGS SDB CIL packet. 
- * @param socket_id The socket file descriptor to use.
- * @param hostname The hostname of the host to send the packet to.
- * @param port_number The port number of the host to send the packet to.
- * @param packet The packet to send. The contents should have been put into network byte order
- *        (NGATCil_AGS_SDB_Status_Send does this automatically).
- * @param packet_length How much of the packet to send.
- * @return The routine returns TRUE on success and FALSE on failure. If the routine failed,
- *      NGATCil_General_Error_Number and NGATCil_General_Error_String should be set.
- * @see ngatcil_udp_raw.html#NGATCil_UDP_Raw_Send_To
- */
-static int AGS_SDB_Packet_Send_To(int socket_id,char *hostname,int port_number,
-			       struct NGATCil_AGS_SDB_Packet_Struct packet,int packet_length)
-{
-	int retval;
-
-#if NGATCIL_DEBUG > 1
-	NGATCil_General_Log_Format("ngatcil","ngatcil_ags_sdb.c","AGS_SDB_Packet_Send_To",
-				   LOG_VERBOSITY_VERBOSE,NULL,
-				   "started (socket_id=%d,hostname=%s,port_number=%d,Packet_length=%d).",
-				   socket_id,hostname,port_number,packet_length);
-#endif
-	retval = NGATCil_UDP_Raw_Send_To(socket_id,hostname,port_number,(void*)&packet,packet_length);
-#if NGATCIL_DEBUG > 1
-	NGATCil_General_Log("ngatcil","ngatcil_ags_sdb.c","AGS_SDB_Packet_Send_To",
-			    LOG_VERBOSITY_VERBOSE,NULL,"finished.");
-#endif
-	return retval;
-}
-
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.2  2006/08/29 14:07:57  cjm
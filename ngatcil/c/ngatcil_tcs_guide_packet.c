@@ -34,6 +34,9 @@
  */
 static char rcsid[] = "$Id: ngatcil_tcs_guide_packet.c,v 1.6 2011-09-08 09:21:11 cjm Exp $";
 
+/* internal functions */
+static void TCS_Guide_Packet_Fixed_Point_Format(char *buff,float value,char sign_char);
+
 /* ----------------------------------------------------------------------------
 ** 		external functions 
 ** ---------------------------------------------------------------------------- */
@@ -70,7 +73,7 @@ int NGATCil_TCS_Guide_Packet_Open_Default(int *socket_id)
 /**
  * Send a TCS guide packet over the specified socket as a UDP packet.
  * The packet contents are derived from "Generic 2.0m Telescope, Autoguider to TCS Interface Control Document,
- * Version 0.01, 6th October 2005".
+ * Version 0.01, 6th October 2005". The packet is formatted using NGATCil_TCS_Guide_Packet_Format.
  * @param socket_id The socket descriptor to send the packet over.
  * @param x_pos The X position of the AG centroid, in pixels from the <b>edge of the CCD</b>, 
  *        <b>NOT</b> the guide window.
@@ -97,7 +100,8 @@ int NGATCil_TCS_Guide_Packet_Open_Default(int *socket_id)
  *      NGATCil_General_Error_Number and NGATCil_General_Error_String should be set.
  * @see #NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED
  * @see #NGATCIL_TCS_GUIDE_PACKET_STATUS_WINDOW
- * @see #NGATCil_TCS_Guide_Packet_To_String
+ * @see #NGATCIL_TCS_GUIDE_PACKET_LENGTH
+ * @see #NGATCil_TCS_Guide_Packet_Format
  * @see ngatcil_udp_raw.html#NGATCil_UDP_Raw_Send
  * @see ngatcil_general.html#NGATCil_General_Error_Number
  * @see ngatcil_general.html#NGATCil_General_Error_String
@@ -107,23 +111,89 @@ int NGATCil_TCS_Guide_Packet_Send(int socket_id,float x_pos,float y_pos,
 				  int timecode_terminating,int timecode_unreliable,
 				  float timecode_secs,char status_char)
 {
-	char packet_buff[35];
-	char x_pos_buff[9];
-	char y_pos_buff[9];
-	char timecode_buff[9];
-	char checksum_buff[5];
-	int retval,i,checksum;
+	char packet_buff[NGATCIL_TCS_GUIDE_PACKET_LENGTH+1];
+	int retval;
 
 #if NGATCIL_DEBUG > 1
 	NGATCil_General_Log("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
 			    LOG_VERBOSITY_VERBOSE,NULL,"started.");
 #endif
+	retval = NGATCil_TCS_Guide_Packet_Format(packet_buff,NGATCIL_TCS_GUIDE_PACKET_LENGTH+1,x_pos,y_pos,
+						 timecode_terminating,timecode_unreliable,timecode_secs,status_char);
+	if(retval == FALSE)
+		return FALSE;
+#if NGATCIL_DEBUG > 5
+	NGATCil_General_Log_Format("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
+				   LOG_VERBOSITY_VERBOSE,NULL,
+				   "packet_buff (with checksum) = '%s' (length %d).",
+				   NGATCil_TCS_Guide_Packet_To_String(packet_buff,strlen(packet_buff)),
+				   strlen(packet_buff));
+#endif
+	/* send packet  -  this is 29 bytes, plus 4 (+1 (cr)) bytes checksum (no \0) = 34 bytes. */
+	retval = NGATCil_UDP_Raw_Send(socket_id,packet_buff,NGATCIL_TCS_GUIDE_PACKET_LENGTH);
+	if(retval == FALSE)
+		return FALSE;
+#if NGATCIL_DEBUG > 1
+	NGATCil_General_Log("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
+			    LOG_VERBOSITY_VERBOSE,NULL,"finished.");
+#endif
+	return TRUE;
+}
+
+/**
+ * Format a TCS guide packet into a buffer, ready to be sent over UDP.
+ * The packet contents are derived from "Generic 2.0m Telescope, Autoguider to TCS Interface Control Document,
+ * Version 0.01, 6th October 2005". The packet is 34 bytes long: 
+ * <pre>
+ * sXXXX.XX sYYYY.YY sTTTT.TT S CCCC\r
+ * </pre>
+ * where s is '0' or '-', S is the status char, and CCCC is the sum of the preceeding 29 bytes.
+ * The numbers are formatted using TCS_Guide_Packet_Fixed_Point_Format rather than sprintf("%07.2f"), 
+ * so this routine does no floating point formatting and no memory allocation, and is cheap enough to call
+ * from a time critical thread.
+ * @param packet_buff A buffer to format the packet into. On return this is NULL terminated.
+ * @param packet_buff_length The length of packet_buff, this must be at least NGATCIL_TCS_GUIDE_PACKET_LENGTH+1.
+ * @param x_pos The X position of the AG centroid, in pixels from the <b>edge of the CCD</b>.
+ * @param y_pos The Y position of the AG centroid, in pixels from the <b>edge of the CCD</b>.
+ * @param timecode_terminating Boolean. If TRUE the timecode will contain the terminating timecode.
+ * @param timecode_unreliable Boolean. If TRUE the timecode will be negative.
+ * @param timecode_secs The number of seconds the TCS should wait for until the next guide packet will be sent.
+ * @param status_char The status byte.
+ * @return The routine returns TRUE on success and FALSE on failure. If the routine failed,
+ *      NGATCil_General_Error_Number and NGATCil_General_Error_String should be set.
+ * @see #NGATCil_TCS_Guide_Packet_Send
+ * @see #TCS_Guide_Packet_Fixed_Point_Format
+ * @see #NGATCIL_TCS_GUIDE_PACKET_LENGTH
+ * @see #NGATCIL_TCS_GUIDE_PACKET_STATUS_FAILED
+ * @see #NGATCIL_TCS_GUIDE_PACKET_STATUS_WINDOW
+ * @see ngatcil_general.html#NGATCil_General_Error_Number
+ * @see ngatcil_general.html#NGATCil_General_Error_String
+ */
+int NGATCil_TCS_Guide_Packet_Format(char *packet_buff,int packet_buff_length,float x_pos,float y_pos,
+				    int timecode_terminating,int timecode_unreliable,
+				    float timecode_secs,char status_char)
+{
+	int i,checksum;
+
 	/* check parameters */
+	if(packet_buff == NULL)
+	{
+		NGATCil_General_Error_Number = 223;
+		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Format:packet_buff was NULL.");
+		return FALSE;
+	}
+	if(packet_buff_length < (NGATCIL_TCS_GUIDE_PACKET_LENGTH+1))
+	{
+		NGATCil_General_Error_Number = 224;
+		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Format:"
+			"packet_buff_length was too small(%d).",packet_buff_length);
+		return FALSE;
+	}
 	if(!NGATCIL_GENERAL_IS_BOOLEAN(timecode_terminating))
 	{
 		NGATCil_General_Error_Number = 200;
 		sprintf(NGATCil_General_Error_String,
-			"NGATCil_TCS_Guide_Packet_Send:Illegal value for timecode terminating (%d).",
+			"NGATCil_TCS_Guide_Packet_Format:Illegal value for timecode terminating (%d).",
 			timecode_terminating);
 		return FALSE;
 	}
@@ -131,26 +201,28 @@ int NGATCil_TCS_Guide_Packet_Send(int socket_id,float x_pos,float y_pos,
 	{
 		NGATCil_General_Error_Number = 201;
 		sprintf(NGATCil_General_Error_String,
-			"NGATCil_TCS_Guide_Packet_Send:Illegal value for timecode unreliable (%d).",
+			"NGATCil_TCS_Guide_Packet_Format:Illegal value for timecode unreliable (%d).",
 			timecode_unreliable);
 		return FALSE;
 	}
 	if((x_pos < -9999.99f) || (x_pos > 9999.99f))
 	{
 		NGATCil_General_Error_Number = 202;
-		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Send:x_pos out of range (%.2f).",x_pos);
+		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Format:x_pos out of range (%.2f).",
+			x_pos);
 		return FALSE;
 	}
 	if((y_pos < -9999.99f) || (y_pos > 9999.99f))
 	{
 		NGATCil_General_Error_Number = 203;
-		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Send:y_pos out of range (%.2f).",y_pos);
+		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Format:y_pos out of range (%.2f).",
+			y_pos);
 		return FALSE;
 	}
 	if((timecode_secs < 0.01f) || (timecode_secs > 9999.99f))
 	{
 		NGATCil_General_Error_Number = 204;
-		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Send:"
+		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Format:"
 			"timecode_secs out of range (%.2f).",timecode_secs);
 		return FALSE;
 	}
@@ -158,95 +230,40 @@ int NGATCil_TCS_Guide_Packet_Send(int socket_id,float x_pos,float y_pos,
 	   (status_char != NGATCIL_TCS_GUIDE_PACKET_STATUS_WINDOW))
 	{
 		NGATCil_General_Error_Number = 205;
-		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Send:"
+		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Format:"
 			"Illegal status char %c.",status_char);
 		return FALSE;
 	}
-	/* setup buffers */
-	strcpy(packet_buff,"");
-	/* x pos */
-	sprintf(x_pos_buff+1,"%07.2f",fabs(x_pos));
-	if(x_pos >= 0.0f)
-		x_pos_buff[0] = '0';
-	else
-		x_pos_buff[0] = '-';
-#if NGATCIL_DEBUG > 5
-	NGATCil_General_Log_Format("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
-				   LOG_VERBOSITY_VERBOSE,NULL,"x_pos_buff = %s.",x_pos_buff);
-#endif
-	/* y pos */
-	sprintf(y_pos_buff+1,"%07.2f",fabs(y_pos));
-	if(y_pos >= 0.0f)
-		y_pos_buff[0] = '0';
-	else
-		y_pos_buff[0] = '-';
-#if NGATCIL_DEBUG > 5
-	NGATCil_General_Log_Format("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
-				   LOG_VERBOSITY_VERBOSE,NULL,"y_pos_buff = %s.",y_pos_buff);
-#endif
-	/* timecode */
+	/* x pos (bytes 0..7) */
+	TCS_Guide_Packet_Fixed_Point_Format(packet_buff,x_pos,(x_pos >= 0.0f) ? '0' : '-');
+	packet_buff[8] = ' ';
+	/* y pos (bytes 9..16) */
+	TCS_Guide_Packet_Fixed_Point_Format(packet_buff+9,y_pos,(y_pos >= 0.0f) ? '0' : '-');
+	packet_buff[17] = ' ';
+	/* timecode (bytes 18..25) */
 	if(timecode_terminating)
-	{
-		strcpy(timecode_buff,"00000.00");
-	}
+		TCS_Guide_Packet_Fixed_Point_Format(packet_buff+18,0.0f,'0');
 	else
-	{
-			sprintf(timecode_buff+1,"%07.2f",timecode_secs);
-			if(timecode_unreliable)
-				timecode_buff[0] = '-';
-			else
-				timecode_buff[0] = '0';
-	}
-#if NGATCIL_DEBUG > 5
-	NGATCil_General_Log_Format("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
-				   LOG_VERBOSITY_VERBOSE,NULL,"timecode_buff = %s.",timecode_buff);
-#endif
-	/* packet (up to checksum) */
-	retval = sprintf(packet_buff,"%s %s %s %c ",x_pos_buff,y_pos_buff,timecode_buff,status_char);
-	if(retval != 29)
-	{
-		NGATCil_General_Error_Number = 206;
-		sprintf(NGATCil_General_Error_String,"NGATCil_TCS_Guide_Packet_Send:"
-			"Malformed packet_buff (%s,%d).",packet_buff,retval);
-		return FALSE;
-	}
-#if NGATCIL_DEBUG > 5
-	NGATCil_General_Log_Format("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
-				   LOG_VERBOSITY_VERBOSE,NULL,
-				   "packet_buff (without checksum) = '%s'.",packet_buff);
-#endif
+		TCS_Guide_Packet_Fixed_Point_Format(packet_buff+18,timecode_secs,timecode_unreliable ? '-' : '0');
+	packet_buff[26] = ' ';
+	packet_buff[27] = status_char;
+	packet_buff[28] = ' ';
 	/* compute checksum */
 	checksum = 0;
 	for(i=0;i<29;i++) /* 29 (0..28) bytes up to checksum (8+1+8+1+8+1+1+1) */
 	{
 		checksum += (int)(packet_buff[i]);
 	}
-#if NGATCIL_DEBUG > 5
-	NGATCil_General_Log_Format("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
-				   LOG_VERBOSITY_VERBOSE,NULL,"checksum = %d.",checksum);
-#endif
-	sprintf(checksum_buff,"%04d",checksum);
-#if NGATCIL_DEBUG > 9
-	NGATCil_General_Log_Format("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
-				   LOG_VERBOSITY_VERBOSE,NULL,"checksum_buff = '%s'.",checksum_buff);
-#endif
-	strcat(packet_buff,checksum_buff);
-	strcat(packet_buff,"\r");
-#if NGATCIL_DEBUG > 5
-	NGATCil_General_Log_Format("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
-				   LOG_VERBOSITY_VERBOSE,NULL,
-				   "packet_buff (with checksum) = '%s' (length %d).",
-				   NGATCil_TCS_Guide_Packet_To_String(packet_buff,strlen(packet_buff)),
-				   strlen(packet_buff));
-#endif
-	/* send packet  -  this is 29 bytes, plus 4 (+1 (cr)) bytes checksum (no \0) = 34 bytes. */
-	retval = NGATCil_UDP_Raw_Send(socket_id,packet_buff,34);
-	if(retval == FALSE)
-		return FALSE;
-#if NGATCIL_DEBUG > 1
-	NGATCil_General_Log("ngatcil","ngatcil_tcs_guide_packet.c","NGATCil_TCS_Guide_Packet_Send",
-			    LOG_VERBOSITY_VERBOSE,NULL,"finished.");
-#endif
+	/* checksum is %04d, 29 printable bytes can never sum to more than 9999 */
+	packet_buff[32] = '0'+(checksum%10);
+	checksum /= 10;
+	packet_buff[31] = '0'+(checksum%10);
+	checksum /= 10;
+	packet_buff[30] = '0'+(checksum%10);
+	checksum /= 10;
+	packet_buff[29] = '0'+(checksum%10);
+	packet_buff[33] = '\r';
+	packet_buff[34] = '\0';
 	return TRUE;
 }
 
@@ -526,6 +543,42 @@ char *NGATCil_TCS_Guide_Packet_To_String(void *packet_buff,int packet_buff_lengt
 /* ----------------------------------------------------------------------------
 ** 		internal functions 
 ** ---------------------------------------------------------------------------- */
+/**
+ * Format the absolute value of a number into 8 characters of a guide packet, as a sign character followed by
+ * the equivalent of sprintf("%07.2f"), i.e. "sNNNN.NN". The value is rounded to the nearest hundredth 
+ * (ties to even, as printf does), and no NULL terminator is written. The value is assumed to have already been range checked
+ * (-9999.99..9999.99).
+ * @param buff The buffer to write the 8 characters into.
+ * @param value The value to format.
+ * @param sign_char The character to put in the first byte, '0' or '-'.
+ */
+static void TCS_Guide_Packet_Fixed_Point_Format(char *buff,float value,char sign_char)
+{
+	double scaled,fraction;
+	long hundredths;
+	int i;
+
+	/* a float multiplied by 100 is exact in a double, so we can round half to even as printf does */
+	scaled = fabs((double)value)*100.0;
+	hundredths = (long)scaled;
+	fraction = scaled-(double)hundredths;
+	if((fraction > 0.5)||((fraction == 0.5)&&(hundredths & 1L)))
+		hundredths++;
+	if(hundredths > 999999L)
+		hundredths = 999999L;
+	buff[0] = sign_char;
+	buff[7] = '0'+(char)(hundredths%10);
+	hundredths /= 10;
+	buff[6] = '0'+(char)(hundredths%10);
+	hundredths /= 10;
+	buff[5] = '.';
+	for(i=4;i>0;i--)
+	{
+		buff[i] = '0'+(char)(hundredths%10);
+		hundredths /= 10;
+	}
+}
+
 /*
 ** $Log: not supported by cvs2svn $
 ** Revision 1.5  2009/01/30 18:00:52  cjm
@@ -13,6 +13,12 @@
  * Default port number to send SDB CIL packets to (13011). 
  */
 #define NGATCIL_AGS_SDB_CIL_PORT_DEFAULT (13011)
+/**
+ * The maximum length of a formatted AGS SDB CIL packet, in bytes: an 8 integer header (7 Cil header integers
+ * plus the datum count) and 6 integers for each AGS datum (D_AGS_DATAID_EOL). Use this to size the buffer
+ * passed to NGATCil_AGS_SDB_Status_Format.
+ */
+#define NGATCIL_AGS_SDB_PACKET_LENGTH_MAX ((8*sizeof(int))+(D_AGS_DATAID_EOL*6*sizeof(int)))
 
 /* enums */
 /**
@@ -186,6 +192,8 @@ typedef enum eAgsDataId_e eAgsDataId_t;
 extern int NGATCil_AGS_SDB_Initialise(void);
 extern int NGATCil_AGS_SDB_Remote_Host_Set(char *hostname,int port_number);
 extern int NGATCil_AGS_SDB_Status_Send(int socket_id);
+extern int NGATCil_AGS_SDB_Status_Format(char *packet_buff,int packet_buff_length,int *packet_length);
+extern int NGATCil_AGS_SDB_Status_Buffer_Send(int socket_id,char *packet_buff,int packet_length);
 extern int NGATCil_AGS_SDB_Value_Set(eAgsDataId_t datum_id,int value);
 
 #endif
@@ -31,6 +31,9 @@ extern int NGATCil_TCS_Guide_Packet_Open_Default(int *socket_id);
 extern int NGATCil_TCS_Guide_Packet_Send(int socket_id,float x_pos,float y_pos,
 					 int timecode_terminating,int timecode_unreliable,
 					 float timecode_secs,char status_char);
+extern int NGATCil_TCS_Guide_Packet_Format(char *packet_buff,int packet_buff_length,float x_pos,float y_pos,
+					   int timecode_terminating,int timecode_unreliable,
+					   float timecode_secs,char status_char);
 extern int NGATCil_TCS_Guide_Packet_Recv(int socket_id,float *x_pos,float *y_pos,
 					 int *timecode_terminating,int *timecode_unreliable,
 					 float *timecode_secs,char *status_char);
@@ -0,0 +1,1099 @@
+/* autoguider_centroid_bench.c
+ * $Id$
+ * Benchmark centroid accuracy against CPU cost, on synthetic guide windows with known star positions.
+ */
+/**
+ * Benchmark centroid accuracy against CPU cost, on synthetic guide windows containing one star at a known
+ * sub-pixel position, and write the results as CSV. The windows cover a grid of exposure regimes:
+ * <ul>
+ * <li>snr - The integrated signal to noise ratio of the star (the star flux is derived from it, given the
+ *     background, read noise and FWHM).
+ * <li>fwhm - The FWHM of the (circular Gaussian) star, in pixels.
+ * <li>background - The sky background, in counts per pixel.
+ * <li>window - The size of the (square) guide window, in pixels.
+ * </ul>
+ * The star's flux is integrated over each pixel (using erf), the background added, and Gaussian noise with the
+ * variance of the photon plus read noise added. The star is placed at a random sub-pixel position within
+ * CENTROID_MAX_OFFSET pixels of the window centre. Pixel (x,y) is centred on position (x,y), so the truth is
+ * in 0-based pixel coordinates.
+ * Every method is run on the same frames in each regime. The methods are:
+ * <ul>
+ * <li>object_detect - The autoguider's current path, Autoguider_Object_Detect (libdprt Object_List_Get), taking
+ *     the object with the most counts. This needs the autoguider config (-config_filename) for the object
+ *     detection thresholds. Any difference between libdprt's pixel coordinate origin and the one used here
+ *     shows up as a constant bias, which is removed before the results are judged (see below).
+ * <li>centre_of_mass - Background subtracted centre of mass in a box of half-width 1.5 FWHM around the
+ *     brightest pixel.
+ * <li>gaussian_3_point - A Gaussian through the brightest pixel and its two neighbours, in X and Y
+ *     separately (background subtracted).
+ * <li>weighted_centre_of_mass - Iteratively Gaussian weighted centre of mass, starting at the brightest pixel.
+ * </ul>
+ * The last three are candidate algorithms implemented here (they are not yet used by the autoguider).
+ * The background they subtract is the median of the window's edge pixels.
+ * Each method's bias in a regime is first estimated as the median error, in X and Y, of every position it
+ * returned. A measurement is a miss if no position is returned, or it is more than one FWHM from the truth
+ * once this bias is removed, so a constant offset (such as a different pixel origin) does not turn every
+ * measurement into a miss. For each method and regime a CSV line gives the fraction of frames found, the mean
+ * error (bias) and RMS error in X and Y, the radial RMS error, the radial RMS error with the bias removed,
+ * and the mean thread CPU time and heap allocations per frame. Allocations are counted by wrapping
+ * malloc/calloc/realloc at link time (autoguider_test_alloc.c), as autoguider_reduction_bench does.
+ * If -budget is specified, a summary is printed for each regime, naming the cheapest method whose radial RMS
+ * error with the bias removed is within the budget (and which finds the star in at least
+ * CENTROID_MIN_FOUND_FRACTION of the frames).
+ * <pre>
+ * autoguider_centroid_bench [-co[nfig_filename] &lt;filename&gt;] [-csv &lt;filename&gt;] [-label &lt;string&gt;]
+ * 	[-m[ethod] &lt;name&gt;] [-frames &lt;n&gt;] [-read_noise &lt;counts&gt;] [-budget &lt;pixels&gt;]
+ * </pre>
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+
+#include "autoguider_general.h"
+#include "autoguider_object.h"
+
+#include "autoguider_test_util.h"
+
+/* hash defines */
+#ifndef M_PI
+/**
+ * Pi, if math.h does not define it (it is not POSIX).
+ */
+#define M_PI                       (3.14159265358979323846)
+#endif
+#ifndef M_SQRT2
+/**
+ * The square root of 2, if math.h does not define it (it is not POSIX).
+ */
+#define M_SQRT2                    (1.41421356237309504880)
+#endif
+/**
+ * The number of signal to noise ratios in the grid.
+ */
+#define SNR_COUNT                  (6)
+/**
+ * The number of FWHMs in the grid.
+ */
+#define FWHM_COUNT                 (4)
+/**
+ * The number of background levels in the grid.
+ */
+#define BACKGROUND_COUNT           (3)
+/**
+ * The number of window sizes in the grid.
+ */
+#define WINDOW_COUNT               (3)
+/**
+ * The largest window size in the grid, used to size the edge pixel list.
+ */
+#define MAX_WINDOW_SIZE            (100)
+/**
+ * The default number of frames generated for each regime.
+ */
+#define DEFAULT_FRAME_COUNT        (50)
+/**
+ * The default read noise of the synthetic frames, in counts.
+ */
+#define DEFAULT_READ_NOISE         (8.0)
+/**
+ * The furthest the star is placed from the window centre, in pixels (in X and Y).
+ */
+#define CENTROID_MAX_OFFSET        (2.0)
+/**
+ * The fraction of frames a method must find the star in, to be considered by the -budget summary.
+ */
+#define CENTROID_MIN_FOUND_FRACTION (0.95)
+/**
+ * The number of iterations of the weighted centre of mass.
+ */
+#define WEIGHTED_ITERATION_COUNT   (5)
+/**
+ * The conversion factor from a Gaussian FWHM to sigma.
+ */
+#define FWHM_TO_SIGMA              (0.4246609)
+
+/* data types */
+/**
+ * Structure holding the synthetic frames for one regime.
+ * <dl>
+ * <dt>Window_Size</dt> <dd>The number of columns (and rows) in each frame.</dd>
+ * <dt>Frame_Count</dt> <dd>The number of frames.</dd>
+ * <dt>FWHM</dt> <dd>The FWHM of the star, in pixels.</dd>
+ * <dt>Data</dt> <dd>The frames, one after another.</dd>
+ * <dt>Work</dt> <dd>A working copy of one frame, restored before each method call.</dd>
+ * <dt>True_X</dt> <dd>The true X position of the star in each frame.</dd>
+ * <dt>True_Y</dt> <dd>The true Y position of the star in each frame.</dd>
+ * <dt>Error_X</dt> <dd>Working list of the X errors of the positions a method returned.</dd>
+ * <dt>Error_Y</dt> <dd>Working list of the Y errors of the positions a method returned.</dd>
+ * <dt>Sort_List</dt> <dd>Working list used to find the median errors.</dd>
+ * </dl>
+ */
+struct Regime_Struct
+{
+	int Window_Size;
+	int Frame_Count;
+	double FWHM;
+	float *Data;
+	float *Work;
+	double *True_X;
+	double *True_Y;
+	double *Error_X;
+	double *Error_Y;
+	double *Sort_List;
+};
+
+/**
+ * Structure describing one centroiding method.
+ * <dl>
+ * <dt>Name</dt> <dd>The method name, as written to the CSV and selected with -method.</dd>
+ * <dt>Needs_Config</dt> <dd>Boolean, whether the method needs the autoguider config to be loaded.</dd>
+ * <dt>Centroid</dt> <dd>Routine to centroid the star in a frame. It returns TRUE if a position was found,
+ *     FALSE if not, and -1 on an error. It may modify the frame.</dd>
+ * </dl>
+ */
+struct Method_Struct
+{
+	char *Name;
+	int Needs_Config;
+	int (*Centroid)(float *frame,int window_size,double fwhm,double *x,double *y);
+};
+
+/**
+ * Structure holding the results of one method on one regime.
+ * <dl>
+ * <dt>Method</dt> <dd>The method.</dd>
+ * <dt>Found_Fraction</dt> <dd>The fraction of frames the star was found in.</dd>
+ * <dt>RMS</dt> <dd>The radial RMS error with the bias removed, in pixels.</dd>
+ * <dt>CPU_Us</dt> <dd>The mean thread CPU time per frame, in microseconds.</dd>
+ * </dl>
+ */
+struct Result_Struct
+{
+	struct Method_Struct *Method;
+	double Found_Fraction;
+	double RMS;
+	double CPU_Us;
+};
+
+/* internal functions */
+static int Centroid_Object_Detect(float *frame,int window_size,double fwhm,double *x,double *y);
+static int Centroid_Centre_Of_Mass(float *frame,int window_size,double fwhm,double *x,double *y);
+static int Centroid_Gaussian_3_Point(float *frame,int window_size,double fwhm,double *x,double *y);
+static int Centroid_Weighted_Centre_Of_Mass(float *frame,int window_size,double fwhm,double *x,double *y);
+static float Frame_Edge_Median(float *frame,int window_size);
+static void Frame_Peak(float *frame,int window_size,int *peak_x,int *peak_y);
+static int Regime_Create(struct Regime_Struct *regime,double snr,double fwhm,double background,int window_size);
+static void Regime_Free(struct Regime_Struct *regime);
+static int Bench_Method(struct Method_Struct *method,struct Regime_Struct *regime,double snr,double background,
+			FILE *fp,struct Result_Struct *result);
+static double Pixel_Integral(double centre,double sigma,int pixel);
+static double Median(double *list,int count,double *sort_list);
+static int Double_Compare(const void *p1,const void *p2);
+static int Float_Compare(const void *p1,const void *p2);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The integrated signal to noise ratios in the grid.
+ * @see #SNR_COUNT
+ */
+static double SNR_List[SNR_COUNT] = {5.0,10.0,20.0,50.0,100.0,300.0};
+/**
+ * The star FWHMs in the grid, in pixels.
+ * @see #FWHM_COUNT
+ */
+static double FWHM_List[FWHM_COUNT] = {1.5,2.5,4.0,6.0};
+/**
+ * The sky backgrounds in the grid, in counts per pixel.
+ * @see #BACKGROUND_COUNT
+ */
+static double Background_List[BACKGROUND_COUNT] = {10.0,100.0,1000.0};
+/**
+ * The guide window sizes in the grid, in pixels.
+ * @see #WINDOW_COUNT
+ */
+static int Window_List[WINDOW_COUNT] = {32,64,MAX_WINDOW_SIZE};
+/**
+ * The list of centroiding methods.
+ * @see #Method_Struct
+ */
+static struct Method_Struct Method_List[] =
+{
+	{"object_detect",TRUE,Centroid_Object_Detect},
+	{"centre_of_mass",FALSE,Centroid_Centre_Of_Mass},
+	{"gaussian_3_point",FALSE,Centroid_Gaussian_3_Point},
+	{"weighted_centre_of_mass",FALSE,Centroid_Weighted_Centre_Of_Mass},
+	{NULL,FALSE,NULL}
+};
+/**
+ * The autoguider config filename to load, or NULL if no config is loaded (and object_detect is skipped).
+ */
+static char *Config_Filename = NULL;
+/**
+ * The CSV filename to write, or NULL to write to stdout.
+ */
+static char *CSV_Filename = NULL;
+/**
+ * A label written in the first column of every CSV line, to identify the build being benchmarked.
+ */
+static char *Label = "";
+/**
+ * If not NULL, only benchmark the method with this name.
+ */
+static char *Selected_Method = NULL;
+/**
+ * The number of frames generated for each regime.
+ * @see #DEFAULT_FRAME_COUNT
+ */
+static int Frame_Count = DEFAULT_FRAME_COUNT;
+/**
+ * The read noise of the synthetic frames, in counts.
+ * @see #DEFAULT_READ_NOISE
+ */
+static double Read_Noise = DEFAULT_READ_NOISE;
+/**
+ * The tracking error budget (radial RMS, in pixels) for the summary, or negative for no summary.
+ */
+static double Budget = -1.0;
+/**
+ * State of the random number generator used to create the synthetic frames.
+ */
+static unsigned int Random_Seed = 12345;
+
+/**
+ * Main program.
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The program returns 0 on success, and non-zero on failure.
+ * @see #Parse_Arguments
+ * @see #Regime_Create
+ * @see #Bench_Method
+ * @see autoguider_object.html#Autoguider_Object_Initialise
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Load
+ */
+int main(int argc, char *argv[])
+{
+	struct Regime_Struct regime;
+	struct Result_Struct result_list[sizeof(Method_List)/sizeof(Method_List[0])];
+	char error_string[AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH];
+	FILE *fp = stdout;
+	int s,f,b,w,m,result_count,best_index;
+
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(Config_Filename != NULL)
+	{
+		CCD_Config_Initialise();
+		if(!CCD_Config_Load(Config_Filename))
+		{
+			fprintf(stderr,"autoguider_centroid_bench:CCD_Config_Load(%s) failed.\n",Config_Filename);
+			return 2;
+		}
+		if(!Autoguider_Object_Initialise())
+		{
+			Autoguider_General_Error_To_String("bench","autoguider_centroid_bench.c","main",
+							   LOG_VERBOSITY_VERY_TERSE,"BENCH",error_string);
+			fprintf(stderr,"autoguider_centroid_bench:%s\n",error_string);
+			return 2;
+		}
+	}
+	else
+	{
+		fprintf(stderr,"autoguider_centroid_bench:Skipping object_detect, it needs -config_filename.\n");
+	}
+	if(CSV_Filename != NULL)
+	{
+		fp = fopen(CSV_Filename,"w");
+		if(fp == NULL)
+		{
+			fprintf(stderr,"autoguider_centroid_bench:Failed to open CSV file '%s'.\n",CSV_Filename);
+			return 3;
+		}
+	}
+	fprintf(fp,"label,method,snr,fwhm,background,window,frames,found_fraction,bias_x,bias_y,rms_x,rms_y,rms,"
+		"rms_unbiased,cpu_us_per_frame,allocs_per_frame\n");
+	for(s=0;s<SNR_COUNT;s++)
+	{
+		for(f=0;f<FWHM_COUNT;f++)
+		{
+			for(b=0;b<BACKGROUND_COUNT;b++)
+			{
+				for(w=0;w<WINDOW_COUNT;w++)
+				{
+					if(!Regime_Create(&regime,SNR_List[s],FWHM_List[f],Background_List[b],
+							  Window_List[w]))
+						return 4;
+					result_count = 0;
+					for(m=0;Method_List[m].Name != NULL;m++)
+					{
+						if((Selected_Method != NULL)&&
+						   (strcmp(Selected_Method,Method_List[m].Name) != 0))
+							continue;
+						if(Method_List[m].Needs_Config && (Config_Filename == NULL))
+							continue;
+						if(!Bench_Method(&(Method_List[m]),&regime,SNR_List[s],Background_List[b],
+								 fp,&(result_list[result_count])))
+						{
+							Autoguider_General_Error_To_String("bench",
+									"autoguider_centroid_bench.c","main",
+									LOG_VERBOSITY_VERY_TERSE,"BENCH",error_string);
+							fprintf(stderr,"autoguider_centroid_bench:%s failed:%s\n",
+								Method_List[m].Name,error_string);
+							Regime_Free(&regime);
+							return 5;
+						}
+						result_count++;
+					}
+					fflush(fp);
+					Regime_Free(&regime);
+					if(Budget < 0.0)
+						continue;
+					/* pick the cheapest method within the tracking error budget */
+					best_index = -1;
+					for(m=0;m<result_count;m++)
+					{
+						if((result_list[m].Found_Fraction < CENTROID_MIN_FOUND_FRACTION)||
+						   (result_list[m].RMS > Budget))
+							continue;
+						if((best_index < 0)||(result_list[m].CPU_Us < result_list[best_index].CPU_Us))
+							best_index = m;
+					}
+					fprintf(stdout,"# snr %.0f fwhm %.1f background %.0f window %d : ",SNR_List[s],
+						FWHM_List[f],Background_List[b],Window_List[w]);
+					if(best_index < 0)
+						fprintf(stdout,"no method within %.3f pixels.\n",Budget);
+					else
+					{
+						fprintf(stdout,"%s (unbiased rms %.3f pixels, %.1f us).\n",
+							result_list[best_index].Method->Name,result_list[best_index].RMS,
+							result_list[best_index].CPU_Us);
+					}
+				}
+			}
+		}
+	}
+	if(fp != stdout)
+		fclose(fp);
+	Autoguider_Object_Shutdown();
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Centroid using the autoguider's object detection, as the guide loop does, taking the object with
+ * the most counts.
+ * @param frame The frame.
+ * @param window_size The number of columns and rows in the frame.
+ * @param fwhm The star FWHM (not used).
+ * @param x The address of a double to store the X position in.
+ * @param y The address of a double to store the Y position in.
+ * @return The routine returns TRUE if an object was found, FALSE if not, and -1 if object detection failed.
+ * @see autoguider_object.html#Autoguider_Object_Detect
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Count
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Object
+ */
+static int Centroid_Object_Detect(float *frame,int window_size,double fwhm,double *x,double *y)
+{
+	struct Autoguider_Object_Struct object;
+	float best_counts;
+	int i,count,found;
+
+	if(!Autoguider_Object_Detect(frame,window_size,window_size,0,0,TRUE,0,0))
+		return -1;
+	if(!Autoguider_Object_List_Get_Count(&count))
+		return -1;
+	found = FALSE;
+	best_counts = 0.0f;
+	for(i=0;i<count;i++)
+	{
+		if(!Autoguider_Object_List_Get_Object(i,&object))
+			return -1;
+		if((found == FALSE)||(object.Total_Counts > best_counts))
+		{
+			best_counts = object.Total_Counts;
+			(*x) = object.Buffer_X_Position;
+			(*y) = object.Buffer_Y_Position;
+			found = TRUE;
+		}
+	}
+	return found;
+}
+
+/**
+ * Centroid using the background subtracted centre of mass, in a box of half-width 1.5 FWHM
+ * (at least 2 pixels) around the brightest pixel. Pixels below the background are ignored.
+ * @param frame The frame.
+ * @param window_size The number of columns and rows in the frame.
+ * @param fwhm The star FWHM, in pixels.
+ * @param x The address of a double to store the X position in.
+ * @param y The address of a double to store the Y position in.
+ * @return The routine returns TRUE if a position was found, and FALSE if not.
+ * @see #Frame_Edge_Median
+ * @see #Frame_Peak
+ */
+static int Centroid_Centre_Of_Mass(float *frame,int window_size,double fwhm,double *x,double *y)
+{
+	double sum,sum_x,sum_y,value;
+	float background;
+	int peak_x,peak_y,half_width,i,j;
+
+	background = Frame_Edge_Median(frame,window_size);
+	Frame_Peak(frame,window_size,&peak_x,&peak_y);
+	half_width = (int)ceil(1.5*fwhm);
+	if(half_width < 2)
+		half_width = 2;
+	sum = 0.0;
+	sum_x = 0.0;
+	sum_y = 0.0;
+	for(j=peak_y-half_width;j<=peak_y+half_width;j++)
+	{
+		if((j < 0)||(j >= window_size))
+			continue;
+		for(i=peak_x-half_width;i<=peak_x+half_width;i++)
+		{
+			if((i < 0)||(i >= window_size))
+				continue;
+			value = frame[(j*window_size)+i]-background;
+			if(value <= 0.0)
+				continue;
+			sum += value;
+			sum_x += value*i;
+			sum_y += value*j;
+		}
+	}
+	if(sum <= 0.0)
+		return FALSE;
+	(*x) = sum_x/sum;
+	(*y) = sum_y/sum;
+	return TRUE;
+}
+
+/**
+ * Centroid by fitting a Gaussian through the brightest pixel and its two neighbours, in X and Y separately.
+ * The fit is the vertex of the parabola through the logarithms of the (background subtracted) pixel values.
+ * @param frame The frame.
+ * @param window_size The number of columns and rows in the frame.
+ * @param fwhm The star FWHM (not used).
+ * @param x The address of a double to store the X position in.
+ * @param y The address of a double to store the Y position in.
+ * @return The routine returns TRUE if a position was found, and FALSE if not (the peak is on the window edge,
+ *         or a pixel is not above the background, or the pixels are not peaked).
+ * @see #Frame_Edge_Median
+ * @see #Frame_Peak
+ */
+static int Centroid_Gaussian_3_Point(float *frame,int window_size,double fwhm,double *x,double *y)
+{
+	double left,centre,right,denominator;
+	float background;
+	int peak_x,peak_y,index;
+
+	background = Frame_Edge_Median(frame,window_size);
+	Frame_Peak(frame,window_size,&peak_x,&peak_y);
+	if((peak_x < 1)||(peak_x >= (window_size-1))||(peak_y < 1)||(peak_y >= (window_size-1)))
+		return FALSE;
+	index = (peak_y*window_size)+peak_x;
+	centre = frame[index]-background;
+	/* x */
+	left = frame[index-1]-background;
+	right = frame[index+1]-background;
+	if((left <= 0.0)||(centre <= 0.0)||(right <= 0.0))
+		return FALSE;
+	left = log(left);
+	centre = log(centre);
+	right = log(right);
+	denominator = left-(2.0*centre)+right;
+	if(denominator >= 0.0)
+		return FALSE;
+	(*x) = peak_x+(0.5*(left-right)/denominator);
+	/* y */
+	centre = frame[index]-background;
+	left = frame[index-window_size]-background;
+	right = frame[index+window_size]-background;
+	if((left <= 0.0)||(right <= 0.0))
+		return FALSE;
+	left = log(left);
+	centre = log(centre);
+	right = log(right);
+	denominator = left-(2.0*centre)+right;
+	if(denominator >= 0.0)
+		return FALSE;
+	(*y) = peak_y+(0.5*(left-right)/denominator);
+	return TRUE;
+}
+
+/**
+ * Centroid using an iteratively Gaussian weighted centre of mass. The weighting Gaussian has the star's FWHM,
+ * and is centred on the brightest pixel for the first iteration, and on the previous estimate thereafter.
+ * The sum is over a box of half-width 2 FWHM (at least 3 pixels) around the current estimate.
+ * @param frame The frame.
+ * @param window_size The number of columns and rows in the frame.
+ * @param fwhm The star FWHM, in pixels.
+ * @param x The address of a double to store the X position in.
+ * @param y The address of a double to store the Y position in.
+ * @return The routine returns TRUE if a position was found, and FALSE if not.
+ * @see #WEIGHTED_ITERATION_COUNT
+ * @see #Frame_Edge_Median
+ * @see #Frame_Peak
+ */
+static int Centroid_Weighted_Centre_Of_Mass(float *frame,int window_size,double fwhm,double *x,double *y)
+{
+	double sum,sum_x,sum_y,value,weight,dx,dy,centre_x,centre_y,two_sigma_squared;
+	float background;
+	int peak_x,peak_y,half_width,iteration,i,j,start_x,start_y;
+
+	background = Frame_Edge_Median(frame,window_size);
+	Frame_Peak(frame,window_size,&peak_x,&peak_y);
+	half_width = (int)ceil(2.0*fwhm);
+	if(half_width < 3)
+		half_width = 3;
+	two_sigma_squared = 2.0*(fwhm*FWHM_TO_SIGMA)*(fwhm*FWHM_TO_SIGMA);
+	centre_x = peak_x;
+	centre_y = peak_y;
+	for(iteration=0;iteration<WEIGHTED_ITERATION_COUNT;iteration++)
+	{
+		sum = 0.0;
+		sum_x = 0.0;
+		sum_y = 0.0;
+		start_x = (int)floor(centre_x+0.5);
+		start_y = (int)floor(centre_y+0.5);
+		for(j=start_y-half_width;j<=start_y+half_width;j++)
+		{
+			if((j < 0)||(j >= window_size))
+				continue;
+			dy = j-centre_y;
+			for(i=start_x-half_width;i<=start_x+half_width;i++)
+			{
+				if((i < 0)||(i >= window_size))
+					continue;
+				dx = i-centre_x;
+				value = frame[(j*window_size)+i]-background;
+				weight = exp(-((dx*dx)+(dy*dy))/two_sigma_squared);
+				sum += value*weight;
+				sum_x += value*weight*i;
+				sum_y += value*weight*j;
+			}
+		}
+		if(sum <= 0.0)
+			return FALSE;
+		centre_x = sum_x/sum;
+		centre_y = sum_y/sum;
+		if((centre_x < 0.0)||(centre_x >= window_size)||(centre_y < 0.0)||(centre_y >= window_size))
+			return FALSE;
+	}
+	(*x) = centre_x;
+	(*y) = centre_y;
+	return TRUE;
+}
+
+/**
+ * Return the median of the pixels on the edge of a frame, used as the background estimate by the
+ * candidate methods.
+ * @param frame The frame.
+ * @param window_size The number of columns and rows in the frame.
+ * @return The median edge pixel value.
+ * @see #Float_Compare
+ */
+static float Frame_Edge_Median(float *frame,int window_size)
+{
+	float edge_list[4*MAX_WINDOW_SIZE];
+	int i,count;
+
+	count = 0;
+	for(i=0;(i<window_size)&&(i<MAX_WINDOW_SIZE);i++)
+	{
+		edge_list[count++] = frame[i];
+		edge_list[count++] = frame[((window_size-1)*window_size)+i];
+		edge_list[count++] = frame[i*window_size];
+		edge_list[count++] = frame[(i*window_size)+window_size-1];
+	}
+	qsort(edge_list,count,sizeof(float),Float_Compare);
+	return edge_list[count/2];
+}
+
+/**
+ * Find the brightest pixel in a frame.
+ * @param frame The frame.
+ * @param window_size The number of columns and rows in the frame.
+ * @param peak_x The address of an integer to store the X position of the brightest pixel in.
+ * @param peak_y The address of an integer to store the Y position of the brightest pixel in.
+ */
+static void Frame_Peak(float *frame,int window_size,int *peak_x,int *peak_y)
+{
+	int i,peak_index;
+
+	peak_index = 0;
+	for(i=1;i<(window_size*window_size);i++)
+	{
+		if(frame[i] > frame[peak_index])
+			peak_index = i;
+	}
+	(*peak_x) = peak_index%window_size;
+	(*peak_y) = peak_index/window_size;
+}
+
+/**
+ * Create the synthetic frames for one regime. The star flux F is chosen so that
+ * F/sqrt(F+(N*(background+read_noise^2))) is the required signal to noise ratio, where N = 4 pi sigma^2 is
+ * the effective number of pixels of a Gaussian star.
+ * @param regime The regime to fill in.
+ * @param snr The integrated signal to noise ratio of the star.
+ * @param fwhm The FWHM of the star, in pixels.
+ * @param background The sky background, in counts per pixel.
+ * @param window_size The number of columns and rows in each frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Frame_Count
+ * @see #Read_Noise
+ * @see #Pixel_Integral
+ * @see autoguider_test_random.html#Autoguider_Test_Random_Gaussian
+ */
+static int Regime_Create(struct Regime_Struct *regime,double snr,double fwhm,double background,int window_size)
+{
+	double sigma,noise_pixels,noise,flux,value,*x_profile,*y_profile;
+	float *data = NULL;
+	int frame,x,y,pixel_count;
+
+	regime->Window_Size = window_size;
+	regime->Frame_Count = Frame_Count;
+	regime->FWHM = fwhm;
+	pixel_count = window_size*window_size;
+	regime->Data = (float *)malloc(Frame_Count*pixel_count*sizeof(float));
+	regime->Work = (float *)malloc(pixel_count*sizeof(float));
+	regime->True_X = (double *)malloc(Frame_Count*sizeof(double));
+	regime->True_Y = (double *)malloc(Frame_Count*sizeof(double));
+	regime->Error_X = (double *)malloc(Frame_Count*sizeof(double));
+	regime->Error_Y = (double *)malloc(Frame_Count*sizeof(double));
+	regime->Sort_List = (double *)malloc(Frame_Count*sizeof(double));
+	x_profile = (double *)malloc(window_size*sizeof(double));
+	y_profile = (double *)malloc(window_size*sizeof(double));
+	if((regime->Data == NULL)||(regime->Work == NULL)||(regime->True_X == NULL)||(regime->True_Y == NULL)||
+	   (regime->Error_X == NULL)||(regime->Error_Y == NULL)||(regime->Sort_List == NULL)||
+	   (x_profile == NULL)||(y_profile == NULL))
+	{
+		fprintf(stderr,"Regime_Create:Failed to allocate %d %dx%d frames.\n",Frame_Count,window_size,
+			window_size);
+		if(x_profile != NULL)
+			free(x_profile);
+		if(y_profile != NULL)
+			free(y_profile);
+		Regime_Free(regime);
+		return FALSE;
+	}
+	sigma = fwhm*FWHM_TO_SIGMA;
+	noise_pixels = 4.0*M_PI*sigma*sigma*(background+(Read_Noise*Read_Noise));
+	flux = ((snr*snr)+sqrt((snr*snr*snr*snr)+(4.0*snr*snr*noise_pixels)))/2.0;
+	for(frame=0;frame<Frame_Count;frame++)
+	{
+		data = regime->Data+(frame*pixel_count);
+		regime->True_X[frame] = (window_size/2.0)+
+			(CENTROID_MAX_OFFSET*((2.0*Autoguider_Test_Random_Uniform(&Random_Seed))-1.0));
+		regime->True_Y[frame] = (window_size/2.0)+
+			(CENTROID_MAX_OFFSET*((2.0*Autoguider_Test_Random_Uniform(&Random_Seed))-1.0));
+		for(x=0;x<window_size;x++)
+		{
+			x_profile[x] = Pixel_Integral(regime->True_X[frame],sigma,x);
+			y_profile[x] = Pixel_Integral(regime->True_Y[frame],sigma,x);
+		}
+		for(y=0;y<window_size;y++)
+		{
+			for(x=0;x<window_size;x++)
+			{
+				value = background+(flux*x_profile[x]*y_profile[y]);
+				noise = sqrt(value+(Read_Noise*Read_Noise))*
+					Autoguider_Test_Random_Gaussian(&Random_Seed);
+				data[(y*window_size)+x] = (float)(value+noise);
+			}
+		}
+	}
+	free(x_profile);
+	free(y_profile);
+	return TRUE;
+}
+
+/**
+ * Free the data allocated in a regime by Regime_Create.
+ * @param regime The regime.
+ */
+static void Regime_Free(struct Regime_Struct *regime)
+{
+	if(regime->Data != NULL)
+		free(regime->Data);
+	if(regime->Work != NULL)
+		free(regime->Work);
+	if(regime->True_X != NULL)
+		free(regime->True_X);
+	if(regime->True_Y != NULL)
+		free(regime->True_Y);
+	if(regime->Error_X != NULL)
+		free(regime->Error_X);
+	if(regime->Error_Y != NULL)
+		free(regime->Error_Y);
+	if(regime->Sort_List != NULL)
+		free(regime->Sort_List);
+	regime->Data = NULL;
+	regime->Work = NULL;
+	regime->True_X = NULL;
+	regime->True_Y = NULL;
+	regime->Error_X = NULL;
+	regime->Error_Y = NULL;
+	regime->Sort_List = NULL;
+}
+
+/**
+ * Run one method over every frame in a regime, and write a CSV line with the results. Each frame is copied
+ * (untimed) to the regime's work buffer before the method is called, and each call is timed with
+ * CLOCK_THREAD_CPUTIME_ID. The method is called once untimed first, to fault in any buffers it allocates.
+ * The method's bias is estimated as the median X and Y error of all the positions it returned. Positions more
+ * than one FWHM from the truth once the bias is removed are then counted as misses, and the errors of the
+ * remaining positions summarised.
+ * @param method The method to run.
+ * @param regime The regime.
+ * @param snr The regime's signal to noise ratio, written to the CSV.
+ * @param background The regime's background, written to the CSV.
+ * @param fp The file to write the CSV line to.
+ * @param result The address of a structure to store the summary results in.
+ * @return The routine returns TRUE on success and FALSE if the method returned an error.
+ * @see autoguider_test_alloc.html#Autoguider_Test_Allocation_Count
+ * @see #Label
+ * @see #Median
+ */
+static int Bench_Method(struct Method_Struct *method,struct Regime_Struct *regime,double snr,double background,
+			FILE *fp,struct Result_Struct *result)
+{
+	struct timespec start_time,end_time;
+	unsigned long allocation_count;
+	double x,y,dx,dy,sum_dx,sum_dy,sum_dx2,sum_dy2,total_ns,bias_x,bias_y,rms_x,rms_y,rms,rms_unbiased;
+	double median_x,median_y;
+	int frame,found,found_count,returned_count,i,pixel_count;
+
+	pixel_count = regime->Window_Size*regime->Window_Size;
+	/* warm up */
+	memcpy(regime->Work,regime->Data,pixel_count*sizeof(float));
+	if((*(method->Centroid))(regime->Work,regime->Window_Size,regime->FWHM,&x,&y) < 0)
+		return FALSE;
+	returned_count = 0;
+	total_ns = 0.0;
+	allocation_count = 0;
+	for(frame=0;frame<regime->Frame_Count;frame++)
+	{
+		memcpy(regime->Work,regime->Data+(frame*pixel_count),pixel_count*sizeof(float));
+		allocation_count -= Autoguider_Test_Allocation_Count;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID,&start_time);
+		found = (*(method->Centroid))(regime->Work,regime->Window_Size,regime->FWHM,&x,&y);
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID,&end_time);
+		allocation_count += Autoguider_Test_Allocation_Count;
+		if(found < 0)
+			return FALSE;
+		total_ns += fdifftime(end_time,start_time)*AUTOGUIDER_GENERAL_ONE_SECOND_NS;
+		if(found == FALSE)
+			continue;
+		regime->Error_X[returned_count] = x-regime->True_X[frame];
+		regime->Error_Y[returned_count] = y-regime->True_Y[frame];
+		returned_count++;
+	}
+	/* gate each position on it's distance from the truth, once the method's (median) bias is removed */
+	median_x = Median(regime->Error_X,returned_count,regime->Sort_List);
+	median_y = Median(regime->Error_Y,returned_count,regime->Sort_List);
+	found_count = 0;
+	sum_dx = 0.0;
+	sum_dy = 0.0;
+	sum_dx2 = 0.0;
+	sum_dy2 = 0.0;
+	for(i=0;i<returned_count;i++)
+	{
+		dx = regime->Error_X[i];
+		dy = regime->Error_Y[i];
+		if((((dx-median_x)*(dx-median_x))+((dy-median_y)*(dy-median_y))) > (regime->FWHM*regime->FWHM))
+			continue;
+		sum_dx += dx;
+		sum_dy += dy;
+		sum_dx2 += dx*dx;
+		sum_dy2 += dy*dy;
+		found_count++;
+	}
+	if(found_count > 0)
+	{
+		bias_x = sum_dx/found_count;
+		bias_y = sum_dy/found_count;
+		rms_x = sqrt(sum_dx2/found_count);
+		rms_y = sqrt(sum_dy2/found_count);
+		rms = sqrt((sum_dx2+sum_dy2)/found_count);
+		rms_unbiased = sqrt(fabs(((sum_dx2+sum_dy2)/found_count)-(bias_x*bias_x)-(bias_y*bias_y)));
+	}
+	else
+	{
+		bias_x = 0.0;
+		bias_y = 0.0;
+		rms_x = 0.0;
+		rms_y = 0.0;
+		rms = 0.0;
+		rms_unbiased = 0.0;
+	}
+	result->Method = method;
+	result->Found_Fraction = ((double)found_count)/regime->Frame_Count;
+	result->RMS = rms_unbiased;
+	result->CPU_Us = total_ns/(regime->Frame_Count*1000.0);
+	fprintf(fp,"%s,%s,%.0f,%.1f,%.0f,%d,%d,%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.2f,%.2f\n",Label,method->Name,
+		snr,regime->FWHM,background,regime->Window_Size,regime->Frame_Count,result->Found_Fraction,
+		bias_x,bias_y,rms_x,rms_y,rms,rms_unbiased,result->CPU_Us,
+		((double)allocation_count)/regime->Frame_Count);
+	return TRUE;
+}
+
+/**
+ * Return the fraction of a one dimensional Gaussian's flux falling in a pixel.
+ * @param centre The centre of the Gaussian.
+ * @param sigma The sigma of the Gaussian.
+ * @param pixel The pixel, covering pixel-0.5 to pixel+0.5.
+ * @return The fraction of the flux in the pixel.
+ */
+static double Pixel_Integral(double centre,double sigma,int pixel)
+{
+	return 0.5*(erf((pixel+0.5-centre)/(M_SQRT2*sigma))-erf((pixel-0.5-centre)/(M_SQRT2*sigma)));
+}
+
+/**
+ * Return the median of a list of doubles, without changing the list.
+ * @param list The list.
+ * @param count The number of elements in the list.
+ * @param sort_list A list of at least count elements, used to sort a copy of the list.
+ * @return The median, or 0.0 if the list is empty.
+ * @see #Double_Compare
+ */
+static double Median(double *list,int count,double *sort_list)
+{
+	if(count < 1)
+		return 0.0;
+	memcpy(sort_list,list,count*sizeof(double));
+	qsort(sort_list,count,sizeof(double),Double_Compare);
+	if((count%2) == 0)
+		return (sort_list[(count/2)-1]+sort_list[count/2])/2.0;
+	return sort_list[count/2];
+}
+
+/**
+ * qsort comparison routine for doubles, sorting into ascending order.
+ * @param p1 A pointer to the first double.
+ * @param p2 A pointer to the second double.
+ * @return -1, 0 or 1.
+ */
+static int Double_Compare(const void *p1,const void *p2)
+{
+	double d1,d2;
+
+	d1 = *((const double *)p1);
+	d2 = *((const double *)p2);
+	if(d1 < d2)
+		return -1;
+	if(d1 > d2)
+		return 1;
+	return 0;
+}
+
+/**
+ * qsort comparison routine for floats, sorting into ascending order.
+ * @param p1 A pointer to the first float.
+ * @param p2 A pointer to the second float.
+ * @return -1, 0 or 1.
+ */
+static int Float_Compare(const void *p1,const void *p2)
+{
+	float f1,f2;
+
+	f1 = *((const float *)p1);
+	f2 = *((const float *)p2);
+	if(f1 < f2)
+		return -1;
+	if(f1 > f2)
+		return 1;
+	return 0;
+}
+
+/**
+ * Parse the command line arguments.
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Help
+ * @see #Config_Filename
+ * @see #CSV_Filename
+ * @see #Label
+ * @see #Selected_Method
+ * @see #Frame_Count
+ * @see #Read_Noise
+ * @see #Budget
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"-budget")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%lf",&Budget);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal budget '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:budget requires a number of pixels.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-config_filename")==0)||(strcmp(argv[i],"-co")==0))
+		{
+			if((i+1)<argc)
+			{
+				Config_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:config filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-csv")==0)
+		{
+			if((i+1)<argc)
+			{
+				CSV_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:CSV filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-frames")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Frame_Count);
+				if((retval != 1)||(Frame_Count < 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal frame count '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:frames requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if(strcmp(argv[i],"-label")==0)
+		{
+			if((i+1)<argc)
+			{
+				Label = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:label required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-method")==0)||(strcmp(argv[i],"-m")==0))
+		{
+			if((i+1)<argc)
+			{
+				Selected_Method = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:method name required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-read_noise")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%lf",&Read_Noise);
+				if((retval != 1)||(Read_Noise < 0.0))
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal read noise '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:read noise requires a number of counts.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	int m;
+
+	fprintf(stdout,"Autoguider Centroid Bench:Help.\n");
+	fprintf(stdout,"Measure centroid accuracy and CPU cost on synthetic guide windows with known star positions.\n");
+	fprintf(stdout,"autoguider_centroid_bench [-co[nfig_filename] <filename>][-csv <filename>][-label <string>]\n");
+	fprintf(stdout,"\t[-m[ethod] <name>][-frames <n>][-read_noise <counts>][-budget <pixels>][-h[elp]]\n");
+	fprintf(stdout,"\t-config_filename is an autoguider properties file, needed for object_detect.\n");
+	fprintf(stdout,"\t-csv defaults to stdout. -label is written in the first column, e.g. a build id.\n");
+	fprintf(stdout,"\t-frames defaults to %d per regime, -read_noise to %.1f counts.\n",DEFAULT_FRAME_COUNT,
+		DEFAULT_READ_NOISE);
+	fprintf(stdout,"\t-budget prints the cheapest method with a bias removed radial RMS error within the budget,\n"
+		"\tper regime.\n");
+	fprintf(stdout,"\tMethods:");
+	for(m=0;Method_List[m].Name != NULL;m++)
+		fprintf(stdout," %s",Method_List[m].Name);
+	fprintf(stdout,"\n");
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
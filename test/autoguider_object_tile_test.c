@@ -0,0 +1,568 @@
+/* autoguider_object_tile_test.c
+ * $Id$
+ * Test tiled object detection finds the same objects as serial object detection.
+ */
+/**
+ * Test tiled object detection (Autoguider_Object_Detect_Tiled) finds the same objects as serial object detection
+ * (Autoguider_Object_Detect) on the same frame. A synthetic frame is created, with a noisy background and
+ * Gaussian stars at random positions, plus stars placed across the boundaries between tiles (for every tested
+ * tile count), and pairs of stars close enough to merge into one object that crosses a boundary.
+ * The frame is detected serially, and then tiled with each of the tile counts in Tile_Count_List, on the worker
+ * pool. For each tile count the median, threshold and number of objects must be the same, and each serial object
+ * must have a tiled object with the same pixel count, and the same position, total counts, peak counts and FWHM
+ * (to within TILE_TEST_TOLERANCE, as positions are summed relative to each tile).
+ * <pre>
+ * autoguider_object_tile_test -co[nfig_filename] &lt;filename&gt; [-threads &lt;n&gt;] [-size &lt;pixels&gt;]
+ * 	[-stars &lt;n&gt;]
+ * </pre>
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+
+#include "autoguider_general.h"
+#include "autoguider_object.h"
+#include "autoguider_worker_pool.h"
+
+#include "autoguider_test_util.h"
+
+/* hash defines */
+#ifndef M_PI
+/**
+ * Pi, if math.h does not define it (it is not POSIX).
+ */
+#define M_PI                       (3.14159265358979323846)
+#endif
+/**
+ * The number of tile counts tested.
+ */
+#define TILE_COUNT_COUNT           (5)
+/**
+ * The default number of columns (and rows) in the synthetic frame.
+ */
+#define DEFAULT_FRAME_SIZE         (512)
+/**
+ * The default number of randomly placed stars in the synthetic frame.
+ */
+#define DEFAULT_STAR_COUNT         (60)
+/**
+ * The default number of worker pool threads (as well as the calling thread).
+ */
+#define DEFAULT_THREAD_COUNT       (3)
+/**
+ * The sky background of the synthetic frame, in counts per pixel.
+ */
+#define BACKGROUND                 (100.0)
+/**
+ * The read noise of the synthetic frame, in counts.
+ */
+#define READ_NOISE                 (8.0)
+/**
+ * The conversion factor from a Gaussian FWHM to sigma.
+ */
+#define FWHM_TO_SIGMA              (0.4246609)
+/**
+ * The tolerance allowed between serial and tiled positions, counts and FWHMs, as a fraction
+ * (or in pixels, for positions).
+ */
+#define TILE_TEST_TOLERANCE        (0.001)
+
+/* internal functions */
+static int Frame_Create(float **frame);
+static void Frame_Add_Star(float *frame,double x,double y,double flux,double fwhm);
+static int Object_List_Copy(struct Autoguider_Object_Struct **object_list,int *object_count);
+static int Object_List_Compare(struct Autoguider_Object_Struct *serial_list,int serial_count,
+			       struct Autoguider_Object_Struct *tiled_list,int tiled_count,int tile_count);
+static int Value_Is_Close(double value1,double value2);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The tile counts to test. 1 tests the tiled entry point takes the serial path.
+ * @see #TILE_COUNT_COUNT
+ */
+static int Tile_Count_List[TILE_COUNT_COUNT] = {1,2,3,4,7};
+/**
+ * The autoguider config filename to load, for the object detection thresholds.
+ */
+static char *Config_Filename = NULL;
+/**
+ * The number of columns (and rows) in the synthetic frame.
+ * @see #DEFAULT_FRAME_SIZE
+ */
+static int Frame_Size = DEFAULT_FRAME_SIZE;
+/**
+ * The number of randomly placed stars in the synthetic frame.
+ * @see #DEFAULT_STAR_COUNT
+ */
+static int Star_Count = DEFAULT_STAR_COUNT;
+/**
+ * The number of worker pool threads.
+ * @see #DEFAULT_THREAD_COUNT
+ */
+static int Thread_Count = DEFAULT_THREAD_COUNT;
+/**
+ * State of the random number generator used to create the synthetic frame.
+ */
+static unsigned int Random_Seed = 54321;
+
+/**
+ * Main program.
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The program returns 0 if the tiled and serial objects match, and non-zero on failure.
+ * @see #Parse_Arguments
+ * @see #Frame_Create
+ * @see #Object_List_Copy
+ * @see #Object_List_Compare
+ * @see #Tile_Count_List
+ * @see autoguider_object.html#Autoguider_Object_Initialise
+ * @see autoguider_object.html#Autoguider_Object_Detect
+ * @see autoguider_object.html#Autoguider_Object_Detect_Tiled
+ * @see autoguider_worker_pool.html#Autoguider_Worker_Pool_Initialise
+ * @see autoguider_worker_pool.html#Autoguider_Worker_Pool_Shutdown
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Load
+ */
+int main(int argc, char *argv[])
+{
+	struct Autoguider_Object_Struct *serial_list = NULL;
+	struct Autoguider_Object_Struct *tiled_list = NULL;
+	char error_string[AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH];
+	float *frame = NULL;
+	float serial_median,serial_threshold;
+	int serial_count,tiled_count,failed,t;
+
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(Config_Filename == NULL)
+	{
+		fprintf(stderr,"autoguider_object_tile_test:-config_filename is required.\n");
+		return 1;
+	}
+	CCD_Config_Initialise();
+	if(!CCD_Config_Load(Config_Filename))
+	{
+		fprintf(stderr,"autoguider_object_tile_test:CCD_Config_Load(%s) failed.\n",Config_Filename);
+		return 2;
+	}
+	if((!Autoguider_Object_Initialise())||(!Autoguider_Worker_Pool_Initialise(Thread_Count)))
+	{
+		Autoguider_General_Error_To_String("test","autoguider_object_tile_test.c","main",
+						   LOG_VERBOSITY_VERY_TERSE,"TEST",error_string);
+		fprintf(stderr,"autoguider_object_tile_test:%s\n",error_string);
+		return 2;
+	}
+	if(!Frame_Create(&frame))
+		return 3;
+	/* serial detection */
+	if(!Autoguider_Object_Detect(frame,Frame_Size,Frame_Size,0,0,TRUE,0,0))
+	{
+		Autoguider_General_Error_To_String("test","autoguider_object_tile_test.c","main",
+						   LOG_VERBOSITY_VERY_TERSE,"TEST",error_string);
+		fprintf(stderr,"autoguider_object_tile_test:Serial detection failed:%s\n",error_string);
+		free(frame);
+		return 4;
+	}
+	serial_median = Autoguider_Object_Median_Get();
+	serial_threshold = Autoguider_Object_Threshold_Get();
+	if(!Object_List_Copy(&serial_list,&serial_count))
+	{
+		free(frame);
+		return 4;
+	}
+	fprintf(stdout,"serial: %d objects, median %.3f, threshold %.3f.\n",serial_count,serial_median,
+		serial_threshold);
+	/* tiled detection, on the same frame */
+	failed = FALSE;
+	for(t=0;t<TILE_COUNT_COUNT;t++)
+	{
+		if(!Autoguider_Object_Detect_Tiled(frame,Frame_Size,Frame_Size,0,0,TRUE,0,0,Tile_Count_List[t]))
+		{
+			Autoguider_General_Error_To_String("test","autoguider_object_tile_test.c","main",
+							   LOG_VERBOSITY_VERY_TERSE,"TEST",error_string);
+			fprintf(stderr,"autoguider_object_tile_test:Tiled detection (%d tiles) failed:%s\n",
+				Tile_Count_List[t],error_string);
+			failed = TRUE;
+			continue;
+		}
+		if((Autoguider_Object_Median_Get() != serial_median)||
+		   (Autoguider_Object_Threshold_Get() != serial_threshold))
+		{
+			fprintf(stderr,"autoguider_object_tile_test:%d tiles:median %.3f/threshold %.3f differs from "
+				"serial median %.3f/threshold %.3f.\n",Tile_Count_List[t],Autoguider_Object_Median_Get(),
+				Autoguider_Object_Threshold_Get(),serial_median,serial_threshold);
+			failed = TRUE;
+		}
+		if(!Object_List_Copy(&tiled_list,&tiled_count))
+		{
+			failed = TRUE;
+			continue;
+		}
+		if(!Object_List_Compare(serial_list,serial_count,tiled_list,tiled_count,Tile_Count_List[t]))
+			failed = TRUE;
+		else
+			fprintf(stdout,"%d tiles: %d objects match.\n",Tile_Count_List[t],tiled_count);
+		free(tiled_list);
+		tiled_list = NULL;
+	}
+	free(serial_list);
+	free(frame);
+	Autoguider_Worker_Pool_Shutdown();
+	Autoguider_Object_Shutdown();
+	if(failed)
+	{
+		fprintf(stdout,"FAILED.\n");
+		return 5;
+	}
+	fprintf(stdout,"PASSED.\n");
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Create the synthetic frame. Each pixel has the background plus Gaussian noise with the variance of the
+ * photon plus read noise. Stars are added:
+ * <ul>
+ * <li>Star_Count stars at random positions, with random fluxes and FWHMs.
+ * <li>For each tested tile count, a star centred on each boundary between tiles, at a random column.
+ * <li>For each tested tile count, a pair of stars straddling the first boundary, close enough to be
+ *     detected as one object.
+ * </ul>
+ * The tile boundaries are worked out the same way as Object_List_Get_Tiled (the first rows%tiles tiles
+ * get an extra row).
+ * @param frame The address of a float pointer, on success set to the allocated frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Frame_Size
+ * @see #Star_Count
+ * @see #Tile_Count_List
+ * @see #Frame_Add_Star
+ * @see autoguider_test_random.html#Autoguider_Test_Random_Uniform
+ * @see autoguider_test_random.html#Autoguider_Test_Random_Gaussian
+ */
+static int Frame_Create(float **frame)
+{
+	double x,y;
+	int i,t,boundary_row,tile_nrows,tile_remainder,b;
+
+	(*frame) = (float *)malloc(Frame_Size*Frame_Size*sizeof(float));
+	if((*frame) == NULL)
+	{
+		fprintf(stderr,"Frame_Create:Failed to allocate %dx%d frame.\n",Frame_Size,Frame_Size);
+		return FALSE;
+	}
+	for(i=0;i<(Frame_Size*Frame_Size);i++)
+	{
+		(*frame)[i] = (float)(BACKGROUND+(sqrt(BACKGROUND+(READ_NOISE*READ_NOISE))*
+					       Autoguider_Test_Random_Gaussian(&Random_Seed)));
+	}
+	for(i=0;i<Star_Count;i++)
+	{
+		x = Autoguider_Test_Random_Uniform(&Random_Seed)*Frame_Size;
+		y = Autoguider_Test_Random_Uniform(&Random_Seed)*Frame_Size;
+		Frame_Add_Star((*frame),x,y,2000.0+(Autoguider_Test_Random_Uniform(&Random_Seed)*50000.0),
+			       1.5+(Autoguider_Test_Random_Uniform(&Random_Seed)*4.0));
+	}
+	for(t=0;t<TILE_COUNT_COUNT;t++)
+	{
+		tile_nrows = Frame_Size/Tile_Count_List[t];
+		tile_remainder = Frame_Size%Tile_Count_List[t];
+		boundary_row = 0;
+		for(b=0;b<(Tile_Count_List[t]-1);b++)
+		{
+			boundary_row += tile_nrows;
+			if(b < tile_remainder)
+				boundary_row++;
+			x = 10.0+(Autoguider_Test_Random_Uniform(&Random_Seed)*(Frame_Size-20));
+			Frame_Add_Star((*frame),x,boundary_row-0.5,20000.0,3.0);
+			/* a merged pair across the first boundary */
+			if(b == 0)
+			{
+				x = 10.0+(Autoguider_Test_Random_Uniform(&Random_Seed)*(Frame_Size-20));
+				Frame_Add_Star((*frame),x,boundary_row-3.0,15000.0,2.5);
+				Frame_Add_Star((*frame),x+3.0,boundary_row+2.0,15000.0,2.5);
+			}
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Add a circular Gaussian star to the frame, out to 4 sigma, with photon noise.
+ * @param frame The frame.
+ * @param x The X position of the star centre, in pixels.
+ * @param y The Y position of the star centre, in pixels.
+ * @param flux The total counts in the star.
+ * @param fwhm The FWHM of the star, in pixels.
+ * @see #Frame_Size
+ * @see autoguider_test_random.html#Autoguider_Test_Random_Gaussian
+ */
+static void Frame_Add_Star(float *frame,double x,double y,double flux,double fwhm)
+{
+	double sigma,value,dx,dy;
+	int i,j,half_width;
+
+	sigma = fwhm*FWHM_TO_SIGMA;
+	half_width = (int)ceil(4.0*sigma);
+	for(j=(int)y-half_width;j<=(int)y+half_width;j++)
+	{
+		if((j < 0)||(j >= Frame_Size))
+			continue;
+		dy = j-y;
+		for(i=(int)x-half_width;i<=(int)x+half_width;i++)
+		{
+			if((i < 0)||(i >= Frame_Size))
+				continue;
+			dx = i-x;
+			value = flux*exp(-((dx*dx)+(dy*dy))/(2.0*sigma*sigma))/(2.0*M_PI*sigma*sigma);
+			value += sqrt(value)*Autoguider_Test_Random_Gaussian(&Random_Seed);
+			frame[(j*Frame_Size)+i] += (float)value;
+		}
+	}
+}
+
+/**
+ * Copy the objects detected by the last object detection into an allocated list.
+ * @param object_list The address of a list pointer, on success set to the allocated list, to be freed
+ *        by the caller.
+ * @param object_count The address of an integer, on success set to the number of objects in the list.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Count
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Object
+ */
+static int Object_List_Copy(struct Autoguider_Object_Struct **object_list,int *object_count)
+{
+	int i;
+
+	if(!Autoguider_Object_List_Get_Count(object_count))
+		return FALSE;
+	(*object_list) = (struct Autoguider_Object_Struct *)malloc(((*object_count)+1)*
+								   sizeof(struct Autoguider_Object_Struct));
+	if((*object_list) == NULL)
+	{
+		fprintf(stderr,"Object_List_Copy:Failed to allocate %d objects.\n",(*object_count));
+		return FALSE;
+	}
+	for(i=0;i<(*object_count);i++)
+	{
+		if(!Autoguider_Object_List_Get_Object(i,&((*object_list)[i])))
+		{
+			free((*object_list));
+			(*object_list) = NULL;
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Compare the serial and tiled object lists. The lists must have the same number of objects, and each serial
+ * object must have a tiled object with the same pixel count and stellar flag, and close (Value_Is_Close)
+ * position, total counts, peak counts and FWHM. The index is not compared, as objects with the same total counts
+ * may be sorted in a different order. Each mismatch is printed.
+ * @param serial_list The serial object list.
+ * @param serial_count The number of serial objects.
+ * @param tiled_list The tiled object list.
+ * @param tiled_count The number of tiled objects.
+ * @param tile_count The number of tiles the tiled list was detected with, for printing.
+ * @return The routine returns TRUE if the lists match, and FALSE if they do not.
+ * @see #Value_Is_Close
+ */
+static int Object_List_Compare(struct Autoguider_Object_Struct *serial_list,int serial_count,
+			       struct Autoguider_Object_Struct *tiled_list,int tiled_count,int tile_count)
+{
+	struct Autoguider_Object_Struct *serial = NULL;
+	struct Autoguider_Object_Struct *tiled = NULL;
+	int i,j,found,matched;
+
+	matched = TRUE;
+	if(serial_count != tiled_count)
+	{
+		fprintf(stderr,"Object_List_Compare:%d tiles:found %d objects, serial found %d.\n",tile_count,
+			tiled_count,serial_count);
+		matched = FALSE;
+	}
+	for(i=0;i<serial_count;i++)
+	{
+		serial = &(serial_list[i]);
+		found = FALSE;
+		for(j=0;(j<tiled_count)&&(found == FALSE);j++)
+		{
+			tiled = &(tiled_list[j]);
+			found = ((tiled->Pixel_Count == serial->Pixel_Count)&&
+				 (tiled->Is_Stellar == serial->Is_Stellar)&&
+				 (fabs(tiled->CCD_X_Position-serial->CCD_X_Position) < TILE_TEST_TOLERANCE)&&
+				 (fabs(tiled->CCD_Y_Position-serial->CCD_Y_Position) < TILE_TEST_TOLERANCE)&&
+				 Value_Is_Close(tiled->Total_Counts,serial->Total_Counts)&&
+				 Value_Is_Close(tiled->Peak_Counts,serial->Peak_Counts)&&
+				 Value_Is_Close(tiled->FWHM_X,serial->FWHM_X)&&
+				 Value_Is_Close(tiled->FWHM_Y,serial->FWHM_Y));
+		}
+		if(found == FALSE)
+		{
+			fprintf(stderr,"Object_List_Compare:%d tiles:no match for serial object %d at (%.3f,%.3f) "
+				"with %d pixels and %.1f counts.\n",tile_count,serial->Index,serial->CCD_X_Position,
+				serial->CCD_Y_Position,serial->Pixel_Count,serial->Total_Counts);
+			matched = FALSE;
+		}
+	}
+	return matched;
+}
+
+/**
+ * Return whether two values are the same to within TILE_TEST_TOLERANCE of their size (or absolutely,
+ * for values smaller than 1).
+ * @param value1 The first value.
+ * @param value2 The second value.
+ * @return TRUE if the values are close, FALSE if they are not.
+ * @see #TILE_TEST_TOLERANCE
+ */
+static int Value_Is_Close(double value1,double value2)
+{
+	double scale;
+
+	scale = fabs(value2);
+	if(scale < 1.0)
+		scale = 1.0;
+	return (fabs(value1-value2) <= (TILE_TEST_TOLERANCE*scale));
+}
+
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Help
+ * @see #Config_Filename
+ * @see #Frame_Size
+ * @see #Star_Count
+ * @see #Thread_Count
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-config_filename")==0)||(strcmp(argv[i],"-co")==0))
+		{
+			if((i+1)<argc)
+			{
+				Config_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:config filename required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if(strcmp(argv[i],"-size")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Frame_Size);
+				if((retval != 1)||(Frame_Size < 32))
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal frame size '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:size requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-stars")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Star_Count);
+				if((retval != 1)||(Star_Count < 0))
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal star count '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:stars requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-threads")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Thread_Count);
+				if((retval != 1)||(Thread_Count < 0))
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal thread count '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:threads requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Autoguider Object Tile Test:Help.\n");
+	fprintf(stdout,"Check tiled object detection finds the same objects as serial object detection.\n");
+	fprintf(stdout,"autoguider_object_tile_test -co[nfig_filename] <filename> [-threads <n>] [-size <pixels>]\n");
+	fprintf(stdout,"\t[-stars <n>]\n");
+	fprintf(stdout,"\n");
+	fprintf(stdout,"\t-config_filename is the autoguider config, for the object detection thresholds.\n");
+	fprintf(stdout,"\t-threads is the number of worker pool threads (default %d).\n",DEFAULT_THREAD_COUNT);
+	fprintf(stdout,"\t-size is the number of columns and rows in the frame (default %d).\n",DEFAULT_FRAME_SIZE);
+	fprintf(stdout,"\t-stars is the number of randomly placed stars (default %d).\n",DEFAULT_STAR_COUNT);
+	fprintf(stdout,"\n");
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
@@ -0,0 +1,1307 @@
+/* autoguider_reduce.c
+ * $Id$
+ * Offline batch reduction of archived autoguider FITS frames, using the autoguider dark, flat and object code.
+ */
+/**
+ * Offline batch reduction of archived autoguider FITS frames (as saved by getfits or the FITS writer).
+ * Each frame is reduced by the same routines the field and guide loops use, configured by the same autoguider
+ * properties file:
+ * <ul>
+ * <li>Raw frames (REDTYPE = 'RAW') are dark subtracted (Autoguider_Dark_Set/Autoguider_Dark_Subtract) and
+ *     flat fielded (Autoguider_Flat_Set/Autoguider_Flat_Field), if enabled by the field.* or guide.* properties.
+ *     Reduced frames are used as they are.
+ * <li>Objects are detected (Autoguider_Object_Detect), with the same start pixel the field (1,1) or guide
+ *     (window start) loop uses, so CCD positions match those logged at the telescope.
+ * <li>A guide object is selected (Autoguider_Object_Guide_Object_Get), as an autoguide on command would.
+ * </ul>
+ * The frame type, binning, window and exposure length are taken from the OBSTYPE, CCDXIMSI, CCDYIMSI, CCDXBIN,
+ * CCDYBIN, CCDWMODE, CCDWXOFF, CCDWYOFF, CCDWXSIZ, CCDWYSIZ, REDTYPE and EXPTIME keywords.
+ * <p>
+ * The dark, flat and object modules hold their state in process wide singletons, so frames are reduced in
+ * parallel by forking worker processes rather than threads. Frame i is reduced by worker (i % worker count).
+ * Each worker writes its results to part files, which are merged in input order when all the workers have
+ * finished, so the output does not depend on the number of workers. Cached calibration frames
+ * (calibration.cache.*) are mapped read only, so the workers share one copy of each dark and flat.
+ * <p>
+ * The output is written to files starting with the output prefix:
+ * <ul>
+ * <li>&lt;prefix&gt;_frames.csv - One line per frame: frame type, dimensions, calibrations applied, object count,
+ *     background statistics (median, mean, background standard deviation, threshold), the selected guide object
+ *     and whether the frame was reduced successfully.
+ * <li>&lt;prefix&gt;_objects.csv - One line per detected object (-format csv).
+ * <li>&lt;prefix&gt;.telemetry - (-format binary) A telemetry file (see autoguider_telemetry.h), containing one
+ *     guide frame record per frame describing the selected guide object, followed by that frame's object
+ *     records. The record Id is the frame's index in the input list. It can be read with
+ *     autoguider_telemetry_export.
+ * </ul>
+ * <pre>
+ * autoguider_reduce -co[nfig_filename] &lt;filename&gt; [-d[irectory] &lt;directory&gt;] [-l[ist] &lt;filename&gt;]
+ * 	[-f[ilename] &lt;filename&gt;] [-o[utput] &lt;prefix&gt;] [-format &lt;csv|binary&gt;] [-w[orkers] &lt;n&gt;]
+ * 	[-no_dark] [-no_flat] [-ag_on &lt;brightest|rank &lt;n&gt;|pixel &lt;x&gt; &lt;y&gt;&gt;]
+ * </pre>
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "fitsio.h"
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+#include "ccd_setup.h"
+
+#include "autoguider_calibration_cache.h"
+#include "autoguider_command.h"
+#include "autoguider_dark.h"
+#include "autoguider_flat.h"
+#include "autoguider_general.h"
+#include "autoguider_object.h"
+#include "autoguider_telemetry.h"
+
+/* hash defines */
+/**
+ * The maximum length of a FITS filename (including the directory).
+ */
+#define REDUCE_FILENAME_LENGTH      (256)
+/**
+ * The maximum length of a line in a CSV part file.
+ */
+#define REDUCE_LINE_LENGTH          (1024)
+/**
+ * The number of frames to allocate space for at a time in the frame list.
+ */
+#define REDUCE_FRAME_LIST_INCREMENT (1024)
+/**
+ * The output format value for CSV output.
+ */
+#define REDUCE_FORMAT_CSV           (0)
+/**
+ * The output format value for binary (telemetry file) output.
+ */
+#define REDUCE_FORMAT_BINARY        (1)
+
+/* data types */
+/**
+ * Structure holding a frame read from a FITS file, and how it was taken.
+ * <dl>
+ * <dt>Is_Guide</dt> <dd>Boolean, TRUE if the frame is a guide frame (OBSTYPE = 'GUIDE'), FALSE for a field.</dd>
+ * <dt>Is_Raw</dt> <dd>Boolean, TRUE if the frame is unreduced (REDTYPE = 'RAW').</dd>
+ * <dt>NAXIS1</dt> <dd>The number of columns in the frame data.</dd>
+ * <dt>NAXIS2</dt> <dd>The number of rows in the frame data.</dd>
+ * <dt>Binned_NCols</dt> <dd>The number of binned columns on the whole CCD (CCDXIMSI).</dd>
+ * <dt>Binned_NRows</dt> <dd>The number of binned rows on the whole CCD (CCDYIMSI).</dd>
+ * <dt>Bin_X</dt> <dd>The X binning (CCDXBIN).</dd>
+ * <dt>Bin_Y</dt> <dd>The Y binning (CCDYBIN).</dd>
+ * <dt>Exposure_Length</dt> <dd>The exposure length in milliseconds (EXPTIME).</dd>
+ * <dt>Use_Window</dt> <dd>Boolean, whether the frame is a window on the CCD (CCDWMODE).</dd>
+ * <dt>Window</dt> <dd>If Use_Window is TRUE, the window the frame was read out of (CCDWXOFF etc).</dd>
+ * <dt>Data</dt> <dd>The frame data, NAXIS1 x NAXIS2 floats.</dd>
+ * <dt>Data_Length</dt> <dd>The number of floats allocated for Data.</dd>
+ * </dl>
+ */
+struct Reduce_Frame_Struct
+{
+	int Is_Guide;
+	int Is_Raw;
+	int NAXIS1;
+	int NAXIS2;
+	int Binned_NCols;
+	int Binned_NRows;
+	int Bin_X;
+	int Bin_Y;
+	int Exposure_Length;
+	int Use_Window;
+	struct CCD_Setup_Window_Struct Window;
+	float *Data;
+	int Data_Length;
+};
+
+/* internal functions */
+static int Reduce_Worker(int worker_index);
+static int Reduce_Frame(int frame_index,struct Reduce_Frame_Struct *frame,FILE *frames_fp,FILE *objects_fp);
+static int Reduce_Frame_Calibrate(struct Reduce_Frame_Struct *frame,int *dark_subtracted,int *flat_fielded);
+static int Reduce_Frame_Read(char *filename,struct Reduce_Frame_Struct *frame);
+static void Reduce_Frame_Read_Int(fitsfile *fits_fp,char *keyword,int default_value,int *value);
+static int Reduce_Write_Objects(int frame_index,int object_count,int guide_index,
+				struct Reduce_Frame_Struct *frame,FILE *objects_fp);
+static int Reduce_Merge(void);
+static int Reduce_Merge_CSV(char *suffix,char *header,FILE *fp);
+static int Reduce_Merge_Binary(FILE *fp);
+static void Reduce_Part_Filename(int worker_index,char *suffix,char *filename);
+static int Frame_List_Add(char *filename);
+static int Frame_List_Add_Directory(char *directory);
+static int Frame_List_Add_List_File(char *list_filename);
+static int Frame_List_Compare(const void *p1,const void *p2);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The autoguider config filename to load.
+ */
+static char *Config_Filename = NULL;
+/**
+ * The list of FITS filenames to reduce, in the order they are reported.
+ */
+static char **Frame_List = NULL;
+/**
+ * The number of filenames in Frame_List.
+ */
+static int Frame_Count = 0;
+/**
+ * The number of filenames Frame_List has space for.
+ * @see #REDUCE_FRAME_LIST_INCREMENT
+ */
+static int Frame_List_Allocated_Count = 0;
+/**
+ * The output filename prefix.
+ */
+static char *Output_Prefix = "autoguider_reduce";
+/**
+ * The output format for objects and guide object selections.
+ * @see #REDUCE_FORMAT_CSV
+ * @see #REDUCE_FORMAT_BINARY
+ */
+static int Output_Format = REDUCE_FORMAT_CSV;
+/**
+ * The number of worker processes. Zero means use one per online CPU.
+ */
+static int Worker_Count = 0;
+/**
+ * Boolean, if TRUE don't dark subtract raw frames, whatever the field/guide.dark_subtract properties say.
+ */
+static int No_Dark = FALSE;
+/**
+ * Boolean, if TRUE don't flat field raw frames, whatever the field/guide.flat_field properties say.
+ */
+static int No_Flat = FALSE;
+/**
+ * How to select the guide object in each frame.
+ */
+static enum COMMAND_AG_ON_TYPE AG_On_Type = COMMAND_AG_ON_TYPE_BRIGHTEST;
+/**
+ * If AG_On_Type is COMMAND_AG_ON_TYPE_RANK, the rank of the guide object to select.
+ */
+static int AG_On_Rank = 1;
+/**
+ * If AG_On_Type is COMMAND_AG_ON_TYPE_PIXEL, the x pixel position to select the guide object nearest to.
+ */
+static float AG_On_Pixel_X = 0.0f;
+/**
+ * If AG_On_Type is COMMAND_AG_ON_TYPE_PIXEL, the y pixel position to select the guide object nearest to.
+ */
+static float AG_On_Pixel_Y = 0.0f;
+/**
+ * Booleans, the field.dark_subtract, field.flat_field, guide.dark_subtract and guide.flat_field properties.
+ */
+static int Field_Dark_Subtract,Field_Flat_Field,Guide_Dark_Subtract,Guide_Flat_Field;
+/**
+ * The unbinned dimensions and binning the dark and flat buffers were last sized for, so they are only
+ * resized (and their calibration frames reloaded) when the frame geometry changes.
+ */
+static int Calibration_NCols = -1,Calibration_NRows = -1,Calibration_Bin_X = -1,Calibration_Bin_Y = -1;
+
+/**
+ * Main program.
+ * <ul>
+ * <li>The arguments are parsed, and the frame list sorted if it came from a directory.
+ * <li>The config is loaded, and the calibration cache, dark, flat and object modules initialised.
+ * <li>The worker processes are forked, and each reduces its share of the frames (Reduce_Worker).
+ * <li>When they have all exited, the part files they wrote are merged (Reduce_Merge).
+ * </ul>
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The program returns 0 on success, and non-zero on failure.
+ * @see #Parse_Arguments
+ * @see #Reduce_Worker
+ * @see #Reduce_Merge
+ * @see autoguider_calibration_cache.html#Autoguider_Calibration_Cache_Initialise
+ * @see autoguider_dark.html#Autoguider_Dark_Initialise
+ * @see autoguider_flat.html#Autoguider_Flat_Initialise
+ * @see autoguider_object.html#Autoguider_Object_Initialise
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Load
+ */
+int main(int argc, char *argv[])
+{
+	char error_string[AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH];
+	struct timespec start_time,end_time;
+	pid_t *pid_list = NULL;
+	pid_t pid;
+	int i,status,failed_worker_count;
+
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(Config_Filename == NULL)
+	{
+		fprintf(stderr,"autoguider_reduce:-config_filename must be specified.\n");
+		return 1;
+	}
+	if(Frame_Count < 1)
+	{
+		fprintf(stderr,"autoguider_reduce:No FITS frames to reduce.\n");
+		return 1;
+	}
+	if(Worker_Count < 1)
+		Worker_Count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if(Worker_Count < 1)
+		Worker_Count = 1;
+	if(Worker_Count > Frame_Count)
+		Worker_Count = Frame_Count;
+	/* initialise the reduction modules once, the workers inherit them */
+	CCD_Config_Initialise();
+	if(!CCD_Config_Load(Config_Filename))
+	{
+		fprintf(stderr,"autoguider_reduce:CCD_Config_Load(%s) failed.\n",Config_Filename);
+		return 2;
+	}
+	if((!CCD_Config_Get_Boolean("field.dark_subtract",&Field_Dark_Subtract))||
+	   (!CCD_Config_Get_Boolean("field.flat_field",&Field_Flat_Field))||
+	   (!CCD_Config_Get_Boolean("guide.dark_subtract",&Guide_Dark_Subtract))||
+	   (!CCD_Config_Get_Boolean("guide.flat_field",&Guide_Flat_Field)))
+	{
+		fprintf(stderr,"autoguider_reduce:Failed to get field/guide dark_subtract/flat_field from '%s'.\n",
+			Config_Filename);
+		return 2;
+	}
+	if((!Autoguider_Calibration_Cache_Initialise())||(!Autoguider_Dark_Initialise())||
+	   (!Autoguider_Flat_Initialise())||(!Autoguider_Object_Initialise()))
+	{
+		Autoguider_General_Error_To_String("reduce","autoguider_reduce.c","main",
+						   LOG_VERBOSITY_VERY_TERSE,"REDUCE",error_string);
+		fprintf(stderr,"autoguider_reduce:%s\n",error_string);
+		return 2;
+	}
+	fprintf(stdout,"autoguider_reduce:Reducing %d frames with %d workers.\n",Frame_Count,Worker_Count);
+	fflush(stdout);
+	fflush(stderr);
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	pid_list = (pid_t *)malloc(Worker_Count*sizeof(pid_t));
+	if(pid_list == NULL)
+	{
+		fprintf(stderr,"autoguider_reduce:Failed to allocate pid list (%d).\n",Worker_Count);
+		return 3;
+	}
+	for(i=0;i<Worker_Count;i++)
+	{
+		pid = fork();
+		if(pid < 0)
+		{
+			fprintf(stderr,"autoguider_reduce:fork failed (%d).\n",errno);
+			return 3;
+		}
+		if(pid == 0)
+		{
+			/* don't call exit, the parent still owns any stdio buffers copied by fork */
+			fflush(stdout);
+			_exit(Reduce_Worker(i) ? 0 : 4);
+		}
+		pid_list[i] = pid;
+	}
+	failed_worker_count = 0;
+	for(i=0;i<Worker_Count;i++)
+	{
+		if(waitpid(pid_list[i],&status,0) < 0)
+		{
+			fprintf(stderr,"autoguider_reduce:waitpid(%d) failed (%d).\n",(int)pid_list[i],errno);
+			failed_worker_count++;
+		}
+		else if((!WIFEXITED(status))||(WEXITSTATUS(status) != 0))
+		{
+			fprintf(stderr,"autoguider_reduce:Worker %d failed (status %d).\n",i,status);
+			failed_worker_count++;
+		}
+	}
+	free(pid_list);
+	if(failed_worker_count > 0)
+		return 4;
+	if(!Reduce_Merge())
+		return 5;
+	clock_gettime(CLOCK_MONOTONIC,&end_time);
+	fprintf(stdout,"autoguider_reduce:Reduced %d frames in %.3f s.\n",Frame_Count,
+		fdifftime(end_time,start_time));
+	Autoguider_Object_Shutdown();
+	Autoguider_Flat_Shutdown();
+	Autoguider_Dark_Shutdown();
+	Autoguider_Calibration_Cache_Shutdown();
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * The body of a worker process. Reduces every frame whose index modulo Worker_Count is worker_index,
+ * in order, writing the results to this worker's frames and objects part files. A frame that fails to reduce
+ * is reported on stderr and recorded as failed in the frames part file, it does not stop the worker.
+ * @param worker_index The index of this worker, from 0 to Worker_Count-1.
+ * @return The routine returns TRUE on success and FALSE if the part files could not be written.
+ * @see #Reduce_Frame
+ * @see #Reduce_Part_Filename
+ */
+static int Reduce_Worker(int worker_index)
+{
+	struct Reduce_Frame_Struct frame;
+	char filename[REDUCE_FILENAME_LENGTH];
+	char error_string[AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH];
+	FILE *frames_fp = NULL;
+	FILE *objects_fp = NULL;
+	int i,retval;
+
+	Reduce_Part_Filename(worker_index,"frames",filename);
+	frames_fp = fopen(filename,"w");
+	if(frames_fp == NULL)
+	{
+		fprintf(stderr,"Reduce_Worker:Failed to open '%s'.\n",filename);
+		return FALSE;
+	}
+	Reduce_Part_Filename(worker_index,"objects",filename);
+	objects_fp = fopen(filename,"w");
+	if(objects_fp == NULL)
+	{
+		fclose(frames_fp);
+		fprintf(stderr,"Reduce_Worker:Failed to open '%s'.\n",filename);
+		return FALSE;
+	}
+	frame.Data = NULL;
+	frame.Data_Length = 0;
+	for(i=worker_index;i<Frame_Count;i+=Worker_Count)
+	{
+		if(!Reduce_Frame(i,&frame,frames_fp,objects_fp))
+		{
+			Autoguider_General_Error_To_String("reduce","autoguider_reduce.c","Reduce_Worker",
+							   LOG_VERBOSITY_VERY_TERSE,"REDUCE",error_string);
+			fprintf(stderr,"autoguider_reduce:%s:%s\n",Frame_List[i],error_string);
+		}
+	}
+	if(frame.Data != NULL)
+		free(frame.Data);
+	retval = (fclose(objects_fp) == 0);
+	if(fclose(frames_fp) != 0)
+		retval = FALSE;
+	if(retval == FALSE)
+	{
+		fprintf(stderr,"Reduce_Worker:Failed to close part files for worker %d.\n",worker_index);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Reduce one frame, and write the results. The frame line is always written, with status FAILED if the
+ * frame could not be reduced.
+ * @param frame_index The index of the frame in Frame_List.
+ * @param frame A frame structure, whose data buffer is reused from frame to frame.
+ * @param frames_fp The frames part file to write the frame line to.
+ * @param objects_fp The objects part file to write the objects (and in binary format, the guide frame record) to.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Reduce_Frame_Read
+ * @see #Reduce_Frame_Calibrate
+ * @see #Reduce_Write_Objects
+ * @see autoguider_object.html#Autoguider_Object_Detect
+ * @see autoguider_object.html#Autoguider_Object_Guide_Object_Get
+ */
+static int Reduce_Frame(int frame_index,struct Reduce_Frame_Struct *frame,FILE *frames_fp,FILE *objects_fp)
+{
+	struct Autoguider_Object_Struct object;
+	int dark_subtracted,flat_fielded,object_count,guide_index,retval;
+
+	dark_subtracted = FALSE;
+	flat_fielded = FALSE;
+	object_count = 0;
+	guide_index = -1;
+	object.CCD_X_Position = 0.0f;
+	object.CCD_Y_Position = 0.0f;
+	retval = Reduce_Frame_Read(Frame_List[frame_index],frame);
+	if(retval)
+		retval = Reduce_Frame_Calibrate(frame,&dark_subtracted,&flat_fielded);
+	if(retval)
+	{
+		/* start pixels as used by Field_Reduce and Guide_Reduce */
+		if(frame->Is_Guide)
+		{
+			retval = Autoguider_Object_Detect(frame->Data,frame->NAXIS1,frame->NAXIS2,
+							  frame->Window.X_Start,frame->Window.Y_Start,TRUE,
+							  frame_index,0);
+		}
+		else
+			retval = Autoguider_Object_Detect(frame->Data,frame->NAXIS1,frame->NAXIS2,1,1,TRUE,frame_index,0);
+	}
+	if(retval)
+		retval = Autoguider_Object_List_Get_Count(&object_count);
+	if(retval && (object_count > 0))
+	{
+		/* no suitable guide object is not a reduction failure */
+		if(Autoguider_Object_Guide_Object_Get(AG_On_Type,AG_On_Pixel_X,AG_On_Pixel_Y,AG_On_Rank,&guide_index))
+		{
+			if((guide_index >= 0)&&(!Autoguider_Object_List_Get_Object(guide_index,&object)))
+				guide_index = -1;
+		}
+		else
+			guide_index = -1;
+	}
+	if(retval)
+		retval = Reduce_Write_Objects(frame_index,object_count,guide_index,frame,objects_fp);
+	fprintf(frames_fp,"%d,%s,%s,%s,%d,%d,%d,%d,%d,%s,%s,%d,%.3f,%.3f,%.3f,%.3f,%d,%.3f,%.3f,%s\n",
+		frame_index,Frame_List[frame_index],frame->Is_Guide ? "GUIDE" : "FIELD",
+		frame->Is_Raw ? "RAW" : "REDUCED",frame->NAXIS1,frame->NAXIS2,frame->Bin_X,frame->Bin_Y,
+		frame->Exposure_Length,dark_subtracted ? "true" : "false",flat_fielded ? "true" : "false",
+		object_count,retval ? Autoguider_Object_Median_Get() : 0.0f,
+		retval ? Autoguider_Object_Mean_Get() : 0.0f,
+		retval ? Autoguider_Object_Background_Standard_Deviation_Get() : 0.0f,
+		retval ? Autoguider_Object_Threshold_Get() : 0.0f,guide_index,
+		(guide_index >= 0) ? object.CCD_X_Position : 0.0f,(guide_index >= 0) ? object.CCD_Y_Position : 0.0f,
+		retval ? "OK" : "FAILED");
+	return retval;
+}
+
+/**
+ * Dark subtract and flat field a raw frame, if the field/guide properties (and the -no_dark/-no_flat
+ * arguments) allow it. The dark and flat buffers are only resized when the frame's CCD geometry changes,
+ * and Autoguider_Dark_Set/Autoguider_Flat_Set only reload when the binning/exposure length changes,
+ * so runs of similar frames reuse the loaded calibrations. Reduced frames are left alone.
+ * @param frame The frame to calibrate.
+ * @param dark_subtracted The address of an integer, set to TRUE if the frame was dark subtracted.
+ * @param flat_fielded The address of an integer, set to TRUE if the frame was flat fielded.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Calibration_NCols
+ * @see autoguider_dark.html#Autoguider_Dark_Set_Dimension
+ * @see autoguider_dark.html#Autoguider_Dark_Set
+ * @see autoguider_dark.html#Autoguider_Dark_Subtract
+ * @see autoguider_flat.html#Autoguider_Flat_Set_Dimension
+ * @see autoguider_flat.html#Autoguider_Flat_Set
+ * @see autoguider_flat.html#Autoguider_Flat_Field
+ */
+static int Reduce_Frame_Calibrate(struct Reduce_Frame_Struct *frame,int *dark_subtracted,int *flat_fielded)
+{
+	int ncols,nrows,do_dark,do_flat;
+
+	(*dark_subtracted) = FALSE;
+	(*flat_fielded) = FALSE;
+	if(!frame->Is_Raw)
+		return TRUE;
+	if(frame->Is_Guide)
+	{
+		do_dark = Guide_Dark_Subtract && (!No_Dark);
+		do_flat = Guide_Flat_Field && (!No_Flat);
+	}
+	else
+	{
+		do_dark = Field_Dark_Subtract && (!No_Dark);
+		do_flat = Field_Flat_Field && (!No_Flat);
+	}
+	if((!do_dark)&&(!do_flat))
+		return TRUE;
+	ncols = frame->Binned_NCols*frame->Bin_X;
+	nrows = frame->Binned_NRows*frame->Bin_Y;
+	if((ncols != Calibration_NCols)||(nrows != Calibration_NRows)||(frame->Bin_X != Calibration_Bin_X)||
+	   (frame->Bin_Y != Calibration_Bin_Y))
+	{
+		if(!Autoguider_Dark_Set_Dimension(ncols,nrows,frame->Bin_X,frame->Bin_Y))
+			return FALSE;
+		if(!Autoguider_Flat_Set_Dimension(ncols,nrows,frame->Bin_X,frame->Bin_Y))
+			return FALSE;
+		Calibration_NCols = ncols;
+		Calibration_NRows = nrows;
+		Calibration_Bin_X = frame->Bin_X;
+		Calibration_Bin_Y = frame->Bin_Y;
+	}
+	if(do_dark)
+	{
+		if(!Autoguider_Dark_Set(frame->Bin_X,frame->Bin_Y,frame->Exposure_Length))
+			return FALSE;
+		if(!Autoguider_Dark_Subtract(frame->Data,frame->NAXIS1*frame->NAXIS2,frame->Binned_NCols,
+					     frame->Binned_NRows,frame->Use_Window,frame->Window))
+			return FALSE;
+		(*dark_subtracted) = TRUE;
+	}
+	if(do_flat)
+	{
+		if(!Autoguider_Flat_Set(frame->Bin_X,frame->Bin_Y))
+			return FALSE;
+		if(!Autoguider_Flat_Field(frame->Data,frame->NAXIS1*frame->NAXIS2,frame->Binned_NCols,
+					  frame->Binned_NRows,frame->Use_Window,frame->Window))
+			return FALSE;
+		(*flat_fielded) = TRUE;
+	}
+	return TRUE;
+}
+
+/**
+ * Read a FITS frame, and the keywords describing how it was taken. Missing keywords default to
+ * an unwindowed, unbinned, raw field frame the size of the data.
+ * @param filename The FITS filename.
+ * @param frame The frame structure to fill in. The data buffer is reallocated if it is too small.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Reduce_Frame_Read_Int
+ */
+static int Reduce_Frame_Read(char *filename,struct Reduce_Frame_Struct *frame)
+{
+	fitsfile *fits_fp = NULL;
+	char cfitsio_error_buff[32]; /* fits_get_errstatus returns 30 chars max */
+	char value_string[FLEN_VALUE];
+	double exptime;
+	int cfitsio_status = 0;
+	int naxis,pixel_count;
+
+	frame->Is_Guide = FALSE;
+	frame->Is_Raw = TRUE;
+	frame->NAXIS1 = 0;
+	frame->NAXIS2 = 0;
+	frame->Bin_X = 1;
+	frame->Bin_Y = 1;
+	frame->Exposure_Length = 0;
+	frame->Use_Window = FALSE;
+	if(fits_open_file(&fits_fp,filename,READONLY,&cfitsio_status))
+	{
+		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+		Autoguider_General_Error_Number = 2000;
+		sprintf(Autoguider_General_Error_String,"Reduce_Frame_Read:fits_open_file(%s) failed(%d) : %s.",
+			filename,cfitsio_status,cfitsio_error_buff);
+		return FALSE;
+	}
+	fits_read_key(fits_fp,TINT,"NAXIS",&naxis,NULL,&cfitsio_status);
+	fits_read_key(fits_fp,TINT,"NAXIS1",&(frame->NAXIS1),NULL,&cfitsio_status);
+	fits_read_key(fits_fp,TINT,"NAXIS2",&(frame->NAXIS2),NULL,&cfitsio_status);
+	if(cfitsio_status || (naxis != 2)||(frame->NAXIS1 < 1)||(frame->NAXIS2 < 1))
+	{
+		fits_close_file(fits_fp,&cfitsio_status);
+		Autoguider_General_Error_Number = 2001;
+		sprintf(Autoguider_General_Error_String,"Reduce_Frame_Read:%s is not a 2D image.",filename);
+		return FALSE;
+	}
+	if(fits_read_key(fits_fp,TSTRING,"OBSTYPE",value_string,NULL,&cfitsio_status) == 0)
+		frame->Is_Guide = (strcmp(value_string,"GUIDE") == 0);
+	cfitsio_status = 0;
+	if(fits_read_key(fits_fp,TSTRING,"REDTYPE",value_string,NULL,&cfitsio_status) == 0)
+		frame->Is_Raw = (strcmp(value_string,"RAW") == 0);
+	cfitsio_status = 0;
+	if(fits_read_key(fits_fp,TLOGICAL,"CCDWMODE",&(frame->Use_Window),NULL,&cfitsio_status) != 0)
+		frame->Use_Window = FALSE;
+	cfitsio_status = 0;
+	if(fits_read_key(fits_fp,TDOUBLE,"EXPTIME",&exptime,NULL,&cfitsio_status) == 0)
+		frame->Exposure_Length = (int)((exptime*AUTOGUIDER_GENERAL_ONE_SECOND_MS)+0.5);
+	cfitsio_status = 0;
+	Reduce_Frame_Read_Int(fits_fp,"CCDXBIN",1,&(frame->Bin_X));
+	Reduce_Frame_Read_Int(fits_fp,"CCDYBIN",1,&(frame->Bin_Y));
+	Reduce_Frame_Read_Int(fits_fp,"CCDXIMSI",frame->NAXIS1,&(frame->Binned_NCols));
+	Reduce_Frame_Read_Int(fits_fp,"CCDYIMSI",frame->NAXIS2,&(frame->Binned_NRows));
+	if((frame->Bin_X < 1)||(frame->Bin_Y < 1))
+	{
+		fits_close_file(fits_fp,&cfitsio_status);
+		Autoguider_General_Error_Number = 2002;
+		sprintf(Autoguider_General_Error_String,"Reduce_Frame_Read:%s has illegal binning (%d,%d).",
+			filename,frame->Bin_X,frame->Bin_Y);
+		return FALSE;
+	}
+	/* guide frames are always windowed, the window is the guide window */
+	if(frame->Is_Guide)
+		frame->Use_Window = TRUE;
+	if(frame->Use_Window)
+	{
+		Reduce_Frame_Read_Int(fits_fp,"CCDWXOFF",0,&(frame->Window.X_Start));
+		Reduce_Frame_Read_Int(fits_fp,"CCDWYOFF",0,&(frame->Window.Y_Start));
+		frame->Window.X_End = frame->Window.X_Start+frame->NAXIS1-1;
+		frame->Window.Y_End = frame->Window.Y_Start+frame->NAXIS2-1;
+	}
+	else
+	{
+		frame->Window.X_Start = 0;
+		frame->Window.Y_Start = 0;
+		frame->Window.X_End = 0;
+		frame->Window.Y_End = 0;
+	}
+	pixel_count = frame->NAXIS1*frame->NAXIS2;
+	if(pixel_count > frame->Data_Length)
+	{
+		if(frame->Data == NULL)
+			frame->Data = (float *)malloc(pixel_count*sizeof(float));
+		else
+			frame->Data = (float *)realloc(frame->Data,pixel_count*sizeof(float));
+		if(frame->Data == NULL)
+		{
+			frame->Data_Length = 0;
+			fits_close_file(fits_fp,&cfitsio_status);
+			Autoguider_General_Error_Number = 2003;
+			sprintf(Autoguider_General_Error_String,"Reduce_Frame_Read:"
+				"Failed to allocate data for %s (%d,%d).",filename,frame->NAXIS1,frame->NAXIS2);
+			return FALSE;
+		}
+		frame->Data_Length = pixel_count;
+	}
+	if(fits_read_img(fits_fp,TFLOAT,1,pixel_count,NULL,frame->Data,NULL,&cfitsio_status))
+	{
+		fits_get_errstatus(cfitsio_status,cfitsio_error_buff);
+		cfitsio_status = 0;
+		fits_close_file(fits_fp,&cfitsio_status);
+		Autoguider_General_Error_Number = 2004;
+		sprintf(Autoguider_General_Error_String,"Reduce_Frame_Read:fits_read_img(%s) failed : %s.",
+			filename,cfitsio_error_buff);
+		return FALSE;
+	}
+	fits_close_file(fits_fp,&cfitsio_status);
+	return TRUE;
+}
+
+/**
+ * Read an integer keyword from a FITS file, using a default value if it is missing.
+ * @param fits_fp The open FITS file.
+ * @param keyword The keyword to read.
+ * @param default_value The value to use if the keyword is missing or not an integer.
+ * @param value The address of an integer to store the value.
+ */
+static void Reduce_Frame_Read_Int(fitsfile *fits_fp,char *keyword,int default_value,int *value)
+{
+	int cfitsio_status = 0;
+
+	if(fits_read_key(fits_fp,TINT,keyword,value,NULL,&cfitsio_status) != 0)
+		(*value) = default_value;
+}
+
+/**
+ * Write the detected object list for a frame to the objects part file. In binary format a guide frame
+ * telemetry record describing the selected guide object is written first, followed by an object telemetry
+ * record per object.
+ * @param frame_index The index of the frame in Frame_List.
+ * @param object_count The number of detected objects.
+ * @param guide_index The index of the selected guide object, or -1 if none was selected.
+ * @param frame The frame.
+ * @param objects_fp The objects part file.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Output_Format
+ * @see autoguider_object.html#Autoguider_Object_List_Get_Object
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Record_Struct
+ */
+static int Reduce_Write_Objects(int frame_index,int object_count,int guide_index,
+				struct Reduce_Frame_Struct *frame,FILE *objects_fp)
+{
+	struct Autoguider_Telemetry_Record_Struct record;
+	struct Autoguider_Object_Struct object;
+	int i;
+
+	if(Output_Format == REDUCE_FORMAT_BINARY)
+	{
+		memset(&record,0,sizeof(struct Autoguider_Telemetry_Record_Struct));
+		record.Type = AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME;
+		record.Id = frame_index;
+		record.Index = guide_index;
+		record.Object_Count = object_count;
+		record.Exposure_Length = frame->Exposure_Length;
+		if(guide_index >= 0)
+		{
+			if(!Autoguider_Object_List_Get_Object(guide_index,&object))
+				return FALSE;
+			record.Pixel_Count = object.Pixel_Count;
+			record.Is_Stellar = object.Is_Stellar;
+			record.CCD_X_Position = object.CCD_X_Position;
+			record.CCD_Y_Position = object.CCD_Y_Position;
+			record.Buffer_X_Position = object.Buffer_X_Position;
+			record.Buffer_Y_Position = object.Buffer_Y_Position;
+			record.Total_Counts = object.Total_Counts;
+			record.Peak_Counts = object.Peak_Counts;
+			record.FWHM_X = object.FWHM_X;
+			record.FWHM_Y = object.FWHM_Y;
+		}
+		if(fwrite(&record,sizeof(struct Autoguider_Telemetry_Record_Struct),1,objects_fp) != 1)
+			return FALSE;
+	}
+	for(i=0;i<object_count;i++)
+	{
+		if(!Autoguider_Object_List_Get_Object(i,&object))
+			return FALSE;
+		if(Output_Format == REDUCE_FORMAT_BINARY)
+		{
+			memset(&record,0,sizeof(struct Autoguider_Telemetry_Record_Struct));
+			record.Type = AUTOGUIDER_TELEMETRY_RECORD_OBJECT;
+			record.Id = frame_index;
+			record.Index = object.Index;
+			record.Pixel_Count = object.Pixel_Count;
+			record.Is_Stellar = object.Is_Stellar;
+			record.CCD_X_Position = object.CCD_X_Position;
+			record.CCD_Y_Position = object.CCD_Y_Position;
+			record.Buffer_X_Position = object.Buffer_X_Position;
+			record.Buffer_Y_Position = object.Buffer_Y_Position;
+			record.Total_Counts = object.Total_Counts;
+			record.Peak_Counts = object.Peak_Counts;
+			record.FWHM_X = object.FWHM_X;
+			record.FWHM_Y = object.FWHM_Y;
+			if(fwrite(&record,sizeof(struct Autoguider_Telemetry_Record_Struct),1,objects_fp) != 1)
+				return FALSE;
+		}
+		else
+		{
+			fprintf(objects_fp,"%d,%s,%d,%.3f,%.3f,%.3f,%.3f,%.2f,%d,%.2f,%s,%.3f,%.3f\n",frame_index,
+				Frame_List[frame_index],object.Index,object.CCD_X_Position,object.CCD_Y_Position,
+				object.Buffer_X_Position,object.Buffer_Y_Position,object.Total_Counts,
+				object.Pixel_Count,object.Peak_Counts,object.Is_Stellar ? "true" : "false",
+				object.FWHM_X,object.FWHM_Y);
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Merge the worker part files into the output files, in frame order, and delete the part files.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Reduce_Merge_CSV
+ * @see #Reduce_Merge_Binary
+ * @see #Output_Prefix
+ */
+static int Reduce_Merge(void)
+{
+	struct Autoguider_Telemetry_File_Header_Struct header;
+	char filename[REDUCE_FILENAME_LENGTH];
+	FILE *fp = NULL;
+	int retval,i;
+
+	sprintf(filename,"%s_frames.csv",Output_Prefix);
+	fp = fopen(filename,"w");
+	if(fp == NULL)
+	{
+		fprintf(stderr,"Reduce_Merge:Failed to open '%s'.\n",filename);
+		return FALSE;
+	}
+	retval = Reduce_Merge_CSV("frames","frame,filename,obstype,redtype,naxis1,naxis2,bin_x,bin_y,"
+				  "exposure_length,dark_subtracted,flat_fielded,object_count,median,mean,"
+				  "background_sd,threshold,guide_index,guide_ccd_x,guide_ccd_y,status",fp);
+	if((fclose(fp) != 0)||(!retval))
+		return FALSE;
+	if(Output_Format == REDUCE_FORMAT_BINARY)
+	{
+		sprintf(filename,"%s.telemetry",Output_Prefix);
+		fp = fopen(filename,"w");
+		if(fp == NULL)
+		{
+			fprintf(stderr,"Reduce_Merge:Failed to open '%s'.\n",filename);
+			return FALSE;
+		}
+		header.Magic = AUTOGUIDER_TELEMETRY_MAGIC;
+		header.Version = AUTOGUIDER_TELEMETRY_VERSION;
+		header.Header_Length = sizeof(struct Autoguider_Telemetry_File_Header_Struct);
+		header.Record_Length = sizeof(struct Autoguider_Telemetry_Record_Struct);
+		retval = (fwrite(&header,sizeof(struct Autoguider_Telemetry_File_Header_Struct),1,fp) == 1);
+		if(retval)
+			retval = Reduce_Merge_Binary(fp);
+	}
+	else
+	{
+		sprintf(filename,"%s_objects.csv",Output_Prefix);
+		fp = fopen(filename,"w");
+		if(fp == NULL)
+		{
+			fprintf(stderr,"Reduce_Merge:Failed to open '%s'.\n",filename);
+			return FALSE;
+		}
+		retval = Reduce_Merge_CSV("objects","frame,filename,index,ccd_x,ccd_y,buffer_x,buffer_y,total_counts,"
+					  "pixel_count,peak_counts,is_stellar,fwhm_x,fwhm_y",fp);
+	}
+	if((fclose(fp) != 0)||(!retval))
+		return FALSE;
+	for(i=0;i<Worker_Count;i++)
+	{
+		Reduce_Part_Filename(i,"frames",filename);
+		remove(filename);
+		Reduce_Part_Filename(i,"objects",filename);
+		remove(filename);
+	}
+	return TRUE;
+}
+
+/**
+ * Merge one kind of CSV part file into an output file. Every part file line starts with the frame index,
+ * and each worker wrote its frames in increasing order, so frame i's lines are the next lines in
+ * worker (i % Worker_Count)'s part file whose index is i.
+ * @param suffix The part file suffix, "frames" or "objects".
+ * @param header The CSV header line to write first.
+ * @param fp The output file.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Reduce_Part_Filename
+ */
+static int Reduce_Merge_CSV(char *suffix,char *header,FILE *fp)
+{
+	char filename[REDUCE_FILENAME_LENGTH];
+	FILE **part_fp_list = NULL;
+	char (*line_list)[REDUCE_LINE_LENGTH] = NULL;
+	int *have_line_list = NULL;
+	int i,w,line_frame_index,retval;
+
+	part_fp_list = (FILE **)calloc(Worker_Count,sizeof(FILE *));
+	line_list = (char (*)[REDUCE_LINE_LENGTH])malloc(Worker_Count*REDUCE_LINE_LENGTH);
+	have_line_list = (int *)calloc(Worker_Count,sizeof(int));
+	if((part_fp_list == NULL)||(line_list == NULL)||(have_line_list == NULL))
+	{
+		fprintf(stderr,"Reduce_Merge_CSV:Failed to allocate merge state for %d workers.\n",Worker_Count);
+		return FALSE;
+	}
+	retval = TRUE;
+	for(w=0;w<Worker_Count;w++)
+	{
+		Reduce_Part_Filename(w,suffix,filename);
+		part_fp_list[w] = fopen(filename,"r");
+		if(part_fp_list[w] == NULL)
+		{
+			fprintf(stderr,"Reduce_Merge_CSV:Failed to open '%s'.\n",filename);
+			retval = FALSE;
+		}
+		else
+			have_line_list[w] = (fgets(line_list[w],REDUCE_LINE_LENGTH,part_fp_list[w]) != NULL);
+	}
+	if(retval)
+	{
+		fprintf(fp,"%s\n",header);
+		for(i=0;i<Frame_Count;i++)
+		{
+			w = i%Worker_Count;
+			while(have_line_list[w] && (sscanf(line_list[w],"%d",&line_frame_index) == 1)&&
+			      (line_frame_index == i))
+			{
+				fputs(line_list[w],fp);
+				have_line_list[w] = (fgets(line_list[w],REDUCE_LINE_LENGTH,part_fp_list[w]) != NULL);
+			}
+		}
+	}
+	for(w=0;w<Worker_Count;w++)
+	{
+		if(part_fp_list[w] != NULL)
+			fclose(part_fp_list[w]);
+	}
+	free(part_fp_list);
+	free(line_list);
+	free(have_line_list);
+	return retval;
+}
+
+/**
+ * Merge the binary (telemetry record) objects part files into the output telemetry file, in frame order.
+ * Each record's Id is its frame index, see Reduce_Merge_CSV.
+ * @param fp The output file, with the telemetry file header already written.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Reduce_Part_Filename
+ * @see autoguider_telemetry.html#Autoguider_Telemetry_Record_Struct
+ */
+static int Reduce_Merge_Binary(FILE *fp)
+{
+	char filename[REDUCE_FILENAME_LENGTH];
+	FILE **part_fp_list = NULL;
+	struct Autoguider_Telemetry_Record_Struct *record_list = NULL;
+	int *have_record_list = NULL;
+	int i,w,retval;
+
+	part_fp_list = (FILE **)calloc(Worker_Count,sizeof(FILE *));
+	record_list = (struct Autoguider_Telemetry_Record_Struct *)malloc(Worker_Count*
+							sizeof(struct Autoguider_Telemetry_Record_Struct));
+	have_record_list = (int *)calloc(Worker_Count,sizeof(int));
+	if((part_fp_list == NULL)||(record_list == NULL)||(have_record_list == NULL))
+	{
+		fprintf(stderr,"Reduce_Merge_Binary:Failed to allocate merge state for %d workers.\n",Worker_Count);
+		return FALSE;
+	}
+	retval = TRUE;
+	for(w=0;w<Worker_Count;w++)
+	{
+		Reduce_Part_Filename(w,"objects",filename);
+		part_fp_list[w] = fopen(filename,"r");
+		if(part_fp_list[w] == NULL)
+		{
+			fprintf(stderr,"Reduce_Merge_Binary:Failed to open '%s'.\n",filename);
+			retval = FALSE;
+		}
+		else
+		{
+			have_record_list[w] = (fread(&(record_list[w]),sizeof(struct Autoguider_Telemetry_Record_Struct),
+						     1,part_fp_list[w]) == 1);
+		}
+	}
+	for(i=0;retval && (i<Frame_Count);i++)
+	{
+		w = i%Worker_Count;
+		while(have_record_list[w] && (record_list[w].Id == i))
+		{
+			if(fwrite(&(record_list[w]),sizeof(struct Autoguider_Telemetry_Record_Struct),1,fp) != 1)
+			{
+				fprintf(stderr,"Reduce_Merge_Binary:Failed to write record.\n");
+				retval = FALSE;
+				break;
+			}
+			have_record_list[w] = (fread(&(record_list[w]),sizeof(struct Autoguider_Telemetry_Record_Struct),
+						     1,part_fp_list[w]) == 1);
+		}
+	}
+	for(w=0;w<Worker_Count;w++)
+	{
+		if(part_fp_list[w] != NULL)
+			fclose(part_fp_list[w]);
+	}
+	free(part_fp_list);
+	free(record_list);
+	free(have_record_list);
+	return retval;
+}
+
+/**
+ * Create the filename of a worker's part file.
+ * @param worker_index The index of the worker.
+ * @param suffix The part file suffix, "frames" or "objects".
+ * @param filename A string of at least REDUCE_FILENAME_LENGTH characters to store the filename.
+ * @see #Output_Prefix
+ */
+static void Reduce_Part_Filename(int worker_index,char *suffix,char *filename)
+{
+	sprintf(filename,"%s.%d.%s.part",Output_Prefix,worker_index,suffix);
+}
+
+/**
+ * Add a filename to the end of the frame list.
+ * @param filename The filename to add, a copy is taken.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Frame_List
+ * @see #REDUCE_FRAME_LIST_INCREMENT
+ */
+static int Frame_List_Add(char *filename)
+{
+	if(strlen(filename) >= REDUCE_FILENAME_LENGTH)
+	{
+		fprintf(stderr,"Frame_List_Add:Filename '%s' too long.\n",filename);
+		return FALSE;
+	}
+	if(Frame_Count >= Frame_List_Allocated_Count)
+	{
+		Frame_List_Allocated_Count += REDUCE_FRAME_LIST_INCREMENT;
+		Frame_List = (char **)realloc(Frame_List,Frame_List_Allocated_Count*sizeof(char *));
+		if(Frame_List == NULL)
+		{
+			fprintf(stderr,"Frame_List_Add:Failed to reallocate frame list (%d).\n",
+				Frame_List_Allocated_Count);
+			return FALSE;
+		}
+	}
+	Frame_List[Frame_Count] = (char *)malloc(strlen(filename)+1);
+	if(Frame_List[Frame_Count] == NULL)
+	{
+		fprintf(stderr,"Frame_List_Add:Failed to allocate filename '%s'.\n",filename);
+		return FALSE;
+	}
+	strcpy(Frame_List[Frame_Count],filename);
+	Frame_Count++;
+	return TRUE;
+}
+
+/**
+ * Add the FITS files (ending in .fits or .fit) in a directory to the frame list, sorted by name.
+ * @param directory The directory to scan.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Frame_List_Add
+ * @see #Frame_List_Compare
+ */
+static int Frame_List_Add_Directory(char *directory)
+{
+	DIR *dir = NULL;
+	struct dirent *entry = NULL;
+	char filename[REDUCE_FILENAME_LENGTH];
+	int first_index,length;
+
+	dir = opendir(directory);
+	if(dir == NULL)
+	{
+		fprintf(stderr,"Frame_List_Add_Directory:Failed to open directory '%s' (%d).\n",directory,errno);
+		return FALSE;
+	}
+	first_index = Frame_Count;
+	while((entry = readdir(dir)) != NULL)
+	{
+		length = strlen(entry->d_name);
+		if(((length > 5)&&(strcmp(entry->d_name+length-5,".fits") == 0))||
+		   ((length > 4)&&(strcmp(entry->d_name+length-4,".fit") == 0)))
+		{
+			if((strlen(directory)+length+2) > REDUCE_FILENAME_LENGTH)
+			{
+				fprintf(stderr,"Frame_List_Add_Directory:Filename '%s/%s' too long.\n",directory,
+					entry->d_name);
+				closedir(dir);
+				return FALSE;
+			}
+			sprintf(filename,"%s/%s",directory,entry->d_name);
+			if(!Frame_List_Add(filename))
+			{
+				closedir(dir);
+				return FALSE;
+			}
+		}
+	}
+	closedir(dir);
+	/* readdir order is arbitrary, sort so the output order is repeatable */
+	qsort(Frame_List+first_index,Frame_Count-first_index,sizeof(char *),Frame_List_Compare);
+	return TRUE;
+}
+
+/**
+ * Add the filenames listed in a file (one per line, blank lines and lines starting with '#' ignored)
+ * to the frame list, in the order listed.
+ * @param list_filename The file containing the list of filenames.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Frame_List_Add
+ */
+static int Frame_List_Add_List_File(char *list_filename)
+{
+	FILE *fp = NULL;
+	char line[REDUCE_FILENAME_LENGTH+2];
+	int length;
+
+	fp = fopen(list_filename,"r");
+	if(fp == NULL)
+	{
+		fprintf(stderr,"Frame_List_Add_List_File:Failed to open '%s'.\n",list_filename);
+		return FALSE;
+	}
+	while(fgets(line,REDUCE_FILENAME_LENGTH+2,fp) != NULL)
+	{
+		length = strlen(line);
+		while((length > 0)&&((line[length-1] == '\n')||(line[length-1] == '\r')||(line[length-1] == ' ')))
+			line[--length] = '\0';
+		if((length == 0)||(line[0] == '#'))
+			continue;
+		if(!Frame_List_Add(line))
+		{
+			fclose(fp);
+			return FALSE;
+		}
+	}
+	fclose(fp);
+	return TRUE;
+}
+
+/**
+ * qsort comparison routine for the frame list.
+ * @param p1 A pointer to the first filename pointer.
+ * @param p2 A pointer to the second filename pointer.
+ * @return The strcmp of the two filenames.
+ */
+static int Frame_List_Compare(const void *p1,const void *p2)
+{
+	return strcmp(*(char * const *)p1,*(char * const *)p2);
+}
+
+/**
+ * Parse the command line arguments.
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Help
+ * @see #Config_Filename
+ * @see #Frame_List_Add
+ * @see #Frame_List_Add_Directory
+ * @see #Frame_List_Add_List_File
+ * @see #Output_Prefix
+ * @see #Output_Format
+ * @see #Worker_Count
+ * @see #No_Dark
+ * @see #No_Flat
+ * @see #AG_On_Type
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"-ag_on")==0)
+		{
+			if(((i+1)<argc)&&(strcmp(argv[i+1],"brightest")==0))
+			{
+				AG_On_Type = COMMAND_AG_ON_TYPE_BRIGHTEST;
+				i++;
+			}
+			else if(((i+2)<argc)&&(strcmp(argv[i+1],"rank")==0))
+			{
+				AG_On_Type = COMMAND_AG_ON_TYPE_RANK;
+				retval = sscanf(argv[i+2],"%d",&AG_On_Rank);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal rank '%s'.\n",argv[i+2]);
+					return FALSE;
+				}
+				i+= 2;
+			}
+			else if(((i+3)<argc)&&(strcmp(argv[i+1],"pixel")==0))
+			{
+				AG_On_Type = COMMAND_AG_ON_TYPE_PIXEL;
+				if((sscanf(argv[i+2],"%f",&AG_On_Pixel_X) != 1)||(sscanf(argv[i+3],"%f",&AG_On_Pixel_Y) != 1))
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal pixel '%s %s'.\n",argv[i+2],argv[i+3]);
+					return FALSE;
+				}
+				i+= 3;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-ag_on requires brightest, rank <n> or pixel <x> <y>.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-config_filename")==0)||(strcmp(argv[i],"-co")==0))
+		{
+			if((i+1)<argc)
+			{
+				Config_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:config filename required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-directory")==0)||(strcmp(argv[i],"-d")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(!Frame_List_Add_Directory(argv[i+1]))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:directory required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-filename")==0)||(strcmp(argv[i],"-f")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(!Frame_List_Add(argv[i+1]))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-format")==0)
+		{
+			if(((i+1)<argc)&&(strcmp(argv[i+1],"csv")==0))
+				Output_Format = REDUCE_FORMAT_CSV;
+			else if(((i+1)<argc)&&(strcmp(argv[i+1],"binary")==0))
+				Output_Format = REDUCE_FORMAT_BINARY;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-format requires csv or binary.\n");
+				return FALSE;
+			}
+			i++;
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if((strcmp(argv[i],"-list")==0)||(strcmp(argv[i],"-l")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(!Frame_List_Add_List_File(argv[i+1]))
+					return FALSE;
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:list filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-no_dark")==0)
+		{
+			No_Dark = TRUE;
+		}
+		else if(strcmp(argv[i],"-no_flat")==0)
+		{
+			No_Flat = TRUE;
+		}
+		else if((strcmp(argv[i],"-output")==0)||(strcmp(argv[i],"-o")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(strlen(argv[i+1]) > (REDUCE_FILENAME_LENGTH-32))
+				{
+					fprintf(stderr,"Parse_Arguments:output prefix '%s' too long.\n",argv[i+1]);
+					return FALSE;
+				}
+				Output_Prefix = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:output prefix required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-workers")==0)||(strcmp(argv[i],"-w")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Worker_Count);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal worker count '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:worker count requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Autoguider Reduce:Help.\n");
+	fprintf(stdout,"Reduce archived autoguider FITS frames with the autoguider dark, flat and object code.\n");
+	fprintf(stdout,"autoguider_reduce -co[nfig_filename] <filename> [-d[irectory] <directory>]\n");
+	fprintf(stdout,"\t[-l[ist] <filename>][-f[ilename] <filename>][-o[utput] <prefix>][-format <csv|binary>]\n");
+	fprintf(stdout,"\t[-w[orkers] <n>][-no_dark][-no_flat][-ag_on <brightest|rank <n>|pixel <x> <y>>][-h[elp]]\n");
+	fprintf(stdout,"\t-config_filename is the autoguider properties file the frames were taken with.\n");
+	fprintf(stdout,"\t-directory adds the .fits/.fit files in a directory (sorted by name), -list adds the\n");
+	fprintf(stdout,"\tfiles listed one per line in a file, -filename adds one file. They can be repeated.\n");
+	fprintf(stdout,"\t-output defaults to autoguider_reduce, writing <prefix>_frames.csv and\n");
+	fprintf(stdout,"\t<prefix>_objects.csv (csv) or <prefix>.telemetry (binary).\n");
+	fprintf(stdout,"\t-workers defaults to the number of online CPUs. -ag_on defaults to brightest.\n");
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
@@ -0,0 +1,796 @@
+/* autoguider_reduction_bench.c
+ * $Id$
+ * Microbenchmark the autoguider per-pixel reduction kernels on synthetic frames.
+ */
+/**
+ * Microbenchmark the autoguider per-pixel reduction kernels on synthetic frames, and write the results as CSV.
+ * Each kernel is driven directly through the autoguider (and CCD library) routines the field and guide loops use:
+ * <ul>
+ * <li>raw_to_reduced_field - Autoguider_Buffer_Raw_To_Reduced_Field.
+ * <li>raw_to_reduced_guide - Autoguider_Buffer_Raw_To_Reduced_Guide.
+ * <li>dark_subtract - Autoguider_Dark_Subtract.
+ * <li>flat_field - Autoguider_Flat_Field.
+ * <li>flip_x - CCD_Exposure_Flip_X.
+ * <li>flip_y - CCD_Exposure_Flip_Y.
+ * <li>object_detect - Autoguider_Object_Detect, which copies the frame, computes the threshold
+ *     (Object_Set_Threshold, using iterstat if object.threshold.stats.type is sigma_clip), calls the libdprt
+ *     detection routine and creates the object mask spans (Object_Mask_Create).
+ * </ul>
+ * Frames are square, from 64x64 (a small guide window) up to 2048x2048 (a binned 1x1 field frame), containing
+ * a noisy bias level and a scattering of stars. Before each call the kernel's input is restored (untimed), so
+ * every call sees the same data. Each kernel/size is called until the minimum run time has elapsed.
+ * Each CSV line contains the mean time per call and per pixel, the bandwidth implied by the bytes the kernel reads
+ * and writes per pixel, and the number of heap allocations per call. The allocations are counted by wrapping
+ * malloc/calloc/realloc at link time (-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc), so only allocations made
+ * by code linked into this executable are counted, not those inside shared libraries.
+ * <pre>
+ * autoguider_reduction_bench [-co[nfig_filename] &lt;filename&gt;] [-csv &lt;filename&gt;] [-label &lt;string&gt;]
+ * 	[-k[ernel] &lt;name&gt;] [-max_size &lt;pixels&gt;] [-min_time &lt;ms&gt;]
+ * </pre>
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_udp.h"
+
+#include "ccd_config.h"
+#include "ccd_exposure.h"
+#include "ccd_setup.h"
+
+#include "autoguider_buffer.h"
+#include "autoguider_dark.h"
+#include "autoguider_flat.h"
+#include "autoguider_general.h"
+#include "autoguider_object.h"
+
+#include "autoguider_test_util.h"
+
+/* hash defines */
+/**
+ * The frame sizes (number of columns and rows) benchmarked.
+ */
+#define BENCH_SIZE_COUNT           (6)
+/**
+ * The default minimum time to run each kernel/size for, in milliseconds.
+ */
+#define DEFAULT_MIN_TIME_MS        (200)
+/**
+ * The minimum number of timed calls for each kernel/size.
+ */
+#define MIN_ITERATION_COUNT        (3)
+/**
+ * The bias level of the synthetic frames, in counts.
+ */
+#define FRAME_BIAS                 (1000.0)
+/**
+ * The peak height of the synthetic stars above the bias, in counts.
+ */
+#define FRAME_STAR_PEAK            (5000.0)
+/**
+ * The Gaussian sigma of the synthetic stars, in pixels.
+ */
+#define FRAME_STAR_SIGMA           (1.5)
+/**
+ * The mean level of the synthetic dark, in counts.
+ */
+#define FRAME_DARK_LEVEL           (20.0)
+/**
+ * The Gaussian sigma of the synthetic dark's pixel to pixel variation, in counts.
+ */
+#define FRAME_DARK_NOISE           (2.0)
+/**
+ * The Gaussian sigma of the synthetic flat's pixel to pixel variation about 1.0.
+ */
+#define FRAME_FLAT_NOISE           (0.02)
+
+/* data types */
+/**
+ * Structure holding the frame a kernel is run on.
+ * <dl>
+ * <dt>NCols</dt> <dd>The number of columns in the frame.</dd>
+ * <dt>NRows</dt> <dd>The number of rows in the frame.</dd>
+ * <dt>Raw_Source</dt> <dd>The synthetic raw frame, never modified.</dd>
+ * <dt>Raw</dt> <dd>A working copy of the raw frame, restored from Raw_Source before each flip.</dd>
+ * <dt>Reduced_Source</dt> <dd>The synthetic raw frame converted to float, never modified.</dd>
+ * <dt>Reduced</dt> <dd>A working copy of the reduced frame, restored from Reduced_Source before each call.</dd>
+ * </dl>
+ */
+struct Bench_Frame_Struct
+{
+	int NCols;
+	int NRows;
+	unsigned short *Raw_Source;
+	unsigned short *Raw;
+	float *Reduced_Source;
+	float *Reduced;
+};
+
+/**
+ * Structure describing one benchmarked kernel.
+ * <dl>
+ * <dt>Name</dt> <dd>The kernel name, as written to the CSV and selected with -kernel.</dd>
+ * <dt>Bytes_Per_Pixel</dt> <dd>The number of bytes the kernel reads and writes per pixel, used to compute
+ *     the bandwidth.</dd>
+ * <dt>Needs_Config</dt> <dd>Boolean, whether the kernel needs the autoguider config to be loaded.</dd>
+ * <dt>Prepare</dt> <dd>Untimed routine, called before each timed call to restore the kernel's input.</dd>
+ * <dt>Run</dt> <dd>The timed routine, calls the kernel once.</dd>
+ * </dl>
+ */
+struct Bench_Kernel_Struct
+{
+	char *Name;
+	int Bytes_Per_Pixel;
+	int Needs_Config;
+	int (*Prepare)(struct Bench_Frame_Struct *frame);
+	int (*Run)(struct Bench_Frame_Struct *frame);
+};
+
+/* internal functions */
+static int Prepare_Raw_Field(struct Bench_Frame_Struct *frame);
+static int Prepare_Raw_Guide(struct Bench_Frame_Struct *frame);
+static int Prepare_Raw(struct Bench_Frame_Struct *frame);
+static int Prepare_Reduced(struct Bench_Frame_Struct *frame);
+static int Run_Raw_To_Reduced_Field(struct Bench_Frame_Struct *frame);
+static int Run_Raw_To_Reduced_Guide(struct Bench_Frame_Struct *frame);
+static int Run_Dark_Subtract(struct Bench_Frame_Struct *frame);
+static int Run_Flat_Field(struct Bench_Frame_Struct *frame);
+static int Run_Flip_X(struct Bench_Frame_Struct *frame);
+static int Run_Flip_Y(struct Bench_Frame_Struct *frame);
+static int Run_Object_Detect(struct Bench_Frame_Struct *frame);
+static int Frame_Create(struct Bench_Frame_Struct *frame,int ncols,int nrows);
+static void Frame_Free(struct Bench_Frame_Struct *frame);
+static int Bench_Kernel(struct Bench_Kernel_Struct *kernel,struct Bench_Frame_Struct *frame,FILE *fp);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The frame sizes benchmarked.
+ * @see #BENCH_SIZE_COUNT
+ */
+static int Size_List[BENCH_SIZE_COUNT] = {64,128,256,512,1024,2048};
+/**
+ * The list of benchmarked kernels.
+ * @see #Bench_Kernel_Struct
+ */
+static struct Bench_Kernel_Struct Kernel_List[] =
+{
+	{"raw_to_reduced_field",6,FALSE,Prepare_Raw_Field,Run_Raw_To_Reduced_Field},
+	{"raw_to_reduced_guide",6,FALSE,Prepare_Raw_Guide,Run_Raw_To_Reduced_Guide},
+	{"dark_subtract",12,FALSE,Prepare_Reduced,Run_Dark_Subtract},
+	{"flat_field",12,FALSE,Prepare_Reduced,Run_Flat_Field},
+	{"flip_x",4,FALSE,Prepare_Raw,Run_Flip_X},
+	{"flip_y",4,FALSE,Prepare_Raw,Run_Flip_Y},
+	{"object_detect",4,TRUE,Prepare_Reduced,Run_Object_Detect},
+	{NULL,0,FALSE,NULL,NULL}
+};
+/**
+ * The autoguider config filename to load, or NULL if no config is loaded (and object_detect is skipped).
+ */
+static char *Config_Filename = NULL;
+/**
+ * The CSV filename to write, or NULL to write to stdout.
+ */
+static char *CSV_Filename = NULL;
+/**
+ * A label written in the first column of every CSV line, to identify the build being benchmarked.
+ */
+static char *Label = "";
+/**
+ * If not NULL, only benchmark the kernel with this name.
+ */
+static char *Selected_Kernel = NULL;
+/**
+ * The largest frame size to benchmark.
+ */
+static int Max_Size = 2048;
+/**
+ * The minimum time to run each kernel/size for, in milliseconds.
+ * @see #DEFAULT_MIN_TIME_MS
+ */
+static int Min_Time_Ms = DEFAULT_MIN_TIME_MS;
+/**
+ * State of the random number generator used to create the synthetic frames.
+ */
+static unsigned int Random_Seed = 12345;
+
+/**
+ * Main program.
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The program returns 0 on success, and non-zero on failure.
+ * @see #Parse_Arguments
+ * @see #Frame_Create
+ * @see #Bench_Kernel
+ * @see autoguider_object.html#Autoguider_Object_Initialise
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Load
+ */
+int main(int argc, char *argv[])
+{
+	struct Bench_Frame_Struct frame;
+	char error_string[AUTOGUIDER_GENERAL_ERROR_STRING_LENGTH];
+	FILE *fp = stdout;
+	int i,k,size;
+
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(Config_Filename != NULL)
+	{
+		CCD_Config_Initialise();
+		if(!CCD_Config_Load(Config_Filename))
+		{
+			fprintf(stderr,"autoguider_reduction_bench:CCD_Config_Load(%s) failed.\n",Config_Filename);
+			return 2;
+		}
+		if(!Autoguider_Object_Initialise())
+		{
+			Autoguider_General_Error_To_String("bench","autoguider_reduction_bench.c","main",
+							   LOG_VERBOSITY_VERY_TERSE,"BENCH",error_string);
+			fprintf(stderr,"autoguider_reduction_bench:%s\n",error_string);
+			return 2;
+		}
+	}
+	if(CSV_Filename != NULL)
+	{
+		fp = fopen(CSV_Filename,"w");
+		if(fp == NULL)
+		{
+			fprintf(stderr,"autoguider_reduction_bench:Failed to open CSV file '%s'.\n",CSV_Filename);
+			return 3;
+		}
+	}
+	fprintf(fp,"label,kernel,ncols,nrows,pixels,iterations,ns_per_call,ns_per_pixel,gb_per_s,allocs_per_call\n");
+	for(i=0;i<BENCH_SIZE_COUNT;i++)
+	{
+		size = Size_List[i];
+		if(size > Max_Size)
+			continue;
+		if(!Frame_Create(&frame,size,size))
+		{
+			Autoguider_General_Error_To_String("bench","autoguider_reduction_bench.c","main",
+							   LOG_VERBOSITY_VERY_TERSE,"BENCH",error_string);
+			fprintf(stderr,"autoguider_reduction_bench:Frame_Create (%dx%d) failed:%s\n",size,size,
+				error_string);
+			return 4;
+		}
+		for(k=0;Kernel_List[k].Name != NULL;k++)
+		{
+			if((Selected_Kernel != NULL)&&(strcmp(Selected_Kernel,Kernel_List[k].Name) != 0))
+				continue;
+			if(Kernel_List[k].Needs_Config && (Config_Filename == NULL))
+			{
+				if(i == 0)
+				{
+					fprintf(stderr,"autoguider_reduction_bench:Skipping %s, it needs -config_filename.\n",
+						Kernel_List[k].Name);
+				}
+				continue;
+			}
+			if(!Bench_Kernel(&(Kernel_List[k]),&frame,fp))
+			{
+				Autoguider_General_Error_To_String("bench","autoguider_reduction_bench.c","main",
+								   LOG_VERBOSITY_VERY_TERSE,"BENCH",error_string);
+				fprintf(stderr,"autoguider_reduction_bench:%s (%dx%d) failed:%s\n",Kernel_List[k].Name,
+					size,size,error_string);
+				Frame_Free(&frame);
+				return 5;
+			}
+			fflush(fp);
+		}
+		Frame_Free(&frame);
+	}
+	if(fp != stdout)
+		fclose(fp);
+	Autoguider_Object_Shutdown();
+	Autoguider_Flat_Shutdown();
+	Autoguider_Dark_Shutdown();
+	Autoguider_Buffer_Shutdown();
+	return 0;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Copy the synthetic raw frame into raw field buffer 0.
+ * @param frame The frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Field_Lock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Field_Unlock
+ */
+static int Prepare_Raw_Field(struct Bench_Frame_Struct *frame)
+{
+	unsigned short *buffer_ptr = NULL;
+
+	if(!Autoguider_Buffer_Raw_Field_Lock(0,&buffer_ptr))
+		return FALSE;
+	memcpy(buffer_ptr,frame->Raw_Source,frame->NCols*frame->NRows*sizeof(unsigned short));
+	return Autoguider_Buffer_Raw_Field_Unlock(0);
+}
+
+/**
+ * Copy the synthetic raw frame into raw guide buffer 0.
+ * @param frame The frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Guide_Lock
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_Guide_Unlock
+ */
+static int Prepare_Raw_Guide(struct Bench_Frame_Struct *frame)
+{
+	unsigned short *buffer_ptr = NULL;
+
+	if(!Autoguider_Buffer_Raw_Guide_Lock(0,&buffer_ptr))
+		return FALSE;
+	memcpy(buffer_ptr,frame->Raw_Source,frame->NCols*frame->NRows*sizeof(unsigned short));
+	return Autoguider_Buffer_Raw_Guide_Unlock(0);
+}
+
+/**
+ * Restore the frame's working raw data from the synthetic raw frame.
+ * @param frame The frame.
+ * @return The routine returns TRUE.
+ */
+static int Prepare_Raw(struct Bench_Frame_Struct *frame)
+{
+	memcpy(frame->Raw,frame->Raw_Source,frame->NCols*frame->NRows*sizeof(unsigned short));
+	return TRUE;
+}
+
+/**
+ * Restore the frame's working reduced data from the synthetic reduced frame.
+ * @param frame The frame.
+ * @return The routine returns TRUE.
+ */
+static int Prepare_Reduced(struct Bench_Frame_Struct *frame)
+{
+	memcpy(frame->Reduced,frame->Reduced_Source,frame->NCols*frame->NRows*sizeof(float));
+	return TRUE;
+}
+
+/**
+ * Convert raw field buffer 0 to reduced field buffer 0.
+ * @param frame The frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_To_Reduced_Field
+ */
+static int Run_Raw_To_Reduced_Field(struct Bench_Frame_Struct *frame)
+{
+	return Autoguider_Buffer_Raw_To_Reduced_Field(0);
+}
+
+/**
+ * Convert raw guide buffer 0 to reduced guide buffer 0.
+ * @param frame The frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_buffer.html#Autoguider_Buffer_Raw_To_Reduced_Guide
+ */
+static int Run_Raw_To_Reduced_Guide(struct Bench_Frame_Struct *frame)
+{
+	return Autoguider_Buffer_Raw_To_Reduced_Guide(0);
+}
+
+/**
+ * Dark subtract the whole of the frame's working reduced data.
+ * @param frame The frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_dark.html#Autoguider_Dark_Subtract
+ */
+static int Run_Dark_Subtract(struct Bench_Frame_Struct *frame)
+{
+	struct CCD_Setup_Window_Struct window;
+
+	window.X_Start = 0;
+	window.Y_Start = 0;
+	window.X_End = 0;
+	window.Y_End = 0;
+	return Autoguider_Dark_Subtract(frame->Reduced,frame->NCols*frame->NRows,frame->NCols,frame->NRows,FALSE,
+					window);
+}
+
+/**
+ * Flat field the whole of the frame's working reduced data.
+ * @param frame The frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_flat.html#Autoguider_Flat_Field
+ */
+static int Run_Flat_Field(struct Bench_Frame_Struct *frame)
+{
+	struct CCD_Setup_Window_Struct window;
+
+	window.X_Start = 0;
+	window.Y_Start = 0;
+	window.X_End = 0;
+	window.Y_End = 0;
+	return Autoguider_Flat_Field(frame->Reduced,frame->NCols*frame->NRows,frame->NCols,frame->NRows,FALSE,
+				     window);
+}
+
+/**
+ * Flip the frame's working raw data in X.
+ * @param frame The frame.
+ * @return The routine returns TRUE.
+ * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Flip_X
+ */
+static int Run_Flip_X(struct Bench_Frame_Struct *frame)
+{
+	CCD_Exposure_Flip_X(frame->NCols,frame->NRows,frame->Raw);
+	return TRUE;
+}
+
+/**
+ * Flip the frame's working raw data in Y.
+ * @param frame The frame.
+ * @return The routine returns TRUE.
+ * @see ../ccd/cdocs/ccd_exposure.html#CCD_Exposure_Flip_Y
+ */
+static int Run_Flip_Y(struct Bench_Frame_Struct *frame)
+{
+	CCD_Exposure_Flip_Y(frame->NCols,frame->NRows,frame->Raw);
+	return TRUE;
+}
+
+/**
+ * Detect objects on the frame's working reduced data, as a full frame field would.
+ * @param frame The frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_object.html#Autoguider_Object_Detect
+ */
+static int Run_Object_Detect(struct Bench_Frame_Struct *frame)
+{
+	return Autoguider_Object_Detect(frame->Reduced,frame->NCols,frame->NRows,0,0,TRUE,0,0);
+}
+
+/**
+ * Create the synthetic frame, and size the autoguider field, guide, dark and flat buffers to match.
+ * The frame is a bias level with approximately Gaussian read noise (the sum of four uniform deviates),
+ * plus one star per 64x64 pixels (at least three) at random positions.
+ * The dark (FRAME_DARK_LEVEL counts with FRAME_DARK_NOISE pixel variation) and flat (1.0 with FRAME_FLAT_NOISE
+ * pixel variation) are filled in, so Autoguider_Dark_Subtract and Autoguider_Flat_Field run on realistic data.
+ * On failure the frame is freed.
+ * @param frame The frame to fill in.
+ * @param ncols The number of columns.
+ * @param nrows The number of rows.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see autoguider_test_random.html#Autoguider_Test_Random_Uniform
+ * @see autoguider_buffer.html#Autoguider_Buffer_Set_Field_Dimension
+ * @see autoguider_buffer.html#Autoguider_Buffer_Set_Guide_Dimension
+ * @see autoguider_dark.html#Autoguider_Dark_Set_Dimension
+ * @see autoguider_flat.html#Autoguider_Flat_Set_Dimension
+ * @see autoguider_dark.html#Autoguider_Dark_Set_Data
+ * @see autoguider_flat.html#Autoguider_Flat_Set_Data
+ * @see autoguider_test_random.html#Autoguider_Test_Random_Gaussian
+ * @see #Frame_Free
+ */
+static int Frame_Create(struct Bench_Frame_Struct *frame,int ncols,int nrows)
+{
+	double value,star_x,star_y,dx,dy;
+	int x,y,s,star_count,pixel_count;
+
+	frame->NCols = ncols;
+	frame->NRows = nrows;
+	pixel_count = ncols*nrows;
+	frame->Raw_Source = (unsigned short *)malloc(pixel_count*sizeof(unsigned short));
+	frame->Raw = (unsigned short *)malloc(pixel_count*sizeof(unsigned short));
+	frame->Reduced_Source = (float *)malloc(pixel_count*sizeof(float));
+	frame->Reduced = (float *)malloc(pixel_count*sizeof(float));
+	if((frame->Raw_Source == NULL)||(frame->Raw == NULL)||(frame->Reduced_Source == NULL)||
+	   (frame->Reduced == NULL))
+	{
+		fprintf(stderr,"Frame_Create:Failed to allocate %dx%d frame.\n",ncols,nrows);
+		Frame_Free(frame);
+		return FALSE;
+	}
+	for(y=0;y<nrows;y++)
+	{
+		for(x=0;x<ncols;x++)
+		{
+			value = FRAME_BIAS+(10.0*(Autoguider_Test_Random_Uniform(&Random_Seed)+
+						  Autoguider_Test_Random_Uniform(&Random_Seed)+
+						  Autoguider_Test_Random_Uniform(&Random_Seed)+
+						  Autoguider_Test_Random_Uniform(&Random_Seed)-2.0));
+			frame->Reduced_Source[(y*ncols)+x] = (float)value;
+		}
+	}
+	star_count = pixel_count/(64*64);
+	if(star_count < 3)
+		star_count = 3;
+	for(s=0;s<star_count;s++)
+	{
+		star_x = 8.0+(Autoguider_Test_Random_Uniform(&Random_Seed)*(ncols-16));
+		star_y = 8.0+(Autoguider_Test_Random_Uniform(&Random_Seed)*(nrows-16));
+		for(y=(int)star_y-6;y<=(int)star_y+6;y++)
+		{
+			for(x=(int)star_x-6;x<=(int)star_x+6;x++)
+			{
+				dx = x-star_x;
+				dy = y-star_y;
+				frame->Reduced_Source[(y*ncols)+x] += (float)(FRAME_STAR_PEAK*
+						exp(-((dx*dx)+(dy*dy))/(2.0*FRAME_STAR_SIGMA*FRAME_STAR_SIGMA)));
+			}
+		}
+	}
+	for(x=0;x<pixel_count;x++)
+	{
+		if(frame->Reduced_Source[x] > 65535.0f)
+			frame->Reduced_Source[x] = 65535.0f;
+		frame->Raw_Source[x] = (unsigned short)frame->Reduced_Source[x];
+		frame->Reduced_Source[x] = (float)frame->Raw_Source[x];
+	}
+	if(!Autoguider_Buffer_Set_Field_Dimension(ncols,nrows,1,1))
+	{
+		Frame_Free(frame);
+		return FALSE;
+	}
+	if(!Autoguider_Buffer_Set_Guide_Dimension(ncols,nrows,1,1))
+	{
+		Frame_Free(frame);
+		return FALSE;
+	}
+	if(!Autoguider_Dark_Set_Dimension(ncols,nrows,1,1))
+	{
+		Frame_Free(frame);
+		return FALSE;
+	}
+	if(!Autoguider_Flat_Set_Dimension(ncols,nrows,1,1))
+	{
+		Frame_Free(frame);
+		return FALSE;
+	}
+	/* the working reduced buffer is restored before every kernel call, use it to build the dark and flat */
+	for(x=0;x<pixel_count;x++)
+	{
+		frame->Reduced[x] = (float)(FRAME_DARK_LEVEL+(FRAME_DARK_NOISE*
+						Autoguider_Test_Random_Gaussian(&Random_Seed)));
+	}
+	if(!Autoguider_Dark_Set_Data(frame->Reduced,pixel_count))
+	{
+		Frame_Free(frame);
+		return FALSE;
+	}
+	for(x=0;x<pixel_count;x++)
+	{
+		frame->Reduced[x] = (float)(1.0+(FRAME_FLAT_NOISE*Autoguider_Test_Random_Gaussian(&Random_Seed)));
+	}
+	if(!Autoguider_Flat_Set_Data(frame->Reduced,pixel_count))
+	{
+		Frame_Free(frame);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Free the data allocated in a frame by Frame_Create.
+ * @param frame The frame.
+ */
+static void Frame_Free(struct Bench_Frame_Struct *frame)
+{
+	if(frame->Raw_Source != NULL)
+		free(frame->Raw_Source);
+	if(frame->Raw != NULL)
+		free(frame->Raw);
+	if(frame->Reduced_Source != NULL)
+		free(frame->Reduced_Source);
+	if(frame->Reduced != NULL)
+		free(frame->Reduced);
+	frame->Raw_Source = NULL;
+	frame->Raw = NULL;
+	frame->Reduced_Source = NULL;
+	frame->Reduced = NULL;
+}
+
+/**
+ * Benchmark one kernel on one frame, and write a CSV line with the results. The kernel is called once untimed
+ * (to fault in any buffers it allocates), then called until Min_Time_Ms has elapsed (and at least
+ * MIN_ITERATION_COUNT times), timing each call with CLOCK_MONOTONIC. The Prepare routine is called (untimed)
+ * before every call.
+ * @param kernel The kernel to benchmark.
+ * @param frame The frame to run the kernel on.
+ * @param fp The file to write the CSV line to.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Min_Time_Ms
+ * @see #MIN_ITERATION_COUNT
+ * @see autoguider_test_alloc.html#Autoguider_Test_Allocation_Count
+ * @see #Label
+ */
+static int Bench_Kernel(struct Bench_Kernel_Struct *kernel,struct Bench_Frame_Struct *frame,FILE *fp)
+{
+	struct timespec start_time,end_time;
+	unsigned long allocation_count;
+	double total_ns,ns_per_call,ns_per_pixel,gb_per_s;
+	int iteration_count,pixel_count;
+
+	pixel_count = frame->NCols*frame->NRows;
+	/* warm up */
+	if(!(*(kernel->Prepare))(frame))
+		return FALSE;
+	if(!(*(kernel->Run))(frame))
+		return FALSE;
+	total_ns = 0.0;
+	iteration_count = 0;
+	allocation_count = 0;
+	while((total_ns < (Min_Time_Ms*(double)AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS))||
+	      (iteration_count < MIN_ITERATION_COUNT))
+	{
+		if(!(*(kernel->Prepare))(frame))
+			return FALSE;
+		allocation_count -= Autoguider_Test_Allocation_Count;
+		clock_gettime(CLOCK_MONOTONIC,&start_time);
+		if(!(*(kernel->Run))(frame))
+			return FALSE;
+		clock_gettime(CLOCK_MONOTONIC,&end_time);
+		allocation_count += Autoguider_Test_Allocation_Count;
+		total_ns += fdifftime(end_time,start_time)*AUTOGUIDER_GENERAL_ONE_SECOND_NS;
+		iteration_count++;
+	}
+	ns_per_call = total_ns/iteration_count;
+	ns_per_pixel = ns_per_call/pixel_count;
+	/* bytes per ns is GB/s */
+	gb_per_s = ((double)kernel->Bytes_Per_Pixel*pixel_count)/ns_per_call;
+	fprintf(fp,"%s,%s,%d,%d,%d,%d,%.1f,%.4f,%.3f,%.2f\n",Label,kernel->Name,frame->NCols,frame->NRows,
+		pixel_count,iteration_count,ns_per_call,ns_per_pixel,gb_per_s,
+		((double)allocation_count)/iteration_count);
+	return TRUE;
+}
+
+/**
+ * Parse the command line arguments.
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Help
+ * @see #Config_Filename
+ * @see #CSV_Filename
+ * @see #Label
+ * @see #Selected_Kernel
+ * @see #Max_Size
+ * @see #Min_Time_Ms
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-config_filename")==0)||(strcmp(argv[i],"-co")==0))
+		{
+			if((i+1)<argc)
+			{
+				Config_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:config filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-csv")==0)
+		{
+			if((i+1)<argc)
+			{
+				CSV_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:CSV filename required.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if((strcmp(argv[i],"-kernel")==0)||(strcmp(argv[i],"-k")==0))
+		{
+			if((i+1)<argc)
+			{
+				Selected_Kernel = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:kernel name required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-label")==0)
+		{
+			if((i+1)<argc)
+			{
+				Label = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:label required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-max_size")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Max_Size);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal max size '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:max size requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-min_time")==0)
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Min_Time_Ms);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal min time '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:min time requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	int k;
+
+	fprintf(stdout,"Autoguider Reduction Bench:Help.\n");
+	fprintf(stdout,"Microbenchmark the per-pixel reduction kernels on synthetic frames, writing CSV.\n");
+	fprintf(stdout,"autoguider_reduction_bench [-co[nfig_filename] <filename>][-csv <filename>]\n");
+	fprintf(stdout,"\t[-label <string>][-k[ernel] <name>][-max_size <pixels>][-min_time <ms>][-h[elp]]\n");
+	fprintf(stdout,"\t-config_filename is an autoguider properties file, needed for object_detect.\n");
+	fprintf(stdout,"\t-csv defaults to stdout. -label is written in the first column, e.g. a build id.\n");
+	fprintf(stdout,"\t-max_size defaults to 2048, -min_time defaults to %d ms.\n",DEFAULT_MIN_TIME_MS);
+	fprintf(stdout,"\tKernels:");
+	for(k=0;Kernel_List[k].Name != NULL;k++)
+		fprintf(stdout," %s",Kernel_List[k].Name);
+	fprintf(stdout,"\n");
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
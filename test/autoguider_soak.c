@@ -0,0 +1,1407 @@
+/* autoguider_soak.c
+ * $Id$
+ * Long duration soak test of the autoguider, tracking resource growth and guide packet cadence over time.
+ */
+/**
+ * Long duration soak test of the autoguider. The autoguider is started (as a child process) with a properties
+ * file that selects the simulated CCD driver (ccd/sim) and sends its TCS guide packets to localhost, where
+ * this program acts as the TCS:
+ * <ul>
+ * <li>The dark model bias/rate frames and the flat the properties file names are created (if they don't exist),
+ *     so the autoguider's normal dark subtraction and flat fielding code paths are exercised.
+ * <li>The autoguider is started, and told to "autoguide on brightest". If guiding stops (or the guide
+ *     packets stop arriving) autoguiding is restarted, and the restart counted.
+ * <li>A guide packet server thread receives the guide packets, and records the interval between them.
+ * <li>A number of client threads repeatedly connect to the autoguider command server and send status and
+ *     getfits commands.
+ * <li>Every sample interval, the autoguider's resident set size and thread count (/proc/&lt;pid&gt;/status),
+ *     open file descriptors (/proc/&lt;pid&gt;/fd), heap bytes in use ("status memory heap") and the
+ *     50th/95th/99th percentile guide packet interval in that sample are written as a line of a CSV file.
+ * </ul>
+ * At the end of the run (or on SIGINT) a least squares line is fitted to each metric over the samples taken
+ * after the warm up period. The test fails if any metric grew by more than its limit over that period,
+ * if the autoguider died, or if no guide packets were received after the warm up.
+ * <pre>
+ * autoguider_soak -co[nfig_filename] &lt;filename&gt; [-autoguider &lt;executable&gt;] [-hours &lt;h&gt;]
+ * 	[-sample_interval &lt;s&gt;] [-warmup &lt;s&gt;] [-clients &lt;n&gt;] [-client_interval &lt;ms&gt;]
+ * 	[-csv &lt;filename&gt;] [-log &lt;filename&gt;] [-rss_limit &lt;kB&gt;] [-heap_limit &lt;bytes&gt;]
+ * 	[-fd_limit &lt;n&gt;] [-thread_limit &lt;n&gt;] [-cadence_limit &lt;ms&gt;]
+ * </pre>
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_SOURCE 1
+/**
+ * This hash define is needed before including source files give us POSIX.4/IEEE1003.1b-1993 prototypes.
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "fitsio.h"
+
+#include "ccd_config.h"
+
+#include "command_server.h"
+
+#include "ngatcil_general.h"
+#include "ngatcil_tcs_guide_packet.h"
+#include "ngatcil_udp_raw.h"
+
+#include "autoguider_general.h"
+
+/* hash defines */
+/**
+ * The maximum length of a filename.
+ */
+#define SOAK_FILENAME_LENGTH        (256)
+/**
+ * The number of guide packet intervals to allocate space for at a time.
+ */
+#define SOAK_INTERVAL_INCREMENT     (1024)
+/**
+ * The number of samples to allocate space for at a time.
+ */
+#define SOAK_SAMPLE_INCREMENT       (256)
+/**
+ * How long to wait (seconds) for the autoguider command server to start answering.
+ */
+#define SOAK_STARTUP_TIMEOUT        (120)
+/**
+ * How long to wait (seconds) for the autoguider to exit after a shutdown command, before killing it.
+ */
+#define SOAK_SHUTDOWN_TIMEOUT       (30)
+/**
+ * Index in the sample value list of the resident set size (kB).
+ */
+#define SOAK_METRIC_RSS             (0)
+/**
+ * Index in the sample value list of the heap bytes in use.
+ */
+#define SOAK_METRIC_HEAP            (1)
+/**
+ * Index in the sample value list of the open file descriptor count.
+ */
+#define SOAK_METRIC_FD              (2)
+/**
+ * Index in the sample value list of the thread count.
+ */
+#define SOAK_METRIC_THREAD          (3)
+/**
+ * Index in the sample value list of the median guide packet interval (ms).
+ */
+#define SOAK_METRIC_CADENCE_P50     (4)
+/**
+ * Index in the sample value list of the 95th percentile guide packet interval (ms).
+ */
+#define SOAK_METRIC_CADENCE_P95     (5)
+/**
+ * Index in the sample value list of the 99th percentile guide packet interval (ms).
+ */
+#define SOAK_METRIC_CADENCE_P99     (6)
+/**
+ * The number of metrics in a sample.
+ */
+#define SOAK_METRIC_COUNT           (7)
+
+/* data types */
+/**
+ * Structure holding one sample of the autoguider's resource usage.
+ * <dl>
+ * <dt>Elapsed</dt> <dd>The number of seconds since the autoguider was started.</dd>
+ * <dt>Value</dt> <dd>The value of each metric (indexed by SOAK_METRIC_*). A negative value means the metric
+ *     could not be measured in this sample (e.g. no guide packets were received).</dd>
+ * <dt>Packet_Count</dt> <dd>The number of guide packets received during the sample.</dd>
+ * <dt>Client_Command_Count</dt> <dd>The total number of client commands sent so far.</dd>
+ * <dt>Client_Error_Count</dt> <dd>The total number of client commands that failed so far.</dd>
+ * <dt>Guide_Restart_Count</dt> <dd>The total number of times autoguiding has been restarted so far.</dd>
+ * </dl>
+ */
+struct Soak_Sample_Struct
+{
+	double Elapsed;
+	double Value[SOAK_METRIC_COUNT];
+	int Packet_Count;
+	int Client_Command_Count;
+	int Client_Error_Count;
+	int Guide_Restart_Count;
+};
+
+/* internal functions */
+static int Soak_Calibration_Create(void);
+static int Soak_Calibration_Create_Frame(char *keyword,int ncols,int nrows,float value);
+static int Soak_Autoguider_Start(void);
+static int Soak_Autoguider_Wait_For_Startup(void);
+static void Soak_Autoguider_Stop(void);
+static int Soak_Autoguider_Is_Alive(void);
+static int Soak_Guide_Check(int force);
+static int Soak_Command(char *command_string,char **reply_string);
+static int Soak_Guide_Packet_Callback(int socket_id,void *message_buff,int message_length);
+static void *Soak_Client_Thread(void *user_arg);
+static int Soak_Sample(double elapsed,struct Soak_Sample_Struct *sample);
+static int Soak_Sample_Proc_Status(struct Soak_Sample_Struct *sample);
+static int Soak_Sample_FD_Count(void);
+static void Soak_Sample_Cadence(struct Soak_Sample_Struct *sample);
+static int Soak_Sample_Add(struct Soak_Sample_Struct *sample);
+static void Soak_Sample_Write(FILE *fp,struct Soak_Sample_Struct *sample);
+static int Soak_Evaluate(void);
+static int Soak_Double_Compare(const void *p1,const void *p2);
+static void Soak_Sleep_Ms(int ms);
+static void Soak_Signal_Handler(int signal_number);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The names of each metric, as used in the CSV header and the summary.
+ * @see #SOAK_METRIC_COUNT
+ */
+static char *Metric_Name_List[SOAK_METRIC_COUNT] =
+{
+	"rss_kb","heap_bytes","fd_count","thread_count","cadence_p50_ms","cadence_p95_ms","cadence_p99_ms"
+};
+/**
+ * The maximum amount each metric may grow over the run (after the warm up), before the test fails.
+ * Set by the -rss_limit, -heap_limit, -fd_limit, -thread_limit and -cadence_limit arguments.
+ * @see #SOAK_METRIC_COUNT
+ */
+static double Metric_Limit_List[SOAK_METRIC_COUNT] =
+{
+	4096.0,1048576.0,2.0,2.0,20.0,20.0,20.0
+};
+/**
+ * The autoguider executable to run.
+ */
+static char *Autoguider_Executable = "autoguider";
+/**
+ * The autoguider config filename, passed to the autoguider and read for the ports and calibration filenames.
+ */
+static char *Config_Filename = NULL;
+/**
+ * The filename to redirect the autoguider's standard output and error to.
+ */
+static char *Log_Filename = "autoguider_soak.log";
+/**
+ * The CSV filename to write the samples to.
+ */
+static char *CSV_Filename = "autoguider_soak.csv";
+/**
+ * How long to run the soak test for, in hours.
+ */
+static double Duration_Hours = 8.0;
+/**
+ * The time between samples, in seconds.
+ */
+static int Sample_Interval = 60;
+/**
+ * Samples taken before this many seconds have elapsed are not used to look for trends.
+ */
+static int Warmup_Length = 600;
+/**
+ * The number of command server client threads.
+ */
+static int Client_Count = 2;
+/**
+ * How long each client thread waits between commands, in milliseconds.
+ */
+static int Client_Interval = 200;
+/**
+ * The commands the client threads send, in turn. Commands starting with getfits return a FITS image.
+ */
+static char *Client_Command_List[] =
+{
+	"status temperature get","status guide active","status guide cadence","status object count",
+	"status object list","getfits guide reduced","getfits field reduced","status guide last_object",
+	"getfits guide raw"
+};
+/**
+ * The number of commands in Client_Command_List.
+ */
+static int Client_Command_Count = sizeof(Client_Command_List)/sizeof(Client_Command_List[0]);
+/**
+ * The autoguider command server port number (command.server.port_number).
+ */
+static int Command_Server_Port = 6571;
+/**
+ * The port number we receive TCS guide packets on (cil.tcs.guide_packet.port_number).
+ */
+static int Guide_Packet_Port = 13025;
+/**
+ * The guide packet server socket.
+ */
+static int Guide_Packet_Socket_Fd = -1;
+/**
+ * The process id of the autoguider.
+ */
+static pid_t Autoguider_Pid = -1;
+/**
+ * Boolean, set when the autoguider has been reaped (it exited or was killed).
+ */
+static int Autoguider_Exited = FALSE;
+/**
+ * The autoguider's wait status, if Autoguider_Exited is TRUE.
+ */
+static int Autoguider_Exit_Status = 0;
+/**
+ * Set by the signal handler (or at the end of the run) to stop the client threads and main loop.
+ */
+static volatile sig_atomic_t Quit = FALSE;
+/**
+ * Mutex protecting the guide packet interval data and client counts.
+ */
+static pthread_mutex_t Soak_Mutex = PTHREAD_MUTEX_INITIALIZER;
+/**
+ * The intervals (ms) between guide packets received during the current sample.
+ */
+static double *Interval_List = NULL;
+/**
+ * The number of intervals in Interval_List.
+ */
+static int Interval_Count = 0;
+/**
+ * The number of intervals Interval_List has space for.
+ */
+static int Interval_Allocated_Count = 0;
+/**
+ * The number of guide packets received during the current sample.
+ */
+static int Packet_Count = 0;
+/**
+ * The time the last guide packet was received. A tv_sec of zero means there is no previous packet
+ * (we have just started, or autoguiding has been restarted), so no interval is recorded for the next packet.
+ */
+static struct timespec Last_Packet_Time = {0L,0L};
+/**
+ * The total number of commands the client threads have sent.
+ */
+static int Total_Client_Command_Count = 0;
+/**
+ * The total number of client commands that failed.
+ */
+static int Total_Client_Error_Count = 0;
+/**
+ * The number of times autoguiding has been (re)started by Soak_Guide_Check, not including the first time.
+ */
+static int Guide_Restart_Count = 0;
+/**
+ * The list of samples taken.
+ */
+static struct Soak_Sample_Struct *Sample_List = NULL;
+/**
+ * The number of samples in Sample_List.
+ */
+static int Sample_Count = 0;
+/**
+ * The number of samples Sample_List has space for.
+ */
+static int Sample_Allocated_Count = 0;
+
+/**
+ * Main program.
+ * <ul>
+ * <li>The arguments are parsed, and the config loaded to get the ports and calibration filenames.
+ * <li>The calibration frames are created if necessary (Soak_Calibration_Create).
+ * <li>The guide packet server is started on the guide packet port.
+ * <li>The autoguider is started (Soak_Autoguider_Start), and we wait for its command server to answer.
+ * <li>Autoguiding is started, and the client threads are started.
+ * <li>Until the run length has elapsed (or we are interrupted, or the autoguider dies), a sample is taken
+ *     every sample interval and written to the CSV file, and autoguiding is restarted if it has stopped.
+ * <li>The client threads are stopped, the autoguider is shut down, and the samples evaluated (Soak_Evaluate).
+ * </ul>
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The program returns 0 if the soak test passed, and non-zero if it failed.
+ * @see #Parse_Arguments
+ * @see #Soak_Calibration_Create
+ * @see #Soak_Autoguider_Start
+ * @see #Soak_Autoguider_Wait_For_Startup
+ * @see #Soak_Guide_Check
+ * @see #Soak_Client_Thread
+ * @see #Soak_Sample
+ * @see #Soak_Evaluate
+ */
+int main(int argc, char *argv[])
+{
+	struct Soak_Sample_Struct sample;
+	struct sigaction signal_action;
+	struct timespec start_time,current_time;
+	pthread_t *client_thread_list = NULL;
+	FILE *csv_fp = NULL;
+	double elapsed,next_sample_elapsed;
+	int i,retval,passed;
+
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(Config_Filename == NULL)
+	{
+		fprintf(stderr,"autoguider_soak:-config_filename must be specified.\n");
+		return 1;
+	}
+	/* load the config the autoguider will use, to get the ports and calibration filenames */
+	CCD_Config_Initialise();
+	if(!CCD_Config_Load(Config_Filename))
+	{
+		fprintf(stderr,"autoguider_soak:CCD_Config_Load(%s) failed.\n",Config_Filename);
+		return 2;
+	}
+	if((!CCD_Config_Get_Integer("command.server.port_number",&Command_Server_Port))||
+	   (!CCD_Config_Get_Integer("cil.tcs.guide_packet.port_number",&Guide_Packet_Port)))
+	{
+		fprintf(stderr,"autoguider_soak:Failed to get command server/guide packet port numbers from '%s'.\n",
+			Config_Filename);
+		return 2;
+	}
+	if(!Soak_Calibration_Create())
+		return 2;
+	/* stop on ^C, and don't die when the autoguider drops a connection */
+	signal_action.sa_handler = Soak_Signal_Handler;
+	sigemptyset(&(signal_action.sa_mask));
+	signal_action.sa_flags = 0;
+	sigaction(SIGINT,&signal_action,NULL);
+	sigaction(SIGTERM,&signal_action,NULL);
+	signal_action.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE,&signal_action,NULL);
+	/* act as the TCS, receiving guide packets */
+	if(!NGATCil_UDP_Server_Start(Guide_Packet_Port,NGATCIL_TCS_GUIDE_PACKET_LENGTH,&Guide_Packet_Socket_Fd,
+				     Soak_Guide_Packet_Callback))
+	{
+		NGATCil_General_Error();
+		return 3;
+	}
+	csv_fp = fopen(CSV_Filename,"w");
+	if(csv_fp == NULL)
+	{
+		fprintf(stderr,"autoguider_soak:Failed to open CSV file '%s' (%d).\n",CSV_Filename,errno);
+		return 3;
+	}
+	fprintf(csv_fp,"elapsed_s");
+	for(i = 0; i < SOAK_METRIC_COUNT; i++)
+		fprintf(csv_fp,",%s",Metric_Name_List[i]);
+	fprintf(csv_fp,",packet_count,client_commands,client_errors,guide_restarts\n");
+	fflush(csv_fp);
+	clock_gettime(CLOCK_MONOTONIC,&start_time);
+	if(!Soak_Autoguider_Start())
+	{
+		fclose(csv_fp);
+		return 4;
+	}
+	if(!Soak_Autoguider_Wait_For_Startup())
+	{
+		Soak_Autoguider_Stop();
+		fclose(csv_fp);
+		return 4;
+	}
+	if(!Soak_Guide_Check(TRUE))
+		fprintf(stderr,"autoguider_soak:Failed to start autoguiding, will retry.\n");
+	/* start the clients */
+	client_thread_list = (pthread_t *)malloc(Client_Count*sizeof(pthread_t));
+	if((Client_Count > 0)&&(client_thread_list == NULL))
+	{
+		fprintf(stderr,"autoguider_soak:Failed to allocate client thread list (%d).\n",Client_Count);
+		Soak_Autoguider_Stop();
+		fclose(csv_fp);
+		return 5;
+	}
+	for(i = 0; i < Client_Count; i++)
+	{
+		retval = pthread_create(&(client_thread_list[i]),NULL,Soak_Client_Thread,NULL);
+		if(retval != 0)
+		{
+			fprintf(stderr,"autoguider_soak:Failed to create client thread %d (%d).\n",i,retval);
+			Client_Count = i;
+			break;
+		}
+	}
+	fprintf(stdout,"autoguider_soak:Running for %.2f hours, sampling every %d s (warm up %d s), "
+		"with %d clients.\n",Duration_Hours,Sample_Interval,Warmup_Length,Client_Count);
+	fflush(stdout);
+	next_sample_elapsed = Sample_Interval;
+	elapsed = 0.0;
+	while((Quit == FALSE)&&(elapsed < (Duration_Hours*3600.0)))
+	{
+		Soak_Sleep_Ms(1000);
+		clock_gettime(CLOCK_MONOTONIC,&current_time);
+		elapsed = fdifftime(current_time,start_time);
+		if(!Soak_Autoguider_Is_Alive())
+		{
+			fprintf(stderr,"autoguider_soak:The autoguider exited after %.0f s.\n",elapsed);
+			break;
+		}
+		if(elapsed >= next_sample_elapsed)
+		{
+			/* a failed sample leaves the structure zeroed, so Packet_Count is 0 and guiding is restarted */
+			memset(&sample,0,sizeof(struct Soak_Sample_Struct));
+			if(Soak_Sample(elapsed,&sample))
+			{
+				if(!Soak_Sample_Add(&sample))
+					break;
+				Soak_Sample_Write(csv_fp,&sample);
+				Soak_Sample_Write(stdout,&sample);
+				fflush(stdout);
+			}
+			next_sample_elapsed += Sample_Interval;
+			/* restart autoguiding if it stopped, or no packets arrived during the sample */
+			Soak_Guide_Check(sample.Packet_Count == 0);
+		}
+	}
+	/* stop the clients and the autoguider */
+	Quit = TRUE;
+	for(i = 0; i < Client_Count; i++)
+		pthread_join(client_thread_list[i],NULL);
+	if(client_thread_list != NULL)
+		free(client_thread_list);
+	Soak_Autoguider_Stop();
+	fclose(csv_fp);
+	NGATCil_UDP_Close(Guide_Packet_Socket_Fd);
+	passed = Soak_Evaluate();
+	fprintf(stdout,"autoguider_soak:%s (samples written to %s).\n",passed ? "PASS" : "FAIL",CSV_Filename);
+	if(Interval_List != NULL)
+		free(Interval_List);
+	if(Sample_List != NULL)
+		free(Sample_List);
+	return passed ? 0 : 6;
+}
+
+/* ----------------------------------------------------------------------------
+** 		internal functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Create the dark model bias and dark rate frames, and the flat, named in the config for the field and guide
+ * binning, if they do not already exist. The bias frame is set to the simulated camera's bias level
+ * (ccd.sim.exposure.bias), the dark rate to zero, and the flat to one, so the calibrations do not change the
+ * simulated frames but the calibration code is still run every frame.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Soak_Calibration_Create_Frame
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_Integer
+ */
+static int Soak_Calibration_Create(void)
+{
+	char keyword[64];
+	char *loop_name[2] = {"field","guide"};
+	int ncols,nrows,x_bin,y_bin,bias,i;
+
+	if(!CCD_Config_Get_Integer("ccd.sim.exposure.bias",&bias))
+	{
+		fprintf(stderr,"Soak_Calibration_Create:'%s' does not configure the simulated driver "
+			"(ccd.sim.exposure.bias).\n",Config_Filename);
+		return FALSE;
+	}
+	for(i = 0; i < 2; i++)
+	{
+		sprintf(keyword,"ccd.%s.ncols",loop_name[i]);
+		if(!CCD_Config_Get_Integer(keyword,&ncols))
+			return FALSE;
+		sprintf(keyword,"ccd.%s.nrows",loop_name[i]);
+		if(!CCD_Config_Get_Integer(keyword,&nrows))
+			return FALSE;
+		sprintf(keyword,"ccd.%s.x_bin",loop_name[i]);
+		if(!CCD_Config_Get_Integer(keyword,&x_bin))
+			return FALSE;
+		sprintf(keyword,"ccd.%s.y_bin",loop_name[i]);
+		if(!CCD_Config_Get_Integer(keyword,&y_bin))
+			return FALSE;
+		if((x_bin < 1)||(y_bin < 1))
+		{
+			fprintf(stderr,"Soak_Calibration_Create:Illegal %s binning (%d,%d).\n",loop_name[i],x_bin,y_bin);
+			return FALSE;
+		}
+		sprintf(keyword,"dark.model.bias.filename.%d.%d",x_bin,y_bin);
+		if(!Soak_Calibration_Create_Frame(keyword,ncols/x_bin,nrows/y_bin,(float)bias))
+			return FALSE;
+		sprintf(keyword,"dark.model.rate.filename.%d.%d",x_bin,y_bin);
+		if(!Soak_Calibration_Create_Frame(keyword,ncols/x_bin,nrows/y_bin,0.0f))
+			return FALSE;
+		sprintf(keyword,"flat.filename.%d.%d",x_bin,y_bin);
+		if(!Soak_Calibration_Create_Frame(keyword,ncols/x_bin,nrows/y_bin,1.0f))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * Create a float FITS image, filled with a constant value, with the filename in the specified config keyword.
+ * If the file already exists it is left alone. The directory it is in is created if necessary (one level only).
+ * @param keyword The config keyword containing the filename.
+ * @param ncols The number of columns in the image.
+ * @param nrows The number of rows in the image.
+ * @param value The value of every pixel.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see ../ccd/cdocs/ccd_config.html#CCD_Config_Get_String
+ */
+static int Soak_Calibration_Create_Frame(char *keyword,int ncols,int nrows,float value)
+{
+	char error_buff[32]; /* fits_get_errstatus returns 30 chars max */
+	char directory[SOAK_FILENAME_LENGTH];
+	fitsfile *fits_fp = NULL;
+	char *filename = NULL;
+	char *ch = NULL;
+	float *data = NULL;
+	long axes[2];
+	int status,i;
+
+	if(!CCD_Config_Get_String(keyword,&filename))
+	{
+		fprintf(stderr,"Soak_Calibration_Create_Frame:'%s' not in '%s'.\n",keyword,Config_Filename);
+		return FALSE;
+	}
+	if(access(filename,F_OK) == 0)
+	{
+		free(filename);
+		return TRUE;
+	}
+	if(strlen(filename) >= SOAK_FILENAME_LENGTH)
+	{
+		fprintf(stderr,"Soak_Calibration_Create_Frame:Filename '%s' too long.\n",filename);
+		free(filename);
+		return FALSE;
+	}
+	strcpy(directory,filename);
+	ch = strrchr(directory,'/');
+	if((ch != NULL)&&(ch != directory))
+	{
+		(*ch) = '\0';
+		if((mkdir(directory,0755) != 0)&&(errno != EEXIST))
+		{
+			fprintf(stderr,"Soak_Calibration_Create_Frame:Failed to create directory '%s' (%d).\n",
+				directory,errno);
+			free(filename);
+			return FALSE;
+		}
+	}
+	data = (float *)malloc(ncols*nrows*sizeof(float));
+	if(data == NULL)
+	{
+		fprintf(stderr,"Soak_Calibration_Create_Frame:Failed to allocate %d x %d image.\n",ncols,nrows);
+		free(filename);
+		return FALSE;
+	}
+	for(i = 0; i < (ncols*nrows); i++)
+		data[i] = value;
+	status = 0;
+	axes[0] = ncols;
+	axes[1] = nrows;
+	fits_create_file(&fits_fp,filename,&status);
+	fits_create_img(fits_fp,FLOAT_IMG,2,axes,&status);
+	fits_write_img(fits_fp,TFLOAT,1,ncols*nrows,data,&status);
+	fits_close_file(fits_fp,&status);
+	free(data);
+	if(status != 0)
+	{
+		fits_get_errstatus(status,error_buff);
+		fprintf(stderr,"Soak_Calibration_Create_Frame:Failed to create '%s' (%d) : %s.\n",filename,status,
+			error_buff);
+		free(filename);
+		return FALSE;
+	}
+	fprintf(stdout,"autoguider_soak:Created %s (%d x %d, %.1f).\n",filename,ncols,nrows,value);
+	free(filename);
+	return TRUE;
+}
+
+/**
+ * Fork and exec the autoguider with the config file, with its standard output and error redirected to
+ * Log_Filename.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Autoguider_Pid
+ */
+static int Soak_Autoguider_Start(void)
+{
+	int fd;
+
+	fflush(stdout);
+	fflush(stderr);
+	Autoguider_Pid = fork();
+	if(Autoguider_Pid < 0)
+	{
+		fprintf(stderr,"Soak_Autoguider_Start:fork failed (%d).\n",errno);
+		return FALSE;
+	}
+	if(Autoguider_Pid == 0)
+	{
+		fd = open(Log_Filename,O_WRONLY|O_CREAT|O_TRUNC,0644);
+		if(fd >= 0)
+		{
+			dup2(fd,STDOUT_FILENO);
+			dup2(fd,STDERR_FILENO);
+			close(fd);
+		}
+		execlp(Autoguider_Executable,Autoguider_Executable,"-co",Config_Filename,(char *)NULL);
+		fprintf(stderr,"Soak_Autoguider_Start:exec of '%s' failed (%d).\n",Autoguider_Executable,errno);
+		_exit(127);
+	}
+	fprintf(stdout,"autoguider_soak:Started %s (pid %d), logging to %s.\n",Autoguider_Executable,
+		(int)Autoguider_Pid,Log_Filename);
+	return TRUE;
+}
+
+/**
+ * Wait until the autoguider's command server answers a status command, or SOAK_STARTUP_TIMEOUT seconds.
+ * @return The routine returns TRUE when the autoguider is answering, and FALSE if it died or did not answer.
+ * @see #SOAK_STARTUP_TIMEOUT
+ * @see #Soak_Command
+ */
+static int Soak_Autoguider_Wait_For_Startup(void)
+{
+	char *reply_string = NULL;
+	int i;
+
+	for(i = 0; i < SOAK_STARTUP_TIMEOUT; i++)
+	{
+		if(!Soak_Autoguider_Is_Alive())
+		{
+			fprintf(stderr,"Soak_Autoguider_Wait_For_Startup:The autoguider exited, see %s.\n",
+				Log_Filename);
+			return FALSE;
+		}
+		if(Soak_Command("status guide active",&reply_string))
+		{
+			free(reply_string);
+			return TRUE;
+		}
+		Soak_Sleep_Ms(1000);
+	}
+	fprintf(stderr,"Soak_Autoguider_Wait_For_Startup:The autoguider did not answer within %d s.\n",
+		SOAK_STARTUP_TIMEOUT);
+	return FALSE;
+}
+
+/**
+ * Stop the autoguider. A shutdown command is sent, and if the autoguider has not exited within
+ * SOAK_SHUTDOWN_TIMEOUT seconds it is killed.
+ * @see #SOAK_SHUTDOWN_TIMEOUT
+ * @see #Soak_Command
+ * @see #Soak_Autoguider_Is_Alive
+ */
+static void Soak_Autoguider_Stop(void)
+{
+	char *reply_string = NULL;
+	int i;
+
+	if(!Soak_Autoguider_Is_Alive())
+		return;
+	if(Soak_Command("autoguide off",&reply_string))
+		free(reply_string);
+	if(Soak_Command("shutdown",&reply_string))
+		free(reply_string);
+	for(i = 0; i < SOAK_SHUTDOWN_TIMEOUT; i++)
+	{
+		if(!Soak_Autoguider_Is_Alive())
+			return;
+		Soak_Sleep_Ms(1000);
+	}
+	fprintf(stderr,"Soak_Autoguider_Stop:The autoguider did not shut down, killing it.\n");
+	kill(Autoguider_Pid,SIGKILL);
+	waitpid(Autoguider_Pid,&Autoguider_Exit_Status,0);
+	Autoguider_Exited = TRUE;
+}
+
+/**
+ * Check whether the autoguider is still running, reaping it if it has exited.
+ * @return The routine returns TRUE if the autoguider is running, FALSE if it has exited.
+ * @see #Autoguider_Pid
+ * @see #Autoguider_Exited
+ */
+static int Soak_Autoguider_Is_Alive(void)
+{
+	pid_t pid;
+
+	if(Autoguider_Exited)
+		return FALSE;
+	pid = waitpid(Autoguider_Pid,&Autoguider_Exit_Status,WNOHANG);
+	if(pid == Autoguider_Pid)
+	{
+		Autoguider_Exited = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * (Re)start autoguiding on the brightest object if the autoguider is not guiding, or force is TRUE.
+ * If autoguiding was running it is stopped first. Last_Packet_Time is reset so the gap while the
+ * field is taken is not recorded as a guide packet interval.
+ * @param force If TRUE, restart autoguiding even if the autoguider says it is guiding.
+ * @return The routine returns TRUE if autoguiding was already running or was started successfully.
+ * @see #Soak_Command
+ * @see #Guide_Restart_Count
+ * @see #Last_Packet_Time
+ */
+static int Soak_Guide_Check(int force)
+{
+	static int first_time = TRUE;
+	char *reply_string = NULL;
+	int guiding,retval;
+
+	guiding = FALSE;
+	if(Soak_Command("status guide active",&reply_string))
+	{
+		guiding = (strcmp(reply_string,"0 true") == 0);
+		free(reply_string);
+	}
+	if(guiding&&(force == FALSE))
+		return TRUE;
+	if(guiding)
+	{
+		if(Soak_Command("autoguide off",&reply_string))
+			free(reply_string);
+	}
+	pthread_mutex_lock(&Soak_Mutex);
+	Last_Packet_Time.tv_sec = 0;
+	Last_Packet_Time.tv_nsec = 0;
+	pthread_mutex_unlock(&Soak_Mutex);
+	if(first_time == FALSE)
+		Guide_Restart_Count++;
+	first_time = FALSE;
+	retval = Soak_Command("autoguide on brightest",&reply_string);
+	if(retval == FALSE)
+		return FALSE;
+	retval = (strncmp(reply_string,"0",1) == 0);
+	if(retval == FALSE)
+		fprintf(stderr,"Soak_Guide_Check:autoguide on brightest failed:%s\n",reply_string);
+	free(reply_string);
+	return retval;
+}
+
+/**
+ * Send a command to the autoguider command server, on a new connection, and return the (text) reply.
+ * @param command_string The command to send.
+ * @param reply_string The address of a pointer to store the reply in. This is allocated, and should be
+ *        freed by the caller (if the routine returns TRUE).
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Command_Server_Port
+ */
+static int Soak_Command(char *command_string,char **reply_string)
+{
+	Command_Server_Handle_T handle;
+	int retval;
+
+	(*reply_string) = NULL;
+	if(!Command_Server_Open_Client("localhost",Command_Server_Port,&handle))
+		return FALSE;
+	retval = Command_Server_Write_Message(handle,command_string);
+	if(retval)
+		retval = Command_Server_Read_Message(handle,reply_string);
+	Command_Server_Close_Client(&handle);
+	return retval;
+}
+
+/**
+ * Guide packet server callback. The interval since the last guide packet is added to Interval_List.
+ * @param socket_id The socket the packet was received on.
+ * @param message_buff The packet.
+ * @param message_length The length of the packet.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Interval_List
+ * @see #Packet_Count
+ * @see #Last_Packet_Time
+ */
+static int Soak_Guide_Packet_Callback(int socket_id,void *message_buff,int message_length)
+{
+	struct timespec current_time;
+	double *new_interval_list = NULL;
+	int retval;
+
+	if(message_length != NGATCIL_TCS_GUIDE_PACKET_LENGTH)
+		return FALSE;
+	clock_gettime(CLOCK_MONOTONIC,&current_time);
+	retval = TRUE;
+	pthread_mutex_lock(&Soak_Mutex);
+	Packet_Count++;
+	if(Last_Packet_Time.tv_sec != 0)
+	{
+		if(Interval_Count >= Interval_Allocated_Count)
+		{
+			new_interval_list = (double *)realloc(Interval_List,(Interval_Allocated_Count+
+							SOAK_INTERVAL_INCREMENT)*sizeof(double));
+			if(new_interval_list != NULL)
+			{
+				Interval_List = new_interval_list;
+				Interval_Allocated_Count += SOAK_INTERVAL_INCREMENT;
+			}
+		}
+		if(Interval_Count < Interval_Allocated_Count)
+			Interval_List[Interval_Count++] = fdifftime(current_time,Last_Packet_Time)*1000.0;
+		else
+			retval = FALSE;
+	}
+	Last_Packet_Time = current_time;
+	pthread_mutex_unlock(&Soak_Mutex);
+	return retval;
+}
+
+/**
+ * Command server client thread. Until Quit is set, the commands in Client_Command_List are sent in turn
+ * (starting at a random place), each on a new connection, waiting Client_Interval milliseconds between commands.
+ * Replies to getfits commands are read as binary, and are a failure if they are not a FITS image.
+ * Other replies are a failure if they do not start with "0".
+ * @param user_arg Not used.
+ * @return The routine returns NULL.
+ * @see #Client_Command_List
+ * @see #Total_Client_Command_Count
+ * @see #Total_Client_Error_Count
+ */
+static void *Soak_Client_Thread(void *user_arg)
+{
+	Command_Server_Handle_T handle;
+	void *data_buffer = NULL;
+	char *reply_string = NULL;
+	char *command_string = NULL;
+	size_t data_buffer_length;
+	int command_index,retval;
+
+	command_index = (int)(((unsigned long)pthread_self())%Client_Command_Count);
+	while(Quit == FALSE)
+	{
+		command_string = Client_Command_List[command_index];
+		command_index = (command_index+1)%Client_Command_Count;
+		retval = Command_Server_Open_Client("localhost",Command_Server_Port,&handle);
+		if(retval)
+		{
+			retval = Command_Server_Write_Message(handle,command_string);
+			if(retval&&(strncmp(command_string,"getfits",7) == 0))
+			{
+				data_buffer = NULL;
+				data_buffer_length = 0;
+				retval = Command_Server_Read_Binary_Message(handle,&data_buffer,&data_buffer_length);
+				if(retval)
+				{
+					retval = ((data_buffer_length > 6)&&(strncmp((char*)data_buffer,"SIMPLE",6) == 0));
+					free(data_buffer);
+				}
+			}
+			else if(retval)
+			{
+				reply_string = NULL;
+				retval = Command_Server_Read_Message(handle,&reply_string);
+				if(retval)
+				{
+					retval = (strncmp(reply_string,"0",1) == 0);
+					free(reply_string);
+				}
+			}
+			Command_Server_Close_Client(&handle);
+		}
+		pthread_mutex_lock(&Soak_Mutex);
+		Total_Client_Command_Count++;
+		if(retval == FALSE)
+			Total_Client_Error_Count++;
+		pthread_mutex_unlock(&Soak_Mutex);
+		Soak_Sleep_Ms(Client_Interval);
+	}
+	return NULL;
+}
+
+/**
+ * Take a sample of the autoguider's resource usage and guide packet cadence.
+ * @param elapsed The number of seconds since the autoguider was started.
+ * @param sample The address of a sample structure to fill in.
+ * @return The routine returns TRUE on success and FALSE on failure (the autoguider has exited).
+ * @see #Soak_Sample_Proc_Status
+ * @see #Soak_Sample_FD_Count
+ * @see #Soak_Sample_Cadence
+ * @see #Soak_Command
+ */
+static int Soak_Sample(double elapsed,struct Soak_Sample_Struct *sample)
+{
+	char *reply_string = NULL;
+	double heap_bytes;
+	int i,retval,fd_count;
+
+	sample->Elapsed = elapsed;
+	for(i = 0; i < SOAK_METRIC_COUNT; i++)
+		sample->Value[i] = -1.0;
+	if(!Soak_Sample_Proc_Status(sample))
+		return FALSE;
+	fd_count = Soak_Sample_FD_Count();
+	if(fd_count >= 0)
+		sample->Value[SOAK_METRIC_FD] = (double)fd_count;
+	if(Soak_Command("status memory heap",&reply_string))
+	{
+		retval = sscanf(reply_string,"0 %lf",&heap_bytes);
+		if(retval == 1)
+			sample->Value[SOAK_METRIC_HEAP] = heap_bytes;
+		free(reply_string);
+	}
+	Soak_Sample_Cadence(sample);
+	pthread_mutex_lock(&Soak_Mutex);
+	sample->Client_Command_Count = Total_Client_Command_Count;
+	sample->Client_Error_Count = Total_Client_Error_Count;
+	pthread_mutex_unlock(&Soak_Mutex);
+	sample->Guide_Restart_Count = Guide_Restart_Count;
+	return TRUE;
+}
+
+/**
+ * Read the autoguider's resident set size (VmRSS) and thread count (Threads) from /proc/&lt;pid&gt;/status.
+ * @param sample The address of a sample structure to fill in.
+ * @return The routine returns TRUE on success and FALSE if the status file could not be opened.
+ * @see #SOAK_METRIC_RSS
+ * @see #SOAK_METRIC_THREAD
+ */
+static int Soak_Sample_Proc_Status(struct Soak_Sample_Struct *sample)
+{
+	char filename[SOAK_FILENAME_LENGTH];
+	char line[256];
+	FILE *fp = NULL;
+	double value;
+
+	sprintf(filename,"/proc/%d/status",(int)Autoguider_Pid);
+	fp = fopen(filename,"r");
+	if(fp == NULL)
+		return FALSE;
+	while(fgets(line,sizeof(line),fp) != NULL)
+	{
+		if(sscanf(line,"VmRSS: %lf",&value) == 1)
+			sample->Value[SOAK_METRIC_RSS] = value;
+		else if(sscanf(line,"Threads: %lf",&value) == 1)
+			sample->Value[SOAK_METRIC_THREAD] = value;
+	}
+	fclose(fp);
+	return TRUE;
+}
+
+/**
+ * Count the autoguider's open file descriptors, by counting the entries in /proc/&lt;pid&gt;/fd.
+ * @return The number of open file descriptors, or -1 if the directory could not be read.
+ */
+static int Soak_Sample_FD_Count(void)
+{
+	char directory_name[SOAK_FILENAME_LENGTH];
+	struct dirent *entry = NULL;
+	DIR *dir = NULL;
+	int count;
+
+	sprintf(directory_name,"/proc/%d/fd",(int)Autoguider_Pid);
+	dir = opendir(directory_name);
+	if(dir == NULL)
+		return -1;
+	count = 0;
+	while((entry = readdir(dir)) != NULL)
+	{
+		if(entry->d_name[0] != '.')
+			count++;
+	}
+	closedir(dir);
+	return count;
+}
+
+/**
+ * Compute the 50th, 95th and 99th percentile guide packet interval from the intervals received since the last
+ * sample, and reset the interval list and packet count for the next sample. If no intervals were received,
+ * the percentiles are left negative (not measured).
+ * @param sample The address of a sample structure to fill in.
+ * @see #Interval_List
+ * @see #Soak_Double_Compare
+ */
+static void Soak_Sample_Cadence(struct Soak_Sample_Struct *sample)
+{
+	pthread_mutex_lock(&Soak_Mutex);
+	sample->Packet_Count = Packet_Count;
+	if(Interval_Count > 0)
+	{
+		qsort(Interval_List,Interval_Count,sizeof(double),Soak_Double_Compare);
+		/* nearest rank percentiles */
+		sample->Value[SOAK_METRIC_CADENCE_P50] = Interval_List[((Interval_Count*50)+99)/100-1];
+		sample->Value[SOAK_METRIC_CADENCE_P95] = Interval_List[((Interval_Count*95)+99)/100-1];
+		sample->Value[SOAK_METRIC_CADENCE_P99] = Interval_List[((Interval_Count*99)+99)/100-1];
+	}
+	Interval_Count = 0;
+	Packet_Count = 0;
+	pthread_mutex_unlock(&Soak_Mutex);
+}
+
+/**
+ * Add a copy of the sample to Sample_List.
+ * @param sample The sample to add.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Sample_List
+ * @see #SOAK_SAMPLE_INCREMENT
+ */
+static int Soak_Sample_Add(struct Soak_Sample_Struct *sample)
+{
+	struct Soak_Sample_Struct *new_sample_list = NULL;
+
+	if(Sample_Count >= Sample_Allocated_Count)
+	{
+		new_sample_list = (struct Soak_Sample_Struct *)realloc(Sample_List,(Sample_Allocated_Count+
+						 SOAK_SAMPLE_INCREMENT)*sizeof(struct Soak_Sample_Struct));
+		if(new_sample_list == NULL)
+		{
+			fprintf(stderr,"Soak_Sample_Add:Failed to reallocate sample list (%d).\n",Sample_Count);
+			return FALSE;
+		}
+		Sample_List = new_sample_list;
+		Sample_Allocated_Count += SOAK_SAMPLE_INCREMENT;
+	}
+	Sample_List[Sample_Count++] = (*sample);
+	return TRUE;
+}
+
+/**
+ * Write a sample as a CSV line. Metrics that were not measured are written as empty fields.
+ * @param fp The file to write to.
+ * @param sample The sample to write.
+ */
+static void Soak_Sample_Write(FILE *fp,struct Soak_Sample_Struct *sample)
+{
+	int i;
+
+	fprintf(fp,"%.0f",sample->Elapsed);
+	for(i = 0; i < SOAK_METRIC_COUNT; i++)
+	{
+		if(sample->Value[i] < 0.0)
+			fprintf(fp,",");
+		else
+			fprintf(fp,",%.1f",sample->Value[i]);
+	}
+	fprintf(fp,",%d,%d,%d,%d\n",sample->Packet_Count,sample->Client_Command_Count,sample->Client_Error_Count,
+		sample->Guide_Restart_Count);
+	fflush(fp);
+}
+
+/**
+ * Evaluate the samples taken after the warm up period. For each metric a least squares line is fitted
+ * to the measured values against elapsed time, and the growth over the evaluated period (slope multiplied
+ * by the period length) compared with the metric's limit. A summary line is printed for each metric.
+ * @return The routine returns TRUE if the soak test passed, and FALSE if it failed.
+ * @see #Sample_List
+ * @see #Metric_Limit_List
+ * @see #Warmup_Length
+ */
+static int Soak_Evaluate(void)
+{
+	double sum_t,sum_v,sum_tt,sum_tv,t,v,slope,growth,first_t,last_t,denominator;
+	int metric,i,n,passed,packet_count;
+
+	passed = TRUE;
+	if(Autoguider_Exited&&((!WIFEXITED(Autoguider_Exit_Status))||(WEXITSTATUS(Autoguider_Exit_Status) != 0))&&
+	   (Quit == FALSE))
+	{
+		fprintf(stdout,"autoguider_soak:FAIL:The autoguider died (status %#x).\n",Autoguider_Exit_Status);
+		passed = FALSE;
+	}
+	packet_count = 0;
+	for(i = 0; i < Sample_Count; i++)
+	{
+		if(Sample_List[i].Elapsed >= Warmup_Length)
+			packet_count += Sample_List[i].Packet_Count;
+	}
+	if(packet_count == 0)
+	{
+		fprintf(stdout,"autoguider_soak:FAIL:No guide packets were received after the warm up.\n");
+		passed = FALSE;
+	}
+	if(Sample_Count > 0)
+	{
+		fprintf(stdout,"autoguider_soak:%d client commands, %d failed, %d guide restarts.\n",
+			Sample_List[Sample_Count-1].Client_Command_Count,Sample_List[Sample_Count-1].Client_Error_Count,
+			Sample_List[Sample_Count-1].Guide_Restart_Count);
+	}
+	for(metric = 0; metric < SOAK_METRIC_COUNT; metric++)
+	{
+		sum_t = 0.0;
+		sum_v = 0.0;
+		sum_tt = 0.0;
+		sum_tv = 0.0;
+		first_t = -1.0;
+		last_t = -1.0;
+		n = 0;
+		for(i = 0; i < Sample_Count; i++)
+		{
+			t = Sample_List[i].Elapsed;
+			v = Sample_List[i].Value[metric];
+			if((t < Warmup_Length)||(v < 0.0))
+				continue;
+			if(first_t < 0.0)
+				first_t = t;
+			last_t = t;
+			sum_t += t;
+			sum_v += v;
+			sum_tt += t*t;
+			sum_tv += t*v;
+			n++;
+		}
+		denominator = (n*sum_tt)-(sum_t*sum_t);
+		if((n < 3)||(denominator <= 0.0))
+		{
+			fprintf(stdout,"autoguider_soak:FAIL:%s:Only %d samples after the warm up, "
+				"cannot look for a trend.\n",Metric_Name_List[metric],n);
+			passed = FALSE;
+			continue;
+		}
+		slope = ((n*sum_tv)-(sum_t*sum_v))/denominator;
+		growth = slope*(last_t-first_t);
+		fprintf(stdout,"autoguider_soak:%s:%s:mean %.1f, growth %.1f over %.0f s (%.3f/hour), limit %.1f.\n",
+			(growth > Metric_Limit_List[metric]) ? "FAIL" : "PASS",Metric_Name_List[metric],sum_v/n,growth,
+			last_t-first_t,slope*3600.0,Metric_Limit_List[metric]);
+		if(growth > Metric_Limit_List[metric])
+			passed = FALSE;
+	}
+	return passed;
+}
+
+/**
+ * qsort comparison routine for doubles, sorting into ascending order.
+ * @param p1 A pointer to the first double.
+ * @param p2 A pointer to the second double.
+ * @return -1, 0 or 1.
+ */
+static int Soak_Double_Compare(const void *p1,const void *p2)
+{
+	double d1,d2;
+
+	d1 = *((const double *)p1);
+	d2 = *((const double *)p2);
+	if(d1 < d2)
+		return -1;
+	if(d1 > d2)
+		return 1;
+	return 0;
+}
+
+/**
+ * Sleep for the specified number of milliseconds.
+ * @param ms The number of milliseconds to sleep for.
+ */
+static void Soak_Sleep_Ms(int ms)
+{
+	struct timespec sleep_time;
+
+	sleep_time.tv_sec = ms/1000;
+	sleep_time.tv_nsec = (ms%1000)*AUTOGUIDER_GENERAL_ONE_MILLISECOND_NS;
+	nanosleep(&sleep_time,NULL);
+}
+
+/**
+ * Signal handler for SIGINT and SIGTERM, stop the soak test early (the samples so far are still evaluated).
+ * @param signal_number The signal received.
+ * @see #Quit
+ */
+static void Soak_Signal_Handler(int signal_number)
+{
+	Quit = TRUE;
+}
+
+/**
+ * Routine to parse command line arguments.
+ * @param argc The number of arguments sent to the program.
+ * @param argv An array of argument strings.
+ * @return The routine returns TRUE on success, and FALSE if an argument was not recognised or illegal.
+ * @see #Help
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i;
+
+	for(i=1;i<argc;i++)
+	{
+		if(strcmp(argv[i],"-autoguider")==0)
+		{
+			if((i+1)<argc)
+			{
+				Autoguider_Executable = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:autoguider executable required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-cadence_limit")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%lf",&(Metric_Limit_List[SOAK_METRIC_CADENCE_P50])) == 1))
+			{
+				Metric_Limit_List[SOAK_METRIC_CADENCE_P95] = Metric_Limit_List[SOAK_METRIC_CADENCE_P50];
+				Metric_Limit_List[SOAK_METRIC_CADENCE_P99] = Metric_Limit_List[SOAK_METRIC_CADENCE_P50];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-cadence_limit requires a number of milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-client_interval")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%d",&Client_Interval) == 1)&&(Client_Interval > 0))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-client_interval requires a number of milliseconds.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-clients")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%d",&Client_Count) == 1)&&(Client_Count >= 0))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-clients requires a number of clients.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-config_filename")==0)||(strcmp(argv[i],"-co")==0))
+		{
+			if((i+1)<argc)
+			{
+				Config_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:config filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-csv")==0)
+		{
+			if((i+1)<argc)
+			{
+				CSV_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:CSV filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-fd_limit")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%lf",&(Metric_Limit_List[SOAK_METRIC_FD])) == 1))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-fd_limit requires a number of file descriptors.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-heap_limit")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%lf",&(Metric_Limit_List[SOAK_METRIC_HEAP])) == 1))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-heap_limit requires a number of bytes.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if(strcmp(argv[i],"-hours")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%lf",&Duration_Hours) == 1)&&(Duration_Hours > 0.0))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-hours requires a number of hours.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-log")==0)
+		{
+			if((i+1)<argc)
+			{
+				Log_Filename = argv[i+1];
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:log filename required.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-rss_limit")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%lf",&(Metric_Limit_List[SOAK_METRIC_RSS])) == 1))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-rss_limit requires a number of kilobytes.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-sample_interval")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%d",&Sample_Interval) == 1)&&(Sample_Interval > 0))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-sample_interval requires a number of seconds.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-thread_limit")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%lf",&(Metric_Limit_List[SOAK_METRIC_THREAD])) == 1))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-thread_limit requires a number of threads.\n");
+				return FALSE;
+			}
+		}
+		else if(strcmp(argv[i],"-warmup")==0)
+		{
+			if(((i+1)<argc)&&(sscanf(argv[i+1],"%d",&Warmup_Length) == 1)&&(Warmup_Length >= 0))
+				i++;
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:-warmup requires a number of seconds.\n");
+				return FALSE;
+			}
+		}
+		else
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Autoguider Soak:Help.\n");
+	fprintf(stdout,"Run the autoguider against the simulated CCD driver for a long time, acting as the TCS and\n");
+	fprintf(stdout,"as command server clients, and fail if its resource usage or guide cadence trends upwards.\n");
+	fprintf(stdout,"autoguider_soak -co[nfig_filename] <filename> [-autoguider <executable>][-hours <h>]\n");
+	fprintf(stdout,"\t[-sample_interval <s>][-warmup <s>][-clients <n>][-client_interval <ms>]\n");
+	fprintf(stdout,"\t[-csv <filename>][-log <filename>][-rss_limit <kB>][-heap_limit <bytes>]\n");
+	fprintf(stdout,"\t[-fd_limit <n>][-thread_limit <n>][-cadence_limit <ms>][-h[elp]]\n");
+	fprintf(stdout,"\t-config_filename is passed to the autoguider, see ../c/sim.autoguider.properties.\n");
+	fprintf(stdout,"\t-hours defaults to 8, -sample_interval to 60 s and -warmup to 600 s.\n");
+	fprintf(stdout,"\t-clients defaults to 2, each sending a command every -client_interval (200) ms.\n");
+	fprintf(stdout,"\tThe limits are the most each metric may grow by (fitted over the run after the warm up),\n");
+	fprintf(stdout,"\tthey default to 4096 kB RSS, 1048576 heap bytes, 2 fds, 2 threads and 20 ms cadence.\n");
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
@@ -0,0 +1,402 @@
+/* autoguider_telemetry_export.cpp
+ * $Id$
+ * Export autoguider binary telemetry files as CSV or gnuplot data.
+ */
+/**
+ * Export autoguider binary telemetry files (written by autoguider_telemetry.c) as CSV or gnuplot data.
+ * Each telemetry file is mmap'ed, its header checked, and the guide frame or object records in it
+ * written to stdout. This replaces grepping the autoguider text logs with scripts such as
+ * autoguider_guide_packets_to_csv and autoguider_object_list_to_csv.
+ * <pre>
+ * autoguider_telemetry_export [-format &lt;csv|gnuplot&gt;] [-type &lt;frame|object&gt;] [-id &lt;id&gt;]
+ * 	&lt;filename&gt; [&lt;filename&gt; ...]
+ * </pre>
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "autoguider_telemetry.h"
+
+/* hash defines */
+/**
+ * Boolean true value.
+ */
+#define TRUE			(1)
+/**
+ * Boolean false value.
+ */
+#define FALSE			(0)
+/**
+ * The maximum number of telemetry files that can be specified on the command line.
+ */
+#define MAX_FILENAME_COUNT	(256)
+
+/* data types */
+/**
+ * Enumeration of output formats.
+ * <ul>
+ * <li>FORMAT_CSV - Comma separated values, with a header line and a UTC date column.
+ * <li>FORMAT_GNUPLOT - Whitespace separated columns, with a '#' comment header. Each guide session (Id)
+ *     is a separate gnuplot data set (separated by two blank lines), so it can be selected with 'index'.
+ * </ul>
+ */
+enum FORMAT
+{
+	FORMAT_CSV=0,FORMAT_GNUPLOT=1
+};
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+/**
+ * The output format.
+ * @see #FORMAT
+ */
+static enum FORMAT Format = FORMAT_CSV;
+/**
+ * The type of record to export, AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME or AUTOGUIDER_TELEMETRY_RECORD_OBJECT.
+ */
+static int Record_Type = AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME;
+/**
+ * If not -1, only export records with this guide session/field Id.
+ */
+static int Selected_Id = -1;
+/**
+ * The list of telemetry files to export.
+ */
+static char *Filename_List[MAX_FILENAME_COUNT];
+/**
+ * The number of telemetry files in Filename_List.
+ */
+static int Filename_Count = 0;
+/**
+ * The Id of the last exported record, used to separate gnuplot data sets.
+ */
+static int Last_Id = -1;
+
+/* internal routines */
+static int Export_File(char *filename);
+static void Print_Header(void);
+static void Print_Record(struct Autoguider_Telemetry_Record_Struct *record);
+static int Parse_Arguments(int argc, char *argv[]);
+static void Help(void);
+
+/* -----------------------------------------------------------------------------
+**      External routines
+** ----------------------------------------------------------------------------- */
+/**
+ * Main program.
+ * <ul>
+ * <li>We parse the command line arguments.
+ * <li>We print the column header.
+ * <li>We export each file in Filename_List.
+ * </ul>
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The program returns 0 on success and non-zero on failure.
+ * @see #Parse_Arguments
+ * @see #Print_Header
+ * @see #Export_File
+ */
+int main(int argc, char *argv[])
+{
+	int i;
+
+	if(!Parse_Arguments(argc,argv))
+		return 1;
+	if(Filename_Count == 0)
+	{
+		fprintf(stderr,"autoguider_telemetry_export:No telemetry files specified.\n");
+		Help();
+		return 2;
+	}
+	Print_Header();
+	for(i=0; i < Filename_Count; i++)
+	{
+		if(!Export_File(Filename_List[i]))
+			return 3;
+	}
+	return 0;
+}
+
+/* -----------------------------------------------------------------------------
+**      Internal routines
+** ----------------------------------------------------------------------------- */
+/**
+ * Export the selected records in a telemetry file. The file is mmap'ed read only, the header checked,
+ * and the records indexed directly. Any partial record at the end of the file (being written by the autoguider)
+ * is ignored.
+ * @param filename The telemetry file to export.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Print_Record
+ * @see #Record_Type
+ * @see #Selected_Id
+ */
+static int Export_File(char *filename)
+{
+	struct Autoguider_Telemetry_File_Header_Struct *header = NULL;
+	struct Autoguider_Telemetry_Record_Struct *record = NULL;
+	struct stat file_stat;
+	char *file_ptr = NULL;
+	size_t record_count,i;
+	int fd;
+
+	fd = open(filename,O_RDONLY);
+	if(fd < 0)
+	{
+		fprintf(stderr,"Export_File:Failed to open '%s' (%d).\n",filename,errno);
+		return FALSE;
+	}
+	if(fstat(fd,&file_stat) != 0)
+	{
+		fprintf(stderr,"Export_File:Failed to stat '%s' (%d).\n",filename,errno);
+		close(fd);
+		return FALSE;
+	}
+	if(file_stat.st_size < (off_t)sizeof(struct Autoguider_Telemetry_File_Header_Struct))
+	{
+		fprintf(stderr,"Export_File:'%s' is too short (%ld bytes).\n",filename,(long)file_stat.st_size);
+		close(fd);
+		return FALSE;
+	}
+	file_ptr = (char *)mmap(NULL,file_stat.st_size,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if(file_ptr == MAP_FAILED)
+	{
+		fprintf(stderr,"Export_File:Failed to mmap '%s' (%d).\n",filename,errno);
+		return FALSE;
+	}
+	header = (struct Autoguider_Telemetry_File_Header_Struct *)file_ptr;
+	if((header->Magic != AUTOGUIDER_TELEMETRY_MAGIC)||(header->Version != AUTOGUIDER_TELEMETRY_VERSION)||
+	   (header->Record_Length != sizeof(struct Autoguider_Telemetry_Record_Struct))||
+	   (header->Header_Length != sizeof(struct Autoguider_Telemetry_File_Header_Struct)))
+	{
+		fprintf(stderr,"Export_File:'%s' is not a version %d telemetry file "
+			"(magic %#x,version %d,record length %d).\n",filename,AUTOGUIDER_TELEMETRY_VERSION,
+			header->Magic,header->Version,header->Record_Length);
+		munmap(file_ptr,file_stat.st_size);
+		return FALSE;
+	}
+	record = (struct Autoguider_Telemetry_Record_Struct *)(file_ptr+header->Header_Length);
+	record_count = (file_stat.st_size-header->Header_Length)/header->Record_Length;
+	for(i=0; i < record_count; i++)
+	{
+		if(record[i].Type != Record_Type)
+			continue;
+		if((Selected_Id != -1)&&(record[i].Id != Selected_Id))
+			continue;
+		Print_Record(&(record[i]));
+	}
+	munmap(file_ptr,file_stat.st_size);
+	return TRUE;
+}
+
+/**
+ * Print the column header for the selected record type and output format.
+ * @see #Format
+ * @see #Record_Type
+ */
+static void Print_Header(void)
+{
+	const char *separator = ",";
+
+	if(Format == FORMAT_GNUPLOT)
+	{
+		fprintf(stdout,"# ");
+		separator = " ";
+	}
+	else
+		fprintf(stdout,"Date%s",separator);
+	if(Record_Type == AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME)
+	{
+		fprintf(stdout,"Time%sId%sFrame Number%sExposure Length%sLoop Cadence%sStatus%sObject Count%s"
+			"CCD X%sCCD Y%sTotal Counts%sPeak Counts%sFWHM X%sFWHM Y\n",separator,separator,separator,
+			separator,separator,separator,separator,separator,separator,separator,separator,separator);
+	}
+	else
+	{
+		fprintf(stdout,"Time%sId%sFrame Number%sIndex%sCCD X%sCCD Y%sBuffer X%sBuffer Y%sTotal Counts%s"
+			"No of Pixels%sPeak Counts%sIs Stellar%sFWHM X%sFWHM Y\n",separator,separator,separator,
+			separator,separator,separator,separator,separator,separator,separator,separator,separator,
+			separator);
+	}
+}
+
+/**
+ * Print one record in the selected output format. In gnuplot format, two blank lines are printed
+ * when the record's Id differs from the previous one.
+ * @param record The record to print.
+ * @see #Format
+ * @see #Last_Id
+ */
+static void Print_Record(struct Autoguider_Telemetry_Record_Struct *record)
+{
+	struct tm *time_tm = NULL;
+	struct tm time_tm_buff;
+	time_t time_secs;
+	char time_string[32];
+	const char *separator = ",";
+	char status_char;
+
+	if(Format == FORMAT_GNUPLOT)
+	{
+		separator = " ";
+		if((Last_Id != -1)&&(record->Id != Last_Id))
+			fprintf(stdout,"\n\n");
+	}
+	else
+	{
+		time_secs = record->Time_Sec;
+		time_tm = gmtime_r(&time_secs,&time_tm_buff);
+		strftime(time_string,31,"%Y-%m-%dT%H:%M:%S",time_tm);
+		fprintf(stdout,"%s.%03d%s",time_string,record->Time_NSec/1000000,separator);
+	}
+	Last_Id = record->Id;
+	fprintf(stdout,"%d.%03d%s%d%s%d%s",record->Time_Sec,record->Time_NSec/1000000,separator,record->Id,separator,
+		record->Frame_Number,separator);
+	if(record->Type == AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME)
+	{
+		status_char = record->Status_Char;
+		if(status_char == '\0')
+			status_char = '-';
+		fprintf(stdout,"%d%s%.3f%s%c%s%d%s%.2f%s%.2f%s%.2f%s%.2f%s%.2f%s%.2f\n",record->Exposure_Length,
+			separator,record->Loop_Cadence,separator,status_char,separator,record->Object_Count,separator,
+			record->CCD_X_Position,separator,record->CCD_Y_Position,separator,record->Total_Counts,separator,
+			record->Peak_Counts,separator,record->FWHM_X,separator,record->FWHM_Y);
+	}
+	else
+	{
+		fprintf(stdout,"%d%s%.2f%s%.2f%s%.2f%s%.2f%s%.2f%s%d%s%.2f%s%d%s%.2f%s%.2f\n",record->Index,separator,
+			record->CCD_X_Position,separator,record->CCD_Y_Position,separator,record->Buffer_X_Position,
+			separator,record->Buffer_Y_Position,separator,record->Total_Counts,separator,
+			record->Pixel_Count,separator,record->Peak_Counts,separator,record->Is_Stellar,separator,
+			record->FWHM_X,separator,record->FWHM_Y);
+	}
+}
+
+/**
+ * Parse the command line arguments.
+ * @param argc The number of arguments.
+ * @param argv The argument list.
+ * @return The routine returns TRUE on success and FALSE on failure.
+ * @see #Help
+ * @see #Format
+ * @see #Record_Type
+ * @see #Selected_Id
+ * @see #Filename_List
+ * @see #Filename_Count
+ */
+static int Parse_Arguments(int argc, char *argv[])
+{
+	int i,retval;
+
+	for(i=1;i<argc;i++)
+	{
+		if((strcmp(argv[i],"-format")==0)||(strcmp(argv[i],"-f")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(strcmp(argv[i+1],"csv") == 0)
+					Format = FORMAT_CSV;
+				else if(strcmp(argv[i+1],"gnuplot") == 0)
+					Format = FORMAT_GNUPLOT;
+				else
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal format '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:Format requires csv or gnuplot.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-help")==0)||(strcmp(argv[i],"-h")==0))
+		{
+			Help();
+			exit(0);
+		}
+		else if((strcmp(argv[i],"-id")==0)||(strcmp(argv[i],"-i")==0))
+		{
+			if((i+1)<argc)
+			{
+				retval = sscanf(argv[i+1],"%d",&Selected_Id);
+				if(retval != 1)
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal id '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:Id requires an integer.\n");
+				return FALSE;
+			}
+		}
+		else if((strcmp(argv[i],"-type")==0)||(strcmp(argv[i],"-t")==0))
+		{
+			if((i+1)<argc)
+			{
+				if(strcmp(argv[i+1],"frame") == 0)
+					Record_Type = AUTOGUIDER_TELEMETRY_RECORD_GUIDE_FRAME;
+				else if(strcmp(argv[i+1],"object") == 0)
+					Record_Type = AUTOGUIDER_TELEMETRY_RECORD_OBJECT;
+				else
+				{
+					fprintf(stderr,"Parse_Arguments:Illegal type '%s'.\n",argv[i+1]);
+					return FALSE;
+				}
+				i++;
+			}
+			else
+			{
+				fprintf(stderr,"Parse_Arguments:Type requires frame or object.\n");
+				return FALSE;
+			}
+		}
+		else if(argv[i][0] == '-')
+		{
+			fprintf(stderr,"Parse_Arguments:argument '%s' not recognized.\n",argv[i]);
+			return FALSE;
+		}
+		else
+		{
+			if(Filename_Count >= MAX_FILENAME_COUNT)
+			{
+				fprintf(stderr,"Parse_Arguments:Too many filenames (max %d).\n",MAX_FILENAME_COUNT);
+				return FALSE;
+			}
+			Filename_List[Filename_Count++] = argv[i];
+		}
+	}
+	return TRUE;
+}
+
+/**
+ * Help routine.
+ */
+static void Help(void)
+{
+	fprintf(stdout,"Autoguider Telemetry Export:Help.\n");
+	fprintf(stdout,"Export autoguider binary telemetry files as CSV or gnuplot data, to stdout.\n");
+	fprintf(stdout,"autoguider_telemetry_export [-f[ormat] <csv|gnuplot>][-t[ype] <frame|object>]\n");
+	fprintf(stdout,"\t[-i[d] <guide/field id>][-h[elp]] <filename> [<filename> ...]\n");
+	fprintf(stdout,"\t-format defaults to csv, -type defaults to frame.\n");
+	fprintf(stdout,"\tIn gnuplot format each guide session is a separate data set, selectable with 'index'.\n");
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
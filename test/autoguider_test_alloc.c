@@ -0,0 +1,75 @@
+/* autoguider_test_alloc.c
+ * $Id$
+ * Heap allocation counting for the benchmarks.
+ */
+/**
+ * Heap allocation counting for the benchmarks. Programs linked with 
+ * -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc call these wrappers instead of malloc/calloc/realloc, which
+ * count the allocation in Autoguider_Test_Allocation_Count and call the real routine. Only allocations made by
+ * code linked into the executable are counted, not those inside shared libraries.
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+#include <stdlib.h>
+#include "autoguider_test_util.h"
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+
+/* external variables */
+/**
+ * The number of heap allocations made (malloc, calloc and realloc calls) by code linked into this program.
+ */
+volatile unsigned long Autoguider_Test_Allocation_Count = 0;
+
+/* wrapped allocation routines */
+extern void *__real_malloc(size_t size);
+extern void *__real_calloc(size_t nmemb,size_t size);
+extern void *__real_realloc(void *ptr,size_t size);
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * malloc wrapper (linked with -Wl,--wrap=malloc), counts the allocation and calls the real malloc.
+ * @param size The number of bytes to allocate.
+ * @return The allocated memory.
+ * @see #Autoguider_Test_Allocation_Count
+ */
+void *__wrap_malloc(size_t size)
+{
+	Autoguider_Test_Allocation_Count++;
+	return __real_malloc(size);
+}
+
+/**
+ * calloc wrapper (linked with -Wl,--wrap=calloc), counts the allocation and calls the real calloc.
+ * @param nmemb The number of elements to allocate.
+ * @param size The size of each element in bytes.
+ * @return The allocated memory.
+ * @see #Autoguider_Test_Allocation_Count
+ */
+void *__wrap_calloc(size_t nmemb,size_t size)
+{
+	Autoguider_Test_Allocation_Count++;
+	return __real_calloc(nmemb,size);
+}
+
+/**
+ * realloc wrapper (linked with -Wl,--wrap=realloc), counts the allocation and calls the real realloc.
+ * @param ptr The memory to reallocate.
+ * @param size The new size in bytes.
+ * @return The reallocated memory.
+ * @see #Autoguider_Test_Allocation_Count
+ */
+void *__wrap_realloc(void *ptr,size_t size)
+{
+	Autoguider_Test_Allocation_Count++;
+	return __real_realloc(ptr,size);
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
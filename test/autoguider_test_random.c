@@ -0,0 +1,64 @@
+/* autoguider_test_random.c
+ * $Id$
+ * Repeatable random numbers for synthetic test data.
+ */
+/**
+ * Repeatable random numbers for synthetic test data, shared by the benchmarks and the simulated camera.
+ * A simple linear congruential generator is used (rather than rand), so the data generated from a given seed
+ * is the same on every platform, and the caller's use of rand is unaffected. The generator state is passed in,
+ * so each user keeps its own sequence.
+ * @author $Author: cjm $
+ * @version $Revision$
+ */
+#include <math.h>
+#include "autoguider_test_util.h"
+
+/* hash defines */
+#ifndef M_PI
+/**
+ * Pi, if math.h did not define it.
+ */
+#define M_PI                       (3.14159265358979323846)
+#endif
+
+/* internal variables */
+/**
+ * Revision control system identifier.
+ */
+static char rcsid[] = "$Id$";
+
+/* ----------------------------------------------------------------------------
+** 		external functions
+** ---------------------------------------------------------------------------- */
+/**
+ * Return a pseudo-random number uniformly distributed between 0 and 1.
+ * @param state The address of the generator state, updated on return. Set it to a fixed seed before the first
+ *        call to get the same sequence on every run.
+ * @return A number in [0,1).
+ */
+double Autoguider_Test_Random_Uniform(unsigned int *state)
+{
+	(*state) = ((*state)*1103515245U)+12345U;
+	return ((double)(((*state)>>8)&0xffffff))/16777216.0;
+}
+
+/**
+ * Return a pseudo-random number from a Gaussian distribution with mean 0 and sigma 1 (Box-Muller).
+ * @param state The address of the generator state, updated on return.
+ * @return The number.
+ * @see #Autoguider_Test_Random_Uniform
+ */
+double Autoguider_Test_Random_Gaussian(unsigned int *state)
+{
+	double u1,u2;
+
+	do
+	{
+		u1 = Autoguider_Test_Random_Uniform(state);
+	} while(u1 <= 0.0);
+	u2 = Autoguider_Test_Random_Uniform(state);
+	return sqrt(-2.0*log(u1))*cos(2.0*M_PI*u2);
+}
+/*
+** $Log: not supported by cvs2svn $
+*/
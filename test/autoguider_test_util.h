@@ -0,0 +1,15 @@
+/* autoguider_test_util.h
+** $Header$
+*/
+#ifndef AUTOGUIDER_TEST_UTIL_H
+#define AUTOGUIDER_TEST_UTIL_H
+
+/* autoguider_test_random.c */
+extern double Autoguider_Test_Random_Uniform(unsigned int *state);
+extern double Autoguider_Test_Random_Gaussian(unsigned int *state);
+/* autoguider_test_alloc.c, only for programs linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc */
+extern volatile unsigned long Autoguider_Test_Allocation_Count;
+/*
+** $Log: not supported by cvs2svn $
+*/
+#endif